@@ -115,6 +115,14 @@ static inline void __dma_page_dev_to_cpu(struct page *page, unsigned long off,
 		___dma_page_dev_to_cpu(page, off, size, dir);
 }
 
+/*
+ * For drivers mapping or syncing several large buffers at once, e.g. all
+ * the frames of a decoder: between these, the inner caches are flushed
+ * once instead of by line for each buffer, when that is cheaper.
+ */
+extern bool dma_cache_batch_begin(size_t size);
+extern void dma_cache_batch_end(bool batched);
+
 /*
  * Return whether the given device DMA address mask can be supported
  * properly.  For example, if your device can only drive the low 24-bits
@@ -82,7 +82,11 @@ static inline void check_context(struct mm_struct *mm)
 
 #endif
 
+#if defined(CONFIG_CPU_HAS_ASID) && !defined(CONFIG_SMP)
+void destroy_context(struct mm_struct *mm);
+#else
 #define destroy_context(mm)		do { } while(0)
+#endif
 
 /*
  * This is called when "tsk" is about to enter lazy TLB mode.
@@ -15,6 +15,12 @@ extern char * strchr(const char * s, int c);
 //#define __HAVE_ARCH_MEMCPY
 extern void * memcpy(void *, const void *, __kernel_size_t);
 
+#ifdef CONFIG_NEON_COPY
+/* memcpy() hands copies from this size on to memcpy_neon(), 0 for none */
+extern unsigned int memcpy_neon_threshold;
+extern bool memcpy_neon(void *, const void *, __kernel_size_t);
+#endif
+
 //#define __HAVE_ARCH_MEMMOVE
 extern void * memmove(void *, const void *, __kernel_size_t);
 
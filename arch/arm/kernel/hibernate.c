@@ -0,0 +1,89 @@
+/*
+ * Hibernation support specific for ARM
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The CPU state is saved with cpu_suspend() as for suspend to RAM, so
+ * the restored kernel comes back through cpu_resume(): once the pages of
+ * the image are copied into place, the MMU is turned off and control
+ * jumps to cpu_resume() in the restored copy of memory.
+ */
+
+#include <linux/mm.h>
+#include <linux/suspend.h>
+#include <asm/cacheflush.h>
+#include <asm/mmu_context.h>
+#include <asm/pgtable.h>
+#include <asm/proc-fns.h>
+#include <asm/system.h>
+#include <asm/tlbflush.h>
+
+extern const void __nosave_begin, __nosave_end;
+extern struct pbe *restore_pblist;
+
+extern int __swsusp_arch_suspend(unsigned long v2p);
+extern void swsusp_arch_jump(void (*fn)(void), void *sp);
+extern void swsusp_arch_mmu_off(unsigned long resume);
+
+/* The copy overwrites the stack of whichever task gets here */
+static u64 resume_stack[PAGE_SIZE / 2 / sizeof(u64)] __nosavedata;
+
+int pfn_is_nosave(unsigned long pfn)
+{
+	unsigned long nosave_begin_pfn = PFN_DOWN(__pa(&__nosave_begin));
+	unsigned long nosave_end_pfn = PFN_UP(__pa(&__nosave_end));
+
+	return (pfn >= nosave_begin_pfn) && (pfn < nosave_end_pfn);
+}
+
+void notrace save_processor_state(void)
+{
+	local_fiq_disable();
+}
+
+void notrace restore_processor_state(void)
+{
+	local_fiq_enable();
+}
+
+int notrace swsusp_arch_suspend(void)
+{
+	return __swsusp_arch_suspend(PHYS_OFFSET - PAGE_OFFSET);
+}
+
+/*
+ * Runs on resume_stack with interrupts off, so neither current nor
+ * anything vmalloc()ed may be touched: the kernel page tables and the
+ * text are the same in both kernels, the rest of memory is not.
+ */
+static void notrace __noreturn swsusp_arch_restore(void)
+{
+	void (*mmu_off)(unsigned long);
+	struct pbe *pbe;
+
+	for (pbe = restore_pblist; pbe; pbe = pbe->next)
+		copy_page(pbe->orig_address, pbe->address);
+
+	/* as for a soft reboot, leaving the caches clean and off */
+	identity_mapping_add(init_mm.pgd, 0, TASK_SIZE);
+	local_flush_tlb_all();
+	flush_cache_all();
+	cpu_proc_fin();
+	flush_cache_all();
+
+	mmu_off = (void *)virt_to_phys(swsusp_arch_mmu_off);
+	mmu_off(virt_to_phys(cpu_resume));
+	for (;;)
+		;
+}
+
+int notrace swsusp_arch_resume(void)
+{
+	/* the pgd of a user mm could be among the pages copied over */
+	cpu_switch_mm(init_mm.pgd, &init_mm);
+	swsusp_arch_jump(swsusp_arch_restore,
+			 resume_stack + ARRAY_SIZE(resume_stack));
+	return 0;
+}
@@ -0,0 +1,317 @@
+/*
+ *  linux/arch/arm/lib/neon_copy.c
+ *
+ *  NEON copy_page(), large memcpy() and memzero()
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The NEON loops move 64 or 128 bytes per iteration through the NEON
+ * load/store unit, which on the Cortex-A8 has a wider path to the L2
+ * than the integer ldm/stm. Entering kernel mode NEON costs a save of
+ * the VFP state of its owner, so memcpy() and __memzero() only go there
+ * for large sizes. clear_page() is a 4KB __memzero(). All of them are
+ * off until the boot self-test has checked and measured them.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/hardirq.h>
+#include <linux/string.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+extern void __copy_page_std(void *to, const void *from);
+extern void __copy_page_neon(void *to, const void *from, unsigned int pld);
+extern void __memcpy_neon(void *dest, const void *src, size_t n,
+			  unsigned int pld);
+extern void __memzero_std(void *ptr, size_t n);
+extern void __memzero_neon(void *ptr, size_t n);
+
+/* Prefetch distance of the NEON loops, in bytes */
+static unsigned int neon_copy_pld = 4 * L1_CACHE_BYTES;
+module_param_named(pld, neon_copy_pld, uint, 0644);
+
+static bool neon_copy_page;
+module_param_named(copy_page, neon_copy_page, bool, 0644);
+
+/* Smallest memcpy() done with NEON, 0 for none */
+unsigned int memcpy_neon_threshold;
+module_param_named(memcpy_threshold, memcpy_neon_threshold, uint, 0644);
+
+/* Smallest __memzero() done with NEON, 0 for none */
+static unsigned int memzero_neon_threshold;
+module_param_named(memzero_threshold, memzero_neon_threshold, uint, 0644);
+
+void copy_page(void *to, const void *from)
+{
+	if (!neon_copy_page || in_interrupt()) {
+		__copy_page_std(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	__copy_page_neon(to, from, neon_copy_pld);
+	kernel_neon_end();
+}
+
+static inline bool neon_copy_lowmem(const void *p, size_t n)
+{
+	return (unsigned long)p >= PAGE_OFFSET &&
+		(unsigned long)p + n <= (unsigned long)high_memory;
+}
+
+/*
+ * Called by memcpy() for copies of at least memcpy_neon_threshold bytes.
+ * Only the linear mapping is known to be normal memory, where the
+ * unaligned NEON accesses cannot fault, so the rest is left to memcpy().
+ */
+bool memcpy_neon(void *dest, const void *src, size_t n)
+{
+	if (in_interrupt() || !neon_copy_lowmem(dest, n) ||
+	    !neon_copy_lowmem(src, n))
+		return false;
+
+	kernel_neon_begin();
+	__memcpy_neon(dest, src, n, neon_copy_pld);
+	kernel_neon_end();
+	return true;
+}
+
+void __memzero(void *ptr, size_t n)
+{
+	if (likely(!memzero_neon_threshold || n < memzero_neon_threshold) ||
+	    in_interrupt() || !neon_copy_lowmem(ptr, n)) {
+		__memzero_std(ptr, n);
+		return;
+	}
+
+	kernel_neon_begin();
+	__memzero_neon(ptr, n);
+	kernel_neon_end();
+}
+
+/*
+ * The benchmark copies between two buffers larger than the L2, so the
+ * page copies see the memory bandwidth that COW faults and page
+ * migration get, while the memcpy() sizes are measured cache hot.
+ */
+#define NEON_COPY_ORDER		7
+#define NEON_COPY_RUNS		3
+#define NEON_MEMCPY_SPAN	(64 * 1024)
+
+/* Below this, saving a live VFP context would cost more than NEON gains */
+#define NEON_MEMCPY_MIN		1024
+#define NEON_MEMCPY_MAX		(16 * 1024)
+
+static unsigned long long __init time_copy_pages(void *dst, void *src,
+						 int pages, unsigned int pld)
+{
+	unsigned long long t, best = ~0ULL;
+	int run, i;
+
+	for (run = 0; run < NEON_COPY_RUNS; run++) {
+		t = sched_clock();
+		for (i = 0; i < pages; i++) {
+			if (!pld) {
+				__copy_page_std(dst + i * PAGE_SIZE,
+						src + i * PAGE_SIZE);
+				continue;
+			}
+			kernel_neon_begin();
+			__copy_page_neon(dst + i * PAGE_SIZE,
+					 src + i * PAGE_SIZE, pld);
+			kernel_neon_end();
+		}
+		best = min(best, sched_clock() - t);
+	}
+
+	return best;
+}
+
+static unsigned long long __init time_memcpy(void *dst, void *src,
+					     size_t size, bool neon)
+{
+	unsigned long long t, best = ~0ULL;
+	size_t off;
+	int run;
+
+	for (run = 0; run < NEON_COPY_RUNS; run++) {
+		t = sched_clock();
+		for (off = 0; off < NEON_MEMCPY_SPAN; off += size) {
+			if (!neon) {
+				memcpy(dst + off, src + off, size);
+				continue;
+			}
+			kernel_neon_begin();
+			__memcpy_neon(dst + off, src + off, size,
+				      neon_copy_pld);
+			kernel_neon_end();
+		}
+		best = min(best, sched_clock() - t);
+	}
+
+	return best;
+}
+
+static unsigned long long __init time_memzero(void *dst, size_t size,
+					      bool neon)
+{
+	unsigned long long t, best = ~0ULL;
+	size_t off;
+	int run;
+
+	for (run = 0; run < NEON_COPY_RUNS; run++) {
+		t = sched_clock();
+		for (off = 0; off < NEON_MEMCPY_SPAN; off += size) {
+			if (!neon) {
+				__memzero_std(dst + off, size);
+				continue;
+			}
+			kernel_neon_begin();
+			__memzero_neon(dst + off, size);
+			kernel_neon_end();
+		}
+		best = min(best, sched_clock() - t);
+	}
+
+	return best;
+}
+
+/* Smallest size from which NEON wins at every larger size, 0 for none */
+static unsigned int __init neon_threshold(void *dst, void *src,
+		unsigned long long (*timer)(void *, void *, size_t, bool))
+{
+	unsigned int threshold = 0;
+	size_t size;
+
+	for (size = NEON_MEMCPY_MAX; size >= NEON_MEMCPY_MIN; size /= 2) {
+		if (timer(dst, src, size, true) >= timer(dst, src, size, false))
+			break;
+		threshold = size;
+	}
+
+	return threshold;
+}
+
+static unsigned long long __init time_memzero_cb(void *dst, void *src,
+						 size_t size, bool neon)
+{
+	return time_memzero(dst, size, neon);
+}
+
+static bool __init neon_copy_zeroed(const u8 *p, size_t n)
+{
+	while (n--)
+		if (*p++)
+			return false;
+	return true;
+}
+
+/*
+ * Check the NEON loops on misaligned heads and odd tails, which the
+ * page and threshold sized runs never hit.
+ */
+static bool __init neon_copy_selftest(u8 *dst, u8 *src)
+{
+	static const size_t sizes[] __initconst = { 1, 7, 8, 63, 64, 65, 200 };
+	size_t i, s, d;
+
+	for (i = 0; i < 256; i++)
+		src[i] = i ^ 0xa5;
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		for (s = 0; s < 4; s++) {
+			for (d = 0; d < 4; d++) {
+				__memzero_std(dst, 512);
+				kernel_neon_begin();
+				__memcpy_neon(dst + d, src + s, sizes[i], 0);
+				kernel_neon_end();
+				if (memcmp(dst + d, src + s, sizes[i]) ||
+				    dst[d + sizes[i]])
+					return false;
+
+				memset(dst, 0xff, 512);
+				kernel_neon_begin();
+				__memzero_neon(dst + d, sizes[i]);
+				kernel_neon_end();
+				if (!neon_copy_zeroed(dst + d, sizes[i]) ||
+				    dst[d + sizes[i]] != 0xff)
+					return false;
+			}
+		}
+	}
+
+	kernel_neon_begin();
+	__copy_page_neon(dst, src, neon_copy_pld);
+	kernel_neon_end();
+	return !memcmp(dst, src, PAGE_SIZE);
+}
+
+static int __init neon_copy_init(void)
+{
+	unsigned long long arm_ns, neon_ns, ns;
+	unsigned int order = NEON_COPY_ORDER;
+	unsigned int pld, best_pld = neon_copy_pld;
+	unsigned long src, dst;
+	int pages;
+
+	if (!cpu_has_neon())
+		return 0;
+
+	for (;;) {
+		src = __get_free_pages(GFP_KERNEL | __GFP_NOWARN, order);
+		dst = __get_free_pages(GFP_KERNEL | __GFP_NOWARN, order);
+		if (src && dst)
+			break;
+		if (src)
+			free_pages(src, order);
+		if (dst)
+			free_pages(dst, order);
+		if (!order--)
+			return -ENOMEM;
+	}
+	pages = 1 << order;
+
+	if (!neon_copy_selftest((u8 *)dst, (u8 *)src)) {
+		pr_err("neon_copy: self-test failed, using the ARM routines\n");
+		goto out;
+	}
+
+	memset((void *)src, 0x5a, pages * PAGE_SIZE);
+
+	arm_ns = time_copy_pages((void *)dst, (void *)src, pages, 0);
+
+	neon_ns = ~0ULL;
+	for (pld = L1_CACHE_BYTES; pld <= 8 * L1_CACHE_BYTES;
+	     pld += L1_CACHE_BYTES) {
+		ns = time_copy_pages((void *)dst, (void *)src, pages, pld);
+		if (ns < neon_ns) {
+			neon_ns = ns;
+			best_pld = pld;
+		}
+	}
+	neon_copy_pld = best_pld;
+
+	memcpy_neon_threshold = neon_threshold((void *)dst, (void *)src,
+					       time_memcpy);
+	memzero_neon_threshold = neon_threshold((void *)dst, NULL,
+						time_memzero_cb);
+
+	neon_copy_page = neon_ns < arm_ns;
+
+	pr_info("neon_copy: copy_page %s (arm %llu ns, neon %llu ns, "
+		"pld %u), memcpy from %u bytes, memzero from %u bytes\n",
+		neon_copy_page ? "neon" : "arm", arm_ns, neon_ns,
+		neon_copy_pld, memcpy_neon_threshold, memzero_neon_threshold);
+out:
+	free_pages(src, order);
+	free_pages(dst, order);
+	return 0;
+}
+late_initcall_sync(neon_copy_init);
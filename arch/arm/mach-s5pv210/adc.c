@@ -52,6 +52,9 @@
 #include <linux/mutex.h>
 #include <linux/io.h>
 #include <linux/uaccess.h>
+#include <linux/interrupt.h>
+#include <linux/completion.h>
+#include <linux/workqueue.h>
 
 #include <asm/irq.h>
 #include <mach/hardware.h>
@@ -72,6 +75,24 @@ static void __iomem	*base_addr;
 static int adc_port;
 struct s3c_adc_mach_info *plat_data;
 
+/*
+ * With the end of conversion interrupt the caller sleeps while the
+ * ADC converts instead of spinning on ECFLG. Without it, as when the
+ * touchscreen driver owns the interrupt, conversions are polled.
+ */
+static int adc_irq = -1;
+static DECLARE_COMPLETION(adc_done);
+static unsigned long adc_data;
+
+#define ADC_CONVERT_TIMEOUT	msecs_to_jiffies(10)
+#define ADC_WORK_BATCH		8
+
+/* Requests queued by s3c_adc_get(), served in order by adc_work */
+static LIST_HEAD(adc_requests);
+static DEFINE_SPINLOCK(adc_request_lock);
+static void s3c_adc_work(struct work_struct *work);
+static DECLARE_WORK(adc_work, s3c_adc_work);
+
 #ifdef ADC_WITH_TOUCHSCREEN
 static DEFINE_MUTEX(adc_mutex);
 
@@ -98,35 +119,67 @@ static int s3c_adc_open(struct inode *inode, struct file *file)
 	return 0;
 }
 
-static unsigned int s3c_adc_convert(void)
+static irqreturn_t s3c_adc_irq(int irq, void *dev_id)
 {
-	unsigned int adc_return = 0;
-	unsigned long data0;
-	unsigned long data1;
+	adc_data = readl(base_addr + S3C_ADCDAT0);
+	writel(0, base_addr + S3C_ADCCLRINT);
+	complete(&adc_done);
 
+	return IRQ_HANDLED;
+}
+
+/* Power up the ADC and select adc_port, once per batch of conversions */
+static void s3c_adc_start(void)
+{
 	writel((readl(base_addr + S3C_ADCCON) | S3C_ADCCON_PRSCEN) & ~S3C_ADCCON_STDBM,
 		base_addr + S3C_ADCCON);
 
 	writel((adc_port & 0xF), base_addr + S3C_ADCMUX);
 
 	udelay(10);
+}
 
-	writel(readl(base_addr + S3C_ADCCON) | S3C_ADCCON_ENABLE_START,
+static void s3c_adc_stop(void)
+{
+	writel((readl(base_addr + S3C_ADCCON) | S3C_ADCCON_STDBM) & ~S3C_ADCCON_PRSCEN,
 		base_addr + S3C_ADCCON);
+}
 
-	do {
-		data0 = readl(base_addr + S3C_ADCCON);
-	} while (!(data0 & S3C_ADCCON_ECFLG));
+static unsigned int s3c_adc_sample(void)
+{
+	unsigned long data0;
+	unsigned long data1;
 
-	data1 = readl(base_addr + S3C_ADCDAT0);
+	if (adc_irq >= 0)
+		INIT_COMPLETION(adc_done);
 
-	writel((readl(base_addr + S3C_ADCCON) | S3C_ADCCON_STDBM) & ~S3C_ADCCON_PRSCEN,
+	writel(readl(base_addr + S3C_ADCCON) | S3C_ADCCON_ENABLE_START,
 		base_addr + S3C_ADCCON);
 
+	if (adc_irq >= 0 &&
+	    wait_for_completion_timeout(&adc_done, ADC_CONVERT_TIMEOUT)) {
+		data1 = adc_data;
+	} else {
+		do {
+			data0 = readl(base_addr + S3C_ADCCON);
+		} while (!(data0 & S3C_ADCCON_ECFLG));
+
+		data1 = readl(base_addr + S3C_ADCDAT0);
+	}
+
 	if (plat_data->resolution == 12)
-		adc_return = data1 & S3C_ADCDAT0_XPDATA_MASK_12BIT;
+		return data1 & S3C_ADCDAT0_XPDATA_MASK_12BIT;
 	else
-		adc_return = data1 & S3C_ADCDAT0_XPDATA_MASK;
+		return data1 & S3C_ADCDAT0_XPDATA_MASK;
+}
+
+static unsigned int s3c_adc_convert(void)
+{
+	unsigned int adc_return;
+
+	s3c_adc_start();
+	adc_return = s3c_adc_sample();
+	s3c_adc_stop();
 
 	return adc_return;
 }
@@ -135,45 +188,96 @@ static unsigned int s3c_adc_convert(void)
 int s3c_adc_get_adc_data(int channel)
 {
 	int adc_value = 0;
-	int cur_adc_port = 0;
 
-#ifdef ADC_WITH_TOUCHSCREEN
+	s3c_adc_get_adc_samples(channel, &adc_value, 1);
+
+	pr_debug("%s : Converted Value: %03d\n", __func__, adc_value);
+
+	return adc_value;
+}
+EXPORT_SYMBOL(s3c_adc_get_adc_data);
+
+/*
+ * Take count conversions of channel into samples, powering up the ADC
+ * and switching the mux once for all of them.
+ */
+int s3c_adc_get_adc_samples(int channel, int *samples, int count)
+{
+	int cur_adc_port;
+	int i;
+
 	mutex_lock(&adc_mutex);
+#ifdef ADC_WITH_TOUCHSCREEN
 	s3c_adc_save_SFR_on_ADC();
-#else
-	mutex_lock(&adc_mutex);
 #endif
 
 	cur_adc_port = adc_port;
 	adc_port = channel;
 
-	adc_value = s3c_adc_convert();
+	s3c_adc_start();
+	for (i = 0; i < count; i++)
+		samples[i] = s3c_adc_sample();
+	s3c_adc_stop();
 
 	adc_port = cur_adc_port;
 
 #ifdef ADC_WITH_TOUCHSCREEN
 	s3c_adc_restore_SFR_on_ADC();
-	mutex_unlock(&adc_mutex);
-#else
-	mutex_unlock(&adc_mutex);
 #endif
+	mutex_unlock(&adc_mutex);
 
-	pr_debug("%s : Converted Value: %03d\n", __func__, adc_value);
+	return count;
+}
+EXPORT_SYMBOL(s3c_adc_get_adc_samples);
 
-	return adc_value;
+static void s3c_adc_work(struct work_struct *work)
+{
+	struct s3c_adc_request *req;
+	int batch[ADC_WORK_BATCH];
+	unsigned int total;
+	int count, n, i, j;
+
+	for (;;) {
+		spin_lock_irq(&adc_request_lock);
+		if (list_empty(&adc_requests)) {
+			spin_unlock_irq(&adc_request_lock);
+			break;
+		}
+		req = list_first_entry(&adc_requests,
+				       struct s3c_adc_request, list);
+		list_del_init(&req->list);
+		spin_unlock_irq(&adc_request_lock);
+
+		/* let other users in between batches of a long request */
+		count = max(req->samples, 1);
+		total = 0;
+		for (i = 0; i < count; i += n) {
+			n = min(count - i, ADC_WORK_BATCH);
+			s3c_adc_get_adc_samples(req->channel, batch, n);
+			for (j = 0; j < n; j++)
+				total += batch[j];
+		}
+
+		req->callback(req->channel, req->param, total / count);
+	}
 }
-EXPORT_SYMBOL(s3c_adc_get_adc_data);
 
 int s3c_adc_get(struct s3c_adc_request *req)
 {
-	unsigned adc_channel = req->channel;
-	int adc_value_ret = 0;
+	unsigned long flags;
+	int ret = 0;
 
-	adc_value_ret = s3c_adc_convert();
+	spin_lock_irqsave(&adc_request_lock, flags);
+	if (req->list.next && !list_empty(&req->list))
+		ret = -EBUSY;
+	else
+		list_add_tail(&req->list, &adc_requests);
+	spin_unlock_irqrestore(&adc_request_lock, flags);
 
-	req->callback(adc_channel, req->param, adc_value_ret);
+	if (!ret)
+		schedule_work(&adc_work);
 
-	return 0;
+	return ret;
 }
 EXPORT_SYMBOL(s3c_adc_get);
 
@@ -310,15 +414,27 @@ static int __devinit s3c_adc_probe(struct platform_device *pdev)
 	writel((readl(base_addr + S3C_ADCCON) | S3C_ADCCON_STDBM) & ~S3C_ADCCON_PRSCEN,
 		base_addr + S3C_ADCCON);
 
+	/* the touchscreen driver may own the interrupt: then it is polled */
+	adc_irq = platform_get_irq(pdev, 1);
+	if (adc_irq >= 0 &&
+	    request_irq(adc_irq, s3c_adc_irq, 0, "s3c-adc", NULL)) {
+		dev_info(dev, "no ADC interrupt, polling conversions\n");
+		adc_irq = -1;
+	}
+
 	ret = misc_register(&s3c_adc_miscdev);
 	if (ret) {
 		printk(KERN_ERR "cannot register miscdev on minor=%d (%d)\n",
 			ADC_MINOR, ret);
-		goto err_clk;
+		goto err_irq;
 	}
 
 	return 0;
 
+err_irq:
+	if (adc_irq >= 0)
+		free_irq(adc_irq, NULL);
+	adc_irq = -1;
 err_clk:
 	clk_disable(adc_clock);
 	clk_put(adc_clock);
@@ -338,6 +454,11 @@ err_req:
 
 static int s3c_adc_remove(struct platform_device *dev)
 {
+	misc_deregister(&s3c_adc_miscdev);
+	cancel_work_sync(&adc_work);
+	if (adc_irq >= 0)
+		free_irq(adc_irq, NULL);
+	adc_irq = -1;
 	clk_disable(adc_clock);
 	clk_put(adc_clock);
 	return 0;
@@ -21,24 +21,43 @@
 
 #include "aries.h"
 
+/*
+ * BT_WAKE is held while the host transmits and dropped once the UART has
+ * had nothing to send for bt_lpm_delay. An A2DP stream writes a packet
+ * every few ms, so rather than pushing the timer back on each of them,
+ * a write only records its time and the timer, when it fires, re-arms
+ * itself for the end of the idle period it finds.
+ */
 static struct aries_bt_lpm {
 	struct hrtimer bt_lpm_timer;
 	ktime_t bt_lpm_delay;
+	ktime_t last_tx;
 } bt_lpm;
 
 static enum hrtimer_restart bt_enter_lpm(struct hrtimer *timer)
 {
+	ktime_t idle_end = ktime_add(bt_lpm.last_tx, bt_lpm.bt_lpm_delay);
+
+	if (ktime_to_ns(ktime_sub(idle_end, ktime_get())) > 0) {
+		hrtimer_set_expires(timer, idle_end);
+		return HRTIMER_RESTART;
+	}
+
 	gpio_set_value(GPIO_BT_WAKE, 0);
 
 	return HRTIMER_NORESTART;
 }
 
+/* Called with the port lock held, interrupts off */
 void aries_bt_uart_wake_peer(struct uart_port *port)
 {
 	if (!bt_lpm.bt_lpm_timer.function)
 		return;
 
-	hrtimer_try_to_cancel(&bt_lpm.bt_lpm_timer);
+	bt_lpm.last_tx = ktime_get();
+	if (hrtimer_active(&bt_lpm.bt_lpm_timer))
+		return;
+
 	gpio_set_value(GPIO_BT_WAKE, 1);
 	hrtimer_start(&bt_lpm.bt_lpm_timer, bt_lpm.bt_lpm_delay, HRTIMER_MODE_REL);
 }
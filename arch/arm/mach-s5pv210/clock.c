@@ -1556,3 +1556,11 @@ void __init s5pv210_register_clocks(void)
 
 	s3c_pwmclk_init();
 }
+
+/* The init_clocks are left running for drivers that enable them */
+static int __init s5pv210_disable_unused_clocks(void)
+{
+	s3c_disable_unused_clocks(init_clocks, ARRAY_SIZE(init_clocks));
+	return 0;
+}
+late_initcall(s5pv210_disable_unused_clocks);
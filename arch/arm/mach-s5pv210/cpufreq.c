@@ -16,11 +16,18 @@
 #include <linux/err.h>
 #include <linux/clk.h>
 #include <linux/io.h>
+#include <linux/jiffies.h>
+#include <linux/kthread.h>
+#include <linux/vmalloc.h>
+#include <linux/wakelock.h>
 #include <linux/suspend.h>
 #include <linux/reboot.h>
 #include <linux/regulator/consumer.h>
 #include <linux/cpufreq.h>
+#include <linux/cpufreq_input_boost.h>
 #include <linux/platform_device.h>
+#include <linux/sched.h>
+#include <linux/workqueue.h>
 
 #include <mach/map.h>
 #include <mach/regs-clock.h>
@@ -47,6 +54,49 @@ static DEFINE_MUTEX(set_freq_lock);
 
 #define SLEEP_FREQ	(800 * 1000) /* Use 800MHz when entering sleep */
 
+/* APLL setting of each level: levels sharing one skip the relock */
+static const u32 s5pv210_apll_val[] = {
+	[OC0] = APLL_VAL_1700,
+	[OC1] = APLL_VAL_1600,
+	[OC2] = APLL_VAL_1520,
+	[OC3] = APLL_VAL_1440,
+	[OC4] = APLL_VAL_1400,
+	[OC5] = APLL_VAL_1320,
+	[OC6] = APLL_VAL_1200,
+	[OC7] = APLL_VAL_1100,
+	[L0] = APLL_VAL_1000,
+	[L1] = APLL_VAL_800,
+	[L2] = APLL_VAL_800,
+};
+
+/*
+ * Measured cost of each kind of transition, from PRECHANGE to
+ * POSTCHANGE (regulator ramps excluded). transition_latency follows
+ * the average of all of them rather than the relock worst case.
+ */
+enum s5pv210_transition {
+	TRANS_DIV,		/* ARM dividers only */
+	TRANS_APLL,		/* APLL relock through MPLL */
+	TRANS_APLL_BUS,		/* relock plus memory bus change */
+	TRANS_KINDS,
+};
+
+static const char * const s5pv210_transition_names[TRANS_KINDS] = {
+	"div",
+	"apll",
+	"apll+bus",
+};
+
+struct s5pv210_transition_cost {
+	unsigned long count;
+	unsigned long long total_ns;
+	unsigned long long max_ns;
+};
+
+static struct s5pv210_transition_cost transition_costs[TRANS_KINDS];
+
+#define S5PV210_TRANSITION_LATENCY	40000	/* ns, until measured */
+
 /*
  * relation has an additional symantics other than the standard of cpufreq
  *	DISALBE_FURTHER_CPUFREQ: disable further access to target until being re-enabled.
@@ -161,7 +211,7 @@ static struct s5pv210_dvs_conf dvs_conf[] = {
 	},
 };
 
-static u32 clkdiv_val[13][11] = {
+static u32 clkdiv_val[MAX_PERF_LEVEL + 1][11] = {
 	/*
 	 * Clock divider value for following
 	 * { APLL, A2M, HCLK_MSYS, PCLK_MSYS,
@@ -202,6 +252,38 @@ static u32 clkdiv_val[13][11] = {
 	{1, 3, 1, 1, 3, 1, 4, 1, 3, 0, 0},
 };
 
+/*
+ * Memory bus (DMC0) levels. DMC0 runs from SCLKMPLL (667MHz) through
+ * the ONEDRAM divider, so it can be scaled without touching the ARM
+ * clock: the bus governor picks a level from the activity hints of the
+ * multimedia blocks and the ARM frequency, or a fixed one (bus_policy).
+ */
+struct s5pv210_bus_level {
+	unsigned long freq;	/* kHz */
+	u32 div;		/* ONEDRAM divider */
+};
+
+static const struct s5pv210_bus_level bus_levels[] = {
+	{ 166000, 3 },
+	{ 133000, 4 },
+	{  83000, 7 },
+};
+
+static const char * const bus_hint_names[BUS_HINT_NUM] = {
+	[BUS_HINT_MFC]	= "mfc",
+	[BUS_HINT_FIMC]	= "fimc",
+	[BUS_HINT_G3D]	= "g3d",
+	[BUS_HINT_INPUT]	= "input",
+};
+
+static atomic_t bus_hints[BUS_HINT_NUM];
+static unsigned int bus_cur;		/* current index in bus_levels */
+static int bus_fixed = -1;		/* bus_policy level, -1 for auto */
+static unsigned int bus_up_khz = 800000;	/* ARM kHz using the top level */
+
+static void s5pv210_bus_work_fn(struct work_struct *work);
+static DECLARE_WORK(bus_work, s5pv210_bus_work_fn);
+
 /*
  * This function set DRAM refresh counter
  * accoriding to operating frequency of DRAM
@@ -234,6 +316,44 @@ static void s5pv210_set_refresh(enum s5pv210_dmc_port ch, unsigned long freq)
 	__raw_writel(tmp1, reg);
 }
 
+/* HCLK_MSYS (memory bus, DMC1) of a level, in kHz */
+static unsigned long s5pv210_hclk_msys(unsigned int index)
+{
+	return s5pv210_freq_table[index].frequency / (clkdiv_val[index][2] + 1);
+}
+
+static int s5pv210_find_index(unsigned int freq)
+{
+	int i;
+
+	for (i = 0; s5pv210_freq_table[i].frequency != CPUFREQ_TABLE_END; i++)
+		if (s5pv210_freq_table[i].frequency == freq)
+			return i;
+	return -1;
+}
+
+static void s5pv210_account_transition(struct cpufreq_policy *policy,
+				       enum s5pv210_transition kind, u64 ns)
+{
+	struct s5pv210_transition_cost *cost = &transition_costs[kind];
+	unsigned long long total_ns = 0;
+	unsigned long count = 0;
+	int i;
+
+	cost->count++;
+	cost->total_ns += ns;
+	if (ns > cost->max_ns)
+		cost->max_ns = ns;
+
+	for (i = 0; i < TRANS_KINDS; i++) {
+		count += transition_costs[i].count;
+		total_ns += transition_costs[i].total_ns;
+	}
+	do_div(total_ns, count);
+	policy->cpuinfo.transition_latency = max_t(unsigned long long,
+						   total_ns, 1000);
+}
+
 int s5pv210_verify_speed(struct cpufreq_policy *policy)
 {
 	if (policy->cpu)
@@ -250,6 +370,185 @@ unsigned int s5pv210_getspeed(unsigned int cpu)
 	return clk_get_rate(cpu_clk) / 1000;
 }
 
+static unsigned int s5pv210_bus_select(unsigned int arm_freq)
+{
+	int i;
+
+	if (bus_fixed >= 0)
+		return bus_fixed;
+
+	for (i = 0; i < BUS_HINT_NUM; i++)
+		if (atomic_read(&bus_hints[i]))
+			return 0;
+
+	if (arm_freq >= bus_up_khz)
+		return 0;
+	if (arm_freq > s5pv210_freq_table[MAX_PERF_LEVEL].frequency)
+		return 1;
+	return ARRAY_SIZE(bus_levels) - 1;
+}
+
+/*
+ * Switch DMC0 to another level, with set_freq_lock held. The refresh
+ * counter is first set for the slower of both rates, so that DRAM is
+ * refreshed often enough while the divider settles.
+ */
+static void s5pv210_set_bus_level(unsigned int level)
+{
+	unsigned long reg;
+
+	if (level == bus_cur)
+		return;
+
+	s5pv210_set_refresh(DMC0, min(bus_levels[level].freq,
+				      bus_levels[bus_cur].freq));
+
+	reg = __raw_readl(S5P_CLK_DIV6);
+	reg &= ~S5P_CLKDIV6_ONEDRAM_MASK;
+	reg |= (bus_levels[level].div << S5P_CLKDIV6_ONEDRAM_SHIFT);
+	__raw_writel(reg, S5P_CLK_DIV6);
+
+	do {
+		reg = __raw_readl(S5P_CLKDIV_STAT1);
+	} while (reg & (1 << 15));
+
+	s5pv210_set_refresh(DMC0, bus_levels[level].freq);
+	bus_cur = level;
+
+	pr_debug("DMC0 bus at %lukHz\n", bus_levels[level].freq);
+}
+
+/* Re-evaluate the bus level, with set_freq_lock held */
+static void s5pv210_bus_update(void)
+{
+	/* The boot level is restored for suspend and reboot */
+	if (no_cpufreq_access)
+		s5pv210_set_bus_level(0);
+	else
+		s5pv210_set_bus_level(s5pv210_bus_select(s5pv210_getspeed(0)));
+}
+
+static void s5pv210_bus_work_fn(struct work_struct *work)
+{
+	mutex_lock(&set_freq_lock);
+	s5pv210_bus_update();
+	mutex_unlock(&set_freq_lock);
+}
+
+/*
+ * Report a multimedia block starting or stopping to use the memory bus.
+ * Safe from any context: the level is changed from a work item.
+ */
+void s5pv210_bus_hint(enum s5pv210_bus_hint hint, bool active)
+{
+	if (active)
+		atomic_inc(&bus_hints[hint]);
+	else if (!atomic_add_unless(&bus_hints[hint], -1, 0))
+		return;
+
+	schedule_work(&bus_work);
+}
+EXPORT_SYMBOL(s5pv210_bus_hint);
+
+/* Touch input raises the bus along with the CPU minimum */
+static int s5pv210_bus_input_boost(struct notifier_block *nb,
+				   unsigned long val, void *data)
+{
+	s5pv210_bus_hint(BUS_HINT_INPUT, val == INPUT_BOOST_START);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block s5pv210_bus_input_nb = {
+	.notifier_call = s5pv210_bus_input_boost,
+};
+
+/*
+ * Thermal cap. The battery temperature, the only sensor on the board, is
+ * reported at every battery poll; it is averaged and its trend projected
+ * THERMAL_LOOKAHEAD ahead. While the projection is above the trip
+ * temperature the highest allowed level drops one step per poll, down to
+ * the floor level, and it only rises a step again once the projection is
+ * THERMAL_HYST below the trip. Moving one level at a time against the
+ * projection settles on the level the device can sustain, where capping
+ * on the temperature itself would swing between full speed and the
+ * floor.
+ */
+#define THERMAL_HYST		20		/* 0.1 degC */
+#define THERMAL_LOOKAHEAD	(120 * HZ)
+
+static int thermal_trip_temp = 420;	/* 0.1 degC, 0 for no cap */
+static unsigned int thermal_floor_level = L0;	/* lowest level capped to */
+static unsigned int thermal_cap_level = OC0;	/* highest level allowed */
+static int thermal_avg;			/* 0.1 degC, 0 before a report */
+static int thermal_forecast;
+static unsigned long thermal_stamp;
+
+static int s5pv210_thermal_policy(struct notifier_block *nb,
+				  unsigned long event, void *data)
+{
+	struct cpufreq_policy *policy = data;
+
+	if (event == CPUFREQ_ADJUST && thermal_cap_level != OC0)
+		cpufreq_verify_within_limits(policy, 0,
+				s5pv210_freq_table[thermal_cap_level].frequency);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block s5pv210_thermal_nb = {
+	.notifier_call = s5pv210_thermal_policy,
+};
+
+static void s5pv210_thermal_set_cap(unsigned int cap)
+{
+	if (cap == thermal_cap_level)
+		return;
+
+	pr_info("thermal: %d.%d degC, capped at %umhz\n",
+		thermal_avg / 10, (int)abs(thermal_avg % 10),
+		s5pv210_freq_table[cap].frequency / 1000);
+	thermal_cap_level = cap;
+	cpufreq_update_policy(0);
+}
+
+/* temp in 0.1 degC, from the battery poll */
+void s5pv210_thermal_update(int temp)
+{
+	unsigned long now = jiffies, elapsed = now - thermal_stamp;
+	int avg = thermal_avg, rise;
+	unsigned int cap = thermal_cap_level;
+
+	if (!thermal_avg) {
+		thermal_avg = thermal_forecast = temp;
+		thermal_stamp = now;
+		return;
+	}
+
+	thermal_avg = (3 * thermal_avg + temp) / 4;
+	thermal_stamp = now;
+
+	/* polls further apart than the lookahead are taken as that far */
+	rise = thermal_avg - avg;
+	if (elapsed && elapsed < THERMAL_LOOKAHEAD)
+		rise = rise * (int)(THERMAL_LOOKAHEAD / elapsed);
+	thermal_forecast = thermal_avg + rise;
+
+	if (!thermal_trip_temp)
+		cap = OC0;
+	else if (thermal_forecast > thermal_trip_temp &&
+		 cap < thermal_floor_level)
+		cap++;
+	else if (thermal_forecast < thermal_trip_temp - THERMAL_HYST &&
+		 cap > OC0)
+		cap--;
+	/* a floor raised past the cap lifts it at once */
+	if (cap > thermal_floor_level)
+		cap = thermal_floor_level;
+
+	s5pv210_thermal_set_cap(cap);
+}
+EXPORT_SYMBOL(s5pv210_thermal_update);
+
 #ifdef CONFIG_DVFS_LIMIT
 void s5pv210_lock_dvfs_high_level(uint nToken, uint perf_level)
 {
@@ -317,9 +616,12 @@ static int s5pv210_target(struct cpufreq_policy *policy,
 {
 	unsigned long reg;
 	unsigned int index;
+	int old_index;
 	unsigned int pll_changing = 0;
 	unsigned int bus_speed_changing = 0;
 	unsigned int arm_volt, int_volt;
+	enum s5pv210_transition kind;
+	u64 start;
 	int ret = 0;
 
 	mutex_lock(&set_freq_lock);
@@ -378,17 +680,31 @@ static int s5pv210_target(struct cpufreq_policy *policy,
 	}
 
 	cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
+	start = sched_clock();
 
 	/* Don't use cpufreq_frequency_table_target() any more as it */
 	/* may not be accurate. Compare against freqs.old instead */
+	old_index = s5pv210_find_index(freqs.old);
 
-	/* Check if there need to change PLL */
-	if ((index <= L0) || (freqs.old >= s5pv210_freq_table[L0].frequency))
+	/*
+	 * Check if there need to change PLL: not between levels sharing
+	 * an APLL setting, which only differ in their ARM dividers.
+	 */
+	if (old_index < 0 ||
+	    s5pv210_apll_val[old_index] != s5pv210_apll_val[index])
 		pll_changing = 1;
 
-	/* Check if there need to change System bus clock */
+	/*
+	 * Check if there need to change System bus clock. Leaving or
+	 * entering L2 does not when the memory bus ends up at the same
+	 * rate, so the refresh counters can be left alone.
+	 */
 	if ((index == L2) || (freqs.old == s5pv210_freq_table[L2].frequency))
 		bus_speed_changing = 1;
+	if (bus_speed_changing && old_index >= 0 &&
+	    s5pv210_hclk_msys(old_index) == s5pv210_hclk_msys(index) &&
+	    clkdiv_val[old_index][8] == clkdiv_val[index][8])
+		bus_speed_changing = 0;
 
 	if (bus_speed_changing) {
 		/*
@@ -502,38 +818,7 @@ static int s5pv210_target(struct cpufreq_policy *policy,
 		 * 6-1. Set PMS values
 		 * 6-2. Wait untile the PLL is locked
 		 */
-		switch (index) {
-		case OC0:
-			__raw_writel(APLL_VAL_1700, S5P_APLL_CON);
-			break;
-		case OC1:
-			__raw_writel(APLL_VAL_1600, S5P_APLL_CON);
-			break;
-		case OC2:
-			__raw_writel(APLL_VAL_1520, S5P_APLL_CON);
-			break;
-		case OC3:
-			__raw_writel(APLL_VAL_1440, S5P_APLL_CON);
-			break;
-		case OC4:
-			__raw_writel(APLL_VAL_1400, S5P_APLL_CON);
-			break;
-		case OC5:
-			__raw_writel(APLL_VAL_1320, S5P_APLL_CON);
-			break;
-		case OC6:
-			__raw_writel(APLL_VAL_1200, S5P_APLL_CON);
-			break;
-		case OC7:
-			__raw_writel(APLL_VAL_1100, S5P_APLL_CON);
-			break;
-		case L0:
-			__raw_writel(APLL_VAL_1000, S5P_APLL_CON);
-			break;
-		default:
-			__raw_writel(APLL_VAL_800, S5P_APLL_CON);
-			break;
-		}
+		__raw_writel(s5pv210_apll_val[index], S5P_APLL_CON);
 
 		do {
 			reg = __raw_readl(S5P_APLL_CON);
@@ -593,9 +878,10 @@ static int s5pv210_target(struct cpufreq_policy *policy,
 	 * and memory refresh parameter should be changed
 	 */
 	if (bus_speed_changing) {
+		/* DMC0 stays at the level picked by the bus governor */
 		reg = __raw_readl(S5P_CLK_DIV6);
 		reg &= ~S5P_CLKDIV6_ONEDRAM_MASK;
-		reg |= (clkdiv_val[index][8] << S5P_CLKDIV6_ONEDRAM_SHIFT);
+		reg |= (bus_levels[bus_cur].div << S5P_CLKDIV6_ONEDRAM_SHIFT);
 		__raw_writel(reg, S5P_CLK_DIV6);
 
 		do {
@@ -603,23 +889,24 @@ static int s5pv210_target(struct cpufreq_policy *policy,
 		} while (reg & (1 << 15));
 
 		/* Reconfigure DRAM refresh counter value */
+		s5pv210_set_refresh(DMC0, bus_levels[bus_cur].freq);
 		if (index != L2) {
-			/*
-			 * DMC0 : 166Mhz
-			 * DMC1 : 200Mhz
-			 */
-			s5pv210_set_refresh(DMC0, 166000);
+			/* DMC1 : 200Mhz */
 			s5pv210_set_refresh(DMC1, 200000);
 		} else {
-			/*
-			 * DMC0 : 83Mhz
-			 * DMC1 : 100Mhz
-			 */
-			s5pv210_set_refresh(DMC0, 83000);
+			/* DMC1 : 100Mhz */
 			s5pv210_set_refresh(DMC1, 100000);
 		}
 	}
 
+	if (bus_speed_changing)
+		kind = TRANS_APLL_BUS;
+	else if (pll_changing)
+		kind = TRANS_APLL;
+	else
+		kind = TRANS_DIV;
+	s5pv210_account_transition(policy, kind, sched_clock() - start);
+
 	cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
 
 	if (freqs.new < freqs.old) {
@@ -635,6 +922,8 @@ static int s5pv210_target(struct cpufreq_policy *policy,
 
 	pr_debug("Perf changed[L%d]\n", index);
 out:
+	if (!ret)
+		s5pv210_bus_update();
 	mutex_unlock(&set_freq_lock);
 	return ret;
 }
@@ -664,7 +953,8 @@ static int check_mem_type(void __iomem *dmc_reg)
 static int __init s5pv210_cpu_init(struct cpufreq_policy *policy)
 {
 	unsigned long mem_type;
-	int ret;
+	unsigned long reg;
+	int i, ret;
 
 	cpu_clk = clk_get(NULL, "armclk");
 	if (IS_ERR(cpu_clk))
@@ -704,14 +994,20 @@ static int __init s5pv210_cpu_init(struct cpufreq_policy *policy)
 	s5pv210_dram_conf[1].refresh = (__raw_readl(S5P_VA_DMC1 + 0x30) * 1000);
 	s5pv210_dram_conf[1].freq = clk_get_rate(dmc1_clk);
 
+	/* Start the bus governor from the divider the bootloader left */
+	reg = (__raw_readl(S5P_CLK_DIV6) & S5P_CLKDIV6_ONEDRAM_MASK) >>
+		S5P_CLKDIV6_ONEDRAM_SHIFT;
+	for (i = 0; i < ARRAY_SIZE(bus_levels); i++)
+		if (bus_levels[i].div == reg)
+			bus_cur = i;
+
 	policy->cur = policy->min = policy->max = s5pv210_getspeed(0);
 
 	cpufreq_frequency_table_get_attr(s5pv210_freq_table, policy->cpu);
 
-	policy->cpuinfo.transition_latency = 40000;
+	policy->cpuinfo.transition_latency = S5PV210_TRANSITION_LATENCY;
 
 #ifdef CONFIG_DVFS_LIMIT
-	int i;
 	for (i = 0; i < DVFS_LOCK_TOKEN_NUM; i++)
 		g_dvfslockval[i] = MAX_PERF_LEVEL;
 #endif
@@ -766,8 +1062,383 @@ static int s5pv210_cpufreq_reboot_notifier_event(struct notifier_block *this,
 	return NOTIFY_DONE;
 }
 
+static ssize_t show_transition_cost(struct cpufreq_policy *policy, char *buf)
+{
+	struct s5pv210_transition_cost cost;
+	unsigned long long avg_ns;
+	int i, len = 0;
+
+	mutex_lock(&set_freq_lock);
+	for (i = 0; i < TRANS_KINDS; i++) {
+		cost = transition_costs[i];
+		avg_ns = cost.total_ns;
+		if (cost.count)
+			do_div(avg_ns, cost.count);
+		len += sprintf(buf + len, "%s: %lu avg %llu max %llu ns\n",
+			       s5pv210_transition_names[i], cost.count,
+			       avg_ns, cost.max_ns);
+	}
+	mutex_unlock(&set_freq_lock);
+
+	return len;
+}
+cpufreq_freq_attr_ro(transition_cost);
+
+static ssize_t show_bus_freq(struct cpufreq_policy *policy, char *buf)
+{
+	int i, len;
+
+	len = sprintf(buf, "%lu", bus_levels[bus_cur].freq);
+	for (i = 0; i < BUS_HINT_NUM; i++)
+		len += sprintf(buf + len, " %s:%d", bus_hint_names[i],
+			       atomic_read(&bus_hints[i]));
+	len += sprintf(buf + len, "\n");
+
+	return len;
+}
+cpufreq_freq_attr_ro(bus_freq);
+
+static ssize_t show_bus_policy(struct cpufreq_policy *policy, char *buf)
+{
+	int i, len = 0;
+
+	len += sprintf(buf + len, bus_fixed < 0 ? "[auto]" : "auto");
+	for (i = 0; i < ARRAY_SIZE(bus_levels); i++)
+		len += sprintf(buf + len, i == bus_fixed ? " [%lu]" : " %lu",
+			       bus_levels[i].freq);
+	len += sprintf(buf + len, "\n");
+
+	return len;
+}
+
+static ssize_t store_bus_policy(struct cpufreq_policy *policy,
+				const char *buf, size_t count)
+{
+	unsigned long freq;
+	int i, level = -1;
+
+	if (!sysfs_streq(buf, "auto")) {
+		if (strict_strtoul(buf, 0, &freq))
+			return -EINVAL;
+		for (i = 0; i < ARRAY_SIZE(bus_levels); i++)
+			if (bus_levels[i].freq == freq)
+				level = i;
+		if (level < 0)
+			return -EINVAL;
+	}
+
+	mutex_lock(&set_freq_lock);
+	bus_fixed = level;
+	s5pv210_bus_update();
+	mutex_unlock(&set_freq_lock);
+
+	return count;
+}
+cpufreq_freq_attr_rw(bus_policy);
+
+static ssize_t show_bus_up_freq(struct cpufreq_policy *policy, char *buf)
+{
+	return sprintf(buf, "%u\n", bus_up_khz);
+}
+
+static ssize_t store_bus_up_freq(struct cpufreq_policy *policy,
+				 const char *buf, size_t count)
+{
+	unsigned long freq;
+
+	if (strict_strtoul(buf, 0, &freq))
+		return -EINVAL;
+
+	mutex_lock(&set_freq_lock);
+	bus_up_khz = freq;
+	s5pv210_bus_update();
+	mutex_unlock(&set_freq_lock);
+
+	return count;
+}
+cpufreq_freq_attr_rw(bus_up_freq);
+
+static ssize_t show_thermal_cap(struct cpufreq_policy *policy, char *buf)
+{
+	return sprintf(buf, "%u %d %d\n",
+		       s5pv210_freq_table[thermal_cap_level].frequency,
+		       thermal_avg, thermal_forecast);
+}
+cpufreq_freq_attr_ro(thermal_cap);
+
+static ssize_t show_thermal_trip(struct cpufreq_policy *policy, char *buf)
+{
+	return sprintf(buf, "%d\n", thermal_trip_temp);
+}
+
+static ssize_t store_thermal_trip(struct cpufreq_policy *policy,
+				  const char *buf, size_t count)
+{
+	unsigned long trip;
+
+	if (strict_strtoul(buf, 0, &trip) || trip > 1000)
+		return -EINVAL;
+
+	/* the next poll moves the cap, a step at a time */
+	thermal_trip_temp = trip;
+
+	return count;
+}
+cpufreq_freq_attr_rw(thermal_trip);
+
+static ssize_t show_thermal_floor(struct cpufreq_policy *policy, char *buf)
+{
+	return sprintf(buf, "%u\n",
+		       s5pv210_freq_table[thermal_floor_level].frequency);
+}
+
+static ssize_t store_thermal_floor(struct cpufreq_policy *policy,
+				   const char *buf, size_t count)
+{
+	unsigned long freq;
+	int level;
+
+	if (strict_strtoul(buf, 0, &freq))
+		return -EINVAL;
+	level = s5pv210_find_index(freq);
+	if (level < 0)
+		return -EINVAL;
+
+	thermal_floor_level = level;
+
+	return count;
+}
+cpufreq_freq_attr_rw(thermal_floor);
+
+/*
+ * ARM voltage calibration. For each level, the voltage is stepped down
+ * from the table value while a checksum stress loop runs, until the
+ * checksum differs from the one computed at the table voltage or
+ * UV_CAL_MAX_DROP is reached. The level then gets the lowest stable
+ * voltage plus a margin. Every step is logged first, so a level that
+ * hangs the device can be read back from last_kmsg.
+ *
+ * Results only live in dvs_conf: they are kept across boots by saving
+ * UV_mV_table and writing it back, or by passing it as s5pv210_uv=.
+ */
+#define UV_CAL_STEP		25000	/* uV, BUCK1 step */
+#define UV_CAL_MAX_DROP		250000	/* uV, below the table voltage */
+#define UV_CAL_MIN_VOLT		750000	/* uV, BUCK1 minimum */
+#define UV_CAL_TEST_MS		2000	/* stress time per step */
+#define UV_CAL_BUF_WORDS	(SZ_1M / sizeof(u32))
+
+static bool uv_cal_running;
+static bool uv_cal_abort;
+static struct wake_lock uv_cal_wake_lock;
+static int uv_cal_target = -1;		/* level, or -1 for all of them */
+static int uv_cal_level = -1;		/* level under test */
+static unsigned long uv_cal_volt;	/* voltage under test */
+static unsigned long uv_cal_margin = 50000;
+static unsigned long uv_cal_stable[MAX_PERF_LEVEL + 1];
+
+/* Fill buf from a fixed seed, then fold it: equal results at any voltage */
+static u32 s5pv210_uv_stress_once(u32 *buf)
+{
+	u32 x = 0x2545f491, sum = 0;
+	int i;
+
+	for (i = 0; i < UV_CAL_BUF_WORDS; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		buf[i] = x;
+	}
+	memmove(buf + 1, buf, (UV_CAL_BUF_WORDS - 1) * sizeof(u32));
+	for (i = 0; i < UV_CAL_BUF_WORDS; i++)
+		sum = ((sum << 5) | (sum >> 27)) ^ (buf[i] * 0x9e3779b1);
+
+	return sum;
+}
+
+static bool s5pv210_uv_stress(u32 *buf, u32 ref)
+{
+	unsigned long end = jiffies + msecs_to_jiffies(UV_CAL_TEST_MS);
+
+	while (time_before(jiffies, end) && !uv_cal_abort) {
+		if (s5pv210_uv_stress_once(buf) != ref)
+			return false;
+		cond_resched();
+	}
+	return true;
+}
+
+static void s5pv210_uv_set_volt(unsigned long volt)
+{
+	mutex_lock(&set_freq_lock);
+	uv_cal_volt = volt;
+	regulator_set_voltage(arm_regulator, volt, arm_volt_max);
+	mutex_unlock(&set_freq_lock);
+}
+
+/* Called with further transitions disabled, running at the level */
+static void s5pv210_uv_calibrate_level(int level, u32 *buf)
+{
+	unsigned long table_volt = dvs_conf[level].arm_volt;
+	unsigned long volt = table_volt, stable = table_volt;
+	u32 ref;
+
+	uv_cal_level = level;
+	ref = s5pv210_uv_stress_once(buf);
+
+	while (volt >= UV_CAL_MIN_VOLT + UV_CAL_STEP &&
+	       volt - UV_CAL_STEP >= table_volt - UV_CAL_MAX_DROP &&
+	       !uv_cal_abort) {
+		volt -= UV_CAL_STEP;
+		pr_info("uv_calibrate: %umhz at %lumV\n",
+			s5pv210_freq_table[level].frequency / 1000,
+			volt / 1000);
+		s5pv210_uv_set_volt(volt);
+		if (!s5pv210_uv_stress(buf, ref))
+			break;
+		stable = volt;
+	}
+
+	mutex_lock(&set_freq_lock);
+	uv_cal_stable[level] = stable;
+	dvs_conf[level].arm_volt = min(stable + uv_cal_margin, table_volt);
+	mutex_unlock(&set_freq_lock);
+	s5pv210_uv_set_volt(dvs_conf[level].arm_volt);
+
+	pr_info("uv_calibrate: %umhz stable at %lumV, using %lumV\n",
+		s5pv210_freq_table[level].frequency / 1000, stable / 1000,
+		dvs_conf[level].arm_volt / 1000);
+}
+
+static int s5pv210_uv_calibrate_fn(void *data)
+{
+	struct cpufreq_policy *policy = data;
+	unsigned int freq;
+	u32 *buf;
+	int i;
+
+	buf = vmalloc(UV_CAL_BUF_WORDS * sizeof(u32));
+	if (!buf)
+		goto out;
+
+	for (i = 0; i <= MAX_PERF_LEVEL && !uv_cal_abort; i++) {
+		if (uv_cal_target >= 0 && i != uv_cal_target)
+			continue;
+
+		/* Stay at the level until the test is over */
+		freq = s5pv210_freq_table[i].frequency;
+		if (cpufreq_driver_target(policy, freq, CPUFREQ_RELATION_H |
+					  DISABLE_FURTHER_CPUFREQ))
+			continue;
+		if (policy->cur == freq)
+			s5pv210_uv_calibrate_level(i, buf);
+		else
+			pr_info("uv_calibrate: %umhz is outside the policy\n",
+				freq / 1000);
+		cpufreq_driver_target(policy, policy->cur,
+				      ENABLE_FURTHER_CPUFREQ);
+	}
+	vfree(buf);
+out:
+	uv_cal_level = -1;
+	cpufreq_cpu_put(policy);
+	wake_unlock(&uv_cal_wake_lock);
+	uv_cal_running = false;
+
+	return 0;
+}
+
+static ssize_t show_uv_calibrate(struct cpufreq_policy *policy, char *buf)
+{
+	int i, len = 0;
+
+	if (uv_cal_level >= 0)
+		len += sprintf(buf + len, "running: %umhz at %lumV\n",
+			       s5pv210_freq_table[uv_cal_level].frequency / 1000,
+			       uv_cal_volt / 1000);
+	else
+		len += sprintf(buf + len, "idle\n");
+
+	for (i = 0; i <= MAX_PERF_LEVEL; i++) {
+		if (!uv_cal_stable[i])
+			continue;
+		len += sprintf(buf + len, "%umhz: stable %lumV, using %lumV\n",
+			       s5pv210_freq_table[i].frequency / 1000,
+			       uv_cal_stable[i] / 1000,
+			       dvs_conf[i].arm_volt / 1000);
+	}
+
+	return len;
+}
+
+/*
+ * "all" or a frequency in MHz, optionally followed by the margin in mV,
+ * or "stop". The run is not waited for: it needs the policy lock held
+ * by this store to change frequency.
+ */
+static ssize_t store_uv_calibrate(struct cpufreq_policy *policy,
+				  const char *buf, size_t count)
+{
+	char what[8];
+	unsigned int mhz, margin;
+	int n, i, target = -1;
+	struct cpufreq_policy *cal_policy;
+	struct task_struct *task;
+
+	n = sscanf(buf, "%7s %u", what, &margin);
+	if (n < 1)
+		return -EINVAL;
+
+	if (!strcmp(what, "stop")) {
+		uv_cal_abort = true;
+		return count;
+	}
+	if (uv_cal_running)
+		return -EBUSY;
+
+	if (strcmp(what, "all")) {
+		if (sscanf(what, "%u", &mhz) != 1)
+			return -EINVAL;
+		for (i = 0; i <= MAX_PERF_LEVEL; i++)
+			if (s5pv210_freq_table[i].frequency == mhz * 1000)
+				target = i;
+		if (target < 0)
+			return -EINVAL;
+	}
+	if (n == 2)
+		uv_cal_margin = margin * 1000;
+
+	if (IS_ERR_OR_NULL(arm_regulator))
+		return -ENODEV;
+	cal_policy = cpufreq_cpu_get(0);
+	if (!cal_policy)
+		return -ENODEV;
+
+	uv_cal_target = target;
+	uv_cal_abort = false;
+	uv_cal_running = true;
+	wake_lock(&uv_cal_wake_lock);
+	task = kthread_run(s5pv210_uv_calibrate_fn, cal_policy, "uv_calibrate");
+	if (IS_ERR(task)) {
+		uv_cal_running = false;
+		wake_unlock(&uv_cal_wake_lock);
+		cpufreq_cpu_put(cal_policy);
+		return PTR_ERR(task);
+	}
+
+	return count;
+}
+cpufreq_freq_attr_rw(uv_calibrate);
+
 static struct freq_attr *s5pv210_cpufreq_attr[] = {
 	&cpufreq_freq_attr_scaling_available_freqs,
+	&transition_cost,
+	&bus_freq,
+	&bus_policy,
+	&bus_up_freq,
+	&thermal_cap,
+	&thermal_trip,
+	&thermal_floor,
+	&uv_calibrate,
 	NULL,
 };
 
@@ -793,6 +1464,16 @@ static struct notifier_block s5pv210_cpufreq_reboot_notifier = {
 	.notifier_call	= s5pv210_cpufreq_reboot_notifier_event,
 };
 
+/* s5pv210_uv=<mV>,<mV>,...: ARM voltages per level, as in UV_mV_table */
+static int uv_boot_table[MAX_PERF_LEVEL + 2];
+
+static int __init s5pv210_uv_setup(char *str)
+{
+	get_options(str, ARRAY_SIZE(uv_boot_table), uv_boot_table);
+	return 1;
+}
+__setup("s5pv210_uv=", s5pv210_uv_setup);
+
 static int __init s5pv210_cpufreq_probe(struct platform_device *pdev)
 {
 	struct s5pv210_cpufreq_data *pdata = dev_get_platdata(&pdev->dev);
@@ -812,6 +1493,14 @@ static int __init s5pv210_cpufreq_probe(struct platform_device *pdev)
 		}
 	}
 
+	/* uv_boot_table[0] holds the number of values given */
+	for (i = 0; i < uv_boot_table[0]; i++)
+		if (uv_boot_table[i + 1] * 1000 <= arm_volt_max &&
+		    uv_boot_table[i + 1] * 1000 >= UV_CAL_MIN_VOLT)
+			dvs_conf[i].arm_volt = uv_boot_table[i + 1] * 1000;
+
+	wake_lock_init(&uv_cal_wake_lock, WAKE_LOCK_SUSPEND, "uv_calibrate");
+
 	arm_regulator = regulator_get(NULL, "vddarm");
 	if (IS_ERR(arm_regulator)) {
 		pr_err("failed to get regulater resource vddarm\n");
@@ -829,6 +1518,8 @@ error:
 finish:
 	register_pm_notifier(&s5pv210_cpufreq_notifier);
 	register_reboot_notifier(&s5pv210_cpufreq_reboot_notifier);
+	input_boost_register_notifier(&s5pv210_bus_input_nb);
+	cpufreq_register_notifier(&s5pv210_thermal_nb, CPUFREQ_POLICY_NOTIFIER);
 
 	return cpufreq_register_driver(&s5pv210_driver);
 }
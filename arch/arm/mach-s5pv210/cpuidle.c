@@ -14,20 +14,51 @@
 #include <linux/init.h>
 #include <linux/platform_device.h>
 #include <linux/cpuidle.h>
+#include <linux/dma-mapping.h>
 #include <linux/io.h>
+#include <linux/moduleparam.h>
 #include <asm/proc-fns.h>
 #include <asm/cacheflush.h>
+#include <asm/hardware/vic.h>
 
 #include <mach/map.h>
 #include <mach/regs-irq.h>
 #include <mach/regs-clock.h>
+#include <mach/power-domain.h>
+#include <mach/cpuidle.h>
 #include <plat/pm.h>
 #include <plat/devs.h>
 
 #include <mach/dma.h>
 #include <mach/regs-gpio.h>
 
-#define S5PC110_MAX_STATES	1
+#define S5PC110_MAX_STATES	2
+
+/* Deep idle may be turned off at runtime, e.g. to rule it out of a bug */
+static bool enable_didle = true;
+module_param(enable_didle, bool, 0644);
+
+/* Register save area for s5pv210_didle_save, read back with the MMU off */
+static unsigned long *regs_save;
+static dma_addr_t phy_regs_save;
+
+#define S3C_HSMMC_PRNSTS	(0x24)
+#define S3C_HSMMC_CLKCON	(0x2c)
+#define S3C_HSMMC_CMD_INHIBIT	0x00000001
+#define S3C_HSMMC_DATA_INHIBIT	0x00000002
+#define S3C_HSMMC_CLOCK_CARD_EN	0x0004
+
+#define S5P_HSMMC_NUM		4
+
+static void __iomem *hsmmc_base[S5P_HSMMC_NUM];
+
+/* Power domains whose blocks would lose their bus and clocks in deep idle */
+#define DIDLE_PD_BUSY	(S5PV210_PD_MFC | S5PV210_PD_G3D | \
+			 S5PV210_PD_CAM | S5PV210_PD_TV)
+
+/* Wakeup sources: EINT, RTC alarm and tick, keypad and I2S */
+#define DIDLE_WAKEUP_SRC	((1 << 0) | (1 << 1) | (1 << 2) | \
+				 (1 << 5) | (1 << 13))
 
 static void s5p_enter_idle(void)
 {
@@ -45,6 +76,165 @@ static void s5p_enter_idle(void)
 	cpu_do_idle();
 }
 
+/* Whether a SD/MMC controller has a command or transfer in flight */
+static int check_sdmmc_op(void)
+{
+	unsigned int ch;
+
+	for (ch = 0; ch < S5P_HSMMC_NUM; ch++) {
+		/* Registers of a gated controller must not be accessed */
+		if (!hsmmc_base[ch] || !(__raw_readl(S5P_CLKGATE_IP2) &
+					 (S5P_CLKGATE_IP2_HSMMC0 << ch)))
+			continue;
+
+		if ((__raw_readl(hsmmc_base[ch] + S3C_HSMMC_PRNSTS) &
+		     (S3C_HSMMC_CMD_INHIBIT | S3C_HSMMC_DATA_INHIBIT)) ||
+		    (__raw_readl(hsmmc_base[ch] + S3C_HSMMC_CLKCON) &
+		     S3C_HSMMC_CLOCK_CARD_EN))
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Deep idle is only safe with the multimedia power domains off, no DMA
+ * channel in use (the PL330 clocks run as long as a channel is held),
+ * no USB activity and no SD/MMC transfer in flight. LCD and audio may
+ * stay on: TOP-ON keeps the display and the I2S internal DMA running.
+ */
+static int s5p_didle_busy(void)
+{
+	if (!enable_didle || !regs_save)
+		return 1;
+
+	if (__raw_readl(S5P_NORMAL_CFG) & DIDLE_PD_BUSY)
+		return 1;
+
+	if (__raw_readl(S5P_CLKGATE_IP0) & (S5P_CLKGATE_IP0_MDMA |
+		S5P_CLKGATE_IP0_PDMA0 | S5P_CLKGATE_IP0_PDMA1))
+		return 1;
+
+	if (__raw_readl(S5P_CLKGATE_IP1) & (S5P_CLKGATE_IP1_USBOTG |
+					    S5P_CLKGATE_IP1_USBHOST))
+		return 1;
+
+	return check_sdmmc_op();
+}
+
+/* Keep the pads in their current state while the core is powered down */
+static void s5p_gpio_pdn_conf(void)
+{
+	void __iomem *gpio_base = S5PV210_GPA0_BASE;
+	unsigned int val;
+
+	do {
+		/* Keep the previous state in didle mode */
+		__raw_writel(0xffff, gpio_base + 0x10);
+
+		/* Pull up-down state in didle is same as normal */
+		val = __raw_readl(gpio_base + 0x08);
+		__raw_writel(val, gpio_base + 0x14);
+
+		gpio_base += 0x20;
+	} while (gpio_base <= S5PV210_MP28_BASE);
+}
+
+/*
+ * Power the ARM core down with the TOP block on. The core resumes from
+ * reset through s5pv210_didle_resume, found by the bootloader in INFORM0,
+ * and returns from s5pv210_didle_save with 1. Interrupts are masked in
+ * the VIC during the entry so a pending one cannot complete the WFI
+ * early: didle.S does not expect to return from it.
+ */
+static void s5p_enter_didle(void)
+{
+	unsigned long tmp;
+	unsigned long save_wakeup_mask;
+	unsigned long vic_regs[4];
+
+	/* store the physical address of the register recovery block */
+	__raw_writel(phy_regs_save, S5P_INFORM2);
+
+	/* ensure INFORM0 has the resume address */
+	__raw_writel(virt_to_phys(s5pv210_didle_resume), S5P_INFORM0);
+
+	vic_regs[0] = __raw_readl(VA_VIC0 + VIC_INT_ENABLE);
+	vic_regs[1] = __raw_readl(VA_VIC1 + VIC_INT_ENABLE);
+	vic_regs[2] = __raw_readl(VA_VIC2 + VIC_INT_ENABLE);
+	vic_regs[3] = __raw_readl(VA_VIC3 + VIC_INT_ENABLE);
+
+	__raw_writel(0xffffffff, VA_VIC0 + VIC_INT_ENABLE_CLEAR);
+	__raw_writel(0xffffffff, VA_VIC1 + VIC_INT_ENABLE_CLEAR);
+	__raw_writel(0xffffffff, VA_VIC2 + VIC_INT_ENABLE_CLEAR);
+	__raw_writel(0xffffffff, VA_VIC3 + VIC_INT_ENABLE_CLEAR);
+
+	s5p_gpio_pdn_conf();
+
+	save_wakeup_mask = __raw_readl(S5P_WAKEUP_MASK);
+	tmp = save_wakeup_mask | 0xffff;
+	tmp &= ~DIDLE_WAKEUP_SRC;
+	__raw_writel(tmp, S5P_WAKEUP_MASK);
+
+	/* Clear wakeup status register */
+	__raw_writel(__raw_readl(S5P_WAKEUP_STAT), S5P_WAKEUP_STAT);
+
+	/* TOP logic and memory on, L2 retained, ARM off */
+	tmp = __raw_readl(S5P_IDLE_CFG);
+	tmp &= ~(S5P_IDLE_CFG_TL_MASK | S5P_IDLE_CFG_TM_MASK |
+		 S5P_IDLE_CFG_L2_MASK | S5P_IDLE_CFG_DIDLE);
+	tmp |= S5P_IDLE_CFG_TL_ON | S5P_IDLE_CFG_TM_ON |
+		S5P_IDLE_CFG_L2_RET | S5P_IDLE_CFG_DIDLE;
+	__raw_writel(tmp, S5P_IDLE_CFG);
+
+	tmp = __raw_readl(S5P_PWR_CFG);
+	tmp &= S5P_CFG_WFI_CLEAN;
+	tmp |= S5P_CFG_WFI_IDLE;
+	__raw_writel(tmp, S5P_PWR_CFG);
+
+	/* An interrupt raised meanwhile would be lost: skip the power down */
+	if ((__raw_readl(VA_VIC0 + VIC_RAW_STATUS) & vic_regs[0]) ||
+	    (__raw_readl(VA_VIC1 + VIC_RAW_STATUS) & vic_regs[1]) ||
+	    (__raw_readl(VA_VIC2 + VIC_RAW_STATUS) & vic_regs[2]) ||
+	    (__raw_readl(VA_VIC3 + VIC_RAW_STATUS) & vic_regs[3]))
+		goto skipped_didle;
+
+	/* SYSCON interrupt handling disable */
+	tmp = __raw_readl(S5P_OTHERS);
+	tmp |= S5P_OTHER_SYSC_INTOFF;
+	__raw_writel(tmp, S5P_OTHERS);
+
+	vfp_pm_save_context();
+	s5pv210_didle_save(regs_save);
+	vfp_pm_restore_context();
+
+	/* Release retention of GPIO/MMC/UART IO */
+	tmp = __raw_readl(S5P_OTHERS);
+	tmp |= (S5P_OTHERS_RET_IO | S5P_OTHERS_RET_CF |
+		S5P_OTHERS_RET_MMC | S5P_OTHERS_RET_UART);
+	__raw_writel(tmp, S5P_OTHERS);
+
+skipped_didle:
+	__raw_writel(save_wakeup_mask, S5P_WAKEUP_MASK);
+	__raw_writel(__raw_readl(S5P_WAKEUP_STAT), S5P_WAKEUP_STAT);
+
+	/* Back to plain WFI for the normal idle state */
+	tmp = __raw_readl(S5P_IDLE_CFG);
+	tmp &= ~(S5P_IDLE_CFG_TL_MASK | S5P_IDLE_CFG_TM_MASK |
+		 S5P_IDLE_CFG_L2_MASK | S5P_IDLE_CFG_DIDLE);
+	tmp |= S5P_IDLE_CFG_TL_ON | S5P_IDLE_CFG_TM_ON;
+	__raw_writel(tmp, S5P_IDLE_CFG);
+
+	tmp = __raw_readl(S5P_PWR_CFG);
+	tmp &= S5P_CFG_WFI_CLEAN;
+	__raw_writel(tmp, S5P_PWR_CFG);
+
+	__raw_writel(vic_regs[0], VA_VIC0 + VIC_INT_ENABLE);
+	__raw_writel(vic_regs[1], VA_VIC1 + VIC_INT_ENABLE);
+	__raw_writel(vic_regs[2], VA_VIC2 + VIC_INT_ENABLE);
+	__raw_writel(vic_regs[3], VA_VIC3 + VIC_INT_ENABLE);
+}
+
 /* Actual code that puts the SoC in different idle states */
 static int s5p_enter_idle_normal(struct cpuidle_device *dev,
 				struct cpuidle_state *state)
@@ -64,6 +254,39 @@ static int s5p_enter_idle_normal(struct cpuidle_device *dev,
 	return idle_time;
 }
 
+static int s5p_enter_idle_deep(struct cpuidle_device *dev,
+			       struct cpuidle_state *state)
+{
+	struct timeval before, after;
+	int idle_time;
+
+	local_irq_disable();
+	do_gettimeofday(&before);
+
+	/* Something may have started since s5p_idle_prepare() */
+	if (s5p_didle_busy())
+		s5p_enter_idle();
+	else
+		s5p_enter_didle();
+
+	do_gettimeofday(&after);
+	local_irq_enable();
+	idle_time = (after.tv_sec - before.tv_sec) * USEC_PER_SEC +
+			(after.tv_usec - before.tv_usec);
+	return idle_time;
+}
+
+/* Hide the deep idle state from the governor while it is not safe */
+static int s5p_idle_prepare(struct cpuidle_device *device)
+{
+	if (s5p_didle_busy())
+		device->states[1].flags |= CPUIDLE_FLAG_IGNORE;
+	else
+		device->states[1].flags &= ~CPUIDLE_FLAG_IGNORE;
+
+	return 0;
+}
+
 static DEFINE_PER_CPU(struct cpuidle_device, s5p_cpuidle_device);
 
 static struct cpuidle_driver s5p_idle_driver = {
@@ -75,11 +298,12 @@ static struct cpuidle_driver s5p_idle_driver = {
 static int s5p_init_cpuidle(void)
 {
 	struct cpuidle_device *device;
+	int i;
 
 	cpuidle_register_driver(&s5p_idle_driver);
 
 	device = &per_cpu(s5p_cpuidle_device, smp_processor_id());
-	device->state_count = 1;
+	device->state_count = S5PC110_MAX_STATES;
 
 	/* Wait for interrupt state */
 	device->states[0].enter = s5p_enter_idle_normal;
@@ -89,6 +313,24 @@ static int s5p_init_cpuidle(void)
 	strcpy(device->states[0].name, "IDLE");
 	strcpy(device->states[0].desc, "ARM clock gating - WFI");
 
+	/* Deep idle, TOP-ON */
+	device->states[1].enter = s5p_enter_idle_deep;
+	device->states[1].exit_latency = 300;	/* uS */
+	device->states[1].target_residency = 5000;
+	device->states[1].flags = CPUIDLE_FLAG_TIME_VALID;
+	strcpy(device->states[1].name, "DEEP IDLE");
+	strcpy(device->states[1].desc, "ARM power gating - TOP on");
+
+	device->safe_state = &device->states[0];
+	device->prepare = s5p_idle_prepare;
+
+	regs_save = dma_alloc_coherent(NULL, 4096, &phy_regs_save, GFP_KERNEL);
+	if (!regs_save)
+		printk(KERN_WARNING "s5p_init_cpuidle: no deep idle save area\n");
+
+	for (i = 0; i < S5P_HSMMC_NUM; i++)
+		hsmmc_base[i] = ioremap(S5PV210_PA_HSMMC(i), SZ_4K);
+
 	if (cpuidle_register_device(device)) {
 		printk(KERN_ERR "s5p_init_cpuidle: Failed registering\n");
 		return -EIO;
@@ -12,15 +12,19 @@
 #ifndef __ASM_PLAT_ADC_H
 #define __ASM_PLAT_ADC_H __FILE__
 
+#include <linux/list.h>
+
 struct s3c_adc_request {
 	/* for linked list */
-	struct list_head *list;
+	struct list_head list;
 	/* after finish ADC sampling, s3c_adc_request function call this function with three parameter */
 	void (*callback)(int channel, unsigned long int param, unsigned short sample);
 	/* for private data */
 	unsigned long int param;
 	/* selected channel for ADC sampling */
 	int channel;
+	/* conversions averaged into the sample, 0 for one */
+	int samples;
 };
 
 struct s3c_adc_mach_info {
@@ -31,6 +35,9 @@ struct s3c_adc_mach_info {
 };
 
 extern int s3c_adc_get_adc_data(int channel);
+extern int s3c_adc_get_adc_samples(int channel, int *samples, int count);
+/* Queue req, its callback runs from a work item; -EBUSY if already queued */
+extern int s3c_adc_get(struct s3c_adc_request *req);
 void __init s3c_adc_set_platdata(struct s3c_adc_mach_info *pd);
 
 #endif /* __ASM_PLAT_ADC_H */
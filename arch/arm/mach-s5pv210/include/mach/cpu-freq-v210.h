@@ -51,4 +51,26 @@ extern void s5pv210_unlock_dvfs_high_level(unsigned int nToken);
 
 extern void s5pv210_cpufreq_set_platdata(struct s5pv210_cpufreq_data *pdata);
 
+/* Activity hints raising the memory bus level, independently of ARM */
+enum s5pv210_bus_hint {
+	BUS_HINT_MFC,
+	BUS_HINT_FIMC,
+	BUS_HINT_G3D,
+	BUS_HINT_INPUT,
+	BUS_HINT_NUM
+};
+
+#ifdef CONFIG_CPU_FREQ
+extern void s5pv210_bus_hint(enum s5pv210_bus_hint hint, bool active);
+/* Battery temperature in 0.1 degC, feeding the thermal cap */
+extern void s5pv210_thermal_update(int temp);
+#else
+static inline void s5pv210_bus_hint(enum s5pv210_bus_hint hint, bool active)
+{
+}
+static inline void s5pv210_thermal_update(int temp)
+{
+}
+#endif
+
 #endif /* __ASM_ARCH_CPU_FREQ_H */
@@ -109,6 +109,9 @@
 #define S5PV210_PA_JPEG		(0xFB600000)
 #define S5PV210_SZ_JPEG		SZ_1M
 
+#define S5PV210_PA_SSS		(0xEA000000)
+#define S5PV210_SZ_SSS		SZ_64K
+
 #define S5PV210_SZ_FIMC0	SZ_1M
 #define S5P_SZ_FIMC0		S5PV210_SZ_FIMC0
 #define S5PV210_SZ_FIMC1	SZ_1M
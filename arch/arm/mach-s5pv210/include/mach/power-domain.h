@@ -33,6 +33,9 @@ struct regulator_init_data;
  *				should be running when the power domain
  *				is turned on
  * @ctrlbit:			register control bit
+ * @off_delay:			msecs the domain stays powered after its
+ *				last user disabled it, 0 to power it off
+ *				right away
  *
  * This structure contains samsung power domain regulator configuration
  * information that must be passed by platform code to the samsung
@@ -45,6 +48,7 @@ struct s5pv210_pd_config {
 	struct regulator_init_data *init_data;
 	struct clk_should_be_running *clk_run;
 	int ctrlbit;
+	unsigned int off_delay;
 };
 
 extern struct platform_device s5pv210_pd_audio;
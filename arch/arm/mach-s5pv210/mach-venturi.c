@@ -363,6 +363,7 @@ static struct s5p_media_device aries_media_devs[] = {
 		.bank = 0,
 		.memsize = S5PV210_VIDEO_SAMSUNG_MEMSIZE_MFC0,
 		.paddr = 0,
+		.movable = true,
 	},
 	[1] = {
 		.id = S5P_MDEV_MFC,
@@ -370,6 +371,7 @@ static struct s5p_media_device aries_media_devs[] = {
 		.bank = 1,
 		.memsize = S5PV210_VIDEO_SAMSUNG_MEMSIZE_MFC1,
 		.paddr = 0,
+		.movable = true,
 	},
 	[2] = {
 		.id = S5P_MDEV_FIMC0,
@@ -377,6 +379,7 @@ static struct s5p_media_device aries_media_devs[] = {
 		.bank = 1,
 		.memsize = S5PV210_VIDEO_SAMSUNG_MEMSIZE_FIMC0,
 		.paddr = 0,
+		.movable = true,
 	},
 /*	[3] = {
 		.id = S5P_MDEV_FIMC1,
@@ -391,6 +394,7 @@ static struct s5p_media_device aries_media_devs[] = {
 		.bank = 1,
 		.memsize = S5PV210_VIDEO_SAMSUNG_MEMSIZE_FIMC2,
 		.paddr = 0,
+		.movable = true,
 	},
 	[5] = {
 		.id = S5P_MDEV_JPEG,
@@ -4557,6 +4561,9 @@ static struct platform_device *aries_devices[] __initdata = {
         &s5p_device_tvout,
         //&s5p_device_hpd,
         //&s5p_device_cec,
+#endif
+#if defined(CONFIG_CRYPTO_DEV_S5P) || defined(CONFIG_CRYPTO_DEV_S5P_MODULE)
+	&s5p_device_sss,
 #endif
 	&sec_device_battery,
 #if defined(CONFIG_KEYPAD_CYPRESS_TOUCH)
@@ -14,6 +14,10 @@
 #include <linux/io.h>
 #include <linux/mutex.h>
 #include <linux/kernel.h>
+#include <linux/debugfs.h>
+#include <linux/hrtimer.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/driver.h>
 #include <linux/regulator/machine.h>
@@ -32,13 +36,41 @@ struct s5pv210_pd_data {
 	unsigned startup_delay;
 	struct clk_should_be_running *clk_run;
 	int ctrlbit;
+
+	/*
+	 * The regulator core sees the requested state in enabled. With an
+	 * off_delay, the domain stays powered that long after its last user
+	 * dropped it, so that short idle gaps do not pay a power cycle.
+	 */
+	struct mutex lock;
+	bool enabled;
+	bool powered;
+	u32 off_delay;			/* msecs */
+	struct delayed_work off_work;
+
+	/* protected by lock */
+	ktime_t on_since;
+	u64 on_time_us;
+	unsigned long on_count;
+	unsigned long off_count;
+	unsigned long off_skipped;	/* re-enabled before off_delay expired */
+	unsigned int lat_last_us;	/* power-on latency */
+	unsigned int lat_max_us;
+	u64 lat_total_us;
+
+	struct dentry *debugfs;
+	struct list_head node;
 };
 
 struct clk_should_be_running {
 	const char *clk_name;
 	struct device *dev;
 };
-static spinlock_t pd_lock;
+static DEFINE_SPINLOCK(pd_lock);
+
+static LIST_HEAD(s5pv210_pd_list);
+static DEFINE_MUTEX(s5pv210_pd_list_lock);
+static struct dentry *s5pv210_pd_debugfs;
 
 static struct regulator_consumer_supply s5pv210_pd_audio_supply[] = {
 	REGULATOR_SUPPLY("pd", "s5pc1xx-iis.0"),
@@ -250,6 +282,7 @@ static struct s5pv210_pd_config s5pv210_pd_g3d_pdata = {
 	.init_data = &s5pv210_pd_g3d_data,
 	.clk_run = s5pv210_pd_g3d_clk,
 	.ctrlbit = S5PV210_PD_G3D,
+	.off_delay = 50,
 };
 
 static struct s5pv210_pd_config s5pv210_pd_mfc_pdata = {
@@ -258,6 +291,7 @@ static struct s5pv210_pd_config s5pv210_pd_mfc_pdata = {
 	.init_data = &s5pv210_pd_mfc_data,
 	.clk_run = s5pv210_pd_mfc_clk,
 	.ctrlbit = S5PV210_PD_MFC,
+	.off_delay = 100,
 };
 
 struct platform_device s5pv210_pd_audio = {
@@ -409,13 +443,15 @@ static int s5pv210_pd_is_enabled(struct regulator_dev *dev)
 {
 	struct s5pv210_pd_data *data = rdev_get_drvdata(dev);
 
-	return (__raw_readl(S5P_BLK_PWR_STAT) & data->ctrlbit) ? 1 : 0;
+	return data->enabled;
 }
 
-static int s5pv210_pd_enable(struct regulator_dev *dev)
+/* Called with data->lock held */
+static int s5pv210_pd_power_on(struct s5pv210_pd_data *data)
 {
-	struct s5pv210_pd_data *data = rdev_get_drvdata(dev);
-	int ret = 0;
+	ktime_t start = ktime_get();
+	unsigned int lat;
+	int ret;
 
 	if (data->clk_run)
 		s5pv210_pd_clk_enable(data->clk_run);
@@ -428,12 +464,23 @@ static int s5pv210_pd_enable(struct regulator_dev *dev)
 	if (data->clk_run)
 		s5pv210_pd_clk_disable(data->clk_run);
 
-	return ret;
+	if (ret < 0)
+		return ret;
+
+	data->on_since = ktime_get();
+	lat = ktime_to_us(ktime_sub(data->on_since, start));
+	data->powered = true;
+	data->on_count++;
+	data->lat_last_us = lat;
+	data->lat_max_us = max(data->lat_max_us, lat);
+	data->lat_total_us += lat;
+
+	return 0;
 }
 
-static int s5pv210_pd_disable(struct regulator_dev *dev)
+/* Called with data->lock held */
+static int s5pv210_pd_power_off(struct s5pv210_pd_data *data)
 {
-	struct s5pv210_pd_data *data = rdev_get_drvdata(dev);
 	int ret;
 
 	ret = s5pv210_pd_ctrl(data->ctrlbit, 0);
@@ -442,9 +489,65 @@ static int s5pv210_pd_disable(struct regulator_dev *dev)
 		return ret;
 	}
 
+	data->powered = false;
+	data->off_count++;
+	data->on_time_us += ktime_to_us(ktime_sub(ktime_get(),
+						  data->on_since));
+
 	return 0;
 }
 
+static void s5pv210_pd_off_work(struct work_struct *work)
+{
+	struct s5pv210_pd_data *data = container_of(work,
+			struct s5pv210_pd_data, off_work.work);
+
+	mutex_lock(&data->lock);
+	if (!data->enabled && data->powered)
+		s5pv210_pd_power_off(data);
+	mutex_unlock(&data->lock);
+}
+
+static int s5pv210_pd_enable(struct regulator_dev *dev)
+{
+	struct s5pv210_pd_data *data = rdev_get_drvdata(dev);
+	int ret = 0;
+
+	mutex_lock(&data->lock);
+	if (data->powered) {
+		/* still up, the pending power off is dropped */
+		cancel_delayed_work(&data->off_work);
+		data->off_skipped++;
+	} else {
+		ret = s5pv210_pd_power_on(data);
+	}
+
+	if (!ret)
+		data->enabled = true;
+	mutex_unlock(&data->lock);
+
+	return ret;
+}
+
+static int s5pv210_pd_disable(struct regulator_dev *dev)
+{
+	struct s5pv210_pd_data *data = rdev_get_drvdata(dev);
+	int ret = 0;
+
+	mutex_lock(&data->lock);
+	if (data->off_delay)
+		schedule_delayed_work(&data->off_work,
+				      msecs_to_jiffies(data->off_delay));
+	else
+		ret = s5pv210_pd_power_off(data);
+
+	if (!ret)
+		data->enabled = false;
+	mutex_unlock(&data->lock);
+
+	return ret;
+}
+
 static int s5pv210_pd_enable_time(struct regulator_dev *dev)
 {
 	struct s5pv210_pd_data *data = rdev_get_drvdata(dev);
@@ -479,6 +582,78 @@ static struct regulator_ops s5pv210_pd_ops = {
 	.list_voltage = s5pv210_pd_list_voltage,
 };
 
+#ifdef CONFIG_DEBUG_FS
+static int s5pv210_pd_stats_show(struct seq_file *s, void *unused)
+{
+	struct s5pv210_pd_data *data;
+	u64 on_time;
+
+	seq_printf(s, "%-16s %5s %5s %12s %8s %8s %8s %8s %8s\n",
+		   "domain", "users", "state", "on_time_ms", "on", "off",
+		   "skipped", "lat_us", "lat_max");
+
+	mutex_lock(&s5pv210_pd_list_lock);
+	list_for_each_entry(data, &s5pv210_pd_list, node) {
+		mutex_lock(&data->lock);
+		on_time = data->on_time_us;
+		if (data->powered)
+			on_time += ktime_to_us(ktime_sub(ktime_get(),
+							 data->on_since));
+		do_div(on_time, USEC_PER_MSEC);
+
+		seq_printf(s, "%-16s %5u %5s %12llu %8lu %8lu %8lu %8u %8u\n",
+			   data->desc.name, data->dev->use_count,
+			   data->powered ? (data->enabled ? "on" : "idle") :
+			   "off", on_time, data->on_count, data->off_count,
+			   data->off_skipped, data->lat_last_us,
+			   data->lat_max_us);
+		mutex_unlock(&data->lock);
+	}
+	mutex_unlock(&s5pv210_pd_list_lock);
+
+	return 0;
+}
+
+static int s5pv210_pd_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, s5pv210_pd_stats_show, inode->i_private);
+}
+
+static const struct file_operations s5pv210_pd_stats_fops = {
+	.open		= s5pv210_pd_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * s5pv210_pd/stats sums up all the domains, and s5pv210_pd/<supply>/
+ * holds the off_delay_ms tunable of each one.
+ */
+static void s5pv210_pd_debugfs_add(struct s5pv210_pd_data *data)
+{
+	mutex_lock(&s5pv210_pd_list_lock);
+	if (!s5pv210_pd_debugfs) {
+		s5pv210_pd_debugfs = debugfs_create_dir("s5pv210_pd", NULL);
+		if (!IS_ERR_OR_NULL(s5pv210_pd_debugfs))
+			debugfs_create_file("stats", S_IRUGO,
+					    s5pv210_pd_debugfs, NULL,
+					    &s5pv210_pd_stats_fops);
+	}
+
+	if (!IS_ERR_OR_NULL(s5pv210_pd_debugfs)) {
+		data->debugfs = debugfs_create_dir(data->desc.name,
+						   s5pv210_pd_debugfs);
+		if (!IS_ERR_OR_NULL(data->debugfs))
+			debugfs_create_u32("off_delay_ms", S_IRUGO | S_IWUSR,
+					   data->debugfs, &data->off_delay);
+	}
+	mutex_unlock(&s5pv210_pd_list_lock);
+}
+#else
+static inline void s5pv210_pd_debugfs_add(struct s5pv210_pd_data *data) { }
+#endif
+
 static int __devinit reg_s5pv210_pd_probe(struct platform_device *pdev)
 {
 	struct s5pv210_pd_config *config = pdev->dev.platform_data;
@@ -509,7 +684,13 @@ static int __devinit reg_s5pv210_pd_probe(struct platform_device *pdev)
 
 	drvdata->clk_run = config->clk_run;
 	drvdata->ctrlbit = config->ctrlbit;
-	spin_lock_init(&pd_lock);
+	drvdata->off_delay = config->off_delay;
+
+	mutex_init(&drvdata->lock);
+	INIT_DELAYED_WORK(&drvdata->off_work, s5pv210_pd_off_work);
+	drvdata->powered = __raw_readl(S5P_BLK_PWR_STAT) & drvdata->ctrlbit;
+	drvdata->enabled = drvdata->powered;
+	drvdata->on_since = ktime_get();
 
 	drvdata->dev = regulator_register(&drvdata->desc, &pdev->dev,
 					  config->init_data, drvdata);
@@ -521,6 +702,11 @@ static int __devinit reg_s5pv210_pd_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, drvdata);
 
+	mutex_lock(&s5pv210_pd_list_lock);
+	list_add_tail(&drvdata->node, &s5pv210_pd_list);
+	mutex_unlock(&s5pv210_pd_list_lock);
+	s5pv210_pd_debugfs_add(drvdata);
+
 	dev_dbg(&pdev->dev, "%s supplying %duV\n", drvdata->desc.name,
 		drvdata->microvolts);
 
@@ -537,7 +723,13 @@ static int __devexit reg_s5pv210_pd_remove(struct platform_device *pdev)
 {
 	struct s5pv210_pd_data *drvdata = platform_get_drvdata(pdev);
 
+	mutex_lock(&s5pv210_pd_list_lock);
+	list_del(&drvdata->node);
+	mutex_unlock(&s5pv210_pd_list_lock);
+	debugfs_remove_recursive(drvdata->debugfs);
+
 	regulator_unregister(drvdata->dev);
+	cancel_delayed_work_sync(&drvdata->off_work);
 	kfree(drvdata->desc.name);
 	kfree(drvdata);
 
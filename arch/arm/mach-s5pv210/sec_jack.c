@@ -59,6 +59,17 @@
 
 #define WAKELOCK_DET_TIMEOUT	HZ * 5 //5 sec
 
+/*
+ * The pins are sampled once they have been quiet this long: every edge
+ * pushes the check back, instead of the work polling them in a loop.
+ */
+#define DET_DEBOUNCE_TIME	msecs_to_jiffies(200)
+#define SEND_END_DEBOUNCE_TIME	msecs_to_jiffies(60)
+
+/* Sampling of an ADC value between the 3 and 4 pole zones */
+#define UNSTABLE_ADC_RETRIES	10
+#define UNSTABLE_ADC_DELAY	msecs_to_jiffies(20)
+
 
 static struct platform_driver sec_jack_driver;
 
@@ -87,6 +98,9 @@ struct switch_dev switch_sendend = {
 };
 static struct timer_list send_end_key_event_timer;
 static struct timer_list delay_work_timer;
+static struct timer_list det_debounce_timer;
+static struct timer_list send_end_debounce_timer;
+static int count_pole;
 
 static unsigned int current_jack_type_status;
 
@@ -127,117 +141,111 @@ static void jack_input_selector(int jack_type_status)
 }
 
 
+static void jack_type_detect_change(struct work_struct *ignored);
+static DECLARE_DELAYED_WORK(detect_jack_type_work, jack_type_detect_change);
+
+/*
+ * One ADC sample per run. A value between the zones is sampled again
+ * from a later run, not by sleeping here.
+ */
 static void jack_type_detect_change(struct work_struct *ignored)
 {
 	int adc = 0;
 	struct sec_gpio_info   *det_jack = &hi->port.det_jack;
 	struct sec_gpio_info   *send_end = &hi->port.send_end;
-	int state = gpio_get_value(det_jack->gpio) ^ det_jack->low_active;
-	int count_pole=0;
-	bool bQuit = false;
+	int state;
+
+	state = gpio_get_value(det_jack->gpio) ^ det_jack->low_active;
 
-	while(!bQuit)
+	if(state)
 	{
-		state = gpio_get_value(det_jack->gpio) ^ det_jack->low_active;
+		adc = s3c_adc_get_adc_data(SEC_HEADSET_ADC_CHANNEL);
+		printk(KERN_INFO "[ JACK_DRIVER : adc = %d, state = %d\n", adc, state);			
 
-		if(state)
+		/* 4 pole zone */
+		if(adc < 3200 && adc >= 2500)
 		{
-			adc = s3c_adc_get_adc_data(SEC_HEADSET_ADC_CHANNEL);
-			printk(KERN_INFO "[ JACK_DRIVER : adc = %d, state = %d\n", adc, state);			
-
-			/* 4 pole zone */
-			if(adc < 3200 && adc >= 2500)
+			current_jack_type_status = SEC_HEADSET_4_POLE_DEVICE;
+			printk(KERN_INFO "[ JACK_DRIVER (%s,%d) ] 4 pole  headset attached : adc = %d\n",__func__,__LINE__, adc);
+			if(send_end_irq_token==0)
 			{
-				current_jack_type_status = SEC_HEADSET_4_POLE_DEVICE;
-				printk(KERN_INFO "[ JACK_DRIVER (%s,%d) ] 4 pole  headset attached : adc = %d\n",__func__,__LINE__, adc);
-				bQuit = true;
-				if(send_end_irq_token==0)
-				{
-					enable_irq(send_end->eint);
+				enable_irq(send_end->eint);
                                         enable_irq_wake(send_end->eint);
-					send_end_irq_token=1;
-				}
-				McDrv_Ctrl_MICBIAS2(1);
+				send_end_irq_token=1;
 			}
-			/* 3 pole zone */
-			else if(!adc)
+			McDrv_Ctrl_MICBIAS2(1);
+		}
+		/* 3 pole zone */
+		else if(!adc)
+		{
+			/* detect 3pole or tv-out cable */
+			current_jack_type_status = SEC_HEADSET_3_POLE_DEVICE;
+			printk(KERN_INFO "[ JACK_DRIVER (%s,%d) ] 3 pole headset or TV-out attatched : adc = %d\n", __func__,__LINE__,adc);
+			if(send_end_irq_token==1)
+			{
+				disable_irq(send_end->eint);
+                                        disable_irq_wake(send_end->eint);
+				send_end_irq_token=0;
+			}
+			if(!get_recording_status())
+			{
+				McDrv_Ctrl_MICBIAS2(0);
+			}
+		}
+		/* unstable zone */
+		else
+		{	
+			/* unknown cable or unknown case */
+			if(count_pole == UNSTABLE_ADC_RETRIES)
 			{
 				/* detect 3pole or tv-out cable */
-				current_jack_type_status = SEC_HEADSET_3_POLE_DEVICE;
 				printk(KERN_INFO "[ JACK_DRIVER (%s,%d) ] 3 pole headset or TV-out attatched : adc = %d\n", __func__,__LINE__,adc);
-				bQuit=true;
+				count_pole = 0;
 				if(send_end_irq_token==1)
 				{
 					disable_irq(send_end->eint);
-                                        disable_irq_wake(send_end->eint);
+                                                disable_irq_wake(send_end->eint);
 					send_end_irq_token=0;
 				}
+				current_jack_type_status = SEC_HEADSET_3_POLE_DEVICE;
 				if(!get_recording_status())
 				{
 					McDrv_Ctrl_MICBIAS2(0);
 				}
 			}
-			/* unstable zone */
+			/* If 4 pole is inserted slowly, ADC value should be lower than 250.
+		 	* So, check again.
+			 */
 			else
-			{	
-				/* unknown cable or unknown case */
-				if(count_pole == 10)
-				{
-					/* detect 3pole or tv-out cable */
-					printk(KERN_INFO "[ JACK_DRIVER (%s,%d) ] 3 pole headset or TV-out attatched : adc = %d\n", __func__,__LINE__,adc);
-					count_pole = 0;
-					if(send_end_irq_token==1)
-					{
-						disable_irq(send_end->eint);
-                                                disable_irq_wake(send_end->eint);
-						send_end_irq_token=0;
-					}
-					current_jack_type_status = SEC_HEADSET_3_POLE_DEVICE;
-					if(!get_recording_status())
-					{
-						McDrv_Ctrl_MICBIAS2(0);
-					}
-					bQuit=true;
-				}
-				/* If 4 pole is inserted slowly, ADC value should be lower than 250.
-			 	* So, check again.
-				 */
-				else
-				{
-					++count_pole;
-					/* Todo : to prevent unexpected reset bug.
-					 * 		  is it msleep bug? need wakelock.
-					 */
-					wake_lock_timeout(&jack_sendend_wake_lock, WAKELOCK_DET_TIMEOUT);
-					msleep(20);
-				}
+			{
+				++count_pole;
+				wake_lock_timeout(&jack_sendend_wake_lock, WAKELOCK_DET_TIMEOUT);
+				schedule_delayed_work(&detect_jack_type_work, UNSTABLE_ADC_DELAY);
+				return;
 			}
-		} /* if(state) */
-		else
+		}
+	} /* if(state) */
+	else
+	{
+		current_jack_type_status = SEC_JACK_NO_DEVICE;
+		if(!get_recording_status())
 		{
-			bQuit=true;
-
-			current_jack_type_status = SEC_JACK_NO_DEVICE;
-			if(!get_recording_status())
-			{
-				McDrv_Ctrl_MICBIAS2(0);
+			McDrv_Ctrl_MICBIAS2(0);
     			}
-			SEC_JACKDEV_DBG("JACK dev detached  \n");			
+		SEC_JACKDEV_DBG("JACK dev detached  \n");			
 
-		}
-                
-		switch_set_state(&switch_jack_detection, current_jack_type_status);
-		jack_input_selector(current_jack_type_status);
 	}
+                
+	switch_set_state(&switch_jack_detection, current_jack_type_status);
+	jack_input_selector(current_jack_type_status);
 }
 
-static DECLARE_DELAYED_WORK(detect_jack_type_work, jack_type_detect_change);
-
+/* Runs once the detect pin has been stable for DET_DEBOUNCE_TIME */
 static void jack_detect_change(struct work_struct *ignored)
 {
 	struct sec_gpio_info   *det_jack = &hi->port.det_jack;
 	struct sec_gpio_info   *send_end = &hi->port.send_end;
-	int state,count=20;
+	int state;
 
 	cancel_delayed_work_sync(&detect_jack_type_work);
 	state = gpio_get_value(det_jack->gpio) ^ det_jack->low_active;
@@ -249,20 +257,8 @@ static void jack_detect_change(struct work_struct *ignored)
 
 	if(state)
 	{
-		/* check pin state repeatedly */
-		while(count--)
-		{
-			if(state != (gpio_get_value(det_jack->gpio) ^ det_jack->low_active))
-			{
-				if(!get_recording_status())
-				{
-					McDrv_Ctrl_MICBIAS2(0);
-				}
-				return;
-			}
-			msleep(10);
-		}
 		McDrv_Ctrl_MICBIAS2(1);
+		count_pole = 0;
 		schedule_delayed_work(&detect_jack_type_work, 60);
 	}
 	else if(!state && current_jack_type_status != SEC_JACK_NO_DEVICE)
@@ -287,12 +283,15 @@ static void jack_detect_change(struct work_struct *ignored)
 	}
 }
 
+/*
+ * A press is handled once the key has been stable for SEND_END_DEBOUNCE_TIME,
+ * a release right away. The ADC is only read for a press.
+ */
 static void sendend_switch_change(struct work_struct *ignored)
 {
 	struct sec_gpio_info   *det_jack = &hi->port.det_jack;
 	struct sec_gpio_info   *send_end = &hi->port.send_end;
 	int state, headset_state;
-	int count=6;
 	int adc = 0;;
 	
 	headset_state = gpio_get_value(det_jack->gpio) ^ det_jack->low_active;
@@ -301,16 +300,10 @@ static void sendend_switch_change(struct work_struct *ignored)
 
 	wake_lock_timeout(&jack_sendend_wake_lock,WAKELOCK_DET_TIMEOUT);
 		
-	/* check pin state repeatedly */
-	while(count-- && !key_pressed)
+	if(!key_pressed && (!headset_state || current_jack_type_status == SEC_HEADSET_3_POLE_DEVICE))
 	{
-		if(state != (gpio_get_value(send_end->gpio) ^ send_end->low_active) || !headset_state || current_jack_type_status == SEC_HEADSET_3_POLE_DEVICE)
-		{
-			printk(KERN_INFO "[ JACK_DRIVER] (%s,%d) ] SEND/END key is ignored. State is unstable.\n",__func__,__LINE__);
-			return;
-		}
-                
-		msleep(10);
+		printk(KERN_INFO "[ JACK_DRIVER] (%s,%d) ] SEND/END key is ignored. State is unstable.\n",__func__,__LINE__);
+		return;
 	}
 
 	if(state)
@@ -384,6 +377,16 @@ static DECLARE_WORK(sendend_switch_work, sendend_switch_change);
 static DECLARE_WORK(sendend_timer_work, sendend_timer_work_func);
 
 
+static void det_debounce_timer_handler(unsigned long arg)
+{
+	schedule_work(&jack_detect_work);
+}
+
+static void send_end_debounce_timer_handler(unsigned long arg)
+{
+	schedule_work(&sendend_switch_work);
+}
+
 //IRQ Handler
 static irqreturn_t detect_irq_handler(int irq, void *dev_id)
 {
@@ -391,7 +394,10 @@ static irqreturn_t detect_irq_handler(int irq, void *dev_id)
 		return IRQ_HANDLED;
 	
 	key_enable = 0;
-	schedule_work(&jack_detect_work);
+
+	/* keep awake until the pin has settled and been sampled */
+	wake_lock_timeout(&jack_sendend_wake_lock, WAKELOCK_DET_TIMEOUT);
+	mod_timer(&det_debounce_timer, jiffies + DET_DEBOUNCE_TIME);
 	return IRQ_HANDLED;
 }
  
@@ -409,7 +415,11 @@ static irqreturn_t send_end_irq_handler(int irq, void *dev_id)
 
         if (key_enable && headset_state)
         {
-                schedule_work(&sendend_switch_work);		
+                wake_lock_timeout(&jack_sendend_wake_lock, WAKELOCK_DET_TIMEOUT);
+                if (key_pressed)
+                        schedule_work(&sendend_switch_work);
+                else
+                        mod_timer(&send_end_debounce_timer, jiffies + SEND_END_DEBOUNCE_TIME);
         }
 
         return IRQ_HANDLED;
@@ -546,6 +556,15 @@ static int sec_jack_probe(struct platform_device *pdev)
 	init_timer(&send_end_key_event_timer);
 	send_end_key_event_timer.function = send_end_key_event_timer_handler;
 
+	init_timer(&det_debounce_timer);
+	det_debounce_timer.function = det_debounce_timer_handler;
+
+	init_timer(&send_end_debounce_timer);
+	send_end_debounce_timer.function = send_end_debounce_timer_handler;
+
+	/* the interrupt handlers take it */
+	wake_lock_init(&jack_sendend_wake_lock, WAKE_LOCK_SUSPEND, "sec_jack");
+
 	
 	ret = switch_dev_register(&switch_jack_detection);
 	if (ret < 0) 
@@ -615,8 +634,6 @@ static int sec_jack_probe(struct platform_device *pdev)
 	}
 
 	enable_irq_wake(det_jack->eint);
-        
-	wake_lock_init(&jack_sendend_wake_lock, WAKE_LOCK_SUSPEND, "sec_jack");
 
 	init_timer(&delay_work_timer);
 	delay_work_timer.function = delay_work_timer_func;
@@ -646,6 +663,9 @@ static int sec_jack_remove(struct platform_device *pdev)
 	input_unregister_device(hi->input);
 	free_irq(hi->port.det_jack.eint, 0);
 	free_irq(hi->port.send_end.eint, 0);
+	del_timer_sync(&det_debounce_timer);
+	del_timer_sync(&send_end_debounce_timer);
+	cancel_delayed_work_sync(&detect_jack_type_work);
 	switch_dev_unregister(&switch_jack_detection);
 	switch_dev_unregister(&switch_sendend);
 	return 0;
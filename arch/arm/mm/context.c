@@ -12,6 +12,8 @@
 #include <linux/mm.h>
 #include <linux/smp.h>
 #include <linux/percpu.h>
+#include <linux/bitops.h>
+#include <linux/vmstat.h>
 
 #include <asm/mmu_context.h>
 #include <asm/tlbflush.h>
@@ -103,22 +105,11 @@ static void reset_context(void *info)
 	isb();
 }
 
-#else
-
-static inline void set_mm_context(struct mm_struct *mm, unsigned int asid)
-{
-	mm->context.id = asid;
-	cpumask_copy(mm_cpumask(mm), cpumask_of(smp_processor_id()));
-}
-
-#endif
-
 void __new_context(struct mm_struct *mm)
 {
 	unsigned int asid;
 
 	spin_lock(&cpu_asid_lock);
-#ifdef CONFIG_SMP
 	/*
 	 * Check the ASID again, in case the change was broadcast from
 	 * another CPU before we acquired the lock.
@@ -128,7 +119,6 @@ void __new_context(struct mm_struct *mm)
 		spin_unlock(&cpu_asid_lock);
 		return;
 	}
-#endif
 	/*
 	 * At this point, it is guaranteed that the current mm (with
 	 * an old ASID) isn't active on any other CPU since the ASIDs
@@ -137,6 +127,7 @@ void __new_context(struct mm_struct *mm)
 	asid = ++cpu_last_asid;
 	if (asid == 0)
 		asid = cpu_last_asid = ASID_FIRST_VERSION;
+	count_vm_event(ASID_ALLOC);
 
 	/*
 	 * If we've used up all our ASIDs, we need
@@ -145,13 +136,92 @@ void __new_context(struct mm_struct *mm)
 	if (unlikely((asid & ~ASID_MASK) == 0)) {
 		asid = cpu_last_asid + smp_processor_id() + 1;
 		flush_context();
-#ifdef CONFIG_SMP
+		count_vm_event(ASID_ROLLOVER);
 		smp_wmb();
 		smp_call_function(reset_context, NULL, 1);
-#endif
 		cpu_last_asid += NR_CPUS;
 	}
 
 	set_mm_context(mm, asid);
 	spin_unlock(&cpu_asid_lock);
 }
+
+#else
+
+/*
+ * Without other CPUs to keep in step, the ASIDs of the current version
+ * are tracked in a bitmap and given back when their mm goes away, so a
+ * new version and its full TLB flush are only needed once more than 255
+ * address spaces are alive at the same time, rather than after every 255
+ * forks. Here cpu_last_asid holds only the version.
+ */
+#define NUM_ASIDS	(1 << ASID_BITS)
+
+/* ASID 0 is reserved */
+static DECLARE_BITMAP(asid_map, NUM_ASIDS) = { 1 };
+static unsigned int asid_next = 1;
+
+static inline void set_mm_context(struct mm_struct *mm, unsigned int asid)
+{
+	mm->context.id = asid;
+	cpumask_copy(mm_cpumask(mm), cpumask_of(smp_processor_id()));
+}
+
+void __new_context(struct mm_struct *mm)
+{
+	unsigned int asid = mm->context.id & ~ASID_MASK;
+
+	spin_lock(&cpu_asid_lock);
+
+	/*
+	 * A mm of an older version keeps its ASID if it is still free:
+	 * the TLB was flushed when the version changed.
+	 */
+	if (asid && !test_bit(asid, asid_map))
+		goto found;
+
+	asid = find_next_zero_bit(asid_map, NUM_ASIDS, asid_next);
+	if (asid == NUM_ASIDS)
+		asid = find_next_zero_bit(asid_map, NUM_ASIDS, 1);
+	if (asid == NUM_ASIDS) {
+		cpu_last_asid += ASID_FIRST_VERSION;
+		if (cpu_last_asid == 0)
+			cpu_last_asid = ASID_FIRST_VERSION;
+		bitmap_zero(asid_map, NUM_ASIDS);
+		__set_bit(0, asid_map);
+		flush_context();
+		count_vm_event(ASID_ROLLOVER);
+		asid = 1;
+	}
+	asid_next = asid + 1;
+	count_vm_event(ASID_ALLOC);
+
+found:
+	__set_bit(asid, asid_map);
+	set_mm_context(mm, cpu_last_asid | asid);
+	spin_unlock(&cpu_asid_lock);
+}
+
+/*
+ * The last reference to mm is gone, so it is not loaded anywhere: drop
+ * what its page table walks may have left in the TLB since exit_mmap()
+ * and give its ASID back.
+ */
+void destroy_context(struct mm_struct *mm)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&cpu_asid_lock, flags);
+	if (((mm->context.id ^ cpu_last_asid) >> ASID_BITS) == 0) {
+		local_flush_tlb_mm(mm);
+		if (icache_is_vivt_asid_tagged()) {
+			__flush_icache_all();
+			dsb();
+		}
+		__clear_bit(mm->context.id & ~ASID_MASK, asid_map);
+		count_vm_event(ASID_FLUSH);
+	}
+	spin_unlock_irqrestore(&cpu_asid_lock, flags);
+}
+
+#endif
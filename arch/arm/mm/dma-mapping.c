@@ -18,6 +18,7 @@
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
 #include <linux/highmem.h>
+#include <linux/sched.h>
 
 #include <asm/memory.h>
 #include <asm/highmem.h>
@@ -422,6 +423,136 @@ void dma_free_coherent(struct device *dev, size_t size, void *cpu_addr, dma_addr
 }
 EXPORT_SYMBOL(dma_free_coherent);
 
+/*
+ * Above dma_cache_all_threshold bytes, cleaning or invalidating the inner
+ * caches line by line costs more than cleaning and invalidating all of
+ * them by set/way, which is as good for any direction. The threshold is
+ * measured at boot unless given as dma_cache_all_threshold=, and stays 0
+ * (always by line) on SMP, where the set/way operations only reach the
+ * local CPU. Outer caches are still maintained by range.
+ */
+static size_t dma_cache_all_threshold;
+static int dma_cache_all_set;
+
+/* Inside a dma_cache_batch_begin(), with the inner caches flushed */
+static int dma_cache_batched;
+
+static int __init dma_cache_all_setup(char *str)
+{
+	dma_cache_all_threshold = memparse(str, &str);
+	dma_cache_all_set = 1;
+	return 1;
+}
+__setup("dma_cache_all_threshold=", dma_cache_all_setup);
+
+/* Whether the inner cache maintenance of size bytes has been done */
+static bool dma_cache_inner_done(size_t size)
+{
+	if (dma_cache_batched)
+		return true;
+
+	if (!dma_cache_all_threshold || size < dma_cache_all_threshold)
+		return false;
+
+	__cpuc_flush_kern_all();
+	return true;
+}
+
+/**
+ * dma_cache_batch_begin - prepare for mapping or syncing several buffers
+ * @size: total size of the buffers
+ *
+ * When @size makes the inner caches cheaper to flush whole, flushes them
+ * and lets the mappings and syncs of the buffers until
+ * dma_cache_batch_end() skip their inner cache maintenance. The caller
+ * must not sleep nor touch the buffers in between. Returns whether a
+ * batch was started, to be passed to dma_cache_batch_end().
+ */
+bool dma_cache_batch_begin(size_t size)
+{
+	if (arch_is_coherent() || !dma_cache_all_threshold ||
+	    size < dma_cache_all_threshold)
+		return false;
+
+	preempt_disable();
+	__cpuc_flush_kern_all();
+	dma_cache_batched = 1;
+	return true;
+}
+EXPORT_SYMBOL(dma_cache_batch_begin);
+
+void dma_cache_batch_end(bool batched)
+{
+	if (!batched)
+		return;
+
+	dma_cache_batched = 0;
+	preempt_enable();
+}
+EXPORT_SYMBOL(dma_cache_batch_end);
+
+/*
+ * Time cleaning a dirty buffer by line against flushing all the inner
+ * caches with the same buffer dirty, to find where the lines cost more.
+ */
+#define DMA_CACHE_BENCH_ORDER	6
+
+static int __init dma_cache_all_init(void)
+{
+	size_t size = PAGE_SIZE << DMA_CACHE_BENCH_ORDER;
+	unsigned long long t, range_ns = ULLONG_MAX, all_ns = ULLONG_MAX;
+	unsigned long flags;
+	struct page *page;
+	void *buf;
+	int i;
+
+	/* set/way operations only reach this CPU */
+	if (num_possible_cpus() > 1) {
+		dma_cache_all_threshold = 0;
+		return 0;
+	}
+
+	if (dma_cache_all_set || arch_is_coherent())
+		return 0;
+
+	page = alloc_pages(GFP_KERNEL, DMA_CACHE_BENCH_ORDER);
+	if (!page)
+		return 0;
+	buf = page_address(page);
+
+	for (i = 0; i < 2; i++) {
+		local_irq_save(flags);
+
+		memset(buf, i, size);
+		t = sched_clock();
+		dmac_map_area(buf, size, DMA_TO_DEVICE);
+		range_ns = min(range_ns, sched_clock() - t);
+
+		memset(buf, i, size);
+		t = sched_clock();
+		__cpuc_flush_kern_all();
+		all_ns = min(all_ns, sched_clock() - t);
+
+		local_irq_restore(flags);
+	}
+
+	__free_pages(page, DMA_CACHE_BENCH_ORDER);
+
+	if (!range_ns)
+		return 0;
+
+	t = all_ns * size;
+	do_div(t, range_ns);
+	dma_cache_all_threshold = PAGE_ALIGN((size_t)t);
+
+	pr_info("DMA: whole inner cache flush above %zu KB "
+		"(%llu ns by line, %llu ns whole for %zu KB)\n",
+		dma_cache_all_threshold >> 10, range_ns, all_ns, size >> 10);
+
+	return 0;
+}
+arch_initcall(dma_cache_all_init);
+
 /*
  * Make an area consistent for devices.
  * Note: Drivers should NOT use this function directly, as it will break
@@ -435,7 +566,8 @@ void ___dma_single_cpu_to_dev(const void *kaddr, size_t size,
 
 	BUG_ON(!virt_addr_valid(kaddr) || !virt_addr_valid(kaddr + size - 1));
 
-	dmac_map_area(kaddr, size, dir);
+	if (!dma_cache_inner_done(size))
+		dmac_map_area(kaddr, size, dir);
 
 	paddr = __pa(kaddr);
 	if (dir == DMA_FROM_DEVICE) {
@@ -459,7 +591,8 @@ void ___dma_single_dev_to_cpu(const void *kaddr, size_t size,
 		outer_inv_range(paddr, paddr + size);
 	}
 
-	dmac_unmap_area(kaddr, size, dir);
+	if (dir == DMA_TO_DEVICE || !dma_cache_inner_done(size))
+		dmac_unmap_area(kaddr, size, dir);
 }
 EXPORT_SYMBOL(___dma_single_dev_to_cpu);
 
@@ -514,7 +647,8 @@ void ___dma_page_cpu_to_dev(struct page *page, unsigned long off,
 {
 	unsigned long paddr;
 
-	dma_cache_maint_page(page, off, size, dir, dmac_map_area);
+	if (!dma_cache_inner_done(size))
+		dma_cache_maint_page(page, off, size, dir, dmac_map_area);
 
 	paddr = page_to_phys(page) + off;
 	if (dir == DMA_FROM_DEVICE) {
@@ -536,7 +670,8 @@ void ___dma_page_dev_to_cpu(struct page *page, unsigned long off,
 	if (dir != DMA_TO_DEVICE)
 		outer_inv_range(paddr, paddr + size);
 
-	dma_cache_maint_page(page, off, size, dir, dmac_unmap_area);
+	if (dir == DMA_TO_DEVICE || !dma_cache_inner_done(size))
+		dma_cache_maint_page(page, off, size, dir, dmac_unmap_area);
 
 	/*
 	 * Mark the D-cache clean for this page to avoid extra flushing.
@@ -546,6 +681,21 @@ void ___dma_page_dev_to_cpu(struct page *page, unsigned long off,
 }
 EXPORT_SYMBOL(___dma_page_dev_to_cpu);
 
+static size_t dma_sg_size(struct scatterlist *sg, int nents)
+{
+	struct scatterlist *s;
+	size_t size = 0;
+	int i;
+
+	if (!dma_cache_all_threshold)
+		return 0;
+
+	for_each_sg(sg, s, nents, i)
+		size += s->length;
+
+	return size;
+}
+
 /**
  * dma_map_sg - map a set of SG buffers for streaming mode DMA
  * @dev: valid struct device pointer, or NULL for ISA and EISA-like devices
@@ -566,22 +716,26 @@ int dma_map_sg(struct device *dev, struct scatterlist *sg, int nents,
 		enum dma_data_direction dir)
 {
 	struct scatterlist *s;
+	bool batched;
 	int i, j;
 
 	BUG_ON(!valid_dma_direction(dir));
 
+	batched = dma_cache_batch_begin(dma_sg_size(sg, nents));
 	for_each_sg(sg, s, nents, i) {
 		s->dma_address = __dma_map_page(dev, sg_page(s), s->offset,
 						s->length, dir);
 		if (dma_mapping_error(dev, s->dma_address))
 			goto bad_mapping;
 	}
+	dma_cache_batch_end(batched);
 	debug_dma_map_sg(dev, sg, nents, nents, dir);
 	return nents;
 
  bad_mapping:
 	for_each_sg(sg, s, i, j)
 		__dma_unmap_page(dev, sg_dma_address(s), sg_dma_len(s), dir);
+	dma_cache_batch_end(batched);
 	return 0;
 }
 EXPORT_SYMBOL(dma_map_sg);
@@ -600,12 +754,16 @@ void dma_unmap_sg(struct device *dev, struct scatterlist *sg, int nents,
 		enum dma_data_direction dir)
 {
 	struct scatterlist *s;
+	bool batched = false;
 	int i;
 
 	debug_dma_unmap_sg(dev, sg, nents, dir);
 
+	if (dir != DMA_TO_DEVICE)
+		batched = dma_cache_batch_begin(dma_sg_size(sg, nents));
 	for_each_sg(sg, s, nents, i)
 		__dma_unmap_page(dev, sg_dma_address(s), sg_dma_len(s), dir);
+	dma_cache_batch_end(batched);
 }
 EXPORT_SYMBOL(dma_unmap_sg);
 
@@ -620,8 +778,11 @@ void dma_sync_sg_for_cpu(struct device *dev, struct scatterlist *sg,
 			int nents, enum dma_data_direction dir)
 {
 	struct scatterlist *s;
+	bool batched = false;
 	int i;
 
+	if (dir != DMA_TO_DEVICE)
+		batched = dma_cache_batch_begin(dma_sg_size(sg, nents));
 	for_each_sg(sg, s, nents, i) {
 		if (!dmabounce_sync_for_cpu(dev, sg_dma_address(s), 0,
 					    sg_dma_len(s), dir))
@@ -630,6 +791,7 @@ void dma_sync_sg_for_cpu(struct device *dev, struct scatterlist *sg,
 		__dma_page_dev_to_cpu(sg_page(s), s->offset,
 				      s->length, dir);
 	}
+	dma_cache_batch_end(batched);
 
 	debug_dma_sync_sg_for_cpu(dev, sg, nents, dir);
 }
@@ -646,8 +808,10 @@ void dma_sync_sg_for_device(struct device *dev, struct scatterlist *sg,
 			int nents, enum dma_data_direction dir)
 {
 	struct scatterlist *s;
+	bool batched;
 	int i;
 
+	batched = dma_cache_batch_begin(dma_sg_size(sg, nents));
 	for_each_sg(sg, s, nents, i) {
 		if (!dmabounce_sync_for_device(dev, sg_dma_address(s), 0,
 					sg_dma_len(s), dir))
@@ -656,6 +820,7 @@ void dma_sync_sg_for_device(struct device *dev, struct scatterlist *sg,
 		__dma_page_cpu_to_dev(sg_page(s), s->offset,
 				      s->length, dir);
 	}
+	dma_cache_batch_end(batched);
 
 	debug_dma_sync_sg_for_device(dev, sg, nents, dir);
 }
@@ -11,9 +11,13 @@
 */
 
 #include <linux/err.h>
+#include <linux/gfp.h>
+#include <linux/init.h>
 #include <linux/memblock.h>
 #include <linux/mm.h>
+#include <linux/mutex.h>
 #include <linux/swap.h>
+#include <asm/cacheflush.h>
 #include <asm/setup.h>
 #include <linux/io.h>
 #include <mach/memory.h>
@@ -25,6 +29,42 @@ static int nr_media_devs;
 
 static dma_addr_t media_base[NR_BANKS];
 
+#ifdef CONFIG_CMA
+/* Lent memory goes back and forth in whole buddy blocks */
+#define S5P_MEDIA_LEND_ALIGN	(MAX_ORDER_NR_PAGES << PAGE_SHIFT)
+
+static DEFINE_MUTEX(media_lend_lock);
+
+static size_t s5p_media_lent_size(struct s5p_media_device *mdev)
+{
+	return ALIGN(mdev->memsize, S5P_MEDIA_LEND_ALIGN);
+}
+
+/* The movable device whose memory holds that of mdev, if any */
+static struct s5p_media_device *s5p_media_lender(struct s5p_media_device *mdev)
+{
+	struct s5p_media_device *lender;
+	int i;
+
+	for (i = 0; i < nr_media_devs; i++) {
+		lender = &media_devs[i];
+		if (!lender->movable || !lender->paddr)
+			continue;
+
+		if (mdev->paddr >= lender->paddr &&
+		    mdev->paddr < lender->paddr + s5p_media_lent_size(lender))
+			return lender;
+	}
+
+	return NULL;
+}
+#else
+static struct s5p_media_device *s5p_media_lender(struct s5p_media_device *mdev)
+{
+	return NULL;
+}
+#endif
+
 static struct s5p_media_device *s5p_get_media_device(int dev_id, int bank)
 {
 	struct s5p_media_device *mdev = NULL;
@@ -80,6 +120,26 @@ size_t s5p_get_media_memsize_bank(int dev_id, int bank)
 }
 EXPORT_SYMBOL(s5p_get_media_memsize_bank);
 
+/* Whether [paddr, paddr + size) lies in memory reserved for dev_id */
+bool s5p_media_memory_contains(int dev_id, dma_addr_t paddr, size_t size)
+{
+	struct s5p_media_device *mdev;
+	int i;
+
+	for (i = 0; i < nr_media_devs; i++) {
+		mdev = &media_devs[i];
+		if (mdev->id != dev_id || !mdev->paddr)
+			continue;
+
+		if (paddr >= mdev->paddr && size <= mdev->memsize &&
+		    paddr - mdev->paddr <= mdev->memsize - size)
+			return true;
+	}
+
+	return false;
+}
+EXPORT_SYMBOL(s5p_media_memory_contains);
+
 dma_addr_t s5p_get_media_membase_bank(int bank)
 {
 	if (bank > meminfo.nr_banks) {
@@ -110,6 +170,25 @@ void s5p_reserve_bootmem(struct s5p_media_device *mdevs,
 		if (mdev->memsize <= 0)
 			continue;
 
+#ifdef CONFIG_CMA
+		if (mdev->movable) {
+			size_t size = s5p_media_lent_size(mdev);
+
+			start = meminfo.bank[mdev->bank].start;
+			end = start + meminfo.bank[mdev->bank].size;
+
+			if (boundary && (boundary < end - start))
+				start = end - boundary;
+
+			/* kept from bootmem, then given to the page allocator */
+			mdev->paddr = memblock_find_in_range(start, end, size,
+						S5P_MEDIA_LEND_ALIGN);
+			ret = memblock_reserve(mdev->paddr, size);
+			if (ret < 0)
+				pr_err("memblock_reserve(%x, %x) failed\n",
+					mdev->paddr, size);
+		} else
+#endif
 		if (!strcmp(mdev->name, "jpeg"))
 			mdev->paddr = mfc_paddr;
 		else
@@ -124,10 +203,13 @@ void s5p_reserve_bootmem(struct s5p_media_device *mdevs,
 						mdev->memsize, PAGE_SIZE);
 		}
 
-		ret = memblock_remove(mdev->paddr, mdev->memsize);
-		if (ret < 0)
-			pr_err("memblock_reserve(%x, %x) failed\n",
-				mdev->paddr, mdev->memsize);
+		/* inside lent memory, shares its claims instead */
+		if (!s5p_media_lender(mdev)) {
+			ret = memblock_remove(mdev->paddr, mdev->memsize);
+			if (ret < 0)
+				pr_err("memblock_reserve(%x, %x) failed\n",
+					mdev->paddr, mdev->memsize);
+		}
 
 		if (media_base[mdev->bank] > mdev->paddr)
 			media_base[mdev->bank] = mdev->paddr;
@@ -142,6 +224,99 @@ void s5p_reserve_bootmem(struct s5p_media_device *mdevs,
 	}
 }
 
+#ifdef CONFIG_CMA
+/*
+ * Takes the memory of a movable device back from the page allocator,
+ * migrating the pages lent out, on the first claim.
+ */
+int s5p_media_claim(int dev_id, int bank)
+{
+	struct s5p_media_device *mdev, *lender;
+	unsigned long pfn;
+	size_t size;
+	int ret = 0;
+
+	/* no memory reserved, or none lent: nothing to claim */
+	mdev = s5p_get_media_device(dev_id, bank);
+	if (!mdev || !mdev->paddr)
+		return 0;
+
+	lender = s5p_media_lender(mdev);
+	if (!lender)
+		return 0;
+
+	mutex_lock(&media_lend_lock);
+	if (!lender->users) {
+		size = s5p_media_lent_size(lender);
+		pfn = __phys_to_pfn(lender->paddr);
+
+		ret = alloc_contig_range(pfn, pfn + (size >> PAGE_SHIFT));
+		if (ret) {
+			printk(KERN_ERR "s5p: cannot take back memory of %s "
+				"for %s: %d\n", lender->name, mdev->name, ret);
+			goto out;
+		}
+
+		/* lines of the pages lent must not land on device data */
+		dmac_flush_range(phys_to_virt(lender->paddr),
+				 phys_to_virt(lender->paddr) + size);
+		outer_flush_range(lender->paddr, lender->paddr + size);
+	}
+	lender->users++;
+out:
+	mutex_unlock(&media_lend_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(s5p_media_claim);
+
+void s5p_media_release(int dev_id, int bank)
+{
+	struct s5p_media_device *mdev, *lender;
+
+	mdev = s5p_get_media_device(dev_id, bank);
+	if (!mdev || !mdev->paddr)
+		return;
+
+	lender = s5p_media_lender(mdev);
+	if (!lender)
+		return;
+
+	mutex_lock(&media_lend_lock);
+	if (!WARN_ON(!lender->users) && !--lender->users)
+		free_contig_range(__phys_to_pfn(lender->paddr),
+				  s5p_media_lent_size(lender) >> PAGE_SHIFT);
+	mutex_unlock(&media_lend_lock);
+}
+EXPORT_SYMBOL(s5p_media_release);
+
+/* The page allocator is up: lend the movable devices' memory */
+static int __init s5p_media_lend_init(void)
+{
+	struct s5p_media_device *mdev;
+	unsigned long pfn, end;
+	int i;
+
+	for (i = 0; i < nr_media_devs; i++) {
+		mdev = &media_devs[i];
+		if (!mdev->movable || !mdev->paddr)
+			continue;
+
+		pfn = __phys_to_pfn(mdev->paddr);
+		end = pfn + (s5p_media_lent_size(mdev) >> PAGE_SHIFT);
+		for (; pfn < end; pfn += pageblock_nr_pages)
+			init_cma_reserved_pageblock(pfn_to_page(pfn));
+
+		printk(KERN_INFO "s5p: %lu bytes for %s lent to movable "
+			"pages\n", (unsigned long) s5p_media_lent_size(mdev),
+			mdev->name);
+	}
+
+	return 0;
+}
+core_initcall(s5p_media_lend_init);
+#endif
+
 /* FIXME: temporary implementation to avoid compile error */
 int dma_needs_bounce(struct device *dev, dma_addr_t addr, size_t size)
 {
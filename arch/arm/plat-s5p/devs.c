@@ -459,6 +459,42 @@ struct platform_device s3c_device_jpeg = {
 	.resource         = s3c_jpeg_resource,
 };
 
+#if defined(CONFIG_CRYPTO_DEV_S5P) || defined(CONFIG_CRYPTO_DEV_S5P_MODULE)
+/* Security Sub-System, AES through its feed control DMA */
+static struct resource s5p_sss_resource[] = {
+	[0] = {
+		.start = S5PV210_PA_SSS,
+		.end   = S5PV210_PA_SSS + S5PV210_SZ_SSS - 1,
+		.flags = IORESOURCE_MEM,
+	},
+	[1] = {
+		.name  = "feed control",
+		.start = IRQ_SSS_INT,
+		.end   = IRQ_SSS_INT,
+		.flags = IORESOURCE_IRQ,
+	},
+	[2] = {
+		.name  = "hash",
+		.start = IRQ_SSS_HASH,
+		.end   = IRQ_SSS_HASH,
+		.flags = IORESOURCE_IRQ,
+	},
+};
+
+static u64 s5p_device_sss_dmamask = 0xffffffffUL;
+
+struct platform_device s5p_device_sss = {
+	.name		= "s5p-secss",
+	.id		= -1,
+	.num_resources	= ARRAY_SIZE(s5p_sss_resource),
+	.resource	= s5p_sss_resource,
+	.dev		= {
+		.dma_mask		= &s5p_device_sss_dmamask,
+		.coherent_dma_mask	= 0xffffffffUL,
+	},
+};
+#endif
+
 /* G3D */
 struct platform_device s3c_device_g3d = {
 	.name		= "pvrsrvkm",
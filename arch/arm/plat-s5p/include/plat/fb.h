@@ -54,6 +54,19 @@ extern int s3cfb_clk_on(struct platform_device *pdev, struct clk **s3cfb_clk);
 extern int s3cfb_clk_off(struct platform_device *pdev, struct clk **clk);
 extern void s3cfb_get_clk_name(char *clk_name);
 
+/*
+ * Sent on the scanout notifier, in atomic context, whenever a window
+ * of the LCD controller starts scanning out from another address.
+ */
+struct s3cfb_scanout {
+	struct fb_info	*fb;
+	dma_addr_t	start;
+};
+
+struct notifier_block;
+extern int s3cfb_register_scanout_notifier(struct notifier_block *nb);
+extern int s3cfb_unregister_scanout_notifier(struct notifier_block *nb);
+
 #else
 
 #ifdef CONFIG_S3C_FB
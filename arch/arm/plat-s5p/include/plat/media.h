@@ -22,13 +22,35 @@ struct s5p_media_device {
 	u32		bank;
 	size_t		memsize;
 	dma_addr_t	paddr;
+	bool		movable;	/* lent to movable pages while unclaimed */
+	int		users;
 };
 
 extern struct meminfo meminfo;
 extern dma_addr_t s5p_get_media_memory_bank(int dev_id, int bank);
 extern size_t s5p_get_media_memsize_bank(int dev_id, int bank);
+extern bool s5p_media_memory_contains(int dev_id, dma_addr_t paddr,
+				      size_t size);
 extern dma_addr_t s5p_get_media_membase_bank(int bank);
 extern void s5p_reserve_bootmem(struct s5p_media_device *mdevs, int nr_mdevs, size_t boundary);
 
+/*
+ * Memory of movable media devices is only the device's between a claim
+ * and its release; a device inside the memory of another one claims that.
+ */
+#ifdef CONFIG_CMA
+extern int s5p_media_claim(int dev_id, int bank);
+extern void s5p_media_release(int dev_id, int bank);
+#else
+static inline int s5p_media_claim(int dev_id, int bank)
+{
+	return 0;
+}
+
+static inline void s5p_media_release(int dev_id, int bank)
+{
+}
+#endif
+
 #endif
 
@@ -102,6 +102,9 @@
 #define S3C2412_IISFIC_RXFLUSH		(1 << 7)
 #define S3C2412_IISFIC_TXCOUNT(x)	(((x) >>  8) & 0xf)
 #define S3C2412_IISFIC_RXCOUNT(x)	(((x) >>  0) & 0xf)
+/* The S5PV210 FIFOs are 64 words deep */
+#define S5P_IISFIC_TXCOUNT(x)		(((x) >>  8) & 0x7f)
+#define S5P_IISFIC_RXCOUNT(x)		(((x) >>  0) & 0x7f)
 
 #define S5P_IISAHB_INTENLVL3	(1<<27)
 #define S5P_IISAHB_INTENLVL2	(1<<26)
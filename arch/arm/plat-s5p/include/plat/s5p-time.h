@@ -27,9 +27,6 @@ struct s5p_timer_source {
 	unsigned int source_id;
 };
 
-/* Be able to sleep for atleast 4 seconds (usually more) */
-#define S5PTIMER_MIN_RANGE	4
-
 #define TCNT_MAX		0xffffffff
 #define NON_PERIODIC		0
 #define PERIODIC		1
@@ -27,6 +27,7 @@ enum S5P_SYSMMU_INTERRUPT_TYPE {
 
 #ifdef CONFIG_S5P_SYSTEM_MMU
 
+#include <linux/types.h>
 #include <mach/sysmmu.h>
 
 /**
@@ -85,6 +86,48 @@ void s5p_sysmmu_set_fault_handler(sysmmu_ips ips,
 			int (*handler)(enum S5P_SYSMMU_INTERRUPT_TYPE itype,
 					unsigned long pgtable_base,
 					unsigned long fault_addr));
+
+struct page;
+struct scatterlist;
+struct s5p_sysmmu_map;
+
+/**
+ * s5p_sysmmu_map_create() - page tables and device addresses for an ip
+ * @ips: The ip connected system mmu.
+ * @base: First device address handed out, page aligned and not 0.
+ * @size: Size of the window of device addresses.
+ *
+ * Returns the map, or an ERR_PTR(). The ip translates through it once
+ * s5p_sysmmu_map_enable() is called.
+ */
+struct s5p_sysmmu_map *s5p_sysmmu_map_create(sysmmu_ips ips,
+					unsigned long base, size_t size);
+void s5p_sysmmu_map_destroy(struct s5p_sysmmu_map *map);
+void s5p_sysmmu_map_enable(struct s5p_sysmmu_map *map);
+
+/**
+ * s5p_sysmmu_map_pages() - map pages at consecutive device addresses
+ * @map: The map of the ip.
+ * @pages: The pages, in the order the ip sees them.
+ * @nr_pages: Number of pages.
+ *
+ * Returns the device address of the first page, or 0 on failure.
+ * s5p_sysmmu_map_sg() does the same for a list of page aligned segments.
+ */
+dma_addr_t s5p_sysmmu_map_pages(struct s5p_sysmmu_map *map,
+				struct page **pages, int nr_pages);
+dma_addr_t s5p_sysmmu_map_sg(struct s5p_sysmmu_map *map,
+			     struct scatterlist *sg, int nents);
+
+/**
+ * s5p_sysmmu_unmap() - unmap nr_pages pages mapped at iova
+ *
+ * The TLB of the ip is invalidated once for a batch of unmaps, before the
+ * device addresses are handed out again. s5p_sysmmu_map_flush() forces it.
+ */
+void s5p_sysmmu_unmap(struct s5p_sysmmu_map *map, dma_addr_t iova,
+		      int nr_pages);
+void s5p_sysmmu_map_flush(struct s5p_sysmmu_map *map);
 #else
 #define s5p_sysmmu_enable(ips, pgd) do { } while (0)
 #define s5p_sysmmu_disable(ips) do { } while (0)
@@ -276,10 +276,15 @@ static void __init s5p_clockevent_init(void)
 	clock_rate = clk_get_rate(tin_event);
 	clock_count_per_tick = clock_rate / HZ;
 
+	/*
+	 * Scale for the whole 32-bit range of the counter: a mult/shift
+	 * chosen for a few seconds saturates clockevent_delta2ns(), and
+	 * NO_HZ idle would then wake up every few seconds for nothing.
+	 */
 	clockevents_calc_mult_shift(&time_event_device,
-				    clock_rate, S5PTIMER_MIN_RANGE);
+				    clock_rate, TCNT_MAX / clock_rate);
 	time_event_device.max_delta_ns =
-		clockevent_delta2ns(-1, &time_event_device);
+		clockevent_delta2ns(TCNT_MAX, &time_event_device);
 	time_event_device.min_delta_ns =
 		clockevent_delta2ns(1, &time_event_device);
 
@@ -0,0 +1,321 @@
+/* linux/arch/arm/plat-s5p/sysmmu-map.c
+ *
+ * Device address spaces on top of the System MMU
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * A map owns the page tables of one IP and a window of device addresses.
+ * Scattered pages are mapped at consecutive addresses of the window, so a
+ * buffer the IP sees as contiguous needs neither a carveout nor a high
+ * order allocation.
+ *
+ * Unmapping is lazy: the entries are cleared at once, but the window
+ * space is only reused after the TLB of the IP has been invalidated, one
+ * invalidation covering every buffer unmapped since the last. That is
+ * safe as long as the IP no longer touches a buffer once it is unmapped,
+ * which drivers have to guarantee anyway.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/err.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/genalloc.h>
+#include <linux/scatterlist.h>
+
+#include <asm/cacheflush.h>
+
+#include <plat/sysmmu.h>
+
+/* 16KB first level table of 1MB sections, 1KB second level of 4KB pages */
+#define LV1_ENTRIES		4096
+#define LV2_ENTRIES		256
+#define LV2_SIZE		(LV2_ENTRIES * sizeof(unsigned long))
+#define LV1_SHIFT		20
+
+#define LV1_INDEX(iova)		((iova) >> LV1_SHIFT)
+#define LV2_INDEX(iova)		(((iova) >> PAGE_SHIFT) & (LV2_ENTRIES - 1))
+
+#define LV1_PAGE_TABLE(pa)	(((pa) & ~0x3ffUL) | 0x1)
+#define LV2_SMALL_PAGE(pa)	(((pa) & PAGE_MASK) | 0x2)
+#define LV1_TO_LV2(ent)		((unsigned long *)phys_to_virt((ent) & ~0x3ffUL))
+
+/* Pages unmapped before the window space is given back in one batch */
+#define SYSMMU_MAP_LAZY_PAGES	1024
+
+struct s5p_sysmmu_map {
+	sysmmu_ips		ips;
+	unsigned long		*lv1;
+	struct gen_pool		*window;
+	spinlock_t		lock;
+
+	/* unmapped, waiting for a TLB invalidation to be reused */
+	unsigned long		lazy_pages;
+	unsigned long		*lazy;		/* iova | nr_pages pairs */
+	unsigned int		nr_lazy;
+};
+
+#define SYSMMU_MAP_LAZY_RANGES	64
+
+static struct kmem_cache *lv2_cache;
+
+static void pgtable_flush(void *start, void *end)
+{
+	dmac_flush_range(start, end);
+	outer_flush_range(virt_to_phys(start), virt_to_phys(end));
+}
+
+static unsigned long *lv2_entry(struct s5p_sysmmu_map *map,
+				unsigned long iova, gfp_t gfp)
+{
+	unsigned long *lv1 = &map->lv1[LV1_INDEX(iova)];
+	unsigned long *lv2;
+
+	if (!*lv1) {
+		lv2 = kmem_cache_zalloc(lv2_cache, gfp);
+		if (!lv2)
+			return NULL;
+		pgtable_flush(lv2, lv2 + LV2_ENTRIES);
+
+		*lv1 = LV1_PAGE_TABLE(virt_to_phys(lv2));
+		pgtable_flush(lv1, lv1 + 1);
+	}
+
+	return LV1_TO_LV2(*lv1) + LV2_INDEX(iova);
+}
+
+/* Gives back the window space of everything unmapped so far */
+static void sysmmu_map_sync(struct s5p_sysmmu_map *map)
+{
+	unsigned int i;
+
+	if (!map->nr_lazy)
+		return;
+
+	s5p_sysmmu_tlb_invalidate(map->ips);
+
+	for (i = 0; i < map->nr_lazy; i++)
+		gen_pool_free(map->window, map->lazy[2 * i],
+			      map->lazy[2 * i + 1] << PAGE_SHIFT);
+	map->nr_lazy = 0;
+	map->lazy_pages = 0;
+}
+
+struct s5p_sysmmu_map *s5p_sysmmu_map_create(sysmmu_ips ips,
+					     unsigned long base, size_t size)
+{
+	struct s5p_sysmmu_map *map;
+
+	/* 0 is what gen_pool_alloc() fails with */
+	if (!base || (base | size) & ~PAGE_MASK)
+		return ERR_PTR(-EINVAL);
+
+	map = kzalloc(sizeof(*map), GFP_KERNEL);
+	if (!map)
+		return ERR_PTR(-ENOMEM);
+
+	map->ips = ips;
+	spin_lock_init(&map->lock);
+
+	map->lv1 = (unsigned long *)__get_free_pages(GFP_KERNEL | __GFP_ZERO,
+						get_order(LV1_ENTRIES * 4));
+	if (!map->lv1)
+		goto err_lv1;
+	pgtable_flush(map->lv1, map->lv1 + LV1_ENTRIES);
+
+	map->lazy = kmalloc(2 * SYSMMU_MAP_LAZY_RANGES * sizeof(*map->lazy),
+			    GFP_KERNEL);
+	if (!map->lazy)
+		goto err_lazy;
+
+	map->window = gen_pool_create(PAGE_SHIFT, -1);
+	if (!map->window)
+		goto err_window;
+	if (gen_pool_add(map->window, base, size, -1))
+		goto err_add;
+
+	return map;
+
+err_add:
+	gen_pool_destroy(map->window);
+err_window:
+	kfree(map->lazy);
+err_lazy:
+	free_pages((unsigned long)map->lv1, get_order(LV1_ENTRIES * 4));
+err_lv1:
+	kfree(map);
+	return ERR_PTR(-ENOMEM);
+}
+EXPORT_SYMBOL(s5p_sysmmu_map_create);
+
+/* The IP must be disabled, and everything unmapped */
+void s5p_sysmmu_map_destroy(struct s5p_sysmmu_map *map)
+{
+	int i;
+
+	sysmmu_map_sync(map);
+
+	for (i = 0; i < LV1_ENTRIES; i++)
+		if (map->lv1[i])
+			kmem_cache_free(lv2_cache, LV1_TO_LV2(map->lv1[i]));
+
+	gen_pool_destroy(map->window);
+	kfree(map->lazy);
+	free_pages((unsigned long)map->lv1, get_order(LV1_ENTRIES * 4));
+	kfree(map);
+}
+EXPORT_SYMBOL(s5p_sysmmu_map_destroy);
+
+void s5p_sysmmu_map_enable(struct s5p_sysmmu_map *map)
+{
+	s5p_sysmmu_enable(map->ips, virt_to_phys(map->lv1));
+}
+EXPORT_SYMBOL(s5p_sysmmu_map_enable);
+
+static void sysmmu_map_clear(struct s5p_sysmmu_map *map, unsigned long iova,
+			     int nr_pages)
+{
+	unsigned long *ent, *first = NULL;
+
+	for (; nr_pages--; iova += PAGE_SIZE) {
+		ent = LV1_TO_LV2(map->lv1[LV1_INDEX(iova)]) + LV2_INDEX(iova);
+		if (!first)
+			first = ent;
+		*ent = 0;
+
+		/* the last entry of a second level table, or of the range */
+		if (!nr_pages || LV2_INDEX(iova) == LV2_ENTRIES - 1) {
+			pgtable_flush(first, ent + 1);
+			first = NULL;
+		}
+	}
+}
+
+static void sysmmu_map_free(struct s5p_sysmmu_map *map, unsigned long iova,
+			    int nr_pages)
+{
+	if (map->nr_lazy == SYSMMU_MAP_LAZY_RANGES)
+		sysmmu_map_sync(map);
+
+	map->lazy[2 * map->nr_lazy] = iova;
+	map->lazy[2 * map->nr_lazy + 1] = nr_pages;
+	map->nr_lazy++;
+
+	map->lazy_pages += nr_pages;
+	if (map->lazy_pages >= SYSMMU_MAP_LAZY_PAGES)
+		sysmmu_map_sync(map);
+}
+
+/*
+ * Maps nr_pages pages at consecutive device addresses, returning the
+ * first one, or 0 if the window or memory for tables ran out.
+ */
+dma_addr_t s5p_sysmmu_map_pages(struct s5p_sysmmu_map *map,
+				struct page **pages, int nr_pages)
+{
+	size_t size = nr_pages << PAGE_SHIFT;
+	unsigned long iova, addr, flags;
+	unsigned long *ent, *first = NULL;
+	int i;
+
+	spin_lock_irqsave(&map->lock, flags);
+
+	iova = gen_pool_alloc(map->window, size);
+	if (!iova) {
+		sysmmu_map_sync(map);
+		iova = gen_pool_alloc(map->window, size);
+		if (!iova)
+			goto out;
+	}
+
+	for (i = 0, addr = iova; i < nr_pages; i++, addr += PAGE_SIZE) {
+		ent = lv2_entry(map, addr, GFP_ATOMIC);
+		if (!ent) {
+			sysmmu_map_clear(map, iova, i);
+			gen_pool_free(map->window, iova, size);
+			iova = 0;
+			goto out;
+		}
+		if (!first)
+			first = ent;
+		*ent = LV2_SMALL_PAGE(page_to_phys(pages[i]));
+
+		if (i == nr_pages - 1 || LV2_INDEX(addr) == LV2_ENTRIES - 1) {
+			pgtable_flush(first, ent + 1);
+			first = NULL;
+		}
+	}
+out:
+	spin_unlock_irqrestore(&map->lock, flags);
+
+	return iova;
+}
+EXPORT_SYMBOL(s5p_sysmmu_map_pages);
+
+/* Maps the page aligned segments of sg one after another */
+dma_addr_t s5p_sysmmu_map_sg(struct s5p_sysmmu_map *map,
+			     struct scatterlist *sg, int nents)
+{
+	struct scatterlist *s;
+	struct page **pages;
+	dma_addr_t iova;
+	int i, j, nr_pages = 0;
+
+	for_each_sg(sg, s, nents, i) {
+		if ((s->offset | s->length) & ~PAGE_MASK)
+			return 0;
+		nr_pages += s->length >> PAGE_SHIFT;
+	}
+
+	pages = kmalloc(nr_pages * sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return 0;
+
+	nr_pages = 0;
+	for_each_sg(sg, s, nents, i)
+		for (j = 0; j < s->length >> PAGE_SHIFT; j++)
+			pages[nr_pages++] = nth_page(sg_page(s), j);
+
+	iova = s5p_sysmmu_map_pages(map, pages, nr_pages);
+	kfree(pages);
+
+	return iova;
+}
+EXPORT_SYMBOL(s5p_sysmmu_map_sg);
+
+void s5p_sysmmu_unmap(struct s5p_sysmmu_map *map, dma_addr_t iova,
+		      int nr_pages)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&map->lock, flags);
+	sysmmu_map_clear(map, iova, nr_pages);
+	sysmmu_map_free(map, iova, nr_pages);
+	spin_unlock_irqrestore(&map->lock, flags);
+}
+EXPORT_SYMBOL(s5p_sysmmu_unmap);
+
+/* For a driver about to reuse pages it unmapped: drop the stale TLB entries */
+void s5p_sysmmu_map_flush(struct s5p_sysmmu_map *map)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&map->lock, flags);
+	sysmmu_map_sync(map);
+	spin_unlock_irqrestore(&map->lock, flags);
+}
+EXPORT_SYMBOL(s5p_sysmmu_map_flush);
+
+static int __init s5p_sysmmu_map_init(void)
+{
+	/* second level tables are aligned to their size */
+	lv2_cache = kmem_cache_create("sysmmu-lv2", LV2_SIZE, LV2_SIZE,
+				      SLAB_PANIC, NULL);
+
+	return 0;
+}
+arch_initcall(s5p_sysmmu_map_init);
@@ -41,6 +41,8 @@
 #include <linux/io.h>
 #if defined(CONFIG_DEBUG_FS)
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
 #endif
 
 #include <mach/hardware.h>
@@ -150,6 +152,22 @@ void clk_put(struct clk *clk)
 	module_put(clk->owner);
 }
 
+#if defined(CONFIG_DEBUG_FS)
+static inline void clk_account_on(struct clk *clk)
+{
+	clk->enables++;
+	clk->on_since = sched_clock();
+}
+
+static inline void clk_account_off(struct clk *clk)
+{
+	clk->on_time += sched_clock() - clk->on_since;
+}
+#else
+static inline void clk_account_on(struct clk *clk) { }
+static inline void clk_account_off(struct clk *clk) { }
+#endif
+
 void _clk_enable(struct clk *clk)
 {
 	if (!clk || IS_ERR(clk))
@@ -162,6 +180,7 @@ void _clk_enable(struct clk *clk)
 	pr_debug("%s update hardware clock %s %d %pS\n",
 		 __func__, clk->name, clk->id, clk->dev);
 	(clk->enable)(clk, 1);
+	clk_account_on(clk);
 }
 
 int clk_enable(struct clk *clk)
@@ -191,6 +210,7 @@ void _clk_disable(struct clk *clk)
 	pr_debug("%s update hardware clock  %s %d %pS\n",
 		 __func__, clk->name, clk->id, clk->dev);
 	(clk->enable)(clk, 0);
+	clk_account_off(clk);
 	_clk_disable(clk->parent);
 }
 
@@ -478,6 +498,40 @@ void __init s3c_disable_clocks(struct clk *clkp, int nr_clks)
 		(clkp->enable)(clkp, 0);
 }
 
+static int clk_gate_unused;
+
+static int __init clk_gate_unused_setup(char *str)
+{
+	clk_gate_unused = 1;
+	return 1;
+}
+__setup("clk_gate_unused", clk_gate_unused_setup);
+
+/**
+ * s3c_disable_unused_clocks() - report or gate clocks nobody has enabled
+ * @clkp: Pointer to the first clock in the array.
+ * @nr_clks: Number of clocks in the array.
+ *
+ * For the clocks of @clkp the boot loader left running: once drivers are
+ * up, as a late initcall, those with no user are listed, and gated if
+ * "clk_gate_unused" is on the command line. A driver using a clock it
+ * never enabled shows up in the list before it breaks with the option.
+ */
+void __init s3c_disable_unused_clocks(struct clk *clkp, int nr_clks)
+{
+	spin_lock(&clocks_lock);
+	for (; nr_clks > 0; nr_clks--, clkp++) {
+		if (clkp->usage)
+			continue;
+
+		printk(KERN_INFO "clock: %s:%d unused%s\n", clkp->name, clkp->id,
+		       clk_gate_unused ? ", gating" : "");
+		if (clk_gate_unused)
+			(clkp->enable)(clkp, 0);
+	}
+	spin_unlock(&clocks_lock);
+}
+
 /* initialise all the clocks */
 
 int __init s3c24xx_register_baseclocks(unsigned long xtal)
@@ -615,3 +669,56 @@ err_out:
 late_initcall(clk_debugfs_init);
 
 #endif /* defined(CONFIG_PM_DEBUG) && defined(CONFIG_DEBUG_FS) */
+
+#if defined(CONFIG_DEBUG_FS)
+/*
+ * One line per clock: users now, times gated on and total time on in ms,
+ * the current stretch included. Clocks left on by the boot loader count
+ * from the first clk_enable() only.
+ */
+static int clk_summary_show(struct seq_file *s, void *unused)
+{
+	struct clk *c;
+	u64 now, on;
+
+	seq_printf(s, "%-24s %5s %8s %12s  %s\n",
+		   "clock", "users", "enables", "on_ms", "parent");
+
+	spin_lock(&clocks_lock);
+	now = sched_clock();
+	list_for_each_entry(c, &clocks, list) {
+		on = c->on_time;
+		if (c->usage)
+			on += now - c->on_since;
+		do_div(on, NSEC_PER_MSEC);
+
+		seq_printf(s, "%-21s:%-2d %5d %8lu %12llu  %s\n",
+			   c->name, c->id, c->usage, c->enables,
+			   (unsigned long long)on,
+			   c->parent ? c->parent->name : "-");
+	}
+	spin_unlock(&clocks_lock);
+
+	return 0;
+}
+
+static int clk_summary_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, clk_summary_show, NULL);
+}
+
+static const struct file_operations clk_summary_fops = {
+	.open		= clk_summary_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init clk_summary_init(void)
+{
+	debugfs_create_file("clock_summary", S_IRUGO, NULL, NULL,
+			    &clk_summary_fops);
+	return 0;
+}
+late_initcall(clk_summary_init);
+#endif /* defined(CONFIG_DEBUG_FS) */
@@ -51,6 +51,11 @@ struct clk {
 #if defined(CONFIG_PM_DEBUG) && defined(CONFIG_DEBUG_FS)
 	struct dentry		*dent;	/* For visible tree hierarchy */
 #endif
+#if defined(CONFIG_DEBUG_FS)
+	unsigned long		enables;	/* Times gated on */
+	u64			on_time;	/* ns on, up to the last gating off */
+	u64			on_since;	/* sched_clock() when gated on */
+#endif
 };
 
 /* other clocks which may be registered by board support */
@@ -97,6 +102,7 @@ extern int s3c24xx_register_clocks(struct clk **clk, int nr_clks);
 
 extern void s3c_register_clocks(struct clk *clk, int nr_clks);
 extern void s3c_disable_clocks(struct clk *clkp, int nr_clks);
+extern void s3c_disable_unused_clocks(struct clk *clkp, int nr_clks);
 
 extern int s3c24xx_register_baseclocks(unsigned long xtal);
 
@@ -177,6 +177,9 @@ extern struct platform_device s3c_device_usb_otghcd;
 extern struct platform_device s3c_device_usb_dwcotg;
 #endif
 extern struct platform_device s5p_device_rotator;
+#if defined(CONFIG_CRYPTO_DEV_S5P) || defined(CONFIG_CRYPTO_DEV_S5P_MODULE)
+extern struct platform_device s5p_device_sss;
+#endif
 extern struct platform_device s5p_device_tvout;
 extern struct platform_device s5p_device_g3d;
 
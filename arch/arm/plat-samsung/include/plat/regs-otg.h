@@ -255,6 +255,8 @@
 /* DEPTSIZ common bit */
 #define DEPTSIZ_PKT_CNT_BIT 		(19)
 #define DEPTSIZ_XFER_SIZE_BIT		(0)
+#define DEPTSIZ_PKT_CNT_MAX		(0x3ff)		/* EP1-15 */
+#define DEPTSIZ_XFER_SIZE_MASK		(0x7ffff)	/* EP1-15 */
 
 #define	DEPTSIZ_SETUP_PKCNT_1		(1<<29)
 #define	DEPTSIZ_SETUP_PKCNT_2		(2<<29)
@@ -103,4 +103,20 @@ static inline bool s3c_dma_has_circular(void)
 
 #include <plat/dma.h>
 
+struct scatterlist;
+
+/*
+ * Segments s3c2410_dma_enqueue_sg() chains in one request. Each takes up
+ * to 40 bytes of the 256 of microcode a request has, for segments under
+ * 64K bursts.
+ */
+#define S3C_PL330_MAX_CHAIN	6
+
+extern int s3c2410_dma_enqueue_sg(enum dma_ch channel, void *id,
+				  struct scatterlist *sg, int nents);
+
+extern int s3c2410_dma_enqueue_cyclic(enum dma_ch channel, void *id,
+				      dma_addr_t data, int period,
+				      int periods);
+
 #endif	/* __S3C_DMA_PL330_H_ */
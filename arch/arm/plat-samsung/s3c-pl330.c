@@ -17,6 +17,7 @@
 #include <linux/platform_device.h>
 #include <linux/clk.h>
 #include <linux/err.h>
+#include <linux/scatterlist.h>
 
 #include <asm/hardware/pl330.h>
 
@@ -45,12 +46,14 @@ struct s3c_pl330_dmac {
  * @token: Xfer ID provided by the client.
  * @node: To attach to the list of xfers on a channel.
  * @px: Xfer for PL330 core.
+ * @chain: Xfers following px in the same request, NULL if none.
  * @chan: Owner channel of this xfer.
  */
 struct s3c_pl330_xfer {
 	void			*token;
 	struct list_head	node;
 	struct pl330_xfer	px;
+	struct pl330_xfer	*chain;
 	struct s3c_pl330_chan	*chan;
 };
 
@@ -406,19 +409,25 @@ static inline void _finish_off(struct s3c_pl330_xfer *xfer,
 		enum s3c2410_dma_buffresult res, int ffree)
 {
 	struct s3c_pl330_chan *ch;
+	struct pl330_xfer *x;
+	int bytes = 0;
 
 	if (!xfer)
 		return;
 
 	ch = xfer->chan;
 
-	/* Do callback */
+	/* Do callback, once for the whole chain */
+	for (x = &xfer->px; x; x = x->next)
+		bytes += x->bytes;
 	if (ch->callback_fn)
-		ch->callback_fn(NULL, xfer->token, xfer->px.bytes, res);
+		ch->callback_fn(NULL, xfer->token, bytes, res);
 
 	/* Force Free or if buffer is not needed anymore */
-	if (ffree || !(ch->options & S3C2410_DMAF_CIRCULAR))
+	if (ffree || !(ch->options & S3C2410_DMAF_CIRCULAR)) {
+		kfree(xfer->chain);
 		kmem_cache_free(ch->dmac->kmcache, xfer);
+	}
 }
 
 static inline int s3c_pl330_submit(struct s3c_pl330_chan *ch,
@@ -439,7 +448,7 @@ static inline int s3c_pl330_submit(struct s3c_pl330_chan *ch,
 		if (r->rqtype == MEMTOMEM) {
 			struct pl330_info *pi = xfer->chan->dmac->pi;
 			int burst = 1 << ch->rqcfg.brst_size;
-			u32 bytes = r->x->bytes;
+			struct pl330_xfer *x;
 			int bl;
 
 			bl = pi->pcfg.data_bus_width / 8;
@@ -450,8 +459,12 @@ static inline int s3c_pl330_submit(struct s3c_pl330_chan *ch,
 			if (bl > 16)
 				bl = 16;
 
+			/* Every xfer of a chain is done at the same length */
 			while (bl > 1) {
-				if (!(bytes % (bl * burst)))
+				for (x = r->x; x; x = x->next)
+					if (x->bytes % (bl * burst))
+						break;
+				if (!x)
 					break;
 				bl--;
 			}
@@ -732,13 +745,63 @@ enq_exit:
 }
 #endif
 
+/* Error if size is unaligned */
+static inline bool xfer_unaligned(struct s3c_pl330_chan *ch, int size)
+{
+	return ch->rqcfg.brst_size && size % (1 << ch->rqcfg.brst_size);
+}
+
+static void xfer_set_addr(struct s3c_pl330_chan *ch, struct pl330_xfer *x,
+		dma_addr_t addr, int size)
+{
+	x->bytes = size;
+	x->next = NULL;
+
+	/* For S3C DMA API, direction is always fixed for all xfers */
+	if (ch->req[0].rqtype == MEMTODEV) {
+		x->src_addr = addr;
+		x->dst_addr = ch->sdaddr;
+	} else {
+		x->src_addr = ch->sdaddr;
+		x->dst_addr = addr;
+	}
+}
+
+static struct s3c_pl330_xfer *xfer_alloc(struct s3c_pl330_chan *ch,
+		void *token, dma_addr_t addr, int size)
+{
+	struct s3c_pl330_xfer *xfer;
+
+	xfer = kmem_cache_alloc(ch->dmac->kmcache, GFP_ATOMIC);
+	if (!xfer)
+		return NULL;
+
+	xfer->token = token;
+	xfer->chan = ch;
+	xfer->chain = NULL; /* Single request */
+	xfer_set_addr(ch, &xfer->px, addr, size);
+
+	return xfer;
+}
+
+/* Try submitting on either request */
+static void s3c_pl330_kick(struct s3c_pl330_chan *ch)
+{
+	int idx = (ch->lrq == &ch->req[0]) ? 1 : 0;
+
+	if (!ch->req[idx].x)
+		s3c_pl330_submit(ch, &ch->req[idx]);
+	else
+		s3c_pl330_submit(ch, &ch->req[1 - idx]);
+}
+
 int s3c2410_dma_enqueue(enum dma_ch id, void *token,
 			dma_addr_t addr, int size)
 {
 	struct s3c_pl330_chan *ch;
 	struct s3c_pl330_xfer *xfer;
 	unsigned long flags;
-	int idx, ret = 0;
+	int ret = 0;
 
 	spin_lock_irqsave(&res_lock, flags);
 
@@ -750,41 +813,162 @@ int s3c2410_dma_enqueue(enum dma_ch id, void *token,
 		goto enq_exit;
 	}
 
-	/* Error if size is unaligned */
-	if (ch->rqcfg.brst_size && size % (1 << ch->rqcfg.brst_size)) {
+	if (xfer_unaligned(ch, size)) {
 		ret = -EINVAL;
 		goto enq_exit;
 	}
 
-	xfer = kmem_cache_alloc(ch->dmac->kmcache, GFP_ATOMIC);
+	xfer = xfer_alloc(ch, token, addr, size);
 	if (!xfer) {
 		ret = -ENOMEM;
 		goto enq_exit;
 	}
 
-	xfer->token = token;
-	xfer->chan = ch;
-	xfer->px.bytes = size;
-	xfer->px.next = NULL; /* Single request */
+	add_to_queue(ch, xfer, 0);
+	s3c_pl330_kick(ch);
 
-	/* For S3C DMA API, direction is always fixed for all xfers */
-	if (ch->req[0].rqtype == MEMTODEV) {
-		xfer->px.src_addr = addr;
-		xfer->px.dst_addr = ch->sdaddr;
-	} else {
-		xfer->px.src_addr = ch->sdaddr;
-		xfer->px.dst_addr = addr;
+	spin_unlock_irqrestore(&res_lock, flags);
+
+	if (ch->options & S3C2410_DMAF_AUTOSTART)
+		s3c2410_dma_ctrl(id, S3C2410_DMAOP_START);
+
+	return 0;
+
+enq_exit:
+	spin_unlock_irqrestore(&res_lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL(s3c2410_dma_enqueue);
+
+/*
+ * The segments of sg become a single request to the PL330 core: they
+ * are done back to back by the channel thread and complete with one
+ * interrupt and one callback, for the total size, with token.
+ */
+int s3c2410_dma_enqueue_sg(enum dma_ch id, void *token,
+			   struct scatterlist *sg, int nents)
+{
+	struct s3c_pl330_chan *ch;
+	struct s3c_pl330_xfer *xfer;
+	struct pl330_xfer *x;
+	struct scatterlist *s;
+	unsigned long flags;
+	int i, ret = 0;
+
+	if (nents < 1 || nents > S3C_PL330_MAX_CHAIN)
+		return -EINVAL;
+
+	spin_lock_irqsave(&res_lock, flags);
+
+	ch = id_to_chan(id);
+
+	/* Error if invalid or free channel */
+	if (!ch || chan_free(ch)) {
+		ret = -EINVAL;
+		goto enq_exit;
+	}
+
+	for_each_sg(sg, s, nents, i)
+		if (xfer_unaligned(ch, sg_dma_len(s))) {
+			ret = -EINVAL;
+			goto enq_exit;
+		}
+
+	xfer = xfer_alloc(ch, token, sg_dma_address(sg), sg_dma_len(sg));
+	if (!xfer) {
+		ret = -ENOMEM;
+		goto enq_exit;
+	}
+
+	if (nents > 1) {
+		xfer->chain = kmalloc((nents - 1) * sizeof(*xfer->chain),
+				GFP_ATOMIC);
+		if (!xfer->chain) {
+			kmem_cache_free(ch->dmac->kmcache, xfer);
+			ret = -ENOMEM;
+			goto enq_exit;
+		}
+
+		x = &xfer->px;
+		for_each_sg(sg_next(sg), s, nents - 1, i) {
+			x->next = &xfer->chain[i];
+			x = x->next;
+			xfer_set_addr(ch, x, sg_dma_address(s), sg_dma_len(s));
+		}
 	}
 
 	add_to_queue(ch, xfer, 0);
+	s3c_pl330_kick(ch);
 
-	/* Try submitting on either request */
-	idx = (ch->lrq == &ch->req[0]) ? 1 : 0;
+	spin_unlock_irqrestore(&res_lock, flags);
 
-	if (!ch->req[idx].x)
-		s3c_pl330_submit(ch, &ch->req[idx]);
-	else
-		s3c_pl330_submit(ch, &ch->req[1 - idx]);
+	if (ch->options & S3C2410_DMAF_AUTOSTART)
+		s3c2410_dma_ctrl(id, S3C2410_DMAOP_START);
+
+	return 0;
+
+enq_exit:
+	spin_unlock_irqrestore(&res_lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL(s3c2410_dma_enqueue_sg);
+
+/*
+ * Queues the periods of a ring buffer in one go and makes the channel
+ * CIRCULAR, so they are redone until the channel is flushed, with a
+ * callback for each, without the client enqueueing them again.
+ */
+int s3c2410_dma_enqueue_cyclic(enum dma_ch id, void *token,
+			       dma_addr_t addr, int period, int periods)
+{
+	struct s3c_pl330_chan *ch;
+	struct s3c_pl330_xfer *xfer, *t;
+	unsigned long flags;
+	LIST_HEAD(ring);
+	int i, ret = 0;
+
+	if (period <= 0 || periods < 2)
+		return -EINVAL;
+
+	spin_lock_irqsave(&res_lock, flags);
+
+	ch = id_to_chan(id);
+
+	/* Error if invalid or free channel, or already queued */
+	if (!ch || chan_free(ch) || ch->xfer_head) {
+		ret = -EINVAL;
+		goto enq_exit;
+	}
+
+	if (xfer_unaligned(ch, period)) {
+		ret = -EINVAL;
+		goto enq_exit;
+	}
+
+	/* All or nothing */
+	for (i = 0; i < periods; i++) {
+		xfer = xfer_alloc(ch, token, addr + i * period, period);
+		if (!xfer) {
+			list_for_each_entry_safe(xfer, t, &ring, node)
+				kmem_cache_free(ch->dmac->kmcache, xfer);
+			ret = -ENOMEM;
+			goto enq_exit;
+		}
+		list_add_tail(&xfer->node, &ring);
+	}
+
+	ch->options |= S3C2410_DMAF_CIRCULAR;
+
+	list_for_each_entry_safe(xfer, t, &ring, node) {
+		list_del(&xfer->node);
+		add_to_queue(ch, xfer, 0);
+	}
+
+	/* Both requests of the channel get a period */
+	s3c_pl330_kick(ch);
+	s3c_pl330_kick(ch);
 
 	spin_unlock_irqrestore(&res_lock, flags);
 
@@ -798,7 +982,7 @@ enq_exit:
 
 	return ret;
 }
-EXPORT_SYMBOL(s3c2410_dma_enqueue);
+EXPORT_SYMBOL(s3c2410_dma_enqueue_cyclic);
 
 int s3c2410_dma_request(enum dma_ch id,
 			struct s3c2410_dma_client *client,
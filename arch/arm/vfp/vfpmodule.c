@@ -17,8 +17,10 @@
 #include <linux/sched.h>
 #include <linux/smp.h>
 #include <linux/init.h>
+#include <linux/hardirq.h>
 
 #include <asm/cputype.h>
+#include <asm/neon.h>
 #include <asm/thread_notify.h>
 #include <asm/vfp.h>
 
@@ -406,14 +408,17 @@ static void vfp_enable(void *unused)
 #ifdef CONFIG_PM
 #include <linux/syscore_ops.h>
 
-static int vfp_pm_suspend(void)
+/*
+ * Save and drop the hardware VFP state before the core loses power, for
+ * suspend or deep idle. Called with irqs off.
+ */
+void vfp_pm_save_context(void)
 {
 	struct thread_info *ti = current_thread_info();
 	u32 fpexc = fmrx(FPEXC);
 
 	/* if vfp is on, then save state for resumption */
 	if (fpexc & FPEXC_EN) {
-		printk(KERN_DEBUG "%s: saving vfp state\n", __func__);
 		vfp_save_state(&ti->vfpstate, fpexc);
 
 		/* disable, just in case */
@@ -428,11 +433,9 @@ static int vfp_pm_suspend(void)
 
 	/* clear any information we had about last context state */
 	vfp_current_hw_state[ti->cpu] = NULL;
-
-	return 0;
 }
 
-static void vfp_pm_resume(void)
+void vfp_pm_restore_context(void)
 {
 	/* ensure we have access to the vfp */
 	vfp_enable(NULL);
@@ -441,6 +444,17 @@ static void vfp_pm_resume(void)
 	fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
 }
 
+static int vfp_pm_suspend(void)
+{
+	vfp_pm_save_context();
+	return 0;
+}
+
+static void vfp_pm_resume(void)
+{
+	vfp_pm_restore_context();
+}
+
 static struct syscore_ops vfp_pm_syscore_ops = {
 	.suspend	= vfp_pm_suspend,
 	.resume		= vfp_pm_resume,
@@ -477,6 +491,50 @@ void vfp_sync_hwstate(struct thread_info *thread)
 	put_cpu();
 }
 
+#ifdef CONFIG_KERNEL_MODE_NEON
+
+/*
+ * Save the VFP state of its owner, if any, so kernel mode NEON can use
+ * the register file. The owner reloads its state on its next VFP
+ * instruction, since the hardware context is left invalid.
+ */
+void kernel_neon_begin(void)
+{
+#ifdef CONFIG_SMP
+	struct thread_info *thread = current_thread_info();
+#endif
+	unsigned int cpu;
+	u32 fpexc;
+
+	BUG_ON(in_interrupt());
+	cpu = get_cpu();
+
+	fpexc = fmrx(FPEXC) | FPEXC_EN;
+	fmxr(FPEXC, fpexc);
+
+#ifdef CONFIG_SMP
+	/* Other threads had their state saved when they were switched out */
+	if (vfp_current_hw_state[cpu] == &thread->vfpstate &&
+	    thread->vfpstate.hard.cpu == cpu)
+		vfp_save_state(&thread->vfpstate, fpexc);
+#else
+	if (vfp_current_hw_state[cpu])
+		vfp_save_state(vfp_current_hw_state[cpu], fpexc);
+#endif
+	vfp_current_hw_state[cpu] = NULL;
+}
+EXPORT_SYMBOL(kernel_neon_begin);
+
+void kernel_neon_end(void)
+{
+	/* Disable the VFP so the next user traps and reloads its state */
+	fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
+	put_cpu();
+}
+EXPORT_SYMBOL(kernel_neon_end);
+
+#endif /* CONFIG_KERNEL_MODE_NEON */
+
 void vfp_flush_hwstate(struct thread_info *thread)
 {
 	unsigned int cpu = get_cpu();
@@ -490,6 +490,16 @@ static int bfqq_process_refs(struct bfq_queue *bfqq)
 	return process_refs;
 }
 
+/* Must be called with bfqq != NULL */
+static inline void bfq_bfqq_end_raising(struct bfq_queue *bfqq)
+{
+	BUG_ON(bfqq == NULL);
+	bfqq->raising_coeff = 1;
+	bfqq->raising_cur_max_time = 0;
+	/* Trigger a weight change on the next activation of the queue */
+	bfqq->entity.ioprio_changed = 1;
+}
+
 static void bfq_add_rq_rb(struct request *rq)
 {
 	struct bfq_queue *bfqq = RQ_BFQQ(rq);
@@ -531,6 +541,7 @@ static void bfq_add_rq_rb(struct request *rq)
 	if (!bfq_bfqq_busy(bfqq)) {
 		int soft_rt = bfqd->bfq_raising_max_softrt_rate > 0 &&
 			bfqq->soft_rt_next_start < jiffies;
+		int fg_idle = 0;
 		entity->budget = max_t(unsigned long, bfqq->max_budget,
 				       bfq_serv_to_charge(next_rq, bfqq));
 
@@ -540,6 +551,28 @@ static void bfq_add_rq_rb(struct request *rq)
 		if (bfq_bfqq_just_split(bfqq))
 			goto set_ioprio_changed;
 
+		/*
+		 * With bfq_raising_fg, the sync queue of a background process
+		 * is never raised and loses its raising as soon as it turns
+		 * busy again, while the one of a foreground process only has
+		 * to idle for bfq_raising_fg_min_idle_time to be treated as
+		 * interactive.
+		 */
+		if (bfqd->bfq_raising_fg && bfq_bfqq_sync(bfqq)) {
+			if (bfq_bfqq_background(bfqq)) {
+				if (old_raising_coeff > 1)
+					bfq_bfqq_end_raising(bfqq);
+				else if (idle_for_long_time || soft_rt)
+					bfqd->raising_stats
+						[BFQ_RAISING_BG_DENIED]++;
+				goto add_bfqq_busy;
+			}
+			fg_idle = !idle_for_long_time &&
+				bfqq->budget_timeout +
+				bfqd->bfq_raising_fg_min_idle_time < jiffies;
+			idle_for_long_time |= fg_idle;
+		}
+
 		/*
 		 * If the queue:
 		 * - is not being boosted,
@@ -558,6 +591,12 @@ static void bfq_add_rq_rb(struct request *rq)
 			else
 				bfqq->raising_cur_max_time =
 					bfqd->bfq_raising_rt_max_time;
+			if (fg_idle)
+				bfqd->raising_stats[BFQ_RAISING_FOREGROUND]++;
+			else if (idle_for_long_time)
+				bfqd->raising_stats[BFQ_RAISING_INTERACTIVE]++;
+			else
+				bfqd->raising_stats[BFQ_RAISING_SOFT_RT]++;
 			bfq_log_bfqq(bfqd, bfqq,
 				     "wrais starting at %llu msec,"
 				     "rais_max_time %u",
@@ -592,6 +631,7 @@ add_bfqq_busy:
                         bfqd->bfq_raising_min_inter_arr_async < jiffies) {
                         bfqq->raising_coeff = bfqd->bfq_raising_coeff;
 			bfqq->raising_cur_max_time = bfq_wrais_duration(bfqd);
+			bfqd->raising_stats[BFQ_RAISING_ASYNC]++;
 
 			entity->ioprio_changed = 1;
 			bfq_log_bfqq(bfqd, bfqq,
@@ -733,16 +773,6 @@ static void bfq_merged_requests(struct request_queue *q, struct request *rq,
 	bfq_remove_request(next);
 }
 
-/* Must be called with bfqq != NULL */
-static inline void bfq_bfqq_end_raising(struct bfq_queue *bfqq)
-{
-	BUG_ON(bfqq == NULL);
-	bfqq->raising_coeff = 1;
-	bfqq->raising_cur_max_time = 0;
-	/* Trigger a weight change on the next activation of the queue */
-	bfqq->entity.ioprio_changed = 1;
-}
-
 static void bfq_end_raising_async_queues(struct bfq_data *bfqd,
 					struct bfq_group *bfqg)
 {
@@ -2744,6 +2774,27 @@ bfq_split_bfqq(struct cfq_io_context *cic, struct bfq_queue *bfqq)
 /*
  * Allocate bfq data structures associated with this request.
  */
+/*
+ * Android runs background processes either in a cpu cgroup of their own,
+ * or as SCHED_BATCH when the kernel has no cpu cgroups (as with BFS),
+ * and leaves the foreground ones in the root group as SCHED_NORMAL.
+ */
+static bool bfq_task_background(struct task_struct *p)
+{
+	bool background = p->policy == SCHED_BATCH || p->policy == SCHED_IDLE;
+
+#ifdef CONFIG_CGROUP_SCHED
+	if (!background) {
+		rcu_read_lock();
+		background = task_subsys_state(p, cpu_cgroup_subsys_id)->
+			cgroup->parent != NULL;
+		rcu_read_unlock();
+	}
+#endif
+
+	return background;
+}
+
 static int bfq_set_request(struct request_queue *q, struct request *rq,
 			   gfp_t gfp_mask)
 {
@@ -2785,6 +2836,14 @@ new_queue:
 		}
 	}
 
+	/* Sync requests are allocated by the process issuing them */
+	if (is_sync) {
+		if (bfq_task_background(current))
+			bfq_mark_bfqq_background(bfqq);
+		else
+			bfq_clear_bfqq_background(bfqq);
+	}
+
 	bfqq->allocated[rw]++;
 	atomic_inc(&bfqq->ref);
 	bfq_log_bfqq(bfqd, bfqq, "set_request: bfqq %p, %d", bfqq,
@@ -3057,6 +3116,8 @@ static void *bfq_init_queue(struct request_queue *q)
 	bfqd->bfq_raising_min_idle_time = msecs_to_jiffies(2000);
 	bfqd->bfq_raising_min_inter_arr_async = msecs_to_jiffies(500);
 	bfqd->bfq_raising_max_softrt_rate = 7000;
+	bfqd->bfq_raising_fg = true;
+	bfqd->bfq_raising_fg_min_idle_time = msecs_to_jiffies(500);
 
 	/* Initially estimate the device's peak rate as the reference rate */
 	if (blk_queue_nonrot(bfqd->queue)) {
@@ -3155,6 +3216,47 @@ static ssize_t bfq_weights_show(struct elevator_queue *e, char *page)
 	return num_char;
 }
 
+static ssize_t bfq_raising_stats_show(struct elevator_queue *e, char *page)
+{
+	struct bfq_data *bfqd = e->elevator_data;
+	unsigned long stats[BFQ_RAISING_STATS];
+	struct bfq_queue *bfqq;
+	int raised = 0;
+
+	spin_lock_irq(bfqd->queue->queue_lock);
+	memcpy(stats, bfqd->raising_stats, sizeof(stats));
+	list_for_each_entry(bfqq, &bfqd->active_list, bfqq_list)
+		if (bfqq->raising_coeff > 1)
+			raised++;
+	spin_unlock_irq(bfqd->queue->queue_lock);
+
+	return sprintf(page,
+		       "interactive %lu\n"
+		       "foreground %lu\n"
+		       "soft_rt %lu\n"
+		       "async %lu\n"
+		       "background_denied %lu\n"
+		       "raised_active %d\n",
+		       stats[BFQ_RAISING_INTERACTIVE],
+		       stats[BFQ_RAISING_FOREGROUND],
+		       stats[BFQ_RAISING_SOFT_RT],
+		       stats[BFQ_RAISING_ASYNC],
+		       stats[BFQ_RAISING_BG_DENIED], raised);
+}
+
+/* Any write clears the statistics */
+static ssize_t bfq_raising_stats_store(struct elevator_queue *e,
+				       const char *page, size_t count)
+{
+	struct bfq_data *bfqd = e->elevator_data;
+
+	spin_lock_irq(bfqd->queue->queue_lock);
+	memset(bfqd->raising_stats, 0, sizeof(bfqd->raising_stats));
+	spin_unlock_irq(bfqd->queue->queue_lock);
+
+	return count;
+}
+
 #define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
 static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
 {									\
@@ -3184,6 +3286,9 @@ SHOW_FUNCTION(bfq_raising_min_inter_arr_async_show,
 	      1);
 SHOW_FUNCTION(bfq_raising_max_softrt_rate_show,
 	bfqd->bfq_raising_max_softrt_rate, 0);
+SHOW_FUNCTION(bfq_raising_fg_show, bfqd->bfq_raising_fg, 0);
+SHOW_FUNCTION(bfq_raising_fg_min_idle_time_show,
+	bfqd->bfq_raising_fg_min_idle_time, 1);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
@@ -3228,6 +3333,9 @@ STORE_FUNCTION(bfq_raising_min_inter_arr_async_store,
 	       &bfqd->bfq_raising_min_inter_arr_async, 0, INT_MAX, 1);
 STORE_FUNCTION(bfq_raising_max_softrt_rate_store,
 	       &bfqd->bfq_raising_max_softrt_rate, 0, INT_MAX, 0);
+STORE_FUNCTION(bfq_raising_fg_store, &bfqd->bfq_raising_fg, 0, 1, 0);
+STORE_FUNCTION(bfq_raising_fg_min_idle_time_store,
+	       &bfqd->bfq_raising_fg_min_idle_time, 0, INT_MAX, 1);
 #undef STORE_FUNCTION
 
 /* do nothing for the moment */
@@ -3323,6 +3431,9 @@ static struct elv_fs_entry bfq_attrs[] = {
 	BFQ_ATTR(raising_min_idle_time),
 	BFQ_ATTR(raising_min_inter_arr_async),
 	BFQ_ATTR(raising_max_softrt_rate),
+	BFQ_ATTR(raising_fg),
+	BFQ_ATTR(raising_fg_min_idle_time),
+	BFQ_ATTR(raising_stats),
 	BFQ_ATTR(weights),
 	__ATTR_NULL
 };
@@ -244,6 +244,16 @@ struct bfq_queue {
 	struct cfq_io_context *cic;
 };
 
+/* Causes of weight raising, counted in bfq_data->raising_stats */
+enum bfq_raising_stat {
+	BFQ_RAISING_INTERACTIVE,	/* sync queue idle for long */
+	BFQ_RAISING_FOREGROUND,		/* foreground queue idle for a while */
+	BFQ_RAISING_SOFT_RT,
+	BFQ_RAISING_ASYNC,
+	BFQ_RAISING_BG_DENIED,		/* background queue not raised */
+	BFQ_RAISING_STATS,
+};
+
 /**
  * struct bfq_data - per device data structure.
  * @queue: request queue for the managed device.
@@ -307,6 +317,13 @@ struct bfq_queue {
  *                                   (in jiffies)
  * @bfq_raising_max_softrt_rate: max service-rate for a soft real-time queue,
  *			         sectors per seconds
+ * @bfq_raising_fg: tell the sync queues of foreground and background
+ *                  processes apart for weight raising
+ * @bfq_raising_fg_min_idle_time: minimum idle period after which weight
+ *                                raising may be reactivated for the sync
+ *                                queue of a foreground process (jiffies)
+ * @raising_stats: number of weight-raising periods started, by cause, and
+ *                 of the ones denied to background processes
  * @RT_prod: cached value of the product R*T used for computing the maximum
  * 	     duration of the weight raising automatically
  * @oom_bfqq: fallback dummy bfqq for extreme OOM conditions
@@ -372,8 +389,12 @@ struct bfq_data {
 	unsigned int bfq_raising_min_idle_time;
 	unsigned int bfq_raising_min_inter_arr_async;
 	unsigned int bfq_raising_max_softrt_rate;
+	bool bfq_raising_fg;
+	unsigned int bfq_raising_fg_min_idle_time;
 	u64 RT_prod;
 
+	unsigned long raising_stats[BFQ_RAISING_STATS];
+
 	struct bfq_queue oom_bfqq;
 };
 
@@ -390,6 +411,7 @@ enum bfqq_state_flags {
 	BFQ_BFQQ_FLAG_split_coop,	/* shared bfqq will be splitted */
 	BFQ_BFQQ_FLAG_some_coop_idle,   /* some cooperator is inactive */
 	BFQ_BFQQ_FLAG_just_split,	/* queue has just been split */
+	BFQ_BFQQ_FLAG_background,	/* owner runs in the background */
 };
 
 #define BFQ_BFQQ_FNS(name)						\
@@ -418,6 +440,7 @@ BFQ_BFQQ_FNS(coop);
 BFQ_BFQQ_FNS(split_coop);
 BFQ_BFQQ_FNS(some_coop_idle);
 BFQ_BFQQ_FNS(just_split);
+BFQ_BFQQ_FNS(background);
 #undef BFQ_BFQQ_FNS
 
 /* Logging facilities. */
@@ -144,6 +144,7 @@ void blk_rq_init(struct request_queue *q, struct request *rq)
 	rq->ref_count = 1;
 	rq->start_time = jiffies;
 	set_start_time_ns(rq);
+	blk_lat_stamp(rq);
 	rq->part = NULL;
 }
 EXPORT_SYMBOL(blk_rq_init);
@@ -460,6 +461,9 @@ struct request_queue *blk_alloc_queue_node(gfp_t gfp_mask, int node_id)
 	q->backing_dev_info.capabilities = BDI_CAP_MAP_COPY;
 	q->backing_dev_info.name = "block";
 	q->node = node_id;
+#ifdef CONFIG_BLK_DEFERRED_DISCARD
+	q->discard_defer_max = BLK_DISCARD_DEFER_MAX;
+#endif
 
 	err = bdi_init(&q->backing_dev_info);
 	if (err) {
@@ -1572,6 +1576,7 @@ static inline void __generic_make_request(struct bio *bio)
 		 * of partition p to block n+start(p) of the disk.
 		 */
 		blk_partition_remap(bio);
+		blk_discard_cancel(q, bio);
 
 		if (bio_integrity_enabled(bio) && bio_integrity_prep(bio))
 			goto end_io;
@@ -1881,6 +1886,8 @@ static void blk_account_io_done(struct request *req)
 
 		hd_struct_put(part);
 		part_stat_unlock();
+
+		blk_lat_account(req);
 	}
 }
 
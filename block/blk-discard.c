@@ -0,0 +1,422 @@
+/*
+ * Deferred discards
+ *
+ * Discards issued with BLKDEV_DISCARD_DEFER are not sent to the device
+ * right away: the ranges are kept, merged with the adjacent ones, and
+ * issued from a worker once the queue has no request allocated, when the
+ * screen turns off, or when too many ranges are pending. A write to a
+ * pending range removes it first, so a discard never reaches the device
+ * after the data written in its place.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/earlysuspend.h>
+#include <linux/genhd.h>
+#include <linux/rbtree.h>
+#include <linux/slab.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+#include "blk.h"
+
+/* How long pending discards wait for the queue to go idle */
+#define BLK_DISCARD_IDLE_DELAY	HZ
+
+/* One pending range of whole disk sectors, [start, end) */
+struct blk_discard_range {
+	struct rb_node		node;
+	sector_t		start;
+	sector_t		end;
+};
+
+struct blk_deferred_discard {
+	struct request_queue	*q;
+	struct block_device	*bdev;		/* whole disk */
+
+	spinlock_t		lock;		/* protects the fields below */
+	struct rb_root		ranges;
+	unsigned int		nr_ranges;
+	sector_t		nr_sectors;
+
+	/* range being issued, writes to it wait for the discard */
+	sector_t		issue_start;
+	sector_t		issue_end;
+	wait_queue_head_t	wait;
+
+	struct delayed_work	work;
+	struct list_head	list;		/* blk_discard_list */
+};
+
+static LIST_HEAD(blk_discard_list);
+static DEFINE_MUTEX(blk_discard_mutex);
+static bool blk_discard_screen_off;
+
+/* The first range ending after sector, NULL if there is none */
+static struct rb_node *blk_discard_lookup(struct blk_deferred_discard *dd,
+					  sector_t sector)
+{
+	struct rb_node *n = dd->ranges.rb_node;
+	struct rb_node *found = NULL;
+	struct blk_discard_range *r;
+
+	while (n) {
+		r = rb_entry(n, struct blk_discard_range, node);
+		if (r->end > sector) {
+			found = n;
+			n = n->rb_left;
+		} else {
+			n = n->rb_right;
+		}
+	}
+
+	return found;
+}
+
+static void blk_discard_insert(struct blk_deferred_discard *dd,
+			       struct blk_discard_range *new)
+{
+	struct rb_node **p = &dd->ranges.rb_node;
+	struct rb_node *parent = NULL;
+	struct blk_discard_range *r;
+
+	while (*p) {
+		parent = *p;
+		r = rb_entry(parent, struct blk_discard_range, node);
+		if (new->start < r->start)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+
+	rb_link_node(&new->node, parent, p);
+	rb_insert_color(&new->node, &dd->ranges);
+	dd->nr_ranges++;
+	dd->nr_sectors += new->end - new->start;
+}
+
+static void blk_discard_erase(struct blk_deferred_discard *dd,
+			      struct blk_discard_range *r)
+{
+	rb_erase(&r->node, &dd->ranges);
+	dd->nr_ranges--;
+	dd->nr_sectors -= r->end - r->start;
+}
+
+static bool blk_discard_issuing(struct blk_deferred_discard *dd,
+				sector_t start, sector_t end)
+{
+	return dd->issue_end && dd->issue_start < end && start < dd->issue_end;
+}
+
+static bool blk_discard_can_issue(struct blk_deferred_discard *dd)
+{
+	struct request_queue *q = dd->q;
+
+	return blk_discard_screen_off ||
+	       dd->nr_ranges >= q->discard_defer_max ||
+	       (!q->rq.count[BLK_RW_SYNC] && !q->rq.count[BLK_RW_ASYNC]);
+}
+
+/*
+ * Issue the pending ranges in disk order. Unless force is set, stop as
+ * soon as the queue gets other requests. Returns whether ranges remain.
+ */
+static bool blk_discard_issue(struct blk_deferred_discard *dd, bool force)
+{
+	struct blk_discard_range *r;
+	struct rb_node *n;
+
+	for (;;) {
+		spin_lock_irq(&dd->lock);
+		n = dd->bdev ? rb_first(&dd->ranges) : NULL;
+		if (!n || (!force && !blk_discard_can_issue(dd))) {
+			spin_unlock_irq(&dd->lock);
+			return n != NULL;
+		}
+
+		r = rb_entry(n, struct blk_discard_range, node);
+		blk_discard_erase(dd, r);
+		dd->issue_start = r->start;
+		dd->issue_end = r->end;
+		spin_unlock_irq(&dd->lock);
+
+		blkdev_issue_discard(dd->bdev, r->start, r->end - r->start,
+				     GFP_NOIO, 0);
+		kfree(r);
+
+		spin_lock_irq(&dd->lock);
+		dd->issue_end = 0;
+		spin_unlock_irq(&dd->lock);
+		wake_up_all(&dd->wait);
+
+		cond_resched();
+	}
+}
+
+static void blk_discard_work(struct work_struct *work)
+{
+	struct blk_deferred_discard *dd = container_of(to_delayed_work(work),
+					struct blk_deferred_discard, work);
+
+	if (blk_discard_issue(dd, false))
+		queue_delayed_work(system_nrt_freezable_wq, &dd->work,
+				   BLK_DISCARD_IDLE_DELAY);
+}
+
+/* Run the worker now rather than after the idle delay */
+static void blk_discard_kick(struct blk_deferred_discard *dd)
+{
+	cancel_delayed_work(&dd->work);
+	queue_delayed_work(system_nrt_freezable_wq, &dd->work, 0);
+}
+
+static struct blk_deferred_discard *
+blk_discard_get(struct request_queue *q, gfp_t gfp_mask)
+{
+	struct blk_deferred_discard *dd;
+
+	if (q->deferred_discard)
+		return q->deferred_discard;
+
+	mutex_lock(&blk_discard_mutex);
+	dd = q->deferred_discard;
+	if (dd)
+		goto out;
+
+	dd = kzalloc(sizeof(*dd), gfp_mask);
+	if (!dd)
+		goto out;
+
+	dd->q = q;
+	spin_lock_init(&dd->lock);
+	dd->ranges = RB_ROOT;
+	init_waitqueue_head(&dd->wait);
+	INIT_DELAYED_WORK(&dd->work, blk_discard_work);
+	list_add(&dd->list, &blk_discard_list);
+	smp_wmb();
+	q->deferred_discard = dd;
+out:
+	mutex_unlock(&blk_discard_mutex);
+	return dd;
+}
+
+/*
+ * Queue the discard of nr_sects at sector of bdev, merged with the pending
+ * ranges it touches. Returns 0 once it is pending, or an error for the
+ * caller to issue it right away: deferral is disabled, or the queue has
+ * reached discard_defer_max ranges.
+ */
+int blk_discard_defer(struct block_device *bdev, sector_t sector,
+		      sector_t nr_sects, gfp_t gfp_mask)
+{
+	struct request_queue *q = bdev_get_queue(bdev);
+	struct blk_deferred_discard *dd;
+	struct blk_discard_range *r, *new = NULL, *spare;
+	struct rb_node *n;
+	sector_t start, end;
+	unsigned long flags;
+	int ret = 0;
+
+	if (!q->discard_defer_max || !nr_sects)
+		return -EINVAL;
+
+	dd = blk_discard_get(q, gfp_mask);
+	if (!dd)
+		return -ENOMEM;
+
+	spare = kmalloc(sizeof(*spare), gfp_mask);
+	if (!spare)
+		return -ENOMEM;
+
+	start = sector + get_start_sect(bdev);
+	end = start + nr_sects;
+
+	spin_lock_irqsave(&dd->lock, flags);
+	dd->bdev = bdev->bd_contains;
+
+	/* Absorb the ranges overlapping or adjacent to [start, end) */
+	n = start ? blk_discard_lookup(dd, start - 1) : rb_first(&dd->ranges);
+	while (n) {
+		r = rb_entry(n, struct blk_discard_range, node);
+		if (r->start > end)
+			break;
+		n = rb_next(n);
+
+		start = min(start, r->start);
+		end = max(end, r->end);
+		blk_discard_erase(dd, r);
+		if (new)
+			kfree(r);
+		else
+			new = r;
+	}
+
+	if (!new) {
+		if (dd->nr_ranges >= q->discard_defer_max) {
+			ret = -ENOSPC;
+			goto out;
+		}
+		new = spare;
+		spare = NULL;
+	}
+
+	new->start = start;
+	new->end = end;
+	blk_discard_insert(dd, new);
+out:
+	spin_unlock_irqrestore(&dd->lock, flags);
+	kfree(spare);
+
+	if (ret == -ENOSPC)
+		blk_discard_kick(dd);
+	else if (!ret)
+		queue_delayed_work(system_nrt_freezable_wq, &dd->work,
+				   BLK_DISCARD_IDLE_DELAY);
+
+	return ret;
+}
+
+/*
+ * A write of nr_sects at sector of the whole disk is about to be queued:
+ * drop what it overwrites from the pending ranges, and wait if it is
+ * being discarded right now. Losing a pending range is harmless, so a
+ * range that cannot be split keeps only its head.
+ */
+void __blk_discard_cancel(struct request_queue *q, sector_t sector,
+			  unsigned int nr_sects)
+{
+	struct blk_deferred_discard *dd = q->deferred_discard;
+	sector_t end = sector + nr_sects;
+	struct blk_discard_range *r, *tail;
+	struct rb_node *n;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dd->lock, flags);
+	while (blk_discard_issuing(dd, sector, end)) {
+		spin_unlock_irqrestore(&dd->lock, flags);
+		wait_event(dd->wait, !blk_discard_issuing(dd, sector, end));
+		spin_lock_irqsave(&dd->lock, flags);
+	}
+
+	n = blk_discard_lookup(dd, sector);
+	while (n) {
+		r = rb_entry(n, struct blk_discard_range, node);
+		if (r->start >= end)
+			break;
+		n = rb_next(n);
+
+		if (r->start < sector && r->end > end) {
+			tail = kmalloc(sizeof(*tail), GFP_ATOMIC);
+			if (tail) {
+				tail->start = end;
+				tail->end = r->end;
+			}
+			dd->nr_sectors -= r->end - sector;
+			r->end = sector;
+			if (tail)
+				blk_discard_insert(dd, tail);
+			break;
+		} else if (r->start < sector) {
+			dd->nr_sectors -= r->end - sector;
+			r->end = sector;
+		} else if (r->end > end) {
+			dd->nr_sectors -= end - r->start;
+			r->start = end;
+		} else {
+			blk_discard_erase(dd, r);
+			kfree(r);
+		}
+	}
+	spin_unlock_irqrestore(&dd->lock, flags);
+}
+
+/*
+ * The whole disk is being closed: issue what is pending while its queue
+ * can still be reached through bdev.
+ */
+void blkdev_flush_deferred_discard(struct block_device *bdev)
+{
+	struct request_queue *q = bdev_get_queue(bdev);
+	struct blk_deferred_discard *dd = q ? q->deferred_discard : NULL;
+
+	if (!dd || dd->bdev != bdev)
+		return;
+
+	cancel_delayed_work_sync(&dd->work);
+	blk_discard_issue(dd, true);
+	dd->bdev = NULL;
+}
+
+void blk_discard_exit(struct request_queue *q)
+{
+	struct blk_deferred_discard *dd = q->deferred_discard;
+	struct blk_discard_range *r;
+	struct rb_node *n;
+
+	if (!dd)
+		return;
+
+	mutex_lock(&blk_discard_mutex);
+	list_del(&dd->list);
+	mutex_unlock(&blk_discard_mutex);
+
+	cancel_delayed_work_sync(&dd->work);
+	while ((n = rb_first(&dd->ranges))) {
+		r = rb_entry(n, struct blk_discard_range, node);
+		blk_discard_erase(dd, r);
+		kfree(r);
+	}
+
+	kfree(dd);
+	q->deferred_discard = NULL;
+}
+
+void blk_discard_stat(struct request_queue *q, unsigned int *nr_ranges,
+		      sector_t *nr_sectors)
+{
+	struct blk_deferred_discard *dd = q->deferred_discard;
+
+	*nr_ranges = 0;
+	*nr_sectors = 0;
+	if (!dd)
+		return;
+
+	spin_lock_irq(&dd->lock);
+	*nr_ranges = dd->nr_ranges;
+	*nr_sectors = dd->nr_sectors;
+	spin_unlock_irq(&dd->lock);
+}
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void blk_discard_early_suspend(struct early_suspend *h)
+{
+	struct blk_deferred_discard *dd;
+
+	mutex_lock(&blk_discard_mutex);
+	blk_discard_screen_off = true;
+	list_for_each_entry(dd, &blk_discard_list, list) {
+		if (dd->nr_ranges)
+			blk_discard_kick(dd);
+	}
+	mutex_unlock(&blk_discard_mutex);
+}
+
+static void blk_discard_late_resume(struct early_suspend *h)
+{
+	blk_discard_screen_off = false;
+}
+
+static struct early_suspend blk_discard_early_suspend_handler = {
+	.suspend = blk_discard_early_suspend,
+	.resume = blk_discard_late_resume,
+};
+
+static int __init blk_discard_init(void)
+{
+	register_early_suspend(&blk_discard_early_suspend_handler);
+	return 0;
+}
+subsys_initcall(blk_discard_init);
+#endif
@@ -35,7 +35,9 @@ static void bio_batch_end_io(struct bio *bio, int err)
  * @flags:	BLKDEV_IFL_* flags to control behaviour
  *
  * Description:
- *    Issue a discard request for the sectors in question.
+ *    Issue a discard request for the sectors in question. With
+ *    BLKDEV_DISCARD_DEFER, the discard may only be queued, to be issued
+ *    when the device is idle.
  */
 int blkdev_issue_discard(struct block_device *bdev, sector_t sector,
 		sector_t nr_sects, gfp_t gfp_mask, unsigned long flags)
@@ -69,6 +71,9 @@ int blkdev_issue_discard(struct block_device *bdev, sector_t sector,
 		if (!blk_queue_secdiscard(q))
 			return -EOPNOTSUPP;
 		type |= REQ_SECURE;
+	} else if ((flags & BLKDEV_DISCARD_DEFER) &&
+		   !blk_discard_defer(bdev, sector, nr_sects, gfp_mask)) {
+		return 0;
 	}
 
 	atomic_set(&bb.done, 1);
@@ -382,6 +382,101 @@ static struct queue_sysfs_entry queue_random_entry = {
 	.store = queue_store_random,
 };
 
+#ifdef CONFIG_BLK_DEFERRED_DISCARD
+static ssize_t queue_discard_defer_max_show(struct request_queue *q,
+					    char *page)
+{
+	return queue_var_show(q->discard_defer_max, page);
+}
+
+static ssize_t
+queue_discard_defer_max_store(struct request_queue *q, const char *page,
+			      size_t count)
+{
+	unsigned long max;
+	ssize_t ret = queue_var_store(&max, page, count);
+
+	q->discard_defer_max = min_t(unsigned long, max, UINT_MAX);
+	return ret;
+}
+
+static ssize_t queue_discard_deferred_show(struct request_queue *q,
+					   char *page)
+{
+	unsigned int nr_ranges;
+	sector_t nr_sectors;
+
+	blk_discard_stat(q, &nr_ranges, &nr_sectors);
+	return sprintf(page, "%u %llu\n", nr_ranges,
+		       (unsigned long long)nr_sectors);
+}
+
+static struct queue_sysfs_entry queue_discard_defer_max_entry = {
+	.attr = {.name = "discard_defer_max", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_discard_defer_max_show,
+	.store = queue_discard_defer_max_store,
+};
+
+static struct queue_sysfs_entry queue_discard_deferred_entry = {
+	.attr = {.name = "discard_deferred", .mode = S_IRUGO },
+	.show = queue_discard_deferred_show,
+};
+#endif
+
+#ifdef CONFIG_BLK_LATENCY_HIST
+/*
+ * The bucket bounds in usecs, then for each kind of request the number
+ * that completed in less than each bound. Writing clears the histograms.
+ */
+static ssize_t queue_latency_hist_show(struct request_queue *q, char *page)
+{
+	static const char *names[2][2] = {
+		{ "read_async", "read_sync" },
+		{ "write_async", "write_sync" },
+	};
+	unsigned int hist[BLK_LAT_BUCKETS];
+	ssize_t len;
+	int rw, sync, i;
+
+	len = sprintf(page, "%-12s", "us");
+	for (i = 0; i < BLK_LAT_BUCKETS; i++)
+		len += sprintf(page + len, " %lu", 1UL << i);
+	page[len++] = '\n';
+
+	for (rw = 0; rw < 2; rw++) {
+		for (sync = 0; sync < 2; sync++) {
+			spin_lock_irq(q->queue_lock);
+			memcpy(hist, q->lat_hist[rw][sync], sizeof(hist));
+			spin_unlock_irq(q->queue_lock);
+
+			len += sprintf(page + len, "%-12s", names[rw][sync]);
+			for (i = 0; i < BLK_LAT_BUCKETS; i++)
+				len += sprintf(page + len, " %u", hist[i]);
+			page[len++] = '\n';
+		}
+	}
+
+	return len;
+}
+
+static ssize_t
+queue_latency_hist_store(struct request_queue *q, const char *page,
+			 size_t count)
+{
+	spin_lock_irq(q->queue_lock);
+	memset(q->lat_hist, 0, sizeof(q->lat_hist));
+	spin_unlock_irq(q->queue_lock);
+
+	return count;
+}
+
+static struct queue_sysfs_entry queue_latency_hist_entry = {
+	.attr = {.name = "latency_hist", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_latency_hist_show,
+	.store = queue_latency_hist_store,
+};
+#endif
+
 static struct attribute *default_attrs[] = {
 	&queue_requests_entry.attr,
 	&queue_ra_entry.attr,
@@ -404,6 +499,13 @@ static struct attribute *default_attrs[] = {
 	&queue_rq_affinity_entry.attr,
 	&queue_iostats_entry.attr,
 	&queue_random_entry.attr,
+#ifdef CONFIG_BLK_DEFERRED_DISCARD
+	&queue_discard_defer_max_entry.attr,
+	&queue_discard_deferred_entry.attr,
+#endif
+#ifdef CONFIG_BLK_LATENCY_HIST
+	&queue_latency_hist_entry.attr,
+#endif
 	NULL,
 };
 
@@ -478,6 +580,7 @@ static void blk_release_queue(struct kobject *kobj)
 		elevator_exit(q->elevator);
 
 	blk_throtl_exit(q);
+	blk_discard_exit(q);
 
 	if (rl->rq_pool)
 		mempool_destroy(rl->rq_pool);
@@ -190,6 +190,61 @@ static inline int blk_cpu_to_group(int cpu)
  *	b) the queue had IO stats enabled when this request was started, and
  *	c) it's a file system request or a discard request
  */
+#ifdef CONFIG_BLK_DEFERRED_DISCARD
+int blk_discard_defer(struct block_device *bdev, sector_t sector,
+		      sector_t nr_sects, gfp_t gfp_mask);
+void __blk_discard_cancel(struct request_queue *q, sector_t sector,
+			  unsigned int nr_sects);
+void blk_discard_exit(struct request_queue *q);
+void blk_discard_stat(struct request_queue *q, unsigned int *nr_ranges,
+		      sector_t *nr_sectors);
+
+/* Called with every bio after the partition remap */
+static inline void blk_discard_cancel(struct request_queue *q, struct bio *bio)
+{
+	if (q->deferred_discard && (bio->bi_rw & WRITE) &&
+	    !(bio->bi_rw & REQ_DISCARD) && bio_sectors(bio))
+		__blk_discard_cancel(q, bio->bi_sector, bio_sectors(bio));
+}
+#else
+static inline int blk_discard_defer(struct block_device *bdev, sector_t sector,
+				    sector_t nr_sects, gfp_t gfp_mask)
+{
+	return -EINVAL;
+}
+static inline void blk_discard_cancel(struct request_queue *q,
+				      struct bio *bio) { }
+static inline void blk_discard_exit(struct request_queue *q) { }
+#endif
+
+#ifdef CONFIG_BLK_LATENCY_HIST
+static inline void blk_lat_stamp(struct request *rq)
+{
+	rq->lat_start_ns = ktime_to_ns(ktime_get());
+}
+
+static inline int blk_lat_bucket(s64 delta_ns)
+{
+	u64 us = max_t(s64, delta_ns, 0) >> 10;	/* close enough to usecs */
+
+	if (us >= 1UL << (BLK_LAT_BUCKETS - 2))
+		return BLK_LAT_BUCKETS - 1;
+	return fls_long((unsigned long)us);
+}
+
+/* Called with the queue lock held, like the rest of the completion */
+static inline void blk_lat_account(struct request *rq)
+{
+	s64 delta = ktime_to_ns(ktime_get()) - rq->lat_start_ns;
+
+	rq->q->lat_hist[rq_data_dir(rq)][rq_is_sync(rq)]
+		[blk_lat_bucket(delta)]++;
+}
+#else
+static inline void blk_lat_stamp(struct request *rq) { }
+static inline void blk_lat_account(struct request *rq) { }
+#endif
+
 static inline int blk_do_io_stat(struct request *rq)
 {
 	return rq->rq_disk &&
@@ -85,15 +85,38 @@ static const struct row_queue_params row_queues_def[] = {
 #define ROW_IDLE_TIME_MSEC 10	/* msec */
 #define ROW_READ_FREQ_MSEC 25	/* msec */
 
+/* Think time samples needed before the learned mean is trusted */
+#define ROW_TTIME_MIN_SAMPLES	80
+
+/*
+ * Dispatch latency histogram: bucket i counts requests that waited less
+ * than 512us << i in the scheduler, the last one everything longer.
+ */
+#define ROW_LAT_BUCKETS		12
+#define ROW_LAT_SHIFT		9
+
 /**
  * struct rowq_idling_data -  parameters for idling on the queue
  * @last_insert_time:	time the last request was inserted
  *			to the queue
+ * @last_complete_time:	time the last request of the queue
+ *			completed
+ * @ttime_samples:	weight of the think time samples so far
+ * @ttime_total:	weighted sum of the think time samples
+ * @ttime_mean:		mean think time (usec)
+ * @idle_hits:		idle windows ended by a new request
+ * @idle_misses:	idle windows that expired
  * @begin_idling:	flag indicating wether we should idle
  *
  */
 struct rowq_idling_data {
 	ktime_t			last_insert_time;
+	ktime_t			last_complete_time;
+	unsigned long		ttime_samples;
+	unsigned long		ttime_total;
+	unsigned long		ttime_mean;
+	unsigned int		idle_hits;
+	unsigned int		idle_misses;
 	bool			begin_idling;
 };
 
@@ -109,6 +132,7 @@ struct rowq_idling_data {
  * @dispatch quantum:	number of requests this queue may
  *			dispatch in a dispatch cycle
  * @idle_data:		data for idling on queues
+ * @disp_lat:		dispatch latency histogram
  *
  */
 struct row_queue {
@@ -124,6 +148,8 @@ struct row_queue {
 
 	/* used only for READ queues */
 	struct rowq_idling_data	idle_data;
+
+	unsigned int		disp_lat[ROW_LAT_BUCKETS];
 };
 
 /**
@@ -131,12 +157,15 @@ struct row_queue {
  * @idle_time:		idling duration (jiffies)
  * @freq:		min time between two requests that
  *			triger idling (msec)
+ * @learn:		size the idling window from the think time
+ *			of the queue instead of the fixed values
  * @idle_work:		pointer to struct delayed_work
  *
  */
 struct idling_data {
 	unsigned long			idle_time;
 	u32				freq;
+	int				learn;
 
 	struct workqueue_struct	*idle_workqueue;
 	struct delayed_work		idle_work;
@@ -169,6 +198,10 @@ struct row_data {
 };
 
 #define RQ_ROWQ(rq) ((struct row_queue *) ((rq)->elevator_private[0]))
+/* Low bits of the insertion time in usecs, only used for differences */
+#define RQ_INSERT_US(rq) ((unsigned long)((rq)->elevator_private[1]))
+#define RQ_SET_INSERT_US(rq, us) \
+	((rq)->elevator_private[1] = (void *)(unsigned long)(us))
 
 #define row_log(q, fmt, args...)   \
 	blk_add_trace_msg(q, "%s():" fmt , __func__, ##args)
@@ -194,16 +227,103 @@ static inline int row_rowq_unserved(struct row_data *rd,
 	return rd->cycle_flags & (1 << qnum);
 }
 
-static inline void __maybe_unused row_dump_queues_stat(struct row_data *rd)
+/*
+ * row_dump_queues_stat() - Print the state of the queues
+ * @rd:		pointer to struct row_data
+ * @page:	sysfs buffer, queues_stat attribute
+ *
+ * One line per queue with its think time and idling outcome when it
+ * idles, followed by its dispatch latency histogram.
+ */
+static ssize_t row_dump_queues_stat(struct row_data *rd, char *page)
 {
-	int i;
+	struct row_queue *rqueue;
+	int i, j, len = 0;
 
-	row_log(rd->dispatch_queue, " Queues status:");
-	for (i = 0; i < ROWQ_MAX_PRIO; i++)
-		row_log(rd->dispatch_queue,
-			"queue%d: dispatched= %d, nr_req=%d", i,
-			rd->row_queues[i].nr_dispatched,
-			rd->row_queues[i].nr_req);
+	len += scnprintf(page + len, PAGE_SIZE - len, "lat(us):");
+	for (j = 0; j < ROW_LAT_BUCKETS - 1; j++)
+		len += scnprintf(page + len, PAGE_SIZE - len, " <%u",
+				 (1 << ROW_LAT_SHIFT) << j);
+	len += scnprintf(page + len, PAGE_SIZE - len, " more\n");
+
+	for (i = 0; i < ROWQ_MAX_PRIO; i++) {
+		rqueue = &rd->row_queues[i];
+		len += scnprintf(page + len, PAGE_SIZE - len,
+				 "queue%d: dispatched=%u nr_req=%u", i,
+				 rqueue->nr_dispatched, rqueue->nr_req);
+		if (row_queues_def[i].idling_enabled)
+			len += scnprintf(page + len, PAGE_SIZE - len,
+				" ttime=%luus idling=%d hits=%u misses=%u",
+				rqueue->idle_data.ttime_mean,
+				rqueue->idle_data.begin_idling,
+				rqueue->idle_data.idle_hits,
+				rqueue->idle_data.idle_misses);
+		len += scnprintf(page + len, PAGE_SIZE - len, "\n   ");
+		for (j = 0; j < ROW_LAT_BUCKETS; j++)
+			len += scnprintf(page + len, PAGE_SIZE - len, " %u",
+					 rqueue->disp_lat[j]);
+		len += scnprintf(page + len, PAGE_SIZE - len, "\n");
+	}
+
+	return len;
+}
+
+/*
+ * row_update_ttime() - Account a think time sample of a queue
+ * @rd:		pointer to struct row_data
+ * @rqueue:	queue a request was added to
+ * @now:	time of the insertion
+ *
+ * The think time is the time between the completion of the last
+ * request of an empty queue and the next insertion. Samples longer than
+ * twice read_idle_freq count as that, so that a reader pausing once does
+ * not disable idling for long. The mean decays like CFQ's.
+ */
+static void row_update_ttime(struct row_data *rd, struct row_queue *rqueue,
+			     ktime_t now)
+{
+	struct rowq_idling_data *id = &rqueue->idle_data;
+	unsigned long ttime, cap = 2 * rd->read_idle.freq * USEC_PER_MSEC;
+
+	if (rqueue->nr_req || !ktime_to_us(id->last_complete_time))
+		return;
+
+	ttime = min_t(u64, ktime_us_delta(now, id->last_complete_time), cap);
+
+	id->ttime_samples = (7 * id->ttime_samples + 256) / 8;
+	id->ttime_total = (7 * id->ttime_total + 256 * ttime) / 8;
+	id->ttime_mean = (id->ttime_total + 128) / id->ttime_samples;
+}
+
+/*
+ * row_idle_window() - How long to idle on a queue, in jiffies
+ * @rd:		pointer to struct row_data
+ * @rqueue:	queue to idle on
+ *
+ * Twice the learned think time covers most of the readers coming back,
+ * never more than read_idle.
+ */
+static unsigned long row_idle_window(struct row_data *rd,
+				     struct row_queue *rqueue)
+{
+	struct rowq_idling_data *id = &rqueue->idle_data;
+
+	if (!rd->read_idle.learn || id->ttime_samples < ROW_TTIME_MIN_SAMPLES)
+		return rd->read_idle.idle_time;
+
+	return clamp_t(unsigned long, usecs_to_jiffies(2 * id->ttime_mean),
+		       1, rd->read_idle.idle_time);
+}
+
+static void row_account_disp_lat(struct row_queue *rqueue,
+				 struct request *rq)
+{
+	unsigned long lat = (unsigned long)ktime_to_us(ktime_get()) -
+		RQ_INSERT_US(rq);
+	int bucket = min_t(int, fls_long(lat >> ROW_LAT_SHIFT),
+			   ROW_LAT_BUCKETS - 1);
+
+	rqueue->disp_lat[bucket]++;
 }
 
 /******************** Static helper functions ***********************/
@@ -226,6 +346,7 @@ static void kick_queue(struct work_struct *work)
 	row_log_rowq(rd, rd->curr_queue, "Performing delayed work");
 	/* Mark idling process as done */
 	rd->row_queues[rd->curr_queue].idle_data.begin_idling = false;
+	rd->row_queues[rd->curr_queue].idle_data.idle_misses++;
 
 	if (!(rd->nr_reqs[0] + rd->nr_reqs[1]))
 		row_log(rd->dispatch_queue, "No requests in scheduler");
@@ -276,27 +397,46 @@ static void row_add_request(struct request_queue *q,
 {
 	struct row_data *rd = (struct row_data *)q->elevator->elevator_data;
 	struct row_queue *rqueue = RQ_ROWQ(rq);
+	struct rowq_idling_data *id = &rqueue->idle_data;
+	ktime_t now = ktime_get();
+	bool idle;
+
+	if (row_queues_def[rqueue->prio].idling_enabled)
+		row_update_ttime(rd, rqueue, now);
 
 	list_add_tail(&rq->queuelist, &rqueue->fifo);
 	rd->nr_reqs[rq_data_dir(rq)]++;
 	rqueue->nr_req++;
 	rq_set_fifo_time(rq, jiffies); /* for statistics*/
+	RQ_SET_INSERT_US(rq, ktime_to_us(now));
 
 	if (row_queues_def[rqueue->prio].idling_enabled) {
-		if (delayed_work_pending(&rd->read_idle.idle_work))
-			(void)cancel_delayed_work(
-				&rd->read_idle.idle_work);
-		if (ktime_to_ms(ktime_sub(ktime_get(),
-				rqueue->idle_data.last_insert_time)) <
-				rd->read_idle.freq) {
-			rqueue->idle_data.begin_idling = true;
-			row_log_rowq(rd, rqueue->prio, "Enable idling");
-		} else {
-			rqueue->idle_data.begin_idling = false;
-			row_log_rowq(rd, rqueue->prio, "Disable idling");
+		if (delayed_work_pending(&rd->read_idle.idle_work)) {
+			if (cancel_delayed_work(&rd->read_idle.idle_work) &&
+			    rqueue->prio == rd->curr_queue)
+				id->idle_hits++;
 		}
 
-		rqueue->idle_data.last_insert_time = ktime_get();
+		/*
+		 * Idle while the readers of the queue come back faster
+		 * than read_idle_freq: measured from their think time once
+		 * there are enough samples, from the previous insertion
+		 * otherwise.
+		 */
+		if (rd->read_idle.learn &&
+		    id->ttime_samples >= ROW_TTIME_MIN_SAMPLES)
+			idle = id->ttime_mean <
+				rd->read_idle.freq * USEC_PER_MSEC;
+		else
+			idle = ktime_to_ms(ktime_sub(now,
+					id->last_insert_time)) <
+				rd->read_idle.freq;
+
+		id->begin_idling = idle;
+		row_log_rowq(rd, rqueue->prio, "%s idling",
+			     idle ? "Enable" : "Disable");
+
+		id->last_insert_time = now;
 	}
 	if (row_queues_def[rqueue->prio].is_urgent &&
 	    row_rowq_unserved(rd, rqueue->prio)) {
@@ -396,6 +536,7 @@ static void row_dispatch_insert(struct row_data *rd)
 
 	rq = rq_entry_fifo(rd->row_queues[rd->curr_queue].fifo.next);
 	row_remove_request(rd->dispatch_queue, rq);
+	row_account_disp_lat(&rd->row_queues[rd->curr_queue], rq);
 	elv_dispatch_add_tail(rd->dispatch_queue, rq);
 	rd->row_queues[rd->curr_queue].nr_dispatched++;
 	row_clear_rowq_unserved(rd, rd->curr_queue);
@@ -498,8 +639,9 @@ static int row_dispatch_requests(struct request_queue *q, int force)
 		if (!force && row_queues_def[currq].idling_enabled &&
 		    rd->row_queues[currq].idle_data.begin_idling) {
 			if (!queue_delayed_work(rd->read_idle.idle_workqueue,
-						&rd->read_idle.idle_work,
-						rd->read_idle.idle_time)) {
+					&rd->read_idle.idle_work,
+					row_idle_window(rd,
+						&rd->row_queues[currq]))) {
 				row_log_rowq(rd, currq,
 					     "Work already on queue!");
 				pr_err("ROW_BUG: Work already on queue!");
@@ -562,6 +704,7 @@ static void *row_init_queue(struct request_queue *q)
 	if (!rdata->read_idle.idle_time)
 		rdata->read_idle.idle_time = 1;
 	rdata->read_idle.freq = ROW_READ_FREQ_MSEC;
+	rdata->read_idle.learn = 1;
 	rdata->read_idle.idle_workqueue = alloc_workqueue("row_idle_work",
 					    WQ_MEM_RECLAIM | WQ_HIGHPRI, 0);
 	if (!rdata->read_idle.idle_workqueue)
@@ -611,6 +754,21 @@ static void row_merged_requests(struct request_queue *q, struct request *rq,
 	rqueue->rdata->nr_reqs[rq_data_dir(rq)]--;
 }
 
+/*
+ * row_completed_request() - Called when a request completed
+ * @q:		requests queue
+ * @rq:		request that completed
+ *
+ * Start of the think time of the queue, see row_update_ttime().
+ */
+static void row_completed_request(struct request_queue *q, struct request *rq)
+{
+	struct row_queue *rqueue = RQ_ROWQ(rq);
+
+	if (rqueue && row_queues_def[rqueue->prio].idling_enabled)
+		rqueue->idle_data.last_complete_time = ktime_get();
+}
+
 /*
  * get_queue_type() - Get queue type for a given request
  *
@@ -694,6 +852,7 @@ SHOW_FUNCTION(row_lp_swrite_quantum_show,
 	rowd->row_queues[ROWQ_PRIO_LOW_SWRITE].disp_quantum, 0);
 SHOW_FUNCTION(row_read_idle_show, rowd->read_idle.idle_time, 0);
 SHOW_FUNCTION(row_read_idle_freq_show, rowd->read_idle.freq, 0);
+SHOW_FUNCTION(row_read_idle_learn_show, rowd->read_idle.learn, 0);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
@@ -734,6 +893,7 @@ STORE_FUNCTION(row_lp_swrite_quantum_store,
 			1, INT_MAX, 1);
 STORE_FUNCTION(row_read_idle_store, &rowd->read_idle.idle_time, 1, INT_MAX, 0);
 STORE_FUNCTION(row_read_idle_freq_store, &rowd->read_idle.freq, 1, INT_MAX, 0);
+STORE_FUNCTION(row_read_idle_learn_store, &rowd->read_idle.learn, 0, 1, 0);
 
 #undef STORE_FUNCTION
 
@@ -741,6 +901,11 @@ STORE_FUNCTION(row_read_idle_freq_store, &rowd->read_idle.freq, 1, INT_MAX, 0);
 	__ATTR(name, S_IRUGO|S_IWUSR, row_##name##_show, \
 				      row_##name##_store)
 
+static ssize_t row_queues_stat_show(struct elevator_queue *e, char *page)
+{
+	return row_dump_queues_stat(e->elevator_data, page);
+}
+
 static struct elv_fs_entry row_attrs[] = {
 	ROW_ATTR(hp_read_quantum),
 	ROW_ATTR(rp_read_quantum),
@@ -751,12 +916,15 @@ static struct elv_fs_entry row_attrs[] = {
 	ROW_ATTR(lp_swrite_quantum),
 	ROW_ATTR(read_idle),
 	ROW_ATTR(read_idle_freq),
+	ROW_ATTR(read_idle_learn),
+	__ATTR(queues_stat, S_IRUGO, row_queues_stat_show, NULL),
 	__ATTR_NULL
 };
 
 static struct elevator_type iosched_row = {
 	.ops = {
 		.elevator_merge_req_fn		= row_merged_requests,
+		.elevator_completed_req_fn	= row_completed_request,
 		.elevator_dispatch_fn		= row_dispatch_requests,
 		.elevator_add_req_fn		= row_add_request,
 		.elevator_reinsert_req_fn	= row_reinsert_req,
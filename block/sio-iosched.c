@@ -32,6 +32,8 @@ static const int async_write_expire = 16 * HZ;	/* ditto for async, these limits
 static const int writes_starved = 2;		/* max times reads can starve a write */
 static const int fifo_batch     = 8;		/* # of sequential requests treated as one
 						   by the above parameters. For throughput. */
+static const int async_batch    = 0;		/* max # of contiguous async requests
+						   dispatched together, 0 disables it. */
 
 /* Elevator data */
 struct sio_data {
@@ -42,24 +44,56 @@ struct sio_data {
 	unsigned int batched;
 	unsigned int starved;
 
+	/* Statistics */
+	unsigned int expired[2][2];	/* dispatched past their deadline */
+	unsigned int write_starved;	/* writes forced past reads */
+	unsigned int async_batches;
+	unsigned int async_batched;	/* requests in those batches */
+	unsigned int async_batch_cut;	/* batches stopped for a sync deadline */
+
 	/* Settings */
 	int fifo_expire[2][2];
 	int fifo_batch;
 	int writes_starved;
+	int async_batch;
 };
 
+/*
+ * Move rq towards the head of its fifo until the requests before it
+ * expire no later than it does, so the head stays the first to expire.
+ */
+static void
+sio_fifo_reposition(struct list_head *list, struct request *rq)
+{
+	struct list_head *pos = rq->queuelist.prev;
+
+	while (pos != list &&
+	       time_after(rq_fifo_time(rq_entry_fifo(pos)), rq_fifo_time(rq)))
+		pos = pos->prev;
+
+	list_move(&rq->queuelist, pos);
+}
+
 static void
 sio_merged_requests(struct request_queue *q, struct request *rq,
 		    struct request *next)
 {
+	struct sio_data *sd = q->elevator->elevator_data;
+
 	/*
 	 * If next expires before rq, assign its expire time to rq
 	 * and move into next position (next will be deleted) in fifo.
+	 * When next comes from the other sync/async fifo, rq keeps to
+	 * its own fifo and moves up to where the deadline puts it.
 	 */
 	if (!list_empty(&rq->queuelist) && !list_empty(&next->queuelist)) {
 		if (time_before(rq_fifo_time(next), rq_fifo_time(rq))) {
-			list_move(&rq->queuelist, &next->queuelist);
 			rq_set_fifo_time(rq, rq_fifo_time(next));
+			if (rq_is_sync(rq) == rq_is_sync(next))
+				list_move(&rq->queuelist, &next->queuelist);
+			else
+				sio_fifo_reposition(&sd->fifo_list
+					[rq_is_sync(rq)][rq_data_dir(rq)], rq);
 		}
 	}
 
@@ -167,6 +201,10 @@ sio_choose_request(struct sio_data *sd, int data_dir)
 static inline void
 sio_dispatch_request(struct sio_data *sd, struct request *rq)
 {
+	/* rq_fifo_clear() overwrites the expire time */
+	if (time_after(jiffies, rq_fifo_time(rq)))
+		sd->expired[rq_is_sync(rq)][rq_data_dir(rq)]++;
+
 	/*
 	 * Remove the request from the fifo list
 	 * and dispatch it.
@@ -182,6 +220,58 @@ sio_dispatch_request(struct sio_data *sd, struct request *rq)
 		sd->starved++;
 }
 
+/*
+ * Find the request of the fifo starting where rq ends.
+ */
+static struct request *
+sio_contig_request(struct list_head *list, struct request *rq)
+{
+	sector_t end = blk_rq_pos(rq) + blk_rq_sectors(rq);
+	struct request *next;
+
+	list_for_each_entry(next, list, queuelist) {
+		if (blk_rq_pos(next) == end)
+			return next;
+	}
+
+	return NULL;
+}
+
+/*
+ * Follow the async request just dispatched with the requests of its fifo
+ * that continue it on disk, up to async_batch requests in all. Tried
+ * only while no sync request is past its deadline: merging took what
+ * it could, these are the parts that did not fit in one request.
+ */
+static void
+sio_dispatch_async_batch(struct sio_data *sd, struct request *rq)
+{
+	struct list_head *list = &sd->fifo_list[ASYNC][rq_data_dir(rq)];
+	struct request *next;
+	int nr = 1;
+
+	while (nr < sd->async_batch) {
+		next = sio_contig_request(list, rq);
+		if (!next)
+			break;
+
+		if (sio_expired_request(sd, SYNC, READ) ||
+		    sio_expired_request(sd, SYNC, WRITE)) {
+			sd->async_batch_cut++;
+			break;
+		}
+
+		sio_dispatch_request(sd, next);
+		rq = next;
+		nr++;
+	}
+
+	if (nr > 1) {
+		sd->async_batches++;
+		sd->async_batched += nr;
+	}
+}
+
 static int
 sio_dispatch_requests(struct request_queue *q, int force)
 {
@@ -206,11 +296,17 @@ sio_dispatch_requests(struct request_queue *q, int force)
 		rq = sio_choose_request(sd, data_dir);
 		if (!rq)
 			return 0;
+
+		if (data_dir == WRITE && rq_data_dir(rq) == WRITE)
+			sd->write_starved++;
 	}
 
 	/* Dispatch request */
 	sio_dispatch_request(sd, rq);
 
+	if (sd->async_batch > 1 && !rq_is_sync(rq))
+		sio_dispatch_async_batch(sd, rq);
+
 	return 1;
 }
 
@@ -248,7 +344,7 @@ sio_init_queue(struct request_queue *q)
 	struct sio_data *sd;
 
 	/* Allocate structure */
-	sd = kmalloc_node(sizeof(*sd), GFP_KERNEL, q->node);
+	sd = kmalloc_node(sizeof(*sd), GFP_KERNEL | __GFP_ZERO, q->node);
 	if (!sd)
 		return NULL;
 
@@ -265,6 +361,8 @@ sio_init_queue(struct request_queue *q)
 	sd->fifo_expire[ASYNC][READ] = async_read_expire;
 	sd->fifo_expire[ASYNC][WRITE] = async_write_expire;
 	sd->fifo_batch = fifo_batch;
+	sd->writes_starved = writes_starved;
+	sd->async_batch = async_batch;
 
 	return sd;
 }
@@ -317,6 +415,7 @@ SHOW_FUNCTION(sio_async_read_expire_show, sd->fifo_expire[ASYNC][READ], 1);
 SHOW_FUNCTION(sio_async_write_expire_show, sd->fifo_expire[ASYNC][WRITE], 1);
 SHOW_FUNCTION(sio_fifo_batch_show, sd->fifo_batch, 0);
 SHOW_FUNCTION(sio_writes_starved_show, sd->writes_starved, 0);
+SHOW_FUNCTION(sio_async_batch_show, sd->async_batch, 0);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
@@ -341,12 +440,31 @@ STORE_FUNCTION(sio_async_read_expire_store, &sd->fifo_expire[ASYNC][READ], 0, IN
 STORE_FUNCTION(sio_async_write_expire_store, &sd->fifo_expire[ASYNC][WRITE], 0, INT_MAX, 1);
 STORE_FUNCTION(sio_fifo_batch_store, &sd->fifo_batch, 0, INT_MAX, 0);
 STORE_FUNCTION(sio_writes_starved_store, &sd->writes_starved, 0, INT_MAX, 0);
+STORE_FUNCTION(sio_async_batch_store, &sd->async_batch, 0, INT_MAX, 0);
 #undef STORE_FUNCTION
 
 #define DD_ATTR(name) \
 	__ATTR(name, S_IRUGO|S_IWUSR, sio_##name##_show, \
 				      sio_##name##_store)
 
+static ssize_t
+sio_stats_show(struct elevator_queue *e, char *page)
+{
+	struct sio_data *sd = e->elevator_data;
+
+	return sprintf(page,
+		       "expired: sync_read %u sync_write %u "
+		       "async_read %u async_write %u\n"
+		       "write_starved: %u\n"
+		       "async_batches: %u\n"
+		       "async_batched: %u\n"
+		       "async_batch_cut: %u\n",
+		       sd->expired[SYNC][READ], sd->expired[SYNC][WRITE],
+		       sd->expired[ASYNC][READ], sd->expired[ASYNC][WRITE],
+		       sd->write_starved, sd->async_batches,
+		       sd->async_batched, sd->async_batch_cut);
+}
+
 static struct elv_fs_entry sio_attrs[] = {
 	DD_ATTR(sync_read_expire),
 	DD_ATTR(sync_write_expire),
@@ -354,6 +472,8 @@ static struct elv_fs_entry sio_attrs[] = {
 	DD_ATTR(async_write_expire),
 	DD_ATTR(fifo_batch),
 	DD_ATTR(writes_starved),
+	DD_ATTR(async_batch),
+	__ATTR(stats, S_IRUGO, sio_stats_show, NULL),
 	__ATTR_NULL
 };
 
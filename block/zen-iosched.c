@@ -19,6 +19,8 @@ enum zen_data_dir { ASYNC, SYNC };
 static const int sync_expire  = HZ / 4;    /* max time before a sync is submitted. */
 static const int async_expire = 2 * HZ;    /* ditto for async, these limits are SOFT! */
 static const int fifo_batch = 1;
+static const int async_batch = 0;	/* contiguous async requests dispatched
+					   together, 0 disables it */
 
 struct zen_data {
 	/* Runtime Data */
@@ -27,9 +29,16 @@ struct zen_data {
 
         unsigned int batching;          /* number of sequential requests made */
 
+	/* statistics */
+	unsigned int expired[2];	/* dispatched past their deadline */
+	unsigned int async_batches;
+	unsigned int async_batched;	/* requests in those batches */
+	unsigned int async_batch_cut;	/* batches stopped for a sync deadline */
+
 	/* tunables */
 	int fifo_expire[2];
 	int fifo_batch;
+	int async_batch;
 };
 
 static inline struct zen_data *
@@ -39,18 +48,42 @@ zen_get_data(struct request_queue *q) {
 
 static void zen_dispatch(struct zen_data *, struct request *);
 
+/*
+ * move rq towards the head of its fifo until the requests before it
+ * expire no later than it does, so the head stays the first to expire
+ */
+static void
+zen_fifo_reposition(struct list_head *list, struct request *rq)
+{
+	struct list_head *pos = rq->queuelist.prev;
+
+	while (pos != list &&
+	       time_after(rq_fifo_time(rq_entry_fifo(pos)), rq_fifo_time(rq)))
+		pos = pos->prev;
+
+	list_move(&rq->queuelist, pos);
+}
+
 static void
 zen_merged_requests(struct request_queue *q, struct request *req,
                     struct request *next)
 {
+	struct zen_data *zdata = zen_get_data(q);
+
 	/*
 	 * if next expires before rq, assign its expire time to arq
-	 * and move into next position (next will be deleted) in fifo
+	 * and move into next position (next will be deleted) in fifo.
+	 * When next comes from the other sync/async fifo, req keeps to
+	 * its own fifo and moves up to where the deadline puts it.
 	 */
 	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist)) {
 		if (time_before(rq_fifo_time(next), rq_fifo_time(req))) {
-			list_move(&req->queuelist, &next->queuelist);
 			rq_set_fifo_time(req, rq_fifo_time(next));
+			if (rq_is_sync(req) == rq_is_sync(next))
+				list_move(&req->queuelist, &next->queuelist);
+			else
+				zen_fifo_reposition(
+					&zdata->fifo_list[rq_is_sync(req)], req);
 		}
 	}
 
@@ -71,6 +104,10 @@ static void zen_add_request(struct request_queue *q, struct request *rq)
 
 static void zen_dispatch(struct zen_data *zdata, struct request *rq)
 {
+	/* rq_fifo_clear() overwrites the expire time */
+	if (time_after(jiffies, rq_fifo_time(rq)))
+		zdata->expired[rq_is_sync(rq)]++;
+
 	/* Remove request from list and dispatch it */
 	rq_fifo_clear(rq);
 	elv_dispatch_add_tail(rq->q, rq);
@@ -134,6 +171,56 @@ zen_choose_request(struct zen_data *zdata)
         return NULL;
 }
 
+/*
+ * find the request of the async fifo starting where rq ends
+ */
+static struct request *
+zen_contig_request(struct zen_data *zdata, struct request *rq)
+{
+	sector_t end = blk_rq_pos(rq) + blk_rq_sectors(rq);
+	struct request *next;
+
+	list_for_each_entry(next, &zdata->fifo_list[ASYNC], queuelist) {
+		if (blk_rq_pos(next) == end &&
+		    rq_data_dir(next) == rq_data_dir(rq))
+			return next;
+	}
+
+	return NULL;
+}
+
+/*
+ * follow the async request just dispatched with the async requests that
+ * continue it on disk, up to async_batch in all, for as long as no sync
+ * request is past its deadline
+ */
+static void zen_dispatch_async_batch(struct zen_data *zdata,
+				     struct request *rq)
+{
+	struct request *next;
+	int nr = 1;
+
+	while (nr < zdata->async_batch) {
+		next = zen_contig_request(zdata, rq);
+		if (!next)
+			break;
+
+		if (zen_expired_request(zdata, SYNC)) {
+			zdata->async_batch_cut++;
+			break;
+		}
+
+		zen_dispatch(zdata, next);
+		rq = next;
+		nr++;
+	}
+
+	if (nr > 1) {
+		zdata->async_batches++;
+		zdata->async_batched += nr;
+	}
+}
+
 static int zen_dispatch_requests(struct request_queue *q, int force)
 {
 	struct zen_data *zdata = zen_get_data(q);
@@ -153,6 +240,9 @@ static int zen_dispatch_requests(struct request_queue *q, int force)
 
 	zen_dispatch(zdata, rq);
 
+	if (zdata->async_batch > 1 && !rq_is_sync(rq))
+		zen_dispatch_async_batch(zdata, rq);
+
 	return 1;
 }
 
@@ -160,7 +250,7 @@ static void *zen_init_queue(struct request_queue *q)
 {
 	struct zen_data *zdata;
 
-	zdata = kmalloc_node(sizeof(*zdata), GFP_KERNEL, q->node);
+	zdata = kmalloc_node(sizeof(*zdata), GFP_KERNEL | __GFP_ZERO, q->node);
 	if (!zdata)
 		return NULL;
 	INIT_LIST_HEAD(&zdata->fifo_list[SYNC]);
@@ -168,6 +258,7 @@ static void *zen_init_queue(struct request_queue *q)
 	zdata->fifo_expire[SYNC] = sync_expire;
 	zdata->fifo_expire[ASYNC] = async_expire;
 	zdata->fifo_batch = fifo_batch;
+	zdata->async_batch = async_batch;
 	return zdata;
 }
 
@@ -206,6 +297,7 @@ static ssize_t __FUNC(struct elevator_queue *e, char *page) \
 SHOW_FUNCTION(zen_sync_expire_show, zdata->fifo_expire[SYNC], 1);
 SHOW_FUNCTION(zen_async_expire_show, zdata->fifo_expire[ASYNC], 1);
 SHOW_FUNCTION(zen_fifo_batch_show, zdata->fifo_batch, 0);
+SHOW_FUNCTION(zen_async_batch_show, zdata->async_batch, 0);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV) \
@@ -227,16 +319,33 @@ static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)
 STORE_FUNCTION(zen_sync_expire_store, &zdata->fifo_expire[SYNC], 0, INT_MAX, 1);
 STORE_FUNCTION(zen_async_expire_store, &zdata->fifo_expire[ASYNC], 0, INT_MAX, 1);
 STORE_FUNCTION(zen_fifo_batch_store, &zdata->fifo_batch, 0, INT_MAX, 0);
+STORE_FUNCTION(zen_async_batch_store, &zdata->async_batch, 0, INT_MAX, 0);
 #undef STORE_FUNCTION
 
 #define DD_ATTR(name) \
         __ATTR(name, S_IRUGO|S_IWUSR, zen_##name##_show, \
                                       zen_##name##_store)
 
+static ssize_t zen_stats_show(struct elevator_queue *e, char *page)
+{
+	struct zen_data *zdata = e->elevator_data;
+
+	return sprintf(page,
+		       "expired: sync %u async %u\n"
+		       "async_batches: %u\n"
+		       "async_batched: %u\n"
+		       "async_batch_cut: %u\n",
+		       zdata->expired[SYNC], zdata->expired[ASYNC],
+		       zdata->async_batches, zdata->async_batched,
+		       zdata->async_batch_cut);
+}
+
 static struct elv_fs_entry zen_attrs[] = {
         DD_ATTR(sync_expire),
         DD_ATTR(async_expire),
         DD_ATTR(fifo_batch),
+        DD_ATTR(async_batch),
+        __ATTR(stats, S_IRUGO, zen_stats_show, NULL),
         __ATTR_NULL
 };
 
@@ -1079,6 +1079,30 @@ static int do_test(int m)
 				  speed_template_16_32);
 		break;
 
+	case 207:
+		/* The same modes over each AES implementation, side by side */
+		test_cipher_speed("cbc(aes-generic)", ENCRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("cbc(aes-asm)", ENCRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("cbc(aes-generic)", DECRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("cbc(aes-asm)", DECRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("xts(aes-generic)", ENCRYPT, sec, NULL, 0,
+				speed_template_32_48_64);
+		test_cipher_speed("xts(aes-asm)", ENCRYPT, sec, NULL, 0,
+				speed_template_32_48_64);
+		test_cipher_speed("xts(aes-generic)", DECRYPT, sec, NULL, 0,
+				speed_template_32_48_64);
+		test_cipher_speed("xts(aes-asm)", DECRYPT, sec, NULL, 0,
+				speed_template_32_48_64);
+		test_cipher_speed("ctr(aes-generic)", ENCRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("ctr(aes-asm)", ENCRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		break;
+
 	case 300:
 		/* fall through */
 
@@ -1154,6 +1178,13 @@ static int do_test(int m)
 		test_hash_speed("ghash-generic", sec, hash_speed_template_16);
 		if (mode > 300 && mode < 400) break;
 
+	case 319:
+		test_hash_speed("sha1-generic", sec, generic_hash_speed_template);
+		test_hash_speed("sha1-asm", sec, generic_hash_speed_template);
+		test_hash_speed("sha256-generic", sec,
+				generic_hash_speed_template);
+		if (mode > 300 && mode < 400) break;
+
 	case 399:
 		break;
 
@@ -512,12 +512,14 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
 static int device_resume(struct device *dev, pm_message_t state, bool async)
 {
 	int error = 0;
+	ktime_t calltime;
 
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
 
 	dpm_wait(dev->parent, async);
 	device_lock(dev);
+	calltime = ktime_get();
 
 	/*
 	 * This is a fib.  But we'll allow new children to be added below
@@ -564,6 +566,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 
  End:
 	dev->power.is_suspended = false;
+	suspend_time_record(dev_name(dev), true, calltime);
 
  Unlock:
 	device_unlock(dev);
@@ -874,6 +877,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	int error = 0;
 	struct timer_list timer;
 	struct dpm_drv_wd_data data;
+	ktime_t calltime;
 
 	dpm_wait_for_children(dev, async);
 
@@ -886,6 +890,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	add_timer(&timer);
 
 	device_lock(dev);
+	calltime = ktime_get();
 
 	if (async_error)
 		goto Unlock;
@@ -931,6 +936,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 
  End:
 	dev->power.is_suspended = !error;
+	suspend_time_record(dev_name(dev), false, calltime);
 
  Unlock:
 	device_unlock(dev);
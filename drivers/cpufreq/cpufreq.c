@@ -21,6 +21,7 @@
 #include <linux/notifier.h>
 #include <linux/cpufreq.h>
 #include <linux/delay.h>
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/spinlock.h>
 #include <linux/device.h>
@@ -1434,6 +1435,22 @@ EXPORT_SYMBOL(cpufreq_unregister_notifier);
  *********************************************************************/
 
 
+/* Time of the pending frequency request per CPU in ns, 0 when none */
+static DEFINE_PER_CPU(u64, cpufreq_request_ns);
+
+void cpufreq_request_mark(unsigned int cpu)
+{
+	if (!per_cpu(cpufreq_request_ns, cpu))
+		per_cpu(cpufreq_request_ns, cpu) = ktime_to_ns(ktime_get());
+}
+EXPORT_SYMBOL_GPL(cpufreq_request_mark);
+
+u64 cpufreq_request_time(unsigned int cpu)
+{
+	return per_cpu(cpufreq_request_ns, cpu);
+}
+EXPORT_SYMBOL_GPL(cpufreq_request_time);
+
 int __cpufreq_driver_target(struct cpufreq_policy *policy,
 			    unsigned int target_freq,
 			    unsigned int relation)
@@ -1442,8 +1459,10 @@ int __cpufreq_driver_target(struct cpufreq_policy *policy,
 
 	pr_debug("target for CPU %u: %u kHz, relation %u\n", policy->cpu,
 		target_freq, relation);
+	cpufreq_request_mark(policy->cpu);
 	if (cpu_online(policy->cpu) && cpufreq_driver->target)
 		retval = cpufreq_driver->target(policy, target_freq, relation);
+	per_cpu(cpufreq_request_ns, policy->cpu) = 0;
 	if (likely(retval != -EINVAL)) {
 		if (target_freq == policy->max)
 			cpu_nonscaling(policy->cpu);
@@ -0,0 +1,211 @@
+/*
+ *  linux/drivers/cpufreq/cpufreq_input_boost.c
+ *
+ *  Input boost shared by the cpufreq governors and the bus and GPU
+ *  frequency drivers.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * One input handler watches the touchscreens. A packet starts a boost,
+ * or extends the running one, for boost_ms. The boost raises the
+ * minimum of every cpufreq policy to boost_freq and is passed on to the
+ * subscribers, which raise the memory bus or the GPU clock or jump a
+ * governor to its own boost speed.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/cpufreq_input_boost.h>
+#include <linux/input.h>
+#include <linux/jiffies.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+static unsigned int boost_ms = 100;
+module_param(boost_ms, uint, 0644);
+
+/* Policy minimum while boosted in kHz, 0 to leave it alone */
+static unsigned int boost_freq = 800000;
+module_param(boost_freq, uint, 0644);
+
+static ATOMIC_NOTIFIER_HEAD(input_boost_chain);
+
+static bool boost_on;
+static unsigned long boost_until;
+
+static void input_boost_update_policies(void)
+{
+	unsigned int cpu;
+
+	if (!boost_freq)
+		return;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu)
+		cpufreq_update_policy(cpu);
+	put_online_cpus();
+}
+
+static void input_boost_end_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(input_boost_end_work, input_boost_end_fn);
+
+static void input_boost_start_fn(struct work_struct *work)
+{
+	input_boost_update_policies();
+	schedule_delayed_work(&input_boost_end_work,
+			      msecs_to_jiffies(boost_ms));
+}
+static DECLARE_WORK(input_boost_start_work, input_boost_start_fn);
+
+static void input_boost_end_fn(struct work_struct *work)
+{
+	long left = ACCESS_ONCE(boost_until) - jiffies;
+
+	if (left > 0) {
+		schedule_delayed_work(&input_boost_end_work, left);
+		return;
+	}
+
+	boost_on = false;
+	input_boost_update_policies();
+	atomic_notifier_call_chain(&input_boost_chain, INPUT_BOOST_END, NULL);
+}
+
+bool input_boost_active(void)
+{
+	return boost_on;
+}
+EXPORT_SYMBOL_GPL(input_boost_active);
+
+int input_boost_register_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&input_boost_chain, nb);
+}
+EXPORT_SYMBOL_GPL(input_boost_register_notifier);
+
+int input_boost_unregister_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_unregister(&input_boost_chain, nb);
+}
+EXPORT_SYMBOL_GPL(input_boost_unregister_notifier);
+
+static int input_boost_policy_notifier(struct notifier_block *nb,
+				       unsigned long val, void *data)
+{
+	struct cpufreq_policy *policy = data;
+
+	if (val != CPUFREQ_ADJUST || !boost_on || !boost_freq)
+		return NOTIFY_OK;
+
+	cpufreq_verify_within_limits(policy,
+				     min(boost_freq, policy->max), policy->max);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block input_boost_policy_nb = {
+	.notifier_call = input_boost_policy_notifier,
+};
+
+/* Called with dev->event_lock held */
+static void input_boost_event(struct input_handle *handle, unsigned int type,
+			      unsigned int code, int value)
+{
+	if (type != EV_SYN || code != SYN_REPORT || !boost_ms)
+		return;
+
+	boost_until = jiffies + msecs_to_jiffies(boost_ms);
+	if (boost_on)
+		return;
+
+	boost_on = true;
+	atomic_notifier_call_chain(&input_boost_chain, INPUT_BOOST_START, NULL);
+	schedule_work(&input_boost_start_work);
+}
+
+static int input_boost_connect(struct input_handler *handler,
+			       struct input_dev *dev,
+			       const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq_input_boost";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err_register;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err_open;
+
+	return 0;
+
+err_open:
+	input_unregister_handle(handle);
+err_register:
+	kfree(handle);
+	return error;
+}
+
+static void input_boost_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id input_boost_ids[] = {
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			    BIT_MASK(ABS_MT_POSITION_X) |
+			    BIT_MASK(ABS_MT_POSITION_Y) },
+	}, /* multi-touch touchscreen */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] =
+			    BIT_MASK(ABS_X) | BIT_MASK(ABS_Y) },
+	}, /* touchpad */
+	{ },
+};
+
+static struct input_handler input_boost_handler = {
+	.event		= input_boost_event,
+	.connect	= input_boost_connect,
+	.disconnect	= input_boost_disconnect,
+	.name		= "cpufreq_input_boost",
+	.id_table	= input_boost_ids,
+};
+
+static int __init input_boost_init(void)
+{
+	int ret;
+
+	ret = cpufreq_register_notifier(&input_boost_policy_nb,
+					CPUFREQ_POLICY_NOTIFIER);
+	if (ret)
+		return ret;
+
+	ret = input_register_handler(&input_boost_handler);
+	if (ret)
+		cpufreq_unregister_notifier(&input_boost_policy_nb,
+					    CPUFREQ_POLICY_NOTIFIER);
+	return ret;
+}
+late_initcall(input_boost_init);
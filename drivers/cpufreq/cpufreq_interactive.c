@@ -21,13 +21,15 @@
 #include <linux/cpufreq.h>
 #include <linux/mutex.h>
 #include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
 #include <linux/tick.h>
 #include <linux/time.h>
 #include <linux/timer.h>
 #include <linux/workqueue.h>
 #include <linux/kthread.h>
 #include <linux/slab.h>
-#include <linux/input.h>
+#include <linux/cpufreq_input_boost.h>
 #include <asm/cputime.h>
 
 static atomic_t active_count = ATOMIC_INIT(0);
@@ -68,6 +70,17 @@ static u64 hispeed_freq;
 #define DEFAULT_GO_HISPEED_LOAD 85
 static unsigned long go_hispeed_load;
 
+/*
+ * Target load for each frequency: the governor picks the lowest frequency
+ * at which the current load would not exceed the target load for it. The
+ * table reads "load freq:load ...", each load applying from its freq up.
+ */
+#define DEFAULT_TARGET_LOAD 90
+static unsigned int default_target_loads[] = {DEFAULT_TARGET_LOAD};
+static spinlock_t target_loads_lock;
+static unsigned int *target_loads = default_target_loads;
+static int ntarget_loads = ARRAY_SIZE(default_target_loads);
+
 /*
  * The minimum amount of time to spend at a frequency before we can ramp down.
  */
@@ -77,28 +90,40 @@ static unsigned long min_sample_time;
 /*
  * The sample rate of the timer used to increase frequency
  */
-#define DEFAULT_TIMER_RATE (20 * USEC_PER_MSEC);
+#define DEFAULT_TIMER_RATE (20 * USEC_PER_MSEC)
 static unsigned long timer_rate;
 
 /*
  * Wait this long before raising speed above hispeed, by default a single
- * timer interval.
+ * timer interval. Same "delay freq:delay ..." table format as target_loads,
+ * so each step past hispeed can be made to wait longer.
  */
 #define DEFAULT_ABOVE_HISPEED_DELAY DEFAULT_TIMER_RATE
-static unsigned long above_hispeed_delay_val;
+static unsigned int default_above_hispeed_delay[] = {
+	DEFAULT_ABOVE_HISPEED_DELAY };
+static spinlock_t above_hispeed_delay_lock;
+static unsigned int *above_hispeed_delay = default_above_hispeed_delay;
+static int nabove_hispeed_delay = ARRAY_SIZE(default_above_hispeed_delay);
 
 /*
- * Boost pulse to hispeed on touchscreen input.
+ * Time covered by load samples at each frequency of the table, and the
+ * busy part of it, to tune target_loads against the per-level power.
  */
+#define MAX_FREQ_STATS 32
 
-static int input_boost_val;
-
-struct cpufreq_interactive_inputopen {
-	struct input_handle *handle;
-	struct work_struct inputopen_work;
+struct cpufreq_interactive_freq_stat {
+	u64 time;
+	u64 busy;
 };
 
-static struct cpufreq_interactive_inputopen inputopen;
+static spinlock_t freq_stats_lock;
+static struct cpufreq_interactive_freq_stat freq_stats[MAX_FREQ_STATS];
+
+/*
+ * Boost pulse to hispeed on touchscreen input.
+ */
+
+static int input_boost_val;
 
 /*
  * Non-zero means longer-term speed boost active.
@@ -119,12 +144,151 @@ struct cpufreq_governor cpufreq_gov_interactive = {
 	.owner = THIS_MODULE,
 };
 
+/* Find the entry of a "value freq:value ..." table applying to freq */
+static unsigned int freq_to_table_val(spinlock_t *lock, unsigned int *table,
+				      int ntokens, unsigned int freq)
+{
+	int i;
+	unsigned int ret;
+	unsigned long flags;
+
+	spin_lock_irqsave(lock, flags);
+	for (i = 0; i < ntokens - 1 && freq >= table[i + 1]; i += 2)
+		;
+	ret = table[i];
+	spin_unlock_irqrestore(lock, flags);
+	return ret;
+}
+
+static unsigned int freq_to_targetload(unsigned int freq)
+{
+	return freq_to_table_val(&target_loads_lock, target_loads,
+				 ntarget_loads, freq);
+}
+
+static unsigned int freq_to_above_hispeed_delay(unsigned int freq)
+{
+	return freq_to_table_val(&above_hispeed_delay_lock,
+				 above_hispeed_delay, nabove_hispeed_delay,
+				 freq);
+}
+
+/*
+ * If increasing frequencies never map to a lower target load then
+ * choose_freq() will find the minimum frequency that does not exceed its
+ * target load given the current load.
+ */
+static unsigned int choose_freq(struct cpufreq_interactive_cpuinfo *pcpu,
+				unsigned int loadadjfreq)
+{
+	unsigned int freq = pcpu->policy->cur;
+	unsigned int prevfreq, freqmin, freqmax;
+	unsigned int tl;
+	unsigned int index;
+
+	freqmin = 0;
+	freqmax = UINT_MAX;
+
+	do {
+		prevfreq = freq;
+		tl = freq_to_targetload(freq);
+
+		/*
+		 * Find the lowest frequency where the computed load is less
+		 * than or equal to the target load.
+		 */
+		if (cpufreq_frequency_table_target(pcpu->policy,
+						   pcpu->freq_table,
+						   loadadjfreq / tl,
+						   CPUFREQ_RELATION_L, &index))
+			break;
+		freq = pcpu->freq_table[index].frequency;
+
+		if (freq > prevfreq) {
+			/* The previous frequency is too low. */
+			freqmin = prevfreq;
+
+			if (freq >= freqmax) {
+				/*
+				 * Find the highest frequency that is less
+				 * than freqmax.
+				 */
+				if (cpufreq_frequency_table_target(
+					    pcpu->policy, pcpu->freq_table,
+					    freqmax - 1, CPUFREQ_RELATION_H,
+					    &index))
+					break;
+				freq = pcpu->freq_table[index].frequency;
+
+				if (freq == freqmin) {
+					/*
+					 * The first frequency below freqmax
+					 * has already been found to be too
+					 * low.  freqmax is the lowest speed
+					 * we found that is fast enough.
+					 */
+					freq = freqmax;
+					break;
+				}
+			}
+		} else if (freq < prevfreq) {
+			/* The previous frequency is high enough. */
+			freqmax = prevfreq;
+
+			if (freq <= freqmin) {
+				/*
+				 * Find the lowest frequency that is higher
+				 * than freqmin.
+				 */
+				if (cpufreq_frequency_table_target(
+					    pcpu->policy, pcpu->freq_table,
+					    freqmin + 1, CPUFREQ_RELATION_L,
+					    &index))
+					break;
+				freq = pcpu->freq_table[index].frequency;
+
+				/*
+				 * If freqmax is the first frequency above
+				 * freqmin then we have already found that
+				 * this speed is fast enough.
+				 */
+				if (freq == freqmax)
+					break;
+			}
+		}
+
+		/* If same frequency chosen as previous then done. */
+	} while (freq != prevfreq);
+
+	return freq;
+}
+
+static void account_freq_stat(struct cpufreq_interactive_cpuinfo *pcpu,
+			      unsigned int time, unsigned int idle)
+{
+	unsigned long flags;
+	int i;
+
+	for (i = 0; i < MAX_FREQ_STATS &&
+		     pcpu->freq_table[i].frequency != CPUFREQ_TABLE_END; i++) {
+		if (pcpu->freq_table[i].frequency != pcpu->policy->cur)
+			continue;
+
+		spin_lock_irqsave(&freq_stats_lock, flags);
+		freq_stats[i].time += time;
+		freq_stats[i].busy += time - idle;
+		spin_unlock_irqrestore(&freq_stats_lock, flags);
+		break;
+	}
+}
+
 static void cpufreq_interactive_timer(unsigned long data)
 {
 	unsigned int delta_idle;
 	unsigned int delta_time;
 	int cpu_load;
 	int load_since_change;
+	unsigned int loadadjfreq;
 	u64 time_in_idle;
 	u64 idle_exit_time;
 	struct cpufreq_interactive_cpuinfo *pcpu =
@@ -171,6 +335,7 @@ static void cpufreq_interactive_timer(unsigned long data)
 		cpu_load = 0;
 	else
 		cpu_load = 100 * (delta_time - delta_idle) / delta_time;
+	account_freq_stat(pcpu, delta_time, min(delta_idle, delta_time));
 
 	delta_idle = (unsigned int) cputime64_sub(now_idle,
 						pcpu->target_set_time_in_idle);
@@ -191,28 +356,30 @@ static void cpufreq_interactive_timer(unsigned long data)
 	if (load_since_change > cpu_load)
 		cpu_load = load_since_change;
 
+	/* Load scaled by the current speed, to compare with target loads */
+	loadadjfreq = (unsigned int)cpu_load * pcpu->policy->cur;
+
 	if (cpu_load >= go_hispeed_load || boost_val) {
 		if (pcpu->target_freq <= pcpu->policy->min) {
 			new_freq = hispeed_freq;
 		} else {
-			new_freq = pcpu->policy->max * cpu_load / 100;
+			new_freq = choose_freq(pcpu, loadadjfreq);
 
 			if (new_freq < hispeed_freq)
 				new_freq = hispeed_freq;
-
-			if (pcpu->target_freq == hispeed_freq &&
-			    new_freq > hispeed_freq &&
-			    cputime64_sub(pcpu->timer_run_time,
-					  pcpu->hispeed_validate_time)
-			    < above_hispeed_delay_val) {
-				goto rearm;
-			}
 		}
 	} else {
-		new_freq = pcpu->policy->max * cpu_load / 100;
+		new_freq = choose_freq(pcpu, loadadjfreq);
 	}
 
-	if (new_freq <= hispeed_freq)
+	/* Each step above hispeed waits for the delay of the current one */
+	if (pcpu->target_freq >= hispeed_freq &&
+	    new_freq > pcpu->target_freq &&
+	    cputime64_sub(pcpu->timer_run_time, pcpu->hispeed_validate_time)
+	    < freq_to_above_hispeed_delay(pcpu->target_freq))
+		goto rearm;
+
+	if (new_freq <= hispeed_freq || new_freq > pcpu->target_freq)
 		pcpu->hispeed_validate_time = pcpu->timer_run_time;
 
 	if (cpufreq_frequency_table_target(pcpu->policy, pcpu->freq_table,
@@ -245,6 +412,7 @@ static void cpufreq_interactive_timer(unsigned long data)
 
 	pcpu->target_set_time_in_idle = now_idle;
 	pcpu->target_set_time = pcpu->timer_run_time;
+	cpufreq_request_mark(data);
 
 	if (new_freq < pcpu->target_freq) {
 		pcpu->target_freq = new_freq;
@@ -490,86 +658,16 @@ static void cpufreq_interactive_boost(void)
  * to drop.
  */
 
-static void cpufreq_interactive_input_event(struct input_handle *handle,
-					    unsigned int type,
-					    unsigned int code, int value)
+static int cpufreq_interactive_input_boost(struct notifier_block *nb,
+					   unsigned long val, void *data)
 {
-	if (input_boost_val && type == EV_SYN && code == SYN_REPORT)
+	if (input_boost_val && val == INPUT_BOOST_START)
 		cpufreq_interactive_boost();
+	return NOTIFY_OK;
 }
 
-static void cpufreq_interactive_input_open(struct work_struct *w)
-{
-	struct cpufreq_interactive_inputopen *io =
-		container_of(w, struct cpufreq_interactive_inputopen,
-			     inputopen_work);
-	int error;
-
-	error = input_open_device(io->handle);
-	if (error)
-		input_unregister_handle(io->handle);
-}
-
-static int cpufreq_interactive_input_connect(struct input_handler *handler,
-					     struct input_dev *dev,
-					     const struct input_device_id *id)
-{
-	struct input_handle *handle;
-	int error;
-
-	pr_info("%s: connect to %s\n", __func__, dev->name);
-	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
-	if (!handle)
-		return -ENOMEM;
-
-	handle->dev = dev;
-	handle->handler = handler;
-	handle->name = "cpufreq_interactive";
-
-	error = input_register_handle(handle);
-	if (error)
-		goto err;
-
-	inputopen.handle = handle;
-	queue_work(down_wq, &inputopen.inputopen_work);
-	return 0;
-err:
-	kfree(handle);
-	return error;
-}
-
-static void cpufreq_interactive_input_disconnect(struct input_handle *handle)
-{
-	input_close_device(handle);
-	input_unregister_handle(handle);
-	kfree(handle);
-}
-
-static const struct input_device_id cpufreq_interactive_ids[] = {
-	{
-		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
-			 INPUT_DEVICE_ID_MATCH_ABSBIT,
-		.evbit = { BIT_MASK(EV_ABS) },
-		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
-			    BIT_MASK(ABS_MT_POSITION_X) |
-			    BIT_MASK(ABS_MT_POSITION_Y) },
-	}, /* multi-touch touchscreen */
-	{
-		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
-			 INPUT_DEVICE_ID_MATCH_ABSBIT,
-		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
-		.absbit = { [BIT_WORD(ABS_X)] =
-			    BIT_MASK(ABS_X) | BIT_MASK(ABS_Y) },
-	}, /* touchpad */
-	{ },
-};
-
-static struct input_handler cpufreq_interactive_input_handler = {
-	.event          = cpufreq_interactive_input_event,
-	.connect        = cpufreq_interactive_input_connect,
-	.disconnect     = cpufreq_interactive_input_disconnect,
-	.name           = "cpufreq_interactive",
-	.id_table       = cpufreq_interactive_ids,
+static struct notifier_block cpufreq_interactive_input_nb = {
+	.notifier_call = cpufreq_interactive_input_boost,
 };
 
 static ssize_t show_hispeed_freq(struct kobject *kobj,
@@ -640,27 +738,151 @@ static ssize_t store_min_sample_time(struct kobject *kobj,
 static struct global_attr min_sample_time_attr = __ATTR(min_sample_time, 0644,
 		show_min_sample_time, store_min_sample_time);
 
+/*
+ * Parse a "value freq:value freq:value" table: an odd number of unsigned
+ * values separated by spaces or colons, frequencies ascending.
+ */
+static unsigned int *get_tokenized_data(const char *buf, int *num_tokens)
+{
+	const char *cp;
+	int i;
+	int ntokens = 1;
+	unsigned int *tokenized_data;
+	int err = -EINVAL;
+
+	cp = buf;
+	while ((cp = strpbrk(cp + 1, " :")))
+		ntokens++;
+
+	if (!(ntokens & 0x1))
+		goto err;
+
+	tokenized_data = kmalloc(ntokens * sizeof(unsigned int), GFP_KERNEL);
+	if (!tokenized_data) {
+		err = -ENOMEM;
+		goto err;
+	}
+
+	cp = buf;
+	i = 0;
+	while (i < ntokens) {
+		if (sscanf(cp, "%u", &tokenized_data[i++]) != 1)
+			goto err_kfree;
+
+		cp = strpbrk(cp, " :");
+		if (!cp)
+			break;
+		cp++;
+	}
+
+	if (i != ntokens)
+		goto err_kfree;
+
+	for (i = 3; i < ntokens; i += 2)
+		if (tokenized_data[i] <= tokenized_data[i - 2])
+			goto err_kfree;
+
+	*num_tokens = ntokens;
+	return tokenized_data;
+
+err_kfree:
+	kfree(tokenized_data);
+err:
+	return ERR_PTR(err);
+}
+
+static ssize_t show_table(spinlock_t *lock, unsigned int *table,
+			  int ntokens, char *buf)
+{
+	int i;
+	ssize_t ret = 0;
+	unsigned long flags;
+
+	spin_lock_irqsave(lock, flags);
+	for (i = 0; i < ntokens; i++)
+		ret += sprintf(buf + ret, "%u%s", table[i],
+			       i & 0x1 ? ":" : " ");
+	spin_unlock_irqrestore(lock, flags);
+
+	sprintf(buf + ret - 1, "\n");
+	return ret;
+}
+
+static ssize_t store_table(spinlock_t *lock, unsigned int **table,
+			   int *ntokens, unsigned int *default_table,
+			   const char *buf, size_t count)
+{
+	int ntokens_new;
+	unsigned int *new_table, *old_table;
+	unsigned long flags;
+
+	new_table = get_tokenized_data(buf, &ntokens_new);
+	if (IS_ERR(new_table))
+		return PTR_ERR(new_table);
+
+	spin_lock_irqsave(lock, flags);
+	old_table = *table;
+	*table = new_table;
+	*ntokens = ntokens_new;
+	spin_unlock_irqrestore(lock, flags);
+
+	if (old_table != default_table)
+		kfree(old_table);
+	return count;
+}
+
+static ssize_t show_target_loads(struct kobject *kobj,
+				 struct attribute *attr, char *buf)
+{
+	return show_table(&target_loads_lock, target_loads, ntarget_loads,
+			  buf);
+}
+
+static ssize_t store_target_loads(struct kobject *kobj,
+				  struct attribute *attr, const char *buf,
+				  size_t count)
+{
+	int i;
+	unsigned int *new_table;
+	int ntokens;
+
+	/* A zero target load would divide by zero in choose_freq() */
+	new_table = get_tokenized_data(buf, &ntokens);
+	if (IS_ERR(new_table))
+		return PTR_ERR(new_table);
+	for (i = 0; i < ntokens; i += 2) {
+		if (!new_table[i] || new_table[i] > 100) {
+			kfree(new_table);
+			return -EINVAL;
+		}
+	}
+	kfree(new_table);
+
+	return store_table(&target_loads_lock, &target_loads, &ntarget_loads,
+			   default_target_loads, buf, count);
+}
+
+static struct global_attr target_loads_attr = __ATTR(target_loads, 0644,
+		show_target_loads, store_target_loads);
+
 static ssize_t show_above_hispeed_delay(struct kobject *kobj,
 					struct attribute *attr, char *buf)
 {
-	return sprintf(buf, "%lu\n", above_hispeed_delay_val);
+	return show_table(&above_hispeed_delay_lock, above_hispeed_delay,
+			  nabove_hispeed_delay, buf);
 }
 
 static ssize_t store_above_hispeed_delay(struct kobject *kobj,
 					 struct attribute *attr,
 					 const char *buf, size_t count)
 {
-	int ret;
-	unsigned long val;
-
-	ret = strict_strtoul(buf, 0, &val);
-	if (ret < 0)
-		return ret;
-	above_hispeed_delay_val = val;
-	return count;
+	return store_table(&above_hispeed_delay_lock, &above_hispeed_delay,
+			   &nabove_hispeed_delay, default_above_hispeed_delay,
+			   buf, count);
 }
 
-define_one_global_rw(above_hispeed_delay);
+static struct global_attr above_hispeed_delay_attr = __ATTR(above_hispeed_delay, 0644,
+		show_above_hispeed_delay, store_above_hispeed_delay);
 
 static ssize_t show_timer_rate(struct kobject *kobj,
 			struct attribute *attr, char *buf)
@@ -748,15 +970,62 @@ static ssize_t store_boostpulse(struct kobject *kobj, struct attribute *attr,
 static struct global_attr boostpulse =
 	__ATTR(boostpulse, 0200, NULL, store_boostpulse);
 
+/* "freq sampled_us busy_us" per frequency; writing anything resets */
+static ssize_t show_freq_stats(struct kobject *kobj, struct attribute *attr,
+			       char *buf)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, 0);
+	struct cpufreq_interactive_freq_stat stat;
+	unsigned long flags;
+	ssize_t ret = 0;
+	int i;
+
+	if (!pcpu->freq_table)
+		return 0;
+
+	for (i = 0; i < MAX_FREQ_STATS &&
+		     pcpu->freq_table[i].frequency != CPUFREQ_TABLE_END; i++) {
+		if (pcpu->freq_table[i].frequency == CPUFREQ_ENTRY_INVALID)
+			continue;
+
+		spin_lock_irqsave(&freq_stats_lock, flags);
+		stat = freq_stats[i];
+		spin_unlock_irqrestore(&freq_stats_lock, flags);
+
+		ret += sprintf(buf + ret, "%u %llu %llu\n",
+			       pcpu->freq_table[i].frequency,
+			       stat.time, stat.busy);
+	}
+
+	return ret;
+}
+
+static ssize_t store_freq_stats(struct kobject *kobj, struct attribute *attr,
+				const char *buf, size_t count)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&freq_stats_lock, flags);
+	memset(freq_stats, 0, sizeof(freq_stats));
+	spin_unlock_irqrestore(&freq_stats_lock, flags);
+
+	return count;
+}
+
+static struct global_attr freq_stats_attr = __ATTR(freq_stats, 0644,
+		show_freq_stats, store_freq_stats);
+
 static struct attribute *interactive_attributes[] = {
+	&target_loads_attr.attr,
 	&hispeed_freq_attr.attr,
 	&go_hispeed_load_attr.attr,
-	&above_hispeed_delay.attr,
+	&above_hispeed_delay_attr.attr,
 	&min_sample_time_attr.attr,
 	&timer_rate_attr.attr,
 	&input_boost.attr,
 	&boost.attr,
 	&boostpulse.attr,
+	&freq_stats_attr.attr,
 	NULL,
 };
 
@@ -813,10 +1082,7 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 		if (rc)
 			return rc;
 
-		rc = input_register_handler(&cpufreq_interactive_input_handler);
-		if (rc)
-			pr_warn("%s: failed to register input handler\n",
-				__func__);
+		input_boost_register_notifier(&cpufreq_interactive_input_nb);
 
 		break;
 
@@ -840,7 +1106,7 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 		if (atomic_dec_return(&active_count) > 0)
 			return 0;
 
-		input_unregister_handler(&cpufreq_interactive_input_handler);
+		input_boost_unregister_notifier(&cpufreq_interactive_input_nb);
 		sysfs_remove_group(cpufreq_global_kobject,
 				&interactive_attr_group);
 
@@ -886,7 +1152,6 @@ static int __init cpufreq_interactive_init(void)
 
 	go_hispeed_load = DEFAULT_GO_HISPEED_LOAD;
 	min_sample_time = DEFAULT_MIN_SAMPLE_TIME;
-	above_hispeed_delay_val = DEFAULT_ABOVE_HISPEED_DELAY;
 	timer_rate = DEFAULT_TIMER_RATE;
 
 	/* Initalize per-cpu timers */
@@ -917,9 +1182,11 @@ static int __init cpufreq_interactive_init(void)
 
 	spin_lock_init(&up_cpumask_lock);
 	spin_lock_init(&down_cpumask_lock);
+	spin_lock_init(&target_loads_lock);
+	spin_lock_init(&above_hispeed_delay_lock);
+	spin_lock_init(&freq_stats_lock);
 
 	idle_notifier_register(&cpufreq_interactive_idle_nb);
-	INIT_WORK(&inputopen.inputopen_work, cpufreq_interactive_input_open);
 	return cpufreq_register_governor(&cpufreq_gov_interactive);
 
 err_freeuptask:
@@ -0,0 +1,295 @@
+/*
+ *  linux/drivers/cpufreq/cpufreq_load.c
+ *
+ *  CPU load tracking shared by the cpufreq governors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Each CPU has one deferrable timer sampling the load for all the
+ * governor clients subscribed to it, instead of one timer per governor.
+ * The idle notifier restarts the windows a long idle period left
+ * behind, so sampling resumes with the work that ended the idle period.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/cpufreq_load.h>
+#include <linux/jiffies.h>
+#include <linux/kernel_stat.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+#include <linux/tick.h>
+#include <linux/timer.h>
+
+struct cpufreq_load_cpu {
+	spinlock_t lock;		/* protects clients and their windows */
+	struct list_head clients;
+	struct timer_list timer;
+	unsigned long period;		/* shortest client period, jiffies */
+};
+
+static DEFINE_PER_CPU(struct cpufreq_load_cpu, cpufreq_load_cpu);
+
+static u64 get_cpu_idle_time_jiffy(unsigned int cpu, u64 *wall)
+{
+	cputime64_t idle_time;
+	cputime64_t cur_wall_time;
+	cputime64_t busy_time;
+
+	cur_wall_time = jiffies64_to_cputime64(get_jiffies_64());
+	busy_time = cputime64_add(kstat_cpu(cpu).cpustat.user,
+			kstat_cpu(cpu).cpustat.system);
+
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.irq);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.softirq);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.steal);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.nice);
+
+	idle_time = cputime64_sub(cur_wall_time, busy_time);
+	if (wall)
+		*wall = jiffies_to_usecs(cur_wall_time);
+
+	return jiffies_to_usecs(idle_time);
+}
+
+/*
+ * Idle time of a CPU in usecs, and the current time in wall. Falls back
+ * to the tick based accounting when NO_HZ idle accounting is disabled.
+ */
+u64 cpufreq_load_idle_time(unsigned int cpu, u64 *wall)
+{
+	u64 idle_time = get_cpu_idle_time_us(cpu, wall);
+
+	if (idle_time == -1ULL)
+		return get_cpu_idle_time_jiffy(cpu, wall);
+
+	return idle_time;
+}
+EXPORT_SYMBOL_GPL(cpufreq_load_idle_time);
+
+static void window_end(struct cpufreq_load_window *window, u64 idle,
+		       u64 wall, struct cpufreq_load_stat *stat)
+{
+	stat->now = wall;
+	stat->delta_time = (unsigned int)(wall - window->wall);
+	stat->delta_idle = (unsigned int)(idle - window->idle);
+
+	if (!stat->delta_time || stat->delta_idle > stat->delta_time)
+		stat->load = 0;
+	else
+		stat->load = 100 * (stat->delta_time - stat->delta_idle) /
+			stat->delta_time;
+
+	window->wall = wall;
+	window->idle = idle;
+}
+
+void cpufreq_load_window_start(unsigned int cpu,
+			       struct cpufreq_load_window *window)
+{
+	window->idle = cpufreq_load_idle_time(cpu, &window->wall);
+}
+EXPORT_SYMBOL_GPL(cpufreq_load_window_start);
+
+/* Load of the window since it started, and start the next one */
+void cpufreq_load_window_end(unsigned int cpu,
+			     struct cpufreq_load_window *window,
+			     struct cpufreq_load_stat *stat)
+{
+	u64 wall;
+	u64 idle = cpufreq_load_idle_time(cpu, &wall);
+
+	window_end(window, idle, wall, stat);
+}
+EXPORT_SYMBOL_GPL(cpufreq_load_window_end);
+
+static void cpufreq_load_update_period(struct cpufreq_load_cpu *lc)
+{
+	struct cpufreq_load_client *client;
+	unsigned int period_us = UINT_MAX;
+
+	list_for_each_entry(client, &lc->clients, node)
+		period_us = min(period_us, client->period_us);
+
+	lc->period = max(usecs_to_jiffies(period_us), 1UL);
+}
+
+static void cpufreq_load_sample(unsigned int cpu, struct cpufreq_load_cpu *lc)
+{
+	struct cpufreq_load_client *client;
+	struct cpufreq_load_stat stat;
+	u64 wall;
+	u64 idle = cpufreq_load_idle_time(cpu, &wall);
+
+	list_for_each_entry(client, &lc->clients, node) {
+		/* Shorter than a millisecond: wait for the next sample */
+		if (wall - client->window.wall < USEC_PER_MSEC ||
+		    wall - client->window.wall + TICK_USEC / 2 <
+		    client->period_us)
+			continue;
+
+		window_end(&client->window, idle, wall, &stat);
+		client->update(client, &stat);
+	}
+}
+
+static void cpufreq_load_timer(unsigned long data)
+{
+	unsigned int cpu = data;
+	struct cpufreq_load_cpu *lc = &per_cpu(cpufreq_load_cpu, cpu);
+	unsigned long flags;
+
+	spin_lock_irqsave(&lc->lock, flags);
+	if (!list_empty(&lc->clients)) {
+		cpufreq_load_sample(cpu, lc);
+		mod_timer_pinned(&lc->timer, jiffies + lc->period);
+	}
+	spin_unlock_irqrestore(&lc->lock, flags);
+}
+
+/*
+ * Leaving idle means the runqueue got work: windows the deferred timer
+ * let grow past twice their period only hold the idle period, so start
+ * over instead of reporting a load that no longer applies.
+ */
+static void cpufreq_load_idle_end(void)
+{
+	unsigned int cpu = smp_processor_id();
+	struct cpufreq_load_cpu *lc = &per_cpu(cpufreq_load_cpu, cpu);
+	struct cpufreq_load_client *client;
+	unsigned long flags;
+	bool restarted = false;
+	u64 wall, idle;
+
+	if (list_empty(&lc->clients))
+		return;
+
+	spin_lock_irqsave(&lc->lock, flags);
+	idle = cpufreq_load_idle_time(cpu, &wall);
+	list_for_each_entry(client, &lc->clients, node) {
+		if (wall - client->window.wall < 2 * client->period_us)
+			continue;
+
+		client->window.wall = wall;
+		client->window.idle = idle;
+		restarted = true;
+	}
+
+	if (restarted)
+		mod_timer_pinned(&lc->timer, jiffies + lc->period);
+	spin_unlock_irqrestore(&lc->lock, flags);
+}
+
+static int cpufreq_load_idle_notifier(struct notifier_block *nb,
+				      unsigned long val, void *data)
+{
+	if (val == IDLE_END)
+		cpufreq_load_idle_end();
+
+	return 0;
+}
+
+static struct notifier_block cpufreq_load_idle_nb = {
+	.notifier_call = cpufreq_load_idle_notifier,
+};
+
+/* Start sampling the load of cpu for client, every client->period_us */
+int cpufreq_load_register(struct cpufreq_load_client *client,
+			  unsigned int cpu)
+{
+	struct cpufreq_load_cpu *lc = &per_cpu(cpufreq_load_cpu, cpu);
+	unsigned long flags;
+
+	if (!client->update || !client->period_us)
+		return -EINVAL;
+
+	client->cpu = cpu;
+
+	spin_lock_irqsave(&lc->lock, flags);
+	cpufreq_load_window_start(cpu, &client->window);
+	list_add_tail(&client->node, &lc->clients);
+	cpufreq_load_update_period(lc);
+
+	if (timer_pending(&lc->timer)) {
+		mod_timer_pinned(&lc->timer, min(lc->timer.expires,
+						 jiffies + lc->period));
+	} else {
+		lc->timer.expires = jiffies + lc->period;
+		add_timer_on(&lc->timer, cpu);
+	}
+	spin_unlock_irqrestore(&lc->lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(cpufreq_load_register);
+
+/* Once this returns, update() is no longer running for client */
+void cpufreq_load_unregister(struct cpufreq_load_client *client)
+{
+	struct cpufreq_load_cpu *lc = &per_cpu(cpufreq_load_cpu, client->cpu);
+	unsigned long flags;
+	bool empty;
+
+	spin_lock_irqsave(&lc->lock, flags);
+	list_del(&client->node);
+	empty = list_empty(&lc->clients);
+	if (!empty)
+		cpufreq_load_update_period(lc);
+	spin_unlock_irqrestore(&lc->lock, flags);
+
+	if (empty)
+		del_timer_sync(&lc->timer);
+}
+EXPORT_SYMBOL_GPL(cpufreq_load_unregister);
+
+/* Drop the current window of client, e.g. after changing the frequency */
+void cpufreq_load_restart(struct cpufreq_load_client *client)
+{
+	struct cpufreq_load_cpu *lc = &per_cpu(cpufreq_load_cpu, client->cpu);
+	unsigned long flags;
+
+	spin_lock_irqsave(&lc->lock, flags);
+	cpufreq_load_window_start(client->cpu, &client->window);
+	spin_unlock_irqrestore(&lc->lock, flags);
+}
+EXPORT_SYMBOL_GPL(cpufreq_load_restart);
+
+void cpufreq_load_set_period(struct cpufreq_load_client *client,
+			     unsigned int period_us)
+{
+	struct cpufreq_load_cpu *lc = &per_cpu(cpufreq_load_cpu, client->cpu);
+	unsigned long flags;
+
+	if (!period_us)
+		return;
+
+	spin_lock_irqsave(&lc->lock, flags);
+	client->period_us = period_us;
+	cpufreq_load_update_period(lc);
+	spin_unlock_irqrestore(&lc->lock, flags);
+}
+EXPORT_SYMBOL_GPL(cpufreq_load_set_period);
+
+static int __init cpufreq_load_init(void)
+{
+	unsigned int i;
+	struct cpufreq_load_cpu *lc;
+
+	for_each_possible_cpu(i) {
+		lc = &per_cpu(cpufreq_load_cpu, i);
+		spin_lock_init(&lc->lock);
+		INIT_LIST_HEAD(&lc->clients);
+		init_timer_deferrable(&lc->timer);
+		lc->timer.function = cpufreq_load_timer;
+		lc->timer.data = i;
+		lc->period = 1;
+	}
+
+	idle_notifier_register(&cpufreq_load_idle_nb);
+	return 0;
+}
+core_initcall(cpufreq_load_init);
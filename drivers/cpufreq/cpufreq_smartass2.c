@@ -27,9 +27,9 @@
 #include <linux/cpu.h>
 #include <linux/cpumask.h>
 #include <linux/cpufreq.h>
+#include <linux/cpufreq_load.h>
 #include <linux/sched.h>
 #include <linux/tick.h>
-#include <linux/timer.h>
 #include <linux/workqueue.h>
 #include <linux/moduleparam.h>
 #include <asm/cputime.h>
@@ -116,15 +116,12 @@ static unsigned int smooth_ui;
 
 extern unsigned int touch_state_val;
 
-static void (*pm_idle_old)(void);
 static atomic_t active_count = ATOMIC_INIT(0);
 
 struct smartass_info_s {
 	struct cpufreq_policy *cur_policy;
 	struct cpufreq_frequency_table *freq_table;
-	struct timer_list timer;
-	u64 time_in_idle;
-	u64 idle_exit_time;
+	struct cpufreq_load_client load;
 	u64 freq_change_time;
 	u64 freq_change_time_in_idle;
 	int cur_cpu_load;
@@ -202,11 +199,6 @@ inline static unsigned int validate_freq(struct cpufreq_policy *policy, int freq
 	return freq;
 }
 
-inline static void reset_timer(unsigned long cpu, struct smartass_info_s *this_smartass) {
-	this_smartass->time_in_idle = get_cpu_idle_time_us(cpu, &this_smartass->idle_exit_time);
-	mod_timer(&this_smartass->timer, jiffies + sample_rate_jiffies);
-}
-
 inline static void work_cpumask_set(unsigned long cpu) {
 	unsigned long flags;
 	spin_lock_irqsave(&cpumask_lock, flags);
@@ -214,6 +206,15 @@ inline static void work_cpumask_set(unsigned long cpu) {
 	spin_unlock_irqrestore(&cpumask_lock, flags);
 }
 
+inline static int work_cpumask_test(unsigned long cpu) {
+	unsigned long flags;
+	int res = 0;
+	spin_lock_irqsave(&cpumask_lock, flags);
+	res = cpumask_test_cpu(cpu, &work_cpumask);
+	spin_unlock_irqrestore(&cpumask_lock, flags);
+	return res;
+}
+
 inline static int work_cpumask_test_and_clear(unsigned long cpu) {
 	unsigned long flags;
 	int res = 0;
@@ -272,41 +273,25 @@ inline static int target_freq(struct cpufreq_policy *policy, struct smartass_inf
 	return target;
 }
 
-static void cpufreq_smartass_timer(unsigned long cpu)
+static void cpufreq_smartass_update(struct cpufreq_load_client *client,
+				    const struct cpufreq_load_stat *stat)
 {
-	u64 delta_idle;
-	u64 delta_time;
-	int cpu_load;
+	u64 delta_idle = stat->delta_idle;
+	int cpu_load = stat->load;
 	int old_freq;
-	u64 update_time;
-	u64 now_idle;
-	int queued_work = 0;
+	u64 update_time = stat->now;
+	unsigned int cpu = client->cpu;
 	struct smartass_info_s *this_smartass = &per_cpu(smartass_info, cpu);
 	struct cpufreq_policy *policy = this_smartass->cur_policy;
 
-	now_idle = get_cpu_idle_time_us(cpu, &update_time);
-	old_freq = policy->cur;
-
-	if (this_smartass->idle_exit_time == 0 || update_time == this_smartass->idle_exit_time)
-		return;
-
-	delta_idle = cputime64_sub(now_idle, this_smartass->time_in_idle);
-	delta_time = cputime64_sub(update_time, this_smartass->idle_exit_time);
-
-	// If timer ran less than 1ms after short-term sample started, retry.
-	if (delta_time < 1000) {
-		if (!timer_pending(&this_smartass->timer))
-			reset_timer(cpu,this_smartass);
+	// The work task restarts the sample once it has done its adjustments.
+	if (!this_smartass->enable || work_cpumask_test(cpu))
 		return;
-	}
 
-	if (delta_idle > delta_time)
-		cpu_load = 0;
-	else
-		cpu_load = 100 * (unsigned int)(delta_time - delta_idle) / (unsigned int)delta_time;
+	old_freq = policy->cur;
 
-	dprintk(SMARTASS_DEBUG_LOAD,"smartassT @ %d: load %d (delta_time %llu)\n",
-		old_freq,cpu_load,delta_time);
+	dprintk(SMARTASS_DEBUG_LOAD,"smartassT @ %d: load %d (delta_time %u)\n",
+		old_freq,cpu_load,stat->delta_time);
 
 	this_smartass->cur_cpu_load = cpu_load;
 	this_smartass->old_freq = old_freq;
@@ -325,7 +310,6 @@ static void cpufreq_smartass_timer(unsigned long cpu)
 			this_smartass->ramp_dir = 1;
 			work_cpumask_set(cpu);
 			queue_work(up_wq, &freq_scale_work);
-			queued_work = 1;
 		}
 		else this_smartass->ramp_dir = 0;
 	}
@@ -340,36 +324,8 @@ static void cpufreq_smartass_timer(unsigned long cpu)
 		this_smartass->ramp_dir = -1;
 		work_cpumask_set(cpu);
 		queue_work(down_wq, &freq_scale_work);
-		queued_work = 1;
 	}
 	else this_smartass->ramp_dir = 0;
-
-	// To avoid unnecessary load when the CPU is already at high load, we don't
-	// reset ourselves if we are at max speed. If and when there are idle cycles,
-	// the idle loop will activate the timer.
-	// Additionally, if we queued some work, the work task will reset the timer
-	// after it has done its adjustments.
-	if (!queued_work && old_freq < policy->max)
-		reset_timer(cpu,this_smartass);
-}
-
-static void cpufreq_idle(void)
-{
-	struct smartass_info_s *this_smartass = &per_cpu(smartass_info, smp_processor_id());
-	struct cpufreq_policy *policy = this_smartass->cur_policy;
-
-	if (!this_smartass->enable) {
-		pm_idle_old();
-		return;
-	}
-
-	if (policy->cur == policy->min && timer_pending(&this_smartass->timer))
-		del_timer(&this_smartass->timer);
-
-	pm_idle_old();
-
-	if (!timer_pending(&this_smartass->timer))
-		reset_timer(smp_processor_id(), this_smartass);
 }
 
 /* We use the same work function to sale up and down */
@@ -447,13 +403,8 @@ static void cpufreq_smartass_freq_change_time_work(struct work_struct *work)
 			this_smartass->freq_change_time_in_idle =
 				get_cpu_idle_time_us(cpu,&this_smartass->freq_change_time);
 
-		// reset timer:
-		if (new_freq < policy->max)
-			reset_timer(cpu,this_smartass);
-		// if we are maxed out, it is pointless to use the timer
-		// (idle cycles wake up the timer when the timer comes)
-		else if (timer_pending(&this_smartass->timer))
-			del_timer(&this_smartass->timer);
+		// start a new sample at the new frequency:
+		cpufreq_load_restart(&this_smartass->load);
 	}
 }
 
@@ -562,9 +513,17 @@ static ssize_t store_sample_rate_jiffies(struct kobject *kobj, struct attribute
 {
 	ssize_t res;
 	unsigned long input;
+	unsigned int i;
 	res = strict_strtoul(buf, 0, &input);
-	if (res >= 0 && input > 0 && input <= 1000)
+	if (res >= 0 && input > 0 && input <= 1000) {
 		sample_rate_jiffies = input;
+		for_each_online_cpu(i) {
+			struct smartass_info_s *this_smartass = &per_cpu(smartass_info, i);
+			if (this_smartass->enable)
+				cpufreq_load_set_period(&this_smartass->load,
+							jiffies_to_usecs(sample_rate_jiffies));
+		}
+	}
 	return count;
 }
 
@@ -707,20 +666,19 @@ static int cpufreq_governor_smartass(struct cpufreq_policy *new_policy,
 
 		smp_wmb();
 
-		// Do not register the idle hook and create sysfs
-		// entries if we have already done so.
+		// Do not create sysfs entries if we have already done so.
 		if (atomic_inc_return(&active_count) <= 1) {
 			rc = sysfs_create_group(cpufreq_global_kobject,
 						&smartass_attr_group);
 			if (rc)
 				return rc;
-
-			pm_idle_old = pm_idle;
-			pm_idle = cpufreq_idle;
 		}
 
-		if (this_smartass->cur_policy->cur < new_policy->max && !timer_pending(&this_smartass->timer))
-			reset_timer(cpu,this_smartass);
+		this_smartass->load.update = cpufreq_smartass_update;
+		this_smartass->load.period_us = jiffies_to_usecs(sample_rate_jiffies);
+		rc = cpufreq_load_register(&this_smartass->load, cpu);
+		if (rc)
+			return rc;
 
 		break;
 
@@ -738,22 +696,19 @@ static int cpufreq_governor_smartass(struct cpufreq_policy *new_policy,
 						new_policy->min, CPUFREQ_RELATION_L);
 		}
 
-		if (this_smartass->cur_policy->cur < new_policy->max && !timer_pending(&this_smartass->timer))
-			reset_timer(cpu,this_smartass);
+		cpufreq_load_restart(&this_smartass->load);
 
 		break;
 
 	case CPUFREQ_GOV_STOP:
 		this_smartass->enable = 0;
 		smp_wmb();
-		del_timer(&this_smartass->timer);
+		cpufreq_load_unregister(&this_smartass->load);
 		flush_work(&freq_scale_work);
-		this_smartass->idle_exit_time = 0;
 
 		if (atomic_dec_return(&active_count) <= 1) {
 			sysfs_remove_group(cpufreq_global_kobject,
 					   &smartass_attr_group);
-			pm_idle = pm_idle_old;
 		}
 		break;
 	}
@@ -780,8 +735,8 @@ static void smartass_suspend(int cpu, int suspend)
 					CPUFREQ_RELATION_L);
 	} else {
 		// to avoid wakeup issues with quick sleep/wakeup don't change actual frequency when entering sleep
-		// to allow some time to settle down. Instead we just reset our statistics (and reset the timer).
-		// Eventually, the timer will adjust the frequency if necessary.
+		// to allow some time to settle down. Instead we just reset our statistics (and the sample).
+		// Eventually, the load sample will adjust the frequency if necessary.
 
 		this_smartass->freq_change_time_in_idle =
 			get_cpu_idle_time_us(cpu,&this_smartass->freq_change_time);
@@ -789,7 +744,7 @@ static void smartass_suspend(int cpu, int suspend)
 		dprintk(SMARTASS_DEBUG_JUMPS,"SmartassS: suspending at %d\n",policy->cur);
 	}
 
-	reset_timer(smp_processor_id(),this_smartass);
+	cpufreq_load_restart(&this_smartass->load);
 }
 
 static void smartass_early_suspend(struct early_suspend *handler) {
@@ -845,15 +800,9 @@ static int __init cpufreq_smartass_init(void)
 		this_smartass->enable = 0;
 		this_smartass->cur_policy = 0;
 		this_smartass->ramp_dir = 0;
-		this_smartass->time_in_idle = 0;
-		this_smartass->idle_exit_time = 0;
 		this_smartass->freq_change_time = 0;
 		this_smartass->freq_change_time_in_idle = 0;
 		this_smartass->cur_cpu_load = 0;
-		// intialize timer:
-		init_timer_deferrable(&this_smartass->timer);
-		this_smartass->timer.function = cpufreq_smartass_timer;
-		this_smartass->timer.data = i;
 		work_cpumask_test_and_clear(i);
 	}
 
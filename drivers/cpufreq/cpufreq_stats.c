@@ -21,9 +21,44 @@
 #include <linux/spinlock.h>
 #include <linux/notifier.h>
 #include <asm/cputime.h>
+#ifdef CONFIG_CPU_FREQ_STAT_LATENCY
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#endif
 
 static spinlock_t cpufreq_stats_lock;
 
+#ifdef CONFIG_CPU_FREQ_STAT_LATENCY
+/*
+ * Latency bucket 0 counts latencies under 1us, bucket n those in
+ * [2^(n-1), 2^n) us and the last one everything above.
+ */
+#define CPUFREQ_STATS_LAT_BUCKETS	16
+#define CPUFREQ_STATS_BIN_MAGIC		0x43465354	/* "CFST" */
+#define CPUFREQ_STATS_BIN_VERSION	1
+
+/*
+ * Record read from debugfs cpufreq_stats/cpuN, in native byte order:
+ * this header, then u64 time_in_state[state_num] in USER_HZ ticks,
+ * u32 freq[state_num] in kHz, u32 trans_lat[nr_buckets] for the driver
+ * transition and u32 request_lat[nr_buckets] from the governor request.
+ * The latency histograms restart whenever the governor changes.
+ */
+struct cpufreq_stats_bin_header {
+	u32 magic;
+	u32 version;
+	u32 state_num;
+	u32 nr_buckets;
+	u32 total_trans;
+	u32 reserved;
+	char governor[CPUFREQ_NAME_LEN];
+};
+
+static struct dentry *cpufreq_stats_debugfs;
+#endif
+
 #define CPUFREQ_STATDEVICE_ATTR(_name, _mode, _show) \
 static struct freq_attr _attr_##_name = {\
 	.attr = {.name = __stringify(_name), .mode = _mode, }, \
@@ -42,6 +77,13 @@ struct cpufreq_stats {
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	unsigned int *trans_table;
 #endif
+#ifdef CONFIG_CPU_FREQ_STAT_LATENCY
+	u64 trans_start;		/* ns, 0 outside of a transition */
+	u32 trans_lat[CPUFREQ_STATS_LAT_BUCKETS];
+	u32 request_lat[CPUFREQ_STATS_LAT_BUCKETS];
+	char governor[CPUFREQ_NAME_LEN];
+	struct dentry *debugfs;
+#endif
 };
 
 static DEFINE_PER_CPU(struct cpufreq_stats *, cpufreq_stats_table);
@@ -156,6 +198,84 @@ static struct attribute_group stats_attr_group = {
 	.name = "stats"
 };
 
+#ifdef CONFIG_CPU_FREQ_STAT_LATENCY
+static void cpufreq_stats_lat_add(u32 *hist, u64 start, u64 end)
+{
+	unsigned int us = (unsigned int)min_t(u64,
+			div_u64(end - start, NSEC_PER_USEC), UINT_MAX);
+
+	hist[min(fls(us), CPUFREQ_STATS_LAT_BUCKETS - 1)]++;
+}
+
+static ssize_t cpufreq_stats_bin_read(struct file *file, char __user *ubuf,
+				      size_t count, loff_t *ppos)
+{
+	unsigned int cpu = (unsigned long)file->f_path.dentry->d_inode->i_private;
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, cpu);
+	struct cpufreq_stats_bin_header *hdr;
+	u64 *time_in_state;
+	u32 *freqs, *trans_lat, *request_lat;
+	size_t size;
+	ssize_t ret;
+	int i;
+
+	if (!stat)
+		return -ENODEV;
+	cpufreq_stats_update(stat->cpu);
+
+	size = sizeof(*hdr) + stat->state_num * (sizeof(u64) + sizeof(u32)) +
+		2 * CPUFREQ_STATS_LAT_BUCKETS * sizeof(u32);
+	hdr = kzalloc(size, GFP_KERNEL);
+	if (!hdr)
+		return -ENOMEM;
+
+	time_in_state = (u64 *)(hdr + 1);
+	freqs = (u32 *)(time_in_state + stat->state_num);
+	trans_lat = freqs + stat->state_num;
+	request_lat = trans_lat + CPUFREQ_STATS_LAT_BUCKETS;
+
+	hdr->magic = CPUFREQ_STATS_BIN_MAGIC;
+	hdr->version = CPUFREQ_STATS_BIN_VERSION;
+	hdr->state_num = stat->state_num;
+	hdr->nr_buckets = CPUFREQ_STATS_LAT_BUCKETS;
+
+	spin_lock(&cpufreq_stats_lock);
+	hdr->total_trans = stat->total_trans;
+	memcpy(hdr->governor, stat->governor, CPUFREQ_NAME_LEN);
+	for (i = 0; i < stat->state_num; i++) {
+		time_in_state[i] = cputime64_to_clock_t(stat->time_in_state[i]);
+		freqs[i] = stat->freq_table[i];
+	}
+	memcpy(trans_lat, stat->trans_lat, sizeof(stat->trans_lat));
+	memcpy(request_lat, stat->request_lat, sizeof(stat->request_lat));
+	spin_unlock(&cpufreq_stats_lock);
+
+	ret = simple_read_from_buffer(ubuf, count, ppos, hdr, size);
+	kfree(hdr);
+	return ret;
+}
+
+static const struct file_operations cpufreq_stats_bin_fops = {
+	.read = cpufreq_stats_bin_read,
+	.llseek = default_llseek,
+};
+
+static void cpufreq_stats_set_governor(struct cpufreq_policy *policy)
+{
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	const char *name = policy->governor ? policy->governor->name : "";
+
+	if (!stat || !strncmp(stat->governor, name, CPUFREQ_NAME_LEN))
+		return;
+
+	spin_lock(&cpufreq_stats_lock);
+	strncpy(stat->governor, name, CPUFREQ_NAME_LEN);
+	memset(stat->trans_lat, 0, sizeof(stat->trans_lat));
+	memset(stat->request_lat, 0, sizeof(stat->request_lat));
+	spin_unlock(&cpufreq_stats_lock);
+}
+#endif
+
 static int freq_table_get_index(struct cpufreq_stats *stat, unsigned int freq)
 {
 	int index;
@@ -172,6 +292,9 @@ static void cpufreq_stats_free_table(unsigned int cpu)
 {
 	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, cpu);
 	if (stat) {
+#ifdef CONFIG_CPU_FREQ_STAT_LATENCY
+		debugfs_remove(stat->debugfs);
+#endif
 		kfree(stat->time_in_state);
 		kfree(stat);
 	}
@@ -253,6 +376,17 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 	stat->last_time = get_jiffies_64();
 	stat->last_index = freq_table_get_index(stat, policy->cur);
 	spin_unlock(&cpufreq_stats_lock);
+#ifdef CONFIG_CPU_FREQ_STAT_LATENCY
+	if (cpufreq_stats_debugfs) {
+		char name[8];
+
+		snprintf(name, sizeof(name), "cpu%u", cpu);
+		stat->debugfs = debugfs_create_file(name, 0444,
+				cpufreq_stats_debugfs,
+				(void *)(unsigned long)cpu,
+				&cpufreq_stats_bin_fops);
+	}
+#endif
 	cpufreq_cpu_put(data);
 	return 0;
 error_out:
@@ -276,6 +410,10 @@ static int cpufreq_stat_notifier_policy(struct notifier_block *nb,
 	if (!table)
 		return 0;
 	ret = cpufreq_stats_create_table(policy, table);
+#ifdef CONFIG_CPU_FREQ_STAT_LATENCY
+	if (!ret || ret == -EBUSY)
+		cpufreq_stats_set_governor(policy);
+#endif
 	if (ret)
 		return ret;
 	return 0;
@@ -287,6 +425,27 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	struct cpufreq_freqs *freq = data;
 	struct cpufreq_stats *stat;
 	int old_index, new_index;
+#ifdef CONFIG_CPU_FREQ_STAT_LATENCY
+	u64 now, request;
+
+	stat = per_cpu(cpufreq_stats_table, freq->cpu);
+	if (!stat)
+		return 0;
+
+	now = ktime_to_ns(ktime_get());
+	if (val == CPUFREQ_PRECHANGE) {
+		stat->trans_start = now;
+	} else if (val == CPUFREQ_POSTCHANGE && stat->trans_start) {
+		request = cpufreq_request_time(freq->cpu);
+
+		spin_lock(&cpufreq_stats_lock);
+		cpufreq_stats_lat_add(stat->trans_lat, stat->trans_start, now);
+		if (request && request <= now)
+			cpufreq_stats_lat_add(stat->request_lat, request, now);
+		spin_unlock(&cpufreq_stats_lock);
+		stat->trans_start = 0;
+	}
+#endif
 
 	if (val != CPUFREQ_POSTCHANGE)
 		return 0;
@@ -385,6 +544,9 @@ static int __init cpufreq_stats_init(void)
 	unsigned int cpu;
 
 	spin_lock_init(&cpufreq_stats_lock);
+#ifdef CONFIG_CPU_FREQ_STAT_LATENCY
+	cpufreq_stats_debugfs = debugfs_create_dir("cpufreq_stats", NULL);
+#endif
 	ret = cpufreq_register_notifier(&notifier_policy_block,
 				CPUFREQ_POLICY_NOTIFIER);
 	if (ret)
@@ -395,6 +557,9 @@ static int __init cpufreq_stats_init(void)
 	if (ret) {
 		cpufreq_unregister_notifier(&notifier_policy_block,
 				CPUFREQ_POLICY_NOTIFIER);
+#ifdef CONFIG_CPU_FREQ_STAT_LATENCY
+		debugfs_remove(cpufreq_stats_debugfs);
+#endif
 		return ret;
 	}
 
@@ -417,6 +582,9 @@ static void __exit cpufreq_stats_exit(void)
 		cpufreq_stats_free_table(cpu);
 		cpufreq_stats_free_sysfs(cpu);
 	}
+#ifdef CONFIG_CPU_FREQ_STAT_LATENCY
+	debugfs_remove(cpufreq_stats_debugfs);
+#endif
 }
 
 MODULE_AUTHOR("Zou Nan hai <nanhai.zou@intel.com>");
@@ -15,6 +15,7 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/cpufreq.h>
+#include <linux/cpufreq_load.h>
 #include <linux/cpu.h>
 #include <linux/jiffies.h>
 #include <linux/kernel_stat.h>
@@ -131,39 +132,6 @@ static struct dbs_tuners {
     .allowed_misses = DEF_ALLOWED_MISSES,
 };
 
-static inline cputime64_t get_cpu_idle_time_jiffy(unsigned int cpu,
-						  cputime64_t *wall)
-{
-    cputime64_t idle_time;
-    cputime64_t cur_wall_time;
-    cputime64_t busy_time;
-
-    cur_wall_time = jiffies64_to_cputime64(get_jiffies_64());
-    busy_time = cputime64_add(kstat_cpu(cpu).cpustat.user,
-			      kstat_cpu(cpu).cpustat.system);
-
-    busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.irq);
-    busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.softirq);
-    busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.steal);
-    busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.nice);
-
-    idle_time = cputime64_sub(cur_wall_time, busy_time);
-    if (wall)
-	*wall = (cputime64_t)jiffies_to_usecs(cur_wall_time);
-
-    return (cputime64_t)jiffies_to_usecs(idle_time);
-}
-
-static inline cputime64_t get_cpu_idle_time(unsigned int cpu, cputime64_t *wall)
-{
-    u64 idle_time = get_cpu_idle_time_us(cpu, wall);
-
-    if (idle_time == -1ULL)
-	return get_cpu_idle_time_jiffy(cpu, wall);
-
-    return idle_time;
-}
-
 static inline cputime64_t get_cpu_iowait_time(unsigned int cpu, cputime64_t *wall)
 {
     u64 iowait_time = get_cpu_iowait_time_us(cpu, wall);
@@ -354,7 +322,7 @@ static ssize_t store_ignore_nice_load(struct kobject *a, struct attribute *b,
     for_each_online_cpu(j) {
 	struct cpu_dbs_info_s *dbs_info;
 	dbs_info = &per_cpu(od_cpu_dbs_info, j);
-	dbs_info->prev_cpu_idle = get_cpu_idle_time(j,
+	dbs_info->prev_cpu_idle = cpufreq_load_idle_time(j,
 						    &dbs_info->prev_cpu_wall);
 	if (dbs_tuners_ins.ignore_nice)
 	    dbs_info->prev_cpu_nice = kstat_cpu(j).cpustat.nice;
@@ -490,7 +458,7 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 
 	j_dbs_info = &per_cpu(od_cpu_dbs_info, j);
 
-	cur_idle_time = get_cpu_idle_time(j, &cur_wall_time);
+	cur_idle_time = cpufreq_load_idle_time(j, &cur_wall_time);
 	cur_iowait_time = get_cpu_iowait_time(j, &cur_wall_time);
 
 	wall_time = (unsigned int) cputime64_sub(cur_wall_time,
@@ -720,7 +688,7 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 	    j_dbs_info = &per_cpu(od_cpu_dbs_info, j);
 	    j_dbs_info->cur_policy = policy;
 
-	    j_dbs_info->prev_cpu_idle = get_cpu_idle_time(j,
+	    j_dbs_info->prev_cpu_idle = cpufreq_load_idle_time(j,
 							  &j_dbs_info->prev_cpu_wall);
 	    if (dbs_tuners_ins.ignore_nice) {
 		j_dbs_info->prev_cpu_nice =
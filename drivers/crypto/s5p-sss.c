@@ -143,7 +143,15 @@
 #define FLAGS_AES_CTR                   _SBF(1, 0x02)
 
 #define AES_KEY_LEN         16
-#define CRYPTO_QUEUE_LEN    1
+#define CRYPTO_QUEUE_LEN    32
+
+/*
+ * Below this many bytes, programming the engine and taking two interrupts
+ * costs more than doing the request on the CPU.
+ */
+static unsigned int fallback_bytes = 256;
+module_param(fallback_bytes, uint, 0644);
+MODULE_PARM_DESC(fallback_bytes, "Requests shorter than this are done in software");
 
 struct s5p_aes_reqctx {
 	unsigned long mode;
@@ -151,6 +159,7 @@ struct s5p_aes_reqctx {
 
 struct s5p_aes_ctx {
 	struct s5p_aes_dev         *dev;
+	struct crypto_blkcipher    *fallback;
 
 	uint8_t                     aes_key[AES_MAX_KEY_SIZE];
 	uint8_t                     nonce[CTR_RFC3686_NONCE_SIZE];
@@ -189,11 +198,14 @@ static void s5p_set_dma_outdata(struct s5p_aes_dev *dev, struct scatterlist *sg)
 	SSS_WRITE(dev, FCBTDMAL, sg_dma_len(sg));
 }
 
+/* Called without the lock, the tasklet goes on with the next request */
 static void s5p_aes_complete(struct s5p_aes_dev *dev, int err)
 {
-	/* holding a lock outside */
-	dev->req->base.complete(&dev->req->base, err);
-	dev->busy = false;
+	struct ablkcipher_request *req = dev->req;
+
+	dev->req = NULL;
+	req->base.complete(&req->base, err);
+	tasklet_schedule(&dev->tasklet);
 }
 
 static void s5p_unset_outdata(struct s5p_aes_dev *dev)
@@ -258,39 +270,39 @@ static int s5p_set_indata(struct s5p_aes_dev *dev, struct scatterlist *sg)
 	return err;
 }
 
-static void s5p_aes_tx(struct s5p_aes_dev *dev)
+/* 1 once the last output entry is done, 0 while more follow, or an error */
+static int s5p_aes_tx(struct s5p_aes_dev *dev)
 {
-	int err = 0;
+	int err;
 
 	s5p_unset_outdata(dev);
 
-	if (!sg_is_last(dev->sg_dst)) {
-		err = s5p_set_outdata(dev, sg_next(dev->sg_dst));
-		if (err) {
-			s5p_aes_complete(dev, err);
-			return;
-		}
+	if (sg_is_last(dev->sg_dst))
+		return 1;
 
-		s5p_set_dma_outdata(dev, dev->sg_dst);
-	} else
-		s5p_aes_complete(dev, err);
+	err = s5p_set_outdata(dev, sg_next(dev->sg_dst));
+	if (err)
+		return err;
+
+	s5p_set_dma_outdata(dev, dev->sg_dst);
+	return 0;
 }
 
-static void s5p_aes_rx(struct s5p_aes_dev *dev)
+static int s5p_aes_rx(struct s5p_aes_dev *dev)
 {
 	int err;
 
 	s5p_unset_indata(dev);
 
-	if (!sg_is_last(dev->sg_src)) {
-		err = s5p_set_indata(dev, sg_next(dev->sg_src));
-		if (err) {
-			s5p_aes_complete(dev, err);
-			return;
-		}
+	if (sg_is_last(dev->sg_src))
+		return 0;
 
-		s5p_set_dma_indata(dev, dev->sg_src);
-	}
+	err = s5p_set_indata(dev, sg_next(dev->sg_src));
+	if (err)
+		return err;
+
+	s5p_set_dma_indata(dev, dev->sg_src);
+	return 0;
 }
 
 static irqreturn_t s5p_aes_interrupt(int irq, void *dev_id)
@@ -299,21 +311,34 @@ static irqreturn_t s5p_aes_interrupt(int irq, void *dev_id)
 	struct s5p_aes_dev     *dev  = platform_get_drvdata(pdev);
 	uint32_t                status;
 	unsigned long           flags;
+	int                     err = 0;
 
 	spin_lock_irqsave(&dev->lock, flags);
 
-	if (irq == dev->irq_fc) {
+	if (irq == dev->irq_fc && dev->req) {
 		status = SSS_READ(dev, FCINTSTAT);
-		if (status & SSS_FCINTSTAT_BRDMAINT)
-			s5p_aes_rx(dev);
-		if (status & SSS_FCINTSTAT_BTDMAINT)
-			s5p_aes_tx(dev);
+		if (status & SSS_FCINTSTAT_BRDMAINT) {
+			err = s5p_aes_rx(dev);
+			/* the output entry in flight is left mapped */
+			if (err)
+				s5p_unset_outdata(dev);
+		}
+		if (!err && (status & SSS_FCINTSTAT_BTDMAINT))
+			err = s5p_aes_tx(dev);
 
 		SSS_WRITE(dev, FCINTPEND, status);
+
+		if (err < 0)
+			SSS_WRITE(dev, FCINTENCLR,
+				  SSS_FCINTENCLR_BTDMAINTENCLR |
+				  SSS_FCINTENCLR_BRDMAINTENCLR);
 	}
 
 	spin_unlock_irqrestore(&dev->lock, flags);
 
+	if (err)
+		s5p_aes_complete(dev, err > 0 ? 0 : err);
+
 	return IRQ_HANDLED;
 }
 
@@ -396,8 +421,8 @@ static void s5p_aes_crypt_start(struct s5p_aes_dev *dev, unsigned long mode)
 	s5p_unset_indata(dev);
 
  indata_error:
-	s5p_aes_complete(dev, err);
 	spin_unlock_irqrestore(&dev->lock, flags);
+	s5p_aes_complete(dev, err);
 }
 
 static void s5p_tasklet_cb(unsigned long data)
@@ -408,8 +433,14 @@ static void s5p_tasklet_cb(unsigned long data)
 	unsigned long flags;
 
 	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->req) {
+		spin_unlock_irqrestore(&dev->lock, flags);
+		return;
+	}
 	backlog   = crypto_get_backlog(&dev->queue);
 	async_req = crypto_dequeue_request(&dev->queue);
+	if (!async_req)
+		dev->busy = false;
 	spin_unlock_irqrestore(&dev->lock, flags);
 
 	if (!async_req)
@@ -429,25 +460,52 @@ static int s5p_aes_handle_req(struct s5p_aes_dev *dev,
 			      struct ablkcipher_request *req)
 {
 	unsigned long flags;
+	bool idle;
 	int err;
 
 	spin_lock_irqsave(&dev->lock, flags);
-	if (dev->busy) {
-		err = -EAGAIN;
-		spin_unlock_irqrestore(&dev->lock, flags);
-		goto exit;
-	}
-	dev->busy = true;
-
 	err = ablkcipher_enqueue_request(&dev->queue, req);
+	idle = !dev->busy;
+	dev->busy = true;
 	spin_unlock_irqrestore(&dev->lock, flags);
 
-	tasklet_schedule(&dev->tasklet);
+	/* otherwise the completion of the running request picks it up */
+	if (idle)
+		tasklet_schedule(&dev->tasklet);
 
- exit:
 	return err;
 }
 
+/* Whether every entry of sg covering nbytes can be fed to the engine */
+static bool s5p_aes_sg_ok(struct scatterlist *sg, unsigned int nbytes)
+{
+	for (; sg && nbytes; sg = sg_next(sg)) {
+		if (!sg->length || !IS_ALIGNED(sg->length, AES_BLOCK_SIZE))
+			return false;
+		nbytes -= min(nbytes, sg->length);
+	}
+
+	return true;
+}
+
+static int s5p_aes_fallback(struct ablkcipher_request *req, unsigned long mode)
+{
+	struct crypto_ablkcipher   *tfm = crypto_ablkcipher_reqtfm(req);
+	struct s5p_aes_ctx         *ctx = crypto_ablkcipher_ctx(tfm);
+	struct blkcipher_desc       desc;
+
+	desc.tfm   = ctx->fallback;
+	desc.info  = req->info;
+	desc.flags = req->base.flags;
+
+	if (mode & FLAGS_AES_DECRYPT)
+		return crypto_blkcipher_decrypt_iv(&desc, req->dst, req->src,
+						   req->nbytes);
+
+	return crypto_blkcipher_encrypt_iv(&desc, req->dst, req->src,
+					   req->nbytes);
+}
+
 static int s5p_aes_crypt(struct ablkcipher_request *req, unsigned long mode)
 {
 	struct crypto_ablkcipher   *tfm    = crypto_ablkcipher_reqtfm(req);
@@ -460,6 +518,11 @@ static int s5p_aes_crypt(struct ablkcipher_request *req, unsigned long mode)
 		return -EINVAL;
 	}
 
+	if (req->nbytes < fallback_bytes ||
+	    !s5p_aes_sg_ok(req->src, req->nbytes) ||
+	    !s5p_aes_sg_ok(req->dst, req->nbytes))
+		return s5p_aes_fallback(req, mode);
+
 	reqctx->mode = mode;
 
 	return s5p_aes_handle_req(dev, req);
@@ -470,12 +533,23 @@ static int s5p_aes_setkey(struct crypto_ablkcipher *cipher,
 {
 	struct crypto_tfm  *tfm = crypto_ablkcipher_tfm(cipher);
 	struct s5p_aes_ctx *ctx = crypto_tfm_ctx(tfm);
+	int                 err;
 
 	if (keylen != AES_KEYSIZE_128 &&
 	    keylen != AES_KEYSIZE_192 &&
 	    keylen != AES_KEYSIZE_256)
 		return -EINVAL;
 
+	crypto_blkcipher_clear_flags(ctx->fallback, CRYPTO_TFM_REQ_MASK);
+	crypto_blkcipher_set_flags(ctx->fallback,
+				   tfm->crt_flags & CRYPTO_TFM_REQ_MASK);
+	err = crypto_blkcipher_setkey(ctx->fallback, key, keylen);
+	tfm->crt_flags &= ~CRYPTO_TFM_RES_MASK;
+	tfm->crt_flags |= crypto_blkcipher_get_flags(ctx->fallback) &
+			  CRYPTO_TFM_RES_MASK;
+	if (err)
+		return err;
+
 	memcpy(ctx->aes_key, key, keylen);
 	ctx->keylen = keylen;
 
@@ -505,6 +579,14 @@ static int s5p_aes_cbc_decrypt(struct ablkcipher_request *req)
 static int s5p_aes_cra_init(struct crypto_tfm *tfm)
 {
 	struct s5p_aes_ctx  *ctx = crypto_tfm_ctx(tfm);
+	const char          *name = crypto_tfm_alg_name(tfm);
+
+	ctx->fallback = crypto_alloc_blkcipher(name, 0, CRYPTO_ALG_ASYNC |
+					       CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->fallback)) {
+		pr_err("s5p-sss: can't allocate fallback for %s\n", name);
+		return PTR_ERR(ctx->fallback);
+	}
 
 	ctx->dev = s5p_dev;
 	tfm->crt_ablkcipher.reqsize = sizeof(struct s5p_aes_reqctx);
@@ -512,19 +594,29 @@ static int s5p_aes_cra_init(struct crypto_tfm *tfm)
 	return 0;
 }
 
+static void s5p_aes_cra_exit(struct crypto_tfm *tfm)
+{
+	struct s5p_aes_ctx  *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_blkcipher(ctx->fallback);
+	ctx->fallback = NULL;
+}
+
 static struct crypto_alg algs[] = {
 	{
 		.cra_name		= "ecb(aes)",
 		.cra_driver_name	= "ecb-aes-s5p",
 		.cra_priority		= 100,
 		.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER |
-					  CRYPTO_ALG_ASYNC,
+					  CRYPTO_ALG_ASYNC |
+					  CRYPTO_ALG_NEED_FALLBACK,
 		.cra_blocksize		= AES_BLOCK_SIZE,
 		.cra_ctxsize		= sizeof(struct s5p_aes_ctx),
 		.cra_alignmask		= 0x0f,
 		.cra_type		= &crypto_ablkcipher_type,
 		.cra_module		= THIS_MODULE,
 		.cra_init		= s5p_aes_cra_init,
+		.cra_exit		= s5p_aes_cra_exit,
 		.cra_u.ablkcipher = {
 			.min_keysize	= AES_MIN_KEY_SIZE,
 			.max_keysize	= AES_MAX_KEY_SIZE,
@@ -538,13 +630,15 @@ static struct crypto_alg algs[] = {
 		.cra_driver_name	= "cbc-aes-s5p",
 		.cra_priority		= 100,
 		.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER |
-					  CRYPTO_ALG_ASYNC,
+					  CRYPTO_ALG_ASYNC |
+					  CRYPTO_ALG_NEED_FALLBACK,
 		.cra_blocksize		= AES_BLOCK_SIZE,
 		.cra_ctxsize		= sizeof(struct s5p_aes_ctx),
 		.cra_alignmask		= 0x0f,
 		.cra_type		= &crypto_ablkcipher_type,
 		.cra_module		= THIS_MODULE,
 		.cra_init		= s5p_aes_cra_init,
+		.cra_exit		= s5p_aes_cra_exit,
 		.cra_u.ablkcipher = {
 			.min_keysize	= AES_MIN_KEY_SIZE,
 			.max_keysize	= AES_MAX_KEY_SIZE,
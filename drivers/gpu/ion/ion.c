@@ -29,6 +29,10 @@
 #include <linux/seq_file.h>
 #include <linux/uaccess.h>
 #include <linux/debugfs.h>
+#include <linux/workqueue.h>
+
+#include <asm/cacheflush.h>
+#include <asm/outercache.h>
 
 #include "ion_priv.h"
 #define DEBUG
@@ -148,6 +152,11 @@ static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 	kref_init(&buffer->ref);
 
 	ret = heap->ops->allocate(heap, buffer, len, align, flags);
+	if (ret && (heap->flags & ION_HEAP_FLAG_DEFER_FREE)) {
+		/* the memory may still be waiting on the free list */
+		ion_heap_drain_free_list(heap);
+		ret = heap->ops->allocate(heap, buffer, len, align, flags);
+	}
 	if (ret) {
 		kfree(buffer);
 		return ERR_PTR(ret);
@@ -159,16 +168,63 @@ static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 	return buffer;
 }
 
+static void ion_buffer_release(struct ion_buffer *buffer)
+{
+	buffer->heap->ops->free(buffer);
+	kfree(buffer);
+}
+
+void ion_heap_drain_free_list(struct ion_heap *heap)
+{
+	struct ion_buffer *buffer;
+
+	spin_lock(&heap->free_lock);
+	while (!list_empty(&heap->free_list)) {
+		buffer = list_first_entry(&heap->free_list, struct ion_buffer,
+					  free_node);
+		list_del(&buffer->free_node);
+		spin_unlock(&heap->free_lock);
+
+		ion_buffer_release(buffer);
+
+		spin_lock(&heap->free_lock);
+	}
+	spin_unlock(&heap->free_lock);
+}
+
+static void ion_heap_free_work(struct work_struct *work)
+{
+	ion_heap_drain_free_list(container_of(work, struct ion_heap,
+					      free_work));
+}
+
+void ion_heap_init_deferred_free(struct ion_heap *heap)
+{
+	heap->flags |= ION_HEAP_FLAG_DEFER_FREE;
+	INIT_LIST_HEAD(&heap->free_list);
+	spin_lock_init(&heap->free_lock);
+	INIT_WORK(&heap->free_work, ion_heap_free_work);
+}
+
 static void ion_buffer_destroy(struct kref *kref)
 {
 	struct ion_buffer *buffer = container_of(kref, struct ion_buffer, ref);
 	struct ion_device *dev = buffer->dev;
+	struct ion_heap *heap = buffer->heap;
 
-	buffer->heap->ops->free(buffer);
 	mutex_lock(&dev->lock);
 	rb_erase(&buffer->node, &dev->buffers);
 	mutex_unlock(&dev->lock);
-	kfree(buffer);
+
+	if (heap->flags & ION_HEAP_FLAG_DEFER_FREE) {
+		spin_lock(&heap->free_lock);
+		list_add_tail(&buffer->free_node, &heap->free_list);
+		spin_unlock(&heap->free_lock);
+		queue_work(system_nrt_wq, &heap->free_work);
+		return;
+	}
+
+	ion_buffer_release(buffer);
 }
 
 static void ion_buffer_get(struct ion_buffer *buffer)
@@ -933,6 +989,53 @@ err:
 	return -ENFILE;
 }
 
+/* Beyond about the size of the caches, one flush of it all is cheaper */
+#define ION_CACHE_ALL_SIZE	(512 * 1024)
+
+static int ion_cache_ops(struct ion_client *client, struct ion_cache_data *data)
+{
+	struct ion_handle *handles[ION_CACHE_MAX_HANDLES];
+	struct ion_buffer *buffer;
+	size_t total = 0;
+	int i, ret = 0;
+
+	if (data->count > ION_CACHE_MAX_HANDLES || !data->op ||
+	    (data->op & ~ION_CACHE_FLUSH))
+		return -EINVAL;
+
+	if (copy_from_user(handles, (void __user *)data->handles,
+			   data->count * sizeof(struct ion_handle *)))
+		return -EFAULT;
+
+	mutex_lock(&client->lock);
+	for (i = 0; i < data->count; i++) {
+		if (!ion_handle_validate(client, handles[i])) {
+			ret = -EINVAL;
+			goto out;
+		}
+		buffer = handles[i]->buffer;
+		if (buffer->heap->ops->cache_op)
+			total += buffer->size;
+	}
+
+	/* an invalidate cannot be widened to lines we know nothing about */
+	if (data->op != ION_CACHE_INVALIDATE && total >= ION_CACHE_ALL_SIZE) {
+		flush_cache_all();
+		outer_flush_all();
+		goto out;
+	}
+
+	for (i = 0; i < data->count && !ret; i++) {
+		buffer = handles[i]->buffer;
+		if (buffer->heap->ops->cache_op)
+			ret = buffer->heap->ops->cache_op(buffer->heap, buffer,
+							  data->op);
+	}
+out:
+	mutex_unlock(&client->lock);
+	return ret;
+}
+
 static long ion_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	struct ion_client *client = filp->private_data;
@@ -1013,6 +1116,14 @@ static long ion_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 			return -EFAULT;
 		return dev->custom_ioctl(client, data.cmd, data.arg);
 	}
+	case ION_IOC_CACHE_OPS:
+	{
+		struct ion_cache_data data;
+
+		if (copy_from_user(&data, (void __user *)arg, sizeof(data)))
+			return -EFAULT;
+		return ion_cache_ops(client, &data);
+	}
 	default:
 		return -ENOTTY;
 	}
@@ -1097,6 +1208,9 @@ static int ion_debug_heap_show(struct seq_file *s, void *unused)
 		seq_printf(s, "%16.s %16u %16u\n", client->name, client->pid,
 			   size);
 	}
+
+	if (heap->ops->debug_show)
+		heap->ops->debug_show(heap, s);
 	return 0;
 }
 
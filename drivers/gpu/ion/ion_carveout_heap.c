@@ -147,6 +147,7 @@ struct ion_heap *ion_carveout_heap_create(struct ion_platform_heap *heap_data)
 		     -1);
 	carveout_heap->heap.ops = &carveout_heap_ops;
 	carveout_heap->heap.type = ION_HEAP_TYPE_CARVEOUT;
+	ion_heap_init_deferred_free(&carveout_heap->heap);
 
 	return &carveout_heap->heap;
 }
@@ -156,6 +157,8 @@ void ion_carveout_heap_destroy(struct ion_heap *heap)
 	struct ion_carveout_heap *carveout_heap =
 	     container_of(heap, struct  ion_carveout_heap, heap);
 
+	cancel_work_sync(&heap->free_work);
+	ion_heap_drain_free_list(heap);
 	gen_pool_destroy(carveout_heap->pool);
 	kfree(carveout_heap);
 	carveout_heap = NULL;
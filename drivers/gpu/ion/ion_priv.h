@@ -21,8 +21,12 @@
 #include <linux/mm_types.h>
 #include <linux/mutex.h>
 #include <linux/rbtree.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include <linux/ion.h>
 
+struct seq_file;
+
 struct ion_mapping;
 
 struct ion_dma_mapping {
@@ -54,6 +58,7 @@ struct ion_buffer *ion_handle_buffer(struct ion_handle *handle);
  * @vaddr:		the kenrel mapping if kmap_cnt is not zero
  * @dmap_cnt:		number of times the buffer is mapped for dma
  * @sglist:		the scatterlist for the buffer is dmap_cnt is not zero
+ * @free_node:		node in the heap's free_list once the buffer is released
 */
 struct ion_buffer {
 	struct kref ref;
@@ -71,6 +76,7 @@ struct ion_buffer {
 	void *vaddr;
 	int dmap_cnt;
 	struct scatterlist *sglist;
+	struct list_head free_node;
 };
 
 /**
@@ -84,6 +90,8 @@ struct ion_buffer {
  * @map_kernel		map memory to the kernel
  * @unmap_kernel	unmap memory to the kernel
  * @map_user		map memory to userspace
+ * @cache_op		optional, ION_CACHE_* maintenance of a cached buffer
+ * @debug_show		optional, heap specific lines of the heap's debugfs file
  */
 struct ion_heap_ops {
 	int (*allocate) (struct ion_heap *heap,
@@ -99,8 +107,17 @@ struct ion_heap_ops {
 	void (*unmap_kernel) (struct ion_heap *heap, struct ion_buffer *buffer);
 	int (*map_user) (struct ion_heap *mapper, struct ion_buffer *buffer,
 			 struct vm_area_struct *vma);
+	int (*cache_op) (struct ion_heap *heap, struct ion_buffer *buffer,
+			 unsigned int op);
+	int (*debug_show) (struct ion_heap *heap, struct seq_file *s);
 };
 
+/*
+ * The buffers of a heap with ION_HEAP_FLAG_DEFER_FREE are given back to
+ * the heap from a worker, so releasing a buffer costs its owner nothing.
+ */
+#define ION_HEAP_FLAG_DEFER_FREE	(1 << 0)
+
 /**
  * struct ion_heap - represents a heap in the system
  * @node:		rb node to put the heap on the device's tree of heaps
@@ -111,6 +128,10 @@ struct ion_heap_ops {
  *			allocating.  These are specified by platform data and
  *			MUST be unique
  * @name:		used for debugging
+ * @flags:		ION_HEAP_FLAG_*
+ * @free_list:		released buffers waiting for free_work
+ * @free_lock:		protects free_list
+ * @free_work:		gives the buffers on free_list back to the heap
  *
  * Represents a pool of memory from which buffers can be made.  In some
  * systems the only heap is regular system memory allocated via vmalloc.
@@ -124,6 +145,10 @@ struct ion_heap {
 	struct ion_heap_ops *ops;
 	int id;
 	const char *name;
+	unsigned long flags;
+	struct list_head free_list;
+	spinlock_t free_lock;
+	struct work_struct free_work;
 };
 
 /**
@@ -159,6 +184,18 @@ void ion_device_add_heap(struct ion_device *dev, struct ion_heap *heap);
 struct ion_heap *ion_heap_create(struct ion_platform_heap *);
 void ion_heap_destroy(struct ion_heap *);
 
+/**
+ * ion_heap_init_deferred_free - sets up ION_HEAP_FLAG_DEFER_FREE
+ * @heap:		the heap, from its create function
+ */
+void ion_heap_init_deferred_free(struct ion_heap *heap);
+
+/**
+ * ion_heap_drain_free_list - gives the released buffers back right away
+ * @heap:		the heap, with ION_HEAP_FLAG_DEFER_FREE set
+ */
+void ion_heap_drain_free_list(struct ion_heap *heap);
+
 struct ion_heap *ion_system_heap_create(struct ion_platform_heap *);
 void ion_system_heap_destroy(struct ion_heap *);
 
@@ -14,28 +14,211 @@
  *
  */
 
+#include <linux/dma-mapping.h>
 #include <linux/err.h>
+#include <linux/highmem.h>
 #include <linux/ion.h>
 #include <linux/mm.h>
 #include <linux/scatterlist.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 #include "ion_priv.h"
 
+/*
+ * Pages freed by the system heap are kept for the next allocations
+ * instead of going back to the page allocator. A worker zeroes them in
+ * the background, so an allocation normally only has to map pages that
+ * are ready, and the shrinker gives them back under memory pressure.
+ */
+#define ION_SYSTEM_POOL_MAX	((8 << 20) >> PAGE_SHIFT)	/* 8MB */
+
+struct ion_system_heap {
+	struct ion_heap heap;
+	spinlock_t lock;		/* protects the lists and counters */
+	struct list_head clean;		/* zeroed, ready to hand out */
+	struct list_head dirty;		/* freed, waiting for zero_work */
+	unsigned int nr_clean;
+	unsigned int nr_dirty;
+	struct work_struct zero_work;
+	struct shrinker shrinker;
+
+	/* statistics, in pages */
+	unsigned long hits;		/* taken zeroed from the pool */
+	unsigned long zeroed;		/* taken dirty, zeroed on allocation */
+	unsigned long misses;		/* allocated from the page allocator */
+	unsigned long shrunk;		/* given back by the shrinker */
+};
+
+static inline struct ion_system_heap *to_system_heap(struct ion_heap *heap)
+{
+	return container_of(heap, struct ion_system_heap, heap);
+}
+
+static struct page *ion_system_pool_get(struct ion_system_heap *sh)
+{
+	struct page *page = NULL;
+	bool dirty = false;
+
+	spin_lock(&sh->lock);
+	if (!list_empty(&sh->clean)) {
+		page = list_first_entry(&sh->clean, struct page, lru);
+		sh->nr_clean--;
+		sh->hits++;
+	} else if (!list_empty(&sh->dirty)) {
+		page = list_first_entry(&sh->dirty, struct page, lru);
+		sh->nr_dirty--;
+		sh->zeroed++;
+		dirty = true;
+	} else {
+		sh->misses++;
+	}
+	if (page)
+		list_del(&page->lru);
+	spin_unlock(&sh->lock);
+
+	if (!page)
+		return alloc_page(GFP_KERNEL | __GFP_HIGHMEM | __GFP_ZERO);
+
+	if (dirty)
+		clear_highpage(page);
+	return page;
+}
+
+/* Take back the pages on list, beyond the pool limit they are freed */
+static void ion_system_pool_put(struct ion_system_heap *sh,
+				struct list_head *list)
+{
+	struct page *page, *tmp;
+
+	spin_lock(&sh->lock);
+	while (!list_empty(list) &&
+	       sh->nr_clean + sh->nr_dirty < ION_SYSTEM_POOL_MAX) {
+		page = list_first_entry(list, struct page, lru);
+		list_move_tail(&page->lru, &sh->dirty);
+		sh->nr_dirty++;
+	}
+	spin_unlock(&sh->lock);
+
+	list_for_each_entry_safe(page, tmp, list, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+
+	queue_work(system_nrt_wq, &sh->zero_work);
+}
+
+static void ion_system_pool_zero(struct work_struct *work)
+{
+	struct ion_system_heap *sh =
+		container_of(work, struct ion_system_heap, zero_work);
+	struct page *page;
+
+	spin_lock(&sh->lock);
+	while (!list_empty(&sh->dirty)) {
+		page = list_first_entry(&sh->dirty, struct page, lru);
+		list_del(&page->lru);
+		sh->nr_dirty--;
+		spin_unlock(&sh->lock);
+
+		clear_highpage(page);
+		cond_resched();
+
+		spin_lock(&sh->lock);
+		list_add_tail(&page->lru, &sh->clean);
+		sh->nr_clean++;
+	}
+	spin_unlock(&sh->lock);
+}
+
+/* Dirty pages go first: they would cost a clear to hand out */
+static int ion_system_pool_shrink(struct shrinker *shrinker,
+				  struct shrink_control *sc)
+{
+	struct ion_system_heap *sh =
+		container_of(shrinker, struct ion_system_heap, shrinker);
+	unsigned long nr = sc->nr_to_scan;
+	struct page *page, *tmp;
+	LIST_HEAD(list);
+	int left;
+
+	spin_lock(&sh->lock);
+	for (; nr && sh->nr_dirty; nr--, sh->nr_dirty--) {
+		page = list_first_entry(&sh->dirty, struct page, lru);
+		list_move(&page->lru, &list);
+		sh->shrunk++;
+	}
+	for (; nr && sh->nr_clean; nr--, sh->nr_clean--) {
+		page = list_first_entry(&sh->clean, struct page, lru);
+		list_move(&page->lru, &list);
+		sh->shrunk++;
+	}
+	left = sh->nr_clean + sh->nr_dirty;
+	spin_unlock(&sh->lock);
+
+	list_for_each_entry_safe(page, tmp, &list, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+
+	return left;
+}
+
 static int ion_system_heap_allocate(struct ion_heap *heap,
 				     struct ion_buffer *buffer,
 				     unsigned long size, unsigned long align,
 				     unsigned long flags)
 {
-	buffer->priv_virt = vmalloc_user(size);
-	if (!buffer->priv_virt)
+	struct ion_system_heap *sh = to_system_heap(heap);
+	int npages = PAGE_ALIGN(size) >> PAGE_SHIFT;
+	struct page **pages;
+	LIST_HEAD(list);
+	int i;
+
+	pages = vmalloc(npages * sizeof(struct page *));
+	if (!pages)
 		return -ENOMEM;
+
+	for (i = 0; i < npages; i++) {
+		pages[i] = ion_system_pool_get(sh);
+		if (!pages[i])
+			goto err;
+	}
+
+	/* VM_USERMAP for remap_vmalloc_range() in map_user */
+	buffer->priv_virt = vmap(pages, npages, VM_MAP | VM_USERMAP,
+				 PAGE_KERNEL);
+	if (!buffer->priv_virt)
+		goto err;
+
+	vfree(pages);
 	return 0;
+
+err:
+	while (--i >= 0)
+		list_add_tail(&pages[i]->lru, &list);
+	ion_system_pool_put(sh, &list);
+	vfree(pages);
+	return -ENOMEM;
 }
 
 void ion_system_heap_free(struct ion_buffer *buffer)
 {
-	vfree(buffer->priv_virt);
+	struct ion_system_heap *sh = to_system_heap(buffer->heap);
+	int npages = PAGE_ALIGN(buffer->size) >> PAGE_SHIFT;
+	void *vaddr = buffer->priv_virt;
+	LIST_HEAD(list);
+	int i;
+
+	for (i = 0; i < npages; i++)
+		list_add_tail(&vmalloc_to_page(vaddr + i * PAGE_SIZE)->lru,
+			      &list);
+	vunmap(vaddr);
+
+	ion_system_pool_put(sh, &list);
 }
 
 struct scatterlist *ion_system_heap_map_dma(struct ion_heap *heap,
@@ -91,6 +274,49 @@ int ion_system_heap_map_user(struct ion_heap *heap, struct ion_buffer *buffer,
 	return remap_vmalloc_range(vma, buffer->priv_virt, vma->vm_pgoff);
 }
 
+static enum dma_data_direction ion_cache_dir(unsigned int op)
+{
+	switch (op) {
+	case ION_CACHE_CLEAN:
+		return DMA_TO_DEVICE;
+	case ION_CACHE_INVALIDATE:
+		return DMA_FROM_DEVICE;
+	default:
+		return DMA_BIDIRECTIONAL;
+	}
+}
+
+/* Mapping a page for dma does the cache maintenance for the direction */
+static int ion_system_heap_cache_op(struct ion_heap *heap,
+				    struct ion_buffer *buffer, unsigned int op)
+{
+	enum dma_data_direction dir = ion_cache_dir(op);
+	int npages = PAGE_ALIGN(buffer->size) >> PAGE_SHIFT;
+	void *vaddr = buffer->priv_virt;
+	int i;
+
+	for (i = 0; i < npages; i++, vaddr += PAGE_SIZE)
+		dma_map_page(NULL, vmalloc_to_page(vaddr), 0, PAGE_SIZE, dir);
+
+	return 0;
+}
+
+static int ion_system_heap_debug_show(struct ion_heap *heap,
+				      struct seq_file *s)
+{
+	struct ion_system_heap *sh = to_system_heap(heap);
+
+	spin_lock(&sh->lock);
+	seq_printf(s, "pool pages: %u zeroed, %u dirty\n",
+		   sh->nr_clean, sh->nr_dirty);
+	seq_printf(s, "pool hits: %lu, zeroed on alloc: %lu, misses: %lu, "
+		   "shrunk: %lu\n", sh->hits, sh->zeroed, sh->misses,
+		   sh->shrunk);
+	spin_unlock(&sh->lock);
+
+	return 0;
+}
+
 static struct ion_heap_ops vmalloc_ops = {
 	.allocate = ion_system_heap_allocate,
 	.free = ion_system_heap_free,
@@ -99,23 +325,45 @@ static struct ion_heap_ops vmalloc_ops = {
 	.map_kernel = ion_system_heap_map_kernel,
 	.unmap_kernel = ion_system_heap_unmap_kernel,
 	.map_user = ion_system_heap_map_user,
+	.cache_op = ion_system_heap_cache_op,
+	.debug_show = ion_system_heap_debug_show,
 };
 
 struct ion_heap *ion_system_heap_create(struct ion_platform_heap *unused)
 {
-	struct ion_heap *heap;
+	struct ion_system_heap *sh;
 
-	heap = kzalloc(sizeof(struct ion_heap), GFP_KERNEL);
-	if (!heap)
+	sh = kzalloc(sizeof(struct ion_system_heap), GFP_KERNEL);
+	if (!sh)
 		return ERR_PTR(-ENOMEM);
-	heap->ops = &vmalloc_ops;
-	heap->type = ION_HEAP_TYPE_SYSTEM;
-	return heap;
+	sh->heap.ops = &vmalloc_ops;
+	sh->heap.type = ION_HEAP_TYPE_SYSTEM;
+
+	spin_lock_init(&sh->lock);
+	INIT_LIST_HEAD(&sh->clean);
+	INIT_LIST_HEAD(&sh->dirty);
+	INIT_WORK(&sh->zero_work, ion_system_pool_zero);
+	sh->shrinker.shrink = ion_system_pool_shrink;
+	sh->shrinker.seeks = DEFAULT_SEEKS;
+	register_shrinker(&sh->shrinker);
+
+	return &sh->heap;
 }
 
 void ion_system_heap_destroy(struct ion_heap *heap)
 {
-	kfree(heap);
+	struct ion_system_heap *sh = to_system_heap(heap);
+	struct page *page, *tmp;
+
+	unregister_shrinker(&sh->shrinker);
+	cancel_work_sync(&sh->zero_work);
+
+	list_splice_init(&sh->dirty, &sh->clean);
+	list_for_each_entry_safe(page, tmp, &sh->clean, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+	kfree(sh);
 }
 
 static int ion_system_contig_heap_allocate(struct ion_heap *heap,
@@ -168,6 +416,17 @@ int ion_system_contig_heap_map_user(struct ion_heap *heap,
 
 }
 
+static int ion_system_contig_heap_cache_op(struct ion_heap *heap,
+					   struct ion_buffer *buffer,
+					   unsigned int op)
+{
+	void *vaddr = buffer->priv_virt;
+
+	dma_map_page(NULL, virt_to_page(vaddr), offset_in_page(vaddr),
+		     buffer->size, ion_cache_dir(op));
+	return 0;
+}
+
 static struct ion_heap_ops kmalloc_ops = {
 	.allocate = ion_system_contig_heap_allocate,
 	.free = ion_system_contig_heap_free,
@@ -177,6 +436,7 @@ static struct ion_heap_ops kmalloc_ops = {
 	.map_kernel = ion_system_heap_map_kernel,
 	.unmap_kernel = ion_system_heap_unmap_kernel,
 	.map_user = ion_system_contig_heap_map_user,
+	.cache_op = ion_system_contig_heap_cache_op,
 };
 
 struct ion_heap *ion_system_contig_heap_create(struct ion_platform_heap *unused)
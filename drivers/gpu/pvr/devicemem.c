@@ -1093,9 +1093,16 @@ PVRSRV_ERROR IMG_CALLCONV PVRSRVWrapExtMemoryKM(IMG_HANDLE				hDevCookie,
 			return PVRSRV_ERROR_OUT_OF_MEMORY;
 		}
 
+		/*
+		 * A read only wrap is mapped read only for SGX too (see
+		 * MMU_MapPage), so the CPU mapping only has to be readable.
+		 * This lets camera and video frames mapped PROT_READ from
+		 * FIMC, MFC or an ion heap become textures without a copy.
+		 */
 		eError = OSAcquirePhysPageAddr(pvPageAlignedCPUVAddr,
 										uPageCount * ui32HostPageSize,
 										psIntSysPAddr,
+										(ui32Flags & (PVRSRV_MEM_READ | PVRSRV_MEM_WRITE)) != PVRSRV_MEM_READ,
 										&hOSWrapMem);
 		if(eError != PVRSRV_OK)
 		{
@@ -2253,6 +2253,7 @@ typedef struct _sWrapMemInfo_
     struct page **ppsPages;
     IMG_SYS_PHYADDR *psPhysAddr;
     IMG_INT iPageOffset;
+    IMG_BOOL bWrite;
 #if defined(DEBUG)
     IMG_UINT32 ulStartAddr;
     IMG_UINT32 ulBeyondEndAddr;
@@ -2261,7 +2262,7 @@ typedef struct _sWrapMemInfo_
 } sWrapMemInfo;
 
 
-static IMG_BOOL CPUVAddrToPFN(struct vm_area_struct *psVMArea, IMG_UINT32 ulCPUVAddr, IMG_UINT32 *pulPFN, struct page **ppsPage)
+static IMG_BOOL CPUVAddrToPFN(struct vm_area_struct *psVMArea, IMG_UINT32 ulCPUVAddr, IMG_BOOL bWrite, IMG_UINT32 *pulPFN, struct page **ppsPage)
 {
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,10))
     pgd_t *psPGD;
@@ -2289,7 +2290,7 @@ static IMG_BOOL CPUVAddrToPFN(struct vm_area_struct *psVMArea, IMG_UINT32 ulCPUV
 
     psPTE = (pte_t *)pte_offset_map_lock(psMM, psPMD, ulCPUVAddr, &psPTLock);
 
-    if ((pte_none(*psPTE) == 0) && (pte_present(*psPTE) != 0) && (pte_write(*psPTE) != 0))
+    if ((pte_none(*psPTE) == 0) && (pte_present(*psPTE) != 0) && (!bWrite || pte_write(*psPTE) != 0))
     {
         *pulPFN = pte_pfn(*psPTE);
 	bRet = IMG_TRUE;
@@ -2339,7 +2340,7 @@ PVRSRV_ERROR OSReleasePhysPageAddr(IMG_HANDLE hOSWrapMem)
 		PVR_ASSERT(psPage != NULL);
 
                 
-		if (psInfo->iNumPagesMapped == psInfo->iNumPages)
+		if (psInfo->bWrite && psInfo->iNumPagesMapped == psInfo->iNumPages)
 		{
                     if (!PageReserved(psPage))
                     {
@@ -2428,6 +2429,7 @@ err_out:
 PVRSRV_ERROR OSAcquirePhysPageAddr(IMG_VOID *pvCPUVAddr, 
                                     IMG_UINT32 ui32Bytes, 
                                     IMG_SYS_PHYADDR *psSysPAddr,
+                                    IMG_BOOL bWrite,
                                     IMG_HANDLE *phOSWrapMem)
 {
     IMG_UINT32 ulStartAddrOrig = (IMG_UINT32) pvCPUVAddr;
@@ -2476,6 +2478,7 @@ PVRSRV_ERROR OSAcquirePhysPageAddr(IMG_VOID *pvCPUVAddr,
 
     psInfo->iNumPages = (IMG_INT)(ulAddrRange >> PAGE_SHIFT);
     psInfo->iPageOffset = (IMG_INT)(ulStartAddrOrig & ~PAGE_MASK);
+    psInfo->bWrite = bWrite;
 
     
     psInfo->psPhysAddr = kmalloc((size_t)psInfo->iNumPages * sizeof(*psInfo->psPhysAddr), GFP_KERNEL);
@@ -2508,7 +2511,7 @@ PVRSRV_ERROR OSAcquirePhysPageAddr(IMG_VOID *pvCPUVAddr,
     bMMapSemHeld = IMG_TRUE;
 
     
-    psInfo->iNumPagesMapped = get_user_pages(current, current->mm, ulStartAddr, psInfo->iNumPages, 1, 0, psInfo->ppsPages, NULL);
+    psInfo->iNumPagesMapped = get_user_pages(current, current->mm, ulStartAddr, psInfo->iNumPages, bWrite ? 1 : 0, 0, psInfo->ppsPages, NULL);
 
     if (psInfo->iNumPagesMapped >= 0)
     {
@@ -2591,10 +2594,11 @@ PVRSRV_ERROR OSAcquirePhysPageAddr(IMG_VOID *pvCPUVAddr,
     }
 
     
-    if ((psVMArea->vm_flags & (VM_READ | VM_WRITE)) != (VM_READ | VM_WRITE))
+    if ((psVMArea->vm_flags & VM_READ) == 0 ||
+        (bWrite && (psVMArea->vm_flags & VM_WRITE) == 0))
     {
         PVR_DPF((PVR_DBG_ERROR,
-            "OSAcquirePhysPageAddr: No read/write access to memory region (VMA flags: 0x%lx)", psVMArea->vm_flags));
+            "OSAcquirePhysPageAddr: No %s access to memory region (VMA flags: 0x%lx)", bWrite ? "read/write" : "read", psVMArea->vm_flags));
         goto error;
     }
 
@@ -2605,7 +2609,7 @@ PVRSRV_ERROR OSAcquirePhysPageAddr(IMG_VOID *pvCPUVAddr,
 
 	PVR_ASSERT(i < psInfo->iNumPages);
 
-	if (!CPUVAddrToPFN(psVMArea, ulAddr, &ulPFN, &psInfo->ppsPages[i]))
+	if (!CPUVAddrToPFN(psVMArea, ulAddr, bWrite, &ulPFN, &psInfo->ppsPages[i]))
 	{
             PVR_DPF((PVR_DBG_ERROR,
 	       "OSAcquirePhysPageAddr: Invalid CPU virtual address"));
@@ -275,6 +275,17 @@ IMG_VOID PVRSRVPerProcessDataDisconnect(IMG_UINT32	ui32PID)
 }
 
 
+PVRSRV_ERROR PVRSRVPerProcessDataIterate(HASH_pfnCallback pfnCallback)
+{
+	if (psHashTab == IMG_NULL)
+	{
+		return PVRSRV_OK;
+	}
+
+	return HASH_Iterate(psHashTab, pfnCallback);
+}
+
+
 PVRSRV_ERROR PVRSRVPerProcessDataInit(IMG_VOID)
 {
 	PVR_ASSERT(psHashTab == IMG_NULL);
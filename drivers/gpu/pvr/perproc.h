@@ -36,6 +36,17 @@ extern "C" {
 
 #include "handle.h"
 
+typedef struct _PVRSRV_PROCESS_STATS_
+{
+	IMG_UINT32		ui32TAKicks;
+	IMG_UINT32		ui32Scenes;			/* TA kicks ending a scene */
+	IMG_UINT32		ui32TransferKicks;
+	IMG_UINT32		ui322DKicks;
+	IMG_UINT32		ui32BridgeCalls;
+	IMG_UINT64		ui64BridgeTimeUs;	/* including waiting for the bridge lock */
+	IMG_UINT32		ui32BridgeMaxUs;
+} PVRSRV_PROCESS_STATS;
+
 typedef struct _PVRSRV_PER_PROCESS_DATA_
 {
 	IMG_UINT32		ui32PID;
@@ -70,6 +81,8 @@ typedef struct _PVRSRV_PER_PROCESS_DATA_
 #endif
 	
 	IMG_HANDLE		hOsPrivateData;
+
+	PVRSRV_PROCESS_STATS	sStats;
 } PVRSRV_PER_PROCESS_DATA;
 
 PVRSRV_PER_PROCESS_DATA *PVRSRVPerProcessData(IMG_UINT32 ui32PID);
@@ -77,6 +90,8 @@ PVRSRV_PER_PROCESS_DATA *PVRSRVPerProcessData(IMG_UINT32 ui32PID);
 PVRSRV_ERROR PVRSRVPerProcessDataConnect(IMG_UINT32	ui32PID, IMG_UINT32 ui32Flags);
 IMG_VOID PVRSRVPerProcessDataDisconnect(IMG_UINT32	ui32PID);
 
+PVRSRV_ERROR PVRSRVPerProcessDataIterate(HASH_pfnCallback pfnCallback);
+
 PVRSRV_ERROR PVRSRVPerProcessDataInit(IMG_VOID);
 PVRSRV_ERROR PVRSRVPerProcessDataDeInit(IMG_VOID);
 
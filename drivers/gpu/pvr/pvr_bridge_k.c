@@ -57,6 +57,9 @@
 
 #include "bridged_pvr_bridge.h"
 
+#include <linux/hrtimer.h>
+#include <linux/sched.h>
+
 #if defined(SUPPORT_DRI_DRM)
 #define	PRIVATE_DATA(pFile) ((pFile)->driver_priv)
 #else
@@ -73,6 +76,32 @@ static void ProcSeqStartstopBridgeStats(struct seq_file *sfile,IMG_BOOL start);
 
 #endif
 
+/*
+ * Always available bridge and kick statistics, updated with gPVRSRVLock
+ * held. Bucket n of the latency histogram counts the calls that took
+ * less than 2^n us, the last one everything longer.
+ */
+#define PVR_BRIDGE_LATENCY_BUCKETS	16
+
+typedef struct _PVRSRV_BRIDGE_CALL_STATS_
+{
+	IMG_UINT32 ui32Count;
+	IMG_UINT32 ui32MaxUs;
+	IMG_UINT64 ui64TotalUs;
+} PVRSRV_BRIDGE_CALL_STATS;
+
+static PVRSRV_BRIDGE_CALL_STATS g_asBridgeCallStats[BRIDGE_DISPATCH_TABLE_ENTRY_COUNT];
+static IMG_UINT32 g_aui32BridgeLatency[PVR_BRIDGE_LATENCY_BUCKETS];
+
+static struct proc_dir_entry *g_ProcGPUStats;
+static struct proc_dir_entry *g_ProcBridgeLatency;
+
+static void ProcSeqShowGPUStats(struct seq_file *sfile,void* el);
+static void* ProcSeqOff2ElementBridgeLatency(struct seq_file *sfile, loff_t off);
+static void* ProcSeqNextBridgeLatency(struct seq_file *sfile,void* el,loff_t off);
+static void ProcSeqShowBridgeLatency(struct seq_file *sfile,void* el);
+static void ProcSeqStartstopBridgeLock(struct seq_file *sfile,IMG_BOOL start);
+
 extern PVRSRV_LINUX_MUTEX gPVRSRVLock;
 
 #if defined(SUPPORT_MEMINFO_IDS)
@@ -98,6 +127,23 @@ LinuxBridgeInit(IMG_VOID)
 		}
 	}
 #endif
+	g_ProcGPUStats = CreateProcReadEntrySeq("gpu_stats",
+											NULL,
+											NULL,
+											ProcSeqShowGPUStats,
+											ProcSeq1ElementHeaderOff2Element,
+											ProcSeqStartstopBridgeLock);
+	g_ProcBridgeLatency = CreateProcReadEntrySeq("bridge_latency",
+												 NULL,
+												 ProcSeqNextBridgeLatency,
+												 ProcSeqShowBridgeLatency,
+												 ProcSeqOff2ElementBridgeLatency,
+												 ProcSeqStartstopBridgeLock);
+	if(!g_ProcGPUStats || !g_ProcBridgeLatency)
+	{
+		return PVRSRV_ERROR_OUT_OF_MEMORY;
+	}
+
 	return CommonBridgeInit();
 }
 
@@ -107,6 +153,156 @@ LinuxBridgeDeInit(IMG_VOID)
 #if defined(DEBUG_BRIDGE_KM)
     RemoveProcEntrySeq(g_ProcBridgeStats);
 #endif
+	RemoveProcEntrySeq(g_ProcGPUStats);
+	RemoveProcEntrySeq(g_ProcBridgeLatency);
+}
+
+static void ProcSeqStartstopBridgeLock(struct seq_file *sfile,IMG_BOOL start)
+{
+	if(start)
+	{
+		LinuxLockMutex(&gPVRSRVLock);
+	}
+	else
+	{
+		LinuxUnLockMutex(&gPVRSRVLock);
+	}
+}
+
+/* HASH_Iterate has no cookie: only used with gPVRSRVLock held */
+static struct seq_file *g_psGPUStatsFile;
+
+static PVRSRV_ERROR ShowProcessStats(IMG_UINTPTR_T k, IMG_UINTPTR_T v)
+{
+	PVRSRV_PER_PROCESS_DATA *psPerProc = (PVRSRV_PER_PROCESS_DATA *)v;
+	PVRSRV_PROCESS_STATS *psStats = &psPerProc->sStats;
+	IMG_CHAR szComm[TASK_COMM_LEN] = "-";
+	struct task_struct *psTask;
+
+	PVR_UNREFERENCED_PARAMETER(k);
+
+	rcu_read_lock();
+	psTask = pid_task(find_vpid(psPerProc->ui32PID), PIDTYPE_PID);
+	if(psTask)
+	{
+		get_task_comm(szComm, psTask);
+	}
+	rcu_read_unlock();
+
+	seq_printf(g_psGPUStatsFile,
+			   "%6u %-16s %10u %10u %10u %10u %10u %12llu %8u\n",
+			   psPerProc->ui32PID, szComm,
+			   psStats->ui32TAKicks, psStats->ui32Scenes,
+			   psStats->ui32TransferKicks, psStats->ui322DKicks,
+			   psStats->ui32BridgeCalls, psStats->ui64BridgeTimeUs,
+			   psStats->ui32BridgeMaxUs);
+
+	return PVRSRV_OK;
+}
+
+static void ProcSeqShowGPUStats(struct seq_file *sfile,void* el)
+{
+	if(el == PVR_PROC_SEQ_START_TOKEN)
+	{
+		seq_printf(sfile, "%6s %-16s %10s %10s %10s %10s %10s %12s %8s\n",
+				   "PID", "Name", "TA kicks", "Scenes", "Transfers",
+				   "2D kicks", "Bridge", "Bridge us", "Max us");
+		return;
+	}
+
+	g_psGPUStatsFile = sfile;
+	PVRSRVPerProcessDataIterate(ShowProcessStats);
+	g_psGPUStatsFile = IMG_NULL;
+}
+
+/* Element 1 is the histogram, then one per bridge call that was made */
+static void* ProcSeqOff2ElementBridgeLatency(struct seq_file *sfile, loff_t off)
+{
+	IMG_UINT32 i;
+
+	if(!off)
+	{
+		return PVR_PROC_SEQ_START_TOKEN;
+	}
+
+	if(off == 1)
+	{
+		return (void*)g_aui32BridgeLatency;
+	}
+
+	for(i = 0; i < BRIDGE_DISPATCH_TABLE_ENTRY_COUNT; i++)
+	{
+		if(g_asBridgeCallStats[i].ui32Count && --off == 1)
+		{
+			return (void*)&g_asBridgeCallStats[i];
+		}
+	}
+
+	return (void*)0;
+}
+
+static void* ProcSeqNextBridgeLatency(struct seq_file *sfile,void* el,loff_t off)
+{
+	return ProcSeqOff2ElementBridgeLatency(sfile,off);
+}
+
+static void ProcSeqShowBridgeLatency(struct seq_file *sfile,void* el)
+{
+	PVRSRV_BRIDGE_CALL_STATS *psCall = (PVRSRV_BRIDGE_CALL_STATS *)el;
+	IMG_UINT64 ui64AvgUs;
+	IMG_UINT32 i;
+
+	if(el == PVR_PROC_SEQ_START_TOKEN)
+	{
+		seq_printf(sfile, "%-10s %10s\n", "Latency", "Calls");
+		return;
+	}
+
+	if(el == (void*)g_aui32BridgeLatency)
+	{
+		for(i = 0; i < PVR_BRIDGE_LATENCY_BUCKETS - 1; i++)
+		{
+			seq_printf(sfile, "<%-7uus %10u\n", 1U << i, g_aui32BridgeLatency[i]);
+		}
+		seq_printf(sfile, ">=%-6uus %10u\n\n%-6s %10s %12s %8s %8s\n",
+				   1U << i, g_aui32BridgeLatency[i],
+				   "Bridge", "Calls", "Total us", "Avg us", "Max us");
+		return;
+	}
+
+	ui64AvgUs = psCall->ui64TotalUs;
+	do_div(ui64AvgUs, psCall->ui32Count);
+
+	seq_printf(sfile, "%6u %10u %12llu %8llu %8u\n",
+			   (IMG_UINT32)(psCall - g_asBridgeCallStats),
+			   psCall->ui32Count, psCall->ui64TotalUs, ui64AvgUs,
+			   psCall->ui32MaxUs);
+}
+
+static IMG_VOID BridgeStatsUpdate(PVRSRV_PER_PROCESS_DATA *psPerProc,
+								  IMG_UINT32 ui32BridgeID,
+								  ktime_t sStart)
+{
+	IMG_UINT32 ui32Us = (IMG_UINT32)ktime_us_delta(ktime_get(), sStart);
+	PVRSRV_BRIDGE_CALL_STATS *psCall = &g_asBridgeCallStats[ui32BridgeID];
+	PVRSRV_PROCESS_STATS *psStats = &psPerProc->sStats;
+
+	g_aui32BridgeLatency[min_t(IMG_UINT32, fls(ui32Us),
+							   PVR_BRIDGE_LATENCY_BUCKETS - 1)]++;
+
+	psCall->ui32Count++;
+	psCall->ui64TotalUs += ui32Us;
+	if(ui32Us > psCall->ui32MaxUs)
+	{
+		psCall->ui32MaxUs = ui32Us;
+	}
+
+	psStats->ui32BridgeCalls++;
+	psStats->ui64BridgeTimeUs += ui32Us;
+	if(ui32Us > psStats->ui32BridgeMaxUs)
+	{
+		psStats->ui32BridgeMaxUs = ui32Us;
+	}
 }
 
 #if defined(DEBUG_BRIDGE_KM)
@@ -200,6 +396,8 @@ PVRSRV_BridgeDispatchKM(struct file *pFile, unsigned int unref__ ioctlCmd, unsig
 	IMG_UINT32 ui32PID = OSGetCurrentProcessIDKM();
 	PVRSRV_PER_PROCESS_DATA *psPerProc;
 	IMG_INT err = -EFAULT;
+	IMG_BOOL bDispatched = IMG_FALSE;
+	ktime_t sStart = ktime_get();
 
 	LinuxLockMutex(&gPVRSRVLock);
 
@@ -373,6 +571,7 @@ PVRSRV_BridgeDispatchKM(struct file *pFile, unsigned int unref__ ioctlCmd, unsig
 #endif 
 
 	err = BridgedDispatchKM(psPerProc, psBridgePackageKM);
+	bDispatched = IMG_TRUE;
 	if(err != PVRSRV_OK)
 		goto unlock_and_return;
 
@@ -459,6 +658,10 @@ PVRSRV_BridgeDispatchKM(struct file *pFile, unsigned int unref__ ioctlCmd, unsig
 	}
 
 unlock_and_return:
+	if(bDispatched && psBridgePackageKM->ui32BridgeID < BRIDGE_DISPATCH_TABLE_ENTRY_COUNT)
+	{
+		BridgeStatsUpdate(psPerProc, psBridgePackageKM->ui32BridgeID, sStart);
+	}
 	LinuxUnLockMutex(&gPVRSRVLock);
 	return err;
 }
@@ -53,6 +53,8 @@
 #endif
 #endif
 
+#include <linux/slab.h>
+
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,37))
 static DEFINE_MUTEX(lock);
 #define	DOWN(m) mutex_lock(m)
@@ -81,6 +83,8 @@ static DECLARE_MUTEX(lock);
 
 #define RESMAN_SIGNATURE 0x12345678
 
+#define RESMAN_TYPE_COUNT	(RESMAN_TYPE_KERNEL_DEVICEMEM_ALLOCATION + 1)
+
 typedef struct _RESMAN_ITEM_
 {
 #ifdef DEBUG
@@ -109,7 +113,8 @@ typedef struct _RESMAN_CONTEXT_
 
 	PVRSRV_PER_PROCESS_DATA		*psPerProc; 
 
-	RESMAN_ITEM					*psResItemList;
+	/* One list per resource type, so freeing by type never walks the others */
+	RESMAN_ITEM					*apsResItemList[RESMAN_TYPE_COUNT];
 
 } RESMAN_CONTEXT;
 
@@ -123,6 +128,10 @@ typedef struct
 
 PRESMAN_LIST	gpsResList = IMG_NULL;
 
+#if defined(__linux__)
+static struct kmem_cache *gpsResItemCache = IMG_NULL;
+#endif
+
 #include "lists.h"	 
 
 static IMPLEMENT_LIST_ANY_VA(RESMAN_ITEM)
@@ -137,6 +146,33 @@ static IMPLEMENT_LIST_INSERT(RESMAN_CONTEXT)
 
 #define PRINT_RESLIST(x, y, z)
 
+static RESMAN_ITEM *AllocResItem(IMG_VOID)
+{
+#if defined(__linux__)
+	return kmem_cache_alloc(gpsResItemCache, GFP_KERNEL);
+#else
+	RESMAN_ITEM *psItem;
+
+	if (OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
+				   sizeof(RESMAN_ITEM), (IMG_VOID **)&psItem,
+				   IMG_NULL,
+				   "Resource Manager Item") != PVRSRV_OK)
+	{
+		return IMG_NULL;
+	}
+	return psItem;
+#endif
+}
+
+static IMG_VOID FreeResItem(RESMAN_ITEM *psItem)
+{
+#if defined(__linux__)
+	kmem_cache_free(gpsResItemCache, psItem);
+#else
+	OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(RESMAN_ITEM), psItem, IMG_NULL);
+#endif
+}
+
 static PVRSRV_ERROR FreeResourceByPtr(RESMAN_ITEM *psItem, IMG_BOOL bExecuteCallback, IMG_BOOL bForceCleanup);
 
 static PVRSRV_ERROR FreeResourceByCriteria(PRESMAN_CONTEXT	psContext,
@@ -175,6 +211,16 @@ PVRSRV_ERROR ResManInit(IMG_VOID)
 		
 		gpsResList->psContextList = IMG_NULL;
 
+#if defined(__linux__)
+		gpsResItemCache = kmem_cache_create("pvr-resman-item", sizeof(RESMAN_ITEM), 0, 0, NULL);
+		if (gpsResItemCache == IMG_NULL)
+		{
+			OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(*gpsResList), gpsResList, IMG_NULL);
+			gpsResList = IMG_NULL;
+			return PVRSRV_ERROR_OUT_OF_MEMORY;
+		}
+#endif
+
 		
 		VALIDATERESLIST();
 	}
@@ -187,6 +233,10 @@ IMG_VOID ResManDeInit(IMG_VOID)
 {
 	if (gpsResList != IMG_NULL)
 	{
+#if defined(__linux__)
+		kmem_cache_destroy(gpsResItemCache);
+		gpsResItemCache = IMG_NULL;
+#endif
 		
 		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(*gpsResList), gpsResList, IMG_NULL);
 		gpsResList = IMG_NULL;
@@ -226,7 +276,7 @@ PVRSRV_ERROR PVRSRVResManConnect(IMG_HANDLE			hPerProc,
 #ifdef DEBUG
 	psResManContext->ui32Signature = RESMAN_SIGNATURE;
 #endif 
-	psResManContext->psResItemList	= IMG_NULL;
+	OSMemSet(psResManContext->apsResItemList, 0, sizeof(psResManContext->apsResItemList));
 	psResManContext->psPerProc = hPerProc;
 
 	
@@ -271,9 +321,9 @@ IMG_VOID PVRSRVResManDisconnect(PRESMAN_CONTEXT psResManContext,
 
 		
 		
-		List_RESMAN_ITEM_Reverse(&psResManContext->psResItemList);
+		List_RESMAN_ITEM_Reverse(&psResManContext->apsResItemList[RESMAN_TYPE_MODIFY_SYNC_OPS]);
 		FreeResourceByCriteria(psResManContext, RESMAN_CRITERIA_RESTYPE, RESMAN_TYPE_MODIFY_SYNC_OPS, 0, 0, IMG_TRUE);
-		List_RESMAN_ITEM_Reverse(&psResManContext->psResItemList);  
+		List_RESMAN_ITEM_Reverse(&psResManContext->apsResItemList[RESMAN_TYPE_MODIFY_SYNC_OPS]);  
 
 		
 		FreeResourceByCriteria(psResManContext, RESMAN_CRITERIA_RESTYPE, RESMAN_TYPE_HW_RENDER_CONTEXT, 0, 0, IMG_TRUE);
@@ -303,8 +353,16 @@ IMG_VOID PVRSRVResManDisconnect(PRESMAN_CONTEXT psResManContext,
 		FreeResourceByCriteria(psResManContext, RESMAN_CRITERIA_RESTYPE, RESMAN_TYPE_BUFFERCLASS_DEVICE, 0, 0, IMG_TRUE);
 	}
 
-	
-	PVR_ASSERT(psResManContext->psResItemList == IMG_NULL);
+#ifdef DEBUG
+	{
+		IMG_UINT32 ui32ResType;
+
+		for (ui32ResType = 0; ui32ResType < RESMAN_TYPE_COUNT; ui32ResType++)
+		{
+			PVR_ASSERT(psResManContext->apsResItemList[ui32ResType] == IMG_NULL);
+		}
+	}
+#endif
 
 	
 	List_RESMAN_CONTEXT_Remove(psResManContext);
@@ -342,6 +400,12 @@ PRESMAN_ITEM ResManRegisterRes(PRESMAN_CONTEXT	psResManContext,
 		return (PRESMAN_ITEM) IMG_NULL;
 	}
 
+	if (ui32ResType == 0 || ui32ResType >= RESMAN_TYPE_COUNT)
+	{
+		PVR_DPF((PVR_DBG_ERROR, "ResManRegisterRes: invalid parameter - ui32ResType"));
+		return (PRESMAN_ITEM) IMG_NULL;
+	}
+
 	
 	ACQUIRE_SYNC_OBJ;
 
@@ -358,10 +422,8 @@ PRESMAN_ITEM ResManRegisterRes(PRESMAN_CONTEXT	psResManContext,
 			(IMG_UINTPTR_T)pfnFreeResource));
 
 	
-	if (OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
-				   sizeof(RESMAN_ITEM), (IMG_VOID **)&psNewResItem,
-				   IMG_NULL,
-				   "Resource Manager Item") != PVRSRV_OK)
+	psNewResItem = AllocResItem();
+	if (psNewResItem == IMG_NULL)
 	{
 		PVR_DPF((PVR_DBG_ERROR, "ResManRegisterRes: "
 				"ERROR allocating new resource item"));
@@ -383,7 +445,7 @@ PRESMAN_ITEM ResManRegisterRes(PRESMAN_CONTEXT	psResManContext,
 	psNewResItem->ui32Flags		    = 0;
 
 	
-	List_RESMAN_ITEM_Insert(&psResManContext->psResItemList, psNewResItem);
+	List_RESMAN_ITEM_Insert(&psResManContext->apsResItemList[ui32ResType], psNewResItem);
 
 	
 	VALIDATERESLIST();
@@ -488,7 +550,7 @@ PVRSRV_ERROR ResManDissociateRes(RESMAN_ITEM		*psResItem,
 		List_RESMAN_ITEM_Remove(psResItem);
 
 		
-		List_RESMAN_ITEM_Insert(&psNewResManContext->psResItemList, psResItem);
+		List_RESMAN_ITEM_Insert(&psNewResManContext->apsResItemList[psResItem->ui32ResType], psResItem);
 
 	}
 	else
@@ -551,7 +613,8 @@ IMG_INTERNAL PVRSRV_ERROR ResManFindResourceByPtr(PRESMAN_CONTEXT	psResManContex
 			psItem->ui32Flags));
 
 	
-	if(List_RESMAN_ITEM_IMG_BOOL_Any_va(psResManContext->psResItemList,
+	if(psItem->ui32ResType < RESMAN_TYPE_COUNT &&
+	   List_RESMAN_ITEM_IMG_BOOL_Any_va(psResManContext->apsResItemList[psItem->ui32ResType],
 										&ResManFindResourceByPtr_AnyVaCb,
 										psItem))
 	{
@@ -619,7 +682,7 @@ static PVRSRV_ERROR FreeResourceByPtr(RESMAN_ITEM	*psItem,
 		List_RESMAN_ITEM_Remove(psItem);
 
 		
-		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(RESMAN_ITEM), psItem, IMG_NULL);
+		FreeResItem(psItem);
 	}
 
 	return(eError);
@@ -660,12 +723,12 @@ static IMG_VOID* FreeResourceByCriteria_AnyVaCb(RESMAN_ITEM *psCurItem, va_list
 	}
 }
 
-static PVRSRV_ERROR FreeResourceByCriteria(PRESMAN_CONTEXT	psResManContext,
-										   IMG_UINT32		ui32SearchCriteria,
-										   IMG_UINT32		ui32ResType,
-										   IMG_PVOID		pvParam,
-										   IMG_UINT32		ui32Param,
-										   IMG_BOOL			bExecuteCallback)
+static PVRSRV_ERROR FreeResourceListByCriteria(RESMAN_ITEM		**ppsResItemList,
+											   IMG_UINT32		ui32SearchCriteria,
+											   IMG_UINT32		ui32ResType,
+											   IMG_PVOID		pvParam,
+											   IMG_UINT32		ui32Param,
+											   IMG_BOOL			bExecuteCallback)
 {
 	PRESMAN_ITEM	psCurItem;
 	PVRSRV_ERROR	eError = PVRSRV_OK;
@@ -673,7 +736,7 @@ static PVRSRV_ERROR FreeResourceByCriteria(PRESMAN_CONTEXT	psResManContext,
 	
 	
 	while((psCurItem = (PRESMAN_ITEM)
-				List_RESMAN_ITEM_Any_va(psResManContext->psResItemList,
+				List_RESMAN_ITEM_Any_va(*ppsResItemList,
 										&FreeResourceByCriteria_AnyVaCb,
 										ui32SearchCriteria,
 										ui32ResType,
@@ -699,12 +762,45 @@ static PVRSRV_ERROR FreeResourceByCriteria(PRESMAN_CONTEXT	psResManContext,
 	return eError;
 }
 
+static PVRSRV_ERROR FreeResourceByCriteria(PRESMAN_CONTEXT	psResManContext,
+										   IMG_UINT32		ui32SearchCriteria,
+										   IMG_UINT32		ui32ResType,
+										   IMG_PVOID		pvParam,
+										   IMG_UINT32		ui32Param,
+										   IMG_BOOL			bExecuteCallback)
+{
+	IMG_UINT32		ui32Type;
+	PVRSRV_ERROR	eError = PVRSRV_OK;
+
+	if (ui32SearchCriteria & RESMAN_CRITERIA_RESTYPE)
+	{
+		if (ui32ResType >= RESMAN_TYPE_COUNT)
+		{
+			return PVRSRV_OK;
+		}
+
+		return FreeResourceListByCriteria(&psResManContext->apsResItemList[ui32ResType],
+										  ui32SearchCriteria, ui32ResType,
+										  pvParam, ui32Param, bExecuteCallback);
+	}
+
+	for (ui32Type = 0; ui32Type < RESMAN_TYPE_COUNT && eError == PVRSRV_OK; ui32Type++)
+	{
+		eError = FreeResourceListByCriteria(&psResManContext->apsResItemList[ui32Type],
+											ui32SearchCriteria, ui32ResType,
+											pvParam, ui32Param, bExecuteCallback);
+	}
+
+	return eError;
+}
+
 
 #ifdef DEBUG
 static IMG_VOID ValidateResList(PRESMAN_LIST psResList)
 {
 	PRESMAN_ITEM	psCurItem, *ppsThisItem;
 	PRESMAN_CONTEXT	psCurContext, *ppsThisContext;
+	IMG_UINT32		ui32ResType;
 
 	
 	if (psResList == IMG_NULL)
@@ -732,27 +828,30 @@ static IMG_VOID ValidateResList(PRESMAN_LIST psResList)
 			PVR_ASSERT(psCurContext->ppsThis == ppsThisContext);
 		}
 
-		
-		psCurItem = psCurContext->psResItemList;
-		ppsThisItem = &psCurContext->psResItemList;
-		while(psCurItem != IMG_NULL)
+		for (ui32ResType = 0; ui32ResType < RESMAN_TYPE_COUNT; ui32ResType++)
 		{
-			
-			PVR_ASSERT(psCurItem->ui32Signature == RESMAN_SIGNATURE);
-			if (psCurItem->ppsThis != ppsThisItem)
+		
+			psCurItem = psCurContext->apsResItemList[ui32ResType];
+			ppsThisItem = &psCurContext->apsResItemList[ui32ResType];
+			while(psCurItem != IMG_NULL)
 			{
-				PVR_DPF((PVR_DBG_WARNING,
-						"psCurItem=%08X psCurItem->ppsThis=%08X psCurItem->psNext=%08X ppsThisItem=%08X",
-						(IMG_UINTPTR_T)psCurItem,
-						(IMG_UINTPTR_T)psCurItem->ppsThis,
-						(IMG_UINTPTR_T)psCurItem->psNext,
-						(IMG_UINTPTR_T)ppsThisItem));
-				PVR_ASSERT(psCurItem->ppsThis == ppsThisItem);
-			}
+			
+				PVR_ASSERT(psCurItem->ui32Signature == RESMAN_SIGNATURE);
+				if (psCurItem->ppsThis != ppsThisItem)
+				{
+					PVR_DPF((PVR_DBG_WARNING,
+							"psCurItem=%08X psCurItem->ppsThis=%08X psCurItem->psNext=%08X ppsThisItem=%08X",
+							(IMG_UINTPTR_T)psCurItem,
+							(IMG_UINTPTR_T)psCurItem->ppsThis,
+							(IMG_UINTPTR_T)psCurItem->psNext,
+							(IMG_UINTPTR_T)ppsThisItem));
+					PVR_ASSERT(psCurItem->ppsThis == ppsThisItem);
+				}
 
 			
-			ppsThisItem = &psCurItem->psNext;
-			psCurItem = psCurItem->psNext;
+				ppsThisItem = &psCurItem->psNext;
+				psCurItem = psCurItem->psNext;
+			}
 		}
 
 		
@@ -42,6 +42,9 @@
 #include <linux/console.h>
 #include <linux/workqueue.h>
 #include <linux/version.h>
+#include <linux/spinlock.h>
+#include <linux/hrtimer.h>
+#include <linux/moduleparam.h>
 
 #include "img_defs.h"
 #include "servicesext.h"
@@ -94,17 +97,39 @@ typedef struct S3C_SWAPCHAIN_TAG
 	
 } S3C_SWAPCHAIN;
 
+/*
+ * A queued flip is programmed from the vsync interrupt once the buffer
+ * before it has been shown for its swap interval, goes on screen at the
+ * following vsync and is then completed to services from the workqueue.
+ * A slot is free again once it is both retired and completed.
+ */
 typedef struct S3C_VSYNC_FLIP_ITEM_TAG
 {
 	S3C_HANDLE		  hCmdComplete;
 	S3C_FRAME_BUFFER	*psFb;
 	unsigned long	  ulSwapInterval;
+	ktime_t			  sQueued;
 	S3C_BOOL		  bValid;
-	S3C_BOOL		  bFlipped;
+	S3C_BOOL		  bFlipped;		/* address programmed */
+	S3C_BOOL		  bOnScreen;
+	S3C_BOOL		  bRetired;		/* swap interval over */
 	S3C_BOOL		  bCmdCompleted;
 
 } S3C_VSYNC_FLIP_ITEM;
 
+typedef struct S3C_FLIP_STATS_TAG
+{
+	unsigned long	ulQueued;
+	unsigned long	ulDisplayed;
+	unsigned long	ulImmediate;	/* swap interval 0 */
+	unsigned long	ulQueueFull;
+	unsigned long	ulUnderruns;	/* nothing queued when a flip retired */
+	unsigned long	ulVSyncs;
+	u64				ullLatencyUs;	/* queued until on screen */
+	unsigned long	ulMaxLatencyUs;
+
+} S3C_FLIP_STATS;
+
 typedef struct fb_info S3C_FB_INFO;
 
 typedef struct S3C_LCD_DEVINFO_TAG
@@ -136,12 +161,18 @@ typedef struct S3C_LCD_DEVINFO_TAG
 
 	S3C_VSYNC_FLIP_ITEM				asVSyncFlips[S3C_MAX_BUFFERS];
 
+	/* flip queue, under sFlipLock */
 	unsigned long					ulInsertIndex;
-	unsigned long					ulRemoveIndex;
+	unsigned long					ulRemoveIndex;		/* on screen or next */
+	unsigned long					ulCompleteIndex;	/* next to complete */
+	unsigned long					ulFlipQueueDepth;
+	S3C_FLIP_STATS					sFlipStats;
+	spinlock_t						sFlipLock;
 	S3C_BOOL						bFlushCommands;
 
 	struct workqueue_struct 		*psWorkQueue;
 	struct work_struct				sWork;
+	/* serialises completing flips to services */
 	struct mutex					sVsyncFlipItemMutex;
 
 } S3C_LCD_DEVINFO;
@@ -151,6 +182,11 @@ static PVRSRV_DC_DISP2SRV_KMJTABLE gsPVRJTable;
 
 static S3C_LCD_DEVINFO *gpsLCDInfo;
 
+static unsigned int flip_queue_depth;
+module_param(flip_queue_depth, uint, 0644);
+MODULE_PARM_DESC(flip_queue_depth,
+		 "Flips queued ahead of the display, 0 for one per swap chain buffer");
+
 /*****************************************************************************
  * Video-decode carveout decls
  */
@@ -198,17 +234,9 @@ extern IMG_BOOL IMG_IMPORT PVRGetDisplayClassJTable(PVRSRV_DC_DISP2SRV_KMJTABLE
 static void AdvanceFlipIndex(S3C_LCD_DEVINFO *psDevInfo,
 							 unsigned long	*pulIndex)
 {
-	unsigned long	ulMaxFlipIndex;
-
-	ulMaxFlipIndex = psDevInfo->psSwapChain->ulBufferCount - 1;
-	if (ulMaxFlipIndex >= psDevInfo->ui32NumFrameBuffers)
-	{
-		ulMaxFlipIndex = psDevInfo->ui32NumFrameBuffers -1;
-	}
-
 	(*pulIndex)++;
 
-	if (*pulIndex > ulMaxFlipIndex )
+	if (*pulIndex >= psDevInfo->ulFlipQueueDepth)
 	{
 		*pulIndex = 0;
 	}
@@ -220,11 +248,14 @@ static IMG_VOID ResetVSyncFlipItems(S3C_LCD_DEVINFO* psDevInfo)
 
 	psDevInfo->ulInsertIndex = 0;
 	psDevInfo->ulRemoveIndex = 0;
+	psDevInfo->ulCompleteIndex = 0;
 
-	for(i=0; i < psDevInfo->ui32NumFrameBuffers; i++)
+	for(i=0; i < S3C_MAX_BUFFERS; i++)
 	{
 		psDevInfo->asVSyncFlips[i].bValid = S3C_FALSE;
 		psDevInfo->asVSyncFlips[i].bFlipped = S3C_FALSE;
+		psDevInfo->asVSyncFlips[i].bOnScreen = S3C_FALSE;
+		psDevInfo->asVSyncFlips[i].bRetired = S3C_FALSE;
 		psDevInfo->asVSyncFlips[i].bCmdCompleted = S3C_FALSE;
 	}
 }
@@ -270,92 +301,247 @@ static IMG_VOID S3C_Flip(S3C_LCD_DEVINFO  *psDevInfo,
 	S3C_CONSOLE_UNLOCK();
 }
 
+/*
+ * Pan straight through the driver, from the vsync interrupt or with
+ * sFlipLock held: the new address is latched at the next vsync. The
+ * virtual resolution was set up for the whole chain by S3C_PrepareFlips.
+ */
+static IMG_VOID S3C_PanFlip(S3C_LCD_DEVINFO *psDevInfo,
+							S3C_FRAME_BUFFER *fb)
+{
+	struct fb_info *psFBInfo = psDevInfo->psFBInfo;
+	struct fb_var_screeninfo sFBVar = psFBInfo->var;
+
+	sFBVar.xoffset = 0;
+	sFBVar.yoffset = fb->yoffset;
+
+	if (psFBInfo->fbops->fb_pan_display(&sFBVar, psFBInfo) == 0)
+	{
+		psFBInfo->var.xoffset = 0;
+		psFBInfo->var.yoffset = fb->yoffset;
+	}
+}
+
+static IMG_VOID S3C_PrepareFlips(S3C_LCD_DEVINFO *psDevInfo,
+								 S3C_SWAPCHAIN *psSwapChain)
+{
+	struct fb_var_screeninfo sFBVar;
+	unsigned long ulYResVirtual = 0;
+	unsigned long i;
+	int res;
+
+	S3C_CONSOLE_LOCK();
+
+	sFBVar = psDevInfo->psFBInfo->var;
+
+	for (i = 0; i < psSwapChain->ulBufferCount; i++)
+	{
+		ulYResVirtual = max(ulYResVirtual,
+				(unsigned long)psSwapChain->psBuffer[i].yoffset + sFBVar.yres);
+	}
+
+	if (sFBVar.xres_virtual != sFBVar.xres || sFBVar.yres_virtual < ulYResVirtual)
+	{
+		sFBVar.xres_virtual = sFBVar.xres;
+		sFBVar.yres_virtual = ulYResVirtual;
+
+		sFBVar.activate = FB_ACTIVATE_NOW | FB_ACTIVATE_FORCE;
+
+		res = fb_set_var(psDevInfo->psFBInfo, &sFBVar);
+		if (res != 0)
+		{
+			printk("%s: fb_set_var failed (Y Res Virtual: %lu, Error: %d)\n", __FUNCTION__, ulYResVirtual, res);
+		}
+	}
+
+	S3C_CONSOLE_UNLOCK();
+}
+
+/* Complete the flips that reached the screen, in order */
+static void CompleteFlips(S3C_LCD_DEVINFO *psDevInfo)
+{
+	S3C_VSYNC_FLIP_ITEM *psFlipItem;
+	unsigned long ulFlags;
+
+	for (;;)
+	{
+		spin_lock_irqsave(&psDevInfo->sFlipLock, ulFlags);
+		psFlipItem = &psDevInfo->asVSyncFlips[psDevInfo->ulCompleteIndex];
+		if (!psFlipItem->bValid || !psFlipItem->bOnScreen ||
+			psFlipItem->bCmdCompleted)
+		{
+			spin_unlock_irqrestore(&psDevInfo->sFlipLock, ulFlags);
+			break;
+		}
+		spin_unlock_irqrestore(&psDevInfo->sFlipLock, ulFlags);
+
+		gsPVRJTable.pfnPVRSRVCmdComplete((IMG_HANDLE)psFlipItem->hCmdComplete, IMG_TRUE);
+
+		spin_lock_irqsave(&psDevInfo->sFlipLock, ulFlags);
+		psFlipItem->bCmdCompleted = S3C_TRUE;
+		if (psFlipItem->bRetired)
+		{
+			psFlipItem->bValid = S3C_FALSE;
+		}
+		AdvanceFlipIndex(psDevInfo, &psDevInfo->ulCompleteIndex);
+		spin_unlock_irqrestore(&psDevInfo->sFlipLock, ulFlags);
+	}
+}
+
 static void FlushInternalVSyncQueue(S3C_LCD_DEVINFO*psDevInfo)
 {
-	S3C_VSYNC_FLIP_ITEM*  psFlipItem;
+	S3C_VSYNC_FLIP_ITEM *psFlipItem;
+	S3C_FRAME_BUFFER *psLastFb = NULL;
+	unsigned long ulFlags;
 
 	mutex_lock(&psDevInfo->sVsyncFlipItemMutex);
 
+	/* Show the newest buffer now and retire everything before it */
+	spin_lock_irqsave(&psDevInfo->sFlipLock, ulFlags);
 	psFlipItem = &psDevInfo->asVSyncFlips[psDevInfo->ulRemoveIndex];
-
-	while(psFlipItem->bValid)
+	while (psFlipItem->bValid && !psFlipItem->bRetired)
 	{
-		if(psFlipItem->bFlipped == S3C_FALSE)
+		if (!psFlipItem->bFlipped)
 		{
-			S3C_Flip (psDevInfo, psFlipItem->psFb);
+			psLastFb = psFlipItem->psFb;
 		}
 
-		if(psFlipItem->bCmdCompleted == S3C_FALSE)
+		psFlipItem->bFlipped = S3C_TRUE;
+		psFlipItem->bOnScreen = S3C_TRUE;
+		psFlipItem->bRetired = S3C_TRUE;
+		if (psFlipItem->bCmdCompleted)
 		{
-			gsPVRJTable.pfnPVRSRVCmdComplete((IMG_HANDLE)psFlipItem->hCmdComplete, IMG_TRUE);
+			psFlipItem->bValid = S3C_FALSE;
 		}
 
 		AdvanceFlipIndex(psDevInfo, &psDevInfo->ulRemoveIndex);
-
-		psFlipItem->bFlipped = S3C_FALSE;
-		psFlipItem->bCmdCompleted = S3C_FALSE;
-		psFlipItem->bValid = S3C_FALSE;
-
 		psFlipItem = &psDevInfo->asVSyncFlips[psDevInfo->ulRemoveIndex];
 	}
 
-	psDevInfo->ulInsertIndex = 0;
-	psDevInfo->ulRemoveIndex = 0;
+	if (psLastFb)
+	{
+		S3C_PanFlip(psDevInfo, psLastFb);
+	}
+	spin_unlock_irqrestore(&psDevInfo->sFlipLock, ulFlags);
+
+	CompleteFlips(psDevInfo);
+
+	spin_lock_irqsave(&psDevInfo->sFlipLock, ulFlags);
+	ResetVSyncFlipItems(psDevInfo);
+	spin_unlock_irqrestore(&psDevInfo->sFlipLock, ulFlags);
 
 	mutex_unlock(&psDevInfo->sVsyncFlipItemMutex);
 }
 
 static void VsyncWorkqueueFunc(struct work_struct *psWork)
 {
-	S3C_VSYNC_FLIP_ITEM *psFlipItem;
 	S3C_LCD_DEVINFO *psDevInfo = container_of(psWork, S3C_LCD_DEVINFO, sWork);
 
-	if(psDevInfo == NULL)
-	{
-		return;
-	}
-
 	mutex_lock(&psDevInfo->sVsyncFlipItemMutex);
+	CompleteFlips(psDevInfo);
+	mutex_unlock(&psDevInfo->sVsyncFlipItemMutex);
+}
+
+/* Called from the vsync interrupt with sFlipLock held */
+static S3C_BOOL S3C_FlipVSync(S3C_LCD_DEVINFO *psDevInfo)
+{
+	S3C_VSYNC_FLIP_ITEM *psFlipItem;
+	S3C_FLIP_STATS *psStats = &psDevInfo->sFlipStats;
+	S3C_BOOL bComplete = S3C_FALSE;
+	unsigned long ulLatencyUs;
+
+	psStats->ulVSyncs++;
 
 	psFlipItem = &psDevInfo->asVSyncFlips[psDevInfo->ulRemoveIndex];
+	if (!psFlipItem->bValid || !psFlipItem->bFlipped || psFlipItem->bRetired)
+	{
+		return S3C_FALSE;
+	}
 
-	while(psFlipItem->bValid)
+	if (!psFlipItem->bOnScreen)
 	{
-		if(psFlipItem->bFlipped)
-		{
-			if(!psFlipItem->bCmdCompleted)
-			{
-				gsPVRJTable.pfnPVRSRVCmdComplete((IMG_HANDLE)psFlipItem->hCmdComplete, IMG_TRUE);
-				psFlipItem->bCmdCompleted = S3C_TRUE;
-			}
-
-			psFlipItem->ulSwapInterval--;
-
-			if(psFlipItem->ulSwapInterval == 0)
-			{
-				AdvanceFlipIndex(psDevInfo, &psDevInfo->ulRemoveIndex);
-				psFlipItem->bCmdCompleted = S3C_FALSE;
-				psFlipItem->bFlipped = S3C_FALSE;
-				psFlipItem->bValid = S3C_FALSE;
-			}
-			else
-			{
-				break;
-			}
-		}
-		else
+		psFlipItem->bOnScreen = S3C_TRUE;
+		bComplete = S3C_TRUE;
+
+		ulLatencyUs = (unsigned long)ktime_us_delta(ktime_get(), psFlipItem->sQueued);
+		psStats->ulDisplayed++;
+		psStats->ullLatencyUs += ulLatencyUs;
+		if (ulLatencyUs > psStats->ulMaxLatencyUs)
 		{
-			S3C_Flip (psDevInfo, psFlipItem->psFb);
-			psFlipItem->bFlipped = S3C_TRUE;
-			break;
+			psStats->ulMaxLatencyUs = ulLatencyUs;
 		}
+	}
 
-		psFlipItem = &psDevInfo->asVSyncFlips[psDevInfo->ulRemoveIndex];
+	if (--psFlipItem->ulSwapInterval != 0)
+	{
+		return bComplete;
 	}
 
-	mutex_unlock(&psDevInfo->sVsyncFlipItemMutex);
+	psFlipItem->bRetired = S3C_TRUE;
+	if (psFlipItem->bCmdCompleted)
+	{
+		psFlipItem->bValid = S3C_FALSE;
+	}
+	AdvanceFlipIndex(psDevInfo, &psDevInfo->ulRemoveIndex);
+
+	psFlipItem = &psDevInfo->asVSyncFlips[psDevInfo->ulRemoveIndex];
+	if (psFlipItem->bValid && !psFlipItem->bFlipped)
+	{
+		S3C_PanFlip(psDevInfo, psFlipItem->psFb);
+		psFlipItem->bFlipped = S3C_TRUE;
+	}
+	else
+	{
+		psStats->ulUnderruns++;
+	}
+
+	return bComplete;
+}
+
+static ssize_t FlipStatsShow(struct device *dev,
+							 struct device_attribute *attr, char *buf)
+{
+	S3C_FLIP_STATS sStats;
+	unsigned long ulFlags;
+	u64 ullAvgUs;
+
+	spin_lock_irqsave(&gpsLCDInfo->sFlipLock, ulFlags);
+	sStats = gpsLCDInfo->sFlipStats;
+	spin_unlock_irqrestore(&gpsLCDInfo->sFlipLock, ulFlags);
+
+	ullAvgUs = sStats.ullLatencyUs;
+	if (sStats.ulDisplayed)
+	{
+		do_div(ullAvgUs, sStats.ulDisplayed);
+	}
+
+	return scnprintf(buf, PAGE_SIZE,
+			"depth %lu\nqueued %lu\ndisplayed %lu\nimmediate %lu\n"
+			"queue_full %lu\nunderruns %lu\nvsyncs %lu\n"
+			"latency_avg_us %llu\nlatency_max_us %lu\n",
+			gpsLCDInfo->ulFlipQueueDepth, sStats.ulQueued,
+			sStats.ulDisplayed, sStats.ulImmediate, sStats.ulQueueFull,
+			sStats.ulUnderruns, sStats.ulVSyncs, ullAvgUs,
+			sStats.ulMaxLatencyUs);
+}
+
+/* Any write clears the statistics */
+static ssize_t FlipStatsStore(struct device *dev,
+							  struct device_attribute *attr,
+							  const char *buf, size_t count)
+{
+	unsigned long ulFlags;
+
+	spin_lock_irqsave(&gpsLCDInfo->sFlipLock, ulFlags);
+	memset(&gpsLCDInfo->sFlipStats, 0, sizeof(gpsLCDInfo->sFlipStats));
+	spin_unlock_irqrestore(&gpsLCDInfo->sFlipLock, ulFlags);
+
+	return count;
 }
 
+static DEVICE_ATTR(pvr_flip_stats, S_IRUGO | S_IWUSR,
+				   FlipStatsShow, FlipStatsStore);
+
 static S3C_BOOL CreateVsyncWorkQueue(S3C_LCD_DEVINFO *psDevInfo)
 {
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36))
@@ -373,6 +559,7 @@ static S3C_BOOL CreateVsyncWorkQueue(S3C_LCD_DEVINFO *psDevInfo)
 
 	INIT_WORK(&psDevInfo->sWork, VsyncWorkqueueFunc);
 	mutex_init(&psDevInfo->sVsyncFlipItemMutex);
+	spin_lock_init(&psDevInfo->sFlipLock);
 
 	return S3C_TRUE;
 }
@@ -385,12 +572,21 @@ static void destroyVsyncWorkQueue(S3C_LCD_DEVINFO *psDevInfo)
 
 static irqreturn_t S3C_VSyncISR(int irq, void *dev_id)
 {
+	S3C_BOOL bComplete;
+
 	if( dev_id != gpsLCDInfo)
 	{
 		return IRQ_NONE;
 	}
 
-	queue_work(gpsLCDInfo->psWorkQueue, &gpsLCDInfo->sWork);
+	spin_lock(&gpsLCDInfo->sFlipLock);
+	bComplete = S3C_FlipVSync(gpsLCDInfo);
+	spin_unlock(&gpsLCDInfo->sFlipLock);
+
+	if (bComplete)
+	{
+		queue_work(gpsLCDInfo->psWorkQueue, &gpsLCDInfo->sWork);
+	}
 
 	return IRQ_HANDLED;
 }
@@ -612,7 +808,16 @@ static PVRSRV_ERROR CreateDCSwapChain(IMG_HANDLE hDevice,
 
 	psDevInfo->psSwapChain = psSwapChain;
 
-    ResetVSyncFlipItems(psDevInfo);
+	S3C_PrepareFlips(psDevInfo, psSwapChain);
+
+	psDevInfo->ulFlipQueueDepth = min(psSwapChain->ulBufferCount,
+			(unsigned long)psDevInfo->ui32NumFrameBuffers);
+	if (flip_queue_depth && flip_queue_depth < psDevInfo->ulFlipQueueDepth)
+	{
+		psDevInfo->ulFlipQueueDepth = flip_queue_depth;
+	}
+
+	ResetVSyncFlipItems(psDevInfo);
 	S3C_InstallVsyncISR();
 
 	return PVRSRV_OK;
@@ -639,9 +844,10 @@ static PVRSRV_ERROR DestroyDCSwapChain(IMG_HANDLE hDevice,
 	if (psLCDInfo->psSwapChain == sc)
 		psLCDInfo->psSwapChain = NULL;	
 
-	ResetVSyncFlipItems(psLCDInfo);
-
 	S3C_UninstallVsyncISR();
+	cancel_work_sync(&psLCDInfo->sWork);
+
+	ResetVSyncFlipItems(psLCDInfo);
 
 	return PVRSRV_OK;
 }
@@ -775,27 +981,43 @@ static IMG_BOOL ProcessFlipV1(IMG_HANDLE hCmdCookie,
 							  IMG_UINT32 ui32SwapInterval)
 {
 	S3C_VSYNC_FLIP_ITEM *psFlipItem;
+	unsigned long ulFlags;
 
 	if(ui32SwapInterval == 0)
 	{
-		S3C_Flip(psDevInfo, psFb);
+		spin_lock_irqsave(&psDevInfo->sFlipLock, ulFlags);
+		S3C_PanFlip(psDevInfo, psFb);
+		psDevInfo->sFlipStats.ulImmediate++;
+		spin_unlock_irqrestore(&psDevInfo->sFlipLock, ulFlags);
+
 		gsPVRJTable.pfnPVRSRVCmdComplete(hCmdCookie, IMG_FALSE);
 		return IMG_TRUE;
 	}
 
-	mutex_lock(&psDevInfo->sVsyncFlipItemMutex);
+	spin_lock_irqsave(&psDevInfo->sFlipLock, ulFlags);
 
 	psFlipItem = &psDevInfo->asVSyncFlips[psDevInfo->ulInsertIndex];
 
 	if(psFlipItem->bValid)
 	{
-		mutex_unlock(&psDevInfo->sVsyncFlipItemMutex);
+		/* Services retries the command once a slot is free */
+		psDevInfo->sFlipStats.ulQueueFull++;
+		spin_unlock_irqrestore(&psDevInfo->sFlipLock, ulFlags);
 		return IMG_FALSE;
 	}
 
+	psFlipItem->hCmdComplete = hCmdCookie;
+	psFlipItem->psFb = psFb;
+	psFlipItem->ulSwapInterval = (unsigned long)ui32SwapInterval;
+	psFlipItem->sQueued = ktime_get();
+	psFlipItem->bOnScreen = S3C_FALSE;
+	psFlipItem->bRetired = S3C_FALSE;
+	psFlipItem->bCmdCompleted = S3C_FALSE;
+
+	/* Nothing on its way to the screen: this one goes at the next vsync */
 	if(psDevInfo->ulInsertIndex == psDevInfo->ulRemoveIndex)
 	{
-		S3C_Flip(psDevInfo, psFb);
+		S3C_PanFlip(psDevInfo, psFb);
 		psFlipItem->bFlipped = S3C_TRUE;
 	}
 	else
@@ -803,15 +1025,12 @@ static IMG_BOOL ProcessFlipV1(IMG_HANDLE hCmdCookie,
 		psFlipItem->bFlipped = S3C_FALSE;
 	}
 
-	psFlipItem->hCmdComplete = hCmdCookie;
-	psFlipItem->psFb = psFb;
-	psFlipItem->ulSwapInterval = (unsigned long)ui32SwapInterval;
-
 	psFlipItem->bValid = S3C_TRUE;
+	psDevInfo->sFlipStats.ulQueued++;
 
 	AdvanceFlipIndex(psDevInfo, &psDevInfo->ulInsertIndex);
 
-	mutex_unlock(&psDevInfo->sVsyncFlipItemMutex);
+	spin_unlock_irqrestore(&psDevInfo->sFlipLock, ulFlags);
 	return IMG_TRUE;
 }
 
@@ -976,7 +1195,7 @@ int s3c_displayclass_init(void)
 	if (gpsLCDInfo != NULL)
 		goto exit_out;
 
-	gpsLCDInfo = (S3C_LCD_DEVINFO*)kmalloc(sizeof(S3C_LCD_DEVINFO),GFP_KERNEL);
+	gpsLCDInfo = (S3C_LCD_DEVINFO*)kzalloc(sizeof(S3C_LCD_DEVINFO),GFP_KERNEL);
 
 	gpsLCDInfo->psFBInfo = psLINFBInfo;
 	gpsLCDInfo->ui32NumFrameBuffers = num_of_fb;
@@ -1076,12 +1295,18 @@ int s3c_displayclass_init(void)
 		return 1;
 	}
 
+	if (device_create_file(psLINFBInfo->dev, &dev_attr_pvr_flip_stats))
+	{
+		printk("fail to create the flip statistics\n");
+	}
+
 exit_out:
 	return 0;
 }
 
 void s3c_displayclass_deinit(void)
 {
+	device_remove_file(gpsLCDInfo->psFBInfo->dev, &dev_attr_pvr_flip_stats);
 	destroyVsyncWorkQueue(gpsLCDInfo);
 	DeInitDev(gpsLCDInfo);
 
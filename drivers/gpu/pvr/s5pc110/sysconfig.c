@@ -36,17 +36,15 @@
 #include <linux/clk.h>
 #include <linux/err.h>
 
-#ifdef CONFIG_DVFS_LIMIT
-#include <mach/cpu-freq-v210.h>
-#else
 #include <linux/cpufreq.h>
-#endif
+#include <mach/cpu-freq-v210.h>
 
 #define REAL_HARDWARE 1
 #define SGX540_BASEADDR 0xf3000000
 #define MAPPING_SIZE 0x10000
 #define SGX540_IRQ IRQ_3D
 
+/* Highest G3D rate: the timer frequencies below are derived from it */
 #define SYS_SGX_CLOCK_SPEED					(200000000)
 #define SYS_SGX_HWRECOVERY_TIMEOUT_FREQ		(100) // 10ms (100hz)
 #define SYS_SGX_PDS_TIMER_FREQ				(1000) // 1ms (1000hz)
@@ -128,6 +126,10 @@ static PVRSRV_ERROR EnableSGXClocks(void)
 #endif
 	regulator_enable(g3d_pd_regulator);
 	clk_enable(g3d_clock);
+#if defined(SYS_SGX_CLOCK_SCALING)
+	SysDvfsPowerOn();
+#endif
+	s5pv210_bus_hint(BUS_HINT_G3D, true);
 #ifndef CONFIG_DVFS_LIMIT
 	cpufreq_update_policy(current_thread_info()->cpu);
 #endif
@@ -137,6 +139,10 @@ static PVRSRV_ERROR EnableSGXClocks(void)
 
 static PVRSRV_ERROR DisableSGXClocks(void)
 {
+	s5pv210_bus_hint(BUS_HINT_G3D, false);
+#if defined(SYS_SGX_CLOCK_SCALING)
+	SysDvfsPowerOff();
+#endif
 	clk_disable(g3d_clock);
 	regulator_disable(g3d_pd_regulator);
 #ifdef CONFIG_DVFS_LIMIT
@@ -248,6 +254,9 @@ PVRSRV_ERROR SysInitialise(IMG_VOID)
 			return PVRSRV_ERROR_INIT_FAILURE;
 		}
 
+#if defined(SYS_SGX_CLOCK_SCALING)
+		SysDvfsInit(g3d_clock);
+#endif
 		EnableSGXClocks();
 	}
 #endif
@@ -581,6 +590,9 @@ PVRSRV_ERROR SysDeinitialise (SYS_DATA *psSysData)
 
 #if defined(SUPPORT_ACTIVE_POWER_MANAGEMENT)
 	/* TODO: regulator and clk put. */
+#if defined(SYS_SGX_CLOCK_SCALING)
+	SysDvfsDeinit();
+#endif
 #ifdef CONFIG_DVFS_LIMIT
 	s5pv210_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_PVR);
 #else
@@ -65,4 +65,13 @@ typedef enum _SYS_DEVICE_TYPE_
 	Macro to extract FIFO space from HW register value
 */
 
+#if defined(SYS_SGX_CLOCK_SCALING)
+struct clk;
+
+IMG_VOID SysDvfsInit(struct clk *psClock);
+IMG_VOID SysDvfsDeinit(IMG_VOID);
+IMG_VOID SysDvfsPowerOn(IMG_VOID);
+IMG_VOID SysDvfsPowerOff(IMG_VOID);
+#endif
+
 #endif	/* __SYSINFO_H__ */
@@ -27,10 +27,279 @@
 #include "services_headers.h"
 #include "sysinfo.h"
 
+#if defined(SYS_SGX_CLOCK_SCALING)
+#include <linux/clk.h>
+#include <linux/cpufreq_input_boost.h>
+#include <linux/hrtimer.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#endif
 
 
 /* SYSTEM SPECIFIC FUNCTIONS */
 
+#if defined(SYS_SGX_CLOCK_SCALING)
+/*
+ * G3D clock scaling. The microkernel reports SGX going idle and busy
+ * again through SysSGXIdleTransition; the share of the powered time SGX
+ * was busy picks the lowest clock that would still keep it below
+ * SYS_DVFS_TARGET_LOAD busy. Time with the power domain off is not
+ * sampled at all: the active power manager already covers it.
+ */
+#define SYS_DVFS_LEVELS			3
+#define SYS_DVFS_PERIOD_MS		50
+#define SYS_DVFS_MIN_WINDOW_NS	(10 * NSEC_PER_MSEC)
+#define SYS_DVFS_TARGET_LOAD	80
+#define SYS_DVFS_MAX_LOAD		90
+
+static struct
+{
+	struct clk				*psClock;
+	unsigned long			aulRate[SYS_DVFS_LEVELS];
+	IMG_UINT32				ui32Levels;
+	IMG_UINT32				ui32Level;
+
+	/* Serialises rate changes against powering the clock up and down */
+	struct mutex			sLock;
+	IMG_BOOL				bPowered;
+
+	/* Busy accounting, updated from the MISR */
+	spinlock_t				sStatLock;
+	IMG_BOOL				bBusy;
+	ktime_t					sLast;
+	u64						ui64BusyNs;
+	u64						ui64TotalNs;
+
+	struct delayed_work		sWork;
+
+	/* Full speed while an input boost is on */
+	IMG_BOOL				bBoost;
+	struct work_struct		sBoostWork;
+	struct notifier_block	sBoostNb;
+} gsSysDvfs;
+
+static IMG_VOID SysDvfsAccount(ktime_t sNow)
+{
+	u64 ui64Delta = ktime_to_ns(ktime_sub(sNow, gsSysDvfs.sLast));
+
+	if (gsSysDvfs.bBusy)
+	{
+		gsSysDvfs.ui64BusyNs += ui64Delta;
+	}
+	gsSysDvfs.ui64TotalNs += ui64Delta;
+	gsSysDvfs.sLast = sNow;
+}
+
+IMG_VOID SysSGXIdleTransition(IMG_BOOL bSGXIdle)
+{
+	unsigned long ulFlags;
+
+	spin_lock_irqsave(&gsSysDvfs.sStatLock, ulFlags);
+	SysDvfsAccount(ktime_get());
+	gsSysDvfs.bBusy = !bSGXIdle;
+	spin_unlock_irqrestore(&gsSysDvfs.sStatLock, ulFlags);
+}
+
+/* Busy percentage since the last call, or -1 if the window is too short */
+static IMG_INT32 SysDvfsLoad(IMG_VOID)
+{
+	unsigned long ulFlags;
+	u64 ui64Busy, ui64Total;
+
+	spin_lock_irqsave(&gsSysDvfs.sStatLock, ulFlags);
+	SysDvfsAccount(ktime_get());
+	ui64Busy = gsSysDvfs.ui64BusyNs;
+	ui64Total = gsSysDvfs.ui64TotalNs;
+	if (ui64Total >= SYS_DVFS_MIN_WINDOW_NS)
+	{
+		gsSysDvfs.ui64BusyNs = 0;
+		gsSysDvfs.ui64TotalNs = 0;
+	}
+	spin_unlock_irqrestore(&gsSysDvfs.sStatLock, ulFlags);
+
+	if (ui64Total < SYS_DVFS_MIN_WINDOW_NS)
+	{
+		return -1;
+	}
+
+	/* Both fit in 32 bits once in microseconds: windows are short */
+	do_div(ui64Busy, NSEC_PER_USEC);
+	do_div(ui64Total, NSEC_PER_USEC);
+	return (IMG_INT32)((IMG_UINT32)ui64Busy * 100 / (IMG_UINT32)ui64Total);
+}
+
+static IMG_UINT32 SysDvfsPickLevel(IMG_INT32 i32Load)
+{
+	unsigned long ulWanted;
+	IMG_UINT32 i;
+
+	/* A saturated clock hides how much more work there is */
+	if (i32Load >= SYS_DVFS_MAX_LOAD || gsSysDvfs.bBoost)
+	{
+		return 0;
+	}
+
+	ulWanted = gsSysDvfs.aulRate[gsSysDvfs.ui32Level] / SYS_DVFS_TARGET_LOAD *
+			   i32Load;
+
+	for (i = gsSysDvfs.ui32Levels - 1; i > 0; i--)
+	{
+		if (gsSysDvfs.aulRate[i] >= ulWanted)
+		{
+			break;
+		}
+	}
+
+	return i;
+}
+
+static IMG_VOID SysDvfsWork(struct work_struct *psWork)
+{
+	IMG_INT32 i32Load;
+	IMG_UINT32 ui32Level;
+
+	mutex_lock(&gsSysDvfs.sLock);
+	if (!gsSysDvfs.bPowered)
+	{
+		mutex_unlock(&gsSysDvfs.sLock);
+		return;
+	}
+
+	i32Load = SysDvfsLoad();
+	if (i32Load >= 0)
+	{
+		ui32Level = SysDvfsPickLevel(i32Load);
+		if (ui32Level != gsSysDvfs.ui32Level)
+		{
+			gsSysDvfs.ui32Level = ui32Level;
+			clk_set_rate(gsSysDvfs.psClock, gsSysDvfs.aulRate[ui32Level]);
+		}
+	}
+
+	schedule_delayed_work(&gsSysDvfs.sWork,
+						  msecs_to_jiffies(SYS_DVFS_PERIOD_MS));
+	mutex_unlock(&gsSysDvfs.sLock);
+}
+
+static IMG_VOID SysDvfsBoostWork(struct work_struct *psWork)
+{
+	mutex_lock(&gsSysDvfs.sLock);
+	if (gsSysDvfs.bPowered && gsSysDvfs.bBoost && gsSysDvfs.ui32Level != 0)
+	{
+		gsSysDvfs.ui32Level = 0;
+		clk_set_rate(gsSysDvfs.psClock, gsSysDvfs.aulRate[0]);
+	}
+	mutex_unlock(&gsSysDvfs.sLock);
+}
+
+/* Called from the input event path: the rate is changed from a work */
+static int SysDvfsBoostNotifier(struct notifier_block *psNb,
+								unsigned long ulEvent, void *pvData)
+{
+	gsSysDvfs.bBoost = (ulEvent == INPUT_BOOST_START);
+	if (gsSysDvfs.bBoost)
+	{
+		schedule_work(&gsSysDvfs.sBoostWork);
+	}
+	return NOTIFY_OK;
+}
+
+/*!
+******************************************************************************
+
+ @Function	SysDvfsInit
+
+ @Description Builds the G3D clock levels from the rate the clock runs at
+
+ @Input    psClock - G3D special clock
+
+ @Return   IMG_VOID
+
+******************************************************************************/
+IMG_VOID SysDvfsInit(struct clk *psClock)
+{
+	unsigned long ulMax = clk_get_rate(psClock);
+	unsigned long ulRate;
+	IMG_UINT32 i, ui32Levels = 0;
+
+	mutex_init(&gsSysDvfs.sLock);
+	spin_lock_init(&gsSysDvfs.sStatLock);
+	INIT_DELAYED_WORK_DEFERRABLE(&gsSysDvfs.sWork, SysDvfsWork);
+
+	gsSysDvfs.psClock = psClock;
+
+	/* Full, two thirds and half speed, as far as the divider allows */
+	for (i = 0; i < SYS_DVFS_LEVELS; i++)
+	{
+		ulRate = clk_round_rate(psClock, ulMax * 2 / (i + 2));
+		if (ui32Levels && ulRate >= gsSysDvfs.aulRate[ui32Levels - 1])
+		{
+			continue;
+		}
+		gsSysDvfs.aulRate[ui32Levels++] = ulRate;
+	}
+
+	gsSysDvfs.ui32Levels = ui32Levels;
+	gsSysDvfs.ui32Level = 0;
+
+	INIT_WORK(&gsSysDvfs.sBoostWork, SysDvfsBoostWork);
+	gsSysDvfs.sBoostNb.notifier_call = SysDvfsBoostNotifier;
+	input_boost_register_notifier(&gsSysDvfs.sBoostNb);
+}
+
+IMG_VOID SysDvfsDeinit(IMG_VOID)
+{
+	input_boost_unregister_notifier(&gsSysDvfs.sBoostNb);
+	cancel_work_sync(&gsSysDvfs.sBoostWork);
+
+	mutex_lock(&gsSysDvfs.sLock);
+	gsSysDvfs.bPowered = IMG_FALSE;
+	mutex_unlock(&gsSysDvfs.sLock);
+
+	cancel_delayed_work_sync(&gsSysDvfs.sWork);
+	clk_set_rate(gsSysDvfs.psClock, gsSysDvfs.aulRate[0]);
+}
+
+/* Called with the G3D clock just enabled */
+IMG_VOID SysDvfsPowerOn(IMG_VOID)
+{
+	unsigned long ulFlags;
+
+	mutex_lock(&gsSysDvfs.sLock);
+	clk_set_rate(gsSysDvfs.psClock, gsSysDvfs.aulRate[gsSysDvfs.ui32Level]);
+
+	/* Powering up means there is work queued for SGX */
+	spin_lock_irqsave(&gsSysDvfs.sStatLock, ulFlags);
+	gsSysDvfs.sLast = ktime_get();
+	gsSysDvfs.bBusy = IMG_TRUE;
+	spin_unlock_irqrestore(&gsSysDvfs.sStatLock, ulFlags);
+
+	gsSysDvfs.bPowered = IMG_TRUE;
+	schedule_delayed_work(&gsSysDvfs.sWork,
+						  msecs_to_jiffies(SYS_DVFS_PERIOD_MS));
+	mutex_unlock(&gsSysDvfs.sLock);
+}
+
+/* Called with the G3D clock about to be disabled */
+IMG_VOID SysDvfsPowerOff(IMG_VOID)
+{
+	unsigned long ulFlags;
+
+	mutex_lock(&gsSysDvfs.sLock);
+	gsSysDvfs.bPowered = IMG_FALSE;
+
+	spin_lock_irqsave(&gsSysDvfs.sStatLock, ulFlags);
+	SysDvfsAccount(ktime_get());
+	gsSysDvfs.bBusy = IMG_FALSE;
+	spin_unlock_irqrestore(&gsSysDvfs.sStatLock, ulFlags);
+	mutex_unlock(&gsSysDvfs.sLock);
+
+	/* The next power up reschedules it; a running one sees bPowered */
+	cancel_delayed_work(&gsSysDvfs.sWork);
+}
+#endif /* defined(SYS_SGX_CLOCK_SCALING) */
+
 
 
 
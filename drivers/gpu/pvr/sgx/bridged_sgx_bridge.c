@@ -585,6 +585,15 @@ SGXDoKickBW(IMG_UINT32 ui32BridgeID,
 					&psDoKickIN->sCCBKick);
 #endif
 
+	if(psRetOUT->eError == PVRSRV_OK)
+	{
+		psPerProc->sStats.ui32TAKicks++;
+		if(psDoKickIN->sCCBKick.bLastInScene)
+		{
+			psPerProc->sStats.ui32Scenes++;
+		}
+	}
+
 PVRSRV_BRIDGE_SGX_DOKICK_RETURN_RESULT:
 
 	if(phKernelSyncInfoHandles)
@@ -777,6 +786,11 @@ SGXSubmitTransferBW(IMG_UINT32 ui32BridgeID,
 	psRetOUT->eError = SGXSubmitTransferKM(hDevCookieInt, psKick);
 #endif
 
+	if(psRetOUT->eError == PVRSRV_OK)
+	{
+		psPerProc->sStats.ui32TransferKicks++;
+	}
+
 	return 0;
 }
 
@@ -1054,6 +1068,11 @@ SGXSubmit2DBW(IMG_UINT32 ui32BridgeID,
 		SGXSubmit2DKM(hDevCookieInt, psKick);
 #endif
 
+	if(psRetOUT->eError == PVRSRV_OK)
+	{
+		psPerProc->sStats.ui322DKicks++;
+	}
+
 	return 0;
 }
 #endif 
@@ -38,6 +38,12 @@
 #include "sgxconfig.h"
 #include "sgx_bridge_km.h"
 #include "pdump_osfunc.h"
+#include "proc.h"
+#include "mutex.h"
+
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
 
 #define UINT32_MAX_VALUE	0xFFFFFFFFUL
 
@@ -298,7 +304,7 @@ static IMG_VOID MakeKernelPageReadWrite(IMG_PVOID ulCPUVAddr)
 	ptent = pte_mkwrite(ptent);
 	ptep_modify_prot_commit(&init_mm, ui32CPUVAddr, psPTE, ptent);
 
-	flush_tlb_all();
+	flush_tlb_kernel_range(ui32CPUVAddr, ui32CPUVAddr + PAGE_SIZE);
 }
 
 static IMG_VOID MakeKernelPageReadOnly(IMG_PVOID ulCPUVAddr)
@@ -336,7 +342,7 @@ static IMG_VOID MakeKernelPageReadOnly(IMG_PVOID ulCPUVAddr)
 	ptent = pte_wrprotect(ptent);
 	ptep_modify_prot_commit(&init_mm, ui32CPUVAddr, psPTE, ptent);
 
-	flush_tlb_all();
+	flush_tlb_kernel_range(ui32CPUVAddr, ui32CPUVAddr + PAGE_SIZE);
 
 }
 
@@ -354,6 +360,113 @@ static INLINE IMG_VOID MakeKernelPageReadOnly(IMG_PVOID ulCPUVAddr)
 
 #endif 
 
+/*
+ * Map and unmap write a run of PTEs. Rather than making the page table
+ * writable around every entry, a run opens each page table once and
+ * closes it when the run moves on to the next one or ends.
+ */
+static INLINE IMG_VOID MMU_OpenPTForWrite(IMG_PVOID *ppvWritablePT, IMG_PVOID pvPTCpuVAddr)
+{
+	if (*ppvWritablePT != pvPTCpuVAddr)
+	{
+		if (*ppvWritablePT)
+		{
+			MakeKernelPageReadOnly(*ppvWritablePT);
+		}
+		MakeKernelPageReadWrite(pvPTCpuVAddr);
+		*ppvWritablePT = pvPTCpuVAddr;
+	}
+}
+
+static INLINE IMG_VOID MMU_ClosePTForWrite(IMG_PVOID *ppvWritablePT)
+{
+	if (*ppvWritablePT)
+	{
+		MakeKernelPageReadOnly(*ppvWritablePT);
+		*ppvWritablePT = IMG_NULL;
+	}
+}
+
+/*
+ * Time spent writing SGX page tables, for /proc/pvr/mmu_stats. Map and
+ * unmap run under gPVRSRVLock, which keeps the counters consistent.
+ */
+typedef struct _MMU_OP_STATS_
+{
+	IMG_UINT32 ui32Calls;
+	IMG_UINT64 ui64Bytes;
+	IMG_UINT64 ui64TimeUs;
+} MMU_OP_STATS;
+
+static MMU_OP_STATS g_sMMUMapStats;
+static MMU_OP_STATS g_sMMUUnmapStats;
+static struct proc_dir_entry *g_ProcMMUStats;
+
+extern PVRSRV_LINUX_MUTEX gPVRSRVLock;
+
+static IMG_VOID MMU_AccountOp(MMU_OP_STATS *psStats, IMG_SIZE_T uBytes, ktime_t sStart)
+{
+	psStats->ui32Calls++;
+	psStats->ui64Bytes += uBytes;
+	psStats->ui64TimeUs += ktime_us_delta(ktime_get(), sStart);
+}
+
+static IMG_VOID MMU_ShowOpStats(struct seq_file *sfile, const IMG_CHAR *pszName, MMU_OP_STATS *psStats)
+{
+	IMG_UINT64 ui64UsPerMB = 0;
+
+	if (psStats->ui64Bytes)
+	{
+		ui64UsPerMB = div64_u64(psStats->ui64TimeUs << 20, psStats->ui64Bytes);
+	}
+	seq_printf(sfile, "%-6s %10u %10llu %12llu %10llu\n",
+			   pszName, psStats->ui32Calls, psStats->ui64Bytes >> 20,
+			   psStats->ui64TimeUs, ui64UsPerMB);
+}
+
+static void ProcSeqShowMMUStats(struct seq_file *sfile, void *el)
+{
+	if (el == PVR_PROC_SEQ_START_TOKEN)
+	{
+		seq_printf(sfile, "%-6s %10s %10s %12s %10s\n",
+				   "op", "calls", "MB", "total_us", "us_per_MB");
+		return;
+	}
+	MMU_ShowOpStats(sfile, "map", &g_sMMUMapStats);
+	MMU_ShowOpStats(sfile, "unmap", &g_sMMUUnmapStats);
+}
+
+static void ProcSeqStartstopMMUStats(struct seq_file *sfile, IMG_BOOL start)
+{
+	PVR_UNREFERENCED_PARAMETER(sfile);
+
+	if (start)
+	{
+		LinuxLockMutex(&gPVRSRVLock);
+	}
+	else
+	{
+		LinuxUnLockMutex(&gPVRSRVLock);
+	}
+}
+
+IMG_VOID MMU_CreateStatsEntry(IMG_VOID)
+{
+	g_ProcMMUStats = CreateProcReadEntrySeq("mmu_stats", NULL, NULL,
+											ProcSeqShowMMUStats,
+											ProcSeq1ElementHeaderOff2Element,
+											ProcSeqStartstopMMUStats);
+}
+
+IMG_VOID MMU_RemoveStatsEntry(IMG_VOID)
+{
+	if (g_ProcMMUStats)
+	{
+		RemoveProcEntrySeq(g_ProcMMUStats);
+		g_ProcMMUStats = IMG_NULL;
+	}
+}
+
 IMG_BOOL MMU_IsHeapShared(MMU_HEAP* pMMUHeap)
 {
 	switch(pMMUHeap->psDevArena->DevMemHeapType)
@@ -2827,7 +2940,8 @@ static IMG_VOID
 MMU_MapPage (MMU_HEAP *pMMUHeap,
 			 IMG_DEV_VIRTADDR DevVAddr,
 			 IMG_DEV_PHYADDR DevPAddr,
-			 IMG_UINT32 ui32MemFlags)
+			 IMG_UINT32 ui32MemFlags,
+			 IMG_PVOID *ppvWritablePT)
 {
 	IMG_UINT32 ui32Index;
 	IMG_UINT32 *pui32Tmp;
@@ -2917,13 +3031,12 @@ MMU_MapPage (MMU_HEAP *pMMUHeap,
 	
 	ppsPTInfoList[0]->ui32ValidPTECount++;
 
-	MakeKernelPageReadWrite(ppsPTInfoList[0]->PTPageCpuVAddr);
+	MMU_OpenPTForWrite(ppvWritablePT, ppsPTInfoList[0]->PTPageCpuVAddr);
 	
 	pui32Tmp[ui32Index] = ((DevPAddr.uiAddr>>SGX_MMU_PTE_ADDR_ALIGNSHIFT)
 						& ((~pMMUHeap->ui32DataPageMask)>>SGX_MMU_PTE_ADDR_ALIGNSHIFT))
 						| SGX_MMU_PTE_VALID
 						| ui32MMUFlags;
-	MakeKernelPageReadOnly(ppsPTInfoList[0]->PTPageCpuVAddr);
 	CheckPT(ppsPTInfoList[0]);
 }
 
@@ -2941,6 +3054,8 @@ MMU_MapScatter (MMU_HEAP *pMMUHeap,
 #endif 
 	IMG_UINT32 uCount, i;
 	IMG_DEV_PHYADDR DevPAddr;
+	IMG_PVOID pvWritablePT = IMG_NULL;
+	ktime_t sStart = ktime_get();
 
 	PVR_ASSERT (pMMUHeap != IMG_NULL);
 
@@ -2962,13 +3077,15 @@ MMU_MapScatter (MMU_HEAP *pMMUHeap,
 
 		DevPAddr = SysSysPAddrToDevPAddr(PVRSRV_DEVICE_TYPE_SGX, sSysAddr);
 
-		MMU_MapPage (pMMUHeap, DevVAddr, DevPAddr, ui32MemFlags);
+		MMU_MapPage (pMMUHeap, DevVAddr, DevPAddr, ui32MemFlags, &pvWritablePT);
 		DevVAddr.uiAddr += pMMUHeap->ui32DataPageSize;
 
 		PVR_DPF ((PVR_DBG_MESSAGE,
 				 "MMU_MapScatter: devVAddr=%08X, SysAddr=%08X, size=0x%x/0x%x",
 				  DevVAddr.uiAddr, sSysAddr.uiAddr, uCount, uSize));
 	}
+	MMU_ClosePTForWrite(&pvWritablePT);
+	MMU_AccountOp(&g_sMMUMapStats, uSize, sStart);
 
 #if defined(PDUMP)
 	MMU_PDumpPageTables (pMMUHeap, MapBaseDevVAddr, uSize, IMG_FALSE, hUniqueTag);
@@ -2990,6 +3107,8 @@ MMU_MapPages (MMU_HEAP *pMMUHeap,
 	IMG_UINT32 uCount;
 	IMG_UINT32 ui32VAdvance;
 	IMG_UINT32 ui32PAdvance;
+	IMG_PVOID pvWritablePT = IMG_NULL;
+	ktime_t sStart = ktime_get();
 
 	PVR_ASSERT (pMMUHeap != IMG_NULL);
 
@@ -3032,10 +3151,12 @@ MMU_MapPages (MMU_HEAP *pMMUHeap,
 
 	for (uCount=0; uCount<uSize; uCount+=ui32VAdvance)
 	{
-		MMU_MapPage (pMMUHeap, DevVAddr, DevPAddr, ui32MemFlags);
+		MMU_MapPage (pMMUHeap, DevVAddr, DevPAddr, ui32MemFlags, &pvWritablePT);
 		DevVAddr.uiAddr += ui32VAdvance;
 		DevPAddr.uiAddr += ui32PAdvance;
 	}
+	MMU_ClosePTForWrite(&pvWritablePT);
+	MMU_AccountOp(&g_sMMUMapStats, uSize, sStart);
 
 #if defined(PDUMP)
 	MMU_PDumpPageTables (pMMUHeap, MapBaseDevVAddr, uSize, IMG_FALSE, hUniqueTag);
@@ -3057,6 +3178,8 @@ MMU_MapShadow (MMU_HEAP          *pMMUHeap,
 	IMG_DEV_VIRTADDR	MapDevVAddr;
 	IMG_UINT32			ui32VAdvance;
 	IMG_UINT32			ui32PAdvance;
+	IMG_PVOID			pvWritablePT = IMG_NULL;
+	ktime_t				sStart = ktime_get();
 
 #if !defined (PDUMP)
 	PVR_UNREFERENCED_PARAMETER(hUniqueTag);
@@ -3121,12 +3244,14 @@ MMU_MapShadow (MMU_HEAP          *pMMUHeap,
 				MapDevVAddr.uiAddr,
 				DevPAddr.uiAddr));
 
-		MMU_MapPage (pMMUHeap, MapDevVAddr, DevPAddr, ui32MemFlags);
+		MMU_MapPage (pMMUHeap, MapDevVAddr, DevPAddr, ui32MemFlags, &pvWritablePT);
 
 		
 		MapDevVAddr.uiAddr += ui32VAdvance;
 		uOffset += ui32PAdvance;
 	}
+	MMU_ClosePTForWrite(&pvWritablePT);
+	MMU_AccountOp(&g_sMMUMapStats, uByteSize, sStart);
 
 #if defined(PDUMP)
 	MMU_PDumpPageTables (pMMUHeap, MapBaseDevVAddr, uByteSize, IMG_FALSE, hUniqueTag);
@@ -3146,6 +3271,8 @@ MMU_UnmapPages (MMU_HEAP *psMMUHeap,
 	IMG_UINT32			ui32PDIndex;
 	IMG_UINT32			ui32PTIndex;
 	IMG_UINT32			*pui32Tmp;
+	IMG_PVOID			pvWritablePT = IMG_NULL;
+	ktime_t				sStart = ktime_get();
 
 #if !defined (PDUMP)
 	PVR_UNREFERENCED_PARAMETER(hUniqueTag);
@@ -3208,7 +3335,7 @@ MMU_UnmapPages (MMU_HEAP *psMMUHeap,
 		
 		PVR_ASSERT((IMG_INT32)ppsPTInfoList[0]->ui32ValidPTECount >= 0);
 
-		MakeKernelPageReadWrite(ppsPTInfoList[0]->PTPageCpuVAddr);
+		MMU_OpenPTForWrite(&pvWritablePT, ppsPTInfoList[0]->PTPageCpuVAddr);
 #if defined(SUPPORT_SGX_MMU_DUMMY_PAGE)
 		
 		pui32Tmp[ui32PTIndex] = (psMMUHeap->psMMUContext->psDevInfo->sDummyDataDevPAddr.uiAddr>>SGX_MMU_PTE_ADDR_ALIGNSHIFT)
@@ -3221,15 +3348,16 @@ MMU_UnmapPages (MMU_HEAP *psMMUHeap,
 		pui32Tmp[ui32PTIndex] = 0;
 #endif
 #endif
-		MakeKernelPageReadOnly(ppsPTInfoList[0]->PTPageCpuVAddr);
 
 		CheckPT(ppsPTInfoList[0]);
 
 		
 		sTmpDevVAddr.uiAddr += uPageSize;
 	}
+	MMU_ClosePTForWrite(&pvWritablePT);
 
 	MMU_InvalidatePageTableCache(psMMUHeap->psMMUContext->psDevInfo);
+	MMU_AccountOp(&g_sMMUUnmapStats, uPageSize * ui32PageCount, sStart);
 
 #if defined(PDUMP)
 	MMU_PDumpPageTables (psMMUHeap, sDevVAddr, uPageSize*ui32PageCount, IMG_TRUE, hUniqueTag);
@@ -700,6 +700,8 @@ static PVRSRV_ERROR DevInitSGXPart1 (IMG_VOID *pvDeviceNode)
 		return eError;
 	}
 
+	MMU_CreateStatsEntry();
+
 	return PVRSRV_OK;
 }
 
@@ -895,6 +897,8 @@ static PVRSRV_ERROR DevDeInitSGX (IMG_VOID *pvDeviceNode)
 		return PVRSRV_OK;
 	}
 
+	MMU_RemoveStatsEntry();
+
 #if defined(SUPPORT_HW_RECOVERY)
 	if (psDevInfo->hTimer)
 	{
@@ -35,6 +35,7 @@
 #include <linux/cpufreq.h>
 #include <linux/slab.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 
 #include <asm/irq.h>
 
@@ -56,6 +57,15 @@ enum s3c24xx_i2c_type {
 	TYPE_S3C2440,
 };
 
+struct s3c24xx_i2c_stats {
+	unsigned long		xfers;
+	unsigned long		polled;
+	unsigned long		irqs;
+	unsigned long		errors;
+	u64			total_ns;
+	u64			max_ns;
+};
+
 struct s3c24xx_i2c {
 	spinlock_t		lock;
 	wait_queue_head_t	wait;
@@ -71,6 +81,9 @@ struct s3c24xx_i2c {
 
 	enum s3c24xx_i2c_state	state;
 	unsigned long		clkrate;
+	unsigned int		bus_freq;	/* KHz */
+
+	struct s3c24xx_i2c_stats stats;
 
 	void __iomem		*regs;
 	struct clk		*clk;
@@ -85,6 +98,14 @@ struct s3c24xx_i2c {
 
 /* default platform data removed, dev should always carry data. */
 
+/* Transfers expected to be over within this are polled, 0 for none */
+static unsigned int poll_max_us = 100;
+module_param(poll_max_us, uint, 0644);
+MODULE_PARM_DESC(poll_max_us, "longest transfer polled instead of using the IRQ (us)");
+
+/* Busy wait for the STOP to clear before sleeping, in us */
+#define S3C24XX_I2C_IDLE_US	100
+
 /* s3c24xx_i2c_is2440()
  *
  * return true is this is an s3c2440
@@ -435,6 +456,8 @@ static irqreturn_t s3c24xx_i2c_irq(int irqno, void *dev_id)
 	unsigned long status;
 	unsigned long tmp;
 
+	i2c->stats.irqs++;
+
 	status = readl(i2c->regs + S3C2410_IICSTAT);
 
 	if (status & S3C2410_IICSTAT_ARBITR) {
@@ -487,6 +510,76 @@ static int s3c24xx_i2c_set_master(struct s3c24xx_i2c *i2c)
 	return -ETIMEDOUT;
 }
 
+/* s3c24xx_i2c_xfer_us
+ *
+ * the bus time of a set of messages, address bytes and acks included
+*/
+
+static unsigned int s3c24xx_i2c_xfer_us(struct s3c24xx_i2c *i2c,
+					struct i2c_msg *msgs, int num)
+{
+	unsigned int bytes = 0;
+	int i;
+
+	if (!i2c->bus_freq)
+		return UINT_MAX;
+
+	for (i = 0; i < num; i++)
+		bytes += msgs[i].len + 1;
+
+	return bytes * 9 * 1000 / i2c->bus_freq;
+}
+
+/* s3c24xx_i2c_poll
+ *
+ * run the state machine off the pending bit with the IRQ masked. A
+ * short transfer is over before the interrupts and the wakeup for it
+ * would be. If the slave stretches the clock past budget_us, the IRQ
+ * is turned back on to finish the job and false is returned.
+*/
+
+static bool s3c24xx_i2c_poll(struct s3c24xx_i2c *i2c, unsigned int budget_us)
+{
+	ktime_t start = ktime_get();
+
+	while (i2c->msg_num != 0) {
+		if (readl(i2c->regs + S3C2410_IICCON) & S3C2410_IICCON_IRQPEND) {
+			spin_lock_irq(&i2c->lock);
+			i2c_s3c_irq_nextbyte(i2c,
+					readl(i2c->regs + S3C2410_IICSTAT));
+			spin_unlock_irq(&i2c->lock);
+			continue;
+		}
+
+		if (ktime_us_delta(ktime_get(), start) > budget_us) {
+			spin_lock_irq(&i2c->lock);
+			if (i2c->msg_num != 0)
+				s3c24xx_i2c_enable_irq(i2c);
+			spin_unlock_irq(&i2c->lock);
+			return false;
+		}
+
+		cpu_relax();
+	}
+
+	return true;
+}
+
+static void s3c24xx_i2c_account(struct s3c24xx_i2c *i2c, ktime_t start,
+				bool polled, bool error)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	i2c->stats.xfers++;
+	if (polled)
+		i2c->stats.polled++;
+	if (error)
+		i2c->stats.errors++;
+	i2c->stats.total_ns += ns;
+	if (ns > i2c->stats.max_ns)
+		i2c->stats.max_ns = ns;
+}
+
 /* s3c24xx_i2c_doxfer
  *
  * this starts an i2c transfer
@@ -495,8 +588,11 @@ static int s3c24xx_i2c_set_master(struct s3c24xx_i2c *i2c)
 static int s3c24xx_i2c_doxfer(struct s3c24xx_i2c *i2c,
 			      struct i2c_msg *msgs, int num)
 {
-	unsigned long iicstat, timeout;
-	int spins = 20;
+	unsigned long iicstat, timeout = 1;
+	unsigned int xfer_us;
+	ktime_t start;
+	bool polled;
+	int spins = S3C24XX_I2C_IDLE_US;
 	int ret;
 
 	if (i2c->suspended)
@@ -509,6 +605,10 @@ static int s3c24xx_i2c_doxfer(struct s3c24xx_i2c *i2c,
 		goto out;
 	}
 
+	start = ktime_get();
+	xfer_us = s3c24xx_i2c_xfer_us(i2c, msgs, num);
+	polled = xfer_us <= poll_max_us;
+
 	spin_lock_irq(&i2c->lock);
 
 	i2c->msg     = msgs;
@@ -517,11 +617,19 @@ static int s3c24xx_i2c_doxfer(struct s3c24xx_i2c *i2c,
 	i2c->msg_idx = 0;
 	i2c->state   = STATE_START;
 
-	s3c24xx_i2c_enable_irq(i2c);
+	if (polled)
+		s3c24xx_i2c_disable_irq(i2c);
+	else
+		s3c24xx_i2c_enable_irq(i2c);
 	s3c24xx_i2c_message_start(i2c, msgs);
 	spin_unlock_irq(&i2c->lock);
 
-	timeout = wait_event_timeout(i2c->wait, i2c->msg_num == 0, HZ * 5);
+	if (polled && !s3c24xx_i2c_poll(i2c, 2 * xfer_us + 100))
+		polled = false;
+
+	if (!polled)
+		timeout = wait_event_timeout(i2c->wait, i2c->msg_num == 0,
+					     HZ * 5);
 
 	ret = i2c->msg_idx;
 
@@ -537,9 +645,10 @@ static int s3c24xx_i2c_doxfer(struct s3c24xx_i2c *i2c,
 
 	dev_dbg(i2c->dev, "waiting for bus idle\n");
 
-	/* first, try busy waiting briefly */
+	/* first, try busy waiting briefly: the STOP takes a few bit
+	 * times, far less than the sleep below would */
 	do {
-		cpu_relax();
+		udelay(1);
 		iicstat = readl(i2c->regs + S3C2410_IICSTAT);
 	} while ((iicstat & S3C2410_IICSTAT_START) && --spins);
 
@@ -566,6 +675,8 @@ static int s3c24xx_i2c_doxfer(struct s3c24xx_i2c *i2c,
 		iicstat &= ~S3C2410_IICSTAT_TXRXEN;
 		writel(iicstat, i2c->regs + S3C2410_IICSTAT);
 	}
+
+	s3c24xx_i2c_account(i2c, start, polled, timeout == 0 || ret != num);
 	spin_unlock_irq(&i2c->lock);
 
  out:
@@ -683,6 +794,7 @@ static int s3c24xx_i2c_clockrate(struct s3c24xx_i2c *i2c, unsigned int *got)
 	}
 
 	*got = freq;
+	i2c->bus_freq = freq;
 
 	iiccon = readl(i2c->regs + S3C2410_IICCON);
 	iiccon &= ~(S3C2410_IICCON_SCALEMASK | S3C2410_IICCON_TXDIV_512);
@@ -807,6 +919,51 @@ static int s3c24xx_i2c_init(struct s3c24xx_i2c *i2c)
 	return 0;
 }
 
+static unsigned long s3c24xx_i2c_us(u64 ns)
+{
+	do_div(ns, NSEC_PER_USEC);
+	return (unsigned long)ns;
+}
+
+static ssize_t s3c24xx_i2c_stats_show(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct s3c24xx_i2c *i2c = dev_get_drvdata(dev);
+	struct s3c24xx_i2c_stats stats;
+	u64 avg_ns;
+
+	spin_lock_irq(&i2c->lock);
+	stats = i2c->stats;
+	spin_unlock_irq(&i2c->lock);
+
+	avg_ns = stats.total_ns;
+	if (stats.xfers)
+		do_div(avg_ns, stats.xfers);
+
+	return scnprintf(buf, PAGE_SIZE,
+			 "xfers %lu\npolled %lu\nirqs %lu\nerrors %lu\n"
+			 "avg_us %lu\nmax_us %lu\n",
+			 stats.xfers, stats.polled, stats.irqs, stats.errors,
+			 s3c24xx_i2c_us(avg_ns), s3c24xx_i2c_us(stats.max_ns));
+}
+
+/* Any write clears the statistics */
+static ssize_t s3c24xx_i2c_stats_store(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t count)
+{
+	struct s3c24xx_i2c *i2c = dev_get_drvdata(dev);
+
+	spin_lock_irq(&i2c->lock);
+	memset(&i2c->stats, 0, sizeof(i2c->stats));
+	spin_unlock_irq(&i2c->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(xfer_stats, S_IRUGO | S_IWUSR,
+		   s3c24xx_i2c_stats_show, s3c24xx_i2c_stats_store);
+
 /* s3c24xx_i2c_probe
  *
  * called by the bus driver when a suitable device is found
@@ -936,6 +1093,9 @@ static int s3c24xx_i2c_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, i2c);
 
+	if (device_create_file(&pdev->dev, &dev_attr_xfer_stats))
+		dev_warn(&pdev->dev, "failed to create xfer_stats\n");
+
 	dev_info(&pdev->dev, "%s: S3C I2C adapter\n", dev_name(&i2c->adap.dev));
 	clk_disable(i2c->clk);
 	return 0;
@@ -973,6 +1133,7 @@ static int s3c24xx_i2c_remove(struct platform_device *pdev)
 
 	s3c24xx_i2c_deregister_cpufreq(i2c);
 
+	device_remove_file(&pdev->dev, &dev_attr_xfer_stats);
 	i2c_del_adapter(&i2c->adap);
 	free_irq(i2c->irq, i2c);
 
@@ -425,6 +425,7 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 		if (input_event_to_user(buffer + retval, &event))
 			return -EFAULT;
 
+		input_latency_read(evdev->handle.dev, &event);
 		retval += input_event_size();
 	}
 
@@ -358,6 +358,52 @@ static int input_get_disposition(struct input_dev *dev,
 	return disposition;
 }
 
+#ifdef CONFIG_INPUT_LATENCY
+static void __input_latency_account(struct input_dev *dev, int stage, s64 ns)
+{
+	int bucket = ns > 0 ? fls(div_s64(ns, NSEC_PER_USEC)) : 0;
+
+	dev->latency.hist[stage][min(bucket, INPUT_LATENCY_BUCKETS - 1)]++;
+}
+
+void input_latency_account(struct input_dev *dev, int stage, ktime_t start)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->event_lock, flags);
+	__input_latency_account(dev, stage,
+				ktime_to_ns(ktime_sub(ktime_get(), start)));
+	spin_unlock_irqrestore(&dev->event_lock, flags);
+}
+EXPORT_SYMBOL(input_latency_account);
+
+/* evdev stamps events with the monotonic clock, same as ktime_get() */
+void input_latency_read(struct input_dev *dev, const struct input_event *ev)
+{
+	ktime_t sync;
+
+	if (ev->type != EV_SYN || ev->code != SYN_REPORT)
+		return;
+
+	sync = ktime_set(ev->time.tv_sec, ev->time.tv_usec * NSEC_PER_USEC);
+	input_latency_account(dev, INPUT_LATENCY_READ, sync);
+}
+EXPORT_SYMBOL(input_latency_read);
+
+/* Called with dev->event_lock held */
+static void input_latency_sync(struct input_dev *dev)
+{
+	if (!dev->latency.irq.tv64)
+		return;
+
+	__input_latency_account(dev, INPUT_LATENCY_SYNC,
+		ktime_to_ns(ktime_sub(ktime_get(), dev->latency.irq)));
+	dev->latency.irq.tv64 = 0;
+}
+#else
+static inline void input_latency_sync(struct input_dev *dev) {}
+#endif
+
 static void input_handle_event(struct input_dev *dev,
 			       unsigned int type, unsigned int code, int value)
 {
@@ -391,6 +437,7 @@ static void input_handle_event(struct input_dev *dev,
 		if (dev->num_vals >= 2)
 			input_pass_values(dev, dev->vals, dev->num_vals);
 		dev->num_vals = 0;
+		input_latency_sync(dev);
 	} else if (dev->num_vals >= dev->max_vals - 2) {
 		dev->vals[dev->num_vals++] = input_value_sync;
 		input_pass_values(dev, dev->vals, dev->num_vals);
@@ -1364,12 +1411,65 @@ static ssize_t input_dev_show_properties(struct device *dev,
 }
 static DEVICE_ATTR(properties, S_IRUGO, input_dev_show_properties, NULL);
 
+#ifdef CONFIG_INPUT_LATENCY
+static ssize_t input_dev_show_latency(struct device *dev,
+				      struct device_attribute *attr,
+				      char *buf)
+{
+	static const char * const stages[INPUT_LATENCY_STAGES] = {
+		"irq-thread", "irq-sync", "sync-read",
+	};
+	struct input_dev *input_dev = to_input_dev(dev);
+	struct input_latency latency;
+	int len, stage, i;
+
+	spin_lock_irq(&input_dev->event_lock);
+	latency = input_dev->latency;
+	spin_unlock_irq(&input_dev->event_lock);
+
+	len = scnprintf(buf, PAGE_SIZE, "%-10s", "< us");
+	for (i = 0; i < INPUT_LATENCY_BUCKETS - 1; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, " %6u", 1U << i);
+	len += scnprintf(buf + len, PAGE_SIZE - len, " %6s\n", "more");
+
+	for (stage = 0; stage < INPUT_LATENCY_STAGES; stage++) {
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%-10s",
+				 stages[stage]);
+		for (i = 0; i < INPUT_LATENCY_BUCKETS; i++)
+			len += scnprintf(buf + len, PAGE_SIZE - len, " %6u",
+					 latency.hist[stage][i]);
+		len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+	}
+
+	return len;
+}
+
+/* Any write clears the histograms */
+static ssize_t input_dev_store_latency(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t count)
+{
+	struct input_dev *input_dev = to_input_dev(dev);
+
+	spin_lock_irq(&input_dev->event_lock);
+	memset(input_dev->latency.hist, 0, sizeof(input_dev->latency.hist));
+	spin_unlock_irq(&input_dev->event_lock);
+
+	return count;
+}
+static DEVICE_ATTR(latency, S_IRUGO | S_IWUSR, input_dev_show_latency,
+		   input_dev_store_latency);
+#endif
+
 static struct attribute *input_dev_attrs[] = {
 	&dev_attr_name.attr,
 	&dev_attr_phys.attr,
 	&dev_attr_uniq.attr,
 	&dev_attr_modalias.attr,
 	&dev_attr_properties.attr,
+#ifdef CONFIG_INPUT_LATENCY
+	&dev_attr_latency.attr,
+#endif
 	NULL
 };
 
@@ -381,7 +381,7 @@ static void notify_led_off(void) {
 	if (unlikely(bl_devdata->is_dead) || !bl_on)
 		goto out;
 
-	if (bl_on && bl_timer.expires < jiffies) // Don't disable if there's a timer scheduled
+	if (bl_on && !timer_pending(&bl_timer)) // Don't disable if there's a timer scheduled
 		i2c_touchkey_write_byte(bl_devdata, bl_devdata->backlight_off);
 
 	bl_devdata->pdata->touchkey_sleep_onoff(TOUCHKEY_OFF);
@@ -412,6 +412,13 @@ static void cypress_touchkey_early_suspend(struct early_suspend *h)
 
 	disable_irq(devdata->client->irq);
 
+	/*
+	 * No key can restart the timeout now, and bl_off() would not touch
+	 * a sleeping keypad anyway: don't let it wake the CPU to find out.
+	 */
+	del_timer_sync(&bl_timer);
+	cancel_work_sync(&bl_off_work);
+
 	if (!bl_on)
 		devdata->pdata->touchkey_onoff(TOUCHKEY_OFF);
 
@@ -661,7 +668,9 @@ static int __devexit i2c_touchkey_remove(struct i2c_client *client)
 	free_irq(client->irq, devdata);
 	all_keys_up(devdata);
 	input_unregister_device(devdata->input_dev);
-    del_timer(&bl_timer);
+	del_timer_sync(&bl_timer);
+	cancel_work_sync(&bl_off_work);
+	bl_devdata = NULL;
 	kfree(devdata);
 	return 0;
 }
@@ -25,6 +25,7 @@
 #include <linux/jiffies.h>
 #include <plat/iic.h> //#include "cytma340.h"
 #include <linux/workqueue.h>
+#include <linux/async.h>
 #include <plat/regs-watchdog.h>
 
 /*
@@ -2044,7 +2045,7 @@ struct device *ts_dev;
 * ***************************************************************************/
 
 
-int __init cytouch_init(void)
+static int __init cytouch_init_sync(void)
 {
 	int ret;
 
@@ -2134,6 +2135,22 @@ int __init cytouch_init(void)
 	return 0;
 }
 
+static void __init cytouch_init_async(void *data, async_cookie_t cookie)
+{
+	cytouch_init_sync();
+}
+
+/*
+ * Powering the controller up and probing it sleeps for 400ms and more,
+ * twice that when it has to be reprogrammed: let the rest of boot go on.
+ * The sec class it adds its device to is created by the board.
+ */
+int __init cytouch_init(void)
+{
+	async_schedule(cytouch_init_async, NULL);
+	return 0;
+}
+
 void __exit cytouch_exit(void)
 {
 	i2c_del_driver(&cytouch_i2c_driver);
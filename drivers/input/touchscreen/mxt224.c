@@ -22,6 +22,7 @@
 #include <linux/earlysuspend.h>
 #include <linux/slab.h>
 #include <linux/gpio.h>
+#include <linux/async.h>
 #include <linux/input/mxt224.h>
 #include <asm/unaligned.h>
 
@@ -39,6 +40,9 @@
 
 #define ID_BLOCK_SIZE			7
 
+/* Most T5 messages fetched by one I2C read when the chip has a T44 */
+#define MXT224_BURST_MSGS		16
+
 // Accidental touch key prevention (see cypress-touchkey.c)
 unsigned int touch_state_val = 0;
 EXPORT_SYMBOL(touch_state_val);
@@ -70,8 +74,10 @@ struct mxt224_data {
 	const u8 *power_cfg;
 	u8 finger_type;
 	u16 msg_proc;
+	u16 msg_count;
 	u16 cmd_proc;
 	u16 msg_object_size;
+	u8 burst_msgs;
 	u32 x_dropbits:2;
 	u32 y_dropbits:2;
 	void (*power_on)(void);
@@ -294,6 +300,21 @@ static int __devinit mxt224_init_touch_driver(struct mxt224_data *data)
 	if (ret)
 		goto err;
 
+	/*
+	 * Reading past the end of T5 returns the next pending message, and
+	 * a T44 right in front of it gives their count in the same read.
+	 */
+	if (!get_object_info(data, GEN_MESSAGECOUNT_T44, &dummy,
+			     &data->msg_count) &&
+	    data->msg_count + 1 == data->msg_proc) {
+		data->burst_msgs = min_t(int, MXT224_BURST_MSGS,
+					 (255 - 1) / data->msg_object_size);
+		dev_dbg(&data->client->dev, "Burst reads of %d messages\n",
+					data->burst_msgs);
+	} else {
+		data->msg_count = 0;
+	}
+
 	return 0;
 
 err:
@@ -330,50 +351,83 @@ static void report_input_data(struct mxt224_data *data)
 	input_sync(data->input_dev);
 }
 
-static irqreturn_t mxt224_irq_thread(int irq, void *ptr)
+static void mxt224_process_msg(struct mxt224_data *data, const u8 *msg)
 {
-	struct mxt224_data *data = ptr;
 	int id;
-	u8 msg[data->msg_object_size];
 
-	do {
-		if (read_mem(data, data->msg_proc, sizeof(msg), msg))
-			return IRQ_HANDLED;
+	id = msg[0] - data->finger_type;
 
-		id = msg[0] - data->finger_type;
+	/* If not a touch event, then keep going */
+	if (id < 0 || id >= data->num_fingers)
+		return;
 
-		/* If not a touch event, then keep going */
-		if (id < 0 || id >= data->num_fingers)
-			continue;
+	/* A second message for a finger starts a new frame */
+	if (data->finger_mask & (1U << id))
+		report_input_data(data);
+
+	if (msg[1] & RELEASE_MSG_MASK) {
+		data->fingers[id].z = -1;
+		data->fingers[id].w = msg[5];
+		data->finger_mask |= 1U << id;
+		touch_state_val = 0;
+	} else if ((msg[1] & DETECT_MSG_MASK) && (msg[1] &
+			(PRESS_MSG_MASK | MOVE_MSG_MASK))) {
+		data->fingers[id].z = msg[6];
+		data->fingers[id].w = msg[5];
+		data->fingers[id].x = ((msg[2] << 4) | (msg[4] >> 4)) >>
+						data->x_dropbits;
+		data->fingers[id].y = ((msg[3] << 4) |
+				(msg[4] & 0xF)) >> data->y_dropbits;
+		data->finger_mask |= 1U << id;
+		touch_state_val = 1;
+	} else if ((msg[1] & SUPPRESS_MSG_MASK) &&
+		   (data->fingers[id].z != -1)) {
+		data->fingers[id].z = -1;
+		data->fingers[id].w = msg[5];
+		data->finger_mask |= 1U << id;
+	} else {
+		dev_dbg(&data->client->dev, "Unknown state %#02x %#02x"
+					"\n", msg[0], msg[1]);
+	}
+}
+
+static irqreturn_t mxt224_irq(int irq, void *ptr)
+{
+	struct mxt224_data *data = ptr;
+
+	input_latency_irq(data->input_dev);
+	return IRQ_WAKE_THREAD;
+}
 
-		if (data->finger_mask & (1U << id))
-			report_input_data(data);
-
-		if (msg[1] & RELEASE_MSG_MASK) {
-			data->fingers[id].z = -1;
-			data->fingers[id].w = msg[5];
-			data->finger_mask |= 1U << id;
-			touch_state_val = 0;
-		} else if ((msg[1] & DETECT_MSG_MASK) && (msg[1] &
-				(PRESS_MSG_MASK | MOVE_MSG_MASK))) {
-			data->fingers[id].z = msg[6];
-			data->fingers[id].w = msg[5];
-			data->fingers[id].x = ((msg[2] << 4) | (msg[4] >> 4)) >>
-							data->x_dropbits;
-			data->fingers[id].y = ((msg[3] << 4) |
-					(msg[4] & 0xF)) >> data->y_dropbits;
-			data->finger_mask |= 1U << id;
-			touch_state_val = 1;
-		} else if ((msg[1] & SUPPRESS_MSG_MASK) &&
-			   (data->fingers[id].z != -1)) {
-			data->fingers[id].z = -1;
-			data->fingers[id].w = msg[5];
-			data->finger_mask |= 1U << id;
-		} else {
-			dev_dbg(&data->client->dev, "Unknown state %#02x %#02x"
-						"\n", msg[0], msg[1]);
+static irqreturn_t mxt224_irq_thread(int irq, void *ptr)
+{
+	struct mxt224_data *data = ptr;
+	u16 size = data->msg_object_size;
+	u8 buf[1 + MXT224_BURST_MSGS * size];
+	u8 *msg = buf + 1;
+	int count, i;
+
+	input_latency_thread(data->input_dev);
+
+	do {
+		if (!data->msg_count) {
+			if (read_mem(data, data->msg_proc, size, msg))
+				return IRQ_HANDLED;
+			mxt224_process_msg(data, msg);
 			continue;
 		}
+
+		/* The count and the first message, then the rest at once */
+		if (read_mem(data, data->msg_count, 1 + size, buf))
+			return IRQ_HANDLED;
+
+		count = min_t(int, buf[0], data->burst_msgs);
+		if (count > 1 && read_mem(data, data->msg_proc,
+					  (count - 1) * size, msg + size))
+			return IRQ_HANDLED;
+
+		for (i = 0; i < count; i++)
+			mxt224_process_msg(data, msg + i * size);
 	} while (!gpio_get_value(data->gpio_read_done));
 
 	if (data->finger_mask)
@@ -567,7 +621,7 @@ static int __devinit mxt224_probe(struct i2c_client *client,
 	for (i = 0; i < data->num_fingers; i++)
 		data->fingers[i].z = -1;
 
-	ret = request_threaded_irq(client->irq, NULL, mxt224_irq_thread,
+	ret = request_threaded_irq(client->irq, mxt224_irq, mxt224_irq_thread,
 		IRQF_TRIGGER_LOW | IRQF_ONESHOT, "mxt224_ts", data);
 	if (ret < 0)
 		goto err_irq;
@@ -637,9 +691,19 @@ static struct i2c_driver mxt224_i2c_driver = {
 	},
 };
 
+static void __init mxt224_init_async(void *data, async_cookie_t cookie)
+{
+	int ret = i2c_add_driver(&mxt224_i2c_driver);
+
+	if (ret)
+		pr_err("mxt224: can't register driver: %d\n", ret);
+}
+
+/* The chip resets and reads its config over i2c in probe, off boot's path */
 static int __init mxt224_init(void)
 {
-	return i2c_add_driver(&mxt224_i2c_driver);
+	async_schedule(mxt224_init_async, NULL);
+	return 0;
 }
 
 static void __exit mxt224_exit(void)
@@ -39,6 +39,10 @@
 #define DEFAULT_FMT		V4L2_PIX_FMT_UYVY	/* YUV422 */
 #define POLL_TIME_MS		10
 
+/* Registers of consecutive addresses written in one I2C message */
+#define BURST_MAX_REGS		32
+#define PAGE_SELECT_REG		0xef
+
 /*
  * Specification
  * Parallel : ITU-R. 656/601 YUV422, RGB565, RGB888 (Up to VGA), RAW10
@@ -84,6 +88,8 @@ struct s5ka3dfx_state {
 	int vt_mode;		/*For VT camera */
 	int check_dataline;
 	int check_previewdata;
+	/* last table written since init, every table selects its page */
+	struct s5ka3dfx_reg *last_regs;
 };
 
 enum {
@@ -267,23 +273,56 @@ static int s5ka3dfx_i2c_write_multi(struct i2c_client *client,
 	return (ret == 1) ? 0 : -EIO;
 }
 
+/* regs[] must be at consecutive addresses, the sensor increments them */
+static int s5ka3dfx_i2c_write_burst(struct i2c_client *client,
+				    struct s5ka3dfx_reg regs[], int count)
+{
+	unsigned char buf[BURST_MAX_REGS + 1];
+	struct i2c_msg msg = { client->addr, 0, count + 1, buf };
+	int i;
+
+	buf[0] = regs[0].addr;
+	for (i = 0; i < count; i++)
+		buf[i + 1] = regs[i].val;
+
+	return i2c_transfer(client->adapter, &msg, 1) == 1 ? 0 : -EIO;
+}
+
 static int s5ka3dfx_write_regs(struct v4l2_subdev *sd,
 			       struct s5ka3dfx_reg regs[], int size)
 {
 	struct i2c_client *client = v4l2_get_subdevdata(sd);
-	int i, err;
+	struct s5ka3dfx_state *state = to_state(sd);
+	int i, j, n, err;
 
-	for (i = 0; i < size; i++) {
-		err = s5ka3dfx_i2c_write_multi(client,
-					       regs[i].addr, regs[i].val);
-		if (err < 0) {
-			v4l_info(client, "%s: register set failed\n", __func__);
-			break;
+	/* writing the same table again would change nothing */
+	if (regs == state->last_regs)
+		return 0;
+	state->last_regs = NULL;
+
+	for (i = 0; i < size; i += n) {
+		/* a page switch ends a run, the next address is in the new page */
+		for (n = 1; i + n < size && n < BURST_MAX_REGS; n++)
+			if (regs[i + n].addr != regs[i + n - 1].addr + 1 ||
+			    regs[i + n - 1].addr == PAGE_SELECT_REG)
+				break;
+
+		if (n > 1 && !s5ka3dfx_i2c_write_burst(client, &regs[i], n))
+			continue;
+
+		/* a single register, or a burst that failed */
+		for (j = i; j < i + n; j++) {
+			err = s5ka3dfx_i2c_write_multi(client,
+						       regs[j].addr, regs[j].val);
+			if (err < 0) {
+				v4l_info(client, "%s: register set failed\n",
+					 __func__);
+				return -EIO;
+			}
 		}
 	}
-	if (err < 0)
-		return -EIO;
 
+	state->last_regs = regs;
 	return 0;
 }
 
@@ -1084,6 +1123,9 @@ static int s5ka3dfx_init(struct v4l2_subdev *sd, u32 val)
 			state->vt_mode);
 	pr_debug("state->check_dataline : %d\n", state->check_dataline);
 
+	/* the sensor may have been powered off since */
+	state->last_regs = NULL;
+
 	s5ka3dfx_init_parameters(sd);
 	if (state->vt_mode == 0) {
 		if (state->check_dataline)
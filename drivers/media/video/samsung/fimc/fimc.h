@@ -17,6 +17,8 @@
 #ifdef __KERNEL__
 #include <linux/wait.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/wakelock.h>
 #include <linux/i2c.h>
 #include <linux/fb.h>
 #include <linux/videodev2.h>
@@ -193,6 +195,14 @@ struct fimc_capinfo {
 	/* flip: V4L2_CID_xFLIP, rotate: 90, 180, 270 */
 	u32			flip;
 	u32			rotate;
+
+	/* inq and outq, also updated by the preview interrupt */
+	spinlock_t		lock;
+
+	/* V4L2_CID_PREVIEW_FB: window shown frames go to, -1 if none */
+	int			preview_fb;
+	int			preview_buf;	/* buffer on screen, -1 if none */
+	u32			preview_dropped;
 };
 
 /* for output overlay device */
@@ -255,6 +265,12 @@ struct fimc_outinfo {
 	struct fimc_idx		inq[FIMC_INQUEUES];
 	struct fimc_ctx		ctx[FIMC_MAX_CTXS];
 	struct fimc_ctx_idx	idxs;
+
+	/* DMA addresses last written to the hardware */
+	dma_addr_t		src_addr[3];
+	dma_addr_t		dst_addr[3];
+	bool			src_valid;
+	bool			dst_valid;
 };
 
 struct s3cfb_user_window {
@@ -379,6 +395,9 @@ struct fimc_control {
 	struct mutex			alloc_lock;
 	struct mutex			v4l2_lock;
 	wait_queue_head_t		wq;
+	struct work_struct		power_work;	/* sensor power-up */
+	struct delayed_work		standby_work;	/* end of warm standby */
+	struct wake_lock		standby_wake_lock;
 	struct device			*dev;
 	int				irq;
 
@@ -514,6 +533,7 @@ extern int fimc_streamon_capture(void *fh);
 extern int fimc_streamoff_capture(void *fh);
 extern int fimc_qbuf_capture(void *fh, struct v4l2_buffer *b);
 extern int fimc_dqbuf_capture(void *fh, struct v4l2_buffer *b);
+extern void fimc_capture_preview(struct fimc_control *ctrl, int pp);
 extern int fimc_g_parm(struct file *file, void *fh,
 					struct v4l2_streamparm *a);
 extern int fimc_s_parm(struct file *file, void *fh,
@@ -527,10 +547,15 @@ extern int fimc_querymenu(struct file *file, void *fh,
 extern int fimc_change_clksrc(struct fimc_control *ctrl, int fimc_clk);
 #endif
 extern int fimc_release_subdev(struct fimc_control *ctrl);
+extern int fimc_camera_standby(struct fimc_control *ctrl);
+extern void fimc_camera_power_work(struct work_struct *work);
+extern void fimc_camera_standby_work(struct work_struct *work);
 
 /* output device */
 extern void fimc_outdev_set_src_addr(struct fimc_control *ctrl,
 					dma_addr_t *base);
+extern void fimc_outdev_set_dst_addr(struct fimc_control *ctrl,
+					struct fimc_buf_set *bs);
 extern int fimc_outdev_set_ctx_param(struct fimc_control *ctrl,
 					struct fimc_ctx *ctx);
 extern int fimc_start_fifo(struct fimc_control *ctrl,
@@ -43,6 +43,15 @@
 static int vtmode = 0;
 static int device_id = 0;
 
+/* How long a closed camera stays initialized, waiting to be opened again */
+#define FIMC_CAM_STANDBY_MS	5000
+
+/* Controller whose sensor is in warm standby, if any */
+static struct fimc_control *standby_ctrl;
+
+/* vtmode the initialized sensor was set up for */
+static int init_vtmode;
+
 static const struct v4l2_fmtdesc capture_fmts[] = {
 	{
 		.index		= 0,
@@ -210,7 +219,8 @@ static int fimc_camera_init(struct fimc_control *ctrl)
 	if (ctrl->cam->initialized)
 		return 0;
 
-	/* enable camera power if needed */
+	/* enable camera power if needed, s_input may have started it */
+	flush_work(&ctrl->power_work);
 	if (ctrl->cam->cam_power)
 		ctrl->cam->cam_power(1);
 
@@ -240,6 +250,7 @@ static int fimc_camera_init(struct fimc_control *ctrl)
 	}
 
 	ctrl->cam->initialized = 1;
+	init_vtmode = vtmode;
 
 	return 0;
 }
@@ -385,23 +396,33 @@ static int fimc_add_inqueue(struct fimc_control *ctrl, int i)
 	struct fimc_capinfo *cap = ctrl->cap;
 
 	struct fimc_buf_set *buf;
+	unsigned long flags;
 
 	if (i >= cap->nr_bufs)
 		return -EINVAL;
 
+	spin_lock_irqsave(&cap->lock, flags);
+	if (i == cap->preview_buf) {
+		spin_unlock_irqrestore(&cap->lock, flags);
+		fimc_dbg("%s: buffer %d is on screen.\n", __func__, i);
+		return -EBUSY;
+	}
+
 	list_for_each_entry(buf, &cap->inq, list) {
 		if (buf->id == i) {
+			spin_unlock_irqrestore(&cap->lock, flags);
 			fimc_dbg("%s: buffer %d already in inqueue.\n", \
 					__func__, i);
 			return -EINVAL;
 		}
 	}
 	list_add_tail(&cap->bufs[i].list, &cap->inq);
+	spin_unlock_irqrestore(&cap->lock, flags);
 
 	return 0;
 }
 
-static int fimc_add_outqueue(struct fimc_control *ctrl, int i)
+static int __fimc_add_outqueue(struct fimc_control *ctrl, int i)
 {
 	struct fimc_capinfo *cap = ctrl->cap;
 	struct fimc_buf_set *buf;
@@ -437,6 +458,118 @@ static int fimc_add_outqueue(struct fimc_control *ctrl, int i)
 	return 0;
 }
 
+static int fimc_add_outqueue(struct fimc_control *ctrl, int i)
+{
+	struct fimc_capinfo *cap = ctrl->cap;
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&cap->lock, flags);
+	ret = __fimc_add_outqueue(ctrl, i);
+	spin_unlock_irqrestore(&cap->lock, flags);
+
+	return ret;
+}
+
+/*
+ * Zero-copy preview, called from the interrupt handler once the frame in
+ * slot pp is complete: refill the slot from the incoming queue and flip
+ * the frame onto the preview window, the way fimc_irq_out_dma() does for
+ * the output overlay. The buffer it replaces on screen goes back to the
+ * incoming queue. Without a free buffer the slot is left to be written
+ * again and the frame is counted as dropped.
+ */
+void fimc_capture_preview(struct fimc_control *ctrl, int pp)
+{
+	struct fimc_capinfo *cap = ctrl->cap;
+	struct fb_info *fbinfo = registered_fb[cap->preview_fb];
+	struct s3cfb_window *win = (struct s3cfb_window *)fbinfo->par;
+	int done = cap->outq[pp];
+	int ret;
+
+	spin_lock(&cap->lock);
+	if (__fimc_add_outqueue(ctrl, pp) < 0) {
+		cap->preview_dropped++;
+		spin_unlock(&cap->lock);
+		return;
+	}
+
+	if (cap->preview_buf >= 0)
+		list_add_tail(&cap->bufs[cap->preview_buf].list, &cap->inq);
+	cap->preview_buf = done;
+	spin_unlock(&cap->lock);
+
+	win->other_mem_addr = cap->bufs[done].base[FIMC_ADDR_Y];
+
+	ret = fb_pan_display(fbinfo, &fbinfo->var);
+	if (ret < 0) {
+		cap->preview_dropped++;
+		fimc_err("%s: fb_pan_display fail (ret=%d)\n", __func__, ret);
+	}
+}
+
+/* Link the capture to fb window id, which must match the capture format */
+static int fimc_preview_link(struct fimc_control *ctrl, int id)
+{
+	struct fimc_capinfo *cap = ctrl->cap;
+	struct fb_info *fbinfo;
+	struct s3cfb_window *win;
+	u32 bpp;
+
+	if (ctrl->status == FIMC_STREAMON)
+		return -EBUSY;
+
+	if (id < 0) {
+		cap->preview_fb = -1;
+		return 0;
+	}
+
+	if (id >= num_registered_fb || !registered_fb[id])
+		return -EINVAL;
+
+	switch (cap->fmt.pixelformat) {
+	case V4L2_PIX_FMT_RGB565:
+		bpp = 16;
+		break;
+	case V4L2_PIX_FMT_RGB32:
+		bpp = 32;
+		break;
+	default:
+		fimc_err("%s: preview needs an RGB capture format\n", __func__);
+		return -EINVAL;
+	}
+
+	if (cap->fmt.field == V4L2_FIELD_INTERLACED_TB) {
+		fimc_err("%s: preview needs a progressive format\n", __func__);
+		return -EINVAL;
+	}
+
+	/* The ring needs a buffer on screen besides the two being written */
+	if (cap->nr_bufs < 3) {
+		fimc_err("%s: preview needs 3 or more buffers\n", __func__);
+		return -EINVAL;
+	}
+
+	fbinfo = registered_fb[id];
+	if (fbinfo->var.xres != cap->fmt.width ||
+	    fbinfo->var.yres != cap->fmt.height ||
+	    fbinfo->var.bits_per_pixel != bpp) {
+		fimc_err("%s: fb%d does not match the capture format\n",
+				__func__, id);
+		return -EINVAL;
+	}
+
+	win = (struct s3cfb_window *)fbinfo->par;
+	win->path = DATA_PATH_DMA;
+	win->owner = DMA_MEM_OTHER;
+	win->other_mem_size = cap->bufs[0].length[FIMC_ADDR_Y];
+
+	cap->preview_fb = id;
+	cap->preview_dropped = 0;
+
+	return 0;
+}
+
 static int fimc_update_hwaddr(struct fimc_control *ctrl)
 {
 	int i;
@@ -576,6 +709,7 @@ int fimc_release_subdev(struct fimc_control *ctrl)
 
 	if (ctrl && ctrl->cam && ctrl->cam->sd) {
 		fimc_dbg("%s called\n", __func__);
+		cancel_work_sync(&ctrl->power_work);
 		client = v4l2_get_subdevdata(ctrl->cam->sd);
 		i2c_unregister_device(client);
 		ctrl->cam->sd = NULL;
@@ -588,6 +722,80 @@ int fimc_release_subdev(struct fimc_control *ctrl)
 	return 0;
 }
 
+/* Powers the sensor while the application goes on setting up the capture */
+void fimc_camera_power_work(struct work_struct *work)
+{
+	struct fimc_control *ctrl =
+		container_of(work, struct fimc_control, power_work);
+
+	ctrl->cam->cam_power(1);
+}
+
+/*
+ * Called on close with ctrl->lock held. A sensor that was
+ * initialized stays powered and registered for FIMC_CAM_STANDBY_MS, so a
+ * camera opened again soon after skips the power-up and the upload of the
+ * init tables. Returns 0 when the sensor was kept.
+ */
+int fimc_camera_standby(struct fimc_control *ctrl)
+{
+	if (!ctrl->cam->initialized || ctrl->cam->type == CAM_TYPE_MIPI ||
+	    ctrl->status == FIMC_STREAMON)
+		return -EINVAL;
+
+	fimc_dbg("%s: sensor kept for %d ms\n", __func__, FIMC_CAM_STANDBY_MS);
+
+	standby_ctrl = ctrl;
+	wake_lock(&ctrl->standby_wake_lock);
+	schedule_delayed_work(&ctrl->standby_work,
+			      msecs_to_jiffies(FIMC_CAM_STANDBY_MS));
+
+	return 0;
+}
+
+void fimc_camera_standby_work(struct work_struct *work)
+{
+	struct fimc_control *ctrl =
+		container_of(work, struct fimc_control, standby_work.work);
+
+	mutex_lock(&ctrl->lock);
+	if (standby_ctrl == ctrl) {
+		standby_ctrl = NULL;
+		fimc_release_subdev(ctrl);
+		wake_unlock(&ctrl->standby_wake_lock);
+	}
+	mutex_unlock(&ctrl->lock);
+}
+
+/*
+ * Ends the warm standby. Returns 1 if the sensor kept is camera cam of
+ * ctrl, which is then used as it is, else releases it and returns 0.
+ */
+static int fimc_camera_wakeup(struct fimc_control *ctrl,
+			      struct s3c_platform_camera *cam)
+{
+	struct fimc_control *sctrl = standby_ctrl;
+	int kept = 0;
+
+	if (!sctrl)
+		return 0;
+
+	cancel_delayed_work_sync(&sctrl->standby_work);
+
+	mutex_lock(&sctrl->lock);
+	if (standby_ctrl == sctrl) {
+		standby_ctrl = NULL;
+		if (sctrl == ctrl && sctrl->cam == cam)
+			kept = 1;
+		else
+			fimc_release_subdev(sctrl);
+		wake_unlock(&sctrl->standby_wake_lock);
+	}
+	mutex_unlock(&sctrl->lock);
+
+	return kept;
+}
+
 static int fimc_configure_subdev(struct fimc_control *ctrl)
 {
 	struct i2c_adapter *i2c_adap;
@@ -660,6 +868,11 @@ int fimc_s_input(struct file *file, void *fh, unsigned int i)
 	if (!fimc->camera_isvalid[i])
 		return -EINVAL;
 
+	if (ctrl->id != 2 && fimc_camera_wakeup(ctrl, &fimc->camera[i])) {
+		fimc_dbg("%s: sensor still initialized\n", __func__);
+		return 0;
+	}
+
 	if (fimc->camera[i].sd && ctrl->id != 2) {
 		fimc_err("%s: Camera already in use.\n", __func__);
 		return -EBUSY;
@@ -680,6 +893,10 @@ int fimc_s_input(struct file *file, void *fh, unsigned int i)
 			return -ENODEV;
 		}
 		fimc->active_camera = i;
+
+		/* power up now, the init at streamon waits for it */
+		if (ctrl->cam->cam_power)
+			schedule_work(&ctrl->power_work);
 	}
 
 	if (ctrl->id == 2) {
@@ -860,6 +1077,9 @@ int fimc_s_fmt_vid_capture(struct file *file, void *fh, struct v4l2_format *f)
 	}
 	cap = ctrl->cap;
 	memset(cap, 0, sizeof(*cap));
+	spin_lock_init(&cap->lock);
+	cap->preview_fb = -1;
+	cap->preview_buf = -1;
 	memcpy(&cap->fmt, &f->fmt.pix, sizeof(cap->fmt));
 	v4l2_fill_mbus_format(&mbus_fmt, &f->fmt.pix, 0);
 
@@ -1006,6 +1226,7 @@ int fimc_reqbufs_capture(void *fh, struct v4l2_requestbuffers *b)
 	fimc_dbg("%s: requested %d buffers\n", __func__, b->count);
 
 	INIT_LIST_HEAD(&cap->inq);
+	cap->preview_buf = -1;
 	fimc_free_buffers(ctrl);
 
 	switch (cap->fmt.pixelformat) {
@@ -1148,6 +1369,14 @@ int fimc_g_ctrl_capture(void *fh, struct v4l2_control *c)
 		c->value = (ctrl->cap->flip & FIMC_YFLIP) ? 1 : 0;
 		break;
 
+	case V4L2_CID_PREVIEW_FB:
+		c->value = ctrl->cap->preview_fb;
+		break;
+
+	case V4L2_CID_PREVIEW_DROPPED:
+		c->value = ctrl->cap->preview_dropped;
+		break;
+
 	default:
 		/* get ctrl supported by subdev */
 		mutex_unlock(&ctrl->v4l2_lock);
@@ -1214,6 +1443,10 @@ int fimc_s_ctrl_capture(void *fh, struct v4l2_control *c)
 		fimc_hwset_stop_processing(ctrl);
 		break;
 
+	case V4L2_CID_PREVIEW_FB:
+		ret = fimc_preview_link(ctrl, c->value);
+		break;
+
 	case V4L2_CID_IMAGE_EFFECT_APPLY:
 		ctrl->fe.ie_on = c->value ? 1 : 0;
 		ctrl->fe.ie_after_sc = 0;
@@ -1540,6 +1773,13 @@ static void fimc_reset_capture(struct fimc_control *ctrl)
 	for (i = 0; i < FIMC_PINGPONG; i++)
 		fimc_add_inqueue(ctrl, ctrl->cap->outq[i]);
 
+	/* The last preview frame stays on screen until its buffer is reused */
+	if (ctrl->cap->preview_buf >= 0) {
+		i = ctrl->cap->preview_buf;
+		ctrl->cap->preview_buf = -1;
+		fimc_add_inqueue(ctrl, i);
+	}
+
 	fimc_hwset_reset(ctrl);
 
 	if (0 != ctrl->id)
@@ -1582,6 +1822,10 @@ int fimc_streamon_capture(void *fh)
 
 	fimc_hwset_enable_irq(ctrl, 0, 1);
 
+	/* a sensor kept from the last open may be set up for the other mode */
+	if (ctrl->cam->initialized && init_vtmode != vtmode)
+		ctrl->cam->initialized = 0;
+
 	if (!ctrl->cam->initialized)
 		fimc_camera_init(ctrl);
 
@@ -1764,6 +2008,12 @@ int fimc_dqbuf_capture(void *fh, struct v4l2_buffer *b)
 		return -EINVAL;
 	}
 
+	/* Frames go to the preview window, not to userspace */
+	if (cap->preview_fb >= 0) {
+		mutex_unlock(&ctrl->v4l2_lock);
+		return -EBUSY;
+	}
+
 	/* find out the real index */
 	pp = ((fimc_hwget_frame_count(ctrl) + 2) % 4);
 
@@ -35,9 +35,13 @@
 #include <linux/videodev2_samsung.h>
 #include <linux/delay.h>
 #include <plat/regs-fimc.h>
+#include <mach/cpu-freq-v210.h>
 
 #include "fimc.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/fimc.h>
+
 struct fimc_global *fimc_dev;
 
 int fimc_dma_alloc(struct fimc_control *ctrl, struct fimc_buf_set *bs,
@@ -122,6 +126,7 @@ void fimc_clk_en(struct fimc_control *ctrl, bool on)
 			/* Turn on fimc power domain regulator */
 			regulator_enable(ctrl->regulator);
 			clk_enable(lclk);
+			s5pv210_bus_hint(BUS_HINT_FIMC, true);
 		}
 	} else {
 		while (lclk->usage > 0) {
@@ -132,6 +137,7 @@ void fimc_clk_en(struct fimc_control *ctrl, bool on)
 			clk_disable(lclk);
 			/* Turn off fimc power domain regulator */
 			regulator_disable(ctrl->regulator);
+			s5pv210_bus_hint(BUS_HINT_FIMC, false);
 		}
 	}
 
@@ -248,7 +254,7 @@ static inline u32 fimc_irq_out_dma(struct fimc_control *ctrl,
 {
 	struct fimc_buf_set buf_set;
 	int idx = ctrl->out->idxs.active.idx;
-	int ret = -1, i, ctx_num, next;
+	int ret = -1, ctx_num, next;
 	u32 wakeup = 1;
 
 	if (ctx->status == FIMC_READY_OFF) {
@@ -290,8 +296,7 @@ static inline u32 fimc_irq_out_dma(struct fimc_control *ctrl,
 		memset(&buf_set, 0x00, sizeof(buf_set));
 		buf_set.base[FIMC_ADDR_Y] = ctx->dst[next].base[FIMC_ADDR_Y];
 
-		for (i = 0; i < FIMC_PHYBUFS; i++)
-			fimc_hwset_output_address(ctrl, &buf_set, i);
+		fimc_outdev_set_dst_addr(ctrl, &buf_set);
 
 		ret = fimc_outdev_start_camif(ctrl);
 		if (ret < 0)
@@ -376,6 +381,7 @@ static inline void fimc_irq_out(struct fimc_control *ctrl)
 	}
 
 	ctx = &ctrl->out->ctx[ctx_num];
+	trace_fimc_out_done(ctrl->id, ctx_num);
 
 	switch (ctx->overlay.mode) {
 	case FIMC_OVLY_NONE_SINGLE_BUF:
@@ -415,8 +421,12 @@ static inline void fimc_irq_cap(struct fimc_control *ctrl)
 		cfg = readl(ctrl->regs + S3C_CIGCTRL);
 		cfg &= ~S3C_CIGCTRL_SWRST;
 		writel(cfg, ctrl->regs + S3C_CIGCTRL);
+
+		if (cap->preview_fb >= 0)
+			cap->preview_dropped++;
 	}
 	pp = ((fimc_hwget_frame_count(ctrl) + 2) % 4);
+	trace_fimc_cap_done(ctrl->id, pp);
 	if (cap->fmt.field == V4L2_FIELD_INTERLACED_TB) {
 		/* odd value of pp means one frame is made with top/bottom */
 		if (pp & 0x1) {
@@ -424,6 +434,9 @@ static inline void fimc_irq_cap(struct fimc_control *ctrl)
 			wake_up(&ctrl->wq);
 		}
 	} else {
+		if (cap->preview_fb >= 0 && ctrl->status == FIMC_STREAMON)
+			fimc_capture_preview(ctrl, pp);
+
 		cap->irq = 1;
 		wake_up(&ctrl->wq);
 	}
@@ -488,6 +501,9 @@ struct fimc_control *fimc_register_controller(struct platform_device *pdev)
 	mutex_init(&ctrl->alloc_lock);
 	mutex_init(&ctrl->v4l2_lock);
 	init_waitqueue_head(&ctrl->wq);
+	INIT_WORK(&ctrl->power_work, fimc_camera_power_work);
+	INIT_DELAYED_WORK(&ctrl->standby_work, fimc_camera_standby_work);
+	wake_lock_init(&ctrl->standby_wake_lock, WAKE_LOCK_SUSPEND, ctrl->name);
 
 	/* get resource for io memory */
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
@@ -531,6 +547,9 @@ static int fimc_unregister_controller(struct platform_device *pdev)
 	ctrl = get_fimc_ctrl(id);
 
 	free_irq(ctrl->irq, ctrl);
+	flush_delayed_work(&ctrl->standby_work);
+	cancel_work_sync(&ctrl->power_work);
+	wake_lock_destroy(&ctrl->standby_wake_lock);
 	mutex_destroy(&ctrl->lock);
 	mutex_destroy(&ctrl->alloc_lock);
 	mutex_destroy(&ctrl->v4l2_lock);
@@ -919,6 +938,13 @@ static int fimc_open(struct file *filp)
 	}
 	in_use = atomic_read(&ctrl->in_use);
 
+	/* The reserved memory is lent out while nobody has us open */
+	if (in_use == 1) {
+		ret = s5p_media_claim(S5P_MDEV_FIMC0 + ctrl->id, 1);
+		if (ret < 0)
+			goto claim_err;
+	}
+
 	prv_data = kzalloc(sizeof(struct fimc_prv_data), GFP_KERNEL);
 	if (!prv_data) {
 		fimc_err("%s: not enough memory\n", __func__);
@@ -970,6 +996,10 @@ ctx_err:
 	kfree(prv_data);
 
 kzalloc_err:
+	if (in_use == 1)
+		s5p_media_release(S5P_MDEV_FIMC0 + ctrl->id, 1);
+
+claim_err:
 	atomic_dec(&ctrl->in_use);
 
 resource_busy:
@@ -997,10 +1027,12 @@ static int fimc_release(struct file *filp)
 
 	/* FIXME: turning off actual working camera */
 	if (ctrl->cam && ctrl->id != 2) {
-		/* Unload the subdev (camera sensor) module,
-		 * reset related status flags
+		/* Keep the sensor initialized for a while in case the
+		 * camera is opened again, else unload the subdev module
+		 * and reset related status flags
 		 */
-		fimc_release_subdev(ctrl);
+		if (fimc_camera_standby(ctrl) < 0)
+			fimc_release_subdev(ctrl);
 	}
 
 	if (ctrl->cap) {
@@ -1114,6 +1146,9 @@ static int fimc_release(struct file *filp)
 		ctrl->fb.is_enable = 0;
 	}
 
+	if (atomic_read(&ctrl->in_use) == 0)
+		s5p_media_release(S5P_MDEV_FIMC0 + ctrl->id, 1);
+
 	mutex_unlock(&ctrl->lock);
 
 	fimc_info1("%s released.\n", ctrl->name);
@@ -1121,6 +1156,9 @@ static int fimc_release(struct file *filp)
 	return 0;
 
 release_err:
+	if (atomic_read(&ctrl->in_use) == 0)
+		s5p_media_release(S5P_MDEV_FIMC0 + ctrl->id, 1);
+
 	mutex_unlock(&ctrl->lock);
 	return ret;
 
@@ -26,6 +26,8 @@
 
 #include "fimc.h"
 
+#include <trace/events/fimc.h>
+
 static __u32 fimc_get_pixel_format_type(__u32 pixelformat)
 {
 	switch (pixelformat) {
@@ -53,17 +55,56 @@ static __u32 fimc_get_pixel_format_type(__u32 pixelformat)
 	}
 }
 
+/*
+ * The context registers only change with the context, so per frame only
+ * the buffer addresses are written, and only those that changed since
+ * the last frame. A reset or a new context drops the shadow copies.
+ */
+static void fimc_outdev_invalidate_addr(struct fimc_control *ctrl)
+{
+	ctrl->out->src_valid = false;
+	ctrl->out->dst_valid = false;
+}
+
 void fimc_outdev_set_src_addr(struct fimc_control *ctrl, dma_addr_t *base)
 {
+	struct fimc_outinfo *out = ctrl->out;
+
+	if (out->src_valid &&
+	    !memcmp(out->src_addr, base, sizeof(out->src_addr)))
+		return;
+
 	fimc_hwset_addr_change_disable(ctrl);
 	fimc_hwset_input_address(ctrl, base);
 	fimc_hwset_addr_change_enable(ctrl);
+
+	memcpy(out->src_addr, base, sizeof(out->src_addr));
+	out->src_valid = true;
+}
+
+/* Program bs into every output address slot */
+void fimc_outdev_set_dst_addr(struct fimc_control *ctrl,
+			      struct fimc_buf_set *bs)
+{
+	struct fimc_outinfo *out = ctrl->out;
+	int i;
+
+	if (out->dst_valid &&
+	    !memcmp(out->dst_addr, bs->base, sizeof(out->dst_addr)))
+		return;
+
+	for (i = 0; i < FIMC_PHYBUFS; i++)
+		fimc_hwset_output_address(ctrl, bs, i);
+
+	memcpy(out->dst_addr, bs->base, sizeof(out->dst_addr));
+	out->dst_valid = true;
 }
 
 int fimc_outdev_start_camif(void *param)
 {
 	struct fimc_control *ctrl = (struct fimc_control *)param;
 
+	trace_fimc_out_start(ctrl->id, ctrl->out->idxs.active.ctx);
 	fimc_hwset_start_scaler(ctrl);
 	fimc_hwset_enable_capture(ctrl, 0);	/* bypass disable */
 	fimc_hwset_start_input_dma(ctrl);
@@ -80,6 +121,7 @@ static int fimc_outdev_stop_camif(void *param)
 	fimc_hwset_stop_scaler(ctrl);
 	fimc_hwset_disable_capture(ctrl);
 	fimc_hwset_sw_reset(ctrl);
+	fimc_outdev_invalidate_addr(ctrl);
 
 	fimc_clk_en(ctrl, false);
 	return 0;
@@ -1079,6 +1121,8 @@ int fimc_outdev_set_ctx_param(struct fimc_control *ctrl, struct fimc_ctx *ctx)
 {
 	int ret;
 
+	fimc_outdev_invalidate_addr(ctrl);
+
 	if (ctrl->status == FIMC_READY_ON || ctrl->status == FIMC_STREAMON_IDLE)
 		fimc_hwset_enable_irq(ctrl, 0, 1);
 
@@ -1770,7 +1814,6 @@ int fimc_output_set_dst_addr(struct fimc_control *ctrl,
 	u32 height = ctx->fbuf.fmt.height;
 	u32 y_size = width * height;
 	u32 c_size = y_size >> 2;
-	int i;
 
 	memset(&buf_set, 0x00, sizeof(buf_set));
 
@@ -1831,8 +1874,7 @@ int fimc_output_set_dst_addr(struct fimc_control *ctrl,
 		return -EINVAL;
 	}
 
-	for (i = 0; i < FIMC_PHYBUFS; i++)
-		fimc_hwset_output_address(ctrl, &buf_set, i);
+	fimc_outdev_set_dst_addr(ctrl, &buf_set);
 
 	return 0;
 }
@@ -1875,7 +1917,7 @@ static int fimc_qbuf_output_multi_buf(struct fimc_control *ctrl,
 
 	fimc_outdev_set_src_addr(ctrl, ctx->src[idx].base);
 
-	fimc_output_set_dst_addr(ctrl, ctx, idx);
+	ret = fimc_output_set_dst_addr(ctrl, ctx, idx);
 	if (ret < 0) {
 		fimc_err("%s: Fail: fimc_output_set_dst_addr\n", __func__);
 		return -EINVAL;
@@ -1905,7 +1947,7 @@ static int fimc_qbuf_output_dma_auto(struct fimc_control *ctrl,
 	struct s3cfb_window *win;
 	struct v4l2_rect fimd_rect;
 	struct fimc_buf_set buf_set;	/* destination addr */
-	int ret = -1, i;
+	int ret = -1;
 
 	switch (ctx->status) {
 	case FIMC_READY_ON:
@@ -1951,8 +1993,7 @@ static int fimc_qbuf_output_dma_auto(struct fimc_control *ctrl,
 		memset(&buf_set, 0x00, sizeof(buf_set));
 		buf_set.base[FIMC_ADDR_Y] = ctx->dst[idx].base[FIMC_ADDR_Y];
 
-		for (i = 0; i < FIMC_PHYBUFS; i++)
-			fimc_hwset_output_address(ctrl, &buf_set, i);
+		fimc_outdev_set_dst_addr(ctrl, &buf_set);
 
 		ret = fimc_outdev_start_camif(ctrl);
 		if (ret < 0) {
@@ -1980,15 +2021,14 @@ static int fimc_qbuf_output_dma_manual(struct fimc_control *ctrl,
 				      int idx)
 {
 	struct fimc_buf_set buf_set;	/* destination addr */
-	int ret = -1, i;
+	int ret = -1;
 
 	fimc_outdev_set_src_addr(ctrl, ctx->src[idx].base);
 
 	memset(&buf_set, 0x00, sizeof(buf_set));
 	buf_set.base[FIMC_ADDR_Y] = ctx->dst[idx].base[FIMC_ADDR_Y];
 
-	for (i = 0; i < FIMC_PHYBUFS; i++)
-		fimc_hwset_output_address(ctrl, &buf_set, i);
+	fimc_outdev_set_dst_addr(ctrl, &buf_set);
 
 	ret = fimc_outdev_start_camif(ctrl);
 	if (ret < 0) {
@@ -2369,13 +2409,15 @@ int fimc_push_inq(struct fimc_control *ctrl, struct fimc_ctx *ctx, int idx)
 
 	fimc_dbg("%s: idx = %d\n", __func__, idx);
 
+	spin_lock_irqsave(&ctrl->out->lock_in, spin_flags);
+
+	/* The interrupt handler pops this queue behind our back */
 	if (ctrl->out->inq[FIMC_INQUEUES-1].idx != -1) {
+		spin_unlock_irqrestore(&ctrl->out->lock_in, spin_flags);
 		fimc_err("FULL: common incoming queue\n");
 		return -EBUSY;
 	}
 
-	spin_lock_irqsave(&ctrl->out->lock_in, spin_flags);
-
 	/* ctx own incoming queue */
 	/* Backup original queue */
 	for (i = 0; i < FIMC_OUTBUFS; i++)
@@ -12,6 +12,7 @@
 
 #include <linux/delay.h>
 #include <linux/io.h>
+#include <linux/sched.h>
 
 #include "jpg_mem.h"
 #include "jpg_misc.h"
@@ -20,6 +21,8 @@
 
 #include "regs-jpeg.h"
 
+#include <trace/events/s3c_jpeg.h>
+
 enum {
 	UNKNOWN,
 	BASELINE = 0xC0,
@@ -27,11 +30,24 @@ enum {
 	PROGRESSIVE = 0xC2
 } jpg_sof_marker;
 
+/* Arm the completion flag before starting the codec */
+static void start_jpg(unsigned int reg)
+{
+	jpg_irq_done = 0;
+	smp_wmb();
+
+	trace_s3c_jpeg_start(reg == S3C_JPEG_JRSTART_REG);
+
+	writel(readl(s3c_jpeg_base + reg) | S3C_JPEG_JSTART_REG_ENABLE,
+			s3c_jpeg_base + S3C_JPEG_JSTART_REG);
+}
+
 enum jpg_return_status wait_for_interrupt(void)
 {
-	if (interruptible_sleep_on_timeout(&wait_queue_jpeg,	\
-					 INT_TIMEOUT) == 0) {
+	if (wait_event_timeout(wait_queue_jpeg, jpg_irq_done,
+			       INT_TIMEOUT) == 0) {
 		jpg_err("waiting for interrupt is timeout\n");
+		return ERR_UNKNOWN;
 	}
 
 	return jpg_irq_reason;
@@ -81,9 +97,7 @@ enum jpg_return_status decode_jpg(struct s5pc110_jpg_ctx *jpg_ctx,
 	writel(jpg_ctx->jpg_data_addr, s3c_jpeg_base + S3C_JPEG_JPGADR_REG);
 
 	/* start decoding */
-	writel(readl(s3c_jpeg_base + S3C_JPEG_JRSTART_REG) |
-			S3C_JPEG_JRSTART_REG_ENABLE,
-			s3c_jpeg_base + S3C_JPEG_JSTART_REG);
+	start_jpg(S3C_JPEG_JRSTART_REG);
 
 	ret = wait_for_interrupt();
 
@@ -301,9 +315,7 @@ enum jpg_return_status encode_jpg(struct s5pc110_jpg_ctx *jpg_ctx,
 			S3C_JPEG_INTSE_REG_FINAL_MCU_NUM_INT_EN),
 			s3c_jpeg_base + S3C_JPEG_INTSE_REG);
 
-	writel(readl(s3c_jpeg_base + S3C_JPEG_JSTART_REG) |
-			S3C_JPEG_JSTART_REG_ENABLE,
-			s3c_jpeg_base + S3C_JPEG_JSTART_REG);
+	start_jpg(S3C_JPEG_JSTART_REG);
 	ret = wait_for_interrupt();
 
 	if (ret != OK_ENC_OR_DEC) {
@@ -17,6 +17,7 @@
 
 extern void __iomem		*s3c_jpeg_base;
 extern int			jpg_irq_reason;
+extern int			jpg_irq_done;
 
 /* debug macro */
 #define JPG_DEBUG(fmt, ...)					\
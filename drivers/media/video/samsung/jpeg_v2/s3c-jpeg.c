@@ -38,6 +38,7 @@
 #include <linux/mm.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
+#include <linux/workqueue.h>
 
 #include <linux/version.h>
 #include <plat/media.h>
@@ -55,6 +56,9 @@
 #include "jpg_opr.h"
 #include "regs-jpeg.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/s3c_jpeg.h>
+
 static struct jpegv2_limits	s3c_jpeg_limits;
 static struct jpegv2_buf	s3c_jpeg_bufinfo;
 
@@ -66,8 +70,35 @@ void __iomem		*s3c_jpeg_base;
 static int		irq_no;
 static int		instanceNo;;
 int			jpg_irq_reason;
+int			jpg_irq_done;
 wait_queue_head_t	wait_queue_jpeg;
 
+enum jpg_job_state {
+	JPG_JOB_IDLE,
+	JPG_JOB_BUSY,
+	JPG_JOB_DONE,
+};
+
+/*
+ * IOCTL_JPG_ENCODE_ASYNC: the main image and its thumbnail, encoded back
+ * to back by one submission while the caller goes on. The frame and
+ * stream buffers are the single reserved region, so there is one job
+ * for the device; owner is the file that submitted it.
+ */
+struct s3c_jpeg_job {
+	struct work_struct		work;
+	wait_queue_head_t		wait;
+	struct s5pc110_jpg_ctx		*owner;
+	enum jpg_job_state		state;
+	bool				thumb;
+	struct jpg_args			args;
+	struct jpg_enc_proc_param	enc_param;
+	struct jpg_enc_proc_param	thumb_enc_param;
+	enum jpg_return_status		result;
+};
+
+static struct s3c_jpeg_job	s3c_jpeg_job;
+
 
 DECLARE_WAIT_QUEUE_HEAD(WaitQueue_JPEG);
 
@@ -103,6 +134,7 @@ irqreturn_t s3c_jpeg_irq(int irq, void *dev_id, struct pt_regs *regs)
 	} while (status);
 
 	writel(S3C_JPEG_COM_INT_RELEASE, s3c_jpeg_base + S3C_JPEG_COM_REG);
+	trace_s3c_jpeg_done(int_status);
 	jpg_dbg("int_status : 0x%08x status : 0x%08x\n", int_status, status);
 
 	if (int_status) {
@@ -116,19 +148,210 @@ irqreturn_t s3c_jpeg_irq(int irq, void *dev_id, struct pt_regs *regs)
 		default:
 			jpg_irq_reason = ERR_UNKNOWN;
 		}
-
-		wake_up_interruptible(&wait_queue_jpeg);
 	} else {
 		jpg_irq_reason = ERR_UNKNOWN;
-		wake_up_interruptible(&wait_queue_jpeg);
 	}
 
+	smp_wmb();
+	jpg_irq_done = 1;
+	wake_up(&wait_queue_jpeg);
+
 	return IRQ_HANDLED;
 }
+
+static void s3c_jpeg_set_main_addr(struct s5pc110_jpg_ctx *jpg_reg_ctx)
+{
+	jpg_reg_ctx->jpg_data_addr = (unsigned int)jpg_data_base_addr;
+	jpg_reg_ctx->img_data_addr = (unsigned int)jpg_data_base_addr
+		+ jpg_reg_ctx->bufinfo->main_frame_start;
+}
+
+static void s3c_jpeg_set_thumb_addr(struct s5pc110_jpg_ctx *jpg_reg_ctx)
+{
+	jpg_reg_ctx->jpg_thumb_data_addr = (unsigned int)jpg_data_base_addr
+		+ jpg_reg_ctx->bufinfo->thumb_stream_start;
+	jpg_reg_ctx->img_thumb_data_addr = (unsigned int)jpg_data_base_addr
+		+ jpg_reg_ctx->bufinfo->thumb_frame_start;
+}
+
+/*
+ * Buffers supplied by physical address in jpg_args are encoded from and
+ * into in place when they lie in FIMC or JPEG reserved memory and are
+ * large enough; anything else uses the reserved frame/stream buffers.
+ */
+static bool s3c_jpeg_importable(char *paddr, int size, unsigned int need)
+{
+	static const int devs[] = {
+		S5P_MDEV_FIMC0, S5P_MDEV_FIMC1, S5P_MDEV_FIMC2, S5P_MDEV_JPEG,
+	};
+	int i;
+
+	if (!paddr || size <= 0 || size < need)
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(devs); i++) {
+		if (s5p_media_memory_contains(devs[i], (dma_addr_t)paddr, size))
+			return true;
+	}
+
+	return false;
+}
+
+/* Input is 2 bytes per pixel in both YCbCr 4:2:2 and RGB565 */
+#define JPG_ENC_FRAME_SIZE(p)	((p)->width * (p)->height * 2)
+#define JPG_ENC_STREAM_SIZE(p)	((p)->width * (p)->height)
+
+static void s3c_jpeg_import_main(struct s5pc110_jpg_ctx *jpg_reg_ctx,
+				 struct jpg_args *param,
+				 struct jpg_enc_proc_param *enc_param)
+{
+	s3c_jpeg_set_main_addr(jpg_reg_ctx);
+
+	if (s3c_jpeg_importable(param->phy_in_buf, param->in_buf_size,
+				JPG_ENC_FRAME_SIZE(enc_param)))
+		jpg_reg_ctx->img_data_addr = (unsigned int)param->phy_in_buf;
+
+	if (s3c_jpeg_importable(param->phy_out_buf, param->out_buf_size,
+				JPG_ENC_STREAM_SIZE(enc_param)))
+		jpg_reg_ctx->jpg_data_addr = (unsigned int)param->phy_out_buf;
+}
+
+static void s3c_jpeg_import_thumb(struct s5pc110_jpg_ctx *jpg_reg_ctx,
+				  struct jpg_args *param,
+				  struct jpg_enc_proc_param *enc_param)
+{
+	s3c_jpeg_set_thumb_addr(jpg_reg_ctx);
+
+	if (s3c_jpeg_importable(param->phy_in_thumb_buf,
+				param->in_thumb_buf_size,
+				JPG_ENC_FRAME_SIZE(enc_param)))
+		jpg_reg_ctx->img_thumb_data_addr =
+			(unsigned int)param->phy_in_thumb_buf;
+
+	if (s3c_jpeg_importable(param->phy_out_thumb_buf,
+				param->out_thumb_buf_size,
+				JPG_ENC_STREAM_SIZE(enc_param)))
+		jpg_reg_ctx->jpg_thumb_data_addr =
+			(unsigned int)param->phy_out_thumb_buf;
+}
+
+static void s3c_jpeg_job_work(struct work_struct *work)
+{
+	struct s3c_jpeg_job *job =
+		container_of(work, struct s3c_jpeg_job, work);
+	struct s5pc110_jpg_ctx *jpg_reg_ctx = job->owner;
+	enum jpg_return_status result;
+
+	lock_jpg_mutex();
+
+	jpeg_clock_enable();
+	s3c_jpeg_import_main(jpg_reg_ctx, &job->args, &job->enc_param);
+	result = encode_jpg(jpg_reg_ctx, &job->enc_param);
+
+	if (result == JPG_SUCCESS && job->thumb) {
+		s3c_jpeg_import_thumb(jpg_reg_ctx, &job->args,
+				      &job->thumb_enc_param);
+		result = encode_jpg(jpg_reg_ctx, &job->thumb_enc_param);
+	}
+	jpeg_clock_disable();
+
+	job->result = result;
+	job->state = JPG_JOB_DONE;
+
+	unlock_jpg_mutex();
+
+	wake_up_interruptible(&job->wait);
+}
+
+/* Called with the jpg mutex held */
+static long s3c_jpeg_submit(struct s5pc110_jpg_ctx *jpg_reg_ctx,
+			    unsigned long arg)
+{
+	struct s3c_jpeg_job *job = &s3c_jpeg_job;
+	struct jpg_args *param = &job->args;
+
+	if (job->state != JPG_JOB_IDLE)
+		return -EBUSY;
+
+	if (copy_from_user(param, (struct jpg_args *)arg,
+			   sizeof(struct jpg_args)))
+		return -EFAULT;
+
+	if (!param->enc_param ||
+	    copy_from_user(&job->enc_param, param->enc_param,
+			   sizeof(struct jpg_enc_proc_param)))
+		return -EFAULT;
+
+	job->thumb = param->thumb_enc_param != NULL;
+	if (job->thumb && copy_from_user(&job->thumb_enc_param,
+			param->thumb_enc_param,
+			sizeof(struct jpg_enc_proc_param)))
+		return -EFAULT;
+
+	job->enc_param.enc_type = JPG_MAIN;
+	job->thumb_enc_param.enc_type = JPG_THUMBNAIL;
+
+	job->owner = jpg_reg_ctx;
+	job->state = JPG_JOB_BUSY;
+	queue_work(system_nrt_freezable_wq, &job->work);
+
+	return 0;
+}
+
+/*
+ * Hand back the sizes of the finished job, waiting for it unless the
+ * file is non-blocking. Called with the jpg mutex held, which the job
+ * needs, so it is dropped while waiting.
+ */
+static long s3c_jpeg_get_result(struct file *file,
+				struct s5pc110_jpg_ctx *jpg_reg_ctx,
+				unsigned long arg)
+{
+	struct s3c_jpeg_job *job = &s3c_jpeg_job;
+	struct jpg_args param;
+	long ret;
+
+	if (job->owner != jpg_reg_ctx)
+		return -EINVAL;
+
+	if (job->state == JPG_JOB_BUSY) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		unlock_jpg_mutex();
+		ret = wait_event_interruptible(job->wait,
+					       job->state != JPG_JOB_BUSY);
+		lock_jpg_mutex();
+		if (ret)
+			return ret;
+	}
+
+	if (copy_from_user(&param, (struct jpg_args *)arg,
+			   sizeof(struct jpg_args)))
+		return -EFAULT;
+
+	if (param.enc_param && copy_to_user(param.enc_param, &job->enc_param,
+			sizeof(struct jpg_enc_proc_param)))
+		return -EFAULT;
+
+	if (job->thumb && param.thumb_enc_param &&
+	    copy_to_user(param.thumb_enc_param, &job->thumb_enc_param,
+			 sizeof(struct jpg_enc_proc_param)))
+		return -EFAULT;
+
+	ret = (job->result == JPG_SUCCESS) ? 0 : -EIO;
+
+	job->owner = NULL;
+	job->state = JPG_JOB_IDLE;
+
+	return ret;
+}
+
 static int s3c_jpeg_open(struct inode *inode, struct file *file)
 {
 	struct s5pc110_jpg_ctx *jpg_reg_ctx;
 	unsigned long	ret;
+	int		err;
 
 	jpg_dbg("JPG_open \r\n");
 
@@ -153,6 +376,16 @@ static int s3c_jpeg_open(struct inode *inode, struct file *file)
 		return FALSE;
 	}
 
+	/* The reserved memory is lent out while nobody has us open */
+	if (!instanceNo) {
+		err = s5p_media_claim(S5P_MDEV_JPEG, 0);
+		if (err) {
+			unlock_jpg_mutex();
+			kfree(jpg_reg_ctx);
+			return err;
+		}
+	}
+
 	instanceNo++;
 
 	/* Initialize the limits of the driver */
@@ -181,6 +414,10 @@ static int s3c_jpeg_release(struct inode *inode, struct file *file)
 		return FALSE;
 	}
 
+	/* A job still running encodes into buffers nobody will read */
+	if (s3c_jpeg_job.owner == jpg_reg_ctx)
+		flush_work_sync(&s3c_jpeg_job.work);
+
 	ret = lock_jpg_mutex();
 
 	if (!ret) {
@@ -188,9 +425,17 @@ static int s3c_jpeg_release(struct inode *inode, struct file *file)
 		return FALSE;
 	}
 
+	if (s3c_jpeg_job.owner == jpg_reg_ctx) {
+		s3c_jpeg_job.owner = NULL;
+		s3c_jpeg_job.state = JPG_JOB_IDLE;
+	}
+
 	if ((--instanceNo) < 0)
 		instanceNo = 0;
 
+	if (!instanceNo)
+		s5p_media_release(S5P_MDEV_JPEG, 0);
+
 	unlock_jpg_mutex();
 	kfree(jpg_reg_ctx);
 
@@ -234,6 +479,14 @@ static long s3c_jpeg_ioctl(struct file *file,
 		return FALSE;
 	}
 
+	/* The queued job owns the frame and stream buffers */
+	if ((cmd == IOCTL_JPG_DECODE || cmd == IOCTL_JPG_ENCODE) &&
+	    s3c_jpeg_job.state == JPG_JOB_BUSY) {
+		jpg_err("JPG busy with a queued job\n");
+		unlock_jpg_mutex();
+		return FALSE;
+	}
+
 	switch (cmd) {
 	case IOCTL_JPG_DECODE:
 
@@ -267,11 +520,8 @@ static long s3c_jpeg_ioctl(struct file *file,
 
 		jpeg_clock_enable();
 		if (param.enc_param->enc_type == JPG_MAIN) {
-			jpg_reg_ctx->jpg_data_addr =
-					(unsigned int)jpg_data_base_addr;
-			jpg_reg_ctx->img_data_addr =
-				(unsigned int)jpg_data_base_addr
-				+ jpg_reg_ctx->bufinfo->main_frame_start;
+			s3c_jpeg_import_main(jpg_reg_ctx, &param,
+					     param.enc_param);
 			jpg_dbg("enc_img_data_addr=0x%08x,"
 				"enc_jpg_data_addr=0x%08x\n",
 				jpg_reg_ctx->img_data_addr,
@@ -279,12 +529,8 @@ static long s3c_jpeg_ioctl(struct file *file,
 
 			result = encode_jpg(jpg_reg_ctx, param.enc_param);
 		} else {
-			jpg_reg_ctx->jpg_thumb_data_addr =
-				(unsigned int)jpg_data_base_addr
-				+ jpg_reg_ctx->bufinfo->thumb_stream_start;
-			jpg_reg_ctx->img_thumb_data_addr =
-				(unsigned int)jpg_data_base_addr
-				+ jpg_reg_ctx->bufinfo->thumb_frame_start;
+			s3c_jpeg_import_thumb(jpg_reg_ctx, &param,
+					      param.thumb_enc_param);
 
 			result = encode_jpg(jpg_reg_ctx, param.thumb_enc_param);
 		}
@@ -294,6 +540,18 @@ static long s3c_jpeg_ioctl(struct file *file,
 				   sizeof(struct jpg_args));
 		break;
 
+	case IOCTL_JPG_ENCODE_ASYNC:
+		jpg_dbg("IOCTL_JPG_ENCODE_ASYNC\n");
+		ret = s3c_jpeg_submit(jpg_reg_ctx, arg);
+		unlock_jpg_mutex();
+		return ret;
+
+	case IOCTL_JPG_GET_RESULT:
+		jpg_dbg("IOCTL_JPG_GET_RESULT\n");
+		ret = s3c_jpeg_get_result(file, jpg_reg_ctx, arg);
+		unlock_jpg_mutex();
+		return ret;
+
 	case IOCTL_JPG_GET_STRBUF:
 		jpg_dbg("IOCTL_JPG_GET_STRBUF\n");
 		unlock_jpg_mutex();
@@ -355,8 +613,15 @@ static unsigned int s3c_jpeg_poll(struct file *file, poll_table *wait)
 	unsigned int mask = 0;
 
 	jpg_dbg("enter poll\n");
-	poll_wait(file, &wait_queue_jpeg, wait);
-	mask = POLLOUT | POLLWRNORM;
+	poll_wait(file, &s3c_jpeg_job.wait, wait);
+
+	if (s3c_jpeg_job.owner == file->private_data &&
+	    s3c_jpeg_job.state == JPG_JOB_DONE)
+		mask |= POLLIN | POLLRDNORM;
+
+	if (s3c_jpeg_job.state == JPG_JOB_IDLE)
+		mask |= POLLOUT | POLLWRNORM;
+
 	return mask;
 }
 
@@ -544,6 +809,8 @@ static int s3c_jpeg_probe(struct platform_device *pdev)
 	}
 
 	init_waitqueue_head(&wait_queue_jpeg);
+	init_waitqueue_head(&s3c_jpeg_job.wait);
+	INIT_WORK(&s3c_jpeg_job.work, s3c_jpeg_job_work);
 
 	jpg_dbg("JPG_Init\n");
 
@@ -623,7 +890,7 @@ static void __exit s3c_jpeg_exit(void)
 	jpg_dbg("S3C JPEG driver module exit\n");
 }
 
-module_init(s3c_jpeg_init);
+deferred_initcall(s3c_jpeg_init);
 module_exit(s3c_jpeg_exit);
 
 MODULE_AUTHOR("Peter, Oh");
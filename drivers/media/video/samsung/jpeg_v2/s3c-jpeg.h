@@ -29,6 +29,8 @@
 #define IOCTL_JPG_GET_PHY_FRMBUF		_IO(JPEG_IOCTL_MAGIC, 7)
 #define IOCTL_JPG_GET_PHY_THUMB_FRMBUF		_IO(JPEG_IOCTL_MAGIC, 8)
 #define IOCTL_JPG_GET_INFO			_IO(JPEG_IOCTL_MAGIC, 9)
+#define IOCTL_JPG_ENCODE_ASYNC			_IO(JPEG_IOCTL_MAGIC, 10)
+#define IOCTL_JPG_GET_RESULT			_IO(JPEG_IOCTL_MAGIC, 11)
 #define JPG_CLOCK_DIVIDER_RATIO_QUARTER	4
 
 /* Driver Helper function */
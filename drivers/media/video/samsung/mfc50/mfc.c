@@ -42,6 +42,8 @@
 
 #include <linux/sched.h>
 #include <linux/firmware.h>
+#include <linux/poll.h>
+#include <linux/workqueue.h>
 
 #include <linux/io.h>
 #include <linux/uaccess.h>
@@ -49,9 +51,7 @@
 #include <plat/media.h>
 #include <mach/media.h>
 #include <plat/mfc.h>
-#ifdef CONFIG_DVFS_LIMIT
 #include <mach/cpu-freq-v210.h>
-#endif
 
 #include "mfc_interface.h"
 #include "mfc_logmsg.h"
@@ -59,6 +59,7 @@
 #include "mfc_memory.h"
 #include "mfc_buffer_manager.h"
 #include "mfc_intr.h"
+#include "mfc_sched.h"
 
 #define MFC_FW_NAME	"samsung_mfc_fw.bin"
 
@@ -68,6 +69,101 @@ static struct clk *mfc_sclk;
 static struct regulator *mfc_pd_regulator;
 const struct firmware	*mfc_fw_info;
 
+/* Runs an IOCTL_MFC_*_EXE_ASYNC frame, without mfc_mutex like ENC/DEC_EXE */
+static void mfc_async_work(struct work_struct *work)
+{
+	struct mfc_inst_ctx *mfc_ctx;
+	struct mfc_common_args *args;
+
+	mfc_ctx = container_of(work, struct mfc_inst_ctx, async_work);
+	args = &mfc_ctx->async_args;
+
+	clk_enable(mfc_sclk);
+	if (mfc_ctx->async_cmd == IOCTL_MFC_ENC_EXE)
+		args->ret_code = mfc_exe_encode(mfc_ctx, &(args->args));
+	else
+		args->ret_code = mfc_exe_decode(mfc_ctx, &(args->args));
+	clk_disable(mfc_sclk);
+
+	spin_lock(&mfc_ctx->async_lock);
+	mfc_ctx->async_state = MFC_ASYNC_DONE;
+	spin_unlock(&mfc_ctx->async_lock);
+
+	wake_up_interruptible(&mfc_ctx->async_wait);
+}
+
+static bool mfc_async_done(struct mfc_inst_ctx *mfc_ctx)
+{
+	bool done;
+
+	spin_lock(&mfc_ctx->async_lock);
+	done = mfc_ctx->async_state != MFC_ASYNC_BUSY;
+	spin_unlock(&mfc_ctx->async_lock);
+
+	return done;
+}
+
+/*
+ * State checks for a frame command (IOCTL_MFC_ENC_EXE or
+ * IOCTL_MFC_DEC_EXE), called with mfc_mutex held. An instance runs one
+ * frame at a time, so none may start while an async one is in flight.
+ */
+static int mfc_exe_check(struct mfc_inst_ctx *mfc_ctx, unsigned int exe_cmd)
+{
+	enum mfc_inst_state init_state, exe_state;
+	bool busy;
+
+	if (exe_cmd == IOCTL_MFC_ENC_EXE) {
+		init_state = MFCINST_STATE_ENC_INITIALIZE;
+		exe_state = MFCINST_STATE_ENC_EXE;
+	} else {
+		init_state = MFCINST_STATE_DEC_INITIALIZE;
+		exe_state = MFCINST_STATE_DEC_EXE;
+	}
+
+	if (mfc_ctx->MfcState < init_state) {
+		mfc_err("MFCINST_ERR_STATE_INVALID\n");
+		return MFCINST_ERR_STATE_INVALID;
+	}
+
+	spin_lock(&mfc_ctx->async_lock);
+	busy = mfc_ctx->async_state == MFC_ASYNC_BUSY;
+	spin_unlock(&mfc_ctx->async_lock);
+	if (busy) {
+		mfc_err("MFCINST_ERR_STATE_INVALID : async frame in flight\n");
+		return MFCINST_ERR_STATE_INVALID;
+	}
+
+	if (mfc_set_state(mfc_ctx, exe_state) < 0) {
+		mfc_err("MFCINST_ERR_STATE_INVALID\n");
+		return MFCINST_ERR_STATE_INVALID;
+	}
+
+	return MFCINST_RET_OK;
+}
+
+/* The memory of both ports is lent to movable pages while no instance runs */
+static int mfc_claim_memory(void)
+{
+	int ret;
+
+	ret = s5p_media_claim(S5P_MDEV_MFC, 0);
+	if (ret < 0)
+		return ret;
+
+	ret = s5p_media_claim(S5P_MDEV_MFC, 1);
+	if (ret < 0)
+		s5p_media_release(S5P_MDEV_MFC, 0);
+
+	return ret;
+}
+
+static void mfc_release_memory(void)
+{
+	s5p_media_release(S5P_MDEV_MFC, 1);
+	s5p_media_release(S5P_MDEV_MFC, 0);
+}
+
 static int mfc_open(struct inode *inode, struct file *file)
 {
 	struct mfc_inst_ctx *mfc_ctx;
@@ -76,26 +172,36 @@ static int mfc_open(struct inode *inode, struct file *file)
 	mutex_lock(&mfc_mutex);
 
 	if (!mfc_is_running()) {
+		ret = mfc_claim_memory();
+		if (ret < 0) {
+			mfc_err("MFCINST_MEMORY_ALLOC_FAIL\n");
+			goto err_open;
+		}
+
 		/* Turn on mfc power domain regulator */
 		ret = regulator_enable(mfc_pd_regulator);
 		if (ret < 0) {
 			mfc_err("MFC_RET_POWER_ENABLE_FAIL\n");
 			ret = -EINVAL;
-			goto err_open;
+			goto err_memory;
 		}
 
 #ifdef CONFIG_DVFS_LIMIT
 		s5pv210_lock_dvfs_high_level(DVFS_LOCK_TOKEN_1, L2);
 #endif
+		s5pv210_bus_hint(BUS_HINT_MFC, true);
 		clk_enable(mfc_sclk);
+		mfc_hw_lock();
 
 		mfc_load_firmware(mfc_fw_info->data, mfc_fw_info->size);
 
 		if (mfc_init_hw() != true) {
+			mfc_hw_unlock();
 			clk_disable(mfc_sclk);
 			ret =  -ENODEV;
 			goto err_regulator;
 		}
+		mfc_hw_unlock();
 		clk_disable(mfc_sclk);
 	}
 
@@ -123,6 +229,13 @@ static int mfc_open(struct inode *inode, struct file *file)
 		goto err_set_state;
 	}
 
+	mfc_sched_init_inst(&mfc_ctx->sched, mfc_ctx->mem_inst_no);
+
+	INIT_WORK(&mfc_ctx->async_work, mfc_async_work);
+	init_waitqueue_head(&mfc_ctx->async_wait);
+	spin_lock_init(&mfc_ctx->async_lock);
+	mfc_ctx->async_state = MFC_ASYNC_IDLE;
+
 	/* Decoder only */
 	mfc_ctx->extraDPB = MFC_MAX_EXTRA_DPB;
 	mfc_ctx->FrameType = MFC_RET_FRAME_NOT_SET;
@@ -142,11 +255,15 @@ err_regulator:
 #ifdef CONFIG_DVFS_LIMIT
 		s5pv210_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_1);
 #endif
+		s5pv210_bus_hint(BUS_HINT_MFC, false);
 		/* Turn off mfc power domain regulator */
 		ret = regulator_disable(mfc_pd_regulator);
 		if (ret < 0)
 			mfc_err("MFC_RET_POWER_DISABLE_FAIL\n");
 	}
+err_memory:
+	if (!mfc_is_running())
+		mfc_release_memory();
 err_open:
 	mutex_unlock(&mfc_mutex);
 
@@ -158,24 +275,31 @@ static int mfc_release(struct inode *inode, struct file *file)
 	struct mfc_inst_ctx *mfc_ctx;
 	int ret;
 
+	/* A submitted frame still runs on the instance: let it finish */
+	mfc_ctx = (struct mfc_inst_ctx *)file->private_data;
+	if (mfc_ctx != NULL)
+		flush_work_sync(&mfc_ctx->async_work);
+
 	mutex_lock(&mfc_mutex);
 
-	mfc_ctx = (struct mfc_inst_ctx *)file->private_data;
 	if (mfc_ctx == NULL) {
 		mfc_err("MFCINST_ERR_INVALID_PARAM\n");
 		ret = -EIO;
 		goto out_release;
 	}
 
+	mfc_sched_exit_inst(&mfc_ctx->sched);
+
 	mfc_release_all_buffer(mfc_ctx->mem_inst_no);
-	mfc_merge_fragment(mfc_ctx->mem_inst_no);
 
 	mfc_return_mem_inst_no(mfc_ctx->mem_inst_no);
 
 	/* In case of no instance, we should not release codec instance */
 	if (mfc_ctx->InstNo >= 0) {
 		clk_enable(mfc_sclk);
+		mfc_hw_lock();
 		mfc_return_inst_no(mfc_ctx->InstNo, mfc_ctx->MfcCodecType);
+		mfc_hw_unlock();
 		clk_disable(mfc_sclk);
 	}
 
@@ -184,9 +308,12 @@ static int mfc_release(struct inode *inode, struct file *file)
 	ret = 0;
 
 	if (!mfc_is_running()) {
+		mfc_release_memory();
+
 #ifdef CONFIG_DVFS_LIMIT
 		s5pv210_unlock_dvfs_high_level(DVFS_LOCK_TOKEN_1);
 #endif
+		s5pv210_bus_hint(BUS_HINT_MFC, false);
 		/* Turn off mfc power domain regulator */
 		ret = regulator_disable(mfc_pd_regulator);
 		if (ret < 0) {
@@ -206,6 +333,8 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	int ret, ex_ret;
 	struct mfc_inst_ctx *mfc_ctx = NULL;
 	struct mfc_common_args in_param;
+	enum mfc_async_state async_state;
+	unsigned int exe_cmd;
 
 	mutex_lock(&mfc_mutex);
 	clk_enable(mfc_sclk);
@@ -234,32 +363,27 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		}
 
 		/* MFC encode init */
+		mfc_hw_lock();
 		in_param.ret_code = mfc_init_encode(mfc_ctx, &(in_param.args));
+		mfc_hw_unlock();
 		ret = in_param.ret_code;
 		mutex_unlock(&mfc_mutex);
 		break;
 
 	case IOCTL_MFC_ENC_EXE:
 		mutex_lock(&mfc_mutex);
-		if (mfc_ctx->MfcState < MFCINST_STATE_ENC_INITIALIZE) {
-			mfc_err("MFCINST_ERR_STATE_INVALID\n");
-			in_param.ret_code = MFCINST_ERR_STATE_INVALID;
+		in_param.ret_code = mfc_exe_check(mfc_ctx, IOCTL_MFC_ENC_EXE);
+		if (in_param.ret_code < 0) {
 			ret = -EINVAL;
 			mutex_unlock(&mfc_mutex);
 			break;
 		}
 
-		if (mfc_set_state(mfc_ctx, MFCINST_STATE_ENC_EXE) < 0) {
-			mfc_err("MFCINST_ERR_STATE_INVALID\n");
-			in_param.ret_code = MFCINST_ERR_STATE_INVALID;
-			ret = -EINVAL;
-			mutex_unlock(&mfc_mutex);
-			break;
-		}
+		/* The frame waits for its turn on the codec in mfc_exe_encode */
+		mutex_unlock(&mfc_mutex);
 
 		in_param.ret_code = mfc_exe_encode(mfc_ctx, &(in_param.args));
 		ret = in_param.ret_code;
-		mutex_unlock(&mfc_mutex);
 		break;
 
 	case IOCTL_MFC_DEC_INIT:
@@ -273,7 +397,9 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		}
 
 		/* MFC decode init */
+		mfc_hw_lock();
 		in_param.ret_code = mfc_init_decode(mfc_ctx, &(in_param.args));
+		mfc_hw_unlock();
 		if (in_param.ret_code < 0) {
 			ret = in_param.ret_code;
 			mutex_unlock(&mfc_mutex);
@@ -291,27 +417,79 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 
 	case IOCTL_MFC_DEC_EXE:
 		mutex_lock(&mfc_mutex);
-		if (mfc_ctx->MfcState < MFCINST_STATE_DEC_INITIALIZE) {
-			mfc_err("MFCINST_ERR_STATE_INVALID\n");
-			in_param.ret_code = MFCINST_ERR_STATE_INVALID;
+		in_param.ret_code = mfc_exe_check(mfc_ctx, IOCTL_MFC_DEC_EXE);
+		if (in_param.ret_code < 0) {
 			ret = -EINVAL;
 			mutex_unlock(&mfc_mutex);
 			break;
 		}
 
-		if (mfc_set_state(mfc_ctx, MFCINST_STATE_DEC_EXE) < 0) {
-			mfc_err("MFCINST_ERR_STATE_INVALID\n");
-			in_param.ret_code = MFCINST_ERR_STATE_INVALID;
+		/* The frame waits for its turn on the codec in mfc_exe_decode */
+		mutex_unlock(&mfc_mutex);
+
+		in_param.ret_code = mfc_exe_decode(mfc_ctx, &(in_param.args));
+		ret = in_param.ret_code;
+		break;
+
+	case IOCTL_MFC_ENC_EXE_ASYNC:
+	case IOCTL_MFC_DEC_EXE_ASYNC:
+		mutex_lock(&mfc_mutex);
+		exe_cmd = (cmd == IOCTL_MFC_ENC_EXE_ASYNC) ?
+			IOCTL_MFC_ENC_EXE : IOCTL_MFC_DEC_EXE;
+		in_param.ret_code = mfc_exe_check(mfc_ctx, exe_cmd);
+		if (in_param.ret_code < 0) {
 			ret = -EINVAL;
 			mutex_unlock(&mfc_mutex);
 			break;
 		}
 
-		in_param.ret_code = mfc_exe_decode(mfc_ctx, &(in_param.args));
-		ret = in_param.ret_code;
+		/* An unread result is dropped by the next frame */
+		spin_lock(&mfc_ctx->async_lock);
+		mfc_ctx->async_state = MFC_ASYNC_BUSY;
+		spin_unlock(&mfc_ctx->async_lock);
+
+		mfc_ctx->async_cmd = exe_cmd;
+		mfc_ctx->async_args = in_param;
+		queue_work(system_nrt_freezable_wq, &mfc_ctx->async_work);
+
+		in_param.ret_code = MFCINST_RET_OK;
+		ret = 0;
 		mutex_unlock(&mfc_mutex);
 		break;
 
+	case IOCTL_MFC_GET_RESULT:
+		spin_lock(&mfc_ctx->async_lock);
+		async_state = mfc_ctx->async_state;
+		spin_unlock(&mfc_ctx->async_lock);
+
+		if (async_state == MFC_ASYNC_IDLE) {
+			mfc_err("MFCINST_ERR_STATE_INVALID : no async frame\n");
+			in_param.ret_code = MFCINST_ERR_STATE_INVALID;
+			ret = -EINVAL;
+			break;
+		}
+
+		if (async_state == MFC_ASYNC_BUSY) {
+			if (file->f_flags & O_NONBLOCK) {
+				ret = -EAGAIN;
+				break;
+			}
+
+			if (wait_event_interruptible(mfc_ctx->async_wait,
+					mfc_async_done(mfc_ctx))) {
+				ret = -ERESTARTSYS;
+				break;
+			}
+		}
+
+		in_param = mfc_ctx->async_args;
+		ret = in_param.ret_code;
+
+		spin_lock(&mfc_ctx->async_lock);
+		mfc_ctx->async_state = MFC_ASYNC_IDLE;
+		spin_unlock(&mfc_ctx->async_lock);
+		break;
+
 	case IOCTL_MFC_GET_CONFIG:
 		mutex_lock(&mfc_mutex);
 		if (mfc_ctx->MfcState < MFCINST_STATE_DEC_INITIALIZE) {
@@ -322,7 +500,9 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 
+		mfc_hw_lock();
 		in_param.ret_code = mfc_get_config(mfc_ctx, &(in_param.args));
+		mfc_hw_unlock();
 		ret = in_param.ret_code;
 		mutex_unlock(&mfc_mutex);
 		break;
@@ -448,6 +628,23 @@ out_ioctl:
 	return ret;
 }
 
+static unsigned int mfc_poll(struct file *file, poll_table *wait)
+{
+	struct mfc_inst_ctx *mfc_ctx = (struct mfc_inst_ctx *)file->private_data;
+	unsigned int mask = 0;
+
+	poll_wait(file, &mfc_ctx->async_wait, wait);
+
+	spin_lock(&mfc_ctx->async_lock);
+	if (mfc_ctx->async_state == MFC_ASYNC_DONE)
+		mask |= POLLIN | POLLRDNORM;
+	if (mfc_ctx->async_state != MFC_ASYNC_BUSY)
+		mask |= POLLOUT | POLLWRNORM;
+	spin_unlock(&mfc_ctx->async_lock);
+
+	return mask;
+}
+
 static int mfc_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 	unsigned long vir_size = vma->vm_end - vma->vm_start;
@@ -511,6 +708,7 @@ static const struct file_operations mfc_fops = {
 	.open       = mfc_open,
 	.release    = mfc_release,
 	.unlocked_ioctl = mfc_ioctl,
+	.poll       = mfc_poll,
 	.mmap       = mfc_mmap
 };
 
@@ -524,8 +722,8 @@ static struct miscdevice mfc_miscdev = {
 static void mfc_firmware_request_complete_handler(const struct firmware *fw,
 						  void *context)
 {
+	/* Loaded by the first open: the memory may be lent out until then */
 	if (fw != NULL) {
-		mfc_load_firmware(fw->data, fw->size);
 		mfc_fw_info = fw;
 	} else {
 		mfc_err("failed to load MFC F/W, MFC will not working\n");
@@ -657,6 +855,12 @@ static int mfc_probe(struct platform_device *pdev)
 		goto err_misc_reg;
 	}
 
+	ret = mfc_sched_create_sysfs(mfc_miscdev.this_device);
+	if (ret) {
+		mfc_err("MFC can't create sched_stats\n");
+		goto err_sysfs;
+	}
+
 	/*
 	 * MFC FW downloading
 	 */
@@ -676,6 +880,8 @@ static int mfc_probe(struct platform_device *pdev)
 	return 0;
 
 err_req_fw:
+	mfc_sched_remove_sysfs(mfc_miscdev.this_device);
+err_sysfs:
 	misc_deregister(&mfc_miscdev);
 err_misc_reg:
 	clk_put(mfc_sclk);
@@ -714,6 +920,7 @@ static int mfc_remove(struct platform_device *pdev)
 
 	clk_put(mfc_sclk);
 
+	mfc_sched_remove_sysfs(mfc_miscdev.this_device);
 	misc_deregister(&mfc_miscdev);
 
 	if (mfc_fw_info)
@@ -733,8 +940,10 @@ static int mfc_suspend(struct platform_device *pdev, pm_message_t state)
 		return 0;
 	}
 	clk_enable(mfc_sclk);
+	mfc_hw_lock();
 
 	ret = mfc_set_sleep();
+	mfc_hw_unlock();
 	if (ret != MFCINST_RET_OK) {
 		clk_disable(mfc_sclk);
 		mutex_unlock(&mfc_mutex);
@@ -761,6 +970,7 @@ static int mfc_resume(struct platform_device *pdev)
 	}
 
 	clk_enable(mfc_sclk);
+	mfc_hw_lock();
 
 	/*
 	 * 1. MFC reset
@@ -770,6 +980,7 @@ static int mfc_resume(struct platform_device *pdev)
 	} while (mc_status != 0);
 
 	if (mfc_cmd_reset() == false) {
+		mfc_hw_unlock();
 		clk_disable(mfc_sclk);
 		mutex_unlock(&mfc_mutex);
 		mfc_err("MFCINST_ERR_INIT_FAIL\n");
@@ -781,6 +992,7 @@ static int mfc_resume(struct platform_device *pdev)
 	WRITEL(1, MFC_NUM_MASTER);
 
 	ret = mfc_set_wakeup();
+	mfc_hw_unlock();
 	if (ret != MFCINST_RET_OK) {
 		clk_disable(mfc_sclk);
 		mutex_unlock(&mfc_mutex);
@@ -29,6 +29,10 @@
 #include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/types.h>
+#include <linux/rbtree.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/io.h>
 #include <linux/uaccess.h>
@@ -41,12 +45,106 @@
 #include "mfc_logmsg.h"
 #include "mfc_memory.h"
 
+/*
+ * Free memory of a port is kept in two trees: by address, to coalesce a
+ * freed chunk with its neighbours right away, and by size, to find the
+ * best fit without walking every chunk. Both are protected by
+ * mfc_buffer_lock, which nests inside mfc_mutex.
+ */
+struct mfc_free_tree {
+	struct rb_root by_addr;
+	struct rb_root by_size;
+	unsigned int total;	/* free bytes */
+	unsigned int chunks;
+};
+
 static struct list_head mfc_alloc_mem_head[MFC_MAX_PORT_NUM];
-static struct list_head mfc_free_mem_head[MFC_MAX_PORT_NUM];
+static struct mfc_free_tree mfc_free_mem_tree[MFC_MAX_PORT_NUM];
+static DEFINE_MUTEX(mfc_buffer_lock);
+
+static void mfc_insert_by_addr(struct mfc_free_tree *tree,
+			       struct mfc_free_mem *node)
+{
+	struct rb_node **p = &tree->by_addr.rb_node;
+	struct rb_node *parent = NULL;
+	struct mfc_free_mem *entry;
+
+	while (*p) {
+		parent = *p;
+		entry = rb_entry(parent, struct mfc_free_mem, addr_node);
+		if (node->start_addr < entry->start_addr)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	rb_link_node(&node->addr_node, parent, p);
+	rb_insert_color(&node->addr_node, &tree->by_addr);
+}
+
+/* Equal sizes are ordered by address, so fits come from low memory first */
+static void mfc_insert_by_size(struct mfc_free_tree *tree,
+			       struct mfc_free_mem *node)
+{
+	struct rb_node **p = &tree->by_size.rb_node;
+	struct rb_node *parent = NULL;
+	struct mfc_free_mem *entry;
+
+	while (*p) {
+		parent = *p;
+		entry = rb_entry(parent, struct mfc_free_mem, size_node);
+		if (node->size < entry->size ||
+		    (node->size == entry->size &&
+		     node->start_addr < entry->start_addr))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	rb_link_node(&node->size_node, parent, p);
+	rb_insert_color(&node->size_node, &tree->by_size);
+}
+
+static void mfc_insert_free(struct mfc_free_tree *tree,
+			    struct mfc_free_mem *node)
+{
+	mfc_insert_by_addr(tree, node);
+	mfc_insert_by_size(tree, node);
+	tree->chunks++;
+}
+
+static void mfc_erase_free(struct mfc_free_tree *tree,
+			   struct mfc_free_mem *node)
+{
+	rb_erase(&node->addr_node, &tree->by_addr);
+	rb_erase(&node->size_node, &tree->by_size);
+	tree->chunks--;
+}
+
+/* The smallest chunk of at least size bytes */
+static struct mfc_free_mem *mfc_find_best_fit(struct mfc_free_tree *tree,
+					      unsigned int size)
+{
+	struct rb_node *n = tree->by_size.rb_node;
+	struct mfc_free_mem *entry, *match = NULL;
+
+	while (n) {
+		entry = rb_entry(n, struct mfc_free_mem, size_node);
+		if (entry->size >= size) {
+			match = entry;
+			n = n->rb_left;
+		} else {
+			n = n->rb_right;
+		}
+	}
+
+	return match;
+}
 
 void mfc_print_mem_list(void)
 {
 	struct list_head *pos;
+	struct rb_node *n;
 	struct mfc_alloc_mem *alloc_node;
 	struct mfc_free_mem *free_node;
 	int port_no;
@@ -57,94 +155,194 @@ void mfc_print_mem_list(void)
 		{
 			alloc_node = list_entry(pos, struct mfc_alloc_mem, list);
 			mfc_info("[alloc_list] inst_no: %d, p_addr: 0x%08x, "
-					"u_addr: 0x%p, size: %d\n",
+					"u_addr: 0x%p, size: %d%s\n",
 					alloc_node->inst_no,
 					alloc_node->p_addr,
 					alloc_node->u_addr,
-					alloc_node->size);
+					alloc_node->size,
+					alloc_node->imported ? " (imported)" : "");
 		}
 
-		list_for_each(pos, &mfc_free_mem_head[port_no])
-		{
-			free_node = list_entry(pos, struct mfc_free_mem, list);
+		for (n = rb_first(&mfc_free_mem_tree[port_no].by_addr); n;
+		     n = rb_next(n)) {
+			free_node = rb_entry(n, struct mfc_free_mem, addr_node);
 			mfc_info("[free_list] start_addr: 0x%08x size:%d\n",
 					free_node->start_addr , free_node->size);
 		}
 	}
 }
 
-void mfc_merge_fragment(int inst_no)
+static unsigned int mfc_get_free_mem(int alloc_size, int inst_no, int port_no)
 {
-	struct list_head *pos, *n;
-	struct mfc_free_mem *node1, *node2;
-	int port_no;
+	struct mfc_free_tree *tree = &mfc_free_mem_tree[port_no];
+	struct mfc_free_mem *match_node;
+	unsigned int alloc_addr;
 
-	for (port_no = 0; port_no < MFC_MAX_PORT_NUM; port_no++) {
-		list_for_each_safe(pos, n, &mfc_free_mem_head[port_no])
-		{
-			node1 = list_entry(pos, struct mfc_free_mem, list);
-			node2 = list_entry(n, struct mfc_free_mem, list);
-			if ((node1->start_addr + node1->size) == node2->start_addr) {
-				node2->start_addr = node1->start_addr;
-				node2->size += node1->size;
-				list_del(&(node1->list));
-				kfree(node1);
-			}
-		}
-	}
+	mfc_debug("request Size : %d\n", alloc_size);
 
-#if defined(DEBUG)
-	mfc_print_mem_list();
-#endif
-}
+	if (alloc_size <= 0)
+		return 0;
 
+	if (RB_EMPTY_ROOT(&tree->by_size)) {
+		mfc_err("all memory is gone\n");
+		return 0;
+	}
 
+	match_node = mfc_find_best_fit(tree, alloc_size);
+	if (match_node == NULL) {
+		mfc_err("there is no suitable chunk (size: %d, free: %u in %u chunks)\n",
+				alloc_size, tree->total, tree->chunks);
+		return 0;
+	}
 
-static unsigned int mfc_get_free_mem(int alloc_size, int inst_no, int port_no)
-{
-	struct list_head *pos;
-	struct mfc_free_mem *free_node, *match_node = NULL;
-	unsigned int alloc_addr = 0;
+	mfc_debug("match : startAddr(0x%08x) size(%d)\n", match_node->start_addr, match_node->size);
 
-	mfc_debug("request Size : %d\n", alloc_size);
+	/* Carving from the start keeps the address order of the chunk */
+	alloc_addr = match_node->start_addr;
+	rb_erase(&match_node->size_node, &tree->by_size);
+	match_node->start_addr += alloc_size;
+	match_node->size -= alloc_size;
+	tree->total -= alloc_size;
 
-	if (list_empty(&mfc_free_mem_head[port_no])) {
-		mfc_err("all memory is gone\n");
-		return alloc_addr;
+	if (match_node->size) {
+		mfc_insert_by_size(tree, match_node);
+	} else {
+		rb_erase(&match_node->addr_node, &tree->by_addr);
+		tree->chunks--;
+		kfree(match_node);
 	}
-	/* find best chunk of memory */
-	list_for_each(pos, &mfc_free_mem_head[port_no])
-	{
-		free_node = list_entry(pos, struct mfc_free_mem, list);
-
-		if (match_node != NULL) {
-			if ((free_node->size >= alloc_size) &&
-				(free_node->size < match_node->size))
-				match_node = free_node;
+
+	return alloc_addr;
+}
+
+/* Give [addr, addr + size) back to the port, merged with its neighbours */
+static void mfc_put_free_mem(unsigned int addr, unsigned int size, int port_no)
+{
+	struct mfc_free_tree *tree = &mfc_free_mem_tree[port_no];
+	struct rb_node *n = tree->by_addr.rb_node;
+	struct mfc_free_mem *entry, *prev = NULL, *next = NULL;
+	struct mfc_free_mem *free_node;
+
+	while (n) {
+		entry = rb_entry(n, struct mfc_free_mem, addr_node);
+		if (addr < entry->start_addr) {
+			next = entry;
+			n = n->rb_left;
 		} else {
-			if (free_node->size >= alloc_size)
-				match_node = free_node;
+			prev = entry;
+			n = n->rb_right;
 		}
 	}
 
+	if (prev && prev->start_addr + prev->size != addr)
+		prev = NULL;
+	if (next && addr + size != next->start_addr)
+		next = NULL;
+
+	tree->total += size;
+
+	if (prev && next) {
+		mfc_erase_free(tree, next);
+		rb_erase(&prev->size_node, &tree->by_size);
+		prev->size += size + next->size;
+		mfc_insert_by_size(tree, prev);
+		kfree(next);
+	} else if (prev) {
+		rb_erase(&prev->size_node, &tree->by_size);
+		prev->size += size;
+		mfc_insert_by_size(tree, prev);
+	} else if (next) {
+		/* Growing downwards keeps next's place in the address tree */
+		rb_erase(&next->size_node, &tree->by_size);
+		next->start_addr = addr;
+		next->size += size;
+		mfc_insert_by_size(tree, next);
+	} else {
+		free_node = kmalloc(sizeof(struct mfc_free_mem), GFP_KERNEL);
+		if (!free_node) {
+			mfc_err("lost free chunk 0x%08x (size: %u)\n", addr, size);
+			tree->total -= size;
+			return;
+		}
 
-	if (match_node != NULL) {
-		mfc_debug("match : startAddr(0x%08x) size(%d)\n", match_node->start_addr, match_node->size);
+		free_node->start_addr = addr;
+		free_node->size = size;
+		mfc_insert_free(tree, free_node);
+	}
+}
 
-		alloc_addr = match_node->start_addr;
-		match_node->start_addr += alloc_size;
-		match_node->size -= alloc_size;
+#ifdef CONFIG_DEBUG_FS
+static int mfc_buffer_show(struct seq_file *s, void *unused)
+{
+	struct mfc_free_tree *tree;
+	struct mfc_alloc_mem *alloc_node;
+	struct mfc_free_mem *free_node;
+	unsigned int largest, allocated, frag;
+	struct rb_node *n;
+	int port_no;
 
-		if (match_node->size < 0x1)	/* delete match_node. */
-			mfc_err("there is no suitable chunk...[case 0]\n");
-	} else {
-		mfc_err("there is no suitable chunk....[case 1]\n");
-		return 0;
+	mutex_lock(&mfc_buffer_lock);
+	for (port_no = 0; port_no < MFC_MAX_PORT_NUM; port_no++) {
+		tree = &mfc_free_mem_tree[port_no];
+
+		largest = 0;
+		n = rb_last(&tree->by_size);
+		if (n)
+			largest = rb_entry(n, struct mfc_free_mem, size_node)->size;
+
+		allocated = 0;
+		list_for_each_entry(alloc_node, &mfc_alloc_mem_head[port_no], list) {
+			if (!alloc_node->imported)
+				allocated += alloc_node->size;
+		}
+
+		/* Share of the free memory a single allocation cannot use */
+		frag = tree->total ?
+			100 - div_u64((u64)largest * 100, tree->total) : 0;
+
+		seq_printf(s, "port%d: allocated %u free %u in %u chunks, "
+			   "largest %u, fragmentation %u%%\n", port_no,
+			   allocated, tree->total, tree->chunks, largest, frag);
+
+		for (n = rb_first(&tree->by_addr); n; n = rb_next(n)) {
+			free_node = rb_entry(n, struct mfc_free_mem, addr_node);
+			seq_printf(s, "  free  0x%08x %u\n",
+				   free_node->start_addr, free_node->size);
+		}
+
+		list_for_each_entry(alloc_node, &mfc_alloc_mem_head[port_no], list)
+			seq_printf(s, "  %s 0x%08x %d inst %d\n",
+				   alloc_node->imported ? "import" : "alloc ",
+				   alloc_node->p_addr, alloc_node->size,
+				   alloc_node->inst_no);
 	}
+	mutex_unlock(&mfc_buffer_lock);
 
-	return alloc_addr;
+	return 0;
+}
+
+static int mfc_buffer_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mfc_buffer_show, inode->i_private);
 }
 
+static const struct file_operations mfc_buffer_fops = {
+	.open		= mfc_buffer_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void mfc_buffer_debugfs_init(void)
+{
+	debugfs_create_file("mfc_buffers", S_IRUGO, NULL, NULL,
+			    &mfc_buffer_fops);
+}
+#else
+static inline void mfc_buffer_debugfs_init(void)
+{
+}
+#endif
 
 int mfc_init_buffer(void)
 {
@@ -153,11 +351,17 @@ int mfc_init_buffer(void)
 
 	for (port_no = 0; port_no < MFC_MAX_PORT_NUM; port_no++) {
 		INIT_LIST_HEAD(&mfc_alloc_mem_head[port_no]);
-		INIT_LIST_HEAD(&mfc_free_mem_head[port_no]);
+		mfc_free_mem_tree[port_no].by_addr = RB_ROOT;
+		mfc_free_mem_tree[port_no].by_size = RB_ROOT;
+		mfc_free_mem_tree[port_no].total = 0;
+		mfc_free_mem_tree[port_no].chunks = 0;
+
 		/* init free head node */
-		free_node =
-			(struct mfc_free_mem *)kmalloc(sizeof(struct mfc_free_mem), GFP_KERNEL);
-		memset(free_node, 0x00, sizeof(struct mfc_free_mem));
+		free_node = kzalloc(sizeof(struct mfc_free_mem), GFP_KERNEL);
+		if (!free_node) {
+			mfc_err("There is no more kernel memory");
+			return -ENOMEM;
+		}
 
 		if (port_no) {
 			free_node->start_addr = mfc_get_port1_buff_paddr();
@@ -168,15 +372,27 @@ int mfc_init_buffer(void)
 				(mfc_get_port0_buff_paddr() - mfc_get_fw_buff_paddr());
 		}
 
-		list_add_tail(&(free_node->list), &mfc_free_mem_head[port_no]);
+		mfc_insert_free(&mfc_free_mem_tree[port_no], free_node);
+		mfc_free_mem_tree[port_no].total = free_node->size;
 	}
 
+	mfc_buffer_debugfs_init();
+
 #if defined(DEBUG)
 	mfc_print_mem_list();
 #endif
 	return 0;
 }
 
+static void __mfc_free_alloc_mem(struct mfc_alloc_mem *alloc_node, int port_no)
+{
+	if (!alloc_node->imported)
+		mfc_put_free_mem(alloc_node->p_addr, alloc_node->size, port_no);
+
+	list_del(&(alloc_node->list));
+	kfree(alloc_node);
+}
+
 enum mfc_error_code mfc_release_buffer(unsigned char *u_addr)
 {
 	struct list_head *pos;
@@ -184,12 +400,13 @@ enum mfc_error_code mfc_release_buffer(unsigned char *u_addr)
 	struct mfc_alloc_mem *alloc_node;
 	bool found = false;
 
-	for (port_no = 0; port_no < MFC_MAX_PORT_NUM; port_no++) {
+	mutex_lock(&mfc_buffer_lock);
+	for (port_no = 0; port_no < MFC_MAX_PORT_NUM && !found; port_no++) {
 		list_for_each(pos, &mfc_alloc_mem_head[port_no])
 		{
 			alloc_node = list_entry(pos, struct mfc_alloc_mem, list);
 			if (alloc_node->u_addr == u_addr) {
-				mfc_free_alloc_mem(alloc_node, port_no);
+				__mfc_free_alloc_mem(alloc_node, port_no);
 				found = true;
 				break;
 			}
@@ -199,6 +416,7 @@ enum mfc_error_code mfc_release_buffer(unsigned char *u_addr)
 #if defined(DEBUG)
 	mfc_print_mem_list();
 #endif
+	mutex_unlock(&mfc_buffer_lock);
 
 	if (found)
 		return MFCINST_RET_OK;
@@ -212,11 +430,12 @@ void mfc_release_all_buffer(int inst_no)
 	int port_no;
 	struct mfc_alloc_mem *alloc_node;
 
+	mutex_lock(&mfc_buffer_lock);
 	for (port_no = 0; port_no < MFC_MAX_PORT_NUM; port_no++) {
 		list_for_each_safe(pos, n, &mfc_alloc_mem_head[port_no]) {
 			alloc_node = list_entry(pos, struct mfc_alloc_mem, list);
 			if (alloc_node->inst_no == inst_no) {
-				mfc_free_alloc_mem(alloc_node, port_no);
+				__mfc_free_alloc_mem(alloc_node, port_no);
 			}
 		}
 	}
@@ -224,32 +443,14 @@ void mfc_release_all_buffer(int inst_no)
 #if defined(DEBUG)
 	mfc_print_mem_list();
 #endif
+	mutex_unlock(&mfc_buffer_lock);
 }
 
 void mfc_free_alloc_mem(struct mfc_alloc_mem *alloc_node, int port_no)
 {
-	struct list_head *pos;
-	struct mfc_free_mem *free_node;
-	struct mfc_free_mem *target_node;
-
-	free_node = (struct mfc_free_mem *)kmalloc(sizeof(struct mfc_free_mem), GFP_KERNEL);
-	free_node->start_addr = alloc_node->p_addr;
-	free_node->size = alloc_node->size;
-
-	list_for_each(pos, &mfc_free_mem_head[port_no])
-	{
-		target_node = list_entry(pos, struct mfc_free_mem, list);
-		if (alloc_node->p_addr < target_node->start_addr)
-			break;
-	}
-
-	if (pos == &mfc_free_mem_head[port_no])
-		list_add_tail(&(free_node->list), &(mfc_free_mem_head[port_no]));
-	else
-		list_add_tail(&(free_node->list), pos);
-
-	list_del(&(alloc_node->list));
-	kfree(alloc_node);
+	mutex_lock(&mfc_buffer_lock);
+	__mfc_free_alloc_mem(alloc_node, port_no);
+	mutex_unlock(&mfc_buffer_lock);
 }
 
 enum mfc_error_code mfc_get_phys_addr(struct mfc_inst_ctx *mfc_ctx, union mfc_args *args)
@@ -260,6 +461,7 @@ enum mfc_error_code mfc_get_phys_addr(struct mfc_inst_ctx *mfc_ctx, union mfc_ar
 	struct mfc_get_phys_addr_arg *phys_addr_arg;
 
 	phys_addr_arg = (struct mfc_get_phys_addr_arg *)args;
+	mutex_lock(&mfc_buffer_lock);
 	for (port_no = 0; port_no < MFC_MAX_PORT_NUM; port_no++) {
 		list_for_each(pos, &mfc_alloc_mem_head[port_no])
 		{
@@ -281,6 +483,7 @@ found:
 	ret = MFCINST_RET_OK;
 
 out_getphysaddr:
+	mutex_unlock(&mfc_buffer_lock);
 	return ret;
 }
 
@@ -302,6 +505,8 @@ enum mfc_error_code mfc_allocate_buffer(struct mfc_inst_ctx *mfc_ctx, union mfc_
 	}
 	memset(alloc_node, 0x00, sizeof(struct mfc_alloc_mem));
 
+	mutex_lock(&mfc_buffer_lock);
+
 	/* if user request area, allocate from reserved area */
 	start_paddr = mfc_get_free_mem((int)in_param->buff_size, inst_no, port_no);
 	mfc_debug("start_paddr = 0x%X\n\r", start_paddr);
@@ -310,6 +515,7 @@ enum mfc_error_code mfc_allocate_buffer(struct mfc_inst_ctx *mfc_ctx, union mfc_
 		mfc_err("There is no more memory\n\r");
 		in_param->out_uaddr = -1;
 		ret = MFCINST_MEMORY_ALLOC_FAIL;
+		mutex_unlock(&mfc_buffer_lock);
 		kfree(alloc_node);
 		goto out_getcodecviraddr;
 	}
@@ -344,7 +550,56 @@ enum mfc_error_code mfc_allocate_buffer(struct mfc_inst_ctx *mfc_ctx, union mfc_
 #if defined(DEBUG)
 	mfc_print_mem_list();
 #endif
+	mutex_unlock(&mfc_buffer_lock);
 
 out_getcodecviraddr:
 	return ret;
 }
+
+/* Whether the codec can reach [p_addr, p_addr + size) through port_no */
+bool mfc_port_addressable(int port_no, unsigned int p_addr, unsigned int size)
+{
+	unsigned int base = port_no ? mfc_port1_base_paddr : mfc_port0_base_paddr;
+
+	if (!size || p_addr < base || (p_addr & (MFC_PORT_ADDR_ALIGN - 1)))
+		return false;
+
+	return p_addr - base <= MFC_PORT_ADDR_RANGE &&
+		size <= MFC_PORT_ADDR_RANGE - (p_addr - base);
+}
+
+/*
+ * Hand the codec a physically contiguous buffer the caller already owns,
+ * e.g. a frame shared with the GPU or FIMC, instead of carving one from
+ * the port. The node only records it for the instance: releasing it
+ * gives nothing back to the port.
+ */
+enum mfc_error_code mfc_import_buffer(struct mfc_inst_ctx *mfc_ctx, unsigned int p_addr, unsigned int size, int port_no)
+{
+	struct mfc_alloc_mem *alloc_node;
+
+	if (!mfc_port_addressable(port_no, p_addr, size)) {
+		mfc_err("port%d can't address 0x%08x (size: %u)\n", port_no, p_addr, size);
+		return MFCINST_MEMORY_INVALID_ADDR;
+	}
+
+	alloc_node = kzalloc(sizeof(struct mfc_alloc_mem), GFP_KERNEL);
+	if (!alloc_node) {
+		mfc_err("There is no more kernel memory");
+		return MFCINST_MEMORY_ALLOC_FAIL;
+	}
+
+	alloc_node->p_addr = p_addr;
+	alloc_node->size = size;
+	alloc_node->inst_no = mfc_ctx->mem_inst_no;
+	alloc_node->imported = true;
+
+	mutex_lock(&mfc_buffer_lock);
+	list_add(&(alloc_node->list), &mfc_alloc_mem_head[port_no]);
+#if defined(DEBUG)
+	mfc_print_mem_list();
+#endif
+	mutex_unlock(&mfc_buffer_lock);
+
+	return MFCINST_RET_OK;
+}
@@ -20,6 +20,7 @@
 #define _MFC_BUFFER_MANAGER_H_
 
 #include <linux/list.h>
+#include <linux/rbtree.h>
 #include "mfc_interface.h"
 #include "mfc_opr.h"
 
@@ -33,11 +34,13 @@ struct mfc_alloc_mem  {
 	unsigned char *u_addr;     /* virtual address for user mode process */
 	int size;                  /* memory size                           */
 	int inst_no;               /* instance no                           */
+	bool imported;             /* caller's memory, not the port's       */
 };
 
 
 struct mfc_free_mem  {
-	struct list_head list;     /* struct list_head for free mem         */
+	struct rb_node addr_node;  /* free mem of the port by start address */
+	struct rb_node size_node;  /* free mem of the port by size          */
 	unsigned int start_addr;   /* start address of free mem             */
 	unsigned int size;         /* size of free mem                      */
 };
@@ -46,11 +49,12 @@ struct mfc_free_mem  {
 /* Function Prototype */
 void mfc_print_mem_list(void);
 int mfc_init_buffer(void);
-void mfc_merge_fragment(int inst_no);
 void mfc_release_all_buffer(int inst_no);
 void mfc_free_alloc_mem(struct mfc_alloc_mem *alloc_node, int port_no);
 enum mfc_error_code mfc_release_buffer(unsigned char *u_addr);
 enum mfc_error_code mfc_get_phys_addr(struct mfc_inst_ctx *mfc_ctx, union mfc_args *args);
 enum mfc_error_code mfc_allocate_buffer(struct mfc_inst_ctx *mfc_ctx, union mfc_args *args, int port_no);
+bool mfc_port_addressable(int port_no, unsigned int p_addr, unsigned int size);
+enum mfc_error_code mfc_import_buffer(struct mfc_inst_ctx *mfc_ctx, unsigned int p_addr, unsigned int size, int port_no);
 
 #endif /* _MFC_BUFFER_MANAGER_H_ */
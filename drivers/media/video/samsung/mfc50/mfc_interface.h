@@ -27,6 +27,16 @@
 #define IOCTL_MFC_DEC_EXE			0x00800003
 #define IOCTL_MFC_ENC_EXE			0x00800004
 
+/*
+ * Non-blocking frame commands: *_EXE_ASYNC queues the frame and returns,
+ * poll() reports POLLIN once it is done and GET_RESULT returns its
+ * arguments, waiting for it unless the file is O_NONBLOCK. One frame
+ * per instance is in flight; POLLOUT means another can be submitted.
+ */
+#define IOCTL_MFC_DEC_EXE_ASYNC			0x00800005
+#define IOCTL_MFC_ENC_EXE_ASYNC			0x00800006
+#define IOCTL_MFC_GET_RESULT			0x00800007
+
 #define IOCTL_MFC_GET_IN_BUF			0x00800010
 #define IOCTL_MFC_FREE_BUF			0x00800011
 #define IOCTL_MFC_GET_PHYS_ADDR			0x00800012
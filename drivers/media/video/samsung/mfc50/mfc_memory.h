@@ -87,6 +87,13 @@
 
 #endif
 
+/*
+ * Buffers are programmed as 2KB offsets from the DRAM base of their port,
+ * so the codec reaches 128MB above mfc_port0/1_base_paddr.
+ */
+#define MFC_PORT_ADDR_ALIGN   (2 * 1024)
+#define MFC_PORT_ADDR_RANGE   (128 * 1024 * 1024)
+
 unsigned int mfc_get_fw_buf_phys_addr(void);
 unsigned int mfc_get_risc_buf_phys_addr(int instNo);
 
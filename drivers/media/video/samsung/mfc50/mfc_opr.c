@@ -50,6 +50,9 @@
 #include "mfc_shared_mem.h"
 #include "mfc_intr.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/mfc.h>
+
 
 /* DEBUG_MAKE_RAW is option to dump input stream data of MFC.*/
 #define DEBUG_MAKE_RAW					0 /* Making Dec/Enc Debugging Files */
@@ -297,6 +300,35 @@ static enum mfc_error_code mfc_alloc_dec_frame_buffer(struct mfc_inst_ctx *mfc_c
 	luma_size = buf_size.luma * mfc_ctx->totalDPBCnt;
 	chroma_size = buf_size.chroma * mfc_ctx->totalDPBCnt;
 
+	/*
+	 * Decode straight into the caller's frames when it passed ones the
+	 * codec can reach. Cached instances keep the port memory: their
+	 * display frames are invalidated through the kernel mapping.
+	 */
+	if ((mfc_ctx->buf_type != MFC_BUFFER_CACHE) &&
+		(init_arg->in_frm_size.luma >= luma_size) &&
+		(init_arg->in_frm_size.chroma >= chroma_size) &&
+		mfc_port_addressable(1, init_arg->in_frm_buf.luma, luma_size) &&
+		mfc_port_addressable(0, init_arg->in_frm_buf.chroma, chroma_size)) {
+		ret_code = mfc_import_buffer(mfc_ctx, init_arg->in_frm_buf.chroma, chroma_size, 0);
+		if (ret_code < 0)
+			return ret_code;
+
+		ret_code = mfc_import_buffer(mfc_ctx, init_arg->in_frm_buf.luma, luma_size, 1);
+		if (ret_code < 0)
+			return ret_code;
+
+		init_arg->out_frame_buf_size.chroma = chroma_size;
+		init_arg->out_frame_buf_size.luma = luma_size;
+		init_arg->out_u_addr.chroma = 0;
+		init_arg->out_u_addr.luma = 0;
+		init_arg->out_p_addr = init_arg->in_frm_buf;
+
+		mfc_ctx->dec_dpb_buff_paddr = init_arg->out_p_addr;
+
+		return MFCINST_RET_OK;
+	}
+
 	/*
 	 * Allocate chroma & (Mv in case of H264) buf
 	 */
@@ -1162,9 +1194,11 @@ static enum mfc_error_code mfc_encode_header(struct mfc_inst_ctx *mfc_ctx, union
 static enum mfc_error_code mfc_encode_one_frame(struct mfc_inst_ctx *mfc_ctx, union mfc_args *args)
 {
 	struct mfc_enc_exe_arg *enc_arg;
+	struct mfc_sched_cmd cmd;
 	unsigned int port0_base_paddr, port1_base_paddr;
 	int interrupt_flag;
 	int nReturnErrCode;
+	enum mfc_error_code ret_code = MFCINST_RET_OK;
 
 
 	enc_arg = (struct mfc_enc_exe_arg *)args;
@@ -1174,6 +1208,26 @@ static enum mfc_error_code mfc_encode_one_frame(struct mfc_inst_ctx *mfc_ctx, un
 	mfc_debug("enc_arg->in_Y_addr : 0x%08x enc_arg->in_CbCr_addr :0x%08x \r\n",
 				enc_arg->in_Y_addr, enc_arg->in_CbCr_addr);
 
+	/* Clean the input frame before waiting for the codec */
+	if (mfc_ctx->buf_type == MFC_BUFFER_CACHE) {
+		unsigned char *in_vir;
+		unsigned int aligned_width;
+		unsigned int aligned_height;
+
+		in_vir = phys_to_virt(enc_arg->in_Y_addr);
+		aligned_width = ALIGN_TO_128B(mfc_ctx->img_width);
+		aligned_height = ALIGN_TO_32B(mfc_ctx->img_height);
+		dma_map_single(NULL, in_vir, aligned_width*aligned_height,
+				DMA_TO_DEVICE);
+
+		in_vir = phys_to_virt(enc_arg->in_CbCr_addr);
+		aligned_height = ALIGN_TO_32B(mfc_ctx->img_height/2);
+		dma_map_single(NULL, in_vir, aligned_width*aligned_height,
+				DMA_TO_DEVICE);
+	}
+
+	mfc_sched_get(&mfc_ctx->sched, &cmd);
+
 	mfc_restore_context(mfc_ctx);
 
 	port0_base_paddr = mfc_port0_base_paddr;
@@ -1210,33 +1264,20 @@ static enum mfc_error_code mfc_encode_one_frame(struct mfc_inst_ctx *mfc_ctx, un
 
 	mfc_ctx->forceSetFrameType = DONT_CARE;
 
-	if (mfc_ctx->buf_type == MFC_BUFFER_CACHE) {
-		unsigned char *in_vir;
-		unsigned int aligned_width;
-		unsigned int aligned_height;
-
-		in_vir = phys_to_virt(enc_arg->in_Y_addr);
-		aligned_width = ALIGN_TO_128B(mfc_ctx->img_width);
-		aligned_height = ALIGN_TO_32B(mfc_ctx->img_height);
-		dma_map_single(NULL, in_vir, aligned_width*aligned_height,
-				DMA_TO_DEVICE);
-
-		in_vir = phys_to_virt(enc_arg->in_CbCr_addr);
-		aligned_height = ALIGN_TO_32B(mfc_ctx->img_height/2);
-		dma_map_single(NULL, in_vir, aligned_width*aligned_height,
-				DMA_TO_DEVICE);
-	}
-
 	/* Try frame encoding */
+	trace_mfc_frame_start(mfc_ctx->InstNo, 1);
 	WRITEL((FRAME << 16) | (mfc_ctx->InstNo), MFC_SI_CH0_INST_ID);
 	interrupt_flag = mfc_wait_for_done(R2H_CMD_FRAME_DONE_RET);
 	nReturnErrCode = mfc_return_code();
+	trace_mfc_frame_done(mfc_ctx->InstNo, 1, interrupt_flag, nReturnErrCode);
 	if (interrupt_flag == 0) {
 		mfc_err("MFCINST_ERR_ENC_EXE_TIME_OUT\n");
-		return MFCINST_ERR_INTR_TIME_OUT;
+		ret_code = MFCINST_ERR_INTR_TIME_OUT;
+		goto out_put;
 	} else if ((interrupt_flag != R2H_CMD_FRAME_DONE_RET) && (nReturnErrCode < MFC_WARN_START_NO)) {
 		mfc_err("MFCINST_ERR_ENC_DONE_FAIL\n");
-		return MFCINST_ERR_ENC_ENCODE_DONE_FAIL;
+		ret_code = MFCINST_ERR_ENC_ENCODE_DONE_FAIL;
+		goto out_put;
 	} else if (interrupt_flag != R2H_CMD_FRAME_DONE_RET) {
 		mfc_warn("MFCINST_WARN_ENC_EXE.........(code: %d)\n", interrupt_flag);
 	}
@@ -1247,6 +1288,12 @@ static enum mfc_error_code mfc_encode_one_frame(struct mfc_inst_ctx *mfc_ctx, un
 	enc_arg->out_encoded_Y_paddr = READL(MFC_SI_ENCODED_Y_ADDR);
 	enc_arg->out_encoded_C_paddr = READL(MFC_SI_ENCODED_C_ADDR);
 
+out_put:
+	mfc_sched_put(&mfc_ctx->sched, &cmd);
+
+	if (ret_code != MFCINST_RET_OK)
+		return ret_code;
+
 	if (mfc_ctx->buf_type == MFC_BUFFER_CACHE) {
 		dma_unmap_single(NULL, enc_arg->in_strm_st,
 				enc_arg->out_encoded_size, DMA_FROM_DEVICE);
@@ -1531,6 +1578,7 @@ enum mfc_error_code mfc_init_decode(struct mfc_inst_ctx *mfc_ctx, union mfc_args
 
 static enum mfc_error_code mfc_decode_one_frame(struct mfc_inst_ctx *mfc_ctx, struct mfc_dec_exe_arg *dec_arg, unsigned int *consumed_strm_size)
 {
+	struct mfc_sched_cmd cmd;
 	unsigned int frame_type;
 	static int count;
 	int interrupt_flag;
@@ -1581,12 +1629,15 @@ static enum mfc_error_code mfc_decode_one_frame(struct mfc_inst_ctx *mfc_ctx, st
 	}
 #endif
 
+	mfc_sched_get(&mfc_ctx->sched, &cmd);
+
 	count++;
 	mfc_debug_L0("++ IntNo%d(%d)\r\n", mfc_ctx->InstNo, count);
 
 	WRITEL((mfc_ctx->shared_mem_paddr - mfc_port0_base_paddr), MFC_SI_CH0_HOST_WR_ADR);
 	mfc_set_dec_stream_buffer(mfc_ctx, dec_arg->in_strm_buf, dec_arg->in_strm_size);
 
+	trace_mfc_frame_start(mfc_ctx->InstNo, 0);
 	if (mfc_ctx->endOfFrame) {
 		WRITEL((LAST_FRAME<<16) | (mfc_ctx->InstNo), MFC_SI_CH0_INST_ID);
 		mfc_ctx->endOfFrame = 0;
@@ -1596,6 +1647,7 @@ static enum mfc_error_code mfc_decode_one_frame(struct mfc_inst_ctx *mfc_ctx, st
 
 	interrupt_flag = mfc_wait_for_done(R2H_CMD_FRAME_DONE_RET);
 	nReturnErrCode = mfc_return_code();
+	trace_mfc_frame_done(mfc_ctx->InstNo, 0, interrupt_flag, nReturnErrCode);
 	if (interrupt_flag == 0) {
 #ifdef ENABLE_DEBUG_DEC_EXE_INTR_ERR
  #if ENABLE_DEBUG_DEC_EXE_INTR_ERR
@@ -1609,6 +1661,7 @@ static enum mfc_error_code mfc_decode_one_frame(struct mfc_inst_ctx *mfc_ctx, st
 #endif
 
 		mfc_err("MFCINST_ERR_DEC_EXE_TIME_OUT\n");
+		mfc_sched_put(&mfc_ctx->sched, &cmd);
 		return MFCINST_ERR_INTR_TIME_OUT;
 	} else if ((interrupt_flag != R2H_CMD_FRAME_DONE_RET) && (nReturnErrCode < MFC_WARN_START_NO)) {
 
@@ -1626,6 +1679,7 @@ static enum mfc_error_code mfc_decode_one_frame(struct mfc_inst_ctx *mfc_ctx, st
 #endif
 
 		mfc_err("MFCINST_ERR_DEC_DONE_FAIL.......(interrupt_flag: %d), (ERR Code: %d)\n", interrupt_flag, nReturnErrCode);
+		mfc_sched_put(&mfc_ctx->sched, &cmd);
 		return MFCINST_ERR_DEC_DECODE_DONE_FAIL;
 
 	} else if (interrupt_flag != R2H_CMD_FRAME_DONE_RET) {
@@ -1665,6 +1719,8 @@ static enum mfc_error_code mfc_decode_one_frame(struct mfc_inst_ctx *mfc_ctx, st
 
 	*consumed_strm_size = READL(MFC_SI_DEC_FRM_SIZE);
 
+	mfc_sched_put(&mfc_ctx->sched, &cmd);
+
 	return MFCINST_RET_OK;
 }
 
@@ -1741,9 +1797,10 @@ enum mfc_error_code mfc_exe_decode(struct mfc_inst_ctx *mfc_ctx, union mfc_args
 
 	}
 
+	/* The codec may run another instance by now: use the saved status */
 	if (mfc_ctx->buf_type == MFC_BUFFER_CACHE) {
-		if (((READL(MFC_SI_DISPLAY_STATUS) & 0x3) == DECODING_DISPLAY) ||
-		((READL(MFC_SI_DISPLAY_STATUS) & 0x3) == DISPLAY_ONLY)) {
+		if ((dec_arg->out_display_status == 1) ||
+		    (dec_arg->out_display_status == 2)) {
 			unsigned int aligned_width;
 			unsigned int aligned_height;
 
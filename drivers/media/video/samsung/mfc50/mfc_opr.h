@@ -21,10 +21,14 @@
 #ifndef _MFC_OPR_H_
 #define _MFC_OPR_H_
 
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
 #include <plat/regs-mfc.h>
 #include "mfc_errorno.h"
 #include "mfc_interface.h"
 #include "mfc_shared_mem.h"
+#include "mfc_sched.h"
 
 #define MFC_WARN_START_NO		145
 #define MFC_ERR_START_NO			1
@@ -144,6 +148,12 @@ enum  mfc_frame_type {
 	MFC_RET_FRAME_B_FRAME = 3
 };
 
+enum mfc_async_state {
+	MFC_ASYNC_IDLE = 0,
+	MFC_ASYNC_BUSY,		/* frame queued or running */
+	MFC_ASYNC_DONE,		/* result waiting for GET_RESULT */
+};
+
 struct mfc_inst_ctx {
 	int InstNo;
 	unsigned int DPBCnt;
@@ -176,6 +186,15 @@ struct mfc_inst_ctx {
 	struct mfc_shared_mem shared_mem;
 	enum mfc_buffer_type buf_type;
 	unsigned int desc_buff_paddr;
+	struct mfc_sched_inst sched;
+
+	/* IOCTL_MFC_*_EXE_ASYNC frame, async_state under async_lock */
+	struct work_struct async_work;
+	wait_queue_head_t async_wait;
+	spinlock_t async_lock;
+	enum mfc_async_state async_state;
+	unsigned int async_cmd;
+	struct mfc_common_args async_args;
 };
 
 int mfc_load_firmware(const unsigned char *data, size_t size);
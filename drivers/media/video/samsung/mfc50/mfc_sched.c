@@ -0,0 +1,252 @@
+/*
+ * drivers/media/video/samsung/mfc50/mfc_sched.c
+ *
+ * C file for Samsung MFC (Multi Function Codec - FIMV) driver
+ *
+ * Hardware scheduler shared by the open MFC instances.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The codec runs one command at a time and its result registers are
+ * only valid until the next command starts, so an instance owns the
+ * codec from programming a frame until it has read the frame back.
+ * Everything else - stream checks, cache maintenance, shared memory -
+ * runs outside of it, so one session prepares its next frame while the
+ * other one is on the codec.
+ */
+
+#include <linux/kernel.h>
+#include <linux/device.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+
+#include "mfc_logmsg.h"
+#include "mfc_memory.h"
+#include "mfc_sched.h"
+
+static DEFINE_SPINLOCK(mfc_sched_lock);
+static LIST_HEAD(mfc_run_list);
+static bool mfc_hw_busy;
+
+/* Open instances, by memory instance number, for the statistics */
+static struct mfc_sched_inst *mfc_sched_slots[MFC_MAX_INSTANCE_NUM];
+
+/* Init, sleep and wakeup commands, serialized by mfc_mutex */
+static struct mfc_sched_inst mfc_sys_inst = {
+	.run_node = LIST_HEAD_INIT(mfc_sys_inst.run_node),
+	.cmds = LIST_HEAD_INIT(mfc_sys_inst.cmds),
+	.slot = -1,
+};
+static struct mfc_sched_cmd mfc_sys_cmd;
+
+void mfc_sched_init_inst(struct mfc_sched_inst *inst, int slot)
+{
+	unsigned long flags;
+
+	INIT_LIST_HEAD(&inst->run_node);
+	INIT_LIST_HEAD(&inst->cmds);
+	memset(&inst->stats, 0, sizeof(inst->stats));
+	inst->slot = slot;
+
+	spin_lock_irqsave(&mfc_sched_lock, flags);
+	if (slot >= 0 && slot < MFC_MAX_INSTANCE_NUM)
+		mfc_sched_slots[slot] = inst;
+	spin_unlock_irqrestore(&mfc_sched_lock, flags);
+}
+
+/* The instance has no command left: its last ioctl has returned */
+void mfc_sched_exit_inst(struct mfc_sched_inst *inst)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&mfc_sched_lock, flags);
+	WARN_ON(!list_empty(&inst->cmds));
+	if (inst->slot >= 0 && inst->slot < MFC_MAX_INSTANCE_NUM &&
+	    mfc_sched_slots[inst->slot] == inst)
+		mfc_sched_slots[inst->slot] = NULL;
+	spin_unlock_irqrestore(&mfc_sched_lock, flags);
+}
+
+/* Grant the codec to the first command of the next instance in turn */
+static void mfc_sched_dispatch(void)
+{
+	struct mfc_sched_inst *inst;
+	struct mfc_sched_cmd *cmd;
+	struct task_struct *task;
+
+	if (mfc_hw_busy || list_empty(&mfc_run_list))
+		return;
+
+	inst = list_first_entry(&mfc_run_list, struct mfc_sched_inst, run_node);
+	cmd = list_first_entry(&inst->cmds, struct mfc_sched_cmd, node);
+
+	list_del_init(&cmd->node);
+	list_del_init(&inst->run_node);
+	if (!list_empty(&inst->cmds))
+		list_add_tail(&inst->run_node, &mfc_run_list);
+
+	mfc_hw_busy = true;
+	cmd->started = ktime_get();
+
+	/* cmd lives on the waiter's stack: done with it once granted */
+	task = cmd->task;
+	smp_wmb();
+	cmd->granted = true;
+	wake_up_process(task);
+}
+
+/* Queue cmd on inst and sleep until the codec is ours */
+void mfc_sched_get(struct mfc_sched_inst *inst, struct mfc_sched_cmd *cmd)
+{
+	unsigned long flags;
+
+	cmd->task = current;
+	cmd->granted = false;
+	cmd->queued = ktime_get();
+
+	spin_lock_irqsave(&mfc_sched_lock, flags);
+	list_add_tail(&cmd->node, &inst->cmds);
+	if (list_empty(&inst->run_node))
+		list_add_tail(&inst->run_node, &mfc_run_list);
+	mfc_sched_dispatch();
+	spin_unlock_irqrestore(&mfc_sched_lock, flags);
+
+	for (;;) {
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		if (cmd->granted)
+			break;
+		schedule();
+	}
+	__set_current_state(TASK_RUNNING);
+}
+
+static void mfc_sched_account(struct mfc_sched_stats *stats,
+			      struct mfc_sched_cmd *cmd, ktime_t now)
+{
+	u64 wait = ktime_to_ns(ktime_sub(cmd->started, cmd->queued));
+	u64 run = ktime_to_ns(ktime_sub(now, cmd->started));
+
+	stats->frames++;
+	stats->wait_ns += wait;
+	stats->run_ns += run;
+	if (wait > stats->wait_max_ns)
+		stats->wait_max_ns = wait;
+	if (run > stats->run_max_ns)
+		stats->run_max_ns = run;
+}
+
+/* The result of cmd has been read back: hand the codec on */
+void mfc_sched_put(struct mfc_sched_inst *inst, struct mfc_sched_cmd *cmd)
+{
+	ktime_t now = ktime_get();
+	unsigned long flags;
+
+	spin_lock_irqsave(&mfc_sched_lock, flags);
+	mfc_sched_account(&inst->stats, cmd, now);
+	mfc_hw_busy = false;
+	mfc_sched_dispatch();
+	spin_unlock_irqrestore(&mfc_sched_lock, flags);
+}
+
+void mfc_hw_lock(void)
+{
+	mfc_sched_get(&mfc_sys_inst, &mfc_sys_cmd);
+}
+
+void mfc_hw_unlock(void)
+{
+	mfc_sched_put(&mfc_sys_inst, &mfc_sys_cmd);
+}
+
+static unsigned long mfc_sched_avg_us(u64 total_ns, unsigned int frames)
+{
+	if (!frames)
+		return 0;
+
+	do_div(total_ns, frames);
+	do_div(total_ns, NSEC_PER_USEC);
+	return (unsigned long)total_ns;
+}
+
+static unsigned long mfc_sched_us(u64 ns)
+{
+	do_div(ns, NSEC_PER_USEC);
+	return (unsigned long)ns;
+}
+
+static int mfc_sched_print(char *buf, int len, const char *name,
+			   const struct mfc_sched_stats *s)
+{
+	return len + scnprintf(buf + len, PAGE_SIZE - len,
+			"%-4s %8u %8lu %8lu %8lu %8lu\n", name, s->frames,
+			mfc_sched_avg_us(s->wait_ns, s->frames),
+			mfc_sched_us(s->wait_max_ns),
+			mfc_sched_avg_us(s->run_ns, s->frames),
+			mfc_sched_us(s->run_max_ns));
+}
+
+static ssize_t mfc_sched_stats_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct mfc_sched_stats stats;
+	unsigned long flags;
+	char name[8];
+	int len, i;
+
+	len = scnprintf(buf, PAGE_SIZE,
+			"inst   frames  wait_us  wait_max  run_us  run_max\n");
+
+	for (i = 0; i < MFC_MAX_INSTANCE_NUM; i++) {
+		spin_lock_irqsave(&mfc_sched_lock, flags);
+		if (!mfc_sched_slots[i]) {
+			spin_unlock_irqrestore(&mfc_sched_lock, flags);
+			continue;
+		}
+		stats = mfc_sched_slots[i]->stats;
+		spin_unlock_irqrestore(&mfc_sched_lock, flags);
+
+		snprintf(name, sizeof(name), "%d", i);
+		len = mfc_sched_print(buf, len, name, &stats);
+	}
+
+	spin_lock_irqsave(&mfc_sched_lock, flags);
+	stats = mfc_sys_inst.stats;
+	spin_unlock_irqrestore(&mfc_sched_lock, flags);
+
+	return mfc_sched_print(buf, len, "sys", &stats);
+}
+
+/* Any write clears the statistics of the open instances */
+static ssize_t mfc_sched_stats_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&mfc_sched_lock, flags);
+	for (i = 0; i < MFC_MAX_INSTANCE_NUM; i++) {
+		if (mfc_sched_slots[i])
+			memset(&mfc_sched_slots[i]->stats, 0,
+			       sizeof(struct mfc_sched_stats));
+	}
+	memset(&mfc_sys_inst.stats, 0, sizeof(struct mfc_sched_stats));
+	spin_unlock_irqrestore(&mfc_sched_lock, flags);
+
+	return count;
+}
+
+static DEVICE_ATTR(sched_stats, S_IRUGO | S_IWUSR,
+		   mfc_sched_stats_show, mfc_sched_stats_store);
+
+int mfc_sched_create_sysfs(struct device *dev)
+{
+	return device_create_file(dev, &dev_attr_sched_stats);
+}
+
+void mfc_sched_remove_sysfs(struct device *dev)
+{
+	device_remove_file(dev, &dev_attr_sched_stats);
+}
@@ -0,0 +1,63 @@
+/*
+ * drivers/media/video/samsung/mfc50/mfc_sched.h
+ *
+ * Header file for Samsung MFC (Multi Function Codec - FIMV) driver
+ *
+ * Hardware scheduler shared by the open MFC instances.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _MFC_SCHED_H_
+#define _MFC_SCHED_H_
+
+#include <linux/ktime.h>
+#include <linux/list.h>
+#include <linux/types.h>
+
+struct task_struct;
+struct device;
+
+/* One command waiting for, or running on, the codec */
+struct mfc_sched_cmd {
+	struct list_head node;
+	struct task_struct *task;
+	bool granted;
+	ktime_t queued;
+	ktime_t started;
+};
+
+struct mfc_sched_stats {
+	unsigned int frames;
+	u64 wait_ns;		/* queued until the codec was granted */
+	u64 wait_max_ns;
+	u64 run_ns;		/* codec owned until the result was read */
+	u64 run_max_ns;
+};
+
+/*
+ * Per instance frame queue. An instance with queued commands sits on
+ * the run list; the codec is handed to the instance at its head, which
+ * then goes to the tail, so sessions get the codec one frame each.
+ */
+struct mfc_sched_inst {
+	struct list_head run_node;
+	struct list_head cmds;
+	int slot;
+	struct mfc_sched_stats stats;
+};
+
+void mfc_sched_init_inst(struct mfc_sched_inst *inst, int slot);
+void mfc_sched_exit_inst(struct mfc_sched_inst *inst);
+void mfc_sched_get(struct mfc_sched_inst *inst, struct mfc_sched_cmd *cmd);
+void mfc_sched_put(struct mfc_sched_inst *inst, struct mfc_sched_cmd *cmd);
+
+/* Commands outside of a frame run, called with mfc_mutex held */
+void mfc_hw_lock(void);
+void mfc_hw_unlock(void);
+
+int mfc_sched_create_sysfs(struct device *dev);
+void mfc_sched_remove_sysfs(struct device *dev);
+#endif
@@ -417,7 +417,7 @@ static void __exit s5p_cec_exit(void)
 
 }
 
-module_init(s5p_cec_init);
+deferred_initcall(s5p_cec_init);
 module_exit(s5p_cec_exit);
 
 MODULE_AUTHOR("SangPil Moon");
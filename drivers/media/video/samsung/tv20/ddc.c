@@ -127,7 +127,7 @@ MODULE_DESCRIPTION("Driver for SMDKV210 I2C DDC devices");
 
 MODULE_LICENSE("GPL");
 
-module_init(ddc_init);
+deferred_initcall(ddc_init);
 module_exit(ddc_exit);
 
 
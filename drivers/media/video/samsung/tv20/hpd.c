@@ -388,7 +388,7 @@ static void __exit s5p_hpd_exit(void)
 	misc_deregister(&hpd_misc_device);
 }
 
-module_init(s5p_hpd_init);
+deferred_initcall(s5p_hpd_init);
 module_exit(s5p_hpd_exit);
 
 
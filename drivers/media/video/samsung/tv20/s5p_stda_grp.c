@@ -17,6 +17,9 @@
 #include <linux/dma-mapping.h>
 #include <linux/io.h>
 #include <linux/uaccess.h>
+#include <linux/notifier.h>
+
+#include <plat/fb.h>
 
 #include "s5p_tv.h"
 
@@ -197,49 +200,30 @@ int s5ptvfb_window_off(struct s5p_tv_status *ctrl, int id)
 
 int s5ptvfb_set_window_control(struct s5p_tv_status *ctrl, int id) { return 0; }
 int s5ptvfb_set_alpha_blending(struct s5p_tv_status *ctrl, int id) { return 0; }
-int s5ptvfb_set_window_position(struct s5p_tv_status *ctrl, int id)
+static void s5ptvfb_get_tv_size(struct s5p_tv_status *ctrl,
+				u32 *w_t, u32 *h_t)
 {
-	u32 off_x, off_y;
-	u32 w_t, h_t;
-	u32 w, h;
-
-	struct fb_var_screeninfo *var = &ctrl->fb->var;
-	struct s5ptvfb_window *win = ctrl->fb->par;
-
-	off_x = (u32)win->x;
-	off_y = (u32)win->y;
-
-	w = var->xres;
-	h = var->yres;
-
-	/*
-	 * When tvout resolution was overscanned, there is no
-	 * adjust method in H/W. So, framebuffer should be resized.
-	 * In this case - TV w/h is greater than FB w/h, grp layer's
-	 * dst offset must be changed to fix tv screen.
-	 */
-
 	switch (ctrl->tvout_param.disp_mode) {
 
 	case TVOUT_NTSC_M:
 	case TVOUT_480P_60_16_9:
 	case TVOUT_480P_60_4_3:
 	case TVOUT_480P_59:
-		w_t = 720;
-		h_t = 480;
+		*w_t = 720;
+		*h_t = 480;
 		break;
 
 	case TVOUT_576P_50_16_9:
 	case TVOUT_576P_50_4_3:
-		w_t = 720;
-		h_t = 576;
+		*w_t = 720;
+		*h_t = 576;
 		break;
 
 	case TVOUT_720P_60:
 	case TVOUT_720P_59:
 	case TVOUT_720P_50:
-		w_t = 1280;
-		h_t = 720;
+		*w_t = 1280;
+		*h_t = 720;
 		break;
 
 	case TVOUT_1080I_60:
@@ -249,15 +233,39 @@ int s5ptvfb_set_window_position(struct s5p_tv_status *ctrl, int id)
 	case TVOUT_1080P_59:
 	case TVOUT_1080P_50:
 	case TVOUT_1080P_30:
-		w_t = 1920;
-		h_t = 1080;
+		*w_t = 1920;
+		*h_t = 1080;
 		break;
 
 	default:
-		w_t = 0;
-		h_t = 0;
+		*w_t = 0;
+		*h_t = 0;
 		break;
 	}
+}
+
+int s5ptvfb_set_window_position(struct s5p_tv_status *ctrl, int id)
+{
+	u32 off_x, off_y;
+	u32 w_t, h_t;
+	u32 w, h;
+
+	struct fb_var_screeninfo *var = &ctrl->fb->var;
+	struct s5ptvfb_window *win = ctrl->fb->par;
+
+	off_x = (u32)win->x;
+	off_y = (u32)win->y;
+
+	w = var->xres;
+	h = var->yres;
+
+	/*
+	 * When tvout resolution was overscanned, there is no
+	 * adjust method in H/W. So, framebuffer should be resized.
+	 * In this case - TV w/h is greater than FB w/h, grp layer's
+	 * dst offset must be changed to fix tv screen.
+	 */
+	s5ptvfb_get_tv_size(ctrl, &w_t, &h_t);
 
 	if (w_t > w)
 		off_x = (w_t - w) / 2;
@@ -675,6 +683,88 @@ int s5ptvfb_check_var(struct fb_var_screeninfo *var, struct fb_info *fb)
 	return 0;
 }
 
+#ifdef CONFIG_FB_S3C
+/* Follow the pans of the mirrored window, from its interrupt as well */
+static int s5ptvfb_mirror_notify(struct notifier_block *nb,
+				 unsigned long id, void *data)
+{
+	struct s3cfb_scanout *scanout = data;
+
+	if (scanout->fb == s5ptv_status.mirror_fb)
+		__s5p_vm_set_grp_base_address(VM_GPR0_LAYER, scanout->start);
+
+	return NOTIFY_OK;
+}
+
+static void s5ptvfb_stop_mirror(void)
+{
+	if (!s5ptv_status.mirror_fb)
+		return;
+
+	s3cfb_unregister_scanout_notifier(&s5ptv_status.mirror_nb);
+	s5ptv_status.mirror_fb = NULL;
+
+	/* back to our own frame buffer */
+	s5ptvfb_set_par(s5ptv_status.fb);
+}
+
+/*
+ * Let the grp layer scan out an LCD frame buffer in place of ours, so
+ * the UI is shown on TV without copying it every frame. The LCD window
+ * is not scaled, only centered.
+ */
+static int s5ptvfb_start_mirror(unsigned int id)
+{
+	struct fb_info *fb;
+	struct fb_var_screeninfo *var;
+	enum s5p_tv_vmx_color_fmt color;
+	unsigned long flags;
+	u32 w_t, h_t;
+
+	if (id >= FB_MAX || !registered_fb[id] ||
+	    registered_fb[id] == s5ptv_status.fb)
+		return -EINVAL;
+
+	fb = registered_fb[id];
+	var = &fb->var;
+
+	if (var->bits_per_pixel == 32)
+		color = VM_DIRECT_RGB8888;
+	else if (var->bits_per_pixel == 16)
+		color = VM_DIRECT_RGB565;
+	else
+		return -EINVAL;
+
+	s5ptvfb_get_tv_size(&s5ptv_status, &w_t, &h_t);
+	if (var->xres > w_t || var->yres > h_t)
+		return -EINVAL;
+
+	s5ptvfb_stop_mirror();
+
+	__s5p_vm_set_ctrl(VM_GPR0_LAYER, false, false, false, false,
+		color, 0, 0);
+	__s5p_vm_set_grp_layer_size(VM_GPR0_LAYER, var->xres_virtual,
+		var->xres, var->yres, 0, 0);
+	__s5p_vm_set_grp_layer_position(VM_GPR0_LAYER,
+		(w_t - var->xres) / 2, (h_t - var->yres) / 2);
+
+	s5ptv_status.mirror_fb = fb;
+	s5ptv_status.mirror_nb.notifier_call = s5ptvfb_mirror_notify;
+	s3cfb_register_scanout_notifier(&s5ptv_status.mirror_nb);
+
+	/* a pan from the LCD interrupt must not be overwritten */
+	local_irq_save(flags);
+	__s5p_vm_set_grp_base_address(VM_GPR0_LAYER, fb->fix.smem_start +
+		fb->fix.line_length * var->yoffset);
+	local_irq_restore(flags);
+
+	return 0;
+}
+#else
+static void s5ptvfb_stop_mirror(void) { }
+static int s5ptvfb_start_mirror(unsigned int id) { return -ENODEV; }
+#endif
+
 static int s5ptvfb_release(struct fb_info *fb, int user)
 {
 /*
@@ -685,6 +775,7 @@ static int s5ptvfb_release(struct fb_info *fb, int user)
 	int ret;
 	struct s5ptvfb_window *win = fb->par;
 
+	s5ptvfb_stop_mirror();
 	s5ptvfb_release_window(fb);
 
 /*
@@ -846,6 +937,13 @@ static int s5ptvfb_ioctl(struct fb_info *fb, unsigned int cmd,
 #endif
 		break;
 
+	case S5PTVFB_SET_MIRROR:
+		if ((int)arg < 0) {
+			s5ptvfb_stop_mirror();
+			break;
+		}
+
+		return s5ptvfb_start_mirror(arg);
 	}
 
 	return 0;
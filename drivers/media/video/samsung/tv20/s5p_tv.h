@@ -583,6 +583,10 @@ struct s5p_tv_status {
 
 	struct s5ptvfb_lcd *lcd;
 	struct mutex fb_lock;
+
+	/* LCD frame buffer scanned out by the grp layer, S5PTVFB_SET_MIRROR */
+	struct fb_info *mirror_fb;
+	struct notifier_block mirror_nb;
 };
 
 /* F R A M E  B U F F E R */
@@ -1072,6 +1076,7 @@ extern void s5p_handle_cable(void);
 #define S5PTVFB_WIN_SET_ADDR	_IOW('F', 219, u32)
 #define S5PTVFB_SET_WIN_ON	_IOW('F', 220, u32)
 #define S5PTVFB_SET_WIN_OFF	_IOW('F', 221, u32)
+#define S5PTVFB_SET_MIRROR	_IOW('F', 222, u32)	/* fb index, -1: off */
 
 extern int s5p_tv_clk_gate(bool on);
 extern int s5p_hdcp_is_reset(void);
@@ -94,6 +94,7 @@ Disclaimer
 #include <linux/i2c-algo-bit.h>
 #include <linux/wakelock.h>
 #include <linux/input.h>
+#include <linux/sensor_batch.h>
 
 #include <linux/i2c/bma222.h>
 #include <linux/i2c/bma023_dev.h>
@@ -126,6 +127,11 @@ static struct i2c_client *bma_client = NULL;
 static char			sensor_type = -1;		
 struct class *acc_class;
 static int 			calibration = 0 ;
+
+/* about 1.6s of samples at the default 50ms poll */
+#define BMA_BATCH_SIZE		32
+static const unsigned int bma_batch_codes[] = { REL_X, REL_Y, REL_Z };
+static struct sensor_batch bma_batch;
 struct bma_data {
 	struct work_struct work_acc;
 	struct hrtimer timer;
@@ -905,6 +911,7 @@ static void bma_acc_disable(void)
 	printk("cancelling poll timer\n");
 	hrtimer_cancel(&g_bma222->timer);
 	cancel_work_sync(&g_bma222->work_acc);
+	sensor_batch_flush(&bma_batch);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -939,6 +946,26 @@ static ssize_t poll_delay_store(struct device *dev,struct device_attribute *attr
 	return size;
 }
 
+static ssize_t max_latency_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n", bma_batch.max_latency_ns);
+}
+
+/* Longest a sample may be held back, in ns; 0 reports each one at once */
+static ssize_t max_latency_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size)
+{
+	unsigned long long ns;
+	int err;
+
+	err = strict_strtoull(buf, 10, &ns);
+	if (err < 0)
+		return err;
+
+	sensor_batch_set_latency(&bma_batch, ns);
+
+	return size;
+}
+
 static ssize_t acc_enable_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
 	return sprintf(buf, "%d\n", (g_bma222->state & ACC_ENABLED) ? 1 : 0);
@@ -974,6 +1001,9 @@ static ssize_t acc_enable_store(struct device *dev,struct device_attribute *attr
 static DEVICE_ATTR(poll_delay, S_IRUGO | S_IWUSR | S_IWGRP,
 		   poll_delay_show, poll_delay_store);
 
+static DEVICE_ATTR(max_latency, S_IRUGO | S_IWUSR | S_IWGRP,
+		   max_latency_show, max_latency_store);
+
 static struct device_attribute dev_attr_acc_enable =
 	__ATTR(enable, S_IRUGO | S_IWUSR | S_IWGRP,
 	       acc_enable_show, acc_enable_store);
@@ -981,6 +1011,7 @@ static struct device_attribute dev_attr_acc_enable =
 static struct attribute *acc_sysfs_attrs[] = {
 	&dev_attr_acc_enable.attr,
 	&dev_attr_poll_delay.attr,
+	&dev_attr_max_latency.attr,
 	NULL
 };
 
@@ -992,6 +1023,7 @@ static struct attribute_group acc_attribute_group = {
 static void bma_work_func_acc(struct work_struct *work)
 {
 	bma222acc_t acc,read_acc;
+	int val[3];
 	int err;
 		
 	err = bma222_read_accel_xyz(&read_acc);
@@ -1008,10 +1040,10 @@ static void bma_work_func_acc(struct work_struct *work)
 	
 //	printk("##### %d,  %d,  %d\n", acc.x, acc.y, acc.z );
 
-	input_report_rel(g_bma222->acc_input_dev, REL_X, acc.x);
-	input_report_rel(g_bma222->acc_input_dev, REL_Y, acc.y);
-	input_report_rel(g_bma222->acc_input_dev, REL_Z, acc.z);
-	input_sync(g_bma222->acc_input_dev);
+	val[0] = acc.x;
+	val[1] = acc.y;
+	val[2] = acc.z;
+	sensor_batch_add(&bma_batch, val, ktime_get());
 }
 
 /* This function is for light sensor.  It operates every a few seconds.
@@ -1152,10 +1184,18 @@ static int bma_probe(struct i2c_client *client,
 	input_set_capability(input_dev, EV_REL, REL_Z);
 	input_set_abs_params(input_dev, REL_Z, -256, 256, 0, 0);
 
+	err = sensor_batch_init(&bma_batch, input_dev, EV_REL, bma_batch_codes,
+				ARRAY_SIZE(bma_batch_codes), BMA_BATCH_SIZE);
+	if (err < 0) {
+		input_free_device(input_dev);
+		goto err_input_allocate_device_light;
+	}
+
 	printk("registering lightsensor-level input device\n");
 	err = input_register_device(input_dev);
 	if (err < 0) {
 		printk("%s: could not register input device\n", __func__);
+		sensor_batch_free(&bma_batch);
 		input_free_device(input_dev);
 		goto err_input_register_device_light;
 	}
@@ -1220,6 +1260,7 @@ static int bma_probe(struct i2c_client *client,
 
 error_device:
 	sysfs_remove_group(&client->dev.kobj, &acc_attribute_group);
+	sensor_batch_free(&bma_batch);
 err_input_register_device_light:
 	input_unregister_device(g_bma222->acc_input_dev);
 err_input_allocate_device_light:	
@@ -1244,6 +1285,7 @@ static int bma_remove(struct i2c_client *client)
 	}
 	sysfs_remove_group(&g_bma222->acc_input_dev->dev.kobj, &acc_attribute_group);
 	input_unregister_device(g_bma222->acc_input_dev);
+	sensor_batch_free(&bma_batch);
 
 	destroy_workqueue(g_bma222->wq);
 	mutex_destroy(&g_bma222->power_lock);
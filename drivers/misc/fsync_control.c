@@ -11,14 +11,80 @@
 #include <linux/device.h>
 #include <linux/miscdevice.h>
 #include <linux/fs.h>
+#include <linux/earlysuspend.h>
+#include <linux/fsync_control.h>
+#include <linux/notifier.h>
+#include <linux/reboot.h>
+#include <linux/syscalls.h>
+#include <linux/workqueue.h>
+
+#define FSYNCCONTROL_VERSION 2
+
+/*
+ * fsync_enabled modes:
+ * 0: fsync() and fdatasync() do nothing
+ * 1: they work as usual
+ * 2: dynamic, while the screen is on they only start the writeback of the
+ *    file, and a full sync follows within dynamic_window_ms. The screen
+ *    turning off, a reboot or a panic run that sync right away.
+ */
+enum
+    {
+	FSYNC_DISABLED,
+	FSYNC_ENABLED,
+	FSYNC_DYNAMIC,
+    };
+
+static unsigned int fsync_mode = FSYNC_ENABLED;
+static unsigned int dynamic_window_ms = 2000;
+static bool screen_on = true;
+static unsigned long fsync_deferred;
+
+static void fsynccontrol_sync_fn(struct work_struct *work)
+{
+    sys_sync();
+}
+
+static DECLARE_DELAYED_WORK(fsynccontrol_sync_work, fsynccontrol_sync_fn);
+
+/* Run the pending sync, if any, and wait for it */
+static void fsynccontrol_sync_now(void)
+{
+    flush_delayed_work(&fsynccontrol_sync_work);
+}
+
+/*
+ * Called by fsync() and fdatasync() before syncing file. Returns true
+ * when the sync is to be skipped.
+ */
+bool fsynccontrol_skip_fsync(struct file *file)
+{
+    if (!file->f_op || !file->f_op->fsync)
+	return false;
+
+    switch (ACCESS_ONCE(fsync_mode))
+	{
+	case FSYNC_DISABLED:
+	    return true;
+
+	case FSYNC_DYNAMIC:
+	    if (!ACCESS_ONCE(screen_on))
+		return false;
 
-#define FSYNCCONTROL_VERSION 1
+	    filemap_flush(file->f_mapping);
+	    schedule_delayed_work(&fsynccontrol_sync_work,
+				  msecs_to_jiffies(dynamic_window_ms));
+	    fsync_deferred++;
+	    return true;
 
-bool fsynccontrol_fsync_enabled = false;
+	default:
+	    return false;
+	}
+}
 
 static ssize_t fsynccontrol_status_read(struct device * dev, struct device_attribute * attr, char * buf)
 {
-    return sprintf(buf, "%u\n", (fsynccontrol_fsync_enabled ? 1 : 0));
+    return sprintf(buf, "%u\n", fsync_mode);
 }
 
 static ssize_t fsynccontrol_status_write(struct device * dev, struct device_attribute * attr, const char * buf, size_t size)
@@ -27,18 +93,15 @@ static ssize_t fsynccontrol_status_write(struct device * dev, struct device_attr
 
     if(sscanf(buf, "%u\n", &data) == 1) 
 	{
-	    if (data == 1) 
+	    if (data <= FSYNC_DYNAMIC) 
 		{
-		    pr_info("%s: FSYNCCONTROL fsync enabled\n", __FUNCTION__);
+		    pr_info("%s: FSYNCCONTROL fsync mode %u\n", __FUNCTION__, data);
 
-		    fsynccontrol_fsync_enabled = true;
+		    fsync_mode = data;
 
-		} 
-	    else if (data == 0) 
-		{
-		    pr_info("%s: FSYNCCONTROL fsync disabled\n", __FUNCTION__);
-
-		    fsynccontrol_fsync_enabled = false;
+		    /* Deferred syncs do not wait for the window any more */
+		    if (data != FSYNC_DYNAMIC)
+			fsynccontrol_sync_now();
 		} 
 	    else 
 		{
@@ -53,17 +116,43 @@ static ssize_t fsynccontrol_status_write(struct device * dev, struct device_attr
     return size;
 }
 
+static ssize_t fsynccontrol_window_read(struct device * dev, struct device_attribute * attr, char * buf)
+{
+    return sprintf(buf, "%u\n", dynamic_window_ms);
+}
+
+static ssize_t fsynccontrol_window_write(struct device * dev, struct device_attribute * attr, const char * buf, size_t size)
+{
+    unsigned int data;
+
+    if (sscanf(buf, "%u\n", &data) == 1 && data > 0)
+	dynamic_window_ms = data;
+    else
+	pr_info("%s: invalid input\n", __FUNCTION__);
+
+    return size;
+}
+
+static ssize_t fsynccontrol_deferred_read(struct device * dev, struct device_attribute * attr, char * buf)
+{
+    return sprintf(buf, "%lu\n", fsync_deferred);
+}
+
 static ssize_t fsynccontrol_version(struct device * dev, struct device_attribute * attr, char * buf)
 {
     return sprintf(buf, "%u\n", FSYNCCONTROL_VERSION);
 }
 
 static DEVICE_ATTR(fsync_enabled, S_IRUGO | S_IWUGO, fsynccontrol_status_read, fsynccontrol_status_write);
+static DEVICE_ATTR(dynamic_window_ms, S_IRUGO | S_IWUSR, fsynccontrol_window_read, fsynccontrol_window_write);
+static DEVICE_ATTR(fsync_deferred, S_IRUGO, fsynccontrol_deferred_read, NULL);
 static DEVICE_ATTR(version, S_IRUGO , fsynccontrol_version, NULL);
 
 static struct attribute *fsynccontrol_attributes[] = 
     {
 	&dev_attr_fsync_enabled.attr,
+	&dev_attr_dynamic_window_ms.attr,
+	&dev_attr_fsync_deferred.attr,
 	&dev_attr_version.attr,
 	NULL
     };
@@ -79,6 +168,51 @@ static struct miscdevice fsynccontrol_device =
 	.name = "fsynccontrol",
     };
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void fsynccontrol_early_suspend(struct early_suspend *h)
+{
+    screen_on = false;
+    fsynccontrol_sync_now();
+}
+
+static void fsynccontrol_late_resume(struct early_suspend *h)
+{
+    screen_on = true;
+}
+
+static struct early_suspend fsynccontrol_early_suspend_handler = 
+    {
+	.suspend = fsynccontrol_early_suspend,
+	.resume = fsynccontrol_late_resume,
+    };
+#endif
+
+static int fsynccontrol_reboot_notify(struct notifier_block *nb, unsigned long event, void *unused)
+{
+    fsynccontrol_sync_now();
+
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block fsynccontrol_reboot_nb = 
+    {
+	.notifier_call = fsynccontrol_reboot_notify,
+    };
+
+/* Best effort: the emergency sync only runs if the panic lets it */
+static int fsynccontrol_panic_notify(struct notifier_block *nb, unsigned long event, void *unused)
+{
+    if (delayed_work_pending(&fsynccontrol_sync_work))
+	emergency_sync();
+
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block fsynccontrol_panic_nb = 
+    {
+	.notifier_call = fsynccontrol_panic_notify,
+    };
+
 static int __init fsynccontrol_init(void)
 {
     int ret;
@@ -99,6 +233,12 @@ static int __init fsynccontrol_init(void)
 	    pr_err("Failed to create sysfs group for device (%s)!\n", fsynccontrol_device.name);
 	}
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+    register_early_suspend(&fsynccontrol_early_suspend_handler);
+#endif
+    register_reboot_notifier(&fsynccontrol_reboot_nb);
+    atomic_notifier_chain_register(&panic_notifier_list, &fsynccontrol_panic_nb);
+
     return 0;
 }
 
@@ -0,0 +1,287 @@
+/*
+ * drivers/misc/perf_sampler.c
+ *
+ * Always-on, low rate sampling of the CPU cycle and cache miss counters.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Each online CPU gets two kernel counters, one overflowing every
+ * cycle_period cycles and one every miss_period cache misses. The overflow
+ * handler, in the PMU interrupt, appends the interrupted pc, the task and
+ * a timestamp to a ring in memory; nothing else is collected, so the cost
+ * is a few hundred cycles per sample. A daemon reads the records from
+ * /dev/perf_sampler and resolves the addresses itself, against
+ * /proc/kallsyms and the maps of the sampled processes.
+ *
+ * The ring overwrites nothing: samples taken while it is full are counted
+ * in dropped and lost. Sampling is started and stopped through enabled.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/cpu.h>
+#include <linux/miscdevice.h>
+#include <linux/perf_event.h>
+#include <linux/perf_sampler.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/wait.h>
+
+/* Records, a power of two */
+#define PS_RING_SIZE	4096
+
+/* Records copied out per pass of read() */
+#define PS_READ_BATCH	16
+
+static unsigned long ps_cycle_period = 20000000;
+module_param_named(cycle_period, ps_cycle_period, ulong, 0644);
+MODULE_PARM_DESC(cycle_period, "Cycles between samples, read when enabled");
+
+static unsigned long ps_miss_period = 200000;
+module_param_named(miss_period, ps_miss_period, ulong, 0644);
+MODULE_PARM_DESC(miss_period, "Cache misses between samples, 0 for none");
+
+static unsigned long ps_dropped;
+module_param_named(dropped, ps_dropped, ulong, 0444);
+
+static struct perf_sampler_record *ps_ring;
+static unsigned int ps_head, ps_tail;
+static DEFINE_SPINLOCK(ps_lock);
+static DECLARE_WAIT_QUEUE_HEAD(ps_wait);
+
+static DEFINE_MUTEX(ps_mutex);
+static bool ps_enabled;
+
+static DEFINE_PER_CPU(struct perf_event *, ps_cycles_event);
+static DEFINE_PER_CPU(struct perf_event *, ps_misses_event);
+
+static unsigned int ps_count(void)
+{
+	return ps_head - ps_tail;
+}
+
+static void ps_overflow(struct perf_event *event, int nmi,
+			struct perf_sample_data *data, struct pt_regs *regs)
+{
+	struct perf_sampler_record *r;
+	unsigned long flags;
+	bool wake;
+
+	spin_lock_irqsave(&ps_lock, flags);
+
+	if (ps_count() == PS_RING_SIZE) {
+		ps_dropped++;
+		spin_unlock_irqrestore(&ps_lock, flags);
+		return;
+	}
+
+	r = &ps_ring[ps_head & (PS_RING_SIZE - 1)];
+	r->time = local_clock();
+	r->ip = instruction_pointer(regs);
+	r->pid = current->pid;
+	r->tgid = current->tgid;
+	r->event = event->attr.config == PERF_COUNT_HW_CPU_CYCLES ?
+		   PERF_SAMPLER_CYCLES : PERF_SAMPLER_CACHE_MISSES;
+	r->flags = user_mode(regs) ? PERF_SAMPLER_USER : 0;
+	r->cpu = smp_processor_id();
+	ps_head++;
+
+	/* wake the reader once per quarter ring, not per sample */
+	wake = ps_count() == PS_RING_SIZE / 4;
+
+	spin_unlock_irqrestore(&ps_lock, flags);
+
+	if (wake)
+		wake_up_interruptible(&ps_wait);
+}
+
+static struct perf_event *ps_create(int cpu, u64 config, u64 period)
+{
+	struct perf_event_attr attr = {
+		.type		= PERF_TYPE_HARDWARE,
+		.config		= config,
+		.size		= sizeof(struct perf_event_attr),
+		.sample_period	= period,
+	};
+	struct perf_event *event;
+
+	event = perf_event_create_kernel_counter(&attr, cpu, NULL, ps_overflow);
+	if (IS_ERR(event)) {
+		pr_warn("perf_sampler: no counter for event %llu on cpu%d: %ld\n",
+			config, cpu, PTR_ERR(event));
+		return NULL;
+	}
+
+	return event;
+}
+
+static void ps_release(struct perf_event **eventp)
+{
+	if (*eventp) {
+		perf_event_release_kernel(*eventp);
+		*eventp = NULL;
+	}
+}
+
+static void ps_stop(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		ps_release(&per_cpu(ps_cycles_event, cpu));
+		ps_release(&per_cpu(ps_misses_event, cpu));
+	}
+}
+
+/* Counters are set up on the CPUs online now */
+static int ps_start(void)
+{
+	int cpu, started = 0;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		if (ps_cycle_period) {
+			per_cpu(ps_cycles_event, cpu) = ps_create(cpu,
+					PERF_COUNT_HW_CPU_CYCLES,
+					ps_cycle_period);
+			started += !!per_cpu(ps_cycles_event, cpu);
+		}
+		if (ps_miss_period) {
+			per_cpu(ps_misses_event, cpu) = ps_create(cpu,
+					PERF_COUNT_HW_CACHE_MISSES,
+					ps_miss_period);
+			started += !!per_cpu(ps_misses_event, cpu);
+		}
+	}
+	put_online_cpus();
+
+	return started ? 0 : -ENODEV;
+}
+
+static int ps_set_enabled(const char *val, const struct kernel_param *kp)
+{
+	bool enabled = ps_enabled;
+	struct kernel_param dummy = { .arg = &enabled };
+	int err;
+
+	err = param_set_bool(val, &dummy);
+	if (err)
+		return err;
+
+	/* on the command line: perf_sampler_init() starts it */
+	if (!ps_ring) {
+		ps_enabled = enabled;
+		return 0;
+	}
+
+	mutex_lock(&ps_mutex);
+	if (enabled && !ps_enabled) {
+		err = ps_start();
+		if (err)
+			ps_stop();
+		else
+			ps_enabled = true;
+	} else if (!enabled && ps_enabled) {
+		ps_stop();
+		ps_enabled = false;
+	}
+	mutex_unlock(&ps_mutex);
+
+	return err;
+}
+
+static struct kernel_param_ops ps_enabled_ops = {
+	.set = ps_set_enabled,
+	.get = param_get_bool,
+};
+
+module_param_cb(enabled, &ps_enabled_ops, &ps_enabled, 0644);
+MODULE_PARM_DESC(enabled, "Sample while set");
+
+static ssize_t ps_read(struct file *file, char __user *buf, size_t count,
+		       loff_t *ppos)
+{
+	struct perf_sampler_record batch[PS_READ_BATCH];
+	size_t done = 0;
+	unsigned int i, n;
+	int err;
+
+	if (count < sizeof(batch[0]))
+		return -EINVAL;
+
+	if (!(file->f_flags & O_NONBLOCK)) {
+		err = wait_event_interruptible(ps_wait, ps_count());
+		if (err)
+			return err;
+	}
+
+	while (count - done >= sizeof(batch[0])) {
+		spin_lock_irq(&ps_lock);
+		n = min_t(unsigned int, ps_count(), PS_READ_BATCH);
+		n = min_t(unsigned int, n, (count - done) / sizeof(batch[0]));
+		for (i = 0; i < n; i++)
+			batch[i] = ps_ring[(ps_tail + i) & (PS_RING_SIZE - 1)];
+		ps_tail += n;
+		spin_unlock_irq(&ps_lock);
+
+		if (!n)
+			break;
+		if (copy_to_user(buf + done, batch, n * sizeof(batch[0])))
+			return done ? done : -EFAULT;
+		done += n * sizeof(batch[0]);
+	}
+
+	return done ? done : -EAGAIN;
+}
+
+static unsigned int ps_poll(struct file *file, poll_table *wait)
+{
+	poll_wait(file, &ps_wait, wait);
+
+	return ps_count() ? POLLIN | POLLRDNORM : 0;
+}
+
+static const struct file_operations ps_fops = {
+	.owner		= THIS_MODULE,
+	.read		= ps_read,
+	.poll		= ps_poll,
+	.llseek		= noop_llseek,
+};
+
+static struct miscdevice ps_device = {
+	.minor	= MISC_DYNAMIC_MINOR,
+	.name	= "perf_sampler",
+	.fops	= &ps_fops,
+};
+
+static int __init perf_sampler_init(void)
+{
+	int err;
+
+	ps_ring = vmalloc(PS_RING_SIZE * sizeof(*ps_ring));
+	if (!ps_ring)
+		return -ENOMEM;
+
+	err = misc_register(&ps_device);
+	if (err) {
+		vfree(ps_ring);
+		ps_ring = NULL;
+		return err;
+	}
+
+	mutex_lock(&ps_mutex);
+	if (ps_enabled && ps_start()) {
+		ps_stop();
+		ps_enabled = false;
+	}
+	mutex_unlock(&ps_mutex);
+
+	return 0;
+}
+module_init(perf_sampler_init);
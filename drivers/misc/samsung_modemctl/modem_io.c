@@ -32,6 +32,8 @@
 #include <net/sock.h>
 #include <linux/if.h>
 #include <linux/if_arp.h>
+#include <linux/inetdevice.h>
+#include <linux/rtnetlink.h>
 
 #include <linux/circ_buf.h>
 #include <linux/wakelock.h>
@@ -490,6 +492,20 @@ static struct net_device_ops vnet_ops = {
 	.ndo_start_xmit =	vnet_xmit,
 };
 
+/* Enough for the bandwidth-delay product of HSPA+ */
+#define RMNET_TCP_RMEM_MAX	262144
+
+static void rmnet_set_rmem_max(struct net_device *ndev)
+{
+	struct in_device *in_dev;
+
+	rtnl_lock();
+	in_dev = __in_dev_get_rtnl(ndev);
+	if (in_dev)
+		IN_DEV_CONF_SET(in_dev, TCP_RMEM_MAX, RMNET_TCP_RMEM_MAX);
+	rtnl_unlock();
+}
+
 static void vnet_setup(struct net_device *ndev)
 {
 	ndev->netdev_ops = &vnet_ops;
@@ -686,6 +702,7 @@ int modem_io_init(struct modemctl *mc, void __iomem *mmio)
 				pr_err("failed to register rmnet%d\n", i);
 				goto free;
 			}
+			rmnet_set_rmem_max(mc->ndev[i]);
 		} else {
 			pr_err("failed to alloc rmnet%d\n", i);
 			goto free;
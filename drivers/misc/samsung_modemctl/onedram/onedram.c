@@ -38,6 +38,9 @@
 #include <linux/slab.h>
 #include "onedram.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/onedram.h>
+
 #define DRVNAME "onedram"
 
 #define ONEDRAM_REG_OFFSET 0xFFF800
@@ -111,25 +114,56 @@ static inline void _write_sem(struct onedram *od, int v);
 
 static unsigned long recv_cnt;
 static unsigned long send_cnt;
+
+/* semaphore handoffs */
+static unsigned long sem_hit_cnt;	/* already ours */
+static unsigned long sem_req_cnt;	/* requested from the modem */
+static unsigned long sem_rel_cnt;	/* handed back to the modem */
+static unsigned long long sem_wait_ns;
+static unsigned long long sem_wait_max_ns;
+
 static ssize_t show_debug(struct device *d,
 		struct device_attribute *attr, char *buf)
 {
 	char *p = buf;
 	struct onedram *od = dev_get_drvdata(d);
+	unsigned long long avg;
 
 	if (!od)
 		return 0;
 
+	avg = sem_wait_ns;
+	if (sem_req_cnt)
+		do_div(avg, sem_req_cnt);
+
 	p += sprintf(p, "Semaphore: %d (%d)\n", _read_sem(od), (char)hw_tmp);
 	p += sprintf(p, "Mailbox: %x\n", od->reg->mailbox_AB);
 	p += sprintf(p, "Reference count: %d\n", atomic_read(&od->ref_sem));
 	p += sprintf(p, "Mailbox send: %lu\n", send_cnt);
 	p += sprintf(p, "Mailbox recv: %lu\n", recv_cnt);
+	p += sprintf(p, "Semaphore held: %lu\n", sem_hit_cnt);
+	p += sprintf(p, "Semaphore requested: %lu\n", sem_req_cnt);
+	p += sprintf(p, "Semaphore released: %lu\n", sem_rel_cnt);
+	p += sprintf(p, "Semaphore wait: avg %llu ns, max %llu ns\n",
+			avg, sem_wait_max_ns);
 
 	return p - buf;
 }
 
-static DEVICE_ATTR(debug, 0664, show_debug, NULL);
+/* Any write clears the semaphore statistics */
+static ssize_t store_debug(struct device *d,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	sem_hit_cnt = 0;
+	sem_req_cnt = 0;
+	sem_rel_cnt = 0;
+	sem_wait_ns = 0;
+	sem_wait_max_ns = 0;
+
+	return count;
+}
+
+static DEVICE_ATTR(debug, 0664, show_debug, store_debug);
 
 static struct attribute *onedram_attributes[] = {
 	&dev_attr_debug.attr,
@@ -142,6 +176,8 @@ static const struct attribute_group onedram_group = {
 
 static inline void _write_sem(struct onedram *od, int v)
 {
+	if (!v)
+		sem_rel_cnt++;
 	od->reg->sem = v;
 	hw_tmp = od->reg->sem; /* for hardware */
 }
@@ -166,6 +202,7 @@ static inline int _send_cmd(struct onedram *od, u32 cmd)
 	dev_dbg(od->dev, "send %x\n", cmd);
 	send_cnt++;
 	od->reg->mailbox_BA = cmd;
+	trace_onedram_mailbox_send(cmd, _read_sem(od));
 	return 0;
 }
 
@@ -186,6 +223,7 @@ static inline int _recv_cmd(struct onedram *od, u32 *cmd)
 
 	recv_cnt++;
 	*cmd = od->reg->mailbox_AB;
+	trace_onedram_mailbox_recv(*cmd, _read_sem(od));
 	return 0;
 }
 
@@ -232,12 +270,22 @@ static int get_auth(struct onedram *od, u32 cmd)
 
 	atomic_inc(&od->ref_sem);
 
-	if (_read_sem(od))
+	if (_read_sem(od)) {
+		sem_hit_cnt++;
 		return 0;
+	}
+
+	if (cmd) {
+		unsigned long long t = cpu_clock(smp_processor_id());
 
-	if (cmd)
 		r = _get_auth(od, cmd);
-	else
+
+		t = cpu_clock(smp_processor_id()) - t;
+		sem_req_cnt++;
+		sem_wait_ns += t;
+		if (t > sem_wait_max_ns)
+			sem_wait_max_ns = t;
+	} else
 		r = -EACCES;
 
 	if (r < 0)
@@ -293,6 +293,25 @@ static ssize_t store_debug(struct device *d,
 	return count;
 }
 
+static ssize_t show_stats(struct device *d,
+		struct device_attribute *attr, char *buf)
+{
+	if (!svnet_dev)
+		return 0;
+
+	return sipc_stat_show(svnet_dev->si, buf);
+}
+
+/* Any write clears the statistics */
+static ssize_t store_stats(struct device *d,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	if (svnet_dev)
+		sipc_stat_reset(svnet_dev->si);
+
+	return count;
+}
+
 static ssize_t store_whitelist(struct device *d,
 		struct device_attribute *attr, const char *buf, size_t count)
 {
@@ -316,6 +335,7 @@ static DEVICE_ATTR(latency, 0664, show_latency, NULL);
 static DEVICE_ATTR(waketime, 0664, show_waketime, store_waketime);
 static DEVICE_ATTR(debug, 0664, show_debug, store_debug);
 static DEVICE_ATTR(whitelist, 0664, NULL, store_whitelist);
+static DEVICE_ATTR(stats, 0664, show_stats, store_stats);
 
 static struct attribute *svnet_attributes[] = {
 	&dev_attr_version.attr,
@@ -323,6 +343,7 @@ static struct attribute *svnet_attributes[] = {
 	&dev_attr_debug.attr,
 	&dev_attr_latency.attr,
 	&dev_attr_whitelist.attr,
+	&dev_attr_stats.attr,
 	NULL
 };
 
@@ -350,6 +371,7 @@ int vnet_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 	if (!tmp_xtow)
 		tmp_xtow = cpu_clock(smp_processor_id());
 
+	SIPC_TX_QUEUED(skb) = cpu_clock(smp_processor_id());
 	skb_queue_tail(&sn->txq, skb);
 
 	_wake_process_lock_timeout(sn);
@@ -385,6 +407,7 @@ static int svnet_xmit(struct sk_buff *skb, struct net_device *ndev)
 	if (!tmp_xtow)
 		tmp_xtow = cpu_clock(smp_processor_id());
 
+	SIPC_TX_QUEUED(skb) = cpu_clock(smp_processor_id());
 	skb_queue_tail(&sn->txq, skb);
 
 	_wake_process_lock_timeout(sn);
@@ -25,6 +25,8 @@
 #include <net/sock.h>
 #include <linux/if.h>
 #include <linux/if_arp.h>
+#include <linux/inetdevice.h>
+#include <linux/rtnetlink.h>
 
 #include "pdp.h"
 
@@ -70,11 +72,15 @@ static void vnet_setup(struct net_device *ndev)
 	ndev->watchdog_timeo = 5 * HZ;
 }
 
+/* Enough for the bandwidth-delay product of HSPA+ */
+#define PDP_TCP_RMEM_MAX	262144
+
 struct net_device* create_pdp(int channel, struct net_device *parent)
 {
 	int r;
 	struct pdp_priv *priv;
 	struct net_device *ndev;
+	struct in_device *in_dev;
 	char devname[IFNAMSIZ];
 
 	if (!parent)
@@ -95,6 +101,12 @@ struct net_device* create_pdp(int channel, struct net_device *parent)
 		return ERR_PTR(r);
 	}
 
+	rtnl_lock();
+	in_dev = __in_dev_get_rtnl(ndev);
+	if (in_dev)
+		IN_DEV_CONF_SET(in_dev, TCP_RMEM_MAX, PDP_TCP_RMEM_MAX);
+	rtnl_unlock();
+
 	return ndev;
 }
 
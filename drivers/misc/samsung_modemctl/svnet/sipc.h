@@ -46,6 +46,9 @@ extern void sipc_close(struct sipc **);
 
 extern void sipc_exit(void);
 
+/* cpu_clock() when svnet queued the packet for sipc_write(), 0 if unset */
+#define SIPC_TX_QUEUED(skb) (*(unsigned long long *)(skb)->cb)
+
 extern int sipc_write(struct sipc *, struct sk_buff_head *);
 extern int sipc_read(struct sipc *, u32 mailbox, int *cond);
 extern int sipc_rx(struct sipc *);
@@ -59,6 +62,9 @@ extern ssize_t sipc_debug_show(struct sipc *, char *);
 extern int sipc_debug(struct sipc *, const char *);
 extern int sipc_whitelist(struct sipc *si, const char *buf, size_t count);
 
+extern ssize_t sipc_stat_show(struct sipc *, char *);
+extern void sipc_stat_reset(struct sipc *);
+
 extern void sipc_ramdump(struct sipc *);
 
 #endif /* __SAMSUNG_IPC_H__ */
@@ -31,9 +31,12 @@
 
 #include <linux/circ_buf.h>
 #include <linux/workqueue.h>
+#include <linux/moduleparam.h>
+#include <linux/timer.h>
 #include <asm/errno.h>
 
 #include <net/sock.h>
+#include <net/checksum.h>
 #include <linux/if_ether.h>
 #include <linux/phonet.h>
 #include <net/phonet/phonet.h>
@@ -89,6 +92,15 @@ static struct mailbox_data mb_data[IPCIDX_MAX] = {
 
 /* semaphore latency */
 unsigned long long time_max_semlat;
+
+/*
+ * Keep the semaphore this long after a TX burst, so the next burst
+ * does not have to ask the modem for it again. A request from the
+ * modem still gets it back right away.
+ */
+static unsigned int sem_hold_ms = 2;
+module_param(sem_hold_ms, uint, 0644);
+MODULE_PARM_DESC(sem_hold_ms, "OneDRAM semaphore hold time after TX (ms)");
 //static volatile unsigned long *TCNT = (unsigned long *)0xF520000C;
 
 struct sipc;
@@ -168,6 +180,35 @@ struct frag_info {
 	u8 msg_id;
 };
 
+/* FMT, the 32 RAW channels by CHID, RFS */
+#define STAT_CHAN_RAW 1
+#define STAT_CHAN_RFS (STAT_CHAN_RAW + 32)
+#define STAT_CHAN_MAX (STAT_CHAN_RFS + 1)
+
+struct sipc_chan_stat {
+	unsigned long tx_pkts;
+	unsigned long rx_pkts;
+	unsigned long long tx_bytes;
+	unsigned long long rx_bytes;
+	unsigned long long txq_ns; /* queued by svnet until in the ring */
+	unsigned long long txq_max_ns;
+};
+
+struct sipc_sem_stat {
+	unsigned long cnt;
+	unsigned long long ns;
+	unsigned long long max_ns;
+};
+
+/* Updated from the svnet work, sipc_stat_show() reads it racily */
+struct sipc_stat {
+	struct sipc_chan_stat chan[STAT_CHAN_MAX];
+	struct sipc_sem_stat tx_sem;
+	struct sipc_sem_stat rx_sem;
+	unsigned int out_max[IPCIDX_MAX]; /* ring fill high-watermarks */
+	unsigned int in_max[IPCIDX_MAX];
+};
+
 struct sipc {
 	struct sipc_mapped *map;
 	struct ringbuf rb[IPCIDX_MAX];
@@ -186,12 +227,17 @@ struct sipc {
 	struct frag_head frag_map;
 
 	int od_rel; /* onedram authority release */
+	struct timer_list hold_timer;
+
+	unsigned long rx_queued; /* a ringbuf drain is queued */
 
 	struct net_device *svndev;
 
 	const struct attribute_group *group;
 
 	struct sk_buff_head rfs_rx;
+
+	struct sipc_stat stat;
 };
 
 /* sizeof(struct phonethdr) + NET_SKB_PAD > SMP_CACHE_BYTES */
@@ -216,6 +262,73 @@ unsigned long pdp_bitmap[DIV_ROUND_UP(PDP_MAX, BITS_PER_LONG)];
 static void clear_pdp_wq(struct work_struct *work);
 static DECLARE_WORK(pdp_work, clear_pdp_wq);
 
+/*
+ * PDP packets are read off the RAW ringbuf while the semaphore is held,
+ * queued here, and handed to the stack in batches by a NAPI poll once
+ * the semaphore is back with the modem. pdp_napi_on is under pdp_mutex.
+ */
+#define PDP_NAPI_WEIGHT 64
+static struct napi_struct pdp_napi;
+static struct sk_buff_head pdp_rxq;
+static int pdp_napi_on;
+
+static int _pdp_poll(struct napi_struct *napi, int budget)
+{
+	struct sk_buff *skb;
+	int done = 0;
+
+	while (done < budget) {
+		skb = skb_dequeue(&pdp_rxq);
+		if (!skb)
+			break;
+
+		napi_gro_receive(napi, skb);
+		done++;
+	}
+
+	if (done < budget) {
+		napi_complete(napi);
+		/* queued after the last dequeue, while still scheduled */
+		if (!skb_queue_empty(&pdp_rxq))
+			napi_schedule(napi);
+	}
+
+	return done;
+}
+
+static void _pdp_rx_kick(void)
+{
+	if (!pdp_napi_on || skb_queue_empty(&pdp_rxq))
+		return;
+
+	local_bh_disable();
+	napi_schedule(&pdp_napi);
+	local_bh_enable();
+}
+
+/* Drop the queued packets of ndev before it goes, pdp_mutex held */
+static void _pdp_rx_purge(struct net_device *ndev)
+{
+	struct sk_buff *skb, *tmp;
+	unsigned long flags;
+
+	if (!pdp_napi_on)
+		return;
+
+	napi_disable(&pdp_napi);
+
+	spin_lock_irqsave(&pdp_rxq.lock, flags);
+	skb_queue_walk_safe(&pdp_rxq, skb, tmp) {
+		if (skb->dev == ndev) {
+			__skb_unlink(skb, &pdp_rxq);
+			kfree_skb(skb);
+		}
+	}
+	spin_unlock_irqrestore(&pdp_rxq.lock, flags);
+
+	napi_enable(&pdp_napi);
+}
+
 static ssize_t show_act(struct device *d,
 		struct device_attribute *attr, char *buf);
 static ssize_t show_deact(struct device *d,
@@ -292,7 +405,7 @@ static u8 _get_msg_id(struct sipc *si)
 	return si->msg_id;
 }
 
-static int _get_auth(void)
+static int __get_auth(struct sipc_sem_stat *st)
 {
 	int r;
 	unsigned long long t, d;
@@ -305,9 +418,21 @@ static int _get_auth(void)
 	if (d > time_max_semlat)
 		time_max_semlat = d;
 
+	if (st && !r) {
+		st->cnt++;
+		st->ns += d;
+		if (d > st->max_ns)
+			st->max_ns = d;
+	}
+
 	return r;
 }
 
+static inline int _get_auth(void)
+{
+	return __get_auth(NULL);
+}
+
 static void _put_auth(struct sipc *si)
 {
 	if (!si)
@@ -326,6 +451,42 @@ static inline void _req_rel_auth(struct sipc *si)
 	si->od_rel = 1;
 }
 
+static void _rel_held_auth(struct sipc *si)
+{
+	unsigned long flags;
+
+	/* the mailbox handler hands it over too: don't do it twice */
+	local_irq_save(flags);
+	if (onedram_read_sem()) {
+		if (!onedram_rel_sem()) {
+			onedram_write_mailbox(MB_CMD(MBC_RES_SEM));
+			si->od_rel = 0;
+		} else
+			_req_rel_auth(si);
+	}
+	local_irq_restore(flags);
+}
+
+static void _hold_timer(unsigned long data)
+{
+	_rel_held_auth((struct sipc *)data);
+}
+
+/* Release after a TX burst, or keep it for sem_hold_ms */
+static void _put_auth_hold(struct sipc *si)
+{
+	if (!sem_hold_ms) {
+		_req_rel_auth(si);
+		_put_auth(si);
+		return;
+	}
+
+	_put_auth(si);
+	if (onedram_read_sem())
+		mod_timer(&si->hold_timer,
+				jiffies + msecs_to_jiffies(sem_hold_ms));
+}
+
 static int _get_auth_try(void)
 {
 	return onedram_get_auth(0);
@@ -360,7 +521,8 @@ static void _check_buffer(struct sipc *si)
 	}
 	_put_auth(si);
 
-	if (mailbox)
+	/* a queued drain reads every ringbuf, this data included */
+	if (mailbox && !test_and_set_bit(0, &si->rx_queued))
 		si->queue(MB_DATA(mailbox), si->queue_data);
 }
 
@@ -432,6 +594,7 @@ void sipc_handler(u32 mailbox, void *data)
 		return;
 	}
 
+	set_bit(0, &si->rx_queued);
 	si->queue(mailbox, si->queue_data);
 }
 
@@ -510,6 +673,7 @@ struct sipc* sipc_open(void (*queue)(u32, void*), struct net_device *ndev)
 	si->queue = queue;
 	si->queue_data = ndev;
 	si->svndev = ndev;
+	setup_timer(&si->hold_timer, _hold_timer, (unsigned long)si);
 
 	/* TODO: need?? */
 	if (work_pending(&pdp_work))
@@ -537,6 +701,13 @@ struct sipc* sipc_open(void (*queue)(u32, void*), struct net_device *ndev)
 	
 	skb_queue_head_init(&si->rfs_rx);
 
+	mutex_lock(&pdp_mutex);
+	skb_queue_head_init(&pdp_rxq);
+	netif_napi_add(ndev, &pdp_napi, _pdp_poll, PDP_NAPI_WEIGHT);
+	napi_enable(&pdp_napi);
+	pdp_napi_on = 1;
+	mutex_unlock(&pdp_mutex);
+
 	/* process init message */
 	_init_proc(si);
 
@@ -551,6 +722,7 @@ static void clear_pdp_wq(struct work_struct *work)
 
 	for (i=0;i<sizeof(pdp_devs)/sizeof(pdp_devs[0]);i++) {
 		if (pdp_devs[i]) {
+			_pdp_rx_purge(pdp_devs[i]);
 			destroy_pdp(&pdp_devs[i]);
 			clear_bit(i, pdp_bitmap);
 		}
@@ -577,6 +749,15 @@ void sipc_close(struct sipc **psi)
 
 	si = *psi;
 
+	mutex_lock(&pdp_mutex);
+	if (pdp_napi_on) {
+		napi_disable(&pdp_napi);
+		netif_napi_del(&pdp_napi);
+		skb_queue_purge(&pdp_rxq);
+		pdp_napi_on = 0;
+	}
+	mutex_unlock(&pdp_mutex);
+
 	if (si->group && si->svndev) {
 		int i;
 		sysfs_remove_group(&si->svndev->dev.kobj, si->group);
@@ -593,8 +774,11 @@ void sipc_close(struct sipc **psi)
 	if (si->frag_buf)
 		kfree(si->frag_buf);
 
-	if (si->queue)
+	if (si->queue) {
 		onedram_unregister_handler(sipc_handler);
+		if (del_timer_sync(&si->hold_timer))
+			_rel_held_auth(si);
+	}
 
 	if (si->res)
 		onedram_release_region(0, SIPC_MAP_SIZE);
@@ -651,66 +835,60 @@ static inline void _set_raw_hdr(struct raw_hdr *h, int res,
 	h->control = 0;
 }
 
-static int _write_raw_buf(struct ringbuf *rb, int res, struct sk_buff *skb)
+/* Like __write(), straight from the skb, linear part and fragments alike */
+static int __write_skb(struct ringbuf *rb, struct sk_buff *skb)
 {
-	int len;
-	struct raw_hdr h;
-
-	_dbg("%s: packet %p res 0x%02x\n", __func__, skb, res);
-
-	len = skb->len + sizeof(h);
-
-	_set_raw_hdr(&h, res, len, 0);
+	int c;
+	int len = 0;
+	unsigned int head = rb->rb_out_head;
 
-	len  = __write(rb, (u8 *)hdlc_start, sizeof(hdlc_start));
-	len += __write(rb, (u8 *)&h, sizeof(h));
-	len += __write(rb, skb->data, skb->len);
-	len += __write(rb, (u8 *)hdlc_end, sizeof(hdlc_end));
+	while (len < skb->len) {
+		c = CIRC_SPACE_TO_END(head, rb->rb_out_tail, rb->rb_size);
+		if (skb->len - len < c)
+			c = skb->len - len;
+		if (c <= 0)
+			break;
+		if (skb_copy_bits(skb, len, rb->out_base + head, c))
+			break;
+		head = (head + c) & (rb->rb_size - 1);
+		len += c;
+	}
+	rb->rb_out_head = head;
 
 	return len;
 }
 
-static int _write_raw_skb(struct ringbuf *rb, int res, struct sk_buff *skb)
-{
-	char *b;
-
-	_dbg("%s: packet %p res 0x%02x\n", __func__, skb, res);
-
-	b = skb_put(skb, sizeof(hdlc_end));
-	memcpy(b, hdlc_end, sizeof(hdlc_end));
-
-	b = skb_push(skb, sizeof(struct raw_hdr) + sizeof(hdlc_start));
-	memcpy(b, hdlc_start, sizeof(hdlc_start));
-
-	b += sizeof(hdlc_start);
-
-	_set_raw_hdr((struct raw_hdr *)b, res,
-			skb->len - sizeof(hdlc_start) - sizeof(hdlc_end), 0);
-
-	return __write(rb, skb->data, skb->len);
-}
-
 static int _write_raw(struct ringbuf *rb, struct sk_buff *skb, int res)
 {
 	int len;
 	int space;
+	struct {
+		char start;
+		struct raw_hdr h;
+	} __attribute__ ((packed)) hdr;
 
 	space = CIRC_SPACE(rb->rb_out_head, rb->rb_out_tail, rb->rb_size);
 	if(space < skb->len + sizeof(struct raw_hdr)
 			+ sizeof(hdlc_start) + sizeof(hdlc_end))
 		return -ENOSPC;
 
-	if(skb_headroom(skb) > (sizeof(struct raw_hdr) + sizeof(hdlc_start))
-			&& skb_tailroom(skb) > sizeof(hdlc_end)) {
-		len = _write_raw_skb(rb, res, skb);
-	} else {
-		len = _write_raw_buf(rb, res, skb);
-	}
+	_dbg("%s: packet %p res 0x%02x\n", __func__, skb, res);
 
-	if (res >= PN_PDP_START && res <= PN_PDP_END)
-		_wake_queue(PDP_ID(res));
-	else
-		netif_wake_queue(skb->dev);
+	/* the frame goes into the ring as is, the skb is left untouched */
+	hdr.start = HDLC_START;
+	_set_raw_hdr(&hdr.h, res, skb->len + sizeof(hdr.h), 0);
+
+	len  = __write(rb, (u8 *)&hdr, sizeof(hdr));
+	len += __write_skb(rb, skb);
+	len += __write(rb, (u8 *)hdlc_end, sizeof(hdlc_end));
+
+	/* waking a running queue is a no-op, skip pdp_mutex for it */
+	if (netif_queue_stopped(skb->dev)) {
+		if (res >= PN_PDP_START && res <= PN_PDP_END)
+			_wake_queue(PDP_ID(res));
+		else
+			netif_wake_queue(skb->dev);
+	}
 	return len;
 }
 
@@ -850,6 +1028,53 @@ static int _write_fmt(struct sipc *si, struct ringbuf *rb, struct sk_buff *skb)
 	return len; /* total write bytes */
 }
 
+static inline struct sipc_chan_stat *_stat_chan(struct sipc *si, int res)
+{
+	switch (res_to_ridx(res)) {
+	case IPCIDX_FMT:
+		return &si->stat.chan[0];
+	case IPCIDX_RAW:
+		return &si->stat.chan[STAT_CHAN_RAW + CHID(res)];
+	default:
+		return &si->stat.chan[STAT_CHAN_RFS];
+	}
+}
+
+static inline void _stat_ring(unsigned int *max, unsigned int cnt)
+{
+	if (cnt > *max)
+		*max = cnt;
+}
+
+static void _stat_tx(struct sipc *si, int res, struct sk_buff *skb)
+{
+	struct sipc_chan_stat *st = _stat_chan(si, res);
+	struct ringbuf *rb = &si->rb[res_to_ridx(res)];
+	unsigned long long queued = SIPC_TX_QUEUED(skb);
+	unsigned long long d;
+
+	st->tx_pkts++;
+	st->tx_bytes += skb->len;
+
+	if (queued) {
+		d = cpu_clock(smp_processor_id()) - queued;
+		st->txq_ns += d;
+		if (d > st->txq_max_ns)
+			st->txq_max_ns = d;
+	}
+
+	_stat_ring(&si->stat.out_max[res_to_ridx(res)],
+			CIRC_CNT(rb->rb_out_head, rb->rb_out_tail, rb->rb_size));
+}
+
+static inline void _stat_rx(struct sipc *si, int res, int len)
+{
+	struct sipc_chan_stat *st = _stat_chan(si, res);
+
+	st->rx_pkts++;
+	st->rx_bytes += len;
+}
+
 static int _write(struct sipc *si, int res, struct sk_buff *skb, u32 *mailbox)
 {
 	int r;
@@ -875,8 +1100,10 @@ static int _write(struct sipc *si, int res, struct sk_buff *skb, u32 *mailbox)
 		break;
 	}
 
-	if(r > 0)
+	if(r > 0) {
 		*mailbox |= mb_data[rid].mask_send;
+		_stat_tx(si, res, skb);
+	}
 
 	_dbg("%s: return %d\n", __func__, r);
 	return r;
@@ -920,7 +1147,7 @@ int sipc_write(struct sipc *si, struct sk_buff_head *sbh)
 		return -ENXIO;
 	}
 
-	r = _get_auth();
+	r = __get_auth(&si->stat.tx_sem);
 	if (r) {
 		if (factory_test_force_sleep){
 			printk("tx ignored for factory force sleep\n");
@@ -955,8 +1182,7 @@ int sipc_write(struct sipc *si, struct sk_buff_head *sbh)
 		skb = skb_dequeue(sbh);
 	}
 
-	_req_rel_auth(si);
-	_put_auth(si);
+	_put_auth_hold(si);
 
 	if(mailbox)
 		onedram_write_mailbox(MB_DATA(mailbox));
@@ -1198,6 +1424,7 @@ free_skb:
 static int _read_pdp(struct ringbuf *rb, int len,
 		int res)
 {
+	int queued;
 	int r;
 	struct sk_buff *skb;
 	char *p;
@@ -1232,19 +1459,29 @@ static int _read_pdp(struct ringbuf *rb, int len,
 	ndev->stats.rx_packets++;
 	ndev->stats.rx_bytes += skb->len;
 
-	mutex_unlock(&pdp_mutex);
-
 	read_len = r;
 
 	skb->protocol = __constant_htons(ETH_P_IP);
 
 	skb_reset_mac_header(skb);
 
+	/* the data is cache hot now; lets GRO merge TCP segments */
+	skb->csum = csum_partial(p, len, 0);
+	skb->ip_summed = CHECKSUM_COMPLETE;
+
 	_dbg("%s: pdp packet %p len %d\n", __func__, skb, skb->len);
 
-	r = netif_rx_ni(skb);
-	if (r != NET_RX_SUCCESS)
-		dev_err(&ndev->dev, "pdp rx error: %d\n", r);
+	queued = pdp_napi_on;
+	if (queued)
+		skb_queue_tail(&pdp_rxq, skb);
+
+	mutex_unlock(&pdp_mutex);
+
+	if (!queued) {
+		r = netif_rx_ni(skb);
+		if (r != NET_RX_SUCCESS)
+			dev_err(&ndev->dev, "pdp rx error: %d\n", r);
+	}
 
 	return read_len;
 }
@@ -1285,6 +1522,7 @@ static int _read_raw(struct sipc *si, int inbuf, struct ringbuf *rb)
 			return r;
 		}
 
+		_stat_rx(si, res, data_len);
 		inbuf -= r;
 	}
 
@@ -1321,6 +1559,7 @@ static int _read_rfs(struct sipc *si, int inbuf, struct ringbuf *rb)
 			return r;
 		}
 
+		_stat_rx(si, PN_RFS, data_len);
 		inbuf -= r;
 	}
 
@@ -1554,6 +1793,7 @@ static int _read_fmt(struct sipc *si, int inbuf, struct ringbuf *rb)
 			return r;
 		}
 
+		_stat_rx(si, PN_FMT, h->len - sizeof(struct fmt_hdr));
 		inbuf -= r;
 	}
 
@@ -1579,10 +1819,13 @@ int sipc_read(struct sipc *si, u32 mailbox, int *cond)
 	if (!si)
 		return -EINVAL;
 
-	r = _get_auth();
+	r = __get_auth(&si->stat.rx_sem);
 	if (r)
 		return r;
 
+	/* from here on, new data needs a new drain */
+	clear_bit(0, &si->rx_queued);
+
 	for (i=0;i<IPCIDX_MAX;i++) {
 		int inbuf;
 		struct ringbuf *rb;
@@ -1595,6 +1838,8 @@ int sipc_read(struct sipc *si, u32 mailbox, int *cond)
 		if (!inbuf)
 			continue;
 
+		_stat_ring(&si->stat.in_max[i], inbuf);
+
 		if (i == IPCIDX_FMT)
 			_fmt_wakelock_timeout();
 		else
@@ -1624,6 +1869,8 @@ int sipc_read(struct sipc *si, u32 mailbox, int *cond)
 	if (res)
 		onedram_write_mailbox(MB_DATA(res));
 
+	_pdp_rx_kick();
+
 	*cond =	skb_queue_len(&si->rfs_rx);
 
 	return r;
@@ -1719,6 +1966,86 @@ ssize_t sipc_debug_show(struct sipc *si, char *buf)
 	return p - buf;
 }
 
+static unsigned long _stat_avg_us(unsigned long long ns, unsigned long cnt)
+{
+	if (!cnt)
+		return 0;
+
+	do_div(ns, cnt);
+	do_div(ns, NSEC_PER_USEC);
+	return (unsigned long)ns;
+}
+
+static unsigned long _stat_us(unsigned long long ns)
+{
+	do_div(ns, NSEC_PER_USEC);
+	return (unsigned long)ns;
+}
+
+static char *_stat_show_chan(char *p, const char *name,
+		const struct sipc_chan_stat *st)
+{
+	if (!st->tx_pkts && !st->rx_pkts)
+		return p;
+
+	return p + sprintf(p, "%-7s %8lu %10llu %8lu %10llu %8lu %8lu\n", name,
+			st->tx_pkts, st->tx_bytes, st->rx_pkts, st->rx_bytes,
+			_stat_avg_us(st->txq_ns, st->tx_pkts),
+			_stat_us(st->txq_max_ns));
+}
+
+static char *_stat_show_sem(char *p, const char *name,
+		const struct sipc_sem_stat *st)
+{
+	return p + sprintf(p, "%s sem\t%8lu\tavg %8lu us\tmax %8lu us\n",
+			name, st->cnt, _stat_avg_us(st->ns, st->cnt),
+			_stat_us(st->max_ns));
+}
+
+ssize_t sipc_stat_show(struct sipc *si, char *buf)
+{
+	static const char *ring_names[IPCIDX_MAX] = { "FMT", "RAW", "RFS" };
+	struct sipc_stat *st;
+	char name[8];
+	char *p = buf;
+	int i;
+
+	if (!si || !buf)
+		return 0;
+	st = &si->stat;
+
+	p += sprintf(p, "chan      tx_pkts   tx_bytes  rx_pkts   rx_bytes"
+			"  txq_us  txq_max\n");
+	p = _stat_show_chan(p, "fmt", &st->chan[0]);
+	for (i = 0; i < STAT_CHAN_RFS - STAT_CHAN_RAW; i++) {
+		int res = PN_RAW(i);
+
+		if (res >= PN_PDP_START && res <= PN_PDP_END)
+			snprintf(name, sizeof(name), "pdp%d", PDP_ID(res));
+		else
+			snprintf(name, sizeof(name), "raw%d", i);
+		p = _stat_show_chan(p, name, &st->chan[STAT_CHAN_RAW + i]);
+	}
+	p = _stat_show_chan(p, "rfs", &st->chan[STAT_CHAN_RFS]);
+
+	p += sprintf(p, "\n");
+	p = _stat_show_sem(p, "TX", &st->tx_sem);
+	p = _stat_show_sem(p, "RX", &st->rx_sem);
+
+	p += sprintf(p, "\nring\tout_max\tin_max\tsize\n");
+	for (i = 0; i < IPCIDX_MAX; i++)
+		p += sprintf(p, "%s\t%u\t%u\t%u\n", ring_names[i],
+				st->out_max[i], st->in_max[i], si->rb[i].rb_size);
+
+	return p - buf;
+}
+
+void sipc_stat_reset(struct sipc *si)
+{
+	if (si)
+		memset(&si->stat, 0, sizeof(si->stat));
+}
+
 static void test_copy_buf(struct sipc *si, int idx)
 {
 	struct ringbuf *rb;
@@ -1868,6 +2195,7 @@ static int pdp_deactivate(int channel)
 		return -EBUSY;
 	}
 
+	_pdp_rx_purge(pdp_devs[idx]);
 	destroy_pdp(&pdp_devs[idx]);
 	clear_bit(idx, pdp_bitmap);
 	pdp_cnt--;
@@ -0,0 +1,133 @@
+/*
+ * drivers/misc/sensor_batch.c
+ *
+ * Batched delivery of polled sensor samples through an input device.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The sensors here have no FIFO of their own, so the driver still
+ * wakes at the sampling rate to read them. What batching saves is the
+ * reader: the input core and evdev wake the sensor service once per
+ * batch instead of once per sample.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/input.h>
+#include <linux/sensor_batch.h>
+
+int sensor_batch_init(struct sensor_batch *batch, struct input_dev *input,
+		      unsigned int type, const unsigned int *codes,
+		      unsigned int axes, unsigned int size)
+{
+	if (axes > SENSOR_BATCH_MAX_AXES || !size)
+		return -EINVAL;
+
+	batch->ring = kcalloc(size, sizeof(*batch->ring), GFP_KERNEL);
+	if (!batch->ring)
+		return -ENOMEM;
+
+	mutex_init(&batch->lock);
+	batch->input = input;
+	batch->type = type;
+	batch->codes = codes;
+	batch->axes = axes;
+	batch->size = size;
+	batch->head = 0;
+	batch->count = 0;
+	batch->max_latency_ns = 0;
+
+	input_set_capability(input, EV_MSC, MSC_RAW);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sensor_batch_init);
+
+void sensor_batch_free(struct sensor_batch *batch)
+{
+	kfree(batch->ring);
+	batch->ring = NULL;
+}
+EXPORT_SYMBOL_GPL(sensor_batch_free);
+
+static void sensor_batch_report(struct sensor_batch *batch,
+				const struct sensor_batch_sample *s,
+				ktime_t now, bool batched)
+{
+	unsigned int i;
+
+	if (batched)
+		input_event(batch->input, EV_MSC, MSC_RAW,
+			    (int)ktime_to_us(ktime_sub(now, s->time)));
+
+	for (i = 0; i < batch->axes; i++)
+		input_event(batch->input, batch->type, batch->codes[i],
+			    s->val[i]);
+	input_sync(batch->input);
+}
+
+static void __sensor_batch_flush(struct sensor_batch *batch)
+{
+	ktime_t now = ktime_get();
+	unsigned int tail;
+
+	while (batch->count) {
+		tail = (batch->head + batch->size - batch->count) % batch->size;
+		sensor_batch_report(batch, &batch->ring[tail], now, true);
+		batch->count--;
+	}
+}
+
+void sensor_batch_add(struct sensor_batch *batch, const int *val,
+		      ktime_t time)
+{
+	struct sensor_batch_sample *s;
+	unsigned int tail;
+
+	mutex_lock(&batch->lock);
+
+	if (!batch->max_latency_ns) {
+		struct sensor_batch_sample now = { .time = time };
+
+		memcpy(now.val, val, batch->axes * sizeof(*val));
+		sensor_batch_report(batch, &now, time, false);
+		mutex_unlock(&batch->lock);
+		return;
+	}
+
+	s = &batch->ring[batch->head];
+	s->time = time;
+	memcpy(s->val, val, batch->axes * sizeof(*val));
+	batch->head = (batch->head + 1) % batch->size;
+	batch->count++;
+
+	tail = (batch->head + batch->size - batch->count) % batch->size;
+	if (batch->count == batch->size ||
+	    ktime_to_ns(ktime_sub(time, batch->ring[tail].time)) >=
+			batch->max_latency_ns)
+		__sensor_batch_flush(batch);
+
+	mutex_unlock(&batch->lock);
+}
+EXPORT_SYMBOL_GPL(sensor_batch_add);
+
+/* Report what is queued, e.g. before the sensor is disabled */
+void sensor_batch_flush(struct sensor_batch *batch)
+{
+	mutex_lock(&batch->lock);
+	__sensor_batch_flush(batch);
+	mutex_unlock(&batch->lock);
+}
+EXPORT_SYMBOL_GPL(sensor_batch_flush);
+
+void sensor_batch_set_latency(struct sensor_batch *batch, u64 ns)
+{
+	mutex_lock(&batch->lock);
+	__sensor_batch_flush(batch);
+	batch->max_latency_ns = ns;
+	mutex_unlock(&batch->lock);
+}
+EXPORT_SYMBOL_GPL(sensor_batch_set_latency);
@@ -13,42 +13,61 @@
  *
  */
 
-#include <asm/atomic.h>
-
 #include <linux/err.h>
+#include <linux/hash.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
+#include <linux/percpu.h>
 #include <linux/proc_fs.h>
+#include <linux/rculist.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/stat.h>
 #include <linux/uid_stat.h>
 #include <net/activity_stats.h>
 
+#define UID_HASH_BITS	6
+
+/*
+ * Each TCP send and receive updates the counters of its uid, so lookups
+ * walk a hash chain under RCU and the counters are per cpu, summed only
+ * when read. uid_lock just serializes adding entries, which are never
+ * removed.
+ */
 static DEFINE_SPINLOCK(uid_lock);
-static LIST_HEAD(uid_list);
+static struct hlist_head uid_hash[1 << UID_HASH_BITS];
 static struct proc_dir_entry *parent;
 
+struct uid_stat_counters {
+	unsigned int tcp_rcv;
+	unsigned int tcp_snd;
+};
+
 struct uid_stat {
-	struct list_head link;
+	struct hlist_node link;
 	uid_t uid;
-	atomic_t tcp_rcv;
-	atomic_t tcp_snd;
+	/* wrap at 4GB, as readers of tcp_rcv and tcp_snd expect */
+	struct uid_stat_counters __percpu *counters;
 };
 
+static struct hlist_head *uid_hash_head(uid_t uid)
+{
+	return &uid_hash[hash_32(uid, UID_HASH_BITS)];
+}
+
 static struct uid_stat *find_uid_stat(uid_t uid) {
-	unsigned long flags;
 	struct uid_stat *entry;
+	struct hlist_node *pos;
 
-	spin_lock_irqsave(&uid_lock, flags);
-	list_for_each_entry(entry, &uid_list, link) {
+	rcu_read_lock();
+	hlist_for_each_entry_rcu(entry, pos, uid_hash_head(uid), link) {
 		if (entry->uid == uid) {
-			spin_unlock_irqrestore(&uid_lock, flags);
+			rcu_read_unlock();
 			return entry;
 		}
 	}
-	spin_unlock_irqrestore(&uid_lock, flags);
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -59,10 +78,13 @@ static int tcp_snd_read_proc(char *page, char **start, off_t off,
 	unsigned int bytes;
 	char *p = page;
 	struct uid_stat *uid_entry = (struct uid_stat *) data;
+	int cpu;
 	if (!data)
 		return 0;
 
-	bytes = (unsigned int) (atomic_read(&uid_entry->tcp_snd) + INT_MIN);
+	bytes = 0;
+	for_each_possible_cpu(cpu)
+		bytes += per_cpu_ptr(uid_entry->counters, cpu)->tcp_snd;
 	p += sprintf(p, "%u\n", bytes);
 	len = (p - page) - off;
 	*eof = (len <= count) ? 1 : 0;
@@ -77,10 +99,13 @@ static int tcp_rcv_read_proc(char *page, char **start, off_t off,
 	unsigned int bytes;
 	char *p = page;
 	struct uid_stat *uid_entry = (struct uid_stat *) data;
+	int cpu;
 	if (!data)
 		return 0;
 
-	bytes = (unsigned int) (atomic_read(&uid_entry->tcp_rcv) + INT_MIN);
+	bytes = 0;
+	for_each_possible_cpu(cpu)
+		bytes += per_cpu_ptr(uid_entry->counters, cpu)->tcp_rcv;
 	p += sprintf(p, "%u\n", bytes);
 	len = (p - page) - off;
 	*eof = (len <= count) ? 1 : 0;
@@ -92,20 +117,32 @@ static int tcp_rcv_read_proc(char *page, char **start, off_t off,
 static struct uid_stat *create_stat(uid_t uid) {
 	unsigned long flags;
 	char uid_s[32];
-	struct uid_stat *new_uid;
+	struct uid_stat *new_uid, *old_uid;
+	struct hlist_node *pos;
 	struct proc_dir_entry *entry;
 
-	/* Create the uid stat struct and append it to the list. */
+	/* Create the uid stat struct and add it to the hash. */
 	if ((new_uid = kmalloc(sizeof(struct uid_stat), GFP_KERNEL)) == NULL)
 		return NULL;
 
 	new_uid->uid = uid;
-	/* Counters start at INT_MIN, so we can track 4GB of network traffic. */
-	atomic_set(&new_uid->tcp_rcv, INT_MIN);
-	atomic_set(&new_uid->tcp_snd, INT_MIN);
+	new_uid->counters = alloc_percpu(struct uid_stat_counters);
+	if (!new_uid->counters) {
+		kfree(new_uid);
+		return NULL;
+	}
 
+	/* Another task of the uid may have added it since the lookup. */
 	spin_lock_irqsave(&uid_lock, flags);
-	list_add_tail(&new_uid->link, &uid_list);
+	hlist_for_each_entry(old_uid, pos, uid_hash_head(uid), link) {
+		if (old_uid->uid == uid) {
+			spin_unlock_irqrestore(&uid_lock, flags);
+			free_percpu(new_uid->counters);
+			kfree(new_uid);
+			return old_uid;
+		}
+	}
+	hlist_add_head_rcu(&new_uid->link, uid_hash_head(uid));
 	spin_unlock_irqrestore(&uid_lock, flags);
 
 	sprintf(uid_s, "%d", uid);
@@ -128,7 +165,7 @@ int uid_stat_tcp_snd(uid_t uid, int size) {
 		((entry = create_stat(uid)) == NULL)) {
 			return -1;
 	}
-	atomic_add(size, &entry->tcp_snd);
+	this_cpu_add(entry->counters->tcp_snd, size);
 	return 0;
 }
 
@@ -139,7 +176,7 @@ int uid_stat_tcp_rcv(uid_t uid, int size) {
 		((entry = create_stat(uid)) == NULL)) {
 			return -1;
 	}
-	atomic_add(size, &entry->tcp_rcv);
+	this_cpu_add(entry->counters->tcp_rcv, size);
 	return 0;
 }
 
@@ -40,25 +40,16 @@
 
 #include <linux/hrtimer.h>
 #include <linux/mutex.h>
-#include <linux/kthread.h>
-
-#define WATCHDOG_TIMEOUT                10      /* 10 timer cycles = 50ms */
+#include <linux/spinlock.h>
 
 /* Global variables */
-static bool g_bTimerThreadStarted = false;
 static bool g_bTimerStarted = false;
 static struct hrtimer g_tspTimer;
 static ktime_t g_ktFiveMs;
-struct task_struct  *g_pTspThread;
-static int g_nWatchdogCounter = 0;
+static DEFINE_SPINLOCK(g_tspLock);
 
-DECLARE_COMPLETION(g_tspCompletion);
 DEFINE_SEMAPHORE(g_hMutex);
 
-/* Forward declarations */
-static void VibeOSKernelLinuxStartTimer(void);
-static void VibeOSKernelLinuxStopTimer(void);
-
 /**
  * VibeSemIsLocked - is the semaphore locked
  * @lock: the semaphore to be queried
@@ -74,119 +65,118 @@ static inline int VibeSemIsLocked(struct semaphore *lock)
 #endif
 }
 
-
-static enum hrtimer_restart tsp_timer_interrupt(struct hrtimer *timer)
+static void VibeOSKernelLinuxResetBuffers(void)
 {
-    /* Scheduling next timeout value right away */
-    hrtimer_forward_now(timer, g_ktFiveMs);
+    int i;
 
-    if(g_bTimerStarted)
+    /* Reset samples buffers */
+    for (i = 0; i < NUM_ACTUATORS; i++)
     {
-        /* Notifying the handler of this timer of the tick  */
-        /* This allows us to perform operations that are usually */
-        /* not allowed inside interrupt context, such as locking */
-        /* a mutex, etc. */
-        complete(&g_tspCompletion);
+        g_SamplesBuffer[i].nIndexPlayingBuffer = -1;
+        g_SamplesBuffer[i].actuatorSamples[0].nBufferSize = 0;
+        g_SamplesBuffer[i].actuatorSamples[1].nBufferSize = 0;
     }
-
-    return HRTIMER_RESTART;
+    g_bStopRequested = false;
+    g_bIsPlaying = false;
 }
 
-
-static int VibeOSKernelTimerProc(void* data)
+/*
+** Plays one sample per actuator on each tick, straight from the timer
+** interrupt: the force output only writes PWM and GPIO registers, so no
+** thread has to be woken every 5ms. The timer is not restarted once every
+** actuator has run out of samples.
+*/
+static enum hrtimer_restart tsp_timer_interrupt(struct hrtimer *timer)
 {
-    int nActuatorNotPlaying;
+    int nActuatorNotPlaying = 0;
     int i;
     int bReachEndBuffer = 0;
-    
-    while(!kthread_should_stop())
-    {
-        if(g_bTimerThreadStarted)
-        {
-            /* Block until we get woken up by timer tick */
-            /* . only do this if we're not exiting entirely */
-            wait_for_completion_interruptible(&g_tspCompletion);
+    enum hrtimer_restart ret = HRTIMER_RESTART;
 
-            /* Reinitialized completion so it isn't free by default */
-            init_completion(&g_tspCompletion);
-        }
+    spin_lock(&g_tspLock);
 
-        nActuatorNotPlaying = 0;
+    if (!g_bTimerStarted)
+    {
+        spin_unlock(&g_tspLock);
+        return HRTIMER_NORESTART;
+    }
 
-        /* Return right away if timer is not supposed to run */
-        if (g_bTimerStarted) 
+    for (i = 0; i < NUM_ACTUATORS; i++) 
+    {
+        actuator_samples_buffer *pCurrentActuatorSample = &(g_SamplesBuffer[i]);
+
+        if (-1 == pCurrentActuatorSample->nIndexPlayingBuffer)
         {
-            for (i = 0; i < NUM_ACTUATORS; i++) 
+            nActuatorNotPlaying++;
+            if (NUM_ACTUATORS == nActuatorNotPlaying)
             {
-                actuator_samples_buffer *pCurrentActuatorSample = &(g_SamplesBuffer[i]);
-
-                if (-1 == pCurrentActuatorSample->nIndexPlayingBuffer)
+                /* Nothing to play for all actuators, turn off the timer */
+                ImmVibeSPI_ForceOut_Set(i, 0);
+                ImmVibeSPI_ForceOut_AmpDisable(i);
+                ret = HRTIMER_NORESTART;
+            }
+        }
+        else
+        {
+            /* Play the current buffer */
+            ImmVibeSPI_ForceOut_Set(i, pCurrentActuatorSample->actuatorSamples[(int)pCurrentActuatorSample->nIndexPlayingBuffer].dataBuffer[(int)(pCurrentActuatorSample->nIndexOutputValue++)]);
+            
+            if (pCurrentActuatorSample->nIndexOutputValue >= pCurrentActuatorSample->actuatorSamples[(int)pCurrentActuatorSample->nIndexPlayingBuffer].nBufferSize)
+            {
+                /* We were playing in the last tick */
+                
+                /* Reach the end of the current buffer */
+                pCurrentActuatorSample->actuatorSamples[(int)pCurrentActuatorSample->nIndexPlayingBuffer].nBufferSize = 0;
+            
+                bReachEndBuffer = 1;
+
+                /* Check stop request and empty buffer */
+                if ((g_bStopRequested) || (0 == (pCurrentActuatorSample->actuatorSamples[(int)((pCurrentActuatorSample->nIndexPlayingBuffer) ^ 1)].nBufferSize)))
                 {
-                    nActuatorNotPlaying++;
-                    if ((NUM_ACTUATORS == nActuatorNotPlaying) && ((++g_nWatchdogCounter) > WATCHDOG_TIMEOUT))
+                    pCurrentActuatorSample->nIndexPlayingBuffer = -1; 
+                    
+                    if(g_bStopRequested)
                     {
-                        /* Nothing to play for all actuators, turn off the timer when we reach the watchdog tick count limit */
+                        /* g_bStopReqested is set, so turn off all actuators */
                         ImmVibeSPI_ForceOut_Set(i, 0);
                         ImmVibeSPI_ForceOut_AmpDisable(i);
-                        VibeOSKernelLinuxStopTimer();
-                        /* Reset watchdog counter */
-                        g_nWatchdogCounter = 0;
+                        
+                        /* If it's the last actuator, stop the timer */
+                        if (i == (NUM_ACTUATORS-1))
+                            ret = HRTIMER_NORESTART;
                     }
                 }
-                else
+                else  /* The other buffer has data in it */
                 {
-                    /* Play the current buffer */
-                    ImmVibeSPI_ForceOut_Set(i, pCurrentActuatorSample->actuatorSamples[(int)pCurrentActuatorSample->nIndexPlayingBuffer].dataBuffer[(int)(pCurrentActuatorSample->nIndexOutputValue++)]);
-                    
-                    if (pCurrentActuatorSample->nIndexOutputValue >= pCurrentActuatorSample->actuatorSamples[(int)pCurrentActuatorSample->nIndexPlayingBuffer].nBufferSize)
-                    {
-                        /* We were playing in the last tick */
-                        
-                        /* Reach the end of the current buffer */
-                        pCurrentActuatorSample->actuatorSamples[(int)pCurrentActuatorSample->nIndexPlayingBuffer].nBufferSize = 0;
-                    
-                        bReachEndBuffer = 1;
-
-                        /* Check stop request and empty buffer */
-                        if ((g_bStopRequested) || (0 == (pCurrentActuatorSample->actuatorSamples[(int)((pCurrentActuatorSample->nIndexPlayingBuffer) ^ 1)].nBufferSize)))
-                        {
-                            pCurrentActuatorSample->nIndexPlayingBuffer = -1; 
-                            
-                            if(g_bStopRequested)
-                            {
-                                /* g_bStopReqested is set, so turn off all actuators */
-                                ImmVibeSPI_ForceOut_Set(i, 0);
-                                ImmVibeSPI_ForceOut_AmpDisable(i);
-                                
-                                /* If it's the last actuator, stop the timer */
-                                if (i == (NUM_ACTUATORS-1))
-                                {
-                                    VibeOSKernelLinuxStopTimer();
-
-                                    /* Reset watchdog counter */
-                                    g_nWatchdogCounter = 0;
-                                }
-                            }
-                        }
-                        else  /* The other buffer has data in it */
-                        {
-                            /* Switch buffer */
-                            (pCurrentActuatorSample->nIndexPlayingBuffer) ^= 1;
-                            pCurrentActuatorSample->nIndexOutputValue = 0;
-                        }
-                    }
+                    /* Switch buffer */
+                    (pCurrentActuatorSample->nIndexPlayingBuffer) ^= 1;
+                    pCurrentActuatorSample->nIndexOutputValue = 0;
                 }
             }
-
-            /* Release the mutex if locked */
-            if (bReachEndBuffer && VibeSemIsLocked(&g_hMutex))
-            {
-                up(&g_hMutex);
-            }
         }
     }
 
-    return 0;
+    if (HRTIMER_NORESTART == ret)
+    {
+        /* hrtimer_cancel() would wait for this very callback */
+        g_bTimerStarted = false;
+        VibeOSKernelLinuxResetBuffers();
+    }
+    else
+    {
+        /* Next tick a period after the last one, not after now */
+        hrtimer_forward(timer, hrtimer_get_expires(timer), g_ktFiveMs);
+    }
+
+    spin_unlock(&g_tspLock);
+
+    /* Release the mutex if locked, up() is fine in interrupt context */
+    if ((bReachEndBuffer || HRTIMER_NORESTART == ret) && VibeSemIsLocked(&g_hMutex))
+    {
+        up(&g_hMutex);
+    }
+
+    return ret;
 }
 
 static void VibeOSKernelLinuxInitTimer(void)
@@ -194,10 +184,6 @@ static void VibeOSKernelLinuxInitTimer(void)
     /* Get a 5,000,000ns = 5ms time value */
     g_ktFiveMs = ktime_set(0, 5000000);
 
-    /* Start the companion thread. It's controlled by the timer, so when that is stopped, we're OK. */
-    g_bTimerThreadStarted = true;
-    g_pTspThread = kthread_run(VibeOSKernelTimerProc, NULL, "TouchSense Player Thread");
-
     hrtimer_init(&g_tspTimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 
     /* Initialize a 5ms-timer with tsp_timer_interrupt as timer callback (interrupt driven)*/
@@ -206,15 +192,18 @@ static void VibeOSKernelLinuxInitTimer(void)
 
 static void VibeOSKernelLinuxStartTimer(void)
 {
+    unsigned long flags;
     int i;
 
-    /* Reset watchdog counter */
-    g_nWatchdogCounter = 0;
+    spin_lock_irqsave(&g_tspLock, flags);
 
     if (!g_bTimerStarted)
     {
+        spin_unlock_irqrestore(&g_tspLock, flags);
+
         if (!VibeSemIsLocked(&g_hMutex)) down_interruptible(&g_hMutex); /* start locked */
 
+        spin_lock_irqsave(&g_tspLock, flags);
         g_bTimerStarted = true;
 
         /* Start the timer */
@@ -226,11 +215,14 @@ static void VibeOSKernelLinuxStartTimer(void)
            if ((g_SamplesBuffer[i].actuatorSamples[0].nBufferSize) || (g_SamplesBuffer[i].actuatorSamples[1].nBufferSize))
            {
                g_SamplesBuffer[i].nIndexOutputValue = 0;
+               spin_unlock_irqrestore(&g_tspLock, flags);
                return;
            }
         }
     }
 
+    spin_unlock_irqrestore(&g_tspLock, flags);
+
     /* 
     ** Use interruptible version of down to be safe 
     ** (try to not being stuck here if the mutex is not freed for any reason)
@@ -240,30 +232,19 @@ static void VibeOSKernelLinuxStartTimer(void)
 
 static void VibeOSKernelLinuxStopTimer(void)
 {
-    int i;
+    unsigned long flags;
 
-    if (g_bTimerStarted)
-    {
-        g_bTimerStarted = false;
-        hrtimer_cancel(&g_tspTimer);
-    }
+    spin_lock_irqsave(&g_tspLock, flags);
+    g_bTimerStarted = false;
+    VibeOSKernelLinuxResetBuffers();
+    spin_unlock_irqrestore(&g_tspLock, flags);
 
-     /* Reset samples buffers */
-     for (i = 0; i < NUM_ACTUATORS; i++)
-     {
-         g_SamplesBuffer[i].nIndexPlayingBuffer = -1;
-         g_SamplesBuffer[i].actuatorSamples[0].nBufferSize = 0;
-         g_SamplesBuffer[i].actuatorSamples[1].nBufferSize = 0;
-     }
-     g_bStopRequested = false;
-     g_bIsPlaying = false;
+    /* The callback sees g_bTimerStarted cleared if it runs meanwhile */
+    hrtimer_cancel(&g_tspTimer);
 } 
 
 static void VibeOSKernelLinuxTerminateTimer(void)
 {
     VibeOSKernelLinuxStopTimer();
-    g_bTimerThreadStarted = false;
-    complete_all(&g_tspCompletion);
-    kthread_stop(g_pTspThread);
     if (VibeSemIsLocked(&g_hMutex)) up(&g_hMutex);
 }
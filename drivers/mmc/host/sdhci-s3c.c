@@ -542,6 +542,16 @@ static int __devinit sdhci_s3c_probe(struct platform_device *pdev)
 	/* PIO currently has problems with multi-block IO */
 	host->quirks |= SDHCI_QUIRK_NO_MULTIBLOCK;
 
+#else
+
+	/*
+	 * The controller does ADMA2, which has no SDMA boundary interrupt
+	 * every 512KiB. Give it room for 256 segments so large writes go
+	 * out as a single request; the terminating descriptor quirk above
+	 * is all its descriptor handling needs.
+	 */
+	host->adma_max_segs = 256;
+
 #endif /* CONFIG_MMC_SDHCI_S3C_DMA */
 
 	/* It seems we do not get an DATA transfer complete on non-busy
@@ -602,6 +612,9 @@ static int __devinit sdhci_s3c_probe(struct platform_device *pdev)
 	    gpio_is_valid(pdata->ext_cd_gpio))
 		sdhci_s3c_setup_card_detect_gpio(sc);
 
+	/* Card re-init on resume is slow and does not depend on other devices */
+	device_enable_async_suspend(dev);
+
 	return 0;
 
  err_add_host:
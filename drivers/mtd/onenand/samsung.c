@@ -164,6 +164,7 @@ struct s3c_onenand {
 	struct resource *dma_res;
 	unsigned long	phys_base;
 	struct completion	complete;
+	int		dma_error;
 	struct mtd_partition *parts;
 };
 
@@ -648,6 +649,9 @@ static int s5pc110_dma_poll(void *dst, void *src, size_t count, int direction)
 	} while (!(status & S5PC110_DMA_TRANS_STATUS_TD) &&
 		time_before(jiffies, timeout));
 
+	if (!(status & S5PC110_DMA_TRANS_STATUS_TD))
+		return -ETIMEDOUT;
+
 	writel(S5PC110_DMA_TRANS_CMD_TDC, base + S5PC110_DMA_TRANS_CMD);
 
 	return 0;
@@ -666,6 +670,8 @@ static irqreturn_t s5pc110_onenand_irq(int irq, void *data)
 	if (unlikely(status & S5PC110_INTC_DMA_TE))
 		cmd = S5PC110_DMA_TRANS_CMD_TEC;
 
+	onenand->dma_error = cmd != S5PC110_DMA_TRANS_CMD_TDC;
+
 	writel(cmd, base + S5PC110_DMA_TRANS_CMD);
 	writel(status, base + S5PC110_INTC_DMA_CLR);
 
@@ -700,24 +706,21 @@ static int s5pc110_dma_irq(void *dst, void *src, size_t count, int direction)
 	writel(count, base + S5PC110_DMA_TRANS_SIZE);
 	writel(direction, base + S5PC110_DMA_TRANS_DIR);
 
+	INIT_COMPLETION(onenand->complete);
 	writel(S5PC110_DMA_TRANS_CMD_TR, base + S5PC110_DMA_TRANS_CMD);
 
-	wait_for_completion_timeout(&onenand->complete, msecs_to_jiffies(20));
+	if (!wait_for_completion_timeout(&onenand->complete,
+					 msecs_to_jiffies(20)))
+		return -ETIMEDOUT;
 
-	return 0;
+	return onenand->dma_error ? -EIO : 0;
 }
 
-static int s5pc110_read_bufferram(struct mtd_info *mtd, int area,
-		unsigned char *buffer, int offset, size_t count)
+static void __iomem *s5pc110_bufferram(struct mtd_info *mtd, int area)
 {
 	struct onenand_chip *this = mtd->priv;
-	void __iomem *p;
-	void *buf = (void *) buffer;
-	dma_addr_t dma_src, dma_dst;
-	int err, ofs, page_dma = 0;
-	struct device *dev = &onenand->pdev->dev;
+	void __iomem *p = this->base + area;
 
-	p = this->base + area;
 	if (ONENAND_CURRENT_BUFFERRAM(this)) {
 		if (area == ONENAND_DATARAM)
 			p += this->writesize;
@@ -725,9 +728,26 @@ static int s5pc110_read_bufferram(struct mtd_info *mtd, int area,
 			p += mtd->oobsize;
 	}
 
-	if (offset & 3 || (size_t) buf & 3 ||
-		!onenand->dma_addr || count != mtd->writesize)
-		goto normal;
+	return p;
+}
+
+/*
+ * Move a whole page between buf and the BufferRAM at p with the
+ * OneNAND DMA engine. Fails, for the caller to fall back to memcpy,
+ * when buf is a vmalloc buffer across a page or cannot be mapped.
+ */
+static int s5pc110_dma_bufferram(struct mtd_info *mtd, void __iomem *p,
+				 void *buf, size_t count, int direction)
+{
+	struct onenand_chip *this = mtd->priv;
+	struct device *dev = &onenand->pdev->dev;
+	enum dma_data_direction dir;
+	dma_addr_t dma_ram, dma_buf;
+	int err, ofs, page_dma = 0;
+
+	dir = direction == S5PC110_DMA_DIR_READ ? DMA_FROM_DEVICE :
+						  DMA_TO_DEVICE;
+	dma_ram = onenand->phys_base + (p - this->base);
 
 	/* Handle vmalloc address */
 	if (buf >= high_memory) {
@@ -735,36 +755,53 @@ static int s5pc110_read_bufferram(struct mtd_info *mtd, int area,
 
 		if (((size_t) buf & PAGE_MASK) !=
 		    ((size_t) (buf + count - 1) & PAGE_MASK))
-			goto normal;
+			return -EINVAL;
 		page = vmalloc_to_page(buf);
 		if (!page)
-			goto normal;
+			return -EINVAL;
 
 		/* Page offset */
 		ofs = ((size_t) buf & ~PAGE_MASK);
 		page_dma = 1;
 
-		/* DMA routine */
-		dma_src = onenand->phys_base + (p - this->base);
-		dma_dst = dma_map_page(dev, page, ofs, count, DMA_FROM_DEVICE);
+		dma_buf = dma_map_page(dev, page, ofs, count, dir);
 	} else {
-		/* DMA routine */
-		dma_src = onenand->phys_base + (p - this->base);
-		dma_dst = dma_map_single(dev, buf, count, DMA_FROM_DEVICE);
+		dma_buf = dma_map_single(dev, buf, count, dir);
 	}
-	if (dma_mapping_error(dev, dma_dst)) {
+	if (dma_mapping_error(dev, dma_buf)) {
 		dev_err(dev, "Couldn't map a %d byte buffer for DMA\n", count);
-		goto normal;
+		return -ENOMEM;
 	}
-	err = s5pc110_dma_ops((void *) dma_dst, (void *) dma_src,
-			count, S5PC110_DMA_DIR_READ);
+
+	if (direction == S5PC110_DMA_DIR_READ)
+		err = s5pc110_dma_ops((void *) dma_buf, (void *) dma_ram,
+				count, direction);
+	else
+		err = s5pc110_dma_ops((void *) dma_ram, (void *) dma_buf,
+				count, direction);
 
 	if (page_dma)
-		dma_unmap_page(dev, dma_dst, count, DMA_FROM_DEVICE);
+		dma_unmap_page(dev, dma_buf, count, dir);
 	else
-		dma_unmap_single(dev, dma_dst, count, DMA_FROM_DEVICE);
+		dma_unmap_single(dev, dma_buf, count, dir);
+
+	return err;
+}
+
+static int s5pc110_read_bufferram(struct mtd_info *mtd, int area,
+		unsigned char *buffer, int offset, size_t count)
+{
+	struct onenand_chip *this = mtd->priv;
+	void __iomem *p;
+	void *buf = (void *) buffer;
+
+	p = s5pc110_bufferram(mtd, area);
+
+	if (offset & 3 || (size_t) buf & 3 ||
+		!onenand->dma_addr || count != mtd->writesize)
+		goto normal;
 
-	if (!err)
+	if (!s5pc110_dma_bufferram(mtd, p, buf, count, S5PC110_DMA_DIR_READ))
 		return 0;
 
 normal:
@@ -779,6 +816,44 @@ normal:
 	return 0;
 }
 
+static int s5pc110_write_bufferram(struct mtd_info *mtd, int area,
+		const unsigned char *buffer, int offset, size_t count)
+{
+	struct onenand_chip *this = mtd->priv;
+	void __iomem *p;
+	void *buf = (void *) buffer;
+
+	p = s5pc110_bufferram(mtd, area);
+
+	if (offset & 3 || (size_t) buf & 3 ||
+		!onenand->dma_addr || count != mtd->writesize)
+		goto normal;
+
+	if (!s5pc110_dma_bufferram(mtd, p, buf, count, S5PC110_DMA_DIR_WRITE))
+		return 0;
+
+normal:
+	if (ONENAND_CHECK_BYTE_ACCESS(count)) {
+		unsigned short word;
+		int byte_offset;
+
+		/* Align with word(16-bit) size */
+		count--;
+
+		/* Calculate byte access offset */
+		byte_offset = offset + count;
+
+		/* Read word and save byte */
+		word = this->read_word(p + byte_offset);
+		word = (word & ~0xff) | buffer[count];
+		this->write_word(word, p + byte_offset);
+	}
+
+	memcpy(p + offset, buffer, count);
+
+	return 0;
+}
+
 static int s5pc110_chip_probe(struct mtd_info *mtd)
 {
 	/* Now just return 0 */
@@ -911,6 +986,7 @@ static void s3c_onenand_setup(struct mtd_info *mtd)
 	} else if (onenand->type == TYPE_S5PC110) {
 		/* Use generic onenand functions */
 		this->read_bufferram = s5pc110_read_bufferram;
+		this->write_bufferram = s5pc110_write_bufferram;
 		this->chip_probe = s5pc110_chip_probe;
 		return;
 	} else {
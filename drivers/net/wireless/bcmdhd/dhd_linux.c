@@ -42,6 +42,7 @@
 #include <linux/ethtool.h>
 #include <linux/fcntl.h>
 #include <linux/fs.h>
+#include <linux/vmalloc.h>
 
 #include <asm/uaccess.h>
 #include <asm/unaligned.h>
@@ -240,6 +241,10 @@ typedef struct dhd_info {
 	spinlock_t	sdlock;
 	spinlock_t	txqlock;
 	spinlock_t	dhd_lock;
+
+	/* Received packets, handed to GRO by rx_napi on the primary interface */
+	struct napi_struct rx_napi;
+	struct sk_buff_head rx_napi_queue;
 #ifdef DHDTHREAD
 	/* Thread based operation */
 	bool threads_only;
@@ -299,6 +304,11 @@ typedef struct dhd_info {
 	struct timer_list dtim_timer;
 	tsk_ctl_t dtim_tsk;
 #endif
+
+	/* Dongle counters when the suspend offload profile was applied */
+	bool offload_active;
+	uint32 offload_dropped_base;
+	uint32 offload_arp_base;
 } dhd_info_t;
 
 
@@ -360,6 +370,15 @@ module_param(dhd_pkt_filter_init, uint, 0);
 uint dhd_master_mode = TRUE;
 module_param(dhd_master_mode, uint, 0);
 
+/* Host wakeups the suspend offload profile saved: frames the dongle
+ * dropped as not unicast, and ARP requests it answered itself
+ */
+uint dhd_offload_pkts_dropped = 0;
+module_param(dhd_offload_pkts_dropped, uint, 0444);
+
+uint dhd_offload_arp_replies = 0;
+module_param(dhd_offload_arp_replies, uint, 0444);
+
 #ifdef DHDTHREAD
 /* Watchdog thread priority, -1 to use kernel timer */
 int dhd_watchdog_prio = 0;
@@ -409,6 +428,10 @@ extern uint dhd_rxbound;
 module_param(dhd_txbound, uint, 0);
 module_param(dhd_rxbound, uint, 0);
 
+/* Send queued tx frames as superframes if the dongle takes them */
+uint dhd_txglom = TRUE;
+module_param(dhd_txglom, uint, 0);
+
 /* Deferred transmits */
 extern uint dhd_deferred_tx;
 module_param(dhd_deferred_tx, uint, 0);
@@ -539,6 +562,65 @@ static void dhd_set_packet_filter(int value, dhd_pub_t *dhd)
 #endif
 }
 
+/* Reads the dongle counters of the frames the suspend offloads kept from the host */
+static void dhd_offload_counters(dhd_pub_t *dhd, uint32 *dropped, uint32 *arp)
+{
+	char iovbuf[WLC_IOCTL_SMLEN];
+#ifdef PKT_FILTER_SUPPORT
+	wl_pkt_filter_stats_t *fstats = (wl_pkt_filter_stats_t *)iovbuf;
+	uint32 id;
+#endif
+#ifdef ARP_OFFLOAD_SUPPORT
+	struct arp_ol_stats_t *astats = (struct arp_ol_stats_t *)iovbuf;
+#endif
+
+	*dropped = *arp = 0;
+
+#ifdef PKT_FILTER_SUPPORT
+	if (dhd->pktfilter[DHD_UNICAST_FILTER_NUM]) {
+		id = htod32(simple_strtoul(dhd->pktfilter[DHD_UNICAST_FILTER_NUM],
+			NULL, 0));
+		bcm_mkiovar("pkt_filter_stats", (char *)&id, sizeof(id),
+			iovbuf, sizeof(iovbuf));
+		if (dhd_wl_ioctl_cmd(dhd, WLC_GET_VAR, iovbuf, sizeof(iovbuf),
+			FALSE, 0) >= 0)
+			*dropped = dtoh32(fstats->num_pkts_discarded);
+	}
+#endif
+#ifdef ARP_OFFLOAD_SUPPORT
+	bcm_mkiovar("arp_stats", NULL, 0, iovbuf, sizeof(iovbuf));
+	if (dhd_wl_ioctl_cmd(dhd, WLC_GET_VAR, iovbuf, sizeof(iovbuf),
+		FALSE, 0) >= 0)
+		*arp = dtoh32(astats->peer_service);
+#endif
+}
+
+static void dhd_offload_begin(dhd_pub_t *dhd)
+{
+	dhd_info_t *dhdi = (dhd_info_t *)dhd->info;
+
+	dhd_offload_counters(dhd, &dhdi->offload_dropped_base,
+		&dhdi->offload_arp_base);
+	dhdi->offload_active = TRUE;
+}
+
+static void dhd_offload_end(dhd_pub_t *dhd)
+{
+	dhd_info_t *dhdi = (dhd_info_t *)dhd->info;
+	uint32 dropped, arp;
+
+	if (!dhdi->offload_active)
+		return;
+	dhdi->offload_active = FALSE;
+
+	dhd_offload_counters(dhd, &dropped, &arp);
+	/* the dongle may have been reset meanwhile */
+	if (dropped >= dhdi->offload_dropped_base)
+		dhd_offload_pkts_dropped += dropped - dhdi->offload_dropped_base;
+	if (arp >= dhdi->offload_arp_base)
+		dhd_offload_arp_replies += arp - dhdi->offload_arp_base;
+}
+
 #ifdef DYNAMIC_DTIM_SKIP
 static int
 dhd_dtim_thread(void *data)
@@ -678,11 +760,14 @@ static int dhd_set_suspend(int value, dhd_pub_t *dhd)
 #ifdef DYNAMIC_DTIM_SKIP
 			dhd_dynamic_dtim_skip_init(dhd);
 #endif
+			dhd_offload_begin(dhd);
 		} else {
 
 			/* Kernel resumed  */
 			DHD_ERROR(("%s: Remove extra suspend setting\n", __FUNCTION__));
 
+			dhd_offload_end(dhd);
+
 #if !defined(SUPPORT_PM2_ONLY)
 			power_mode = PM_FAST;
 			dhd_wl_ioctl_cmd(dhd, WLC_SET_PM, (char *)&power_mode,
@@ -1528,6 +1613,68 @@ dhd_txflowcontrol(dhd_pub_t *dhdp, int ifidx, bool state)
 	}
 }
 
+#define DHD_RX_NAPI_WEIGHT	64
+/* Packets queued for rx_napi at most, more are dropped as by netif_rx() */
+#define DHD_RX_NAPI_QLEN	1000
+
+static int
+dhd_rx_napi_poll(struct napi_struct *napi, int budget)
+{
+	dhd_info_t *dhd = container_of(napi, dhd_info_t, rx_napi);
+	struct sk_buff *skb;
+	int done = 0;
+
+	while (done < budget) {
+		skb = skb_dequeue(&dhd->rx_napi_queue);
+		if (!skb)
+			break;
+
+		napi_gro_receive(napi, skb);
+		done++;
+	}
+
+	if (done < budget) {
+		napi_complete(napi);
+		/* queued after the last dequeue, while still scheduled */
+		if (!skb_queue_empty(&dhd->rx_napi_queue))
+			napi_schedule(napi);
+	}
+
+	return done;
+}
+
+static void
+dhd_rx_napi_kick(dhd_info_t *dhd)
+{
+	if (skb_queue_empty(&dhd->rx_napi_queue))
+		return;
+
+	if (in_interrupt()) {
+		napi_schedule(&dhd->rx_napi);
+	} else {
+		/* run the poll now, as netif_rx_ni() would */
+		local_bh_disable();
+		napi_schedule(&dhd->rx_napi);
+		local_bh_enable();
+	}
+}
+
+/* Before net, which carries rx_napi, goes: drop what is still queued */
+static void
+dhd_rx_napi_del(dhd_info_t *dhd, struct net_device *net)
+{
+	if (dhd->rx_napi.dev != net)
+		return;
+
+	/* packets from now on take netif_rx() */
+	dhd->rx_napi.dev = NULL;
+	smp_wmb();
+
+	napi_disable(&dhd->rx_napi);
+	skb_queue_purge(&dhd->rx_napi_queue);
+	netif_napi_del(&dhd->rx_napi);
+}
+
 void
 dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 {
@@ -1667,7 +1814,19 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 		dhdp->dstats.rx_bytes += skb->len;
 		dhdp->rx_packets++; /* Local count */
 
-		if (in_interrupt()) {
+		/*
+		 * Everything the bus read in this pass goes through GRO in
+		 * one NAPI poll, so TCP segments of a download are merged
+		 * before they reach the stack.
+		 */
+		if (dhd->rx_napi.dev) {
+			if (skb_queue_len(&dhd->rx_napi_queue) < DHD_RX_NAPI_QLEN) {
+				skb_queue_tail(&dhd->rx_napi_queue, skb);
+			} else {
+				dhdp->rx_dropped++;
+				dev_kfree_skb_any(skb);
+			}
+		} else if (in_interrupt()) {
 			netif_rx(skb);
 		} else {
 			/* If the receive is not processed inside an ISR,
@@ -1688,6 +1847,8 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 		}
 	}
 
+	dhd_rx_napi_kick(dhd);
+
 	DHD_OS_WAKE_LOCK_RX_TIMEOUT_ENABLE(dhdp, tout_rx);
 	DHD_OS_WAKE_LOCK_CTRL_TIMEOUT_ENABLE(dhdp, tout_ctrl);
 }
@@ -2633,6 +2794,7 @@ dhd_add_if(dhd_info_t *dhd, int ifidx, void *handle, char *name,
 	if (ifp != NULL) {
 		if (ifp->net != NULL) {
 			netif_stop_queue(ifp->net);
+			dhd_rx_napi_del(dhd, ifp->net);
 			unregister_netdev(ifp->net);
 			free_netdev(ifp->net);
 		}
@@ -2781,6 +2943,7 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 	/* Initialize the spinlocks */
 	spin_lock_init(&dhd->sdlock);
 	spin_lock_init(&dhd->txqlock);
+	skb_queue_head_init(&dhd->rx_napi_queue);
 	spin_lock_init(&dhd->dhd_lock);
 
 
@@ -2879,7 +3042,8 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 
 #ifdef DYNAMIC_DTIM_SKIP
 	dhd->dtim_tsk.thr_pid = -1;
-	init_timer(&dhd->dtim_timer);
+	/* polls rx counts while suspended, rx interrupts wake the cpu anyway */
+	init_timer_deferrable(&dhd->dtim_timer);
 	dhd->dtim_timer.data = (ulong)dhd;
 	dhd->dtim_timer.function = dhd_dynamic_dtim_func;
 	PROC_START(dhd_dtim_thread, dhd, &dhd->dtim_tsk, 0);
@@ -3101,6 +3265,7 @@ dhd_preinit_ioctls(dhd_pub_t *dhd)
 	uint power_mode = PM_FAST;
 	uint32 dongle_align = DHD_SDALIGN;
 	uint32 glom = 0;
+	uint32 rxglom = 1;
 	uint bcn_timeout = DHD_BEACON_TIMEOUT_NORMAL;
 
 	uint retry_max = 3;
@@ -3309,6 +3474,15 @@ dhd_preinit_ioctls(dhd_pub_t *dhd)
 		dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0);
 	}
 
+	/* Ask the dongle to take superframes, keep single frames if it refuses */
+	if (dhd_txglom) {
+		bcm_mkiovar("bus:rxglom", (char *)&rxglom, 4, iovbuf, sizeof(iovbuf));
+		if (dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0) < 0)
+			DHD_INFO(("%s: dongle does not take tx superframes\n", __FUNCTION__));
+		else
+			dhd_bus_txglom_enable(dhd);
+	}
+
 	/* Setup timeout if Beacons are lost and roam is off to report link down */
 	bcm_mkiovar("bcn_timeout", (char *)&bcn_timeout, 4, iovbuf, sizeof(iovbuf));
 	dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0);
@@ -3727,6 +3901,13 @@ dhd_net_attach(dhd_pub_t *dhdp, int ifidx)
 
 	memcpy(net->dev_addr, temp_addr, ETHER_ADDR_LEN);
 
+	/* One context for all interfaces, GRO keeps their flows apart */
+	if (ifidx == 0 && !dhd->rx_napi.dev) {
+		netif_napi_add(net, &dhd->rx_napi, dhd_rx_napi_poll,
+			DHD_RX_NAPI_WEIGHT);
+		napi_enable(&dhd->rx_napi);
+	}
+
 	if ((err = register_netdev(net)) != 0) {
 		DHD_ERROR(("couldn't register the net device, err %d\n", err));
 		goto fail;
@@ -3863,6 +4044,7 @@ void dhd_detach(dhd_pub_t *dhdp)
 #endif
 		{
 			if (ifp->net) {
+				dhd_rx_napi_del(dhd, ifp->net);
 				unregister_netdev(ifp->net);
 				free_netdev(ifp->net);
 				ifp->net = NULL;
@@ -3945,6 +4127,8 @@ dhd_free(dhd_pub_t *dhdp)
 	}
 }
 
+static void dhd_image_cache_free(void);
+
 static void __exit
 dhd_module_cleanup(void)
 {
@@ -3959,6 +4143,8 @@ dhd_module_cleanup(void)
 
 	/* Call customer gpio to turn off power with WL_REG_ON signal */
 	dhd_customer_gpio_wlan_ctrl(WLAN_POWER_OFF);
+
+	dhd_image_cache_free();
 }
 
 static int __init
@@ -4156,36 +4342,157 @@ dhd_os_wd_timer(void *bus, uint wdtick)
 	dhd_os_spin_unlock(pub, flags);
 }
 
+/*
+ * Firmware and NVRAM images are read whole and kept, so that turning WiFi
+ * back on (e.g. out of airplane mode) does not read them from flash again.
+ * An entry is only used while its file keeps the size and mtime it was read
+ * with. dhd_image_lock is held from open to close of an image.
+ */
+#define DHD_IMAGE_CACHE_SIZE	2
+#define DHD_IMAGE_MAX_SIZE	(1024 * 1024)
+
+typedef struct dhd_image_entry {
+	char *path;
+	char *data;
+	loff_t size;
+	struct timespec mtime;
+} dhd_image_entry_t;
+
+typedef struct dhd_image {
+	dhd_image_entry_t *entry;
+	loff_t pos;
+} dhd_image_t;
+
+/* Keep images in memory between downloads */
+uint dhd_cache_images = TRUE;
+module_param(dhd_cache_images, uint, 0644);
+
+static dhd_image_entry_t dhd_image_cache[DHD_IMAGE_CACHE_SIZE];
+static int dhd_image_next;		/* entry to replace next */
+static DEFINE_MUTEX(dhd_image_lock);
+
+static void
+dhd_image_entry_free(dhd_image_entry_t *entry)
+{
+	vfree(entry->data);
+	kfree(entry->path);
+	memset(entry, 0, sizeof(*entry));
+}
+
+static void
+dhd_image_cache_free(void)
+{
+	int i;
+
+	mutex_lock(&dhd_image_lock);
+	for (i = 0; i < DHD_IMAGE_CACHE_SIZE; i++)
+		dhd_image_entry_free(&dhd_image_cache[i]);
+	mutex_unlock(&dhd_image_lock);
+}
+
+static dhd_image_entry_t *
+dhd_image_lookup(char *filename, struct file *fp)
+{
+	struct inode *inode = fp->f_path.dentry->d_inode;
+	loff_t size = i_size_read(inode);
+	dhd_image_entry_t *entry;
+	loff_t pos = 0;
+	int i, rdlen;
+
+	for (i = 0; i < DHD_IMAGE_CACHE_SIZE; i++) {
+		entry = &dhd_image_cache[i];
+		if (!entry->path || strcmp(entry->path, filename))
+			continue;
+		if (entry->size == size &&
+		    timespec_equal(&entry->mtime, &inode->i_mtime))
+			return entry;
+		/* the file changed since */
+		dhd_image_entry_free(entry);
+		break;
+	}
+
+	if (size <= 0 || size > DHD_IMAGE_MAX_SIZE) {
+		DHD_ERROR(("%s: %s has bad size %lld\n", __FUNCTION__,
+			filename, (long long)size));
+		return NULL;
+	}
+
+	if (i == DHD_IMAGE_CACHE_SIZE) {
+		for (i = 0; i < DHD_IMAGE_CACHE_SIZE; i++)
+			if (!dhd_image_cache[i].path)
+				break;
+		if (i == DHD_IMAGE_CACHE_SIZE) {
+			i = dhd_image_next;
+			dhd_image_next = (i + 1) % DHD_IMAGE_CACHE_SIZE;
+		}
+	}
+	entry = &dhd_image_cache[i];
+	dhd_image_entry_free(entry);
+
+	entry->data = vmalloc(size);
+	entry->path = kstrdup(filename, GFP_KERNEL);
+	if (!entry->data || !entry->path)
+		goto err;
+
+	while (pos < size) {
+		rdlen = kernel_read(fp, pos, entry->data + pos, size - pos);
+		if (rdlen <= 0)
+			goto err;
+		pos += rdlen;
+	}
+	entry->size = size;
+	entry->mtime = inode->i_mtime;
+
+	return entry;
+
+err:
+	DHD_ERROR(("%s: failed to read %s\n", __FUNCTION__, filename));
+	dhd_image_entry_free(entry);
+	return NULL;
+}
+
 void *
 dhd_os_open_image(char *filename)
 {
 	struct file *fp;
+	dhd_image_t *image = NULL;
+	dhd_image_entry_t *entry;
+
+	mutex_lock(&dhd_image_lock);
 
 	fp = filp_open(filename, O_RDONLY, 0);
-	/*
-	 * 2.6.11 (FC4) supports filp_open() but later revs don't?
-	 * Alternative:
-	 * fp = open_namei(AT_FDCWD, filename, O_RD, 0);
-	 * ???
-	 */
-	 if (IS_ERR(fp))
-		 fp = NULL;
+	if (IS_ERR(fp))
+		goto out;
+
+	entry = dhd_image_lookup(filename, fp);
+	filp_close(fp, NULL);
+	if (!entry)
+		goto out;
 
-	 return fp;
+	image = kmalloc(sizeof(*image), GFP_KERNEL);
+	if (image) {
+		image->entry = entry;
+		image->pos = 0;
+	}
+
+out:
+	if (!image)
+		mutex_unlock(&dhd_image_lock);
+	return image;
 }
 
 int
 dhd_os_get_image_block(char *buf, int len, void *image)
 {
-	struct file *fp = (struct file *)image;
+	dhd_image_t *img = (dhd_image_t *)image;
 	int rdlen;
 
 	if (!image)
 		return 0;
 
-	rdlen = kernel_read(fp, fp->f_pos, buf, len);
-	if (rdlen > 0)
-		fp->f_pos += rdlen;
+	rdlen = MIN(len, img->entry->size - img->pos);
+	memcpy(buf, img->entry->data + img->pos, rdlen);
+	img->pos += rdlen;
 
 	return rdlen;
 }
@@ -4193,8 +4500,15 @@ dhd_os_get_image_block(char *buf, int len, void *image)
 void
 dhd_os_close_image(void *image)
 {
-	if (image)
-		filp_close((struct file *)image, NULL);
+	dhd_image_t *img = (dhd_image_t *)image;
+
+	if (!image)
+		return;
+
+	if (!dhd_cache_images)
+		dhd_image_entry_free(img->entry);
+	kfree(img);
+	mutex_unlock(&dhd_image_lock);
 }
 
 
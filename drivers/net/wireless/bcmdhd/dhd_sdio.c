@@ -83,7 +83,12 @@
 
 #define DHD_TXMINMAX	1	/* Max tx frames if rx still pending */
 
-#define MEMBLOCK	2048		/* Block size used for downloading of dongle image */
+/* With adaptbound, the bounds move between these multiples of txbound/rxbound */
+#define DHD_ADAPT_MIN(b)	MAX((b) / 4, 1)
+#define DHD_ADAPT_MAX(b)	((b) * 4)
+#define DHD_ADAPT_GLOM_BULK	4	/* Packets per superframe meaning bulk rx */
+
+#define MEMBLOCK	8192		/* Block size used for downloading of dongle image */
 #define MAX_NVRAMBUF_SIZE	4096	/* max nvram buf size */
 #define MAX_DATA_BUF	(32 * 1024)	/* Must be large enough to hold biggest possible glom */
 
@@ -96,10 +101,17 @@
 
 /* Total length of frame header for dongle protocol */
 #define SDPCM_HDRLEN	(SDPCM_FRAMETAG_LEN + SDPCM_SWHEADER_LEN)
+
+/* HW header extension carried by every tx frame once the dongle takes superframes */
+#define SDPCM_HWEXT_LEN	8
+#define SDPCM_TXHDREXT(bus)	((bus)->txglom ? SDPCM_HWEXT_LEN : 0)
+
+#define DHD_TXGLOM_MAX		16		/* Max frames in one tx superframe */
+#define DHD_TXGLOM_BUFSZ	(16 * 1024)	/* Max bytes in one tx superframe */
 #ifdef SDTEST
-#define SDPCM_RESERVE	(SDPCM_HDRLEN + SDPCM_TEST_HDRLEN + DHD_SDALIGN)
+#define SDPCM_RESERVE	(SDPCM_HDRLEN + SDPCM_HWEXT_LEN + SDPCM_TEST_HDRLEN + DHD_SDALIGN)
 #else
-#define SDPCM_RESERVE	(SDPCM_HDRLEN + DHD_SDALIGN)
+#define SDPCM_RESERVE	(SDPCM_HDRLEN + SDPCM_HWEXT_LEN + DHD_SDALIGN)
 #endif
 
 /* Space for header read, limit for data packets */
@@ -301,6 +313,19 @@ typedef struct dhd_bus {
 	uint32		ctrl_frame_len;
 	bool		ctrl_frame_stat;
 	uint32		rxint_mode;	/* rx interrupt mode */
+
+	uint		cur_rxbound;		/* Adapted rx frames per DPC */
+	uint		cur_txbound;		/* Adapted tx frames per DPC */
+	uint		adapt_grow;		/* Count of bound increases */
+	uint		adapt_shrink;		/* Count of bound decreases */
+	uint		adapt_glomframes;	/* rxglomframes at the last DPC */
+	uint		adapt_glompkts;		/* rxglompkts at the last DPC */
+
+	bool		txglom;			/* Dongle takes tx superframes */
+	uint8		*txglom_buf;		/* Buffer the superframes are built in */
+	uint8		*txglom_ptr;		/* Aligned pointer into txglom_buf */
+	uint		txglomframes;		/* Number of tx superframes */
+	uint		txglompkts;		/* Number of packets sent in them */
 } dhd_bus_t;
 
 /* clkstate */
@@ -332,6 +357,7 @@ uint dhd_txminmax = DHD_TXMINMAX;
 int dhd_dongle_memsize;
 
 static bool dhd_doflow;
+static bool dhd_adaptbound;
 static bool dhd_alignctl;
 
 static bool sd1idle;
@@ -935,6 +961,17 @@ dhd_enable_oob_intr(struct dhd_bus *bus, bool enable)
 }
 #endif /* defined(OOB_INTR_ONLY) */
 
+/* Fills the HW header extension after the HW tag already in frame */
+static void
+dhdsdio_txhdrext(uint8 *frame, bool lastfrm, uint tailpad)
+{
+	uint16 len = ltoh16(*(uint16 *)frame);
+
+	htol32_ua_store((len - SDPCM_FRAMETAG_LEN) | (lastfrm ? (1 << 24) : 0),
+	                frame + SDPCM_FRAMETAG_LEN);
+	htol32_ua_store((tailpad & 0xffff) << 16, frame + SDPCM_FRAMETAG_LEN + 4);
+}
+
 /* Writes a HW/SW header into the packet and sends it. */
 /* Assumes: (a) header space already there, (b) caller holds lock */
 static int
@@ -949,6 +986,7 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 	bcmsdh_info_t *sdh;
 	void *new;
 	int i;
+	uint hdrext = 0;
 #ifdef WLMEDIA_HTSF
 	char *p;
 	htsfts_t *htsf_ts;
@@ -965,6 +1003,18 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 		goto done;
 	}
 
+	/* Room for the HW header extension, reserved through SDPCM_RESERVE */
+	if (bus->txglom) {
+		if (PKTHEADROOM(osh, pkt) < SDPCM_HWEXT_LEN) {
+			DHD_ERROR(("%s: no headroom for the HW header extension\n",
+			           __FUNCTION__));
+			ret = BCME_BUFTOOSHORT;
+			goto done;
+		}
+		hdrext = SDPCM_HWEXT_LEN;
+		PKTPUSH(osh, pkt, hdrext);
+	}
+
 	frame = (uint8*)PKTDATA(osh, pkt);
 
 #ifdef WLMEDIA_HTSF
@@ -1006,8 +1056,8 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 			PKTPUSH(osh, pkt, pad1);
 			frame = (uint8*)PKTDATA(osh, pkt);
 
-			ASSERT((pad1 + SDPCM_HDRLEN) <= (int) PKTLEN(osh, pkt));
-			bzero(frame, pad1 + SDPCM_HDRLEN);
+			ASSERT((pad1 + SDPCM_HDRLEN + hdrext) <= (int) PKTLEN(osh, pkt));
+			bzero(frame, pad1 + SDPCM_HDRLEN + hdrext);
 		}
 	}
 	ASSERT(pad1 < DHD_SDALIGN);
@@ -1019,9 +1069,9 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 
 	/* Software tag: channel, sequence number, data offset */
 	swheader = ((chan << SDPCM_CHANNEL_SHIFT) & SDPCM_CHANNEL_MASK) | bus->tx_seq |
-	        (((pad1 + SDPCM_HDRLEN) << SDPCM_DOFFSET_SHIFT) & SDPCM_DOFFSET_MASK);
-	htol32_ua_store(swheader, frame + SDPCM_FRAMETAG_LEN);
-	htol32_ua_store(0, frame + SDPCM_FRAMETAG_LEN + sizeof(swheader));
+	        (((pad1 + SDPCM_HDRLEN + hdrext) << SDPCM_DOFFSET_SHIFT) & SDPCM_DOFFSET_MASK);
+	htol32_ua_store(swheader, frame + SDPCM_FRAMETAG_LEN + hdrext);
+	htol32_ua_store(0, frame + SDPCM_FRAMETAG_LEN + hdrext + sizeof(swheader));
 
 #ifdef DHD_DEBUG
 	if (PKTPRIO(pkt) < ARRAYSIZE(tx_packets)) {
@@ -1060,6 +1110,9 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 #endif
 	}
 
+	if (hdrext)
+		dhdsdio_txhdrext(frame, TRUE, len - PKTLEN(osh, pkt));
+
 	do {
 		ret = dhd_bcmsdh_send_buf(bus, bcmsdh_cur_sbwad(sdh), SDIO_FUNC_2, F2SYNC,
 		                          frame, len, pkt, NULL, NULL);
@@ -1096,7 +1149,7 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 
 done:
 	/* restore pkt buffer pointer before calling tx complete routine */
-	PKTPULL(osh, pkt, SDPCM_HDRLEN + pad1);
+	PKTPULL(osh, pkt, SDPCM_HDRLEN + pad1 + hdrext);
 #ifdef PROP_TXSTATUS
 	if (bus->dhd->wlfc_state) {
 		dhd_os_sdunlock(bus->dhd);
@@ -1242,6 +1295,149 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 	return ret;
 }
 
+/* Sends queued data frames as one superframe; returns the number of frames */
+static uint
+dhdsdio_sendglom(dhd_bus_t *bus, uint maxframes)
+{
+	osl_t *osh = bus->dhd->osh;
+	bcmsdh_info_t *sdh = bus->sdh;
+	void *pkts[DHD_TXGLOM_MAX];
+	uint8 *frame = NULL;
+	uint8 seq = bus->tx_seq;
+	uint hdrlen = SDPCM_HDRLEN + SDPCM_HWEXT_LEN;
+	uint total = 0, sublen, datalen, tailpad = 0;
+	uint32 swheader;
+	uint cnt, i;
+	int ret, prec_out;
+
+#ifdef SDTEST
+	if (bus->ext_loop)
+		return 0;
+#endif
+	maxframes = MIN(maxframes, DHD_TXGLOM_MAX);
+
+	/* Same credit check as DATAOK(), against the frames taken so far */
+	for (cnt = 0; cnt < maxframes; cnt++) {
+		if (((uint8)(bus->tx_max - seq) <= 1) || ((uint8)(bus->tx_max - seq) & 0x80))
+			break;
+
+		dhd_os_sdlock_txq(bus->dhd);
+		pkts[cnt] = pktq_mdeq(&bus->txq, ~bus->flowcontrol, &prec_out);
+		if (pkts[cnt] == NULL) {
+			dhd_os_sdunlock_txq(bus->dhd);
+			break;
+		}
+
+		/* Queued packets carry SDPCM_HDRLEN of header space */
+		datalen = PKTLEN(osh, pkts[cnt]) - SDPCM_HDRLEN;
+		sublen = hdrlen + datalen;
+		if (total + ROUNDUP(sublen, ALIGNMENT) > DHD_TXGLOM_BUFSZ) {
+			pktq_penq_head(&bus->txq, prec_out, pkts[cnt]);
+			dhd_os_sdunlock_txq(bus->dhd);
+			break;
+		}
+		dhd_os_sdunlock_txq(bus->dhd);
+
+		frame = bus->txglom_ptr + total;
+		bcopy(PKTDATA(osh, pkts[cnt]) + SDPCM_HDRLEN, frame + hdrlen, datalen);
+
+		*(uint16*)frame = htol16((uint16)sublen);
+		*(((uint16*)frame) + 1) = htol16(~sublen);
+		tailpad = ROUNDUP(sublen, ALIGNMENT) - sublen;
+		dhdsdio_txhdrext(frame, FALSE, tailpad);
+
+		swheader = ((SDPCM_DATA_CHANNEL << SDPCM_CHANNEL_SHIFT) & SDPCM_CHANNEL_MASK) |
+		        seq | ((hdrlen << SDPCM_DOFFSET_SHIFT) & SDPCM_DOFFSET_MASK);
+		htol32_ua_store(swheader, frame + SDPCM_FRAMETAG_LEN + SDPCM_HWEXT_LEN);
+		htol32_ua_store(0, frame + hdrlen - sizeof(swheader));
+
+		seq = (seq + 1) % SDPCM_SEQUENCE_WRAP;
+		total += ROUNDUP(sublen, ALIGNMENT);
+	}
+
+	if (cnt == 0)
+		return 0;
+
+	/* The last frame is padded out to the block like a single one */
+	sublen = total;
+	if (bus->roundup && bus->blocksize && (total > bus->blocksize)) {
+		uint pad2 = bus->blocksize - (total % bus->blocksize);
+		if ((pad2 <= bus->roundup) && (pad2 < bus->blocksize) &&
+		    (total + pad2 <= DHD_TXGLOM_BUFSZ))
+			total += pad2;
+	} else if (total % DHD_SDALIGN) {
+		total += DHD_SDALIGN - (total % DHD_SDALIGN);
+	}
+	dhdsdio_txhdrext(frame, TRUE, tailpad + total - sublen);
+
+	ret = dhd_bcmsdh_send_buf(bus, bcmsdh_cur_sbwad(sdh), SDIO_FUNC_2, F2SYNC,
+	                          bus->txglom_ptr, total, NULL, NULL, NULL);
+	bus->f2txdata++;
+	ASSERT(ret != BCME_PENDING);
+
+	if (ret < 0) {
+		DHD_INFO(("%s: sdio error %d, abort command and terminate frame.\n",
+		          __FUNCTION__, ret));
+		bus->tx_sderrs++;
+
+		bcmsdh_abort(sdh, SDIO_FUNC_2);
+		bcmsdh_cfg_write(sdh, SDIO_FUNC_1, SBSDIO_FUNC1_FRAMECTRL,
+		                 SFC_WF_TERM, NULL);
+		bus->f1regdata++;
+
+		for (i = 0; i < 3; i++) {
+			uint8 hi, lo;
+			hi = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
+			                     SBSDIO_FUNC1_WFRAMEBCHI, NULL);
+			lo = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
+			                     SBSDIO_FUNC1_WFRAMEBCLO, NULL);
+			bus->f1regdata += 2;
+			if ((hi == 0) && (lo == 0))
+				break;
+		}
+	} else {
+		bus->tx_seq = seq;
+		bus->txglomframes++;
+		bus->txglompkts += cnt;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		PKTPULL(osh, pkts[i], SDPCM_HDRLEN);
+		if (ret)
+			bus->dhd->tx_errors++;
+		else
+			bus->dhd->dstats.tx_bytes += PKTLEN(osh, pkts[i]);
+		dhd_txcomplete(bus->dhd, pkts[i], ret != 0);
+		PKTFREE(osh, pkts[i], TRUE);
+	}
+
+	return cnt;
+}
+
+/* Called once the dongle has accepted bus:rxglom */
+int
+dhd_bus_txglom_enable(dhd_pub_t *dhdp)
+{
+	dhd_bus_t *bus = dhdp->bus;
+
+	if (!bus->txglom_buf) {
+		bus->txglom_buf = MALLOC(dhdp->osh, DHD_TXGLOM_BUFSZ + DHD_SDALIGN);
+		if (!bus->txglom_buf) {
+			DHD_ERROR(("%s: no memory for the tx superframe buffer\n",
+			           __FUNCTION__));
+			return BCME_NOMEM;
+		}
+		bus->txglom_ptr = (uint8 *)ROUNDUP((uintptr)bus->txglom_buf, DHD_SDALIGN);
+	}
+
+	dhd_os_sdlock(dhdp);
+	bus->txglom = TRUE;
+	dhd_os_sdunlock(dhdp);
+
+	DHD_INFO(("%s: tx superframes on\n", __FUNCTION__));
+	return BCME_OK;
+}
+
 static uint
 dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 {
@@ -1262,6 +1458,16 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 
 	/* Send frames until the limit or some other event */
 	for (cnt = 0; (cnt < maxframes) && DATAOK(bus); cnt++) {
+		if (bus->txglom && (maxframes - cnt > 1) &&
+		    (pktq_mlen(&bus->txq, tx_prec_map) > 1)) {
+			uint sent = dhdsdio_sendglom(bus, maxframes - cnt);
+
+			if (sent) {
+				cnt += sent - 1;
+				continue;
+			}
+		}
+
 		dhd_os_sdlock_txq(bus->dhd);
 		if ((pkt = pktq_mdeq(&bus->txq, tx_prec_map, &prec_out)) == NULL) {
 			dhd_os_sdunlock_txq(bus->dhd);
@@ -1311,6 +1517,7 @@ dhd_bus_txctl(struct dhd_bus *bus, uchar *msg, uint msglen)
 	uint retries = 0;
 	bcmsdh_info_t *sdh = bus->sdh;
 	uint8 doff = 0;
+	uint hdrext;
 	int ret = -1;
 	int i;
 
@@ -1320,8 +1527,9 @@ dhd_bus_txctl(struct dhd_bus *bus, uchar *msg, uint msglen)
 		return -EIO;
 
 	/* Back the pointer to make a room for bus header */
-	frame = msg - SDPCM_HDRLEN;
-	len = (msglen += SDPCM_HDRLEN);
+	hdrext = SDPCM_TXHDREXT(bus);
+	frame = msg - SDPCM_HDRLEN - hdrext;
+	len = (msglen += SDPCM_HDRLEN + hdrext);
 
 	/* Add alignment padding (optional for ctl frames) */
 	if (dhd_alignctl) {
@@ -1329,11 +1537,11 @@ dhd_bus_txctl(struct dhd_bus *bus, uchar *msg, uint msglen)
 			frame -= doff;
 			len += doff;
 			msglen += doff;
-			bzero(frame, doff + SDPCM_HDRLEN);
+			bzero(frame, doff + SDPCM_HDRLEN + hdrext);
 		}
 		ASSERT(doff < DHD_SDALIGN);
 	}
-	doff += SDPCM_HDRLEN;
+	doff += SDPCM_HDRLEN + hdrext;
 
 	/* Round send length to next SDIO block */
 	if (bus->roundup && bus->blocksize && (len > bus->blocksize)) {
@@ -1363,11 +1571,14 @@ dhd_bus_txctl(struct dhd_bus *bus, uchar *msg, uint msglen)
 	*(uint16*)frame = htol16((uint16)msglen);
 	*(((uint16*)frame) + 1) = htol16(~msglen);
 
+	if (hdrext)
+		dhdsdio_txhdrext(frame, TRUE, len - msglen);
+
 	/* Software tag: channel, sequence number, data offset */
 	swheader = ((SDPCM_CONTROL_CHANNEL << SDPCM_CHANNEL_SHIFT) & SDPCM_CHANNEL_MASK)
 	        | bus->tx_seq | ((doff << SDPCM_DOFFSET_SHIFT) & SDPCM_DOFFSET_MASK);
-	htol32_ua_store(swheader, frame + SDPCM_FRAMETAG_LEN);
-	htol32_ua_store(0, frame + SDPCM_FRAMETAG_LEN + sizeof(swheader));
+	htol32_ua_store(swheader, frame + SDPCM_FRAMETAG_LEN + hdrext);
+	htol32_ua_store(0, frame + SDPCM_FRAMETAG_LEN + hdrext + sizeof(swheader));
 
 	if (!TXCTLOK(bus)) {
 		DHD_INFO(("%s: No bus credit bus->tx_max %d, bus->tx_seq %d\n",
@@ -1560,6 +1771,7 @@ enum {
 	IOV_SLEEP,
 	IOV_DONGLEISOLATION,
 	IOV_VARS,
+	IOV_ADAPTBOUND,
 #ifdef SOFTAP
 	IOV_FWPATH
 #endif
@@ -1583,6 +1795,7 @@ const bcm_iovar_t dhdsdio_iovars[] = {
 	{"alignctl",	IOV_ALIGNCTL,	0,	IOVT_BOOL,	0 },
 	{"sdalign",	IOV_SDALIGN,	0,	IOVT_BOOL,	0 },
 	{"devreset",	IOV_DEVRESET,	0,	IOVT_BOOL,	0 },
+	{"adaptbound",	IOV_ADAPTBOUND,	0,	IOVT_BOOL,	0 },
 #ifdef DHD_DEBUG
 	{"sdreg",	IOV_SDREG,	0,	IOVT_BUFFER,	sizeof(sdreg_t) },
 	{"sbreg",	IOV_SBREG,	0,	IOVT_BUFFER,	sizeof(sdreg_t) },
@@ -1622,6 +1835,74 @@ dhd_dump_pct(struct bcmstrbuf *strbuf, char *desc, uint num, uint div)
 	}
 }
 
+/* Frames per DPC pass: the iovar value, or where adaptbound has moved it */
+static uint
+dhdsdio_bound(uint cur, uint nominal)
+{
+	if (!dhd_adaptbound || !nominal || !cur)
+		return nominal;
+
+	return MIN(MAX(cur, DHD_ADAPT_MIN(nominal)), DHD_ADAPT_MAX(nominal));
+}
+
+static uint
+dhdsdio_rxbound(dhd_bus_t *bus)
+{
+	return dhdsdio_bound(bus->cur_rxbound, dhd_rxbound);
+}
+
+static uint
+dhdsdio_txbound(dhd_bus_t *bus)
+{
+	return dhdsdio_bound(bus->cur_txbound, dhd_txbound);
+}
+
+/* Grow by half while the work outlasts the bound, shrink by a quarter when it's light */
+static uint
+dhdsdio_adapt(dhd_bus_t *bus, uint cur, uint nominal, bool busy, bool light)
+{
+	if (busy && cur < DHD_ADAPT_MAX(nominal)) {
+		cur = MIN(cur + MAX(cur / 2, 1), DHD_ADAPT_MAX(nominal));
+		bus->adapt_grow++;
+	} else if (light && cur > DHD_ADAPT_MIN(nominal)) {
+		cur = MAX(cur - MAX(cur / 4, 1), DHD_ADAPT_MIN(nominal));
+		bus->adapt_shrink++;
+	}
+
+	return cur;
+}
+
+/* Called at the end of a DPC pass with the limits it started with */
+static void
+dhdsdio_adapt_bounds(dhd_bus_t *bus, uint rxbound, uint rxcnt, bool rxdone,
+	uint txbound)
+{
+	uint glomframes = bus->rxglomframes - bus->adapt_glomframes;
+	uint glompkts = bus->rxglompkts - bus->adapt_glompkts;
+	uint txqlen = pktq_mlen(&bus->txq, ~bus->flowcontrol);
+	bool rxbulk;
+
+	bus->adapt_glomframes = bus->rxglomframes;
+	bus->adapt_glompkts = bus->rxglompkts;
+
+	if (!dhd_adaptbound)
+		return;
+
+	/* The dongle packing large superframes means it has a backlog too */
+	rxbulk = !rxdone || (glomframes && glompkts >= glomframes * DHD_ADAPT_GLOM_BULK);
+
+	/* A pending ioctl wants the bus soon: don't grow while it waits */
+	if (bus->ctrl_frame_stat) {
+		rxbulk = FALSE;
+		txqlen = 0;
+	}
+
+	bus->cur_rxbound = dhdsdio_adapt(bus, rxbound, dhd_rxbound,
+		rxbulk, rxdone && rxcnt * 4 < rxbound);
+	bus->cur_txbound = dhdsdio_adapt(bus, txbound, dhd_txbound,
+		txqlen >= txbound, txqlen * 4 < txbound);
+}
+
 void
 dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 {
@@ -1648,6 +1929,14 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 	            bus->fc_rcvd, bus->fc_xoff, bus->fc_xon);
 	bcm_bprintf(strbuf, "rxglomfail %d, rxglomframes %d, rxglompkts %d\n",
 	            bus->rxglomfail, bus->rxglomframes, bus->rxglompkts);
+	bcm_bprintf(strbuf, "adaptbound %d rxbound %d (%d) txbound %d (%d) grow %d shrink %d\n",
+	            dhd_adaptbound, dhdsdio_rxbound(bus), dhd_rxbound,
+	            dhdsdio_txbound(bus), dhd_txbound, bus->adapt_grow, bus->adapt_shrink);
+#ifndef CTFPOOL
+	osl_rxpool_stats(bus->dhd->osh, strbuf);
+#endif
+	bcm_bprintf(strbuf, "txglom %d, txglomframes %d, txglompkts %d\n",
+	            bus->txglom, bus->txglomframes, bus->txglompkts);
 	bcm_bprintf(strbuf, "f2rx (hdrs/data) %d (%d/%d), f2tx %d f1regs %d\n",
 	            (bus->f2rxhdrs + bus->f2rxdata), bus->f2rxhdrs, bus->f2rxdata,
 	            bus->f2txdata, bus->f1regdata);
@@ -1714,6 +2003,12 @@ dhd_bus_clearcounts(dhd_pub_t *dhdp)
 	bus->rx_hdrfail = bus->rx_badhdr = bus->rx_badseq = 0;
 	bus->tx_sderrs = bus->fc_rcvd = bus->fc_xoff = bus->fc_xon = 0;
 	bus->rxglomfail = bus->rxglomframes = bus->rxglompkts = 0;
+	bus->adapt_glomframes = bus->adapt_glompkts = 0;
+	bus->adapt_grow = bus->adapt_shrink = 0;
+	bus->txglomframes = bus->txglompkts = 0;
+#ifndef CTFPOOL
+	osl_rxpool_clearcounts(dhdp->osh);
+#endif
 	bus->f2rxhdrs = bus->f2rxdata = bus->f2txdata = bus->f1regdata = 0;
 }
 
@@ -2324,6 +2619,17 @@ dhdsdio_doiovar(dhd_bus_t *bus, const bcm_iovar_t *vi, uint32 actionid, const ch
 		sd1idle = bool_val;
 		break;
 
+	case IOV_GVAL(IOV_ADAPTBOUND):
+		int_val = (int32)dhd_adaptbound;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_ADAPTBOUND):
+		dhd_adaptbound = bool_val;
+		bus->cur_rxbound = dhd_rxbound;
+		bus->cur_txbound = dhd_txbound;
+		break;
+
 
 	case IOV_SVAL(IOV_MEMBYTES):
 	case IOV_GVAL(IOV_MEMBYTES):
@@ -3076,6 +3382,9 @@ dhd_bus_stop(struct dhd_bus *bus, bool enforce_mutex)
 	bus->rxskip = FALSE;
 	bus->tx_seq = bus->rx_seq = 0;
 
+	/* A restarted dongle has to be asked for superframes again */
+	bus->txglom = FALSE;
+
 	/* Set to a safe default.  It gets updated when we
 	 * receive a packet from the fw but when we reset,
 	 * we need a safe default to be able to send the
@@ -3795,7 +4104,7 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 		/* tx more to improve rx performance */
 		if ((bus->clkstate == CLK_AVAIL) && !bus->fcstate &&
 			pktq_mlen(&bus->txq, ~bus->flowcontrol) && DATAOK(bus)) {
-			dhdsdio_sendfromq(bus, dhd_txbound);
+			dhdsdio_sendfromq(bus, dhdsdio_txbound(bus));
 		}
 #endif /* DHDTHREAD */
 
@@ -4437,9 +4746,12 @@ dhdsdio_dpc(dhd_bus_t *bus)
 	sdpcmd_regs_t *regs = bus->regs;
 	uint32 intstatus, newstatus = 0;
 	uint retries = 0;
-	uint rxlimit = dhd_rxbound; /* Rx frames to read before resched */
-	uint txlimit = dhd_txbound; /* Tx frames to send before resched */
+	uint rxbound = dhdsdio_rxbound(bus);
+	uint txbound = dhdsdio_txbound(bus);
+	uint rxlimit = rxbound; /* Rx frames to read before resched */
+	uint txlimit = txbound; /* Tx frames to send before resched */
 	uint framecnt = 0;		  /* Temporary counter of tx/rx frames */
+	uint rxcnt = 0;
 	bool rxdone = TRUE;		  /* Flag for no more read data */
 	bool resched = FALSE;	  /* Flag indicating resched wanted */
 
@@ -4589,6 +4901,7 @@ dhdsdio_dpc(dhd_bus_t *bus)
 		if (rxdone || bus->rxskip)
 			intstatus  &= ~FRAME_AVAIL_MASK(bus);
 		rxlimit -= MIN(framecnt, rxlimit);
+		rxcnt = framecnt;
 	}
 
 	/* Keep still-pending events for next scheduling */
@@ -4627,7 +4940,8 @@ clkwait:
 
 	if (TXCTLOK(bus) && bus->ctrl_frame_stat && (bus->clkstate == CLK_AVAIL))  {
 		int ret, i;
-		uint8* frame_seq = bus->ctrl_frame_buf + SDPCM_FRAMETAG_LEN;
+		uint8* frame_seq = bus->ctrl_frame_buf + SDPCM_FRAMETAG_LEN +
+			SDPCM_TXHDREXT(bus);
 
 		if (*frame_seq != bus->tx_seq) {
 			DHD_INFO(("%s IOCTL frame seq lag detected!"
@@ -4682,6 +4996,9 @@ clkwait:
 	if (bus->ctrl_frame_stat)
 		resched = TRUE;
 
+	if (bus->clkstate == CLK_AVAIL)
+		dhdsdio_adapt_bounds(bus, rxbound, rxcnt, rxdone, txbound);
+
 	/* Resched if events or tx frames are pending, else await next interrupt */
 	/* On failed register access, all bets are off: no resched or interrupts */
 	if ((bus->dhd->busstate == DHD_BUS_DOWN) || bcmsdh_regfail(sdh)) {
@@ -5281,6 +5598,7 @@ dhdsdio_probe(uint16 venid, uint16 devid, uint16 bus_no, uint16 slot,
 	dhd_readahead = TRUE;
 	retrydata = FALSE;
 	dhd_doflow = FALSE;
+	dhd_adaptbound = TRUE;
 	dhd_dongle_memsize = 0;
 	dhd_txminmax = DHD_TXMINMAX;
 
@@ -5810,6 +6128,12 @@ dhdsdio_release_malloc(dhd_bus_t *bus, osl_t *osh)
 		bus->databuf = NULL;
 	}
 
+	if (bus->txglom_buf) {
+		MFREE(osh, bus->txglom_buf, DHD_TXGLOM_BUFSZ + DHD_SDALIGN);
+		bus->txglom_buf = bus->txglom_ptr = NULL;
+		bus->txglom = FALSE;
+	}
+
 	if (bus->vars && bus->varsz) {
 		MFREE(osh, bus->vars, bus->varsz);
 		bus->vars = NULL;
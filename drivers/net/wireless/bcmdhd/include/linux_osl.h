@@ -332,6 +332,11 @@ extern void osl_ctfpool_cleanup(osl_t *osh);
 extern void osl_ctfpool_stats(osl_t *osh, void *b);
 #endif 
 
+#ifndef CTFPOOL
+extern void osl_rxpool_stats(osl_t *osh, void *b);
+extern void osl_rxpool_clearcounts(osl_t *osh);
+#endif 
+
 #ifdef HNDCTF
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 22)
 #define	SKIPCT	(1 << 6)
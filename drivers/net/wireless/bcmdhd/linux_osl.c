@@ -91,8 +91,23 @@ struct osl_info {
 	uint failed;
 	uint bustype;
 	bcm_mem_link_t *dbgmem_list;
+#ifndef CTFPOOL
+	struct sk_buff_head rxpool;
+	uint rxpool_hits;
+	uint rxpool_misses;
+	uint rxpool_recycled;
+#endif 
 };
 
+#ifndef CTFPOOL
+/* Packets up to an SDIO rx frame (2KB) plus alignment come from the pool */
+#define OSL_RXPOOL_PKTSZ	(2048 + 64)
+#define OSL_RXPOOL_MAX		64
+#define OSL_RXPOOL_PREFILL	32
+
+static struct sk_buff *osl_alloc_skb(unsigned int len);
+#endif 
+
 
 
 
@@ -193,6 +208,17 @@ osl_attach(void *pdev, uint bustype, bool pkttag)
 	osh->pub.pkttag = pkttag;
 	osh->bustype = bustype;
 
+#ifndef CTFPOOL
+	skb_queue_head_init(&osh->rxpool);
+	while (skb_queue_len(&osh->rxpool) < OSL_RXPOOL_PREFILL) {
+		struct sk_buff *skb = osl_alloc_skb(OSL_RXPOOL_PKTSZ);
+
+		if (skb == NULL)
+			break;
+		skb_queue_tail(&osh->rxpool, skb);
+	}
+#endif 
+
 	switch (bustype) {
 		case PCI_BUS:
 		case SI_BUS:
@@ -249,6 +275,9 @@ osl_detach(osl_t *osh)
 		return;
 
 	ASSERT(osh->magic == OS_HANDLE_MAGIC);
+#ifndef CTFPOOL
+	skb_queue_purge(&osh->rxpool);
+#endif 
 	kfree(osh);
 }
 
@@ -263,7 +292,57 @@ static struct sk_buff *osl_alloc_skb(unsigned int len)
 #endif
 }
 
-#ifdef CTFPOOL
+#ifndef CTFPOOL
+
+static inline struct sk_buff *
+osl_rxpool_get(osl_t *osh, uint len)
+{
+	struct sk_buff *skb;
+
+	if (len > OSL_RXPOOL_PKTSZ)
+		return NULL;
+
+	skb = skb_dequeue(&osh->rxpool);
+	if (skb)
+		osh->rxpool_hits++;
+	else
+		osh->rxpool_misses++;
+
+	return skb;
+}
+
+/* Keep a freed packet that can hold any pool request, instead of freeing it */
+static inline bool
+osl_rxpool_put(osl_t *osh, struct sk_buff *skb)
+{
+	if (skb_queue_len(&osh->rxpool) >= OSL_RXPOOL_MAX)
+		return FALSE;
+
+	if (!skb_recycle_check(skb, OSL_RXPOOL_PKTSZ))
+		return FALSE;
+
+	skb_queue_tail(&osh->rxpool, skb);
+	osh->rxpool_recycled++;
+	return TRUE;
+}
+
+void
+osl_rxpool_stats(osl_t *osh, void *b)
+{
+	struct bcmstrbuf *bb = b;
+
+	bcm_bprintf(bb, "rxpool %d hits %d misses %d recycled %d\n",
+		skb_queue_len(&osh->rxpool), osh->rxpool_hits, osh->rxpool_misses,
+		osh->rxpool_recycled);
+}
+
+void
+osl_rxpool_clearcounts(osl_t *osh)
+{
+	osh->rxpool_hits = osh->rxpool_misses = osh->rxpool_recycled = 0;
+}
+
+#else
 
 void *
 osl_ctfpool_add(osl_t *osh)
@@ -462,7 +541,7 @@ osl_pktget(osl_t *osh, uint len)
 	skb = osl_pktfastget(osh, len);
 	if ((skb != NULL) || ((skb = osl_alloc_skb(len)) != NULL)) {
 #else
-	if ((skb = osl_alloc_skb(len))) {
+	if ((skb = osl_rxpool_get(osh, len)) || (skb = osl_alloc_skb(len))) {
 #endif
 		skb_put(skb, len);
 		skb->priority = 0;
@@ -530,7 +609,7 @@ osl_pktfree(osl_t *osh, void *p, bool send)
 			osl_pktfastfree(osh, skb);
 		else {
 #else 
-		{
+		if (!osl_rxpool_put(osh, skb)) {
 #endif 
 
 			if (skb->destructor)
@@ -1189,13 +1189,18 @@ wl_cfg80211_notify_ifchange(void)
 	return 0;
 }
 
-static void wl_scan_prep(struct wl_scan_params *params, struct cfg80211_scan_request *request)
+/*
+ * Fills params from request. With chan_mask, only the channels of request
+ * set in it are scanned: callers make sure there is at least one.
+ */
+static void wl_scan_prep(struct wl_scan_params *params, struct cfg80211_scan_request *request,
+	const unsigned long *chan_mask)
 {
 	u32 n_ssids;
 	u32 n_channels;
 	u16 channel;
 	chanspec_t chanspec;
-	s32 i, offset;
+	s32 i, j, offset;
 	char *ptr;
 	wlc_ssid_t ssid;
 
@@ -1231,9 +1236,12 @@ static void wl_scan_prep(struct wl_scan_params *params, struct cfg80211_scan_req
 	/* Copy channel array if applicable */
 	WL_SCAN(("### List of channelspecs to scan ###\n"));
 	if (n_channels > 0) {
-		for (i = 0; i < n_channels; i++) {
+		for (i = 0, j = 0; i < n_channels; i++) {
 			chanspec = 0;
 			channel = ieee80211_frequency_to_channel(request->channels[i]->center_freq);
+			if (chan_mask && (channel >= WL_SCAN_CACHE_CHANNELS ||
+				!test_bit(channel, chan_mask)))
+				continue;
 			if (request->channels[i]->band == IEEE80211_BAND_2GHZ)
 				chanspec |= WL_CHANSPEC_BAND_2G;
 			else
@@ -1250,13 +1258,15 @@ static void wl_scan_prep(struct wl_scan_params *params, struct cfg80211_scan_req
 					chanspec |= WL_CHANSPEC_CTL_SB_UPPER;
 			}
 
-			params->channel_list[i] = channel;
-			params->channel_list[i] &= WL_CHANSPEC_CHAN_MASK;
-			params->channel_list[i] |= chanspec;
+			params->channel_list[j] = channel;
+			params->channel_list[j] &= WL_CHANSPEC_CHAN_MASK;
+			params->channel_list[j] |= chanspec;
 			WL_SCAN(("Chan : %d, Channel spec: %x \n",
-				channel, params->channel_list[i]));
-			params->channel_list[i] = htod16(params->channel_list[i]);
+				channel, params->channel_list[j]));
+			params->channel_list[j] = htod16(params->channel_list[j]);
+			j++;
 		}
+		n_channels = j;
 	} else {
 		WL_SCAN(("Scanning all channels\n"));
 	}
@@ -1316,7 +1326,7 @@ wl_run_iscan(struct wl_iscan_ctrl *iscan, struct cfg80211_scan_request *request,
 		return -ENOMEM;
 	}
 
-	wl_scan_prep(&params->params, request);
+	wl_scan_prep(&params->params, request, NULL);
 
 	params->version = htod32(ISCAN_REQ_VERSION);
 	params->action = htod16(action);
@@ -1430,7 +1440,8 @@ wl_run_escan(struct wl_priv *wl, struct net_device *ndev,
 			goto exit;
 		}
 
-		wl_scan_prep(&params->params, request);
+		wl_scan_prep(&params->params, request,
+			wl->scan_partial ? wl->scan_seen_chans : NULL);
 		params->version = htod32(ESCAN_REQ_VERSION);
 		params->action =  htod16(action);
 		params->sync_id = htod16(0x1234);
@@ -1538,6 +1549,7 @@ wl_do_escan(struct wl_priv *wl, struct wiphy *wiphy, struct net_device *ndev,
 	results->version = 0;
 	results->count = 0;
 	results->buflen = WL_SCAN_RESULTS_FIXED_SIZE;
+	wl->scan_cache_valid = false;
 
 	err = wl_run_escan(wl, ndev, request, WL_SCAN_ACTION_START);
 exit:
@@ -1545,6 +1557,98 @@ exit:
 	return err;
 }
 
+/*
+ * Legacy broadcast scans, what the framework issues periodically, go
+ * through a cache of the last results left in escan_buf:
+ * - a scan requested within WL_SCAN_CACHE_FRESH_MS of the last one is
+ *   answered by reporting those results again, without scanning;
+ * - otherwise, up to WL_SCAN_CACHE_PARTIAL_MAX scans in a row only cover
+ *   the channels a BSS was seen on since the last full scan, which still
+ *   refreshes every known BSS. A full scan follows, and at least every
+ *   WL_SCAN_CACHE_FULL_MS, to find BSSes on the other channels.
+ * Returns true if request was answered from the cache.
+ */
+static bool
+wl_scan_cache_lookup(struct wl_priv *wl, struct net_device *ndev,
+	struct cfg80211_scan_request *request)
+{
+	u32 i, n_seen = 0;
+	s32 channel;
+
+	wl->scan_cacheable = false;
+	wl->scan_partial = false;
+
+	/* other scans leave their own results in escan_buf */
+	if (wl->p2p_supported && (ndev != wl_to_prmry_ndev(wl) || p2p_scan(wl)))
+		goto uncached;
+	for (i = 0; i < request->n_ssids; i++)
+		if (request->ssids[i].ssid_len)
+			goto uncached;
+	wl->scan_cacheable = true;
+
+	if (wl->scan_cache_valid && request->n_channels &&
+		request->n_channels <= wl->scan_cache_nchans &&
+		time_before(jiffies, wl->scan_cache_time +
+		msecs_to_jiffies(WL_SCAN_CACHE_FRESH_MS))) {
+		WL_SCAN(("reporting cached scan results\n"));
+		wl->bss_list = (wl_scan_results_t *)wl->escan_info.escan_buf;
+		wl_inform_bss(wl);
+		return true;
+	}
+
+	if (wl->scan_partial_cnt >= WL_SCAN_CACHE_PARTIAL_MAX ||
+		time_after(jiffies, wl->scan_full_time +
+		msecs_to_jiffies(WL_SCAN_CACHE_FULL_MS)))
+		return false;
+
+	for (i = 0; i < request->n_channels; i++) {
+		channel = ieee80211_frequency_to_channel(request->channels[i]->center_freq);
+		if (channel < WL_SCAN_CACHE_CHANNELS &&
+			test_bit(channel, wl->scan_seen_chans))
+			n_seen++;
+	}
+	/* nothing seen yet, or nothing to leave out */
+	if (n_seen && n_seen < request->n_channels) {
+		WL_SCAN(("partial scan of %d channels\n", n_seen));
+		wl->scan_partial = true;
+	}
+	return false;
+
+uncached:
+	wl->scan_cache_valid = false;
+	return false;
+}
+
+/* Records the results of a completed cacheable scan */
+static void
+wl_scan_cache_update(struct wl_priv *wl)
+{
+	struct wl_bss_info *bi = NULL;
+	s32 i, channel;
+
+	if (!wl->scan_cacheable || !wl->scan_request)
+		return;
+
+	if (!wl->scan_partial) {
+		bitmap_zero(wl->scan_seen_chans, WL_SCAN_CACHE_CHANNELS);
+		wl->scan_full_time = jiffies;
+		wl->scan_partial_cnt = 0;
+	} else {
+		wl->scan_partial_cnt++;
+	}
+
+	bi = next_bss(wl->bss_list, bi);
+	for_each_bss(wl->bss_list, bi, i) {
+		channel = bi->ctl_ch ? bi->ctl_ch : CHSPEC_CHANNEL(dtohchanspec(bi->chanspec));
+		if (channel < WL_SCAN_CACHE_CHANNELS)
+			set_bit(channel, wl->scan_seen_chans);
+	}
+
+	wl->scan_cache_valid = true;
+	wl->scan_cache_time = jiffies;
+	wl->scan_cache_nchans = wl->scan_request->n_channels;
+}
+
 static s32
 __wl_cfg80211_scan(struct wiphy *wiphy, struct net_device *ndev,
 	struct cfg80211_scan_request *request,
@@ -1682,6 +1786,10 @@ __wl_cfg80211_scan(struct wiphy *wiphy, struct net_device *ndev,
 		else
 			goto scan_out;
 	} else if (escan_req) {
+		if (wl_scan_cache_lookup(wl, ndev, request)) {
+			wl_notify_escan_complete(wl, ndev, false, false);
+			return 0;
+		}
 		if (wl->p2p_supported) {
 			if (p2p_on(wl) && p2p_scan(wl)) {
 
@@ -6590,6 +6698,7 @@ static s32 wl_escan_handler(struct wl_priv *wl,
 			WL_INFO(("ESCAN COMPLETED\n"));
 			wl->bss_list = (wl_scan_results_t *)wl->escan_info.escan_buf;
 			wl_inform_bss(wl);
+			wl_scan_cache_update(wl);
 			wl_notify_escan_complete(wl, ndev, false, false);
 		}
 	}
@@ -7418,6 +7527,7 @@ static s32 __wl_cfg80211_down(struct wl_priv *wl)
 		cfg80211_scan_done(wl->scan_request, true);
 		wl->scan_request = NULL;
 	}
+	wl->scan_cache_valid = false;
 	for_each_ndev(wl, iter, next) {
 		wl_clr_drv_status(wl, READY, iter->ndev);
 		wl_clr_drv_status(wl, SCANNING, iter->ndev);
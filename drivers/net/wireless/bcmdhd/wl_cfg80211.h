@@ -142,6 +142,10 @@ do {									\
 #define IFACE_MAX_CNT 		2
 
 #define WL_SCAN_TIMER_INTERVAL_MS	8000 /* Scan timeout */
+#define WL_SCAN_CACHE_FRESH_MS	4000	/* answer scans from the last results */
+#define WL_SCAN_CACHE_FULL_MS	60000	/* scan all channels at least this often */
+#define WL_SCAN_CACHE_PARTIAL_MAX	3	/* partial scans between full ones */
+#define WL_SCAN_CACHE_CHANNELS	200	/* channel numbers tracked */
 #define WL_CHANNEL_SYNC_RETRY 	3
 #define WL_ACT_FRAME_RETRY 4
 
@@ -473,6 +477,16 @@ typedef struct wl_priv {
 	u16 deauth_reason;           /* Place holder to save deauth/disassoc reasons */
 	u16 scan_busy_count;
 	struct work_struct work_scan_timeout;
+
+	/* scan cache, see wl_scan_cache_lookup() */
+	bool scan_cacheable;		/* running scan is a legacy broadcast scan */
+	bool scan_partial;		/* running scan is limited to scan_seen_chans */
+	bool scan_cache_valid;		/* escan_buf holds the last cacheable scan */
+	u32 scan_cache_nchans;		/* channels that scan was requested on */
+	unsigned long scan_cache_time;	/* jiffies it completed */
+	unsigned long scan_full_time;	/* jiffies the last full scan completed */
+	u32 scan_partial_cnt;		/* partial scans since then */
+	DECLARE_BITMAP(scan_seen_chans, WL_SCAN_CACHE_CHANNELS); /* with a BSS */
 } wl_priv_t;
 
 
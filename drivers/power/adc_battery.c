@@ -32,6 +32,7 @@
 #include <linux/earlysuspend.h>
 #include <linux/io.h>
 #include <mach/regs-clock.h>
+#include <mach/cpu-freq-v210.h>
 //#include <mach/regs-power.h>
 #include <mach/map.h>
 #include <mach/sec_battery.h>
@@ -54,6 +55,7 @@ static int vbus_wake_lock_status = 0;
 
 /* Prototypes */
 extern int s3c_adc_get_adc_data(int channel);
+extern int s3c_adc_get_adc_samples(int channel, int *samples, int count);
 extern void MAX8998_IRQ_init(void);
 extern void maxim_ta_charging_mode(int mode);
 extern void maxim_charging_control(unsigned int dev_type, unsigned int cmd);
@@ -96,6 +98,10 @@ static struct wake_lock wake_lock_for_dev;
 //#define POLLING_INTERVAL  5000
 
 #define POLLING_INTERVAL_TEST   1000
+/* longest poll of a discharging battery that has stopped changing */
+#define POLLING_INTERVAL_MAX	(240*1000)
+/* batt_temp change, in 0.1 degC, still counted as stable */
+#define POLLING_STABLE_TEMP	10
 
 
 #ifdef __BATTERY_COMPENSATION__
@@ -420,6 +426,8 @@ static DEFINE_MUTEX(work_lock);
 static struct work_struct bat_work;
 static struct device *dev;
 static struct timer_list polling_timer;
+static struct timer_list polling_idle_timer;	/* deferrable, backed off polls */
+static unsigned int polling_delay;	/* current polling period, ms */
 static int s3c_battery_initial;
 static int force_update, force_log;
 static int old_level, old_temp, old_is_full, old_is_recharging, old_health, new_temp_level;
@@ -447,6 +455,8 @@ static unsigned int end_time_msec;
 
 static struct s3c_battery_info s3c_bat_info;
 
+static void s3c_bat_arm_polling(void);
+
 static int full_charge_flag;
 
 /* Variables : kor-feature start */
@@ -1419,8 +1429,9 @@ static int s3c_bat_get_adc_data(adc_channel_type adc_ch)
 
 	//pr_info("[BAT]:%s\n", __func__);
 
+	s3c_adc_get_adc_samples(adc_ch, adc_arr, ADC_DATA_ARR_SIZE);
+
 	for (i = 0; i < ADC_DATA_ARR_SIZE; i++) {
-		adc_arr[i] = s3c_adc_get_adc_data(adc_ch);
 		//      pr_info("[BAT]:%s: adc_arr = %d\n", __func__, adc_arr[i]);
 		if (i != 0) {
 			if (adc_arr[i] > adc_max) {
@@ -1932,8 +1943,8 @@ void s3c_cable_changed(bool connected)
 	 * Wait a bit before reading ac/usb line status and setting charger,
 	 * because ac/usb status readings may lag from irq.
 	 */
-	mod_timer(&polling_timer,
-		  jiffies + msecs_to_jiffies(s3c_bat_info.polling_interval));
+	polling_delay = s3c_bat_info.polling_interval;
+	s3c_bat_arm_polling();
 }
 
 extern byte Get_MAX8998_PM_REG(max8998_pm_section_type reg_num);
@@ -2933,13 +2944,63 @@ static void s3c_bat_check_v_f(void)
 }
 #endif /* __CHECK_BATTERY_V_F__ */
 
+/*
+ * Arms the next poll, polling_delay from now. The backed off polls of a
+ * stable discharging battery go on a deferrable timer, which does not
+ * take the cpu out of idle by itself: the poll runs at the next wakeup
+ * for something else. Polls at polling_interval, which the charging
+ * checks count, keep waking the cpu on time.
+ */
+static void s3c_bat_arm_polling(void)
+{
+	unsigned long expires = jiffies + msecs_to_jiffies(polling_delay);
+
+	if (polling_delay > s3c_bat_info.polling_interval) {
+		del_timer(&polling_timer);
+		mod_timer(&polling_idle_timer, expires);
+	} else {
+		del_timer(&polling_idle_timer);
+		mod_timer(&polling_timer, expires);
+	}
+}
+
+static void s3c_bat_stop_polling(void)
+{
+	del_timer_sync(&polling_timer);
+	del_timer_sync(&polling_idle_timer);
+}
+
 static void polling_timer_func(unsigned long unused)
 {
 	//pr_info("[BAT]:%s\n", __func__);
 
 	schedule_work(&bat_work);
 
-	mod_timer(&polling_timer, jiffies + msecs_to_jiffies(s3c_bat_info.polling_interval));
+	s3c_bat_arm_polling();
+}
+
+/*
+ * Charging, a cable change or any change in level, health or
+ * temperature polls every polling_interval: the full charge and step
+ * charging checks count polls. A discharging battery that stays put
+ * doubles the period on each poll, up to POLLING_INTERVAL_MAX.
+ */
+static void s3c_bat_adapt_polling(void)
+{
+	bool stable = s3c_bat_info.cable_status == CABLE_TYPE_NONE &&
+		!s3c_bat_info.bat_info.charging_enabled &&
+		s3c_bat_info.polling_interval == POLLING_INTERVAL &&
+		old_level == s3c_bat_info.bat_info.level &&
+		old_health == s3c_bat_info.bat_info.batt_health &&
+		old_is_full == s3c_bat_info.bat_info.batt_is_full &&
+		abs(old_temp - s3c_bat_info.bat_info.batt_temp) <
+			POLLING_STABLE_TEMP;
+
+	if (!stable || polling_delay < s3c_bat_info.polling_interval)
+		polling_delay = s3c_bat_info.polling_interval;
+	else
+		polling_delay = min(polling_delay * 2,
+				    (unsigned int)POLLING_INTERVAL_MAX);
 }
 
 static void s3c_store_bat_old_data(void)
@@ -3032,6 +3093,7 @@ static void s3c_bat_work(struct work_struct *work)
 
 	s3c_store_bat_old_data();
 	s3c_get_bat_temp();
+	s5pv210_thermal_update(s3c_bat_info.bat_info.batt_temp);
 	s3c_bat_check_v_f();
 	s3c_get_bat_vol();
 	s3c_get_bat_level();
@@ -3048,6 +3110,8 @@ static void s3c_bat_work(struct work_struct *work)
 	  stepcharger_statemachine();
 	}
 
+	s3c_bat_adapt_polling();
+
 	mutex_unlock(&work_lock);
 	wake_unlock(&update_wake_lock);
 }
@@ -3144,6 +3208,12 @@ int _low_battery_alarm_(void)
 	wake_lock_timeout(&vbus_wake_lock, 5 * HZ);
 	power_supply_changed(&s3c_power_supplies[CHARGER_BATTERY]);
 
+	/* poll at the short interval again until the level settles */
+	if (s3c_bat_info.polling) {
+		polling_delay = s3c_bat_info.polling_interval;
+		s3c_bat_arm_polling();
+	}
+
 	return 0;
 }
 
@@ -3304,8 +3374,11 @@ static int __devinit s3c_bat_probe(struct platform_device *pdev)
 #endif /* __TEST_DEVICE_DRIVER__ */
 
 	if (s3c_bat_info.polling) {
+		polling_delay = s3c_bat_info.polling_interval;
 		setup_timer(&polling_timer, polling_timer_func, 0);
-		mod_timer(&polling_timer, jiffies + msecs_to_jiffies(s3c_bat_info.polling_interval));
+		init_timer_deferrable(&polling_idle_timer);
+		polling_idle_timer.function = polling_timer_func;
+		s3c_bat_arm_polling();
 	}
 
 	s3c_battery_initial = 1;
@@ -3419,7 +3492,7 @@ static int s3c_bat_suspend(struct platform_device *pdev, pm_message_t state)
 	//set_low_bat_interrupt(1); /* eur-feature */
 
 	if (s3c_bat_info.polling) {
-		del_timer_sync(&polling_timer);
+		s3c_bat_stop_polling();
 	}
 
 	flush_scheduled_work();
@@ -3447,7 +3520,7 @@ static int __devexit s3c_bat_remove(struct platform_device *pdev)
 	//pr_info("[BAT]:%s\n", __func__);
 
 	if (s3c_bat_info.polling) {
-		del_timer_sync(&polling_timer);
+		s3c_bat_stop_polling();
 	}
 
 	for (i = 0; i < ARRAY_SIZE(s3c_power_supplies); i++) {
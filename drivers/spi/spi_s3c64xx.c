@@ -146,6 +146,7 @@
  * @state: Set of FLAGS to indicate status.
  * @rx_dmach: Controller's DMA channel for Rx.
  * @tx_dmach: Controller's DMA channel for Tx.
+ * @dma_acquired: Set while the DMA channels are held.
  * @sfr_start: BUS address of SPI controller regs.
  * @regs: Pointer to ioremap'ed controller registers.
  * @xfer_completion: To indicate completion of xfer task.
@@ -167,6 +168,7 @@ struct s3c64xx_spi_driver_data {
 	spinlock_t                      lock;
 	enum dma_ch                     rx_dmach;
 	enum dma_ch                     tx_dmach;
+	bool                            dma_acquired;
 	unsigned long                   sfr_start;
 	struct completion               xfer_completion;
 	unsigned                        state;
@@ -764,15 +766,35 @@ static int acquire_dma(struct s3c64xx_spi_driver_data *sdd)
 	return 1;
 }
 
+/* Called with the queue stopped, when the channels are no longer needed */
+static void release_dma(struct s3c64xx_spi_driver_data *sdd)
+{
+	flush_workqueue(sdd->workqueue);
+
+	if (!sdd->dma_acquired)
+		return;
+
+	s3c2410_dma_free(sdd->tx_dmach, &s3c64xx_spi_dma_client);
+	s3c2410_dma_free(sdd->rx_dmach, &s3c64xx_spi_dma_client);
+	sdd->dma_acquired = false;
+}
+
 static void s3c64xx_spi_work(struct work_struct *work)
 {
 	struct s3c64xx_spi_driver_data *sdd = container_of(work,
 					struct s3c64xx_spi_driver_data, work);
 	unsigned long flags;
 
-	/* Acquire DMA channels */
-	while (!acquire_dma(sdd))
-		msleep(10);
+	/*
+	 * Acquire DMA channels, and keep them: a device streaming one
+	 * message at a time would otherwise pay for the request and the
+	 * release of both channels on every message.
+	 */
+	if (!sdd->dma_acquired) {
+		while (!acquire_dma(sdd))
+			msleep(10);
+		sdd->dma_acquired = true;
+	}
 
 	spin_lock_irqsave(&sdd->lock, flags);
 
@@ -798,10 +820,6 @@ static void s3c64xx_spi_work(struct work_struct *work)
 	}
 
 	spin_unlock_irqrestore(&sdd->lock, flags);
-
-	/* Free DMA channels */
-	s3c2410_dma_free(sdd->tx_dmach, &s3c64xx_spi_dma_client);
-	s3c2410_dma_free(sdd->rx_dmach, &s3c64xx_spi_dma_client);
 }
 
 static int s3c64xx_spi_transfer(struct spi_device *spi,
@@ -1147,6 +1165,8 @@ static int s3c64xx_spi_remove(struct platform_device *pdev)
 	while (sdd->state & SPIBUSY)
 		msleep(10);
 
+	release_dma(sdd);
+
 	spi_unregister_master(master);
 
 	destroy_workqueue(sdd->workqueue);
@@ -1183,6 +1203,8 @@ static int s3c64xx_spi_suspend(struct platform_device *pdev, pm_message_t state)
 	while (sdd->state & SPIBUSY)
 		msleep(10);
 
+	release_dma(sdd);
+
 	/* Disable the clock */
 	clk_disable(sdd->src_clk);
 	clk_disable(sdd->clk);
@@ -37,9 +37,54 @@
 
 #include "binder.h"
 
-static DEFINE_MUTEX(binder_lock);
+static DEFINE_MUTEX(binder_main_lock);
 static DEFINE_MUTEX(binder_deferred_lock);
 
+/* binder_main_lock usage, updated with the lock held */
+static struct binder_lock_stats {
+	u64 acquired;
+	u64 contended;
+	u64 wait_ns;
+	u64 wait_max_ns;
+	u64 hold_max_ns;
+	const char *hold_max_tag;
+	u64 locked_at;
+	const char *locked_by;
+} binder_lock_stats;
+
+static inline void binder_lock(const char *tag)
+{
+	struct binder_lock_stats *ls = &binder_lock_stats;
+	u64 start, wait;
+
+	if (mutex_trylock(&binder_main_lock)) {
+		ls->locked_at = sched_clock();
+	} else {
+		start = sched_clock();
+		mutex_lock(&binder_main_lock);
+		ls->locked_at = sched_clock();
+		wait = ls->locked_at - start;
+		ls->contended++;
+		ls->wait_ns += wait;
+		if (wait > ls->wait_max_ns)
+			ls->wait_max_ns = wait;
+	}
+	ls->acquired++;
+	ls->locked_by = tag;
+}
+
+static inline void binder_unlock(const char *tag)
+{
+	struct binder_lock_stats *ls = &binder_lock_stats;
+	u64 held = sched_clock() - ls->locked_at;
+
+	if (held > ls->hold_max_ns) {
+		ls->hold_max_ns = held;
+		ls->hold_max_tag = ls->locked_by;
+	}
+	mutex_unlock(&binder_main_lock);
+}
+
 static HLIST_HEAD(binder_procs);
 static HLIST_HEAD(binder_deferred_list);
 static HLIST_HEAD(binder_dead_nodes);
@@ -106,6 +151,28 @@ module_param_named(debug_mask, binder_debug_mask, uint, S_IWUSR | S_IRUGO);
 static int binder_debug_no_lock;
 module_param_named(proc_no_lock, binder_debug_no_lock, bool, S_IWUSR | S_IRUGO);
 
+/* Freed buffer pages each proc keeps mapped for its next allocations */
+static unsigned int binder_keep_pages = 4;
+module_param_named(keep_pages, binder_keep_pages, uint, S_IWUSR | S_IRUGO);
+
+#define BINDER_ALLOC_HIST	8
+
+/* Buffer allocations, updated with binder_main_lock held */
+static struct binder_alloc_stats {
+	u64 pages_mapped;
+	u64 pages_reused;
+	u64 hist[BINDER_ALLOC_HIST];	/* < 1, 2, 4 ... 64 us, and the rest */
+} binder_alloc_stats;
+
+static void binder_alloc_account(u64 ns)
+{
+	int bucket = fls(ns >> 10);
+
+	if (bucket >= BINDER_ALLOC_HIST)
+		bucket = BINDER_ALLOC_HIST - 1;
+	binder_alloc_stats.hist[bucket]++;
+}
+
 static DECLARE_WAIT_QUEUE_HEAD(binder_user_error_wait);
 static int binder_stop_on_user_error;
 
@@ -148,7 +215,7 @@ enum binder_stat_types {
 
 struct binder_stats {
 	int br[_IOC_NR(BR_FAILED_REPLY) + 1];
-	int bc[_IOC_NR(BC_DEAD_BINDER_DONE) + 1];
+	int bc[_IOC_NR(BC_REPLY_SG) + 1];
 	int obj_created[BINDER_STAT_COUNT];
 	int obj_deleted[BINDER_STAT_COUNT];
 };
@@ -271,6 +338,7 @@ struct binder_buffer {
 	struct binder_node *target_node;
 	size_t data_size;
 	size_t offsets_size;
+	size_t extra_buffers_size;
 	uint8_t data[0];
 };
 
@@ -301,6 +369,10 @@ struct binder_proc {
 	size_t free_async_space;
 
 	struct page **pages;
+	unsigned int pages_kept;
+	struct rb_root latency;
+	unsigned int latency_codes;
+	u64 latency_untracked;
 	size_t buffer_size;
 	uint32_t buffer_free;
 	struct list_head todo;
@@ -356,6 +428,20 @@ struct binder_transaction {
 	long	priority;
 	long	saved_priority;
 	uid_t	sender_euid;
+	u64	start_ns;
+};
+
+#define BINDER_LATENCY_HIST		12
+#define BINDER_LATENCY_MAX_CODES	64
+
+/* Call to reply times of one transaction code handled by a proc */
+struct binder_latency {
+	struct rb_node rb_node;
+	unsigned int code;
+	unsigned int count;
+	u64 total_ns;
+	u64 max_ns;
+	u64 hist[BINDER_LATENCY_HIST];	/* < 1, 4, 16 ... us, and the rest */
 };
 
 static void
@@ -612,7 +698,7 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 				    void *start, void *end,
 				    struct vm_area_struct *vma)
 {
-	void *page_addr;
+	void *page_addr, *run_end;
 	unsigned long user_page_addr;
 	struct vm_struct tmp_area;
 	struct page **page;
@@ -644,38 +730,65 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		goto err_no_vma;
 	}
 
-	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
+	/*
+	 * Pages kept by an earlier free are still mapped and are taken back
+	 * as they are. Each run of missing pages is mapped in the kernel
+	 * with a single map_vm_area().
+	 */
+	for (page_addr = start; page_addr < end; page_addr = run_end) {
 		int ret;
 		struct page **page_array_ptr;
+		void *addr;
+
 		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		run_end = page_addr + PAGE_SIZE;
+		if (*page) {
+			BUG_ON(proc->pages_kept == 0);
+			proc->pages_kept--;
+			binder_alloc_stats.pages_reused++;
+			continue;
+		}
 
-		BUG_ON(*page);
-		*page = alloc_page(GFP_KERNEL | __GFP_ZERO);
-		if (*page == NULL) {
-			printk(KERN_ERR "binder: %d: binder_alloc_buf failed "
-			       "for page at %p\n", proc->pid, page_addr);
-			goto err_alloc_page_failed;
+		for (run_end = page_addr; run_end < end; run_end += PAGE_SIZE) {
+			struct page **p = &page[(run_end - page_addr) / PAGE_SIZE];
+
+			if (*p)
+				break;
+			*p = alloc_page(GFP_KERNEL | __GFP_ZERO);
+			if (*p == NULL) {
+				printk(KERN_ERR "binder: %d: binder_alloc_buf "
+				       "failed for page at %p\n",
+				       proc->pid, run_end);
+				goto err_alloc_failed;
+			}
 		}
+
 		tmp_area.addr = page_addr;
-		tmp_area.size = PAGE_SIZE + PAGE_SIZE /* guard page? */;
+		tmp_area.size = run_end - page_addr + PAGE_SIZE /* guard page? */;
 		page_array_ptr = page;
 		ret = map_vm_area(&tmp_area, PAGE_KERNEL, &page_array_ptr);
 		if (ret) {
 			printk(KERN_ERR "binder: %d: binder_alloc_buf failed "
-			       "to map page at %p in kernel\n",
-			       proc->pid, page_addr);
-			goto err_map_kernel_failed;
+			       "to map pages at %p-%p in kernel\n",
+			       proc->pid, page_addr, run_end);
+			goto err_alloc_failed;
 		}
-		user_page_addr =
-			(uintptr_t)page_addr + proc->user_buffer_offset;
-		ret = vm_insert_page(vma, user_page_addr, page[0]);
-		if (ret) {
-			printk(KERN_ERR "binder: %d: binder_alloc_buf failed "
-			       "to map page at %lx in userspace\n",
-			       proc->pid, user_page_addr);
-			goto err_vm_insert_page_failed;
+		for (addr = page_addr; addr < run_end; addr += PAGE_SIZE) {
+			user_page_addr =
+				(uintptr_t)addr + proc->user_buffer_offset;
+			ret = vm_insert_page(vma, user_page_addr,
+					     page[(addr - page_addr) / PAGE_SIZE]);
+			if (ret) {
+				printk(KERN_ERR "binder: %d: binder_alloc_buf "
+				       "failed to map page at %lx in "
+				       "userspace\n", proc->pid,
+				       user_page_addr);
+				goto err_alloc_failed;
+			}
+			/* vm_insert_page does not seem to increment the refcount */
 		}
-		/* vm_insert_page does not seem to increment the refcount */
+		binder_alloc_stats.pages_mapped +=
+			(run_end - page_addr) / PAGE_SIZE;
 	}
 	if (mm) {
 		up_write(&mm->mmap_sem);
@@ -687,16 +800,30 @@ free_range:
 	for (page_addr = end - PAGE_SIZE; page_addr >= start;
 	     page_addr -= PAGE_SIZE) {
 		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		if (vma && proc->pages_kept < binder_keep_pages) {
+			proc->pages_kept++;
+			continue;
+		}
 		if (vma)
 			zap_page_range(vma, (uintptr_t)page_addr +
 				proc->user_buffer_offset, PAGE_SIZE, NULL);
-err_vm_insert_page_failed:
 		unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
-err_map_kernel_failed:
 		__free_page(*page);
 		*page = NULL;
-err_alloc_page_failed:
-		;
+	}
+	goto err_no_vma;
+
+err_alloc_failed:
+	/* give back the whole range, kept pages included */
+	for (page_addr = start; page_addr < run_end; page_addr += PAGE_SIZE) {
+		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		if (*page == NULL)
+			continue;
+		zap_page_range(vma, (uintptr_t)page_addr +
+			proc->user_buffer_offset, PAGE_SIZE, NULL);
+		unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
+		__free_page(*page);
+		*page = NULL;
 	}
 err_no_vma:
 	if (mm) {
@@ -708,7 +835,9 @@ err_no_vma:
 
 static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 					      size_t data_size,
-					      size_t offsets_size, int is_async)
+					      size_t offsets_size,
+					      size_t extra_buffers_size,
+					      int is_async)
 {
 	struct rb_node *n = proc->free_buffers.rb_node;
 	struct binder_buffer *buffer;
@@ -732,6 +861,13 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 			"size %zd-%zd\n", proc->pid, data_size, offsets_size);
 		return NULL;
 	}
+	size += ALIGN(extra_buffers_size, sizeof(void *));
+	if (size < extra_buffers_size) {
+		binder_user_error("binder: %d: got transaction with invalid "
+			"extra_buffers_size %zd\n", proc->pid,
+			extra_buffers_size);
+		return NULL;
+	}
 
 	if (is_async &&
 	    proc->free_async_space < size + sizeof(struct binder_buffer)) {
@@ -800,6 +936,7 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 		     "%p\n", proc->pid, size, buffer);
 	buffer->data_size = data_size;
 	buffer->offsets_size = offsets_size;
+	buffer->extra_buffers_size = extra_buffers_size;
 	buffer->async_transaction = is_async;
 	if (is_async) {
 		proc->free_async_space -= size + sizeof(struct binder_buffer);
@@ -877,7 +1014,8 @@ static void binder_free_buf(struct binder_proc *proc,
 	buffer_size = binder_buffer_size(proc, buffer);
 
 	size = ALIGN(buffer->data_size, sizeof(void *)) +
-		ALIGN(buffer->offsets_size, sizeof(void *));
+		ALIGN(buffer->offsets_size, sizeof(void *)) +
+		ALIGN(buffer->extra_buffers_size, sizeof(void *));
 
 	binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "binder: %d: binder_free_buf %p size %zd buffer"
@@ -1229,6 +1367,52 @@ static int binder_dec_ref(struct binder_ref *ref, int strong)
 	return 0;
 }
 
+/* proc is replying to t: account the call to its code */
+static void binder_latency_account(struct binder_proc *proc,
+				   struct binder_transaction *t)
+{
+	struct rb_node **p = &proc->latency.rb_node;
+	struct rb_node *parent = NULL;
+	struct binder_latency *lat;
+	u64 ns = sched_clock() - t->start_ns;
+	int bucket;
+
+	while (*p) {
+		parent = *p;
+		lat = rb_entry(parent, struct binder_latency, rb_node);
+
+		if (t->code < lat->code)
+			p = &(*p)->rb_left;
+		else if (t->code > lat->code)
+			p = &(*p)->rb_right;
+		else
+			goto found;
+	}
+	if (proc->latency_codes >= BINDER_LATENCY_MAX_CODES)
+		goto untracked;
+	lat = kzalloc(sizeof(*lat), GFP_KERNEL);
+	if (lat == NULL)
+		goto untracked;
+	lat->code = t->code;
+	rb_link_node(&lat->rb_node, parent, p);
+	rb_insert_color(&lat->rb_node, &proc->latency);
+	proc->latency_codes++;
+
+found:
+	bucket = (fls(ns >> 10) + 1) / 2;
+	if (bucket >= BINDER_LATENCY_HIST)
+		bucket = BINDER_LATENCY_HIST - 1;
+	lat->hist[bucket]++;
+	lat->count++;
+	lat->total_ns += ns;
+	if (ns > lat->max_ns)
+		lat->max_ns = ns;
+	return;
+
+untracked:
+	proc->latency_untracked++;
+}
+
 static void binder_pop_transaction(struct binder_thread *target_thread,
 				   struct binder_transaction *t)
 {
@@ -1368,6 +1552,10 @@ static void binder_transaction_buffer_release(struct binder_proc *proc,
 				task_close_fd(proc, fp->handle);
 			break;
 
+		case BINDER_TYPE_PTR:
+			/* the copy lives in the buffer itself */
+			break;
+
 		default:
 			printk(KERN_ERR "binder: transaction release %d bad "
 			       "object type %lx\n", debug_id, fp->type);
@@ -1378,11 +1566,13 @@ static void binder_transaction_buffer_release(struct binder_proc *proc,
 
 static void binder_transaction(struct binder_proc *proc,
 			       struct binder_thread *thread,
-			       struct binder_transaction_data *tr, int reply)
+			       struct binder_transaction_data *tr, int reply,
+			       size_t extra_buffers_size)
 {
 	struct binder_transaction *t;
 	struct binder_work *tcomplete;
-	size_t *offp, *off_end;
+	size_t *offp, *off_end, *off_start;
+	uint8_t *sg_bufp, *sg_buf_end;
 	struct binder_proc *target_proc;
 	struct binder_thread *target_thread = NULL;
 	struct binder_node *target_node = NULL;
@@ -1391,6 +1581,7 @@ static void binder_transaction(struct binder_proc *proc,
 	struct binder_transaction *in_reply_to = NULL;
 	struct binder_transaction_log_entry *e;
 	uint32_t return_error;
+	u64 alloc_start;
 
 	e = binder_transaction_log_add(&binder_transaction_log);
 	e->call_type = reply ? 2 : !!(tr->flags & TF_ONE_WAY);
@@ -1548,8 +1739,12 @@ static void binder_transaction(struct binder_proc *proc,
 	t->code = tr->code;
 	t->flags = tr->flags;
 	t->priority = task_nice(current);
+	t->start_ns = sched_clock();
+	alloc_start = t->start_ns;
 	t->buffer = binder_alloc_buf(target_proc, tr->data_size,
-		tr->offsets_size, !reply && (t->flags & TF_ONE_WAY));
+		tr->offsets_size, extra_buffers_size,
+		!reply && (t->flags & TF_ONE_WAY));
+	binder_alloc_account(sched_clock() - alloc_start);
 	if (t->buffer == NULL) {
 		return_error = BR_FAILED_REPLY;
 		goto err_binder_alloc_buf_failed;
@@ -1582,7 +1777,10 @@ static void binder_transaction(struct binder_proc *proc,
 		return_error = BR_FAILED_REPLY;
 		goto err_bad_offset;
 	}
+	off_start = offp;
 	off_end = (void *)offp + tr->offsets_size;
+	sg_bufp = (uint8_t *)PTR_ALIGN(off_end, sizeof(void *));
+	sg_buf_end = sg_bufp + extra_buffers_size;
 	for (; offp < off_end; offp++) {
 		struct flat_binder_object *fp;
 		if (*offp > t->buffer->data_size - sizeof(*fp) ||
@@ -1725,6 +1923,73 @@ static void binder_transaction(struct binder_proc *proc,
 			fp->handle = target_fd;
 		} break;
 
+		case BINDER_TYPE_PTR: {
+			struct binder_buffer_object *bp, *parent;
+			size_t buf_left = sg_buf_end - sg_bufp;
+			uint8_t *parent_buf;
+
+			if (*offp > t->buffer->data_size - sizeof(*bp) ||
+			    t->buffer->data_size < sizeof(*bp)) {
+				binder_user_error("binder: %d:%d got transaction with "
+					"invalid offset, %zd\n",
+					proc->pid, thread->pid, *offp);
+				return_error = BR_FAILED_REPLY;
+				goto err_bad_offset;
+			}
+			bp = (struct binder_buffer_object *)fp;
+			if (bp->length > buf_left ||
+			    ALIGN(bp->length, sizeof(void *)) > buf_left) {
+				binder_user_error("binder: %d:%d got transaction with "
+					"too large buffer, %zd > %zd\n",
+					proc->pid, thread->pid, bp->length,
+					buf_left);
+				return_error = BR_FAILED_REPLY;
+				goto err_bad_offset;
+			}
+			if (copy_from_user(sg_bufp, bp->buffer, bp->length)) {
+				binder_user_error("binder: %d:%d got transaction with "
+					"invalid buffer ptr\n",
+					proc->pid, thread->pid);
+				return_error = BR_FAILED_REPLY;
+				goto err_copy_data_failed;
+			}
+			binder_debug(BINDER_DEBUG_TRANSACTION,
+				     "        buffer %p size %zd\n",
+				     bp->buffer, bp->length);
+			bp->buffer = (void __user *)((uintptr_t)sg_bufp +
+					target_proc->user_buffer_offset);
+			sg_bufp += ALIGN(bp->length, sizeof(void *));
+
+			if (!(bp->flags & BINDER_BUFFER_FLAG_HAS_PARENT))
+				break;
+
+			/* parents come first, so they are already checked */
+			if (bp->parent >= offp - off_start) {
+				binder_user_error("binder: %d:%d got transaction with "
+					"invalid parent, %zd\n",
+					proc->pid, thread->pid, bp->parent);
+				return_error = BR_FAILED_REPLY;
+				goto err_bad_parent;
+			}
+			parent = (struct binder_buffer_object *)
+				(t->buffer->data + off_start[bp->parent]);
+			if (parent->type != BINDER_TYPE_PTR ||
+			    parent->length < sizeof(void *) ||
+			    bp->parent_offset > parent->length - sizeof(void *) ||
+			    !IS_ALIGNED(bp->parent_offset, sizeof(void *))) {
+				binder_user_error("binder: %d:%d got transaction with "
+					"invalid parent offset, %zd\n",
+					proc->pid, thread->pid,
+					bp->parent_offset);
+				return_error = BR_FAILED_REPLY;
+				goto err_bad_parent;
+			}
+			parent_buf = (uint8_t *)((uintptr_t)parent->buffer -
+					target_proc->user_buffer_offset);
+			*(void __user **)(parent_buf + bp->parent_offset) =
+				bp->buffer;
+		} break;
+
 		default:
 			binder_user_error("binder: %d:%d got transactio"
 				"n with invalid object type, %lx\n",
@@ -1735,6 +2000,7 @@ static void binder_transaction(struct binder_proc *proc,
 	}
 	if (reply) {
 		BUG_ON(t->buffer->async_transaction != 0);
+		binder_latency_account(proc, in_reply_to);
 		binder_pop_transaction(target_thread, in_reply_to);
 	} else if (!(t->flags & TF_ONE_WAY)) {
 		BUG_ON(t->buffer->async_transaction != 0);
@@ -1765,6 +2031,7 @@ err_binder_get_ref_for_node_failed:
 err_binder_get_ref_failed:
 err_binder_new_node_failed:
 err_bad_object_type:
+err_bad_parent:
 err_bad_offset:
 err_copy_data_failed:
 	binder_transaction_buffer_release(target_proc, t->buffer, offp);
@@ -1993,7 +2260,19 @@ int binder_thread_write(struct binder_proc *proc, struct binder_thread *thread,
 			if (copy_from_user(&tr, ptr, sizeof(tr)))
 				return -EFAULT;
 			ptr += sizeof(tr);
-			binder_transaction(proc, thread, &tr, cmd == BC_REPLY);
+			binder_transaction(proc, thread, &tr, cmd == BC_REPLY, 0);
+			break;
+		}
+
+		case BC_TRANSACTION_SG:
+		case BC_REPLY_SG: {
+			struct binder_transaction_data_sg tr;
+
+			if (copy_from_user(&tr, ptr, sizeof(tr)))
+				return -EFAULT;
+			ptr += sizeof(tr);
+			binder_transaction(proc, thread, &tr.transaction_data,
+					   cmd == BC_REPLY_SG, tr.buffers_size);
 			break;
 		}
 
@@ -2250,7 +2529,7 @@ retry:
 	thread->looper |= BINDER_LOOPER_STATE_WAITING;
 	if (wait_for_proc_work)
 		proc->ready_threads++;
-	mutex_unlock(&binder_lock);
+	binder_unlock(__func__);
 	if (wait_for_proc_work) {
 		if (!(thread->looper & (BINDER_LOOPER_STATE_REGISTERED |
 					BINDER_LOOPER_STATE_ENTERED))) {
@@ -2274,7 +2553,7 @@ retry:
 		} else
 			ret = wait_event_interruptible(thread->wait, binder_has_thread_work(thread));
 	}
-	mutex_lock(&binder_lock);
+	binder_lock(__func__);
 	if (wait_for_proc_work)
 		proc->ready_threads--;
 	thread->looper &= ~BINDER_LOOPER_STATE_WAITING;
@@ -2616,12 +2895,12 @@ static unsigned int binder_poll(struct file *filp,
 	struct binder_thread *thread = NULL;
 	int wait_for_proc_work;
 
-	mutex_lock(&binder_lock);
+	binder_lock(__func__);
 	thread = binder_get_thread(proc);
 
 	wait_for_proc_work = thread->transaction_stack == NULL &&
 		list_empty(&thread->todo) && thread->return_error == BR_OK;
-	mutex_unlock(&binder_lock);
+	binder_unlock(__func__);
 
 	if (wait_for_proc_work) {
 		if (binder_has_proc_work(proc, thread))
@@ -2653,7 +2932,7 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	if (ret)
 		return ret;
 
-	mutex_lock(&binder_lock);
+	binder_lock(__func__);
 	thread = binder_get_thread(proc);
 	if (thread == NULL) {
 		ret = -ENOMEM;
@@ -2765,7 +3044,7 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 err:
 	if (thread)
 		thread->looper &= ~BINDER_LOOPER_STATE_NEED_RETURN;
-	mutex_unlock(&binder_lock);
+	binder_unlock(__func__);
 	wait_event_interruptible(binder_user_error_wait, binder_stop_on_user_error < 2);
 	if (ret && ret != -ERESTARTSYS)
 		printk(KERN_INFO "binder: %d:%d ioctl %x %lx returned %d\n", proc->pid, current->pid, cmd, arg, ret);
@@ -2906,13 +3185,13 @@ static int binder_open(struct inode *nodp, struct file *filp)
 	INIT_LIST_HEAD(&proc->todo);
 	init_waitqueue_head(&proc->wait);
 	proc->default_priority = task_nice(current);
-	mutex_lock(&binder_lock);
+	binder_lock(__func__);
 	binder_stats_created(BINDER_STAT_PROC);
 	hlist_add_head(&proc->proc_node, &binder_procs);
 	proc->pid = current->group_leader->pid;
 	INIT_LIST_HEAD(&proc->delivered_death);
 	filp->private_data = proc;
-	mutex_unlock(&binder_lock);
+	binder_unlock(__func__);
 
 	if (binder_debugfs_dir_entry_proc) {
 		char strbuf[11];
@@ -3050,6 +3329,11 @@ static void binder_deferred_release(struct binder_proc *proc)
 		buffers++;
 	}
 
+	while ((n = rb_first(&proc->latency))) {
+		rb_erase(n, &proc->latency);
+		kfree(rb_entry(n, struct binder_latency, rb_node));
+	}
+
 	binder_stats_deleted(BINDER_STAT_PROC);
 
 	page_count = 0;
@@ -3092,7 +3376,7 @@ static void binder_deferred_func(struct work_struct *work)
 
 	int defer;
 	do {
-		mutex_lock(&binder_lock);
+		binder_lock(__func__);
 		mutex_lock(&binder_deferred_lock);
 		if (!hlist_empty(&binder_deferred_list)) {
 			proc = hlist_entry(binder_deferred_list.first,
@@ -3119,7 +3403,7 @@ static void binder_deferred_func(struct work_struct *work)
 		if (defer & BINDER_DEFERRED_RELEASE)
 			binder_deferred_release(proc); /* frees proc */
 
-		mutex_unlock(&binder_lock);
+		binder_unlock(__func__);
 		if (files)
 			put_files_struct(files);
 	} while (proc);
@@ -3351,7 +3635,9 @@ static const char *binder_command_strings[] = {
 	"BC_EXIT_LOOPER",
 	"BC_REQUEST_DEATH_NOTIFICATION",
 	"BC_CLEAR_DEATH_NOTIFICATION",
-	"BC_DEAD_BINDER_DONE"
+	"BC_DEAD_BINDER_DONE",
+	"BC_TRANSACTION_SG",
+	"BC_REPLY_SG"
 };
 
 static const char *binder_objstat_strings[] = {
@@ -3435,6 +3721,7 @@ static void print_binder_proc_stats(struct seq_file *m,
 	for (n = rb_first(&proc->allocated_buffers); n != NULL; n = rb_next(n))
 		count++;
 	seq_printf(m, "  buffers: %d\n", count);
+	seq_printf(m, "  pages kept: %u\n", proc->pages_kept);
 
 	count = 0;
 	list_for_each_entry(w, &proc->todo, entry) {
@@ -3460,7 +3747,7 @@ static int binder_state_show(struct seq_file *m, void *unused)
 	int do_lock = !binder_debug_no_lock;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		binder_lock(__func__);
 
 	seq_puts(m, "binder state:\n");
 
@@ -3472,7 +3759,7 @@ static int binder_state_show(struct seq_file *m, void *unused)
 	hlist_for_each_entry(proc, pos, &binder_procs, proc_node)
 		print_binder_proc(m, proc, 1);
 	if (do_lock)
-		mutex_unlock(&binder_lock);
+		binder_unlock(__func__);
 	return 0;
 }
 
@@ -3481,18 +3768,33 @@ static int binder_stats_show(struct seq_file *m, void *unused)
 	struct binder_proc *proc;
 	struct hlist_node *pos;
 	int do_lock = !binder_debug_no_lock;
+	int i;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		binder_lock(__func__);
 
 	seq_puts(m, "binder stats:\n");
 
+	seq_printf(m, "lock: acquired %llu contended %llu "
+		   "wait %llu ns max %llu ns hold max %llu ns (%s)\n",
+		   binder_lock_stats.acquired, binder_lock_stats.contended,
+		   binder_lock_stats.wait_ns, binder_lock_stats.wait_max_ns,
+		   binder_lock_stats.hold_max_ns,
+		   binder_lock_stats.hold_max_tag ?: "-");
+
+	seq_printf(m, "alloc: pages mapped %llu reused %llu, us",
+		   binder_alloc_stats.pages_mapped,
+		   binder_alloc_stats.pages_reused);
+	for (i = 0; i < BINDER_ALLOC_HIST - 1; i++)
+		seq_printf(m, " <%d:%llu", 1 << i, binder_alloc_stats.hist[i]);
+	seq_printf(m, " >=%d:%llu\n", 1 << i, binder_alloc_stats.hist[i]);
+
 	print_binder_stats(m, "", &binder_stats);
 
 	hlist_for_each_entry(proc, pos, &binder_procs, proc_node)
 		print_binder_proc_stats(m, proc);
 	if (do_lock)
-		mutex_unlock(&binder_lock);
+		binder_unlock(__func__);
 	return 0;
 }
 
@@ -3503,13 +3805,64 @@ static int binder_transactions_show(struct seq_file *m, void *unused)
 	int do_lock = !binder_debug_no_lock;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		binder_lock(__func__);
 
 	seq_puts(m, "binder transactions:\n");
 	hlist_for_each_entry(proc, pos, &binder_procs, proc_node)
 		print_binder_proc(m, proc, 0);
 	if (do_lock)
-		mutex_unlock(&binder_lock);
+		binder_unlock(__func__);
+	return 0;
+}
+
+static unsigned long long binder_latency_us(u64 ns, unsigned int count)
+{
+	if (count)
+		do_div(ns, count);
+	do_div(ns, NSEC_PER_USEC);
+	return ns;
+}
+
+static void print_binder_proc_latency(struct seq_file *m,
+				      struct binder_proc *proc)
+{
+	struct binder_latency *lat;
+	struct rb_node *n;
+	int i;
+
+	if (RB_EMPTY_ROOT(&proc->latency) && !proc->latency_untracked)
+		return;
+
+	seq_printf(m, "proc %d\n", proc->pid);
+	for (n = rb_first(&proc->latency); n != NULL; n = rb_next(n)) {
+		lat = rb_entry(n, struct binder_latency, rb_node);
+		seq_printf(m, "  code %u: calls %u avg %llu us max %llu us\n"
+			   "   ", lat->code, lat->count,
+			   binder_latency_us(lat->total_ns, lat->count),
+			   binder_latency_us(lat->max_ns, 1));
+		for (i = 0; i < BINDER_LATENCY_HIST - 1; i++)
+			seq_printf(m, " <%lu:%llu", 1UL << (2 * i), lat->hist[i]);
+		seq_printf(m, " >=%lu:%llu\n", 1UL << (2 * i), lat->hist[i]);
+	}
+	if (proc->latency_untracked)
+		seq_printf(m, "  untracked calls: %llu\n",
+			   proc->latency_untracked);
+}
+
+static int binder_latency_show(struct seq_file *m, void *unused)
+{
+	struct binder_proc *proc;
+	struct hlist_node *pos;
+	int do_lock = !binder_debug_no_lock;
+
+	if (do_lock)
+		binder_lock(__func__);
+
+	seq_puts(m, "binder latency:\n");
+	hlist_for_each_entry(proc, pos, &binder_procs, proc_node)
+		print_binder_proc_latency(m, proc);
+	if (do_lock)
+		binder_unlock(__func__);
 	return 0;
 }
 
@@ -3519,11 +3872,11 @@ static int binder_proc_show(struct seq_file *m, void *unused)
 	int do_lock = !binder_debug_no_lock;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		binder_lock(__func__);
 	seq_puts(m, "binder proc state:\n");
 	print_binder_proc(m, proc, 1);
 	if (do_lock)
-		mutex_unlock(&binder_lock);
+		binder_unlock(__func__);
 	return 0;
 }
 
@@ -3572,6 +3925,7 @@ BINDER_DEBUG_ENTRY(state);
 BINDER_DEBUG_ENTRY(stats);
 BINDER_DEBUG_ENTRY(transactions);
 BINDER_DEBUG_ENTRY(transaction_log);
+BINDER_DEBUG_ENTRY(latency);
 
 static int __init binder_init(void)
 {
@@ -3612,6 +3966,11 @@ static int __init binder_init(void)
 				    binder_debugfs_dir_entry_root,
 				    &binder_transaction_log_failed,
 				    &binder_transaction_log_fops);
+		debugfs_create_file("latency",
+				    S_IRUGO,
+				    binder_debugfs_dir_entry_root,
+				    NULL,
+				    &binder_latency_fops);
 	}
 	return ret;
 }
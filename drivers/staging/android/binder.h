@@ -32,6 +32,7 @@ enum {
 	BINDER_TYPE_HANDLE	= B_PACK_CHARS('s', 'h', '*', B_TYPE_LARGE),
 	BINDER_TYPE_WEAK_HANDLE	= B_PACK_CHARS('w', 'h', '*', B_TYPE_LARGE),
 	BINDER_TYPE_FD		= B_PACK_CHARS('f', 'd', '*', B_TYPE_LARGE),
+	BINDER_TYPE_PTR		= B_PACK_CHARS('p', 't', '*', B_TYPE_LARGE),
 };
 
 enum {
@@ -61,6 +62,27 @@ struct flat_binder_object {
 	void			*cookie;
 };
 
+enum {
+	BINDER_BUFFER_FLAG_HAS_PARENT = 0x01,
+};
+
+/*
+ * A buffer of a BC_TRANSACTION_SG/BC_REPLY_SG, copied by the driver
+ * straight from 'buffer' into the target's transaction buffer, after the
+ * offsets, and rewritten to point at the copy. With HAS_PARENT set,
+ * 'parent' is the index in the offsets of an earlier BINDER_TYPE_PTR
+ * object, and the pointer at 'parent_offset' in its buffer is rewritten
+ * too, so embedded pointers stay valid in the target.
+ */
+struct binder_buffer_object {
+	unsigned long		type;
+	unsigned long		flags;
+	void __user		*buffer;
+	size_t			length;
+	size_t			parent;
+	size_t			parent_offset;
+};
+
 /*
  * On 64-bit platforms where user code may run in 32-bits the driver must
  * translate the buffer (and local binder) addresses apropriately.
@@ -147,6 +169,12 @@ struct binder_transaction_data {
 	} data;
 };
 
+struct binder_transaction_data_sg {
+	struct binder_transaction_data transaction_data;
+	/* total size of the BINDER_TYPE_PTR buffers, each aligned */
+	size_t buffers_size;
+};
+
 struct binder_ptr_cookie {
 	void *ptr;
 	void *cookie;
@@ -324,6 +352,13 @@ enum BinderDriverCommandProtocol {
 	/*
 	 * void *: cookie
 	 */
+
+	BC_TRANSACTION_SG = _IOW('c', 17, struct binder_transaction_data_sg),
+	BC_REPLY_SG = _IOW('c', 18, struct binder_transaction_data_sg),
+	/*
+	 * binder_transaction_data_sg: the sent command, with the size of
+	 * the BINDER_TYPE_PTR buffers its offsets refer to.
+	 */
 };
 
 #endif /* _LINUX_BINDER_H */
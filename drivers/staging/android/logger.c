@@ -19,11 +19,14 @@
 
 #include <linux/sched.h>
 #include <linux/module.h>
+#include <linux/device.h>
 #include <linux/fs.h>
 #include <linux/miscdevice.h>
+#include <linux/mm.h>
 #include <linux/uaccess.h>
 #include <linux/poll.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/time.h>
 #include "logger.h"
 
@@ -33,34 +36,63 @@
  * struct logger_log - represents a specific log, such as 'main' or 'radio'
  *
  * This structure lives from module insertion until module removal, so it does
- * not need additional reference counting. The structure is protected by the
- * mutex 'mutex'.
+ * not need additional reference counting. The offsets, lists and counters are
+ * protected by the spinlock 'lock', which is never held across a user copy.
+ * The mutex 'mutex' only serializes readers and ioctls; writers never take it.
+ *
+ * A writer reserves its entry under 'lock', copies the payload in without it
+ * and then commits. Entries between 'c_off' and 'w_off' are reserved but may
+ * not be committed yet, so readers stop at 'c_off'.
  */
 struct logger_log {
 	unsigned char 		*buffer;/* the ring buffer itself */
 	struct miscdevice	misc;	/* misc device representing the log */
 	wait_queue_head_t	wq;	/* wait queue for readers */
 	struct list_head	readers; /* this log's readers */
-	struct mutex		mutex;	/* mutex protecting buffer */
+	struct list_head	writers; /* writes reserved, oldest first */
+	struct mutex		mutex;	/* mutex serializing readers */
+	spinlock_t		lock;	/* lock protecting offsets and lists */
 	size_t			w_off;	/* current write head offset */
+	size_t			c_off;	/* readers may read up to here */
 	size_t			head;	/* new readers start here */
 	size_t			size;	/* size of the log */
+	unsigned long		dropped;	/* writes not logged */
+	unsigned long		overwritten;	/* entries lost to the ring */
 };
 
 /*
  * struct logger_reader - a logging device open for reading
  *
  * This object lives from open to release, so we don't need additional
- * reference counting. The structure is protected by log->mutex.
+ * reference counting. The structure is protected by log->lock; r_ver is
+ * protected by log->mutex.
  */
 struct logger_reader {
 	struct logger_log	*log;	/* associated log */
 	struct list_head	list;	/* entry in logger_log's list */
 	size_t			r_off;	/* current read head offset */
 	bool			r_all;	/* reader can read all entries */
+	bool			r_lapped; /* overwritten while being read */
 	int			r_ver;	/* reader ABI version */
 };
 
+/*
+ * struct logger_write - one write between its reservation and its commit,
+ * on the writer's stack
+ */
+struct logger_write {
+	struct list_head	list;	/* entry in logger_log's writers */
+	size_t			off;	/* offset of the entry's header */
+};
+
+/*
+ * A new entry is dropped rather than wait for a reserved one it would come
+ * this close to. Readers pulled forward by the new entry may walk one more
+ * entry past it, which must not be an uncommitted one.
+ */
+#define LOGGER_WRITE_MARGIN \
+	(2 * (sizeof(struct logger_entry) + LOGGER_ENTRY_MAX_PAYLOAD))
+
 /* logger_offset - returns index 'n' into the log via (optimized) modulus */
 #define logger_offset(n)	((n) & (log->size - 1))
 
@@ -112,7 +144,7 @@ static struct logger_entry *get_entry_header(struct logger_log *log,
  * get_entry_msg_len - Grabs the length of the message of the entry
  * starting from from 'off'.
  *
- * Caller needs to hold log->mutex.
+ * Caller needs to hold log->lock.
  */
 static __u32 get_entry_msg_len(struct logger_log *log, size_t off)
 {
@@ -156,18 +188,19 @@ static ssize_t copy_header_to_user(int ver, struct logger_entry *entry,
 }
 
 /*
- * do_read_log_to_user - reads exactly 'count' bytes from 'log' into the
- * user-space buffer 'buf'. Returns 'count' on success.
+ * do_read_log_to_user - reads exactly 'count' bytes of the entry at 'off',
+ * whose header is 'entry', from 'log' into the user-space buffer 'buf'.
+ * Returns 'count' on success.
  *
- * Caller must hold log->mutex.
+ * Caller must hold log->mutex, but not log->lock: a writer may overwrite
+ * the entry meanwhile, which fix_up_readers() reports in reader->r_lapped.
  */
 static ssize_t do_read_log_to_user(struct logger_log *log,
 				   struct logger_reader *reader,
+				   struct logger_entry *entry, size_t off,
 				   char __user *buf,
 				   size_t count)
 {
-	struct logger_entry scratch;
-	struct logger_entry *entry;
 	size_t len;
 	size_t msg_start;
 
@@ -175,13 +208,12 @@ static ssize_t do_read_log_to_user(struct logger_log *log,
 	 * First, copy the header to userspace, using the version of
 	 * the header requested
 	 */
-	entry = get_entry_header(log, reader->r_off, &scratch);
 	if (copy_header_to_user(reader->r_ver, entry, buf))
 		return -EFAULT;
 
 	count -= get_user_hdr_len(reader->r_ver);
 	buf += get_user_hdr_len(reader->r_ver);
-	msg_start = logger_offset(reader->r_off + sizeof(struct logger_entry));
+	msg_start = logger_offset(off + sizeof(struct logger_entry));
 
 	/*
 	 * We read from the msg in two disjoint operations. First, we read from
@@ -200,9 +232,6 @@ static ssize_t do_read_log_to_user(struct logger_log *log,
 		if (copy_to_user(buf + len, log->buffer, count - len))
 			return -EFAULT;
 
-	reader->r_off = logger_offset(reader->r_off +
-		sizeof(struct logger_entry) + count);
-
 	return count + get_user_hdr_len(reader->r_ver);
 }
 
@@ -213,7 +242,7 @@ static ssize_t do_read_log_to_user(struct logger_log *log,
 static size_t get_next_entry_by_uid(struct logger_log *log,
 		size_t off, uid_t euid)
 {
-	while (off != log->w_off) {
+	while (off != log->c_off) {
 		struct logger_entry *entry;
 		struct logger_entry scratch;
 		size_t next_len;
@@ -247,6 +276,8 @@ static ssize_t logger_read(struct file *file, char __user *buf,
 {
 	struct logger_reader *reader = file->private_data;
 	struct logger_log *log = reader->log;
+	struct logger_entry scratch, entry;
+	size_t off;
 	ssize_t ret;
 	DEFINE_WAIT(wait);
 
@@ -254,9 +285,9 @@ start:
 	while (1) {
 		prepare_to_wait(&log->wq, &wait, TASK_INTERRUPTIBLE);
 
-		mutex_lock(&log->mutex);
-		ret = (log->w_off == reader->r_off);
-		mutex_unlock(&log->mutex);
+		spin_lock(&log->lock);
+		ret = (log->c_off == reader->r_off);
+		spin_unlock(&log->lock);
 		if (!ret)
 			break;
 
@@ -278,27 +309,45 @@ start:
 		return ret;
 
 	mutex_lock(&log->mutex);
+	spin_lock(&log->lock);
 
 	if (!reader->r_all)
 		reader->r_off = get_next_entry_by_uid(log,
 			reader->r_off, current_euid());
 
 	/* is there still something to read or did we race? */
-	if (unlikely(log->w_off == reader->r_off)) {
+	if (unlikely(log->c_off == reader->r_off)) {
+		spin_unlock(&log->lock);
 		mutex_unlock(&log->mutex);
 		goto start;
 	}
 
 	/* get the size of the next entry */
-	ret = get_user_hdr_len(reader->r_ver) +
-		get_entry_msg_len(log, reader->r_off);
+	off = reader->r_off;
+	entry = *get_entry_header(log, off, &scratch);
+	ret = get_user_hdr_len(reader->r_ver) + entry.len;
 	if (count < ret) {
+		spin_unlock(&log->lock);
 		ret = -EINVAL;
 		goto out;
 	}
+	reader->r_lapped = false;
+	spin_unlock(&log->lock);
 
 	/* get exactly one entry from the log */
-	ret = do_read_log_to_user(log, reader, buf, ret);
+	ret = do_read_log_to_user(log, reader, &entry, off, buf, ret);
+
+	spin_lock(&log->lock);
+	if (unlikely(reader->r_lapped)) {
+		/* what was copied may be torn, read the next entry instead */
+		spin_unlock(&log->lock);
+		mutex_unlock(&log->mutex);
+		goto start;
+	}
+	if (ret >= 0)
+		reader->r_off = logger_offset(off +
+			sizeof(struct logger_entry) + entry.len);
+	spin_unlock(&log->lock);
 
 out:
 	mutex_unlock(&log->mutex);
@@ -308,11 +357,12 @@ out:
 
 /*
  * get_next_entry - return the offset of the first valid entry at least 'len'
- * bytes after 'off'.
+ * bytes after 'off'. The number of entries skipped is added to '*skipped'.
  *
- * Caller must hold log->mutex.
+ * Caller must hold log->lock.
  */
-static size_t get_next_entry(struct logger_log *log, size_t off, size_t len)
+static size_t get_next_entry(struct logger_log *log, size_t off, size_t len,
+			     unsigned long *skipped)
 {
 	size_t count = 0;
 
@@ -321,6 +371,7 @@ static size_t get_next_entry(struct logger_log *log, size_t off, size_t len)
 			get_entry_msg_len(log, off);
 		off = logger_offset(off + nr);
 		count += nr;
+		(*skipped)++;
 	} while (count < len);
 
 	return off;
@@ -349,26 +400,31 @@ static inline int clock_interval(size_t a, size_t b, size_t c)
  * We do this by "pulling forward" the readers and start head to the first
  * entry after the new write head.
  *
- * The caller needs to hold log->mutex.
+ * The caller needs to hold log->lock.
  */
 static void fix_up_readers(struct logger_log *log, size_t len)
 {
 	size_t old = log->w_off;
 	size_t new = logger_offset(old + len);
 	struct logger_reader *reader;
+	unsigned long skipped = 0;
 
 	if (clock_interval(old, new, log->head))
-		log->head = get_next_entry(log, log->head, len);
+		log->head = get_next_entry(log, log->head, len,
+					   &log->overwritten);
 
 	list_for_each_entry(reader, &log->readers, list)
-		if (clock_interval(old, new, reader->r_off))
-			reader->r_off = get_next_entry(log, reader->r_off, len);
+		if (clock_interval(old, new, reader->r_off)) {
+			reader->r_off = get_next_entry(log, reader->r_off, len,
+						       &skipped);
+			reader->r_lapped = true;
+		}
 }
 
 /*
  * do_write_log - writes 'len' bytes from 'buf' to 'log'
  *
- * The caller needs to hold log->mutex.
+ * The caller needs to hold log->lock.
  */
 static void do_write_log(struct logger_log *log, const void *buf, size_t count)
 {
@@ -386,30 +442,45 @@ static void do_write_log(struct logger_log *log, const void *buf, size_t count)
 
 /*
  * do_write_log_user - writes 'len' bytes from the user-space buffer 'buf' to
- * the log 'log'
+ * the part of the log 'log' reserved at '*off', and advances '*off'
  *
- * The caller needs to hold log->mutex.
+ * Called without log->lock: the range is reserved for this writer.
  *
  * Returns 'count' on success, negative error code on failure.
  */
-static ssize_t do_write_log_from_user(struct logger_log *log,
+static ssize_t do_write_log_from_user(struct logger_log *log, size_t *off,
 				      const void __user *buf, size_t count)
 {
 	size_t len;
 
-	len = min(count, log->size - log->w_off);
-	if (len && copy_from_user(log->buffer + log->w_off, buf, len))
+	len = min(count, log->size - *off);
+	if (len && copy_from_user(log->buffer + *off, buf, len))
 		return -EFAULT;
 
 	if (count != len)
 		if (copy_from_user(log->buffer, buf + len, count - len))
 			return -EFAULT;
 
-	log->w_off = logger_offset(log->w_off + count);
+	*off = logger_offset(*off + count);
 
 	return count;
 }
 
+/*
+ * do_clear_log - zeroes 'count' bytes of 'log' at 'off', for the payload
+ * of a write that failed after its reservation
+ */
+static void do_clear_log(struct logger_log *log, size_t off, size_t count)
+{
+	size_t len;
+
+	len = min(count, log->size - off);
+	memset(log->buffer + off, 0, len);
+
+	if (count != len)
+		memset(log->buffer, 0, count - len);
+}
+
 /*
  * logger_aio_write - our write method, implementing support for write(),
  * writev(), and aio_write(). Writes are our fast path, and we try to optimize
@@ -419,9 +490,10 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 			 unsigned long nr_segs, loff_t ppos)
 {
 	struct logger_log *log = file_get_log(iocb->ki_filp);
-	size_t orig = log->w_off;
+	struct logger_write write;
 	struct logger_entry header;
 	struct timespec now;
+	size_t off, count;
 	ssize_t ret = 0;
 
 	now = current_kernel_time();
@@ -438,7 +510,18 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 	if (unlikely(!header.len))
 		return 0;
 
-	mutex_lock(&log->mutex);
+	count = sizeof(struct logger_entry) + header.len;
+
+	spin_lock(&log->lock);
+
+	/* never overwrite an entry that is still being copied in */
+	if (unlikely(!list_empty(&log->writers) &&
+		     clock_interval(log->w_off, logger_offset(log->w_off +
+				    count + LOGGER_WRITE_MARGIN), log->c_off))) {
+		log->dropped++;
+		spin_unlock(&log->lock);
+		return header.len;
+	}
 
 	/*
 	 * Fix up any readers, pulling them forward to the first readable
@@ -446,9 +529,18 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 	 * because if we partially fail, we can end up with clobbered log
 	 * entries that encroach on readable buffer.
 	 */
-	fix_up_readers(log, sizeof(struct logger_entry) + header.len);
+	fix_up_readers(log, count);
 
+	/* reserve the entry; readers stop at the oldest reserved one */
+	write.off = log->w_off;
+	if (list_empty(&log->writers))
+		log->c_off = write.off;
+	list_add_tail(&write.list, &log->writers);
 	do_write_log(log, &header, sizeof(struct logger_entry));
+	off = log->w_off;
+	log->w_off = logger_offset(write.off + count);
+
+	spin_unlock(&log->lock);
 
 	while (nr_segs-- > 0) {
 		size_t len;
@@ -458,18 +550,29 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 		len = min_t(size_t, iov->iov_len, header.len - ret);
 
 		/* write out this segment's payload */
-		nr = do_write_log_from_user(log, iov->iov_base, len);
+		nr = do_write_log_from_user(log, &off, iov->iov_base, len);
 		if (unlikely(nr < 0)) {
-			log->w_off = orig;
-			mutex_unlock(&log->mutex);
-			return nr;
+			/* the space is taken, log the entry empty */
+			do_clear_log(log, off, header.len - ret);
+			ret = nr;
+			break;
 		}
 
 		iov++;
 		ret += nr;
 	}
 
-	mutex_unlock(&log->mutex);
+	/* commit the entry */
+	spin_lock(&log->lock);
+	list_del(&write.list);
+	if (list_empty(&log->writers))
+		log->c_off = log->w_off;
+	else
+		log->c_off = list_first_entry(&log->writers,
+					      struct logger_write, list)->off;
+	if (unlikely(ret < 0))
+		log->dropped++;
+	spin_unlock(&log->lock);
 
 	/* wake up any blocked readers */
 	wake_up_interruptible(&log->wq);
@@ -511,10 +614,11 @@ static int logger_open(struct inode *inode, struct file *file)
 
 		INIT_LIST_HEAD(&reader->list);
 
-		mutex_lock(&log->mutex);
+		spin_lock(&log->lock);
 		reader->r_off = log->head;
+		reader->r_lapped = false;
 		list_add_tail(&reader->list, &log->readers);
-		mutex_unlock(&log->mutex);
+		spin_unlock(&log->lock);
 
 		file->private_data = reader;
 	} else
@@ -532,7 +636,11 @@ static int logger_release(struct inode *ignored, struct file *file)
 {
 	if (file->f_mode & FMODE_READ) {
 		struct logger_reader *reader = file->private_data;
+		struct logger_log *log = reader->log;
+
+		spin_lock(&log->lock);
 		list_del(&reader->list);
+		spin_unlock(&log->lock);
 		kfree(reader);
 	}
 
@@ -562,15 +670,111 @@ static unsigned int logger_poll(struct file *file, poll_table *wait)
 
 	poll_wait(file, &log->wq, wait);
 
-	mutex_lock(&log->mutex);
+	spin_lock(&log->lock);
 	if (!reader->r_all)
 		reader->r_off = get_next_entry_by_uid(log,
 			reader->r_off, current_euid());
 
-	if (log->w_off != reader->r_off)
+	if (log->c_off != reader->r_off)
 		ret |= POLLIN | POLLRDNORM;
-	mutex_unlock(&log->mutex);
+	spin_unlock(&log->lock);
+
+	return ret;
+}
+
+/*
+ * logger_mmap - the log's mmap file operation, a read-only view of the ring
+ *
+ * Only for readers that may read all entries: the ring holds every uid's.
+ */
+static int logger_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct logger_reader *reader;
+	struct logger_log *log;
+
+	if (!(file->f_mode & FMODE_READ))
+		return -EBADF;
+
+	reader = file->private_data;
+	log = reader->log;
+
+	if (!reader->r_all)
+		return -EPERM;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != log->size)
+		return -EINVAL;
 
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_flags |= VM_DONTEXPAND;
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       virt_to_phys(log->buffer) >> PAGE_SHIFT,
+			       log->size, vma->vm_page_prot);
+}
+
+/*
+ * log_avail - bytes of committed entries from 'off'
+ *
+ * Caller needs to hold log->lock.
+ */
+static size_t log_avail(struct logger_log *log, size_t off)
+{
+	if (log->c_off >= off)
+		return log->c_off - off;
+	else
+		return (log->size - off) + log->c_off;
+}
+
+static long logger_get_ring_pos(struct logger_reader *reader, void __user *arg)
+{
+	struct logger_log *log = reader->log;
+	struct logger_ring_pos pos;
+
+	if (!reader->r_all)
+		return -EPERM;
+
+	spin_lock(&log->lock);
+	pos.off = reader->r_off;
+	pos.len = log_avail(log, reader->r_off);
+	reader->r_lapped = false;
+	spin_unlock(&log->lock);
+
+	if (copy_to_user(arg, &pos, sizeof(pos)))
+		return -EFAULT;
+	return 0;
+}
+
+/*
+ * logger_advance - moves the reader 'count' bytes on, which must end on an
+ * entry boundary within what the last LOGGER_GET_RING_POS reported
+ */
+static long logger_advance(struct logger_reader *reader, unsigned long count)
+{
+	struct logger_log *log = reader->log;
+	size_t off, done = 0;
+	long ret = 0;
+
+	spin_lock(&log->lock);
+	if (reader->r_lapped) {
+		ret = -EAGAIN;
+		goto out;
+	}
+
+	off = reader->r_off;
+	while (done < count && off != log->c_off) {
+		size_t nr = sizeof(struct logger_entry) +
+			get_entry_msg_len(log, off);
+		off = logger_offset(off + nr);
+		done += nr;
+	}
+	if (done != count) {
+		ret = -EINVAL;
+		goto out;
+	}
+	reader->r_off = off;
+out:
+	spin_unlock(&log->lock);
 	return ret;
 }
 
@@ -606,10 +810,9 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 		reader = file->private_data;
-		if (log->w_off >= reader->r_off)
-			ret = log->w_off - reader->r_off;
-		else
-			ret = (log->size - reader->r_off) + log->w_off;
+		spin_lock(&log->lock);
+		ret = log_avail(log, reader->r_off);
+		spin_unlock(&log->lock);
 		break;
 	case LOGGER_GET_NEXT_ENTRY_LEN:
 		if (!(file->f_mode & FMODE_READ)) {
@@ -618,24 +821,28 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		}
 		reader = file->private_data;
 
+		spin_lock(&log->lock);
 		if (!reader->r_all)
 			reader->r_off = get_next_entry_by_uid(log,
 				reader->r_off, current_euid());
 
-		if (log->w_off != reader->r_off)
+		if (log->c_off != reader->r_off)
 			ret = get_user_hdr_len(reader->r_ver) +
 				get_entry_msg_len(log, reader->r_off);
 		else
 			ret = 0;
+		spin_unlock(&log->lock);
 		break;
 	case LOGGER_FLUSH_LOG:
 		if (!(file->f_mode & FMODE_WRITE)) {
 			ret = -EBADF;
 			break;
 		}
+		spin_lock(&log->lock);
 		list_for_each_entry(reader, &log->readers, list)
-			reader->r_off = log->w_off;
-		log->head = log->w_off;
+			reader->r_off = log->c_off;
+		log->head = log->c_off;
+		spin_unlock(&log->lock);
 		ret = 0;
 		break;
 	case LOGGER_GET_VERSION:
@@ -654,6 +861,22 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		reader = file->private_data;
 		ret = logger_set_version(reader, argp);
 		break;
+	case LOGGER_GET_RING_POS:
+		if (!(file->f_mode & FMODE_READ)) {
+			ret = -EBADF;
+			break;
+		}
+		reader = file->private_data;
+		ret = logger_get_ring_pos(reader, argp);
+		break;
+	case LOGGER_ADVANCE:
+		if (!(file->f_mode & FMODE_READ)) {
+			ret = -EBADF;
+			break;
+		}
+		reader = file->private_data;
+		ret = logger_advance(reader, arg);
+		break;
 	}
 
 	mutex_unlock(&log->mutex);
@@ -666,6 +889,7 @@ static const struct file_operations logger_fops = {
 	.read = logger_read,
 	.aio_write = logger_aio_write,
 	.poll = logger_poll,
+	.mmap = logger_mmap,
 	.unlocked_ioctl = logger_ioctl,
 	.compat_ioctl = logger_ioctl,
 	.open = logger_open,
@@ -675,10 +899,11 @@ static const struct file_operations logger_fops = {
 /*
  * Defines a log structure with name 'NAME' and a size of 'SIZE' bytes, which
  * must be a power of two, and greater than
- * (LOGGER_ENTRY_MAX_PAYLOAD + sizeof(struct logger_entry)).
+ * (LOGGER_ENTRY_MAX_PAYLOAD + sizeof(struct logger_entry)) and PAGE_SIZE.
+ * The buffer is page aligned for logger_mmap().
  */
 #define DEFINE_LOGGER_DEVICE(VAR, NAME, SIZE) \
-static unsigned char _buf_ ## VAR[SIZE]; \
+static unsigned char _buf_ ## VAR[SIZE] __aligned(PAGE_SIZE); \
 static struct logger_log VAR = { \
 	.buffer = _buf_ ## VAR, \
 	.misc = { \
@@ -689,8 +914,11 @@ static struct logger_log VAR = { \
 	}, \
 	.wq = __WAIT_QUEUE_HEAD_INITIALIZER(VAR .wq), \
 	.readers = LIST_HEAD_INIT(VAR .readers), \
+	.writers = LIST_HEAD_INIT(VAR .writers), \
 	.mutex = __MUTEX_INITIALIZER(VAR .mutex), \
+	.lock = __SPIN_LOCK_UNLOCKED(VAR .lock), \
 	.w_off = 0, \
+	.c_off = 0, \
 	.head = 0, \
 	.size = SIZE, \
 };
@@ -713,6 +941,29 @@ static struct logger_log *get_log_from_minor(int minor)
 	return NULL;
 }
 
+/*
+ * logger_stats_show - the log's 'stats' attribute: writes dropped to keep
+ * an entry being copied in intact or after a fault, and old entries lost
+ * to the ring
+ */
+static ssize_t logger_stats_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct miscdevice *misc = dev_get_drvdata(dev);
+	struct logger_log *log = container_of(misc, struct logger_log, misc);
+	unsigned long dropped, overwritten;
+
+	spin_lock(&log->lock);
+	dropped = log->dropped;
+	overwritten = log->overwritten;
+	spin_unlock(&log->lock);
+
+	return sprintf(buf, "dropped %lu\noverwritten %lu\n",
+		       dropped, overwritten);
+}
+
+static DEVICE_ATTR(stats, S_IRUGO, logger_stats_show, NULL);
+
 static int __init init_log(struct logger_log *log)
 {
 	int ret;
@@ -724,6 +975,10 @@ static int __init init_log(struct logger_log *log)
 		return ret;
 	}
 
+	if (device_create_file(log->misc.this_device, &dev_attr_stats))
+		printk(KERN_WARNING "logger: no stats for log '%s'\n",
+		       log->misc.name);
+
 	printk(KERN_INFO "logger: created %luK log '%s'\n",
 	       (unsigned long) log->size >> 10, log->misc.name);
 
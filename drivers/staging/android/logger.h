@@ -67,4 +67,22 @@ struct logger_entry {
 #define LOGGER_GET_VERSION		_IO(__LOGGERIO, 5) /* abi version */
 #define LOGGER_SET_VERSION		_IO(__LOGGERIO, 6) /* abi version */
 
+/*
+ * A reader that can read all entries may mmap() the whole ring, read-only,
+ * and parse the struct logger_entry records in it directly. The ring wraps
+ * at LOGGER_GET_LOG_BUF_SIZE, entries included.
+ *
+ * LOGGER_GET_RING_POS gives the reader's next entry and the bytes of
+ * complete entries from there. After parsing some of them, the reader
+ * passes the bytes it used to LOGGER_ADVANCE, which fails with EAGAIN if
+ * those entries were overwritten in the meantime.
+ */
+struct logger_ring_pos {
+	__u32		off;	/* offset of the next entry in the ring */
+	__u32		len;	/* bytes of complete entries from 'off' */
+};
+
+#define LOGGER_GET_RING_POS	_IOR(__LOGGERIO, 7, struct logger_ring_pos)
+#define LOGGER_ADVANCE		_IO(__LOGGERIO, 8) /* consume mmap'd bytes */
+
 #endif /* _LINUX_LOGGER_H */
@@ -12,6 +12,16 @@
  * and kill processes with a oom_adj value of 0 or higher when the free memory
  * drops below 1024 pages.
  *
+ * Processes are kept indexed by oom_adj as they fork, exit or get their
+ * oom_adj written, so the shrinker only looks at the processes it may kill.
+ *
+ * Before any kill, /dev/lowmem_pressure reports how hard reclaim is working:
+ * each window of scanned pages is graded low, medium or critical from the
+ * share of them that could not be reclaimed. A read returns the level of
+ * the latest event as a line of text and blocks (or poll() waits) until a
+ * new one arrives. Writing a level name to the open file makes that reader
+ * ignore events below it.
+ *
  * The driver considers memory used for caches to be free, but if a large
  * percentage of the cached memory is locked this can be very inaccurate
  * and processes may not get killed until the normal oom killer is triggered.
@@ -31,10 +41,18 @@
 
 #include <linux/module.h>
 #include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
 #include <linux/mm.h>
 #include <linux/oom.h>
+#include <linux/poll.h>
 #include <linux/sched.h>
 #include <linux/notifier.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/swap.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
 #ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_DO_NOT_KILL_PROCESS
 #include <linux/string.h>
 #endif
@@ -134,6 +152,311 @@ enum lowmem_process_type {
 			printk(x);			\
 	} while (0)
 
+/*
+ * Thread groups indexed by oom_adj, so that victim selection only walks
+ * the buckets at or above min_adj instead of every process. Entries are
+ * linked through signal_struct, which survives a leader change in exec.
+ *
+ * Lock order: tasklist_lock -> lowmem_index_lock -> task_lock. The
+ * oom_adj writers requeue after dropping task_lock and siglock: each
+ * update re-reads oom_adj, so the last one leaves the right bucket.
+ */
+#define LOWMEM_BUCKETS		(OOM_ADJUST_MAX - OOM_DISABLE + 1)
+#define lowmem_bucket(adj)	(&lowmem_index[(adj) - OOM_DISABLE])
+
+static struct list_head lowmem_index[LOWMEM_BUCKETS];
+static DEFINE_SPINLOCK(lowmem_index_lock);
+static bool lowmem_index_ready;	/* set once tasks forked at boot are added */
+
+static int lowmem_clamp_adj(int adj)
+{
+	if (adj < OOM_DISABLE)
+		return OOM_DISABLE;
+	if (adj > OOM_ADJUST_MAX)
+		return OOM_ADJUST_MAX;
+	return adj;
+}
+
+static void __lowmem_index_add(struct signal_struct *sig)
+{
+	list_add_tail(&sig->lmk_node, lowmem_bucket(lowmem_clamp_adj(sig->oom_adj)));
+}
+
+/* Called from copy_process() for a new thread group, tasklist_lock held */
+void lowmem_index_add(struct task_struct *p)
+{
+	struct signal_struct *sig = p->signal;
+
+	INIT_LIST_HEAD(&sig->lmk_node);
+	spin_lock(&lowmem_index_lock);
+	if (lowmem_index_ready)
+		__lowmem_index_add(sig);
+	spin_unlock(&lowmem_index_lock);
+}
+
+/* Called from __unhash_process() when the group is dead, tasklist_lock held */
+void lowmem_index_del(struct task_struct *p)
+{
+	struct signal_struct *sig = p->signal;
+
+	spin_lock(&lowmem_index_lock);
+	if (!list_empty(&sig->lmk_node))
+		list_del_init(&sig->lmk_node);
+	spin_unlock(&lowmem_index_lock);
+}
+
+/* Called after /proc/<pid>/oom_adj or oom_score_adj was written */
+void lowmem_index_update(struct task_struct *p)
+{
+	struct signal_struct *sig = p->signal;
+
+	spin_lock(&lowmem_index_lock);
+	if (!list_empty(&sig->lmk_node))
+		list_move_tail(&sig->lmk_node,
+			       lowmem_bucket(lowmem_clamp_adj(sig->oom_adj)));
+	spin_unlock(&lowmem_index_lock);
+}
+
+/* Index the processes forked before the driver was initialized */
+static void __init lowmem_index_init(void)
+{
+	struct task_struct *p;
+	int i;
+
+	for (i = 0; i < LOWMEM_BUCKETS; i++)
+		INIT_LIST_HEAD(&lowmem_index[i]);
+
+	read_lock(&tasklist_lock);
+	spin_lock(&lowmem_index_lock);
+	for_each_process(p)
+		__lowmem_index_add(p->signal);
+	lowmem_index_ready = true;
+	spin_unlock(&lowmem_index_lock);
+	read_unlock(&tasklist_lock);
+}
+
+/* Called with lowmem_index_lock held */
+static bool lowmem_index_empty_from(int min_adj)
+{
+	int adj;
+
+	for (adj = OOM_ADJUST_MAX; adj >= min_adj; adj--)
+		if (!list_empty(lowmem_bucket(adj)))
+			return false;
+	return true;
+}
+
+/*
+ * Reclaim efficiency based pressure levels. Pressure is the percentage
+ * of pages scanned in a window that reclaim failed to free: a system
+ * that frees what it scans is at "low"; one that scans without freeing
+ * anything is about to start killing.
+ */
+enum lowmem_pressure_level {
+	LOWMEM_PRESSURE_LOW,
+	LOWMEM_PRESSURE_MEDIUM,
+	LOWMEM_PRESSURE_CRITICAL,
+	LOWMEM_PRESSURE_LEVELS
+};
+
+static const char * const lowmem_pressure_names[LOWMEM_PRESSURE_LEVELS] = {
+	"low",
+	"medium",
+	"critical",
+};
+
+static uint lowmem_pressure_window = SWAP_CLUSTER_MAX * 16;
+static uint lowmem_pressure_medium = 60;
+static uint lowmem_pressure_critical = 95;
+
+/* Latest event at or above each level, so a reader can filter cheaply */
+struct lowmem_pressure_event {
+	unsigned int seq;
+	enum lowmem_pressure_level level;
+};
+
+static DEFINE_SPINLOCK(lowmem_pressure_lock);
+static unsigned long lowmem_pressure_scanned;
+static unsigned long lowmem_pressure_reclaimed;
+static struct lowmem_pressure_event lowmem_pressure_events[LOWMEM_PRESSURE_LEVELS];
+static DECLARE_WAIT_QUEUE_HEAD(lowmem_pressure_wait);
+
+struct lowmem_pressure_reader {
+	unsigned int seq;
+	enum lowmem_pressure_level min_level;
+};
+
+static enum lowmem_pressure_level lowmem_pressure_grade(unsigned long scanned,
+							unsigned long reclaimed)
+{
+	unsigned long pressure;
+
+	if (reclaimed >= scanned)
+		return LOWMEM_PRESSURE_LOW;
+	pressure = (scanned - reclaimed) * 100 / scanned;
+
+	if (pressure >= lowmem_pressure_critical)
+		return LOWMEM_PRESSURE_CRITICAL;
+	if (pressure >= lowmem_pressure_medium)
+		return LOWMEM_PRESSURE_MEDIUM;
+	return LOWMEM_PRESSURE_LOW;
+}
+
+/*
+ * Called from shrink_zone() with the pages it scanned and reclaimed. An
+ * event is raised each time lowmem_pressure_window pages have been
+ * scanned, which keeps the cost on the reclaim path to a few additions.
+ */
+void lowmem_vmpressure(gfp_t gfp_mask, unsigned long scanned,
+		       unsigned long reclaimed)
+{
+	enum lowmem_pressure_level level;
+	int i;
+
+	/* Reclaim that cannot touch user memory says nothing about it */
+	if (!(gfp_mask & (__GFP_HIGHMEM | __GFP_MOVABLE | __GFP_IO | __GFP_FS)))
+		return;
+	if (!scanned)
+		return;
+
+	spin_lock(&lowmem_pressure_lock);
+	lowmem_pressure_scanned += scanned;
+	lowmem_pressure_reclaimed += reclaimed;
+	if (lowmem_pressure_scanned < lowmem_pressure_window) {
+		spin_unlock(&lowmem_pressure_lock);
+		return;
+	}
+
+	level = lowmem_pressure_grade(lowmem_pressure_scanned,
+				      lowmem_pressure_reclaimed);
+	lowmem_pressure_scanned = 0;
+	lowmem_pressure_reclaimed = 0;
+	for (i = LOWMEM_PRESSURE_LOW; i <= level; i++) {
+		lowmem_pressure_events[i].seq++;
+		lowmem_pressure_events[i].level = level;
+	}
+	spin_unlock(&lowmem_pressure_lock);
+
+	lowmem_print(4, "lowmem_pressure %s\n", lowmem_pressure_names[level]);
+	wake_up_interruptible(&lowmem_pressure_wait);
+}
+
+static bool lowmem_pressure_pending(struct lowmem_pressure_reader *reader)
+{
+	return ACCESS_ONCE(lowmem_pressure_events[reader->min_level].seq) !=
+		reader->seq;
+}
+
+static int lowmem_pressure_open(struct inode *inode, struct file *file)
+{
+	struct lowmem_pressure_reader *reader;
+
+	reader = kzalloc(sizeof(*reader), GFP_KERNEL);
+	if (!reader)
+		return -ENOMEM;
+
+	/* Only report events raised after the open */
+	spin_lock(&lowmem_pressure_lock);
+	reader->seq = lowmem_pressure_events[LOWMEM_PRESSURE_LOW].seq;
+	spin_unlock(&lowmem_pressure_lock);
+
+	file->private_data = reader;
+	return nonseekable_open(inode, file);
+}
+
+static int lowmem_pressure_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+	return 0;
+}
+
+static ssize_t lowmem_pressure_read(struct file *file, char __user *buf,
+				    size_t count, loff_t *pos)
+{
+	struct lowmem_pressure_reader *reader = file->private_data;
+	struct lowmem_pressure_event event;
+	char line[16];
+	int len, ret;
+
+	for (;;) {
+		spin_lock(&lowmem_pressure_lock);
+		event = lowmem_pressure_events[reader->min_level];
+		spin_unlock(&lowmem_pressure_lock);
+		if (event.seq != reader->seq)
+			break;
+
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(lowmem_pressure_wait,
+					       lowmem_pressure_pending(reader));
+		if (ret)
+			return ret;
+	}
+
+	len = scnprintf(line, sizeof(line), "%s\n",
+			lowmem_pressure_names[event.level]);
+	if (count < len)
+		return -EINVAL;
+	if (copy_to_user(buf, line, len))
+		return -EFAULT;
+
+	reader->seq = event.seq;
+	return len;
+}
+
+static ssize_t lowmem_pressure_write(struct file *file, const char __user *buf,
+				     size_t count, loff_t *pos)
+{
+	struct lowmem_pressure_reader *reader = file->private_data;
+	char line[16];
+	int i;
+
+	if (count >= sizeof(line))
+		return -EINVAL;
+	if (copy_from_user(line, buf, count))
+		return -EFAULT;
+	line[count] = '\0';
+
+	for (i = 0; i < LOWMEM_PRESSURE_LEVELS; i++)
+		if (sysfs_streq(line, lowmem_pressure_names[i]))
+			break;
+	if (i == LOWMEM_PRESSURE_LEVELS)
+		return -EINVAL;
+
+	spin_lock(&lowmem_pressure_lock);
+	reader->min_level = i;
+	reader->seq = lowmem_pressure_events[i].seq;
+	spin_unlock(&lowmem_pressure_lock);
+
+	return count;
+}
+
+static unsigned int lowmem_pressure_poll(struct file *file, poll_table *wait)
+{
+	struct lowmem_pressure_reader *reader = file->private_data;
+
+	poll_wait(file, &lowmem_pressure_wait, wait);
+	if (lowmem_pressure_pending(reader))
+		return POLLIN | POLLRDNORM | POLLPRI;
+	return 0;
+}
+
+static const struct file_operations lowmem_pressure_fops = {
+	.owner = THIS_MODULE,
+	.open = lowmem_pressure_open,
+	.release = lowmem_pressure_release,
+	.read = lowmem_pressure_read,
+	.write = lowmem_pressure_write,
+	.poll = lowmem_pressure_poll,
+	.llseek = no_llseek,
+};
+
+static struct miscdevice lowmem_pressure_misc = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "lowmem_pressure",
+	.fops = &lowmem_pressure_fops,
+};
+
 static int
 task_notify_func(struct notifier_block *self, unsigned long val, void *data);
 
@@ -155,10 +478,12 @@ task_notify_func(struct notifier_block *self, unsigned long val, void *data)
 static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 {
 	struct task_struct *p;
+	struct signal_struct *sig;
 	struct task_struct *selected[MANAGED_PROCESS_TYPES] = {NULL};
 	int rem = 0;
 	int tasksize;
 	int i;
+	int adj;
 	int min_adj = OOM_ADJUST_MAX + 1;
 	enum lowmem_process_type proc_type = KILLABLE_PROCESS;
 	int selected_tasksize[MANAGED_PROCESS_TYPES] = {0};
@@ -209,59 +534,80 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 		selected_oom_score_adj[proc_type] = min_adj;
 
 	read_lock(&tasklist_lock);
-	for_each_process(p) {
-		struct mm_struct *mm;
-		struct signal_struct *sig;
-		int oom_adj;
-
-		task_lock(p);
-		mm = p->mm;
-		sig = p->signal;
-		if (!mm || !sig) {
-			task_unlock(p);
-			continue;
-		}
-		oom_adj = sig->oom_adj;
-		if (oom_adj < min_adj) {
+	spin_lock(&lowmem_index_lock);
+	if (lowmem_index_empty_from(lowmem_clamp_adj(min_adj))) {
+		spin_unlock(&lowmem_index_lock);
+		read_unlock(&tasklist_lock);
+		lowmem_print(5, "lowmem_shrink %lu, %x, nothing at adj %d\n",
+			     sc->nr_to_scan, sc->gfp_mask, min_adj);
+		return rem;
+	}
+
+	/*
+	 * Walk the buckets from the highest oom_adj down: the first bucket
+	 * holding a killable process provides the victim, lower ones can
+	 * only be preferred for the do-not-kill fallbacks.
+	 */
+	for (adj = OOM_ADJUST_MAX; adj >= lowmem_clamp_adj(min_adj); adj--) {
+		list_for_each_entry(sig, lowmem_bucket(adj), lmk_node) {
+			struct mm_struct *mm;
+			int oom_adj;
+
+			p = pid_task(sig->leader_pid, PIDTYPE_PID);
+			if (!p)
+				continue;
+
+			task_lock(p);
+			mm = p->mm;
+			if (!mm) {
+				task_unlock(p);
+				continue;
+			}
+			oom_adj = sig->oom_adj;
+			if (oom_adj < min_adj) {
+				task_unlock(p);
+				continue;
+			}
+			tasksize = get_mm_rss(mm);
 			task_unlock(p);
-			continue;
-		}
-		tasksize = get_mm_rss(mm);
-		task_unlock(p);
-		if (tasksize <= 0)
-			continue;
+			if (tasksize <= 0)
+				continue;
 
-		/* Initially consider the process as killable */
-		proc_type = KILLABLE_PROCESS;
+			/* Initially consider the process as killable */
+			proc_type = KILLABLE_PROCESS;
 
 #ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_DO_NOT_KILL_PROCESS
-		/* Check if the process name is contained inside the process to be preserved lists */
-		if (is_in_donotkill_proc_list(p->comm)) {
-			/* This user process must be preserved from killing */
-			proc_type = DO_NOT_KILL_PROCESS;
-			lowmem_print(2, "The process '%s' is inside the donotkill_proc_names", p->comm);
-		} else if (is_in_donotkill_sysproc_list(p->comm)) {
-			/* This system process must be preserved from killing */
-			proc_type = DO_NOT_KILL_SYSTEM_PROCESS;
-			lowmem_print(2, "The process '%s' is inside the donotkill_sysproc_names", p->comm);
-		}
+			/* Check if the process name is contained inside the process to be preserved lists */
+			if (is_in_donotkill_proc_list(p->comm)) {
+				/* This user process must be preserved from killing */
+				proc_type = DO_NOT_KILL_PROCESS;
+				lowmem_print(2, "The process '%s' is inside the donotkill_proc_names", p->comm);
+			} else if (is_in_donotkill_sysproc_list(p->comm)) {
+				/* This system process must be preserved from killing */
+				proc_type = DO_NOT_KILL_SYSTEM_PROCESS;
+				lowmem_print(2, "The process '%s' is inside the donotkill_sysproc_names", p->comm);
+			}
 #endif
 
-		if (selected[proc_type]) {
-			if (oom_adj < selected_oom_score_adj[proc_type])
-				continue;			
-			if (oom_adj == selected_oom_score_adj[proc_type] &&
-			    tasksize <= selected_tasksize[proc_type])
-				continue;
+			if (selected[proc_type]) {
+				if (oom_adj < selected_oom_score_adj[proc_type])
+					continue;
+				if (oom_adj == selected_oom_score_adj[proc_type] &&
+				    tasksize <= selected_tasksize[proc_type])
+					continue;
+			}
+
+			selected[proc_type] = p;
+			selected_tasksize[proc_type] = tasksize;
+			selected_oom_score_adj[proc_type] = oom_adj;
+			lowmem_print(2, "select %d (%s), adj %d, size %d, to kill\n",
+				     p->pid, p->comm, oom_adj, tasksize);
 		}
-
-		selected[proc_type] = p;
-		selected_tasksize[proc_type] = tasksize;
-		selected_oom_score_adj[proc_type] = oom_adj;
-		lowmem_print(2, "select %d (%s), adj %d, size %d, to kill\n",
-			     p->pid, p->comm, oom_adj, tasksize);
+		if (selected[KILLABLE_PROCESS])
+			break;
 	}
-
+	/* tasklist_lock keeps the selected tasks around until they are signalled */
+	spin_unlock(&lowmem_index_lock);
 
 	/* For each managed process type check if a process to be killed has been found:
 	 * - check first if a standard killable process has been found, if so kill it
@@ -297,13 +643,18 @@ static struct shrinker lowmem_shrinker = {
 
 static int __init lowmem_init(void)
 {
+	lowmem_index_init();
 	task_free_register(&task_nb);
 	register_shrinker(&lowmem_shrinker);
+	if (misc_register(&lowmem_pressure_misc))
+		printk(KERN_ERR "lowmemorykiller: failed to register %s\n",
+		       lowmem_pressure_misc.name);
 	return 0;
 }
 
 static void __exit lowmem_exit(void)
 {
+	misc_deregister(&lowmem_pressure_misc);
 	unregister_shrinker(&lowmem_shrinker);
 	task_free_unregister(&task_nb);
 }
@@ -314,6 +665,12 @@ module_param_array_named(adj, lowmem_adj, int, &lowmem_adj_size,
 module_param_array_named(minfree, lowmem_minfree, uint, &lowmem_minfree_size,
 			 S_IRUGO | S_IWUSR);
 module_param_named(debug_level, lowmem_debug_level, uint, S_IRUGO | S_IWUSR);
+module_param_named(pressure_window, lowmem_pressure_window, uint,
+		   S_IRUGO | S_IWUSR);
+module_param_named(pressure_medium, lowmem_pressure_medium, uint,
+		   S_IRUGO | S_IWUSR);
+module_param_named(pressure_critical, lowmem_pressure_critical, uint,
+		   S_IRUGO | S_IWUSR);
 #ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_DO_NOT_KILL_PROCESS
 module_param_named(donotkill_proc, donotkill_proc.enabled, uint, S_IRUGO | S_IWUSR);
 module_param_array_named(donotkill_proc_names, donotkill_proc.names, charp,
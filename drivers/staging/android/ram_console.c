@@ -27,6 +27,13 @@
 #include <linux/rslib.h>
 #endif
 
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_COMPRESS
+#include <linux/lzo.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <asm/unaligned.h>
+#endif
+
 struct ram_console_buffer {
 	uint32_t    sig;
 	uint32_t    start;
@@ -35,6 +42,7 @@ struct ram_console_buffer {
 };
 
 #define RAM_CONSOLE_SIG (0x43474244) /* DBGC */
+#define RAM_CONSOLE_ZSIG (0x5a474244) /* DBGZ */
 
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_EARLY_INIT
 static char __initdata
@@ -45,6 +53,8 @@ static size_t ram_console_old_log_size;
 
 static struct ram_console_buffer *ram_console_buffer;
 static size_t ram_console_buffer_size;
+/* The part of the data written as a ring, all of it unless compressing */
+static size_t ram_console_ring_size;
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
 static char *ram_console_par_buffer;
 static struct rs_control *ram_console_rs_decoder;
@@ -56,6 +66,35 @@ static int ram_console_bad_blocks;
 #define ECC_POLY CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_POLYNOMIAL
 #endif
 
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_COMPRESS
+/*
+ * Console output is collected as text in a stage area at the end of the
+ * data, and each time the stage fills up it is compressed with LZO into a
+ * record written to the ring, which then holds several times more log.
+ * The stage is in the persistent buffer too, so the last messages before
+ * a crash are kept even though they were never compressed.
+ *
+ * A record is a header followed by the compressed bytes: two sync bytes,
+ * then the compressed and the uncompressed lengths, little endian 16 bit.
+ * The oldest record in a wrapped ring has lost its beginning, so reading
+ * starts at the first header that decompresses to what it claims.
+ */
+#define ZREC_SYNC0	0x5a
+#define ZREC_SYNC1	0xc3
+#define ZREC_HDR_SIZE	6
+#define ZSTAGE_SIZE	4096
+
+struct ram_console_stage {
+	uint32_t    len;
+	uint8_t     data[0];
+};
+
+static struct ram_console_stage *ram_console_stage;
+static size_t ram_console_stage_size;
+static void *ram_console_lzo_wrkmem;
+static unsigned char *ram_console_zbuf;
+#endif
+
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
 static void ram_console_encode_rs8(uint8_t *data, size_t len, uint8_t *ecc)
 {
@@ -79,7 +118,8 @@ static int ram_console_decode_rs8(void *data, size_t len, uint8_t *ecc)
 }
 #endif
 
-static void ram_console_update(const char *s, unsigned int count)
+static void ram_console_update(unsigned int offset, const void *s,
+			       unsigned int count)
 {
 	struct ram_console_buffer *buffer = ram_console_buffer;
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
@@ -88,18 +128,18 @@ static void ram_console_update(const char *s, unsigned int count)
 	uint8_t *par;
 	int size = ECC_BLOCK_SIZE;
 #endif
-	memcpy(buffer->data + buffer->start, s, count);
+	memcpy(buffer->data + offset, s, count);
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
-	block = buffer->data + (buffer->start & ~(ECC_BLOCK_SIZE - 1));
+	block = buffer->data + (offset & ~(ECC_BLOCK_SIZE - 1));
 	par = ram_console_par_buffer +
-	      (buffer->start / ECC_BLOCK_SIZE) * ECC_SIZE;
+	      (offset / ECC_BLOCK_SIZE) * ECC_SIZE;
 	do {
 		if (block + ECC_BLOCK_SIZE > buffer_end)
 			size = buffer_end - block;
 		ram_console_encode_rs8(block, size, par);
 		block += ECC_BLOCK_SIZE;
 		par += ECC_SIZE;
-	} while (block < buffer->data + buffer->start + count);
+	} while (block < buffer->data + offset + count);
 #endif
 }
 
@@ -114,29 +154,87 @@ static void ram_console_update_header(void)
 #endif
 }
 
-static void
-ram_console_write(struct console *console, const char *s, unsigned int count)
+static void ram_console_write_ring(const char *s, unsigned int count)
 {
 	int rem;
 	struct ram_console_buffer *buffer = ram_console_buffer;
 
-	if (count > ram_console_buffer_size) {
-		s += count - ram_console_buffer_size;
-		count = ram_console_buffer_size;
+	if (count > ram_console_ring_size) {
+		s += count - ram_console_ring_size;
+		count = ram_console_ring_size;
 	}
-	rem = ram_console_buffer_size - buffer->start;
+	rem = ram_console_ring_size - buffer->start;
 	if (rem < count) {
-		ram_console_update(s, rem);
+		ram_console_update(buffer->start, s, rem);
 		s += rem;
 		count -= rem;
 		buffer->start = 0;
-		buffer->size = ram_console_buffer_size;
+		buffer->size = ram_console_ring_size;
 	}
-	ram_console_update(s, count);
+	ram_console_update(buffer->start, s, count);
 
 	buffer->start += count;
-	if (buffer->size < ram_console_buffer_size)
+	if (buffer->size < ram_console_ring_size)
 		buffer->size += count;
+}
+
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_COMPRESS
+static void ram_console_set_stage_len(uint32_t len)
+{
+	ram_console_update(ram_console_ring_size +
+			   offsetof(struct ram_console_stage, len),
+			   &len, sizeof(len));
+}
+
+/* Moves the stage, full, into the ring as one record */
+static void ram_console_flush_stage(void)
+{
+	struct ram_console_stage *stage = ram_console_stage;
+	unsigned char *zbuf = ram_console_zbuf;
+	size_t clen;
+
+	if (lzo1x_1_compress(stage->data, stage->len, zbuf + ZREC_HDR_SIZE,
+			     &clen, ram_console_lzo_wrkmem) == LZO_E_OK) {
+		zbuf[0] = ZREC_SYNC0;
+		zbuf[1] = ZREC_SYNC1;
+		put_unaligned_le16(clen, zbuf + 2);
+		put_unaligned_le16(stage->len, zbuf + 4);
+		ram_console_write_ring((char *)zbuf, ZREC_HDR_SIZE + clen);
+	}
+
+	ram_console_set_stage_len(0);
+}
+
+static void ram_console_write_stage(const char *s, unsigned int count)
+{
+	struct ram_console_stage *stage = ram_console_stage;
+	unsigned int n;
+
+	while (count) {
+		n = min_t(unsigned int, count,
+			  ram_console_stage_size - stage->len);
+		ram_console_update(ram_console_ring_size +
+				   offsetof(struct ram_console_stage, data) +
+				   stage->len, s, n);
+		ram_console_set_stage_len(stage->len + n);
+		s += n;
+		count -= n;
+
+		if (stage->len == ram_console_stage_size)
+			ram_console_flush_stage();
+	}
+}
+#endif
+
+static void
+ram_console_write(struct console *console, const char *s, unsigned int count)
+{
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_COMPRESS
+	if (ram_console_stage)
+		ram_console_write_stage(s, count);
+	else
+#endif
+		ram_console_write_ring(s, count);
 	ram_console_update_header();
 }
 
@@ -155,25 +253,18 @@ void ram_console_enable_console(int enabled)
 		ram_console.flags &= ~CON_ENABLED;
 }
 
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
+/* Corrects in place the blocks covering len bytes of data from offset */
 static void __init
-ram_console_save_old(struct ram_console_buffer *buffer, const char *bootinfo,
-	char *dest)
+ram_console_correct(struct ram_console_buffer *buffer, size_t offset,
+	size_t len)
 {
-	size_t old_log_size = buffer->size;
-	size_t bootinfo_size = 0;
-	size_t total_size = old_log_size;
-	char *ptr;
-	const char *bootinfo_label = "Boot info:\n";
-
-#ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
 	uint8_t *block;
 	uint8_t *par;
-	char strbuf[80];
-	int strbuf_len = 0;
 
-	block = buffer->data;
-	par = ram_console_par_buffer;
-	while (block < buffer->data + buffer->size) {
+	block = buffer->data + (offset & ~(ECC_BLOCK_SIZE - 1));
+	par = ram_console_par_buffer + (offset / ECC_BLOCK_SIZE) * ECC_SIZE;
+	while (block < buffer->data + offset + len) {
 		int numerr;
 		int size = ECC_BLOCK_SIZE;
 		if (block + size > buffer->data + ram_console_buffer_size)
@@ -195,6 +286,100 @@ ram_console_save_old(struct ram_console_buffer *buffer, const char *bootinfo,
 		block += ECC_BLOCK_SIZE;
 		par += ECC_SIZE;
 	}
+}
+#endif
+
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_COMPRESS
+/*
+ * Returns the records of the ring, decompressed, followed by the text of
+ * the stage, in a buffer with extra bytes of room after them.
+ */
+static char * __init
+ram_console_inflate_old(struct ram_console_buffer *buffer, size_t extra,
+	size_t *sizep)
+{
+	struct ram_console_stage *stage = ram_console_stage;
+	unsigned char *ring;
+	char *log;
+	size_t pos, clen, rlen, log_size = 0, out = 0;
+
+	ring = vmalloc(buffer->size);
+	if (ring == NULL)
+		return NULL;
+	memcpy(ring, &buffer->data[buffer->start],
+	       buffer->size - buffer->start);
+	memcpy(ring + buffer->size - buffer->start,
+	       &buffer->data[0], buffer->start);
+
+	/* an upper bound, a header may be a false match */
+	for (pos = 0; pos + ZREC_HDR_SIZE <= buffer->size; pos++) {
+		if (ring[pos] != ZREC_SYNC0 || ring[pos + 1] != ZREC_SYNC1)
+			continue;
+		rlen = get_unaligned_le16(ring + pos + 4);
+		if (rlen <= ram_console_stage_size)
+			log_size += rlen;
+	}
+	log_size += stage->len;
+
+	log = kmalloc(log_size + extra, GFP_KERNEL);
+	if (log == NULL) {
+		vfree(ring);
+		return NULL;
+	}
+
+	pos = 0;
+	while (pos + ZREC_HDR_SIZE <= buffer->size) {
+		if (ring[pos] != ZREC_SYNC0 || ring[pos + 1] != ZREC_SYNC1) {
+			pos++;
+			continue;
+		}
+		clen = get_unaligned_le16(ring + pos + 2);
+		rlen = get_unaligned_le16(ring + pos + 4);
+		if (pos + ZREC_HDR_SIZE + clen > buffer->size ||
+		    rlen > ram_console_stage_size ||
+		    out + rlen > log_size - stage->len ||
+		    lzo1x_decompress_safe(ring + pos + ZREC_HDR_SIZE, clen,
+					  (unsigned char *)log + out,
+					  &rlen) != LZO_E_OK) {
+			pos++;
+			continue;
+		}
+		out += rlen;
+		pos += ZREC_HDR_SIZE + clen;
+	}
+	vfree(ring);
+
+	memcpy(log + out, stage->data, stage->len);
+	*sizep = out + stage->len;
+	return log;
+}
+#endif
+
+static void __init
+ram_console_save_old(struct ram_console_buffer *buffer, const char *bootinfo,
+	char *dest)
+{
+	size_t old_log_size = buffer->size;
+	size_t bootinfo_size = 0;
+	size_t total_size = 0;
+	char *ptr;
+	const char *bootinfo_label = "Boot info:\n";
+
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
+	char strbuf[80];
+	int strbuf_len = 0;
+
+	ram_console_correct(buffer, 0, buffer->size);
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_COMPRESS
+	if (buffer->sig == RAM_CONSOLE_ZSIG) {
+		ram_console_correct(buffer, ram_console_ring_size,
+				    sizeof(*ram_console_stage));
+		if (ram_console_stage->len <= ram_console_stage_size)
+			ram_console_correct(buffer, ram_console_ring_size,
+					    sizeof(*ram_console_stage) +
+					    ram_console_stage->len);
+	}
+#endif
 	if (ram_console_corrected_bytes || ram_console_bad_blocks)
 		strbuf_len = snprintf(strbuf, sizeof(strbuf),
 			"\n%d Corrected bytes, %d unrecoverable blocks\n",
@@ -211,6 +396,22 @@ ram_console_save_old(struct ram_console_buffer *buffer, const char *bootinfo,
 		bootinfo_size = strlen(bootinfo) + strlen(bootinfo_label);
 	total_size += bootinfo_size;
 
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_COMPRESS
+	/* never early, so there is no dest yet */
+	if (buffer->sig == RAM_CONSOLE_ZSIG) {
+		if (ram_console_stage->len > ram_console_stage_size)
+			ram_console_stage->len = 0;
+		dest = ram_console_inflate_old(buffer, total_size,
+					       &old_log_size);
+		if (dest == NULL) {
+			printk(KERN_ERR
+			       "ram_console: failed to decompress old log\n");
+			return;
+		}
+	}
+#endif
+	total_size += old_log_size;
+
 	if (dest == NULL) {
 		dest = kmalloc(total_size, GFP_KERNEL);
 		if (dest == NULL) {
@@ -222,10 +423,12 @@ ram_console_save_old(struct ram_console_buffer *buffer, const char *bootinfo,
 
 	ram_console_old_log = dest;
 	ram_console_old_log_size = total_size;
-	memcpy(ram_console_old_log,
-	       &buffer->data[buffer->start], buffer->size - buffer->start);
-	memcpy(ram_console_old_log + buffer->size - buffer->start,
-	       &buffer->data[0], buffer->start);
+	if (buffer->sig != RAM_CONSOLE_ZSIG) {
+		memcpy(ram_console_old_log, &buffer->data[buffer->start],
+		       buffer->size - buffer->start);
+		memcpy(ram_console_old_log + buffer->size - buffer->start,
+		       &buffer->data[0], buffer->start);
+	}
 	ptr = ram_console_old_log + old_log_size;
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
 	memcpy(ptr, strbuf, strbuf_len);
@@ -239,10 +442,44 @@ ram_console_save_old(struct ram_console_buffer *buffer, const char *bootinfo,
 	}
 }
 
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_COMPRESS
+static void __init ram_console_compress_init(struct ram_console_buffer *buffer)
+{
+	size_t ring_size;
+
+	/* too small to spare a stage */
+	if (ram_console_buffer_size < 4 * ZSTAGE_SIZE)
+		return;
+
+	ram_console_lzo_wrkmem = kmalloc(LZO1X_1_MEM_COMPRESS, GFP_KERNEL);
+	ram_console_zbuf = kmalloc(ZREC_HDR_SIZE +
+				   lzo1x_worst_compress(ZSTAGE_SIZE),
+				   GFP_KERNEL);
+	if (ram_console_lzo_wrkmem == NULL || ram_console_zbuf == NULL) {
+		printk(KERN_ERR "ram_console: no memory to compress, "
+		       "logging uncompressed\n");
+		kfree(ram_console_lzo_wrkmem);
+		kfree(ram_console_zbuf);
+		return;
+	}
+
+	ring_size = (ram_console_buffer_size -
+		     sizeof(struct ram_console_stage) - ZSTAGE_SIZE) & ~3;
+	ram_console_ring_size = ring_size;
+	ram_console_stage = (struct ram_console_stage *)
+		(buffer->data + ring_size);
+	ram_console_stage_size = ram_console_buffer_size - ring_size -
+		sizeof(struct ram_console_stage);
+}
+#endif
+
 static int __init ram_console_init(struct ram_console_buffer *buffer,
 				   size_t buffer_size, const char *bootinfo,
 				   char *old_buf)
 {
+	size_t old_size;
+	bool found;
+
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
 	int numerr;
 	uint8_t *par;
@@ -298,8 +535,23 @@ static int __init ram_console_init(struct ram_console_buffer *buffer,
 	}
 #endif
 
-	if (buffer->sig == RAM_CONSOLE_SIG) {
-		if (buffer->size > ram_console_buffer_size
+	ram_console_ring_size = ram_console_buffer_size;
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_COMPRESS
+	ram_console_compress_init(buffer);
+#endif
+
+	found = buffer->sig == RAM_CONSOLE_SIG;
+	old_size = ram_console_buffer_size;
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_COMPRESS
+	/* a compressed log only fits the ring it was written with */
+	if (buffer->sig == RAM_CONSOLE_ZSIG && ram_console_stage) {
+		found = true;
+		old_size = ram_console_ring_size;
+	}
+#endif
+
+	if (found) {
+		if (buffer->size > old_size
 		    || buffer->start > buffer->size)
 			printk(KERN_INFO "ram_console: found existing invalid "
 			       "buffer, size %d, start %d\n",
@@ -318,6 +570,12 @@ static int __init ram_console_init(struct ram_console_buffer *buffer,
 	buffer->sig = RAM_CONSOLE_SIG;
 	buffer->start = 0;
 	buffer->size = 0;
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_COMPRESS
+	if (ram_console_stage) {
+		buffer->sig = RAM_CONSOLE_ZSIG;
+		ram_console_set_stage_len(0);
+	}
+#endif
 
 	register_console(&ram_console);
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ENABLE_VERBOSE
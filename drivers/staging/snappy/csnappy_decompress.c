@@ -267,7 +267,8 @@ csnappy_decompress_noheader(
 		opcode = *(const uint8_t *)src++;
 		opword = char_table[opcode];
 		extra_bytes = opword >> 11;
-		trailer = get_unaligned_le32(src) & wordmask[extra_bytes];
+		trailer = le32_to_cpu(UNALIGNED_LOAD32(src)) &
+			wordmask[extra_bytes];
 		src += extra_bytes;
 		src_remaining -= 1 + extra_bytes;
 		length = opword & 0xff;
@@ -55,11 +55,51 @@ Zeev Tarantov <zeev.tarantov <at> gmail.com>
 #endif
 
 #define UNALIGNED_LOAD16(_p)		get_unaligned((const uint16_t *)(_p))
+#define UNALIGNED_STORE16(_p, _val)	put_unaligned((_val), (uint16_t *)(_p))
+
+#if defined(CONFIG_ARM) && __LINUX_ARM_ARCH__ >= 7 && defined(__ARMEL__) && \
+	!defined(STATIC)
+/*
+ * get_unaligned() is byte-wise on ARM, but ARMv7 ldr/str take any
+ * address once alignment_init() has cleared the A bit, which is long
+ * done by the time zram compresses anything. ldrd/strd still need
+ * alignment, so 64-bit accesses are two words.
+ */
+static inline uint32_t csnappy_load32(const void *p)
+{
+	uint32_t v;
+
+	asm("ldr	%0, %1" : "=r" (v) : "Q" (*(const uint32_t *)p));
+	return v;
+}
+
+static inline void csnappy_store32(void *p, uint32_t v)
+{
+	asm("str	%1, %0" : "=Q" (*(uint32_t *)p) : "r" (v));
+}
+
+static inline uint64_t csnappy_load64(const void *p)
+{
+	return csnappy_load32(p) |
+		(uint64_t)csnappy_load32((const char *)p + 4) << 32;
+}
+
+static inline void csnappy_store64(void *p, uint64_t v)
+{
+	csnappy_store32(p, (uint32_t)v);
+	csnappy_store32((char *)p + 4, (uint32_t)(v >> 32));
+}
+
+#define UNALIGNED_LOAD32(_p)		csnappy_load32(_p)
+#define UNALIGNED_LOAD64(_p)		csnappy_load64(_p)
+#define UNALIGNED_STORE32(_p, _val)	csnappy_store32((_p), (_val))
+#define UNALIGNED_STORE64(_p, _val)	csnappy_store64((_p), (_val))
+#else
 #define UNALIGNED_LOAD32(_p)		get_unaligned((const uint32_t *)(_p))
 #define UNALIGNED_LOAD64(_p)		get_unaligned((const uint64_t *)(_p))
-#define UNALIGNED_STORE16(_p, _val)	put_unaligned((_val), (uint16_t *)(_p))
 #define UNALIGNED_STORE32(_p, _val)	put_unaligned((_val), (uint32_t *)(_p))
 #define UNALIGNED_STORE64(_p, _val)	put_unaligned((_val), (uint64_t *)(_p))
+#endif
 
 #define FindLSBSetNonZero(n)		__builtin_ctz(n)
 #define FindLSBSetNonZero64(n)		__builtin_ctzll(n)
@@ -21,8 +21,11 @@
 
 #include <linux/cpu.h>
 #include <linux/highmem.h>
+#include <linux/jhash.h>
 #include <linux/list.h>
 #include <linux/lzo.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/types.h>
@@ -56,14 +59,18 @@
  * the raw pages can be easily reclaimed.
  *
  * A zbud page ("zbpg") is an aligned page containing a list_head,
- * a lock, and two "zbud headers".  The remainder of the physical
- * page is divided up into aligned 64-byte "chunks" which contain
- * the compressed data for zero, one, or two zbuds.  Each zbpg
- * resides on: (1) an "unused list" if it has no zbuds; (2) a
- * "buddied" list if it is fully populated  with two zbuds; or
- * (3) one of PAGE_SIZE/64 "unbuddied" lists indexed by how many chunks
- * the one unbuddied zbud uses.  The data inside a zbpg cannot be
+ * a lock, the shard it is listed on and two "zbud headers".  The
+ * remainder of the physical page is divided up into aligned 64-byte
+ * "chunks" which contain the compressed data for zero, one, or two
+ * zbuds.  Each zbpg resides on: (1) an "unused list" if it has no
+ * zbuds; (2) a "buddied" list if it is fully populated  with two zbuds;
+ * or (3) one of PAGE_SIZE/64 "unbuddied" lists indexed by how many
+ * chunks the one unbuddied zbud uses.  The data inside a zbpg cannot be
  * read or written unless the zbpg's lock is held.
+ *
+ * All these lists exist once per cpu ("shard"), each set with its own
+ * lock, so that puts from reclaim running on different cpus do not
+ * serialize on a single lock.
  */
 
 #define ZBH_SENTINEL  0x43214321
@@ -79,9 +86,12 @@ struct zbud_hdr {
 	DECL_SENTINEL
 };
 
+struct zbud_shard;
+
 struct zbud_page {
 	struct list_head bud_list;
 	spinlock_t lock;
+	struct zbud_shard *shard; /* lists bud_list is on, see zbud_create() */
 	struct zbud_hdr buddy[ZBUD_MAX_BUDS];
 	DECL_SENTINEL
 	/* followed by NUM_CHUNK aligned CHUNK_SIZE-byte chunks */
@@ -94,25 +104,29 @@ struct zbud_page {
 				CHUNK_MASK) >> CHUNK_SHIFT)
 #define MAX_CHUNK	(NCHUNKS-1)
 
-static struct {
-	struct list_head list;
-	unsigned count;
-} zbud_unbuddied[NCHUNKS];
-/* list N contains pages with N chunks USED and NCHUNKS-N unused */
-/* element 0 is never used but optimizing that isn't worth it */
-static unsigned long zbud_cumul_chunk_counts[NCHUNKS];
-
-struct list_head zbud_buddied_list;
-static unsigned long zcache_zbud_buddied_count;
-
-/* protects the buddied list and all unbuddied lists */
-static DEFINE_SPINLOCK(zbud_budlists_spinlock);
-
-static LIST_HEAD(zbpg_unused_list);
-static unsigned long zcache_zbpg_unused_list_count;
+struct zbud_shard {
+	/* protects all the lists and counts of the shard */
+	spinlock_t lock;
+	struct {
+		struct list_head list;
+		unsigned count;
+	} unbuddied[NCHUNKS];
+	/* list N contains pages with N chunks USED and NCHUNKS-N unused */
+	/* element 0 is never used but optimizing that isn't worth it */
+	struct list_head buddied_list;
+	unsigned long buddied_count;
+	struct list_head unused_list;
+	unsigned long unused_count;
+
+	/* lock statistics, updated with the lock held */
+	unsigned long lock_acquired;
+	unsigned long lock_contended;
+	unsigned long long lock_hold_ns;
+	unsigned long long lock_start;
+};
+static DEFINE_PER_CPU(struct zbud_shard, zbud_shards);
 
-/* protects the unused page list */
-static DEFINE_SPINLOCK(zbpg_unused_list_spinlock);
+static unsigned long zbud_cumul_chunk_counts[NCHUNKS];
 
 static atomic_t zcache_zbud_curr_raw_pages;
 static atomic_t zcache_zbud_curr_zpages;
@@ -129,6 +143,47 @@ static void zcache_free_page(void *p);
  * zbud helper functions
  */
 
+static inline void zbud_shard_account_lock(struct zbud_shard *shard)
+{
+	shard->lock_acquired++;
+	shard->lock_start = sched_clock();
+}
+
+static inline void zbud_shard_lock(struct zbud_shard *shard)
+{
+	if (unlikely(!spin_trylock(&shard->lock))) {
+		spin_lock(&shard->lock);
+		shard->lock_contended++;
+	}
+	zbud_shard_account_lock(shard);
+}
+
+static inline int zbud_shard_trylock(struct zbud_shard *shard)
+{
+	if (!spin_trylock(&shard->lock))
+		return 0;
+	zbud_shard_account_lock(shard);
+	return 1;
+}
+
+static inline void zbud_shard_unlock(struct zbud_shard *shard)
+{
+	shard->lock_hold_ns += sched_clock() - shard->lock_start;
+	spin_unlock(&shard->lock);
+}
+
+static inline void zbud_shard_lock_bh(struct zbud_shard *shard)
+{
+	local_bh_disable();
+	zbud_shard_lock(shard);
+}
+
+static inline void zbud_shard_unlock_bh(struct zbud_shard *shard)
+{
+	zbud_shard_unlock(shard);
+	local_bh_enable();
+}
+
 static inline unsigned zbud_max_buddy_size(void)
 {
 	return MAX_CHUNK << CHUNK_SHIFT;
@@ -184,18 +239,19 @@ static struct zbud_page *zbud_alloc_raw_page(void)
 {
 	struct zbud_page *zbpg = NULL;
 	struct zbud_hdr *zh0, *zh1;
+	struct zbud_shard *shard = &__get_cpu_var(zbud_shards);
 	bool recycled = 0;
 
-	/* if any pages on the zbpg list, use one */
-	spin_lock(&zbpg_unused_list_spinlock);
-	if (!list_empty(&zbpg_unused_list)) {
-		zbpg = list_first_entry(&zbpg_unused_list,
+	/* if any pages on this cpu's zbpg list, use one */
+	zbud_shard_lock(shard);
+	if (!list_empty(&shard->unused_list)) {
+		zbpg = list_first_entry(&shard->unused_list,
 				struct zbud_page, bud_list);
 		list_del_init(&zbpg->bud_list);
-		zcache_zbpg_unused_list_count--;
+		shard->unused_count--;
 		recycled = 1;
 	}
-	spin_unlock(&zbpg_unused_list_spinlock);
+	zbud_shard_unlock(shard);
 	if (zbpg == NULL)
 		/* none on zbpg list, try to get a kernel page */
 		zbpg = zcache_get_free_page();
@@ -223,6 +279,7 @@ static struct zbud_page *zbud_alloc_raw_page(void)
 static void zbud_free_raw_page(struct zbud_page *zbpg)
 {
 	struct zbud_hdr *zh0 = &zbpg->buddy[0], *zh1 = &zbpg->buddy[1];
+	struct zbud_shard *shard;
 
 	ASSERT_SENTINEL(zbpg, ZBPG);
 	BUG_ON(!list_empty(&zbpg->bud_list));
@@ -231,10 +288,13 @@ static void zbud_free_raw_page(struct zbud_page *zbpg)
 	BUG_ON(zh1->size != 0 || tmem_oid_valid(&zh1->oid));
 	INVERT_SENTINEL(zbpg, ZBPG);
 	spin_unlock(&zbpg->lock);
-	spin_lock(&zbpg_unused_list_spinlock);
-	list_add(&zbpg->bud_list, &zbpg_unused_list);
-	zcache_zbpg_unused_list_count++;
-	spin_unlock(&zbpg_unused_list_spinlock);
+	/* unused pages go to the freeing cpu, they are not bound to a shard */
+	shard = &get_cpu_var(zbud_shards);
+	zbud_shard_lock(shard);
+	list_add(&zbpg->bud_list, &shard->unused_list);
+	shard->unused_count++;
+	zbud_shard_unlock(shard);
+	put_cpu_var(zbud_shards);
 }
 
 /*
@@ -261,6 +321,7 @@ static void zbud_free_and_delist(struct zbud_hdr *zh)
 {
 	unsigned chunks;
 	struct zbud_hdr *zh_other;
+	struct zbud_shard *shard;
 	unsigned budnum = zbud_budnum(zh), size;
 	struct zbud_page *zbpg =
 		container_of(zh, struct zbud_page, buddy[budnum]);
@@ -273,60 +334,94 @@ static void zbud_free_and_delist(struct zbud_hdr *zh)
 	}
 	size = zbud_free(zh);
 	ASSERT_SPINLOCK(&zbpg->lock);
+	shard = zbpg->shard;
 	zh_other = &zbpg->buddy[(budnum == 0) ? 1 : 0];
 	if (zh_other->size == 0) { /* was unbuddied: unlist and free */
 		chunks = zbud_size_to_chunks(size) ;
-		spin_lock(&zbud_budlists_spinlock);
-		BUG_ON(list_empty(&zbud_unbuddied[chunks].list));
+		zbud_shard_lock(shard);
+		BUG_ON(list_empty(&shard->unbuddied[chunks].list));
 		list_del_init(&zbpg->bud_list);
-		zbud_unbuddied[chunks].count--;
-		spin_unlock(&zbud_budlists_spinlock);
+		shard->unbuddied[chunks].count--;
+		zbud_shard_unlock(shard);
 		zbud_free_raw_page(zbpg);
 	} else { /* was buddied: move remaining buddy to unbuddied list */
 		chunks = zbud_size_to_chunks(zh_other->size) ;
-		spin_lock(&zbud_budlists_spinlock);
+		zbud_shard_lock(shard);
 		list_del_init(&zbpg->bud_list);
-		zcache_zbud_buddied_count--;
-		list_add_tail(&zbpg->bud_list, &zbud_unbuddied[chunks].list);
-		zbud_unbuddied[chunks].count++;
-		spin_unlock(&zbud_budlists_spinlock);
+		shard->buddied_count--;
+		list_add_tail(&zbpg->bud_list, &shard->unbuddied[chunks].list);
+		shard->unbuddied[chunks].count++;
+		zbud_shard_unlock(shard);
 		spin_unlock(&zbpg->lock);
 	}
 }
 
+/*
+ * Look for an unbuddied zbpg with room for nchunks in the shard, which
+ * must be locked. Returns it locked, or NULL.
+ */
+static struct zbud_page *zbud_shard_find_buddy(struct zbud_shard *shard,
+					unsigned nchunks, int *found_chunks)
+{
+	struct zbud_page *zbpg;
+	int i;
+
+	for (i = MAX_CHUNK - nchunks + 1; i > 0; i--) {
+		list_for_each_entry(zbpg, &shard->unbuddied[i].list, bud_list) {
+			if (spin_trylock(&zbpg->lock)) {
+				*found_chunks = i;
+				return zbpg;
+			}
+		}
+	}
+	return NULL;
+}
+
 static struct zbud_hdr *zbud_create(uint32_t pool_id, struct tmem_oid *oid,
 					uint32_t index, struct page *page,
 					void *cdata, unsigned size)
 {
 	struct zbud_hdr *zh0, *zh1, *zh = NULL;
-	struct zbud_page *zbpg = NULL, *ztmp;
+	struct zbud_page *zbpg = NULL;
+	struct zbud_shard *local, *shard;
 	unsigned nchunks;
 	char *to;
-	int i, found_good_buddy = 0;
+	int cpu, found_good_buddy = 0;
 
 	nchunks = zbud_size_to_chunks(size) ;
-	for (i = MAX_CHUNK - nchunks + 1; i > 0; i--) {
-		spin_lock(&zbud_budlists_spinlock);
-		if (!list_empty(&zbud_unbuddied[i].list)) {
-			list_for_each_entry_safe(zbpg, ztmp,
-				    &zbud_unbuddied[i].list, bud_list) {
-				if (spin_trylock(&zbpg->lock)) {
-					found_good_buddy = i;
-					goto found_unbuddied;
-				}
-			}
-		}
-		spin_unlock(&zbud_budlists_spinlock);
+	local = &__get_cpu_var(zbud_shards);
+	shard = local;
+	zbud_shard_lock(shard);
+	zbpg = zbud_shard_find_buddy(shard, nchunks, &found_good_buddy);
+	if (zbpg != NULL)
+		goto found_unbuddied;
+	zbud_shard_unlock(shard);
+
+	/*
+	 * Rather pair with a zbpg of another cpu than use a new page, but
+	 * don't wait for a busy shard.
+	 */
+	for_each_possible_cpu(cpu) {
+		shard = &per_cpu(zbud_shards, cpu);
+		if (shard == local || !zbud_shard_trylock(shard))
+			continue;
+		zbpg = zbud_shard_find_buddy(shard, nchunks, &found_good_buddy);
+		if (zbpg != NULL)
+			goto found_unbuddied;
+		zbud_shard_unlock(shard);
 	}
+
 	/* didn't find a good buddy, try allocating a new page */
 	zbpg = zbud_alloc_raw_page();
 	if (unlikely(zbpg == NULL))
 		goto out;
 	/* ok, have a page, now compress the data before taking locks */
+	shard = local;
 	spin_lock(&zbpg->lock);
-	spin_lock(&zbud_budlists_spinlock);
-	list_add_tail(&zbpg->bud_list, &zbud_unbuddied[nchunks].list);
-	zbud_unbuddied[nchunks].count++;
+	zbud_shard_lock(shard);
+	zbpg->shard = shard;
+	list_add_tail(&zbpg->bud_list, &shard->unbuddied[nchunks].list);
+	shard->unbuddied[nchunks].count++;
 	zh = &zbpg->buddy[0];
 	goto init_zh;
 
@@ -343,9 +438,9 @@ found_unbuddied:
 	} else
 		BUG();
 	list_del_init(&zbpg->bud_list);
-	zbud_unbuddied[found_good_buddy].count--;
-	list_add_tail(&zbpg->bud_list, &zbud_buddied_list);
-	zcache_zbud_buddied_count++;
+	shard->unbuddied[found_good_buddy].count--;
+	list_add_tail(&zbpg->bud_list, &shard->buddied_list);
+	shard->buddied_count++;
 
 init_zh:
 	SET_SENTINEL(zh, ZBH);
@@ -354,7 +449,7 @@ init_zh:
 	zh->oid = *oid;
 	zh->pool_id = pool_id;
 	/* can wait to copy the data until the list locks are dropped */
-	spin_unlock(&zbud_budlists_spinlock);
+	zbud_shard_unlock(shard);
 
 	to = zbud_data(zh, size);
 	memcpy(to, cdata, size);
@@ -456,88 +551,98 @@ static void zbud_evict_zbpg(struct zbud_page *zbpg)
  */
 static void zbud_evict_pages(int nr)
 {
+	struct zbud_shard *shard;
 	struct zbud_page *zbpg;
-	int i;
+	int i, cpu;
 
-	/* first try freeing any pages on unused list */
+	/* first try freeing any pages on unused lists */
+	for_each_possible_cpu(cpu) {
+		shard = &per_cpu(zbud_shards, cpu);
 retry_unused_list:
-	spin_lock_bh(&zbpg_unused_list_spinlock);
-	if (!list_empty(&zbpg_unused_list)) {
-		/* can't walk list here, since it may change when unlocked */
-		zbpg = list_first_entry(&zbpg_unused_list,
-				struct zbud_page, bud_list);
-		list_del_init(&zbpg->bud_list);
-		zcache_zbpg_unused_list_count--;
-		atomic_dec(&zcache_zbud_curr_raw_pages);
-		spin_unlock_bh(&zbpg_unused_list_spinlock);
-		zcache_free_page(zbpg);
-		zcache_evicted_raw_pages++;
-		if (--nr <= 0)
-			goto out;
-		goto retry_unused_list;
+		zbud_shard_lock_bh(shard);
+		if (!list_empty(&shard->unused_list)) {
+			/* can't walk list, it may change when unlocked */
+			zbpg = list_first_entry(&shard->unused_list,
+					struct zbud_page, bud_list);
+			list_del_init(&zbpg->bud_list);
+			shard->unused_count--;
+			atomic_dec(&zcache_zbud_curr_raw_pages);
+			zbud_shard_unlock_bh(shard);
+			zcache_free_page(zbpg);
+			zcache_evicted_raw_pages++;
+			if (--nr <= 0)
+				goto out;
+			goto retry_unused_list;
+		}
+		zbud_shard_unlock_bh(shard);
 	}
-	spin_unlock_bh(&zbpg_unused_list_spinlock);
 
 	/* now try freeing unbuddied pages, starting with least space avail */
 	for (i = 0; i < MAX_CHUNK; i++) {
+		for_each_possible_cpu(cpu) {
+			shard = &per_cpu(zbud_shards, cpu);
 retry_unbud_list_i:
-		spin_lock_bh(&zbud_budlists_spinlock);
-		if (list_empty(&zbud_unbuddied[i].list)) {
-			spin_unlock_bh(&zbud_budlists_spinlock);
-			continue;
+			zbud_shard_lock_bh(shard);
+			list_for_each_entry(zbpg, &shard->unbuddied[i].list,
+					    bud_list) {
+				if (unlikely(!spin_trylock(&zbpg->lock)))
+					continue;
+				list_del_init(&zbpg->bud_list);
+				shard->unbuddied[i].count--;
+				zbud_shard_unlock(shard);
+				zcache_evicted_unbuddied_pages++;
+				/* want budlists unlocked for zbpg eviction */
+				zbud_evict_zbpg(zbpg);
+				local_bh_enable();
+				if (--nr <= 0)
+					goto out;
+				goto retry_unbud_list_i;
+			}
+			zbud_shard_unlock_bh(shard);
 		}
-		list_for_each_entry(zbpg, &zbud_unbuddied[i].list, bud_list) {
+	}
+
+	/* as a last resort, free buddied pages */
+	for_each_possible_cpu(cpu) {
+		shard = &per_cpu(zbud_shards, cpu);
+retry_bud_list:
+		zbud_shard_lock_bh(shard);
+		list_for_each_entry(zbpg, &shard->buddied_list, bud_list) {
 			if (unlikely(!spin_trylock(&zbpg->lock)))
 				continue;
 			list_del_init(&zbpg->bud_list);
-			zbud_unbuddied[i].count--;
-			spin_unlock(&zbud_budlists_spinlock);
-			zcache_evicted_unbuddied_pages++;
+			shard->buddied_count--;
+			zbud_shard_unlock(shard);
+			zcache_evicted_buddied_pages++;
 			/* want budlists unlocked when doing zbpg eviction */
 			zbud_evict_zbpg(zbpg);
 			local_bh_enable();
 			if (--nr <= 0)
 				goto out;
-			goto retry_unbud_list_i;
+			goto retry_bud_list;
 		}
-		spin_unlock_bh(&zbud_budlists_spinlock);
-	}
-
-	/* as a last resort, free buddied pages */
-retry_bud_list:
-	spin_lock_bh(&zbud_budlists_spinlock);
-	if (list_empty(&zbud_buddied_list)) {
-		spin_unlock_bh(&zbud_budlists_spinlock);
-		goto out;
+		zbud_shard_unlock_bh(shard);
 	}
-	list_for_each_entry(zbpg, &zbud_buddied_list, bud_list) {
-		if (unlikely(!spin_trylock(&zbpg->lock)))
-			continue;
-		list_del_init(&zbpg->bud_list);
-		zcache_zbud_buddied_count--;
-		spin_unlock(&zbud_budlists_spinlock);
-		zcache_evicted_buddied_pages++;
-		/* want budlists unlocked when doing zbpg eviction */
-		zbud_evict_zbpg(zbpg);
-		local_bh_enable();
-		if (--nr <= 0)
-			goto out;
-		goto retry_bud_list;
-	}
-	spin_unlock_bh(&zbud_budlists_spinlock);
 out:
 	return;
 }
 
 static void zbud_init(void)
 {
-	int i;
-
-	INIT_LIST_HEAD(&zbud_buddied_list);
-	zcache_zbud_buddied_count = 0;
-	for (i = 0; i < NCHUNKS; i++) {
-		INIT_LIST_HEAD(&zbud_unbuddied[i].list);
-		zbud_unbuddied[i].count = 0;
+	struct zbud_shard *shard;
+	int i, cpu;
+
+	for_each_possible_cpu(cpu) {
+		shard = &per_cpu(zbud_shards, cpu);
+		spin_lock_init(&shard->lock);
+		INIT_LIST_HEAD(&shard->buddied_list);
+		shard->buddied_count = 0;
+		INIT_LIST_HEAD(&shard->unused_list);
+		shard->unused_count = 0;
+		for (i = 0; i < NCHUNKS; i++) {
+			INIT_LIST_HEAD(&shard->unbuddied[i].list);
+			shard->unbuddied[i].count = 0;
+		}
 	}
 }
 
@@ -547,14 +652,63 @@ static void zbud_init(void)
  * currently (and have ever been placed) in each unbuddied list.  It's fun
  * to watch but can probably go away before final merge.
  */
+static unsigned zbud_unbuddied_count(int chunks)
+{
+	unsigned count = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		count += per_cpu(zbud_shards, cpu).unbuddied[chunks].count;
+	return count;
+}
+
 static int zbud_show_unbuddied_list_counts(char *buf)
 {
 	int i;
 	char *p = buf;
 
 	for (i = 0; i < NCHUNKS - 1; i++)
-		p += sprintf(p, "%u ", zbud_unbuddied[i].count);
-	p += sprintf(p, "%d\n", zbud_unbuddied[i].count);
+		p += sprintf(p, "%u ", zbud_unbuddied_count(i));
+	p += sprintf(p, "%d\n", zbud_unbuddied_count(i));
+	return p - buf;
+}
+
+static int zbud_show_buddied_count(char *buf)
+{
+	unsigned long count = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		count += per_cpu(zbud_shards, cpu).buddied_count;
+	return sprintf(buf, "%lu\n", count);
+}
+
+static int zbud_show_unused_list_count(char *buf)
+{
+	unsigned long count = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		count += per_cpu(zbud_shards, cpu).unused_count;
+	return sprintf(buf, "%lu\n", count);
+}
+
+/*
+ * One line per shard: times its lock was taken, how many of those had
+ * to spin, and the total time it was held in nanoseconds.
+ */
+static int zbud_show_lock_stats(char *buf)
+{
+	struct zbud_shard *shard;
+	char *p = buf;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		shard = &per_cpu(zbud_shards, cpu);
+		p += sprintf(p, "cpu%d %lu %lu %llu\n", cpu,
+			shard->lock_acquired, shard->lock_contended,
+			shard->lock_hold_ns);
+	}
 	return p - buf;
 }
 
@@ -901,6 +1055,74 @@ static unsigned long zcache_curr_pers_pampd_count_max;
 /* forward reference */
 static int zcache_compress(struct page *from, void **out_va, size_t *out_len);
 
+/*
+ * Admission policy: compressing media and other already compressed
+ * data only burns cpu before the result is thrown away.  Once puts to
+ * an object (a file, for cleancache) compress on average to more than
+ * zcache_admit_poor_pct percent of a page, its next
+ * zcache_admit_skip_pages puts are refused without compressing; the
+ * put after that is compressed again to re-evaluate the object.
+ * Objects are tracked in a small direct-mapped table.  Entries are
+ * updated without locking: a lost update only costs one decision.
+ */
+#define ZCACHE_ADMIT_BITS	8
+#define ZCACHE_ADMIT_ENTRIES	(1 << ZCACHE_ADMIT_BITS)
+
+struct zcache_admit {
+	uint32_t tag;		/* hash of pool id and oid, 0 if unused */
+	uint16_t avg_clen;	/* running average of compressed sizes */
+	uint16_t skip;		/* puts left to refuse */
+};
+static struct zcache_admit zcache_admit_table[ZCACHE_ADMIT_ENTRIES];
+
+/* set zcache_admit_poor_pct to 100 or more to compress every page */
+static unsigned long zcache_admit_poor_pct = 75;
+static unsigned long zcache_admit_skip_pages = 32;
+static unsigned long zcache_admit_skipped;
+static unsigned long zcache_admit_throttled;
+
+/*
+ * Returns the admission entry of the object if the put should be
+ * compressed, or NULL if it is refused.
+ */
+static struct zcache_admit *zcache_admit_check(uint32_t pool_id,
+						struct tmem_oid *oidp)
+{
+	struct zcache_admit *za;
+	uint32_t tag;
+
+	tag = jhash2((u32 *)oidp->oid, sizeof(*oidp) / sizeof(u32),
+			pool_id) | 1;
+	za = &zcache_admit_table[tag & (ZCACHE_ADMIT_ENTRIES - 1)];
+	if (za->tag != tag) {
+		za->tag = tag;
+		za->avg_clen = 0;
+		za->skip = 0;
+		return za;
+	}
+	if (za->skip) {
+		za->skip--;
+		zcache_admit_skipped++;
+		return NULL;
+	}
+	return za;
+}
+
+static void zcache_admit_update(struct zcache_admit *za, size_t clen)
+{
+	if (za->avg_clen == 0)
+		za->avg_clen = clen;
+	else
+		za->avg_clen = (za->avg_clen * 3 + clen) / 4;
+
+	if (zcache_admit_poor_pct < 100 &&
+	    za->avg_clen > PAGE_SIZE * zcache_admit_poor_pct / 100) {
+		za->skip = min_t(unsigned long, zcache_admit_skip_pages,
+				 USHRT_MAX);
+		zcache_admit_throttled++;
+	}
+}
+
 static void *zcache_pampd_create(struct tmem_pool *pool, struct tmem_oid *oid,
 				 uint32_t index, struct page *page)
 {
@@ -909,12 +1131,17 @@ static void *zcache_pampd_create(struct tmem_pool *pool, struct tmem_oid *oid,
 	int ret;
 	bool ephemeral = is_ephemeral(pool);
 	unsigned long count;
+	struct zcache_admit *za;
 
 	if (ephemeral) {
+		za = zcache_admit_check(pool->pool_id, oid);
+		if (za == NULL)
+			goto out;
 		ret = zcache_compress(page, &cdata, &clen);
 		if (ret == 0)
 
 			goto out;
+		zcache_admit_update(za, clen);
 		if (clen == 0 || clen > zbud_max_buddy_size()) {
 			zcache_compress_poor++;
 			goto out;
@@ -935,9 +1162,13 @@ static void *zcache_pampd_create(struct tmem_pool *pool, struct tmem_oid *oid,
 		if (atomic_read(&zcache_curr_pers_pampd_count) >
 							3 * totalram_pages / 4)
 			goto out;
+		za = zcache_admit_check(pool->pool_id, oid);
+		if (za == NULL)
+			goto out;
 		ret = zcache_compress(page, &cdata, &clen);
 		if (ret == 0)
 			goto out;
+		zcache_admit_update(za, clen);
 		if (clen > zv_max_page_size) {
 			zcache_compress_poor++;
 			goto out;
@@ -1078,6 +1309,29 @@ static struct notifier_block zcache_cpu_notifier_block = {
 		.show = zcache_##_name##_show, \
 	}
 
+#define ZCACHE_SYSFS_RW(_name) \
+	static ssize_t zcache_##_name##_show(struct kobject *kobj, \
+				struct kobj_attribute *attr, char *buf) \
+	{ \
+		return sprintf(buf, "%lu\n", zcache_##_name); \
+	} \
+	static ssize_t zcache_##_name##_store(struct kobject *kobj, \
+				struct kobj_attribute *attr, \
+				const char *buf, size_t count) \
+	{ \
+		unsigned long val; \
+		int err = kstrtoul(buf, 10, &val); \
+		if (err) \
+			return err; \
+		zcache_##_name = val; \
+		return count; \
+	} \
+	static struct kobj_attribute zcache_##_name##_attr = { \
+		.attr = { .name = __stringify(_name), .mode = 0644 }, \
+		.show = zcache_##_name##_show, \
+		.store = zcache_##_name##_store, \
+	}
+
 #define ZCACHE_SYSFS_RO_ATOMIC(_name) \
 	static ssize_t zcache_##_name##_show(struct kobject *kobj, \
 				struct kobj_attribute *attr, char *buf) \
@@ -1111,8 +1365,6 @@ ZCACHE_SYSFS_RO(failed_pers_puts);
 ZCACHE_SYSFS_RO(zbud_curr_zbytes);
 ZCACHE_SYSFS_RO(zbud_cumul_zpages);
 ZCACHE_SYSFS_RO(zbud_cumul_zbytes);
-ZCACHE_SYSFS_RO(zbud_buddied_count);
-ZCACHE_SYSFS_RO(zbpg_unused_list_count);
 ZCACHE_SYSFS_RO(evicted_raw_pages);
 ZCACHE_SYSFS_RO(evicted_unbuddied_pages);
 ZCACHE_SYSFS_RO(evicted_buddied_pages);
@@ -1122,6 +1374,10 @@ ZCACHE_SYSFS_RO(put_to_flush);
 ZCACHE_SYSFS_RO(aborted_preload);
 ZCACHE_SYSFS_RO(aborted_shrink);
 ZCACHE_SYSFS_RO(compress_poor);
+ZCACHE_SYSFS_RO(admit_skipped);
+ZCACHE_SYSFS_RO(admit_throttled);
+ZCACHE_SYSFS_RW(admit_poor_pct);
+ZCACHE_SYSFS_RW(admit_skip_pages);
 ZCACHE_SYSFS_RO_ATOMIC(zbud_curr_raw_pages);
 ZCACHE_SYSFS_RO_ATOMIC(zbud_curr_zpages);
 ZCACHE_SYSFS_RO_ATOMIC(curr_obj_count);
@@ -1130,6 +1386,9 @@ ZCACHE_SYSFS_RO_CUSTOM(zbud_unbuddied_list_counts,
 			zbud_show_unbuddied_list_counts);
 ZCACHE_SYSFS_RO_CUSTOM(zbud_cumul_chunk_counts,
 			zbud_show_cumul_chunk_counts);
+ZCACHE_SYSFS_RO_CUSTOM(zbud_buddied_count, zbud_show_buddied_count);
+ZCACHE_SYSFS_RO_CUSTOM(zbpg_unused_list_count, zbud_show_unused_list_count);
+ZCACHE_SYSFS_RO_CUSTOM(zbud_lock_stats, zbud_show_lock_stats);
 
 static struct attribute *zcache_attrs[] = {
 	&zcache_curr_obj_count_attr.attr,
@@ -1143,6 +1402,10 @@ static struct attribute *zcache_attrs[] = {
 	&zcache_failed_eph_puts_attr.attr,
 	&zcache_failed_pers_puts_attr.attr,
 	&zcache_compress_poor_attr.attr,
+	&zcache_admit_skipped_attr.attr,
+	&zcache_admit_throttled_attr.attr,
+	&zcache_admit_poor_pct_attr.attr,
+	&zcache_admit_skip_pages_attr.attr,
 	&zcache_zbud_curr_raw_pages_attr.attr,
 	&zcache_zbud_curr_zpages_attr.attr,
 	&zcache_zbud_curr_zbytes_attr.attr,
@@ -1160,6 +1423,7 @@ static struct attribute *zcache_attrs[] = {
 	&zcache_aborted_shrink_attr.attr,
 	&zcache_zbud_unbuddied_list_counts_attr.attr,
 	&zcache_zbud_cumul_chunk_counts_attr.attr,
+	&zcache_zbud_lock_stats_attr.attr,
 	NULL,
 };
 
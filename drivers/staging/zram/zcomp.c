@@ -0,0 +1,214 @@
+/*
+ * Compressed RAM block device - compression streams
+ *
+ * Copyright (C) 2008, 2009, 2010  Nitin Gupta
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ *
+ * Project home: http://compcache.googlecode.com
+ */
+
+#define KMSG_COMPONENT "zram"
+#define pr_fmt(fmt) KMSG_COMPONENT ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/wait.h>
+
+#include "zcomp.h"
+#include "zcomp_lzo.h"
+#ifdef CONFIG_ZRAM_SNAPPY_BACKEND
+#include "zcomp_snappy.h"
+#endif
+
+static struct zcomp_backend *backends[] = {
+	&zcomp_lzo,
+#ifdef CONFIG_ZRAM_SNAPPY_BACKEND
+	&zcomp_snappy,
+#endif
+	NULL
+};
+
+static struct zcomp_backend *find_backend(const char *compress)
+{
+	int i = 0;
+
+	while (backends[i]) {
+		if (sysfs_streq(compress, backends[i]->name))
+			break;
+		i++;
+	}
+	return backends[i];
+}
+
+static void zcomp_strm_free(struct zcomp_strm *zstrm)
+{
+	kfree(zstrm->workmem);
+	free_pages((unsigned long)zstrm->buffer, 1);
+	kfree(zstrm);
+}
+
+static struct zcomp_strm *zcomp_strm_alloc(struct zcomp *comp)
+{
+	struct zcomp_strm *zstrm;
+
+	zstrm = kmalloc(sizeof(*zstrm), GFP_KERNEL);
+	if (!zstrm)
+		return NULL;
+
+	zstrm->workmem = kzalloc(comp->backend->workmem_size, GFP_KERNEL);
+	zstrm->buffer = (void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO, 1);
+	if (!zstrm->workmem || !zstrm->buffer) {
+		zcomp_strm_free(zstrm);
+		return NULL;
+	}
+
+	return zstrm;
+}
+
+/*
+ * Get an idle stream, sleeping until one is released if all of them
+ * are busy. Each wait is accounted so that the pool size can be
+ * validated against the real number of concurrent writers.
+ */
+struct zcomp_strm *zcomp_strm_find(struct zcomp *comp)
+{
+	struct zcomp_strm *zstrm;
+
+	spin_lock(&comp->strm_lock);
+	while (list_empty(&comp->idle_strm)) {
+		comp->strm_waits++;
+		spin_unlock(&comp->strm_lock);
+		wait_event(comp->strm_wait, !list_empty(&comp->idle_strm));
+		spin_lock(&comp->strm_lock);
+	}
+
+	zstrm = list_first_entry(&comp->idle_strm, struct zcomp_strm, list);
+	list_del(&zstrm->list);
+	spin_unlock(&comp->strm_lock);
+
+	return zstrm;
+}
+
+void zcomp_strm_release(struct zcomp *comp, struct zcomp_strm *zstrm)
+{
+	spin_lock(&comp->strm_lock);
+	list_add(&zstrm->list, &comp->idle_strm);
+	spin_unlock(&comp->strm_lock);
+
+	wake_up(&comp->strm_wait);
+}
+
+u64 zcomp_strm_waits(struct zcomp *comp)
+{
+	u64 val;
+
+	spin_lock(&comp->strm_lock);
+	val = comp->strm_waits;
+	spin_unlock(&comp->strm_lock);
+
+	return val;
+}
+
+int zcomp_compress(struct zcomp *comp, struct zcomp_strm *zstrm,
+		   const unsigned char *src, size_t *dst_len)
+{
+	return comp->backend->compress(src, zstrm->buffer, dst_len,
+			zstrm->workmem);
+}
+
+int zcomp_decompress(struct zcomp *comp, const unsigned char *src,
+		     size_t src_len, unsigned char *dst)
+{
+	return comp->backend->decompress(src, src_len, dst);
+}
+
+/* show available compressors, the selected one in brackets */
+ssize_t zcomp_available_show(const char *comp, char *buf)
+{
+	ssize_t sz = 0;
+	int i = 0;
+
+	while (backends[i]) {
+		if (sysfs_streq(comp, backends[i]->name))
+			sz += sprintf(buf + sz, "[%s] ", backends[i]->name);
+		else
+			sz += sprintf(buf + sz, "%s ", backends[i]->name);
+		i++;
+	}
+	sz += sprintf(buf + sz, "\n");
+	return sz;
+}
+
+int zcomp_available_algorithm(const char *comp)
+{
+	return find_backend(comp) != NULL;
+}
+
+/* The i-th backend built in, NULL past the last */
+struct zcomp_backend *zcomp_get_backend(int i)
+{
+	return i < ARRAY_SIZE(backends) ? backends[i] : NULL;
+}
+
+void zcomp_destroy(struct zcomp *comp)
+{
+	struct zcomp_strm *zstrm;
+
+	while (!list_empty(&comp->idle_strm)) {
+		zstrm = list_first_entry(&comp->idle_strm,
+					 struct zcomp_strm, list);
+		list_del(&zstrm->list);
+		zcomp_strm_free(zstrm);
+	}
+	kfree(comp);
+}
+
+/*
+ * Create a compressor using the named backend, with max_strm streams.
+ * All streams are allocated up front: the write path runs under memory
+ * pressure (swap-out) and must not depend on more allocations to make
+ * progress.
+ */
+struct zcomp *zcomp_create(const char *compress, int max_strm)
+{
+	int i;
+	struct zcomp *comp;
+	struct zcomp_strm *zstrm;
+	struct zcomp_backend *backend;
+
+	backend = find_backend(compress);
+	if (!backend)
+		return NULL;
+
+	comp = kzalloc(sizeof(*comp), GFP_KERNEL);
+	if (!comp)
+		return NULL;
+
+	comp->backend = backend;
+
+	spin_lock_init(&comp->strm_lock);
+	INIT_LIST_HEAD(&comp->idle_strm);
+	init_waitqueue_head(&comp->strm_wait);
+
+	for (i = 0; i < max_strm; i++) {
+		zstrm = zcomp_strm_alloc(comp);
+		if (!zstrm) {
+			pr_err("Error allocating compression stream %d\n", i);
+			zcomp_destroy(comp);
+			return NULL;
+		}
+		list_add(&zstrm->list, &comp->idle_strm);
+	}
+	comp->max_strm = max_strm;
+
+	return comp;
+}
@@ -0,0 +1,74 @@
+/*
+ * Compressed RAM block device - compression streams
+ *
+ * Copyright (C) 2008, 2009, 2010  Nitin Gupta
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ *
+ * Project home: http://compcache.googlecode.com
+ */
+
+#ifndef _ZCOMP_H_
+#define _ZCOMP_H_
+
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+
+/*
+ * A compression stream bundles the compressor working memory with
+ * the buffer the compressed object is written to. A writer owns a
+ * stream from compression until the object has been copied into the
+ * allocator, so several writers can compress in parallel.
+ */
+struct zcomp_strm {
+	void *workmem;
+	void *buffer;	/* 2 pages: compressed output may expand */
+	struct list_head list;
+};
+
+/*
+ * Compress exactly one page from src into dst. Backends must accept
+ * a dst buffer of two pages: output of incompressible data may expand.
+ */
+struct zcomp_backend {
+	int (*compress)(const unsigned char *src, unsigned char *dst,
+			size_t *dst_len, void *workmem);
+	int (*decompress)(const unsigned char *src, size_t src_len,
+			unsigned char *dst);
+	size_t workmem_size;
+	const char *name;
+};
+
+struct zcomp {
+	struct zcomp_backend *backend;
+	spinlock_t strm_lock;	/* protects idle_strm and stats */
+	struct list_head idle_strm;
+	wait_queue_head_t strm_wait;
+	int max_strm;
+
+	u64 strm_waits;		/* writers that found no idle stream */
+};
+
+extern ssize_t zcomp_available_show(const char *comp, char *buf);
+extern int zcomp_available_algorithm(const char *comp);
+extern struct zcomp_backend *zcomp_get_backend(int i);
+
+extern struct zcomp *zcomp_create(const char *compress, int max_strm);
+extern void zcomp_destroy(struct zcomp *comp);
+
+extern struct zcomp_strm *zcomp_strm_find(struct zcomp *comp);
+extern void zcomp_strm_release(struct zcomp *comp, struct zcomp_strm *zstrm);
+
+extern int zcomp_compress(struct zcomp *comp, struct zcomp_strm *zstrm,
+			  const unsigned char *src, size_t *dst_len);
+extern int zcomp_decompress(struct zcomp *comp, const unsigned char *src,
+			    size_t src_len, unsigned char *dst);
+
+extern u64 zcomp_strm_waits(struct zcomp *comp);
+
+#endif
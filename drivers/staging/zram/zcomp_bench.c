@@ -0,0 +1,302 @@
+/*
+ * Compressed RAM block device - compressor benchmark
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ *
+ * Compares the backends on the data zram actually gets: a run copies a
+ * sample of the anonymous pages in memory, then at each frequency of the
+ * cpufreq table compresses and decompresses every page of the sample
+ * with every backend. The frequency is held by clamping the policy of
+ * cpu0 to it for the length of the measurement.
+ */
+
+#define KMSG_COMPONENT "zram"
+#define pr_fmt(fmt) KMSG_COMPONENT ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/cpufreq.h>
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/highmem.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#include "zram_drv.h"
+#include "zcomp_bench.h"
+
+#define BENCH_MAX_PAGES		4096
+
+static struct dentry *bench_dir;
+static DEFINE_MUTEX(bench_mutex);	/* one run at a time, and results */
+
+static u32 bench_nr_pages = 256;
+static char *bench_results;
+static size_t bench_results_len;
+
+/* the frequency the policy is clamped to, 0 for none */
+static unsigned int bench_freq;
+
+static int bench_policy_notifier(struct notifier_block *nb,
+				 unsigned long event, void *data)
+{
+	struct cpufreq_policy *policy = data;
+
+	if (event == CPUFREQ_ADJUST && bench_freq)
+		cpufreq_verify_within_limits(policy, bench_freq, bench_freq);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block bench_policy_nb = {
+	.notifier_call = bench_policy_notifier,
+};
+
+static void bench_set_freq(unsigned int freq)
+{
+	bench_freq = freq;
+	cpufreq_update_policy(0);
+}
+
+/*
+ * Copies up to nr anonymous pages into sample, spread over all of memory
+ * so one large process does not make up the whole of it. Returns how
+ * many were found.
+ */
+static int bench_sample(struct page **sample, int nr)
+{
+	unsigned long pfn, end, stride, spanned = 0;
+	struct zone *zone;
+	struct page *page;
+	void *src;
+	int n = 0;
+
+	for_each_populated_zone(zone)
+		spanned += zone->spanned_pages;
+
+	/* around a third of memory is anonymous on a busy device */
+	stride = max(spanned / (nr * 4UL), 1UL);
+
+	for_each_populated_zone(zone) {
+		end = zone->zone_start_pfn + zone->spanned_pages;
+		for (pfn = zone->zone_start_pfn; pfn < end && n < nr;
+		     pfn += stride) {
+			if (!pfn_valid(pfn))
+				continue;
+			page = pfn_to_page(pfn);
+			if (!PageLRU(page) || !PageAnon(page) ||
+			    !get_page_unless_zero(page))
+				continue;
+			if (PageAnon(page)) {
+				src = kmap_atomic(page, KM_USER0);
+				memcpy(page_address(sample[n++]), src, PAGE_SIZE);
+				kunmap_atomic(src, KM_USER0);
+			}
+			put_page(page);
+			cond_resched();
+		}
+	}
+
+	return n;
+}
+
+/* Appends a line for backend at the current frequency to the results */
+static void bench_backend(struct zcomp_backend *backend,
+			  struct page **sample, int nr, void *workmem,
+			  unsigned char *dst, unsigned char *out)
+{
+	size_t dst_len, total = 0;
+	s64 comp_ns = 0, decomp_ns = 0;
+	unsigned long ratio;
+	ktime_t t0, t1, t2;
+	int i, ret, errors = 0;
+	void *src;
+
+	for (i = 0; i < nr; i++) {
+		src = page_address(sample[i]);
+		dst_len = 2 * PAGE_SIZE;
+
+		/* keep the timer interrupt the only thing that can get in */
+		preempt_disable();
+		t0 = ktime_get();
+		ret = backend->compress(src, dst, &dst_len, workmem);
+		t1 = ktime_get();
+		if (!ret)
+			ret = backend->decompress(dst, dst_len, out);
+		t2 = ktime_get();
+		preempt_enable();
+
+		if (ret || memcmp(src, out, PAGE_SIZE)) {
+			errors++;
+			continue;
+		}
+		comp_ns += ktime_to_ns(ktime_sub(t1, t0));
+		decomp_ns += ktime_to_ns(ktime_sub(t2, t1));
+		/* as zram, which stores pages that compress badly as they are */
+		total += dst_len > max_zpage_size ? PAGE_SIZE : dst_len;
+
+		cond_resched();
+	}
+
+	nr -= errors;
+	if (!nr)
+		return;
+	ratio = div_u64((u64)nr * PAGE_SIZE * 100, total);
+
+	bench_results_len += scnprintf(bench_results + bench_results_len,
+			PAGE_SIZE - bench_results_len,
+			"%-8s %10u %3lu.%02lu %10lld %10lld %6d\n",
+			backend->name, cpufreq_get(0), ratio / 100, ratio % 100,
+			div_s64(comp_ns, nr), div_s64(decomp_ns, nr), errors);
+}
+
+static void bench_run_freq(struct page **sample, int nr, void *workmem,
+			   unsigned char *dst, unsigned char *out)
+{
+	struct zcomp_backend *backend;
+	int i;
+
+	for (i = 0; (backend = zcomp_get_backend(i)); i++)
+		bench_backend(backend, sample, nr, workmem, dst, out);
+}
+
+static int bench_run(void)
+{
+	struct cpufreq_frequency_table *table = NULL;
+	struct zcomp_backend *backend;
+	struct page **sample;
+	unsigned char *dst = NULL, *out = NULL;
+	void *workmem = NULL;
+	size_t workmem_size = 0;
+	int i, nr, nr_alloc, ret = -ENOMEM;
+
+	nr_alloc = clamp_t(u32, bench_nr_pages, 1, BENCH_MAX_PAGES);
+
+	sample = vzalloc(nr_alloc * sizeof(*sample));
+	if (!sample)
+		return -ENOMEM;
+	for (i = 0; i < nr_alloc; i++) {
+		sample[i] = alloc_page(GFP_KERNEL);
+		if (!sample[i])
+			goto out;
+	}
+
+	for (i = 0; (backend = zcomp_get_backend(i)); i++)
+		workmem_size = max(workmem_size, backend->workmem_size);
+	workmem = kmalloc(workmem_size, GFP_KERNEL);
+	dst = (unsigned char *)__get_free_pages(GFP_KERNEL, 1);
+	out = (unsigned char *)__get_free_page(GFP_KERNEL);
+	if (!workmem || !dst || !out)
+		goto out;
+
+	nr = bench_sample(sample, nr_alloc);
+	if (!nr) {
+		ret = -ENODATA;
+		goto out;
+	}
+
+	bench_results_len = scnprintf(bench_results, PAGE_SIZE,
+			"# %d pages\n# algo     freq_khz  ratio    comp_ns  decomp_ns errors\n",
+			nr);
+
+#ifdef CONFIG_CPU_FREQ_TABLE
+	table = cpufreq_frequency_get_table(0);
+#endif
+	if (table) {
+		cpufreq_register_notifier(&bench_policy_nb,
+					  CPUFREQ_POLICY_NOTIFIER);
+		for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
+			if (table[i].frequency == CPUFREQ_ENTRY_INVALID)
+				continue;
+			bench_set_freq(table[i].frequency);
+			bench_run_freq(sample, nr, workmem, dst, out);
+		}
+		bench_set_freq(0);
+		cpufreq_unregister_notifier(&bench_policy_nb,
+					    CPUFREQ_POLICY_NOTIFIER);
+	} else {
+		bench_run_freq(sample, nr, workmem, dst, out);
+	}
+	ret = 0;
+
+out:
+	free_page((unsigned long)out);
+	free_pages((unsigned long)dst, 1);
+	kfree(workmem);
+	for (i = 0; i < nr_alloc && sample[i]; i++)
+		__free_page(sample[i]);
+	vfree(sample);
+	return ret;
+}
+
+static ssize_t bench_run_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	int ret;
+
+	mutex_lock(&bench_mutex);
+	ret = bench_run();
+	mutex_unlock(&bench_mutex);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations bench_run_fops = {
+	.write		= bench_run_write,
+	.llseek		= noop_llseek,
+};
+
+static ssize_t bench_results_read(struct file *file, char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	ssize_t ret;
+
+	mutex_lock(&bench_mutex);
+	ret = simple_read_from_buffer(buf, count, ppos, bench_results,
+				      bench_results_len);
+	mutex_unlock(&bench_mutex);
+
+	return ret;
+}
+
+static const struct file_operations bench_results_fops = {
+	.read		= bench_results_read,
+	.llseek		= default_llseek,
+};
+
+void __init zcomp_bench_init(void)
+{
+	bench_results = (char *)get_zeroed_page(GFP_KERNEL);
+	if (!bench_results)
+		return;
+
+	bench_dir = debugfs_create_dir("zcomp_bench", NULL);
+	if (IS_ERR_OR_NULL(bench_dir)) {
+		pr_warning("Unable to create zcomp_bench in debugfs\n");
+		free_page((unsigned long)bench_results);
+		bench_results = NULL;
+		bench_dir = NULL;
+		return;
+	}
+
+	debugfs_create_u32("nr_pages", 0644, bench_dir, &bench_nr_pages);
+	debugfs_create_file("run", 0200, bench_dir, NULL, &bench_run_fops);
+	debugfs_create_file("results", 0444, bench_dir, NULL,
+			    &bench_results_fops);
+}
+
+void zcomp_bench_exit(void)
+{
+	debugfs_remove_recursive(bench_dir);
+	free_page((unsigned long)bench_results);
+}
@@ -0,0 +1,22 @@
+/*
+ * Compressed RAM block device - compressor benchmark
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifndef _ZCOMP_BENCH_H_
+#define _ZCOMP_BENCH_H_
+
+#ifdef CONFIG_ZRAM_COMP_BENCH
+extern void zcomp_bench_init(void);
+extern void zcomp_bench_exit(void);
+#else
+static inline void zcomp_bench_init(void) { }
+static inline void zcomp_bench_exit(void) { }
+#endif
+
+#endif
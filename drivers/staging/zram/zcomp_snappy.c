@@ -0,0 +1,44 @@
+/*
+ * Compressed RAM block device - snappy backend
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#include <linux/kernel.h>
+#include <linux/mm.h>
+
+#include "../snappy/csnappy.h" /* if built in drivers/staging */
+#include "zcomp_snappy.h"
+
+#define WMSIZE_ORDER	((PAGE_SHIFT > 14) ? (15) : (PAGE_SHIFT+1))
+#define WMSIZE		(1 << WMSIZE_ORDER)
+
+static int snappy_compress(const unsigned char *src, unsigned char *dst,
+		size_t *dst_len, void *workmem)
+{
+	const char *end = csnappy_compress_fragment((const char *)src,
+			PAGE_SIZE, (char *)dst, workmem, WMSIZE_ORDER);
+
+	*dst_len = end - (char *)dst;
+	return 0;
+}
+
+static int snappy_decompress(const unsigned char *src, size_t src_len,
+		unsigned char *dst)
+{
+	uint32_t dst_len = PAGE_SIZE;
+
+	return csnappy_decompress_noheader((const char *)src, src_len,
+			(char *)dst, &dst_len);
+}
+
+struct zcomp_backend zcomp_snappy = {
+	.compress = snappy_compress,
+	.decompress = snappy_decompress,
+	.workmem_size = WMSIZE,
+	.name = "snappy",
+};
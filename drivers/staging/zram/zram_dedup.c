@@ -0,0 +1,145 @@
+/*
+ * Compressed RAM block device - deduplication of compressed pages
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#include <linux/kernel.h>
+#include <linux/jhash.h>
+#include <linux/rbtree.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+
+#include "zram_drv.h"
+
+void zram_dedup_init(struct zram *zram)
+{
+	zram->dedup_root = RB_ROOT;
+	spin_lock_init(&zram->dedup_lock);
+}
+
+u32 zram_dedup_checksum(const unsigned char *cmem, size_t len)
+{
+	return jhash(cmem, len, 0);
+}
+
+static int zram_dedup_match(struct zram *zram, struct zram_dedup_entry *entry,
+			    const unsigned char *cmem, size_t len)
+{
+	int match;
+	unsigned char *obj;
+
+	if (entry->size != len)
+		return 0;
+
+	obj = zs_map_object(zram->mem_pool, entry->handle, ZS_MM_RO);
+	match = !memcmp(obj, cmem, len);
+	zs_unmap_object(zram->mem_pool, entry->handle);
+
+	return match;
+}
+
+/*
+ * Look for an object identical to cmem. On success a reference is
+ * taken on the returned entry.
+ */
+struct zram_dedup_entry *zram_dedup_find(struct zram *zram,
+		const unsigned char *cmem, size_t len, u32 checksum)
+{
+	struct rb_node *node;
+	struct zram_dedup_entry *entry;
+
+	spin_lock(&zram->dedup_lock);
+	node = zram->dedup_root.rb_node;
+	while (node) {
+		entry = rb_entry(node, struct zram_dedup_entry, node);
+		if (checksum == entry->checksum)
+			break;
+		node = checksum < entry->checksum ?
+			node->rb_left : node->rb_right;
+	}
+
+	if (!node)
+		goto miss;
+
+	/* Checksum collisions are kept next to each other in the tree */
+	while (rb_prev(node)) {
+		entry = rb_entry(rb_prev(node), struct zram_dedup_entry, node);
+		if (entry->checksum != checksum)
+			break;
+		node = rb_prev(node);
+	}
+
+	for (; node; node = rb_next(node)) {
+		entry = rb_entry(node, struct zram_dedup_entry, node);
+		if (entry->checksum != checksum)
+			break;
+		if (zram_dedup_match(zram, entry, cmem, len)) {
+			entry->refcount++;
+			spin_unlock(&zram->dedup_lock);
+			return entry;
+		}
+	}
+
+miss:
+	spin_unlock(&zram->dedup_lock);
+	return NULL;
+}
+
+/*
+ * Start sharing a freshly stored object. Returns NULL if no entry can
+ * be allocated, in which case the caller keeps the object private.
+ */
+struct zram_dedup_entry *zram_dedup_insert(struct zram *zram,
+		unsigned long handle, size_t len, u32 checksum)
+{
+	struct rb_node **rb_node, *parent = NULL;
+	struct zram_dedup_entry *entry, *tmp;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOIO);
+	if (!entry)
+		return NULL;
+
+	entry->checksum = checksum;
+	entry->refcount = 1;
+	entry->handle = handle;
+	entry->size = len;
+
+	spin_lock(&zram->dedup_lock);
+	rb_node = &zram->dedup_root.rb_node;
+	while (*rb_node) {
+		parent = *rb_node;
+		tmp = rb_entry(parent, struct zram_dedup_entry, node);
+		if (checksum < tmp->checksum)
+			rb_node = &parent->rb_left;
+		else
+			rb_node = &parent->rb_right;
+	}
+	rb_link_node(&entry->node, parent, rb_node);
+	rb_insert_color(&entry->node, &zram->dedup_root);
+	spin_unlock(&zram->dedup_lock);
+
+	return entry;
+}
+
+/*
+ * Drop a reference. Returns 1 if it was the last one: the entry has
+ * then been unlinked and the caller frees both the object and entry.
+ */
+int zram_dedup_put(struct zram *zram, struct zram_dedup_entry *entry)
+{
+	int last;
+
+	spin_lock(&zram->dedup_lock);
+	last = !--entry->refcount;
+	if (last)
+		rb_erase(&entry->node, &zram->dedup_root);
+	spin_unlock(&zram->dedup_lock);
+
+	return last;
+}
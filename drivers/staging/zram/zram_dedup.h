@@ -0,0 +1,73 @@
+/*
+ * Compressed RAM block device - deduplication of compressed pages
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifndef _ZRAM_DEDUP_H_
+#define _ZRAM_DEDUP_H_
+
+#include <linux/rbtree.h>
+#include <linux/types.h>
+
+struct zram;
+
+/*
+ * Compressed object shared by every table entry flagged ZRAM_DEDUP
+ * that points to it. Entries are indexed by a checksum of the
+ * compressed data: the compressor is deterministic, so identical
+ * pages always produce identical compressed objects.
+ */
+struct zram_dedup_entry {
+	struct rb_node node;
+	u32 checksum;
+	u32 refcount;
+	unsigned long handle;
+	u16 size;
+};
+
+#ifdef CONFIG_ZRAM_DEDUP
+extern void zram_dedup_init(struct zram *zram);
+extern u32 zram_dedup_checksum(const unsigned char *cmem, size_t len);
+extern struct zram_dedup_entry *zram_dedup_find(struct zram *zram,
+		const unsigned char *cmem, size_t len, u32 checksum);
+extern struct zram_dedup_entry *zram_dedup_insert(struct zram *zram,
+		unsigned long handle, size_t len, u32 checksum);
+extern int zram_dedup_put(struct zram *zram, struct zram_dedup_entry *entry);
+
+static inline int zram_dedup_enabled(struct zram *zram)
+{
+	return zram->use_dedup;
+}
+#else
+static inline void zram_dedup_init(struct zram *zram) { }
+static inline u32 zram_dedup_checksum(const unsigned char *cmem, size_t len)
+{
+	return 0;
+}
+static inline struct zram_dedup_entry *zram_dedup_find(struct zram *zram,
+		const unsigned char *cmem, size_t len, u32 checksum)
+{
+	return NULL;
+}
+static inline struct zram_dedup_entry *zram_dedup_insert(struct zram *zram,
+		unsigned long handle, size_t len, u32 checksum)
+{
+	return NULL;
+}
+static inline int zram_dedup_put(struct zram *zram,
+		struct zram_dedup_entry *entry)
+{
+	return 1;
+}
+static inline int zram_dedup_enabled(struct zram *zram)
+{
+	return 0;
+}
+#endif
+
+#endif
@@ -28,6 +28,7 @@
 #include <linux/device.h>
 #include <linux/genhd.h>
 #include <linux/highmem.h>
+#include <linux/prefetch.h>
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/vmalloc.h>
@@ -36,54 +37,16 @@
 #endif /* CONFIG_ZRAM_FOR_ANDROID */
 
 #include "zram_drv.h"
-
-#if defined(CONFIG_ZRAM_LZO)
-#include <linux/lzo.h>
-#define WMSIZE		LZO1X_MEM_COMPRESS
-#define COMPRESS(s, sl, d, dl, wm)	\
-	lzo1x_1_compress(s, sl, d, dl, wm)
-#define DECOMPRESS(s, sl, d, dl)	\
-	lzo1x_decompress_safe(s, sl, d, dl)
-#elif defined(CONFIG_ZRAM_SNAPPY)
-#include "../snappy/csnappy.h" /* if built in drivers/staging */
-#define WMSIZE_ORDER	((PAGE_SHIFT > 14) ? (15) : (PAGE_SHIFT+1))
-#define WMSIZE		(1 << WMSIZE_ORDER)
-static int
-snappy_compress_(
-	const unsigned char *src,
-	size_t src_len,
-	unsigned char *dst,
-	size_t *dst_len,
-	void *workmem)
-{
-	const unsigned char *end = csnappy_compress_fragment(
-		src, (uint32_t)src_len, dst, workmem, WMSIZE_ORDER);
-	*dst_len = end - dst;
-	return 0;
-}
-static int
-snappy_decompress_(
-	const unsigned char *src,
-	size_t src_len,
-	unsigned char *dst,
-	size_t *dst_len)
-{
-	uint32_t dst_len_ = (uint32_t)*dst_len;
-	int ret = csnappy_decompress_noheader(src, src_len, dst, &dst_len_);
-	*dst_len = (size_t)dst_len_;
-	return ret;
-}
-#define COMPRESS(s, sl, d, dl, wm)	\
-	snappy_compress_(s, sl, d, dl, wm)
-#define DECOMPRESS(s, sl, d, dl)	\
-	snappy_decompress_(s, sl, d, dl)
-#else
-#error either CONFIG_ZRAM_LZO or CONFIG_ZRAM_SNAPPY must be defined
-#endif
+#include "zcomp_bench.h"
 
 /* Globals */
 static int zram_major;
 struct zram *zram_devices;
+#ifdef CONFIG_ZRAM_SNAPPY
+static const char *default_compressor = "snappy";
+#else
+static const char *default_compressor = "lzo";
+#endif
 
 /* Module params (documentation at end) */
 unsigned int zram_num_devices;
@@ -135,21 +98,56 @@ static void zram_clear_flag(struct zram *zram, u32 index,
 	zram->table[index].flags &= ~BIT(flag);
 }
 
-static int page_zero_filled(void *ptr)
+/*
+ * Check whether the page is one machine word repeated over and over
+ * (zero filled pages being the most common case) and return the word.
+ */
+static int page_same_filled(void *ptr, unsigned long *element)
 {
 	unsigned int pos;
 	unsigned long *page;
 
 	page = (unsigned long *)ptr;
 
-	for (pos = 0; pos != PAGE_SIZE / sizeof(*page); pos++) {
-		if (page[pos])
+	for (pos = 1; pos != PAGE_SIZE / sizeof(*page); pos++) {
+		if (page[pos] != page[0])
 			return 0;
 	}
 
+	*element = page[0];
 	return 1;
 }
 
+static void fill_page(void *ptr, unsigned long len, unsigned long element)
+{
+	unsigned long i, *page = ptr;
+
+	if (!element) {
+		memset(ptr, 0, len);
+		return;
+	}
+
+	for (i = 0; i < len / sizeof(*page); i++)
+		page[i] = element;
+}
+
+/* zsmalloc handle of a compressed page, shared or not */
+static unsigned long zram_get_handle(struct zram *zram, u32 index)
+{
+	if (zram_test_flag(zram, index, ZRAM_DEDUP))
+		return zram->table[index].entry->handle;
+	return zram->table[index].handle;
+}
+
+/*
+ * One compression stream per online CPU lets every CPU (including the
+ * one running kswapd) compress concurrently.
+ */
+static int max_comp_streams(void)
+{
+	return max_t(int, num_online_cpus(), 1);
+}
+
 static u64 zram_default_disksize_bytes(void)
 {
 	return ((totalram_pages << PAGE_SHIFT) *
@@ -181,16 +179,32 @@ static void setup_swap_header(struct zram *zram, union swap_header *s)
 static void zram_free_page(struct zram *zram, size_t index)
 {
 	u32 clen;
-	void *obj;
+	struct zram_dedup_entry *entry;
+	unsigned long handle = zram->table[index].handle;
 
-	struct page *page = zram->table[index].page;
-	u32 offset = zram->table[index].offset;
+	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_clear_flag(zram, index, ZRAM_UNDER_WB);
 
-	if (unlikely(!page)) {
-		/*
-		 * No memory is allocated for zero filled pages.
-		 * Simply clear zero page flag.
-		 */
+	if (zram_test_flag(zram, index, ZRAM_WB)) {
+		zram_clear_flag(zram, index, ZRAM_WB);
+		zram_wb_free_block(zram, zram->table[index].blk_idx);
+		zram_stat_dec(&zram->stats.bd_count);
+		zram->table[index].blk_idx = 0;
+		return;
+	}
+
+	/*
+	 * No memory is allocated for same filled pages.
+	 * Simply clear the flag.
+	 */
+	if (zram_test_flag(zram, index, ZRAM_SAME)) {
+		zram_clear_flag(zram, index, ZRAM_SAME);
+		zram_stat_dec(&zram->stats.pages_same);
+		zram->table[index].element = 0;
+		return;
+	}
+
+	if (unlikely(!handle)) {
 		if (zram_test_flag(zram, index, ZRAM_ZERO)) {
 			zram_clear_flag(zram, index, ZRAM_ZERO);
 			zram_stat_dec(&zram->stats.pages_zero);
@@ -200,35 +214,46 @@ static void zram_free_page(struct zram *zram, size_t index)
 
 	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))) {
 		clen = PAGE_SIZE;
-		__free_page(page);
+		__free_page(zram->table[index].page);
 		zram_clear_flag(zram, index, ZRAM_UNCOMPRESSED);
 		zram_stat_dec(&zram->stats.pages_expand);
 		goto out;
 	}
 
-	obj = kmap_atomic(page) + offset;
-	clen = xv_get_object_size(obj) - sizeof(struct zobj_header);
-	kunmap_atomic(obj);
-
-	xv_free(zram->mem_pool, page, offset);
+	clen = zram->table[index].size;
 	if (clen <= PAGE_SIZE / 2)
 		zram_stat_dec(&zram->stats.good_compress);
 
+	if (zram_test_flag(zram, index, ZRAM_DEDUP)) {
+		entry = zram->table[index].entry;
+		zram_clear_flag(zram, index, ZRAM_DEDUP);
+		if (!zram_dedup_put(zram, entry)) {
+			/* Others still share the object */
+			zram_stat64_sub(zram, &zram->stats.dup_data_size, clen);
+			zram_stat_dec(&zram->stats.pages_stored);
+			goto reset;
+		}
+		handle = entry->handle;
+		kfree(entry);
+	}
+	zs_free(zram->mem_pool, handle);
+
 out:
 	zram_stat64_sub(zram, &zram->stats.compr_size, clen);
 	zram_stat_dec(&zram->stats.pages_stored);
 
-	zram->table[index].page = NULL;
-	zram->table[index].offset = 0;
+reset:
+	zram->table[index].handle = 0;
+	zram->table[index].size = 0;
 }
 
-static void handle_zero_page(struct bio_vec *bvec)
+static void handle_same_page(struct bio_vec *bvec, unsigned long element)
 {
 	struct page *page = bvec->bv_page;
 	void *user_mem;
 
 	user_mem = kmap_atomic(page);
-	memset(user_mem + bvec->bv_offset, 0, bvec->bv_len);
+	fill_page(user_mem + bvec->bv_offset, bvec->bv_len, element);
 	kunmap_atomic(user_mem);
 
 	flush_dcache_page(page);
@@ -255,27 +280,115 @@ static inline int is_partial_io(struct bio_vec *bvec)
 	return bvec->bv_len != PAGE_SIZE;
 }
 
+static int zram_bdev_read(struct zram *zram, struct page *page, u32 index)
+{
+	int ret;
+
+	ret = zram_wb_read_page(zram, zram->table[index].blk_idx, page);
+	if (unlikely(ret)) {
+		pr_err("Backing device read failed! err=%d, page=%u\n",
+			ret, index);
+		zram_stat64_inc(zram, &zram->stats.failed_reads);
+		return ret;
+	}
+
+	zram_stat64_inc(zram, &zram->stats.bd_reads);
+	return 0;
+}
+
+/* Read a page that was written back, into mem (PAGE_SIZE bytes) */
+static int zram_bdev_read_mem(struct zram *zram, unsigned char *mem,
+			      u32 index)
+{
+	int ret;
+	struct page *page;
+	unsigned char *src;
+
+	page = alloc_page(GFP_NOIO);
+	if (!page) {
+		pr_info("Error allocating temp memory!\n");
+		return -ENOMEM;
+	}
+
+	ret = zram_bdev_read(zram, page, index);
+	if (!ret) {
+		src = kmap_atomic(page);
+		memcpy(mem, src, PAGE_SIZE);
+		kunmap_atomic(src);
+	}
+	__free_page(page);
+
+	return ret;
+}
+
+static int handle_wb_page(struct zram *zram, struct bio_vec *bvec,
+			  u32 index, int offset)
+{
+	int ret;
+	struct page *page = bvec->bv_page;
+	unsigned char *user_mem, *uncmem;
+
+	if (!is_partial_io(bvec)) {
+		ret = zram_bdev_read(zram, page, index);
+		if (!ret)
+			flush_dcache_page(page);
+		return ret;
+	}
+
+	uncmem = kmalloc(PAGE_SIZE, GFP_NOIO);
+	if (!uncmem) {
+		pr_info("Error allocating temp memory!\n");
+		return -ENOMEM;
+	}
+
+	ret = zram_bdev_read_mem(zram, uncmem, index);
+	if (!ret) {
+		user_mem = kmap_atomic(page);
+		memcpy(user_mem + bvec->bv_offset, uncmem + offset,
+		       bvec->bv_len);
+		kunmap_atomic(user_mem);
+		flush_dcache_page(page);
+	}
+	kfree(uncmem);
+
+	return ret;
+}
+
 static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 			  u32 index, int offset, struct bio *bio)
 {
 	int ret;
-	size_t clen;
+	unsigned long handle;
 	struct page *page;
-	struct zobj_header *zheader;
 	unsigned char *user_mem, *cmem, *uncmem = NULL;
 
 	page = bvec->bv_page;
 
+	/*
+	 * Readers only ever clear the flag, and anything setting it holds
+	 * zram->lock for write, so this is safe under the read lock.
+	 */
+	if (unlikely(zram_test_flag(zram, index, ZRAM_IDLE)))
+		zram_clear_flag(zram, index, ZRAM_IDLE);
+
 	if (zram_test_flag(zram, index, ZRAM_ZERO)) {
-		handle_zero_page(bvec);
+		handle_same_page(bvec, 0);
 		return 0;
 	}
 
+	if (zram_test_flag(zram, index, ZRAM_SAME)) {
+		handle_same_page(bvec, zram->table[index].element);
+		return 0;
+	}
+
+	if (zram_test_flag(zram, index, ZRAM_WB))
+		return handle_wb_page(zram, bvec, index, offset);
+
 	/* Requested page is not present in compressed area */
-	if (unlikely(!zram->table[index].page)) {
+	if (unlikely(!zram->table[index].handle)) {
 		pr_debug("Read before write: sector=%lu, size=%u",
 			 (ulong)(bio->bi_sector), bio->bi_size);
-		handle_zero_page(bvec);
+		handle_same_page(bvec, 0);
 		return 0;
 	}
 
@@ -297,15 +410,14 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	user_mem = kmap_atomic(page);
 	if (!is_partial_io(bvec))
 		uncmem = user_mem;
-	clen = PAGE_SIZE;
 
-	cmem = kmap_atomic(zram->table[index].page) +
-		zram->table[index].offset;
+	handle = zram_get_handle(zram, index);
+	cmem = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
+
+	ret = zcomp_decompress(zram->comp, cmem, zram->table[index].size,
+			uncmem);
 
-	ret = DECOMPRESS(
-			cmem + sizeof(*zheader),
-			xv_get_object_size(cmem) - sizeof(*zheader),
-			uncmem, &clen);
+	zs_unmap_object(zram->mem_pool, handle);
 
 	if (is_partial_io(bvec)) {
 		memcpy(user_mem + bvec->bv_offset, uncmem + offset,
@@ -313,7 +425,6 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 		kfree(uncmem);
 	}
 
-	kunmap_atomic(cmem);
 	kunmap_atomic(user_mem);
 
 	/* Should NEVER happen. Return bio error if it does. */
@@ -328,33 +439,40 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	return 0;
 }
 
-static int zram_read_before_write(struct zram *zram, char *mem, u32 index)
+static int zram_read_before_write(struct zram *zram, unsigned char *mem,
+				  u32 index)
 {
 	int ret;
-	size_t clen = PAGE_SIZE;
-	struct zobj_header *zheader;
+	unsigned long handle;
 	unsigned char *cmem;
 
+	if (zram_test_flag(zram, index, ZRAM_SAME)) {
+		fill_page(mem, PAGE_SIZE, zram->table[index].element);
+		return 0;
+	}
+
+	if (zram_test_flag(zram, index, ZRAM_WB))
+		return zram_bdev_read_mem(zram, mem, index);
+
 	if (zram_test_flag(zram, index, ZRAM_ZERO) ||
-	    !zram->table[index].page) {
+	    !zram->table[index].handle) {
 		memset(mem, 0, PAGE_SIZE);
 		return 0;
 	}
 
-	cmem = kmap_atomic(zram->table[index].page) +
-		zram->table[index].offset;
-
 	/* Page is stored uncompressed since it's incompressible */
 	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))) {
+		cmem = kmap_atomic(zram->table[index].page);
 		memcpy(mem, cmem, PAGE_SIZE);
 		kunmap_atomic(cmem);
 		return 0;
 	}
 
-	ret = DECOMPRESS(cmem + sizeof(*zheader),
-			xv_get_object_size(cmem) - sizeof(*zheader),
-			mem, &clen);
-	kunmap_atomic(cmem);
+	handle = zram_get_handle(zram, index);
+	cmem = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
+	ret = zcomp_decompress(zram->comp, cmem, zram->table[index].size,
+			mem);
+	zs_unmap_object(zram->mem_pool, handle);
 
 	/* Should NEVER happen. Return bio error if it does. */
 	if (unlikely(ret)) {
@@ -366,18 +484,27 @@ static int zram_read_before_write(struct zram *zram, char *mem, u32 index)
 	return 0;
 }
 
+/*
+ * Compression runs on a private stream without zram->lock held, so
+ * concurrent swap writers only serialize on the (short) table update.
+ * Partial I/O has to merge with the currently stored page, so it keeps
+ * the lock across the whole read-modify-write cycle.
+ */
 static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 			   int offset)
 {
 	int ret;
-	u32 store_offset;
 	size_t clen;
-	struct zobj_header *zheader;
+	u32 checksum = 0;
+	unsigned long handle, element;
+	struct zram_dedup_entry *entry;
+	struct zcomp_strm *zstrm;
 	struct page *page, *page_store;
 	unsigned char *user_mem, *cmem, *src, *uncmem = NULL;
 
 	page = bvec->bv_page;
-	src = zram->compress_buffer;
+	zstrm = zcomp_strm_find(zram->comp);
+	src = zstrm->buffer;
 
 	if (is_partial_io(bvec)) {
 		/*
@@ -388,8 +515,9 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		if (!uncmem) {
 			pr_info("Error allocating temp memory!\n");
 			ret = -ENOMEM;
-			goto out;
+			goto out_nolock;
 		}
+		down_write(&zram->lock);
 		ret = zram_read_before_write(zram, uncmem, index);
 		if (ret) {
 			kfree(uncmem);
@@ -397,14 +525,6 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		}
 	}
 
-	/*
-	 * System overwrites unused sectors. Free memory associated
-	 * with this sector now.
-	 */
-	if (zram->table[index].page ||
-	    zram_test_flag(zram, index, ZRAM_ZERO))
-		zram_free_page(zram, index);
-
 	user_mem = kmap_atomic(page);
 
 	if (is_partial_io(bvec))
@@ -413,29 +533,44 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	else
 		uncmem = user_mem;
 
-	if (page_zero_filled(uncmem)) {
+	if (page_same_filled(uncmem, &element)) {
 		kunmap_atomic(user_mem);
 		if (is_partial_io(bvec))
 			kfree(uncmem);
-		zram_stat_inc(&zram->stats.pages_zero);
-		zram_set_flag(zram, index, ZRAM_ZERO);
+		else
+			down_write(&zram->lock);
+		zram_free_page(zram, index);
+		if (!element) {
+			zram_stat_inc(&zram->stats.pages_zero);
+			zram_set_flag(zram, index, ZRAM_ZERO);
+		} else {
+			zram_stat_inc(&zram->stats.pages_same);
+			zram_set_flag(zram, index, ZRAM_SAME);
+			zram->table[index].element = element;
+		}
 		ret = 0;
 		goto out;
 	}
 
-	COMPRESS(uncmem, PAGE_SIZE, src, &clen,
-		zram->compress_workmem);
-	ret = 0;
+	ret = zcomp_compress(zram->comp, zstrm, uncmem, &clen);
 
 	kunmap_atomic(user_mem);
 	if (is_partial_io(bvec))
-			kfree(uncmem);
+		kfree(uncmem);
+	else
+		down_write(&zram->lock);
 
 	if (unlikely(ret != 0)) {
 		pr_err("Compression failed! err=%d\n", ret);
 		goto out;
 	}
 
+	/*
+	 * System overwrites unused sectors. Free memory associated
+	 * with this sector now.
+	 */
+	zram_free_page(zram, index);
+
 	/*
 	 * Page is incompressible. Store it as-is (uncompressed)
 	 * since we do not want to return too many disk write
@@ -451,74 +586,81 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 			goto out;
 		}
 
-		store_offset = 0;
 		zram_set_flag(zram, index, ZRAM_UNCOMPRESSED);
 		zram_stat_inc(&zram->stats.pages_expand);
 		zram->table[index].page = page_store;
+
 		src = kmap_atomic(page);
-		goto memstore;
+		cmem = kmap_atomic(page_store);
+		memcpy(cmem, src, clen);
+		kunmap_atomic(cmem);
+		kunmap_atomic(src);
+		goto update_stats;
+	}
+
+	if (zram_dedup_enabled(zram)) {
+		checksum = zram_dedup_checksum(src, clen);
+		entry = zram_dedup_find(zram, src, clen, checksum);
+		if (entry) {
+			zram_set_flag(zram, index, ZRAM_DEDUP);
+			zram->table[index].entry = entry;
+			zram->table[index].size = clen;
+			zram_stat64_inc(zram, &zram->stats.dedup_hits);
+			zram_stat64_add(zram, &zram->stats.dup_data_size,
+					clen);
+			zram_stat_inc(&zram->stats.pages_stored);
+			if (clen <= PAGE_SIZE / 2)
+				zram_stat_inc(&zram->stats.good_compress);
+			goto out;
+		}
 	}
 
-	if (xv_malloc(zram->mem_pool, clen + sizeof(*zheader),
-		      &zram->table[index].page, &store_offset,
-		      GFP_NOIO | __GFP_HIGHMEM)) {
+	handle = zs_malloc(zram->mem_pool, clen, GFP_NOIO | __GFP_HIGHMEM);
+	if (!handle) {
 		pr_info("Error allocating memory for compressed "
 			"page: %u, size=%zu\n", index, clen);
 		ret = -ENOMEM;
 		goto out;
 	}
+	zram->table[index].handle = handle;
+	zram->table[index].size = clen;
 
-memstore:
-	zram->table[index].offset = store_offset;
-
-	cmem = kmap_atomic(zram->table[index].page) +
-		zram->table[index].offset;
-
-#if 0
-	/* Back-reference needed for memory defragmentation */
-	if (!zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)) {
-		zheader = (struct zobj_header *)cmem;
-		zheader->table_idx = index;
-		cmem += sizeof(*zheader);
-	}
-#endif
-
+	cmem = zs_map_object(zram->mem_pool, handle, ZS_MM_WO);
 	memcpy(cmem, src, clen);
+	zs_unmap_object(zram->mem_pool, handle);
 
-	kunmap_atomic(cmem);
-	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)))
-		kunmap_atomic(src);
+	if (zram_dedup_enabled(zram)) {
+		entry = zram_dedup_insert(zram, handle, clen, checksum);
+		if (entry) {
+			zram_set_flag(zram, index, ZRAM_DEDUP);
+			zram->table[index].entry = entry;
+		}
+	}
 
+update_stats:
 	/* Update stats */
 	zram_stat64_add(zram, &zram->stats.compr_size, clen);
 	zram_stat_inc(&zram->stats.pages_stored);
 	if (clen <= PAGE_SIZE / 2)
 		zram_stat_inc(&zram->stats.good_compress);
 
-	return 0;
-
 out:
+	up_write(&zram->lock);
+out_nolock:
+	zcomp_strm_release(zram->comp, zstrm);
 	if (ret)
 		zram_stat64_inc(zram, &zram->stats.failed_writes);
 	return ret;
 }
 
+/* Reads are called with zram->lock held, see __zram_make_request() */
 static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 			int offset, struct bio *bio, int rw)
 {
-	int ret;
+	if (rw == READ)
+		return zram_bvec_read(zram, bvec, index, offset, bio);
 
-	if (rw == READ) {
-		down_read(&zram->lock);
-		ret = zram_bvec_read(zram, bvec, index, offset, bio);
-		up_read(&zram->lock);
-	} else {
-		down_write(&zram->lock);
-		ret = zram_bvec_write(zram, bvec, index, offset);
-		up_write(&zram->lock);
-	}
-
-	return ret;
+	return zram_bvec_write(zram, bvec, index, offset);
 }
 
 static void update_position(u32 *index, int *offset, struct bio_vec *bvec)
@@ -528,10 +670,17 @@ static void update_position(u32 *index, int *offset, struct bio_vec *bvec)
 	*offset = (*offset + bvec->bv_len) % PAGE_SIZE;
 }
 
+/*
+ * Swap readahead sends bios of up to 1 << page_cluster pages: take
+ * zram->lock once for the whole bio instead of once per page, and
+ * warm up the next table entry while the current page decompresses.
+ * Writes manage the lock themselves so that they can compress without
+ * holding it.
+ */
 static void __zram_make_request(struct zram *zram, struct bio *bio, int rw)
 {
 	int i, offset;
-	u32 index;
+	u32 index, last_index;
 	struct bio_vec *bvec;
 
 	switch (rw) {
@@ -545,10 +694,18 @@ static void __zram_make_request(struct zram *zram, struct bio *bio, int rw)
 
 	index = bio->bi_sector >> SECTORS_PER_PAGE_SHIFT;
 	offset = (bio->bi_sector & (SECTORS_PER_PAGE - 1)) << SECTOR_SHIFT;
+	last_index = (bio->bi_sector + (bio->bi_size >> SECTOR_SHIFT) - 1) >>
+			SECTORS_PER_PAGE_SHIFT;
+
+	if (rw == READ)
+		down_read(&zram->lock);
 
 	bio_for_each_segment(bvec, bio, i) {
 		int max_transfer_size = PAGE_SIZE - offset;
 
+		if (rw == READ && index < last_index)
+			prefetch(&zram->table[index + 1]);
+
 		if (bvec->bv_len > max_transfer_size) {
 			/*
 			 * zram_bvec_rw() can only make operation on a single
@@ -575,11 +732,16 @@ static void __zram_make_request(struct zram *zram, struct bio *bio, int rw)
 		update_position(&index, &offset, bvec);
 	}
 
+	if (rw == READ)
+		up_read(&zram->lock);
+
 	set_bit(BIO_UPTODATE, &bio->bi_flags);
 	bio_endio(bio, 0);
 	return;
 
 out:
+	if (rw == READ)
+		up_read(&zram->lock);
 	bio_io_error(bio);
 }
 
@@ -638,33 +800,43 @@ void __zram_reset_device(struct zram *zram)
 	zram->init_done = 0;
 
 	/* Free various per-device buffers */
-	kfree(zram->compress_workmem);
-	free_pages((unsigned long)zram->compress_buffer, 1);
-
-	zram->compress_workmem = NULL;
-	zram->compress_buffer = NULL;
+	if (zram->comp)
+		zcomp_destroy(zram->comp);
+	zram->comp = NULL;
 
 	/* Free all pages that are still in this zram device */
 	for (index = 0; index < zram->disksize >> PAGE_SHIFT; index++) {
-		struct page *page;
-		u16 offset;
+		unsigned long handle = zram->table[index].handle;
 
-		page = zram->table[index].page;
-		offset = zram->table[index].offset;
+		if (!handle)
+			continue;
 
-		if (!page)
+		if (zram_test_flag(zram, index, ZRAM_SAME) ||
+		    zram_test_flag(zram, index, ZRAM_WB))
 			continue;
 
 		if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)))
-			__free_page(page);
-		else
-			xv_free(zram->mem_pool, page, offset);
+			__free_page(zram->table[index].page);
+		else if (zram_test_flag(zram, index, ZRAM_DEDUP)) {
+			struct zram_dedup_entry *entry;
+
+			entry = zram->table[index].entry;
+			if (zram_dedup_put(zram, entry)) {
+				zs_free(zram->mem_pool, entry->handle);
+				kfree(entry);
+			}
+		} else
+			zs_free(zram->mem_pool, handle);
 	}
 
 	vfree(zram->table);
 	zram->table = NULL;
 
-	xv_destroy_pool(zram->mem_pool);
+	/* The backing device stays attached, only its contents go */
+	zram_wb_reset_blocks(zram);
+
+	if (zram->mem_pool)
+		zs_destroy_pool(zram->mem_pool);
 	zram->mem_pool = NULL;
 
 	/* Reset stats */
@@ -673,6 +845,153 @@ void __zram_reset_device(struct zram *zram)
 	zram->disksize = 0;
 }
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+/*
+ * Mark every stored page idle. Any later read or write of a page
+ * clears the mark, so what is still marked at writeback time has not
+ * been touched since.
+ */
+void zram_mark_idle(struct zram *zram)
+{
+	size_t index;
+
+	down_read(&zram->init_lock);
+	if (!zram->init_done)
+		goto out;
+
+	down_write(&zram->lock);
+	for (index = 0; index < zram->disksize >> PAGE_SHIFT; index++) {
+		if (!zram->table[index].handle ||
+		    zram_test_flag(zram, index, ZRAM_SAME) ||
+		    zram_test_flag(zram, index, ZRAM_WB))
+			continue;
+		zram_set_flag(zram, index, ZRAM_IDLE);
+	}
+	up_write(&zram->lock);
+
+out:
+	up_read(&zram->init_lock);
+}
+
+static int zram_wb_eligible(struct zram *zram, u32 index, int mode)
+{
+	if (!zram->table[index].handle ||
+	    zram_test_flag(zram, index, ZRAM_SAME) ||
+	    zram_test_flag(zram, index, ZRAM_WB) ||
+	    zram_test_flag(zram, index, ZRAM_UNDER_WB))
+		return 0;
+
+	if (mode == ZRAM_WB_HUGE)
+		return zram_test_flag(zram, index, ZRAM_UNCOMPRESSED);
+	return zram_test_flag(zram, index, ZRAM_IDLE);
+}
+
+/*
+ * Write eligible pages to the backing device and free their memory.
+ * zram->lock is dropped during the write so that swap I/O does not
+ * stall behind the (slow) backing device. A page rewritten or freed in
+ * that window loses ZRAM_UNDER_WB and keeps its new contents.
+ */
+static void zram_writeback_work(struct work_struct *work)
+{
+	int ret, mode;
+	size_t index, nr_pages;
+	unsigned long blk_idx;
+	unsigned char *mem;
+	struct page *page;
+	struct zram *zram = container_of(work, struct zram, wb_work);
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		pr_err("Error allocating writeback page\n");
+		return;
+	}
+
+	down_read(&zram->init_lock);
+	if (!zram->init_done || !zram_wb_enabled(zram))
+		goto out;
+
+	mode = zram->wb_mode;
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		down_write(&zram->lock);
+		if (!zram_wb_eligible(zram, index, mode)) {
+			up_write(&zram->lock);
+			continue;
+		}
+
+		mem = kmap(page);
+		ret = zram_read_before_write(zram, mem, index);
+		kunmap(page);
+		if (ret) {
+			up_write(&zram->lock);
+			continue;
+		}
+		zram_set_flag(zram, index, ZRAM_UNDER_WB);
+		up_write(&zram->lock);
+
+		blk_idx = zram_wb_alloc_block(zram);
+		if (blk_idx)
+			ret = zram_wb_write_page(zram, blk_idx, page);
+
+		down_write(&zram->lock);
+		if (!blk_idx || ret ||
+		    !zram_test_flag(zram, index, ZRAM_UNDER_WB)) {
+			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+			up_write(&zram->lock);
+			if (!blk_idx) {
+				pr_info("Backing device is full\n");
+				break;
+			}
+			zram_wb_free_block(zram, blk_idx);
+			if (ret) {
+				pr_err("Backing device write failed! "
+					"err=%d, page=%zu\n", ret, index);
+				break;
+			}
+			continue;
+		}
+
+		zram_free_page(zram, index);
+		zram_set_flag(zram, index, ZRAM_WB);
+		zram->table[index].blk_idx = blk_idx;
+		zram_stat_inc(&zram->stats.bd_count);
+		up_write(&zram->lock);
+
+		zram_stat64_inc(zram, &zram->stats.bd_writes);
+		cond_resched();
+	}
+
+out:
+	up_read(&zram->init_lock);
+	__free_page(page);
+}
+
+/* Start writing pages selected by mode out in the background */
+int zram_writeback(struct zram *zram, int mode)
+{
+	int ret = 0;
+
+	down_read(&zram->init_lock);
+	if (!zram->init_done || !zram_wb_enabled(zram)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (work_pending(&zram->wb_work)) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	zram->wb_mode = mode;
+	queue_work(system_long_wq, &zram->wb_work);
+
+out:
+	up_read(&zram->init_lock);
+	return ret;
+}
+#endif
+
 void zram_reset_device(struct zram *zram)
 {
 	down_write(&zram->init_lock);
@@ -699,17 +1018,9 @@ int zram_init_device(struct zram *zram)
 	if (!zram->disksize)
 		zram_set_disksize(zram, zram_default_disksize_bytes());
 
-	zram->compress_workmem = kzalloc(WMSIZE, GFP_KERNEL);
-	if (!zram->compress_workmem) {
-		pr_err("Error allocating compressor working memory!\n");
-		ret = -ENOMEM;
-		goto fail_no_table;
-	}
-
-	zram->compress_buffer =
-		(void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO, 1);
-	if (!zram->compress_buffer) {
-		pr_err("Error allocating compressor buffer space\n");
+	zram->comp = zcomp_create(zram->compressor, max_comp_streams());
+	if (!zram->comp) {
+		pr_err("Error initializing %s compressor\n", zram->compressor);
 		ret = -ENOMEM;
 		goto fail_no_table;
 	}
@@ -740,12 +1051,13 @@ int zram_init_device(struct zram *zram)
 	/* zram devices sort of resembles non-rotational disks */
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, zram->disk->queue);
 
-	zram->mem_pool = xv_create_pool();
+	zram->mem_pool = zs_create_pool();
 	if (!zram->mem_pool) {
 		pr_err("Error creating memory pool\n");
 		ret = -ENOMEM;
 		goto fail;
 	}
+	zram_dedup_init(zram);
 
 	zram->init_done = 1;
 	up_write(&zram->init_lock);
@@ -785,6 +1097,10 @@ static int create_device(struct zram *zram, int device_id)
 	init_rwsem(&zram->lock);
 	init_rwsem(&zram->init_lock);
 	spin_lock_init(&zram->stat64_lock);
+#ifdef CONFIG_ZRAM_WRITEBACK
+	spin_lock_init(&zram->bitmap_lock);
+	INIT_WORK(&zram->wb_work, zram_writeback_work);
+#endif
 
 	zram->queue = blk_alloc_queue(GFP_KERNEL);
 	if (!zram->queue) {
@@ -816,6 +1132,8 @@ static int create_device(struct zram *zram, int device_id)
 
 	/* Actual capacity set using syfs (/sys/block/zram<id>/disksize */
 	zram_set_disksize(zram, 0);
+	strlcpy(zram->compressor, default_compressor,
+		sizeof(zram->compressor));
 
 	/*
 	 * To ensure that we always get PAGE_SIZE aligned
@@ -893,6 +1211,8 @@ static int __init zram_init(void)
 			goto free_devices;
 	}
 
+	zcomp_bench_init();
+
 	return 0;
 
 free_devices:
@@ -910,12 +1230,18 @@ static void __exit zram_exit(void)
 	int i;
 	struct zram *zram;
 
+	zcomp_bench_exit();
+
 	for (i = 0; i < zram_num_devices; i++) {
 		zram = &zram_devices[i];
 
 		destroy_device(zram);
+#ifdef CONFIG_ZRAM_WRITEBACK
+		cancel_work_sync(&zram->wb_work);
+#endif
 		if (zram->init_done)
 			zram_reset_device(zram);
+		zram_wb_put_backing_dev(zram);
 	}
 
 	unregister_blkdev(zram_major, "zram");
@@ -17,8 +17,11 @@
 
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
+#include <linux/rbtree.h>
+#include <linux/workqueue.h>
 
-#include "xvmalloc.h"
+#include "zsmalloc.h"
+#include "zcomp.h"
 
 /*
  * Some arbitrary value. This is just to catch
@@ -26,18 +29,6 @@
  */
 static const unsigned max_num_devices = 32;
 
-/*
- * Stored at beginning of each compressed object.
- *
- * It stores back-reference to table entry which points to this
- * object. This is required to support memory defragmentation.
- */
-struct zobj_header {
-#if 0
-	u32 table_idx;
-#endif
-};
-
 /*-- Configurable parameters */
 
 /* Default zram disk size: 25% of total RAM */
@@ -51,8 +42,8 @@ static const size_t max_zpage_size = PAGE_SIZE / 4 * 3;
 
 /*
  * NOTE: max_zpage_size must be less than or equal to:
- *   XV_MAX_ALLOC_SIZE - sizeof(struct zobj_header)
- * otherwise, xv_malloc() would always return failure.
+ *   ZS_MAX_ALLOC_SIZE
+ * otherwise, zs_malloc() would always return failure.
  */
 
 /*-- End of configurable params */
@@ -74,6 +65,21 @@ enum zram_pageflags {
 	/* Page consists entirely of zeros */
 	ZRAM_ZERO,
 
+	/* Page is one machine word repeated (table[].element) */
+	ZRAM_SAME,
+
+	/* Compressed object is shared (table[].entry) */
+	ZRAM_DEDUP,
+
+	/* Page lives on the backing device (table[].blk_idx) */
+	ZRAM_WB,
+
+	/* Page is being written to the backing device */
+	ZRAM_UNDER_WB,
+
+	/* Page not accessed since the last "idle" mark */
+	ZRAM_IDLE,
+
 	__NR_ZRAM_PAGEFLAGS,
 };
 
@@ -81,8 +87,14 @@ enum zram_pageflags {
 
 /* Allocated for each disk page */
 struct table {
-	struct page *page;
-	u16 offset;
+	union {
+		unsigned long handle;	/* zsmalloc object */
+		struct page *page;	/* ZRAM_UNCOMPRESSED pages */
+		unsigned long element;	/* ZRAM_SAME pages */
+		struct zram_dedup_entry *entry;	/* ZRAM_DEDUP pages */
+		unsigned long blk_idx;	/* ZRAM_WB pages */
+	};
+	u16 size;	/* object size (excluding header) */
 	u8 count;	/* object ref count (not yet used) */
 	u8 flags;
 } __attribute__((aligned(4)));
@@ -95,20 +107,25 @@ struct zram_stats {
 	u64 failed_writes;	/* can happen when memory is too low */
 	u64 invalid_io;		/* non-page-aligned I/O requests */
 	u64 notify_free;	/* no. of swap slot free notifications */
+	u64 dedup_hits;		/* writes that found an identical object */
+	u64 dup_data_size;	/* compressed bytes saved by dedup */
+	u64 bd_reads;		/* pages read from the backing device */
+	u64 bd_writes;		/* pages written to the backing device */
 	u32 pages_zero;		/* no. of zero filled pages */
+	u32 pages_same;		/* no. of non-zero same filled pages */
 	u32 pages_stored;	/* no. of pages currently stored */
 	u32 good_compress;	/* % of pages with compression ratio<=50% */
 	u32 pages_expand;	/* % of incompressible pages */
+	u32 bd_count;		/* no. of pages on the backing device */
 };
 
 struct zram {
-	struct xv_pool *mem_pool;
-	void *compress_workmem;
-	void *compress_buffer;
+	struct zs_pool *mem_pool;
+	struct zcomp *comp;
 	struct table *table;
 	spinlock_t stat64_lock;	/* protect 64-bit stats */
-	struct rw_semaphore lock; /* protect compression buffers and table
-				   * against concurrent read and writes */
+	struct rw_semaphore lock; /* protect table against concurrent
+				   * read and writes */
 	struct request_queue *queue;
 	struct gendisk *disk;
 	int init_done;
@@ -119,6 +136,22 @@ struct zram {
 	 * we can store in a disk.
 	 */
 	u64 disksize;	/* bytes */
+	char compressor[10];	/* backend name, see comp_algorithm in sysfs */
+
+	int use_dedup;		/* share identical compressed objects */
+	struct rb_root dedup_root;
+	spinlock_t dedup_lock;	/* protects dedup_root and entry refcounts */
+
+#ifdef CONFIG_ZRAM_WRITEBACK
+	struct file *backing_dev;	/* see backing_dev in sysfs */
+	struct block_device *bdev;
+	unsigned int old_block_size;
+	unsigned long nr_blocks;	/* backing device size in pages */
+	unsigned long *bitmap;		/* blocks in use on bdev */
+	spinlock_t bitmap_lock;
+	struct work_struct wb_work;
+	int wb_mode;			/* enum zram_wb_mode */
+#endif
 
 	struct zram_stats stats;
 };
@@ -131,5 +164,12 @@ extern struct attribute_group zram_disk_attr_group;
 
 extern int zram_init_device(struct zram *zram);
 extern void __zram_reset_device(struct zram *zram);
+#ifdef CONFIG_ZRAM_WRITEBACK
+extern void zram_mark_idle(struct zram *zram);
+extern int zram_writeback(struct zram *zram, int mode);
+#endif
+
+#include "zram_dedup.h"
+#include "zram_wb.h"
 
 #endif
@@ -0,0 +1,251 @@
+/*
+ * Compressed RAM block device - writeback to a backing device
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#define KMSG_COMPONENT "zram"
+#define pr_fmt(fmt) KMSG_COMPONENT ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/bio.h>
+#include <linux/bitops.h>
+#include <linux/blkdev.h>
+#include <linux/completion.h>
+#include <linux/fs.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+#include "zram_drv.h"
+
+#define ZRAM_WB_FMODE	(FMODE_READ | FMODE_WRITE | FMODE_EXCL)
+
+void zram_wb_put_backing_dev(struct zram *zram)
+{
+	if (!zram->bdev)
+		return;
+
+	set_blocksize(zram->bdev, zram->old_block_size);
+	blkdev_put(zram->bdev, ZRAM_WB_FMODE);
+	filp_close(zram->backing_dev, NULL);
+	vfree(zram->bitmap);
+
+	zram->bdev = NULL;
+	zram->backing_dev = NULL;
+	zram->bitmap = NULL;
+	zram->nr_blocks = 0;
+}
+
+/*
+ * Open the block device at path name and claim it exclusively. Called
+ * with init_lock held for write, before the device is initialized.
+ * Writing "none" only releases the current backing device.
+ */
+int zram_wb_set_backing_dev(struct zram *zram, const char *name)
+{
+	int ret;
+	char *file_name;
+	unsigned long nr_blocks, *bitmap = NULL;
+	unsigned int old_block_size;
+	struct file *backing_dev;
+	struct block_device *bdev = NULL;
+	struct inode *inode;
+
+	file_name = kstrndup(name, PATH_MAX, GFP_KERNEL);
+	if (!file_name)
+		return -ENOMEM;
+	/* ignore trailing newline */
+	strim(file_name);
+
+	/* A new device replaces the current one, even if it fails to open */
+	zram_wb_put_backing_dev(zram);
+	if (!strcmp(file_name, "none")) {
+		kfree(file_name);
+		return 0;
+	}
+
+	backing_dev = filp_open(file_name, O_RDWR | O_LARGEFILE, 0);
+	if (IS_ERR(backing_dev)) {
+		ret = PTR_ERR(backing_dev);
+		backing_dev = NULL;
+		goto out;
+	}
+
+	inode = backing_dev->f_mapping->host;
+	if (!S_ISBLK(inode->i_mode)) {
+		ret = -ENOTBLK;
+		goto out;
+	}
+
+	bdev = bdgrab(I_BDEV(inode));
+	ret = blkdev_get(bdev, ZRAM_WB_FMODE, zram);
+	if (ret < 0) {
+		/* blkdev_get() drops the reference on failure */
+		bdev = NULL;
+		goto out;
+	}
+
+	/* Block 0 is never handed out, see zram_wb_alloc_block() */
+	nr_blocks = i_size_read(inode) >> PAGE_SHIFT;
+	if (nr_blocks < 2) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	bitmap = vzalloc(BITS_TO_LONGS(nr_blocks) * sizeof(long));
+	if (!bitmap) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	old_block_size = block_size(bdev);
+	ret = set_blocksize(bdev, PAGE_SIZE);
+	if (ret)
+		goto out;
+
+	zram->backing_dev = backing_dev;
+	zram->bdev = bdev;
+	zram->old_block_size = old_block_size;
+	zram->bitmap = bitmap;
+	zram->nr_blocks = nr_blocks;
+
+	pr_info("setup backing device %s (%lu pages)\n", file_name,
+		nr_blocks);
+	kfree(file_name);
+	return 0;
+
+out:
+	vfree(bitmap);
+	if (bdev)
+		blkdev_put(bdev, ZRAM_WB_FMODE);
+	if (backing_dev)
+		filp_close(backing_dev, NULL);
+	kfree(file_name);
+	return ret;
+}
+
+/*
+ * Reserve a free block on the backing device. Returns 0 when it is
+ * full: block 0 is kept unused so that a written back table entry is
+ * never mistaken for an empty one.
+ */
+unsigned long zram_wb_alloc_block(struct zram *zram)
+{
+	unsigned long blk_idx;
+
+	spin_lock(&zram->bitmap_lock);
+	blk_idx = find_next_zero_bit(zram->bitmap, zram->nr_blocks, 1);
+	if (blk_idx < zram->nr_blocks)
+		__set_bit(blk_idx, zram->bitmap);
+	else
+		blk_idx = 0;
+	spin_unlock(&zram->bitmap_lock);
+
+	return blk_idx;
+}
+
+void zram_wb_free_block(struct zram *zram, unsigned long blk_idx)
+{
+	spin_lock(&zram->bitmap_lock);
+	WARN_ON_ONCE(!test_bit(blk_idx, zram->bitmap));
+	__clear_bit(blk_idx, zram->bitmap);
+	spin_unlock(&zram->bitmap_lock);
+}
+
+void zram_wb_reset_blocks(struct zram *zram)
+{
+	if (!zram->bitmap)
+		return;
+
+	spin_lock(&zram->bitmap_lock);
+	bitmap_zero(zram->bitmap, zram->nr_blocks);
+	spin_unlock(&zram->bitmap_lock);
+}
+
+static void zram_wb_end_io(struct bio *bio, int err)
+{
+	complete(bio->bi_private);
+}
+
+static int zram_wb_submit_page(struct zram *zram, unsigned long blk_idx,
+			       struct page *page, int rw)
+{
+	int ret = 0;
+	struct bio *bio;
+	DECLARE_COMPLETION_ONSTACK(done);
+
+	bio = bio_alloc(GFP_NOIO, 1);
+	if (!bio)
+		return -ENOMEM;
+
+	bio->bi_sector = (sector_t)blk_idx << SECTORS_PER_PAGE_SHIFT;
+	bio->bi_bdev = zram->bdev;
+	if (!bio_add_page(bio, page, PAGE_SIZE, 0)) {
+		bio_put(bio);
+		return -EIO;
+	}
+	bio->bi_end_io = zram_wb_end_io;
+	bio->bi_private = &done;
+
+	submit_bio(rw, bio);
+	wait_for_completion(&done);
+
+	if (!test_bit(BIO_UPTODATE, &bio->bi_flags))
+		ret = -EIO;
+	bio_put(bio);
+
+	return ret;
+}
+
+struct zram_wb_read_work {
+	struct work_struct work;
+	struct zram *zram;
+	unsigned long blk_idx;
+	struct page *page;
+	int ret;
+};
+
+static void zram_wb_read_fn(struct work_struct *work)
+{
+	struct zram_wb_read_work *rw;
+
+	rw = container_of(work, struct zram_wb_read_work, work);
+	rw->ret = zram_wb_submit_page(rw->zram, rw->blk_idx, rw->page,
+				      READ_SYNC);
+}
+
+/*
+ * Reads come from zram_make_request(), where bios submitted to another
+ * device are only queued until the current one returns: waiting for
+ * them there would never finish. Hand the read to a worker instead.
+ */
+int zram_wb_read_page(struct zram *zram, unsigned long blk_idx,
+		      struct page *page)
+{
+	struct zram_wb_read_work rw;
+
+	rw.zram = zram;
+	rw.blk_idx = blk_idx;
+	rw.page = page;
+
+	INIT_WORK_ONSTACK(&rw.work, zram_wb_read_fn);
+	queue_work(system_unbound_wq, &rw.work);
+	flush_work(&rw.work);
+	destroy_work_on_stack(&rw.work);
+
+	return rw.ret;
+}
+
+/* Called from the writeback worker only, never from the I/O path */
+int zram_wb_write_page(struct zram *zram, unsigned long blk_idx,
+		       struct page *page)
+{
+	return zram_wb_submit_page(zram, blk_idx, page, WRITE);
+}
@@ -0,0 +1,57 @@
+/*
+ * Compressed RAM block device - writeback to a backing device
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifndef _ZRAM_WB_H_
+#define _ZRAM_WB_H_
+
+#include <linux/errno.h>
+#include <linux/types.h>
+
+struct zram;
+struct page;
+
+/* What zram_writeback() writes out (writeback sysfs node) */
+enum zram_wb_mode {
+	ZRAM_WB_IDLE,		/* pages not accessed since last "idle" mark */
+	ZRAM_WB_HUGE,		/* incompressible pages */
+};
+
+#ifdef CONFIG_ZRAM_WRITEBACK
+extern int zram_wb_set_backing_dev(struct zram *zram, const char *name);
+extern void zram_wb_put_backing_dev(struct zram *zram);
+extern unsigned long zram_wb_alloc_block(struct zram *zram);
+extern void zram_wb_free_block(struct zram *zram, unsigned long blk_idx);
+extern void zram_wb_reset_blocks(struct zram *zram);
+extern int zram_wb_read_page(struct zram *zram, unsigned long blk_idx,
+			     struct page *page);
+extern int zram_wb_write_page(struct zram *zram, unsigned long blk_idx,
+			      struct page *page);
+
+static inline int zram_wb_enabled(struct zram *zram)
+{
+	return zram->bdev != NULL;
+}
+#else
+static inline void zram_wb_put_backing_dev(struct zram *zram) { }
+static inline void zram_wb_free_block(struct zram *zram,
+		unsigned long blk_idx) { }
+static inline void zram_wb_reset_blocks(struct zram *zram) { }
+static inline int zram_wb_read_page(struct zram *zram, unsigned long blk_idx,
+				    struct page *page)
+{
+	return -EIO;
+}
+static inline int zram_wb_enabled(struct zram *zram)
+{
+	return 0;
+}
+#endif
+
+#endif
@@ -0,0 +1,703 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * Copyright (C) 2011  Nitin Gupta
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+/*
+ * zsmalloc is a size-class based allocator for compressed pages.
+ *
+ * Objects of similar size (rounded up to ZS_SIZE_CLASS_DELTA) are
+ * packed into zspages, groups of 0-order pages, and may straddle a
+ * page boundary. Callers never see addresses: zs_malloc() returns an
+ * opaque handle that must be mapped with zs_map_object() before use.
+ * The handle indirection lets zs_compact() migrate objects out of
+ * sparsely used zspages and give the pages back to the buddy allocator.
+ */
+
+#ifdef CONFIG_ZRAM_DEBUG
+#define DEBUG
+#endif
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/bitops.h>
+#include <linux/bit_spinlock.h>
+#include <linux/errno.h>
+#include <linux/highmem.h>
+#include <linux/init.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#include "zsmalloc.h"
+#include "zsmalloc_int.h"
+
+static struct kmem_cache *zs_handle_cachep;
+static struct kmem_cache *zs_zspage_cachep;
+
+static int get_size_class_index(size_t size)
+{
+	int idx = 0;
+
+	if (likely(size > ZS_MIN_ALLOC_SIZE))
+		idx = DIV_ROUND_UP(size - ZS_MIN_ALLOC_SIZE,
+				ZS_SIZE_CLASS_DELTA);
+
+	return idx;
+}
+
+/*
+ * Pick the number of pages per zspage that wastes the least space
+ * for objects of the given size.
+ */
+static u32 get_pages_per_zspage(u32 class_size)
+{
+	u32 i, max_usedpc = 0;
+	u32 max_usedpc_order = 1;
+
+	for (i = 1; i <= ZS_MAX_PAGES_PER_ZSPAGE; i++) {
+		u32 zspage_size = i * PAGE_SIZE;
+		u32 waste = zspage_size % class_size;
+		u32 usedpc = (zspage_size - waste) * 100 / zspage_size;
+
+		if (usedpc > max_usedpc) {
+			max_usedpc = usedpc;
+			max_usedpc_order = i;
+		}
+	}
+
+	return max_usedpc_order;
+}
+
+static enum fullness_group get_fullness_group(struct zspage *zspage)
+{
+	int inuse = zspage->inuse;
+	int max_objs = zspage->class->objs_per_zspage;
+
+	if (inuse == 0)
+		return ZS_EMPTY;
+	if (inuse == max_objs)
+		return ZS_FULL;
+	if (inuse <= 3 * max_objs / 4)
+		return ZS_ALMOST_EMPTY;
+	return ZS_ALMOST_FULL;
+}
+
+static void insert_zspage(struct size_class *class, struct zspage *zspage)
+{
+	zspage->fullness = get_fullness_group(zspage);
+	if (zspage->fullness < ZS_NR_LISTED_GROUPS)
+		list_add(&zspage->list,
+			 &class->fullness_list[zspage->fullness]);
+	else
+		INIT_LIST_HEAD(&zspage->list);
+}
+
+static void remove_zspage(struct zspage *zspage)
+{
+	list_del_init(&zspage->list);
+}
+
+/* Move a zspage to the list matching its current usage */
+static void fix_fullness_group(struct size_class *class,
+			       struct zspage *zspage)
+{
+	if (get_fullness_group(zspage) == zspage->fullness)
+		return;
+
+	remove_zspage(zspage);
+	insert_zspage(class, zspage);
+}
+
+/* Encoded object location <PFN, obj_idx> */
+static unsigned long obj_location(struct zspage *zspage, int obj_idx)
+{
+	return (page_to_pfn(zspage->pages[0]) << OBJ_INDEX_BITS) |
+		(obj_idx & OBJ_INDEX_MASK);
+}
+
+static struct zspage *obj_to_zspage(unsigned long obj, int *obj_idx)
+{
+	struct page *page = pfn_to_page(obj >> OBJ_INDEX_BITS);
+
+	*obj_idx = obj & OBJ_INDEX_MASK;
+	return (struct zspage *)page_private(page);
+}
+
+static unsigned long handle_to_obj(unsigned long handle)
+{
+	return *(unsigned long *)handle >> OBJ_TAG_BITS;
+}
+
+/* Caller must own the handle (pinned or not yet published) */
+static void set_handle_obj(unsigned long handle, unsigned long obj)
+{
+	unsigned long *word = (unsigned long *)handle;
+
+	*word = (obj << OBJ_TAG_BITS) | (*word & BIT(HANDLE_PIN_BIT));
+}
+
+static void pin_handle(unsigned long handle)
+{
+	bit_spin_lock(HANDLE_PIN_BIT, (unsigned long *)handle);
+}
+
+static int trypin_handle(unsigned long handle)
+{
+	return bit_spin_trylock(HANDLE_PIN_BIT, (unsigned long *)handle);
+}
+
+static void unpin_handle(unsigned long handle)
+{
+	bit_spin_unlock(HANDLE_PIN_BIT, (unsigned long *)handle);
+}
+
+/*
+ * Headers are ZS_SIZE_CLASS_DELTA aligned, so they never straddle a
+ * page boundary and a single atomic mapping is enough to reach them.
+ */
+static unsigned long *map_obj_header(struct zspage *zspage, int obj_idx)
+{
+	unsigned long off = (unsigned long)obj_idx * zspage->class->size;
+	struct page *page = zspage->pages[off >> PAGE_SHIFT];
+
+	return kmap_atomic(page) + (off & ~PAGE_MASK);
+}
+
+static void unmap_obj_header(unsigned long *head)
+{
+	kunmap_atomic(head);
+}
+
+/*
+ * Copy the part of an object starting at obj_off to (to_obj == 0) or
+ * from (to_obj == 1) the linear buffer buf, which mirrors the whole
+ * object.
+ */
+static void zs_copy_obj(struct zspage *zspage, int obj_idx, int obj_off,
+			char *buf, int to_obj)
+{
+	unsigned long off = (unsigned long)obj_idx * zspage->class->size;
+	int len = zspage->class->size - obj_off;
+
+	off += obj_off;
+	buf += obj_off;
+
+	while (len) {
+		struct page *page = zspage->pages[off >> PAGE_SHIFT];
+		int pg_off = off & ~PAGE_MASK;
+		int chunk = min_t(int, len, PAGE_SIZE - pg_off);
+		char *addr = kmap_atomic(page);
+
+		if (to_obj)
+			memcpy(addr + pg_off, buf, chunk);
+		else
+			memcpy(buf, addr + pg_off, chunk);
+		kunmap_atomic(addr);
+
+		buf += chunk;
+		off += chunk;
+		len -= chunk;
+	}
+}
+
+static void free_zspage(struct zspage *zspage)
+{
+	int i;
+
+	for (i = 0; i < zspage->class->pages_per_zspage; i++) {
+		set_page_private(zspage->pages[i], 0);
+		__free_page(zspage->pages[i]);
+	}
+	kmem_cache_free(zs_zspage_cachep, zspage);
+}
+
+/*
+ * Allocate a zspage for the given class and thread all of its objects
+ * on the zspage free list.
+ */
+static struct zspage *alloc_zspage(struct size_class *class, gfp_t flags)
+{
+	int i;
+	struct zspage *zspage;
+
+	zspage = kmem_cache_zalloc(zs_zspage_cachep, flags & ~__GFP_HIGHMEM);
+	if (!zspage)
+		return NULL;
+
+	zspage->class = class;
+	for (i = 0; i < class->pages_per_zspage; i++) {
+		struct page *page = alloc_page(flags);
+
+		if (!page) {
+			while (i--)
+				__free_page(zspage->pages[i]);
+			kmem_cache_free(zs_zspage_cachep, zspage);
+			return NULL;
+		}
+		set_page_private(page, (unsigned long)zspage);
+		zspage->pages[i] = page;
+	}
+
+	for (i = 0; i < class->objs_per_zspage; i++) {
+		unsigned long *head = map_obj_header(zspage, i);
+
+		if (i + 1 < class->objs_per_zspage)
+			*head = (unsigned long)(i + 1) << OBJ_TAG_BITS;
+		else
+			*head = (unsigned long)ZS_NO_FREE_OBJ << OBJ_TAG_BITS;
+		unmap_obj_header(head);
+	}
+	zspage->freeobj = 0;
+	INIT_LIST_HEAD(&zspage->list);
+
+	return zspage;
+}
+
+/* Take the first free object off the zspage and tag it as owned */
+static unsigned long obj_malloc(struct size_class *class,
+				struct zspage *zspage, unsigned long handle)
+{
+	int obj_idx = zspage->freeobj;
+	unsigned long *head;
+
+	head = map_obj_header(zspage, obj_idx);
+	zspage->freeobj = (long)*head >> OBJ_TAG_BITS;
+	*head = handle | OBJ_ALLOCATED_TAG;
+	unmap_obj_header(head);
+
+	zspage->inuse++;
+	class->objs_used++;
+
+	return obj_location(zspage, obj_idx);
+}
+
+static void obj_free(struct size_class *class, struct zspage *zspage,
+		     int obj_idx)
+{
+	unsigned long *head;
+
+	head = map_obj_header(zspage, obj_idx);
+	*head = (unsigned long)zspage->freeobj << OBJ_TAG_BITS;
+	unmap_obj_header(head);
+
+	zspage->freeobj = obj_idx;
+	zspage->inuse--;
+	class->objs_used--;
+}
+
+static struct zspage *find_get_zspage(struct size_class *class)
+{
+	int i;
+
+	for (i = 0; i < ZS_NR_LISTED_GROUPS; i++) {
+		if (!list_empty(&class->fullness_list[i]))
+			return list_first_entry(&class->fullness_list[i],
+						struct zspage, list);
+	}
+
+	return NULL;
+}
+
+/**
+ * zs_malloc - Allocate block of given size from pool.
+ * @pool: pool to allocate from
+ * @size: size of block to allocate
+ * @flags: gfp flags used when the pool needs to grow
+ *
+ * On success, a non-zero handle identifying the object is returned.
+ * It has to be mapped with zs_map_object() to get at the data.
+ * On failure, 0 is returned.
+ *
+ * Allocation requests with size > ZS_MAX_ALLOC_SIZE will fail.
+ */
+unsigned long zs_malloc(struct zs_pool *pool, size_t size, gfp_t flags)
+{
+	unsigned long handle, obj;
+	struct size_class *class;
+	struct zspage *zspage;
+
+	if (unlikely(!size || size > ZS_MAX_ALLOC_SIZE))
+		return 0;
+
+	handle = (unsigned long)kmem_cache_alloc(zs_handle_cachep,
+						 flags & ~__GFP_HIGHMEM);
+	if (!handle)
+		return 0;
+	*(unsigned long *)handle = 0;
+
+	class = &pool->size_class[get_size_class_index(size + ZS_HANDLE_SIZE)];
+
+	spin_lock(&class->lock);
+	zspage = find_get_zspage(class);
+	if (!zspage) {
+		spin_unlock(&class->lock);
+		zspage = alloc_zspage(class, flags);
+		if (unlikely(!zspage)) {
+			kmem_cache_free(zs_handle_cachep, (void *)handle);
+			return 0;
+		}
+		spin_lock(&class->lock);
+		class->zspages++;
+		insert_zspage(class, zspage);
+	}
+
+	obj = obj_malloc(class, zspage, handle);
+	set_handle_obj(handle, obj);
+	fix_fullness_group(class, zspage);
+	spin_unlock(&class->lock);
+
+	return handle;
+}
+EXPORT_SYMBOL_GPL(zs_malloc);
+
+void zs_free(struct zs_pool *pool, unsigned long handle)
+{
+	int obj_idx;
+	struct size_class *class;
+	struct zspage *zspage;
+
+	if (unlikely(!handle))
+		return;
+
+	/* Pinning keeps compaction from moving the object under us */
+	pin_handle(handle);
+	zspage = obj_to_zspage(handle_to_obj(handle), &obj_idx);
+	class = zspage->class;
+
+	spin_lock(&class->lock);
+	obj_free(class, zspage, obj_idx);
+	fix_fullness_group(class, zspage);
+	if (zspage->fullness == ZS_EMPTY) {
+		class->zspages--;
+		free_zspage(zspage);
+	}
+	spin_unlock(&class->lock);
+	unpin_handle(handle);
+
+	kmem_cache_free(zs_handle_cachep, (void *)handle);
+}
+EXPORT_SYMBOL_GPL(zs_free);
+
+/**
+ * zs_map_object - get address of allocated object from handle.
+ * @pool: pool from which the object was allocated
+ * @handle: handle returned from zs_malloc
+ * @mm: mapping mode to use
+ *
+ * The object is pinned (cannot be migrated by compaction) until
+ * zs_unmap_object() is called. Like kmap_atomic(), the mapping must
+ * not be held across sleeping calls and only one object can be mapped
+ * per CPU at a time.
+ */
+void *zs_map_object(struct zs_pool *pool, unsigned long handle,
+			enum zs_mapmode mm)
+{
+	int obj_idx;
+	unsigned long off;
+	struct zspage *zspage;
+	struct mapping_area *area;
+
+	BUG_ON(!handle);
+
+	pin_handle(handle);
+	zspage = obj_to_zspage(handle_to_obj(handle), &obj_idx);
+	off = (unsigned long)obj_idx * zspage->class->size;
+
+	area = this_cpu_ptr(pool->area);
+	area->mm = mm;
+	if ((off & ~PAGE_MASK) + zspage->class->size <= PAGE_SIZE) {
+		/* Object fits in a single page: map it directly */
+		area->kaddr = kmap_atomic(zspage->pages[off >> PAGE_SHIFT]);
+		return area->kaddr + (off & ~PAGE_MASK) + ZS_HANDLE_SIZE;
+	}
+
+	area->kaddr = NULL;
+	if (mm != ZS_MM_WO)
+		zs_copy_obj(zspage, obj_idx, ZS_HANDLE_SIZE, area->buf, 0);
+
+	return area->buf + ZS_HANDLE_SIZE;
+}
+EXPORT_SYMBOL_GPL(zs_map_object);
+
+void zs_unmap_object(struct zs_pool *pool, unsigned long handle)
+{
+	int obj_idx;
+	struct zspage *zspage;
+	struct mapping_area *area;
+
+	area = this_cpu_ptr(pool->area);
+	if (area->kaddr) {
+		kunmap_atomic(area->kaddr);
+	} else if (area->mm != ZS_MM_RO) {
+		zspage = obj_to_zspage(handle_to_obj(handle), &obj_idx);
+		/* Skip the header: it is owned by the allocator */
+		zs_copy_obj(zspage, obj_idx, ZS_HANDLE_SIZE, area->buf, 1);
+	}
+	unpin_handle(handle);
+}
+EXPORT_SYMBOL_GPL(zs_unmap_object);
+
+/*
+ * Move every object of src into dst zspages of the same class.
+ * Returns 0 when src has been emptied, -EBUSY if an object is pinned
+ * (mapped or being freed) and -ENOSPC when no destination is left.
+ * Called with class->lock held.
+ */
+static int migrate_zspage(struct zs_pool *pool, struct size_class *class,
+			  struct zspage *src)
+{
+	int obj_idx;
+	char *buf = this_cpu_ptr(pool->area)->buf;
+
+	for (obj_idx = 0; obj_idx < class->objs_per_zspage && src->inuse;
+	     obj_idx++) {
+		struct zspage *dst;
+		unsigned long *head, handle, obj;
+
+		head = map_obj_header(src, obj_idx);
+		handle = *head;
+		unmap_obj_header(head);
+
+		if (!(handle & OBJ_ALLOCATED_TAG))
+			continue;
+		handle &= ~OBJ_ALLOCATED_TAG;
+
+		dst = find_get_zspage(class);
+		if (!dst)
+			return -ENOSPC;
+
+		if (!trypin_handle(handle))
+			return -EBUSY;
+
+		/* obj_malloc() writes the header, copy the payload only */
+		zs_copy_obj(src, obj_idx, ZS_HANDLE_SIZE, buf, 0);
+		obj = obj_malloc(class, dst, handle);
+		zs_copy_obj(dst, obj & OBJ_INDEX_MASK, ZS_HANDLE_SIZE, buf, 1);
+		fix_fullness_group(class, dst);
+
+		obj_free(class, src, obj_idx);
+		set_handle_obj(handle, obj);
+		unpin_handle(handle);
+	}
+
+	return 0;
+}
+
+static unsigned long zs_compact_class(struct zs_pool *pool,
+				      struct size_class *class)
+{
+	unsigned long freed = 0;
+	struct list_head *empty_list;
+	struct zspage *src;
+
+	spin_lock(&class->lock);
+	empty_list = &class->fullness_list[ZS_ALMOST_EMPTY];
+	while (!list_empty(empty_list)) {
+		int ret;
+
+		/* Drain the least recently filled sparse zspage */
+		src = list_entry(empty_list->prev, struct zspage, list);
+		remove_zspage(src);
+
+		ret = migrate_zspage(pool, class, src);
+		if (!src->inuse) {
+			class->zspages--;
+			free_zspage(src);
+			freed += class->pages_per_zspage;
+			continue;
+		}
+
+		insert_zspage(class, src);
+		if (ret)
+			break;
+	}
+	spin_unlock(&class->lock);
+
+	return freed;
+}
+
+/**
+ * zs_compact - release sparsely used zspages back to the system.
+ * @pool: pool to compact
+ *
+ * In every size class, objects are moved out of the emptiest zspages
+ * into partially used ones until no more zspages can be freed.
+ * Returns the number of pages released.
+ */
+unsigned long zs_compact(struct zs_pool *pool)
+{
+	int i;
+	unsigned long freed = 0;
+
+	mutex_lock(&pool->compact_lock);
+	for (i = ZS_NR_SIZE_CLASSES - 1; i >= 0; i--) {
+		freed += zs_compact_class(pool, &pool->size_class[i]);
+		cond_resched();
+	}
+	pool->pages_compacted += freed;
+	mutex_unlock(&pool->compact_lock);
+
+	return freed;
+}
+EXPORT_SYMBOL_GPL(zs_compact);
+
+u64 zs_get_total_size_bytes(struct zs_pool *pool)
+{
+	int i;
+	u64 npages = 0;
+
+	for (i = 0; i < ZS_NR_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+
+		spin_lock(&class->lock);
+		npages += class->zspages * class->pages_per_zspage;
+		spin_unlock(&class->lock);
+	}
+
+	return npages << PAGE_SHIFT;
+}
+EXPORT_SYMBOL_GPL(zs_get_total_size_bytes);
+
+void zs_get_pool_stats(struct zs_pool *pool, struct zs_pool_stats *stats)
+{
+	int i;
+
+	memset(stats, 0, sizeof(*stats));
+	for (i = 0; i < ZS_NR_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+
+		spin_lock(&class->lock);
+		stats->pages_allocated += class->zspages *
+					  class->pages_per_zspage;
+		stats->objs_allocated += class->zspages *
+					 class->objs_per_zspage;
+		stats->objs_used += class->objs_used;
+		stats->bytes_used += class->objs_used * class->size;
+		spin_unlock(&class->lock);
+	}
+
+	mutex_lock(&pool->compact_lock);
+	stats->pages_compacted = pool->pages_compacted;
+	mutex_unlock(&pool->compact_lock);
+}
+EXPORT_SYMBOL_GPL(zs_get_pool_stats);
+
+/*
+ * Create a memory pool. Allocates size classes and the per-cpu
+ * buffers used to access objects that straddle two pages.
+ */
+struct zs_pool *zs_create_pool(void)
+{
+	int i, cpu;
+	struct zs_pool *pool;
+
+	pool = vzalloc(sizeof(*pool));
+	if (!pool)
+		return NULL;
+
+	for (i = 0; i < ZS_NR_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+		int j;
+
+		spin_lock_init(&class->lock);
+		for (j = 0; j < ZS_NR_LISTED_GROUPS; j++)
+			INIT_LIST_HEAD(&class->fullness_list[j]);
+		class->index = i;
+		class->size = ZS_MIN_ALLOC_SIZE + i * ZS_SIZE_CLASS_DELTA;
+		class->pages_per_zspage = get_pages_per_zspage(class->size);
+		class->objs_per_zspage = class->pages_per_zspage *
+					 PAGE_SIZE / class->size;
+	}
+	mutex_init(&pool->compact_lock);
+
+	pool->area = alloc_percpu(struct mapping_area);
+	if (!pool->area)
+		goto fail;
+
+	for_each_possible_cpu(cpu) {
+		struct mapping_area *area = per_cpu_ptr(pool->area, cpu);
+
+		area->buf = (char *)__get_free_pages(GFP_KERNEL,
+					get_order(ZS_MAX_CLASS_SIZE));
+		if (!area->buf)
+			goto fail;
+	}
+
+	return pool;
+
+fail:
+	zs_destroy_pool(pool);
+	return NULL;
+}
+EXPORT_SYMBOL_GPL(zs_create_pool);
+
+void zs_destroy_pool(struct zs_pool *pool)
+{
+	int i, cpu;
+
+	for (i = 0; i < ZS_NR_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+		int j;
+
+		for (j = 0; j < ZS_NR_LISTED_GROUPS; j++) {
+			if (!list_empty(&class->fullness_list[j]))
+				pr_info("zsmalloc: freeing non-empty class "
+					"(size=%u)\n", class->size);
+		}
+	}
+
+	if (pool->area) {
+		for_each_possible_cpu(cpu) {
+			struct mapping_area *area;
+
+			area = per_cpu_ptr(pool->area, cpu);
+			if (area->buf)
+				free_pages((unsigned long)area->buf,
+					   get_order(ZS_MAX_CLASS_SIZE));
+		}
+		free_percpu(pool->area);
+	}
+	vfree(pool);
+}
+EXPORT_SYMBOL_GPL(zs_destroy_pool);
+
+static int __init zs_init(void)
+{
+	BUILD_BUG_ON(ZS_MAX_OBJS_PER_ZSPAGE > OBJ_INDEX_MASK);
+	BUILD_BUG_ON(ZS_MIN_ALLOC_SIZE <= ZS_HANDLE_SIZE);
+
+	zs_handle_cachep = kmem_cache_create("zs_handle", ZS_HANDLE_SIZE,
+					     0, 0, NULL);
+	zs_zspage_cachep = kmem_cache_create("zspage", sizeof(struct zspage),
+					     0, 0, NULL);
+	if (!zs_handle_cachep || !zs_zspage_cachep) {
+		if (zs_handle_cachep)
+			kmem_cache_destroy(zs_handle_cachep);
+		if (zs_zspage_cachep)
+			kmem_cache_destroy(zs_zspage_cachep);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void __exit zs_exit(void)
+{
+	kmem_cache_destroy(zs_handle_cachep);
+	kmem_cache_destroy(zs_zspage_cachep);
+}
+
+module_init(zs_init);
+module_exit(zs_exit);
@@ -0,0 +1,126 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * Copyright (C) 2011  Nitin Gupta
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifndef _ZS_MALLOC_INT_H_
+#define _ZS_MALLOC_INT_H_
+
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/types.h>
+
+/*
+ * Every object starts with a header word. For an allocated object it
+ * is a back-reference to the handle pointing at it (tagged with
+ * OBJ_ALLOCATED_TAG), which is what lets compaction move objects and
+ * fix up their owner. For a free object it links to the next free
+ * slot in the same zspage.
+ */
+#define ZS_HANDLE_SIZE		(sizeof(unsigned long))
+
+/* User configurable params */
+
+/* Largest object a caller can ask for */
+#define ZS_MAX_ALLOC_SIZE	PAGE_SIZE
+
+/*
+ * A zspage is a group of up to ZS_MAX_PAGES_PER_ZSPAGE 0-order pages.
+ * Objects may straddle a page boundary inside a zspage, which is what
+ * keeps the waste low for sizes that do not divide PAGE_SIZE.
+ */
+#define ZS_MAX_PAGES_PER_ZSPAGE	4
+
+/* Must be greater than ZS_HANDLE_SIZE and a multiple of ZS_SIZE_CLASS_DELTA */
+#define ZS_MIN_ALLOC_SIZE	32
+
+/*
+ * Size classes are ZS_SIZE_CLASS_DELTA apart. With 16 bytes the
+ * header word of an object never crosses a page boundary.
+ */
+#define ZS_SIZE_CLASS_DELTA	16
+
+/* End of user params */
+
+#define ZS_MAX_CLASS_SIZE	ALIGN(ZS_MAX_ALLOC_SIZE + ZS_HANDLE_SIZE, \
+					ZS_SIZE_CLASS_DELTA)
+#define ZS_NR_SIZE_CLASSES	((ZS_MAX_CLASS_SIZE - ZS_MIN_ALLOC_SIZE) / \
+					ZS_SIZE_CLASS_DELTA + 1)
+
+#define ZS_MAX_OBJS_PER_ZSPAGE	(ZS_MAX_PAGES_PER_ZSPAGE * PAGE_SIZE / \
+					ZS_MIN_ALLOC_SIZE)
+
+/*
+ * Object location: <PFN of first zspage page, object index>, kept in
+ * the handle word shifted past the pin bit.
+ */
+#define OBJ_INDEX_BITS		10
+#define OBJ_INDEX_MASK		((1UL << OBJ_INDEX_BITS) - 1)
+#define OBJ_TAG_BITS		1
+#define OBJ_ALLOCATED_TAG	1UL
+#define HANDLE_PIN_BIT		0
+
+/* Free list terminator stored in zspage->freeobj */
+#define ZS_NO_FREE_OBJ		(-1)
+
+/*
+ * Fullness groups: zspages are kept on per-class lists according to
+ * their usage so that allocation can fill up busy zspages first and
+ * compaction can drain the emptiest ones.
+ */
+enum fullness_group {
+	ZS_ALMOST_FULL,		/* more than 3/4 of the slots used */
+	ZS_ALMOST_EMPTY,	/* at most 3/4 of the slots used */
+	ZS_FULL,
+	ZS_EMPTY,		/* transient: freed right away */
+	_ZS_NR_FULLNESS_GROUPS,
+};
+
+#define ZS_NR_LISTED_GROUPS	ZS_FULL
+
+struct size_class {
+	spinlock_t lock;
+	struct list_head fullness_list[ZS_NR_LISTED_GROUPS];
+	u32 size;		/* object size, including the header word */
+	u32 index;
+	u32 pages_per_zspage;
+	u32 objs_per_zspage;
+
+	/* stats, protected by lock */
+	u64 zspages;
+	u64 objs_used;
+};
+
+struct zspage {
+	struct list_head list;	/* fullness list of the class */
+	struct size_class *class;
+	enum fullness_group fullness;
+	int inuse;
+	int freeobj;		/* index of first free object */
+	struct page *pages[ZS_MAX_PAGES_PER_ZSPAGE];
+};
+
+/* Per-cpu buffer used to access objects that straddle two pages */
+struct mapping_area {
+	char *buf;
+	void *kaddr;		/* set when the object lies in one page */
+	enum zs_mapmode mm;
+};
+
+struct zs_pool {
+	struct size_class size_class[ZS_NR_SIZE_CLASSES];
+	struct mapping_area __percpu *area;
+	u64 pages_compacted;	/* protected by compact_lock */
+	struct mutex compact_lock;
+};
+
+#endif
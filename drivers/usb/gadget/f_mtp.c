@@ -28,6 +28,7 @@
 
 #include <linux/types.h>
 #include <linux/file.h>
+#include <linux/pagemap.h>
 #include <linux/device.h>
 #include <linux/miscdevice.h>
 
@@ -37,6 +38,7 @@
 #include <linux/usb/f_mtp.h>
 
 #define MTP_BULK_BUFFER_SIZE       16384
+#define MTP_TX_BUFFER_SIZE         32768
 #define INTR_BUFFER_SIZE           28
 
 /* String IDs */
@@ -50,7 +52,7 @@
 #define STATE_ERROR                 4   /* error from completion routine */
 
 /* number of tx and rx requests to allocate */
-#define TX_REQ_MAX 4
+#define MTP_TX_REQ_MAX 8
 #define RX_REQ_MAX 2
 #define INTR_REQ_MAX 5
 
@@ -429,8 +431,8 @@ static int mtp_create_bulk_endpoints(struct mtp_dev *dev,
 	dev->ep_intr = ep;
 
 	/* now allocate requests for our endpoints */
-	for (i = 0; i < TX_REQ_MAX; i++) {
-		req = mtp_request_new(dev->ep_in, MTP_BULK_BUFFER_SIZE);
+	for (i = 0; i < MTP_TX_REQ_MAX; i++) {
+		req = mtp_request_new(dev->ep_in, MTP_TX_BUFFER_SIZE);
 		if (!req)
 			goto fail;
 		req->complete = mtp_complete_in;
@@ -639,6 +641,7 @@ static void send_file_work(struct work_struct *data) {
 	int xfer, ret, hdr_size;
 	int r = 0;
 	int sendZLP = 0;
+	unsigned long ra_pages;
 
 	/* read our parameters */
 	smp_rmb();
@@ -648,6 +651,13 @@ static void send_file_work(struct work_struct *data) {
 
 	DBG(cdev, "send_file_work(%lld %lld)\n", offset, count);
 
+	/* keep readahead ahead of all the requests we can have queued */
+	ra_pages = (MTP_TX_REQ_MAX * MTP_TX_BUFFER_SIZE) >> PAGE_CACHE_SHIFT;
+	spin_lock(&filp->f_lock);
+	if (filp->f_ra.ra_pages < ra_pages)
+		filp->f_ra.ra_pages = ra_pages;
+	spin_unlock(&filp->f_lock);
+
 	if (dev->xfer_send_header) {
 		hdr_size = sizeof(struct mtp_data_header);
 		count += hdr_size;
@@ -681,8 +691,8 @@ static void send_file_work(struct work_struct *data) {
 			break;
 		}
 
-		if (count > MTP_BULK_BUFFER_SIZE)
-			xfer = MTP_BULK_BUFFER_SIZE;
+		if (count > MTP_TX_BUFFER_SIZE)
+			xfer = MTP_TX_BUFFER_SIZE;
 		else
 			xfer = count;
 
@@ -588,10 +588,14 @@ static int rndis_init_response(int configNr, rndis_init_msg_type *buf)
 	rndis_init_cmplt_type *resp;
 	rndis_resp_t *r;
 	struct rndis_params *params = rndis_per_dev_params + configNr;
+	u32 max_pkts = 1;
 
 	if (!params->dev)
 		return -ENOTSUPP;
 
+	if (params->port && params->port->ul_max_pkts_per_xfer > 1)
+		max_pkts = params->port->ul_max_pkts_per_xfer;
+
 	r = rndis_add_response(configNr, sizeof(rndis_init_cmplt_type));
 	if (!r)
 		return -ENOMEM;
@@ -605,16 +609,21 @@ static int rndis_init_response(int configNr, rndis_init_msg_type *buf)
 	resp->MinorVersion = cpu_to_le32(RNDIS_MINOR_VERSION);
 	resp->DeviceFlags = cpu_to_le32(RNDIS_DF_CONNECTIONLESS);
 	resp->Medium = cpu_to_le32(RNDIS_MEDIUM_802_3);
-	resp->MaxPacketsPerTransfer = cpu_to_le32(1);
-	resp->MaxTransferSize = cpu_to_le32(
+	resp->MaxPacketsPerTransfer = cpu_to_le32(max_pkts);
+	resp->MaxTransferSize = cpu_to_le32(max_pkts * (
 		  params->dev->mtu
 		+ sizeof(struct ethhdr)
 		+ sizeof(struct rndis_packet_msg_type)
-		+ 22);
+		+ 22));
 	resp->PacketAlignmentFactor = cpu_to_le32(0);
 	resp->AFListOffset = cpu_to_le32(0);
 	resp->AFListSize = cpu_to_le32(0);
 
+	/* the host's limit for what we send it in one transfer */
+	if (params->port)
+		params->port->dl_max_xfer_size =
+			get_unaligned_le32(&buf->MaxTransferSize);
+
 	params->resp_avail(params->v);
 	return 0;
 }
@@ -799,6 +808,8 @@ void rndis_uninit(int configNr)
 	if (configNr >= RNDIS_MAX_CONFIGS)
 		return;
 	rndis_per_dev_params[configNr].state = RNDIS_UNINITIALIZED;
+	if (rndis_per_dev_params[configNr].port)
+		rndis_per_dev_params[configNr].port->dl_max_xfer_size = 0;
 
 	/* drain the response queue */
 	while ((buf = rndis_get_next_response(configNr, &length)))
@@ -937,6 +948,7 @@ void rndis_deregister(int configNr)
 
 	if (configNr >= RNDIS_MAX_CONFIGS) return;
 	rndis_per_dev_params[configNr].used = 0;
+	rndis_per_dev_params[configNr].port = NULL;
 }
 
 int rndis_set_param_dev(u8 configNr, struct net_device *dev, u16 *cdc_filter)
@@ -952,6 +964,16 @@ int rndis_set_param_dev(u8 configNr, struct net_device *dev, u16 *cdc_filter)
 	return 0;
 }
 
+int rndis_set_param_port(u8 configNr, struct gether *port)
+{
+	pr_debug("%s:\n", __func__);
+	if (configNr >= RNDIS_MAX_CONFIGS) return -1;
+
+	rndis_per_dev_params[configNr].port = port;
+
+	return 0;
+}
+
 int rndis_set_param_vendor(u8 configNr, u32 vendorID, const char *vendorDescr)
 {
 	pr_debug("%s:\n", __func__);
@@ -1043,30 +1065,64 @@ static rndis_resp_t *rndis_add_response(int configNr, u32 length)
 	return r;
 }
 
+/*
+ * One transfer may carry several packet messages (up to the
+ * MaxPacketsPerTransfer we announced). All but the last are cloned
+ * out of the transfer; whatever follows the last one is padding.
+ */
 int rndis_rm_hdr(struct gether *port,
 			struct sk_buff *skb,
 			struct sk_buff_head *list)
 {
-	/* tmp points to a struct rndis_packet_msg_type */
-	__le32 *tmp = (void *)skb->data;
+	struct sk_buff *skb2;
+	u32 msg_len, data_offset, data_len;
+	int num = 0;
 
-	/* MessageType, MessageLength */
-	if (cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
-			!= get_unaligned(tmp++)) {
-		dev_kfree_skb_any(skb);
-		return -EINVAL;
-	}
-	tmp++;
+	while (skb->len >= sizeof(struct rndis_packet_msg_type)) {
+		/* tmp points to a struct rndis_packet_msg_type */
+		__le32 *tmp = (void *)skb->data;
+
+		/* MessageType, MessageLength */
+		if (cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
+				!= get_unaligned(tmp++))
+			break;
+		msg_len = get_unaligned_le32(tmp++);
+
+		/* DataOffset, DataLength */
+		data_offset = get_unaligned_le32(tmp++) + 8;
+		data_len = get_unaligned_le32(tmp++);
+
+		/* last message: the transfer skb itself carries it */
+		if (msg_len == 0 || msg_len >= skb->len) {
+			if (!skb_pull(skb, data_offset)) {
+				dev_kfree_skb_any(skb);
+				return -EOVERFLOW;
+			}
+			skb_trim(skb, data_len);
+			skb_queue_tail(list, skb);
+			return 0;
+		}
+
+		if (data_offset + data_len > msg_len) {
+			dev_kfree_skb_any(skb);
+			return -EOVERFLOW;
+		}
 
-	/* DataOffset, DataLength */
-	if (!skb_pull(skb, get_unaligned_le32(tmp++) + 8)) {
-		dev_kfree_skb_any(skb);
-		return -EOVERFLOW;
+		skb2 = skb_clone(skb, GFP_ATOMIC);
+		if (!skb2) {
+			dev_kfree_skb_any(skb);
+			return -ENOMEM;
+		}
+		skb_pull(skb2, data_offset);
+		skb_trim(skb2, data_len);
+		skb_queue_tail(list, skb2);
+
+		skb_pull(skb, msg_len);
+		num++;
 	}
-	skb_trim(skb, get_unaligned_le32(tmp++));
 
-	skb_queue_tail(list, skb);
-	return 0;
+	dev_kfree_skb_any(skb);
+	return num ? 0 : -EINVAL;
 }
 
 #ifdef CONFIG_USB_GADGET_DEBUG_FILES
@@ -113,6 +113,7 @@ struct s3c_request {
 	struct usb_request req;
 	struct list_head queue;
 	unsigned char mapped;
+	u32 dma_len;		/* length of the DMA transfer in progress */
 };
 
 struct s3c_udc {
@@ -459,7 +459,7 @@ static void done(struct s3c_ep *ep, struct s3c_request *req, int status)
 		status = req->req.status;
 
 	if (req->mapped) {
-		dma_unmap_single(dev, req->req.dma, req->req.length,
+		dma_unmap_single(dev, req->req.dma, req->dma_len,
 				(ep->bEndpointAddress & USB_DIR_IN) ?
 				DMA_TO_DEVICE : DMA_FROM_DEVICE);
 		req->req.dma = DMA_ADDR_INVALID;
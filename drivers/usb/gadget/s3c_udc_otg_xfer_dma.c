@@ -92,6 +92,26 @@ static inline void s3c_udc_pre_setup(void)
 	writel(ep_ctrl|DEPCTL_EPENA|DEPCTL_CNAK, S3C_UDC_OTG_DOEPCTL(EP0_CON));
 }
 
+/*
+ * Largest transfer one DMA programming of EP1-15 takes. Longer requests
+ * are sent as several transfers, restarted from the completion interrupt.
+ */
+static inline u32 s3c_udc_dma_max(struct s3c_ep *ep)
+{
+	return min_t(u32, DEPTSIZ_XFER_SIZE_MASK,
+		     DEPTSIZ_PKT_CNT_MAX * ep->ep.maxpacket);
+}
+
+/* Unmap the finished part of a request before mapping the next one */
+static inline void s3c_udc_dma_unmap(struct s3c_ep *ep, struct s3c_request *req)
+{
+	struct device *dev = &the_controller->dev->dev;
+
+	dma_unmap_single(dev, req->req.dma, req->dma_len,
+			ep_is_in(ep) ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
+	req->mapped = 0;
+}
+
 static int setdma_rx(struct s3c_ep *ep, struct s3c_request *req)
 {
 	u32 *buf, ctrl;
@@ -103,8 +123,12 @@ static int setdma_rx(struct s3c_ep *ep, struct s3c_request *req)
 	prefetchw(buf);
 
 	length = req->req.length - req->req.actual;
+	if (ep_num != EP0_CON)
+		length = min(length, s3c_udc_dma_max(ep));
+
 	req->req.dma = dma_map_single(dev, buf,
 			length, DMA_FROM_DEVICE);
+	req->dma_len = length;
 	req->mapped = 1;
 
 	if (length == 0)
@@ -142,10 +166,13 @@ static int setdma_tx(struct s3c_ep *ep, struct s3c_request *req)
 
 	if (ep_num == EP0_CON)
 		length = min(length, (u32)ep_maxpacket(ep));
+	else
+		length = min(length, s3c_udc_dma_max(ep));
 
 	req->req.actual += length;
 	req->req.dma = dma_map_single(dev, buf,
 			length, DMA_TO_DEVICE);
+	req->dma_len = length;
 	req->mapped = 1;
 
 	if (length == 0)
@@ -198,19 +225,19 @@ static void complete_rx(struct s3c_udc *dev, u8 ep_num)
 		xfer_size = (ep_tsr & 0x7f);
 
 	else
-		xfer_size = (ep_tsr & 0x7fff);
+		xfer_size = (ep_tsr & DEPTSIZ_XFER_SIZE_MASK);
 
 	__dma_single_cpu_to_dev(req->req.buf, req->req.length, DMA_FROM_DEVICE);
-	xfer_length = req->req.length - xfer_size;
+	xfer_length = req->dma_len - xfer_size;
 	req->req.actual += min(xfer_length, req->req.length - req->req.actual);
-	is_short = (xfer_length < ep->ep.maxpacket);
+	is_short = (xfer_length < req->dma_len);
 
 	DEBUG_OUT_EP("%s: RX DMA done : ep = %d, rx bytes = %d/%d, "
 		"is_short = %d, DOEPTSIZ = 0x%x, remained bytes = %d\n",
 		__func__, ep_num, req->req.actual, req->req.length,
 		is_short, ep_tsr, xfer_size);
 
-	if (is_short || req->req.actual == xfer_length) {
+	if (is_short || req->req.actual == req->req.length) {
 		if (ep_num == EP0_CON && dev->ep0state == DATA_STATE_RECV) {
 			DEBUG_OUT_EP("	=> Send ZLP\n");
 			dev->ep0state = WAIT_FOR_SETUP;
@@ -225,6 +252,10 @@ static void complete_rx(struct s3c_udc *dev, u8 ep_num)
 				setdma_rx(ep, req);
 			}
 		}
+	} else if (ep_num != EP0_CON) {
+		/* request longer than one DMA transfer */
+		s3c_udc_dma_unmap(ep, req);
+		setdma_rx(ep, req);
 	}
 }
 
@@ -261,11 +292,11 @@ static void complete_tx(struct s3c_udc *dev, u8 ep_num)
 	if (ep_num == EP0_CON)
 		xfer_size = (ep_tsr & 0x7f);
 	else
-		xfer_size = (ep_tsr & 0x7fff);
+		xfer_size = (ep_tsr & DEPTSIZ_XFER_SIZE_MASK);
 
-	req->req.actual = req->req.length - xfer_size;
-	xfer_length = req->req.length - xfer_size;
-	req->req.actual += min(xfer_length, req->req.length - req->req.actual);
+	/* setdma_tx() counted the whole transfer as sent already */
+	req->req.actual -= min(xfer_size, req->dma_len);
+	xfer_length = req->dma_len - xfer_size;
 	is_short = (xfer_length < ep->ep.maxpacket);
 
 	DEBUG_IN_EP("%s: TX DMA done : ep = %d, tx bytes = %d/%d, "
@@ -281,6 +312,10 @@ static void complete_tx(struct s3c_udc *dev, u8 ep_num)
 			DEBUG_IN_EP("%s: Next Tx request start...\n", __func__);
 			setdma_tx(ep, req);
 		}
+	} else if (ep_num != EP0_CON) {
+		/* request longer than one DMA transfer */
+		s3c_udc_dma_unmap(ep, req);
+		setdma_tx(ep, req);
 	}
 }
 static inline void s3c_udc_check_tx_queue(struct s3c_udc *dev, u8 ep_num)
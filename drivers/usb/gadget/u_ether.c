@@ -84,6 +84,13 @@ struct eth_dev {
 
 	bool			zlp;
 	u8			host_mac[ETH_ALEN];
+
+	/* frames gathered for the next multi-packet IN transfer */
+	struct sk_buff		*tx_agg;
+
+	/* transfers and the frames they carried, for ethtool -S */
+	unsigned long		tx_xfers, tx_xfer_frames;
+	unsigned long		rx_xfers, rx_xfer_frames;
 };
 
 /*-------------------------------------------------------------------------*/
@@ -92,6 +99,12 @@ struct eth_dev {
 
 #define DEFAULT_QLEN	2	/* double buffering by default */
 
+/* Multi-packet IN transfers are built in one skb of at most two pages;
+ * its cb holds the number of frames in it.
+ */
+#define TX_AGG_MAX	SKB_MAX_ORDER(0, 1)
+#define TX_AGG_FRAMES(skb)	(*(unsigned *)(skb)->cb)
+
 
 #ifdef CONFIG_USB_GADGET_DUALSPEED
 
@@ -186,9 +199,46 @@ static void eth_get_drvinfo(struct net_device *net, struct ethtool_drvinfo *p)
  *   - ... probably more ethtool ops
  */
 
+static const char eth_stat_strings[][ETH_GSTRING_LEN] = {
+	"tx_xfers",
+	"tx_xfer_frames",
+	"rx_xfers",
+	"rx_xfer_frames",
+};
+
+static int eth_get_sset_count(struct net_device *net, int sset)
+{
+	switch (sset) {
+	case ETH_SS_STATS:
+		return ARRAY_SIZE(eth_stat_strings);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static void eth_get_strings(struct net_device *net, u32 sset, u8 *data)
+{
+	if (sset == ETH_SS_STATS)
+		memcpy(data, eth_stat_strings, sizeof(eth_stat_strings));
+}
+
+static void eth_get_ethtool_stats(struct net_device *net,
+		struct ethtool_stats *stats, u64 *data)
+{
+	struct eth_dev	*dev = netdev_priv(net);
+
+	data[0] = dev->tx_xfers;
+	data[1] = dev->tx_xfer_frames;
+	data[2] = dev->rx_xfers;
+	data[3] = dev->rx_xfer_frames;
+}
+
 static const struct ethtool_ops ops = {
 	.get_drvinfo = eth_get_drvinfo,
 	.get_link = ethtool_op_get_link,
+	.get_sset_count = eth_get_sset_count,
+	.get_strings = eth_get_strings,
+	.get_ethtool_stats = eth_get_ethtool_stats,
 };
 
 static void defer_kevent(struct eth_dev *dev, int flag)
@@ -237,6 +287,8 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	 */
 	size += sizeof(struct ethhdr) + dev->net->mtu + RX_EXTRA;
 	size += dev->port_usb->header_len;
+	if (dev->port_usb->ul_max_pkts_per_xfer > 1)
+		size *= dev->port_usb->ul_max_pkts_per_xfer;
 	size += out->maxpacket - 1;
 	size -= size % out->maxpacket;
 
@@ -288,6 +340,7 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 	/* normal completion */
 	case 0:
 		skb_put(skb, req->actual);
+		dev->rx_xfers++;
 
 		if (dev->unwrap) {
 			unsigned long	flags;
@@ -319,6 +372,7 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 				goto next_frame;
 			}
 			skb2->protocol = eth_type_trans(skb2, dev->net);
+			dev->rx_xfer_frames++;
 			dev->net->stats.rx_packets++;
 			dev->net->stats.rx_bytes += skb2->len;
 
@@ -478,6 +532,8 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 		break;
 	case 0:
 		dev->net->stats.tx_bytes += skb->len;
+		dev->tx_xfers++;
+		dev->tx_xfer_frames++;
 	}
 	dev->net->stats.tx_packets++;
 
@@ -494,6 +550,163 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 		netif_wake_queue(dev->net);
 }
 
+static void tx_agg_complete(struct usb_ep *ep, struct usb_request *req);
+
+/* Queue the frames gathered in tx_agg; called with req_lock held */
+static int tx_agg_flush(struct eth_dev *dev, struct usb_ep *in)
+{
+	struct sk_buff		*skb = dev->tx_agg;
+	struct usb_request	*req;
+	int			length = skb->len;
+	int			retval;
+
+	/* all requests are in flight: the next completion sends it */
+	if (list_empty(&dev->tx_reqs))
+		return -EBUSY;
+
+	req = container_of(dev->tx_reqs.next, struct usb_request, list);
+	list_del(&req->list);
+	dev->tx_agg = NULL;
+
+	req->buf = skb->data;
+	req->context = skb;
+	req->complete = tx_agg_complete;
+	req->no_interrupt = 0;
+
+	/* same framing as a single frame; TX_AGG_MAX keeps a spare byte */
+	req->zero = 1;
+	if (!dev->zlp && (length % in->maxpacket) == 0)
+		length++;
+	req->length = length;
+
+	retval = usb_ep_queue(in, req, GFP_ATOMIC);
+	if (retval) {
+		DBG(dev, "tx queue err %d\n", retval);
+		dev->net->stats.tx_dropped += TX_AGG_FRAMES(skb);
+		dev_kfree_skb_any(skb);
+		list_add(&req->list, &dev->tx_reqs);
+		return retval;
+	}
+
+	dev->net->trans_start = jiffies;
+	atomic_inc(&dev->tx_qlen);
+	if (list_empty(&dev->tx_reqs))
+		netif_stop_queue(dev->net);
+	return 0;
+}
+
+/* Forget frames still waiting for a transfer; called with req_lock held */
+static void tx_agg_drop(struct eth_dev *dev)
+{
+	if (dev->tx_agg) {
+		dev->net->stats.tx_dropped += TX_AGG_FRAMES(dev->tx_agg);
+		dev_kfree_skb_any(dev->tx_agg);
+		dev->tx_agg = NULL;
+	}
+}
+
+static void tx_agg_complete(struct usb_ep *ep, struct usb_request *req)
+{
+	struct sk_buff	*skb = req->context;
+	struct eth_dev	*dev = ep->driver_data;
+	int		status = req->status;
+
+	switch (status) {
+	default:
+		dev->net->stats.tx_errors++;
+		VDBG(dev, "tx err %d\n", status);
+		/* FALLTHROUGH */
+	case -ECONNRESET:		/* unlink */
+	case -ESHUTDOWN:		/* disconnect etc */
+		break;
+	case 0:
+		dev->net->stats.tx_bytes += skb->len;
+		dev->tx_xfers++;
+		dev->tx_xfer_frames += TX_AGG_FRAMES(skb);
+	}
+	dev->net->stats.tx_packets += TX_AGG_FRAMES(skb);
+	dev_kfree_skb_any(skb);
+
+	spin_lock(&dev->req_lock);
+	list_add(&req->list, &dev->tx_reqs);
+	atomic_dec(&dev->tx_qlen);
+
+	/* send what was gathered while this transfer was busy */
+	if (dev->tx_agg && status != -ECONNRESET && status != -ESHUTDOWN)
+		tx_agg_flush(dev, ep);
+	spin_unlock(&dev->req_lock);
+
+	if (netif_carrier_ok(dev->net))
+		netif_wake_queue(dev->net);
+}
+
+/*
+ * Multi-packet IN path. Frames are copied into tx_agg while a transfer
+ * is in flight, and go out when the transfer completes, when tx_agg is
+ * full, or at once when the endpoint is idle, so nothing waits on a
+ * timer.
+ */
+static netdev_tx_t eth_xmit_agg(struct eth_dev *dev, struct sk_buff *skb,
+		struct usb_ep *in, unsigned max_frames, unsigned max_size)
+{
+	struct net_device	*net = dev->net;
+	unsigned		frame_max = ETH_HLEN + net->mtu + dev->header_len;
+	struct sk_buff		*agg;
+	unsigned long		flags;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	if (list_empty(&dev->tx_reqs)) {
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		return NETDEV_TX_BUSY;
+	}
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->port_usb) {
+		skb = dev->wrap(dev->port_usb, skb);
+	} else {
+		dev_kfree_skb_any(skb);
+		skb = NULL;
+	}
+	spin_unlock_irqrestore(&dev->lock, flags);
+	if (!skb) {
+		net->stats.tx_dropped++;
+		return NETDEV_TX_OK;
+	}
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	agg = dev->tx_agg;
+	if (agg && agg->len + skb->len > max_size) {
+		if (tx_agg_flush(dev, in) == -EBUSY)
+			goto drop;
+		agg = NULL;
+	}
+	if (!agg) {
+		agg = alloc_skb(max_size + 1, GFP_ATOMIC);
+		if (!agg)
+			goto drop;
+		TX_AGG_FRAMES(agg) = 0;
+		dev->tx_agg = agg;
+	}
+
+	memcpy(skb_put(agg, skb->len), skb->data, skb->len);
+	TX_AGG_FRAMES(agg)++;
+	dev_kfree_skb_any(skb);
+
+	if (TX_AGG_FRAMES(agg) >= max_frames ||
+	    agg->len + frame_max > max_size ||
+	    !atomic_read(&dev->tx_qlen))
+		tx_agg_flush(dev, in);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+	return NETDEV_TX_OK;
+
+drop:
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+	dev_kfree_skb_any(skb);
+	net->stats.tx_dropped++;
+	return NETDEV_TX_OK;
+}
+
 static inline int is_promisc(u16 cdc_filter)
 {
 	return cdc_filter & USB_CDC_PACKET_TYPE_PROMISCUOUS;
@@ -509,11 +722,15 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 	unsigned long		flags;
 	struct usb_ep		*in;
 	u16			cdc_filter;
+	unsigned		agg_frames = 0, agg_size = 0;
 
 	spin_lock_irqsave(&dev->lock, flags);
 	if (dev->port_usb) {
 		in = dev->port_usb->in_ep;
 		cdc_filter = dev->port_usb->cdc_filter;
+		agg_frames = dev->port_usb->dl_max_pkts_per_xfer;
+		agg_size = min_t(unsigned, dev->port_usb->dl_max_xfer_size,
+				TX_AGG_MAX);
 	} else {
 		in = NULL;
 		cdc_filter = 0;
@@ -547,6 +764,11 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		/* ignores USB_CDC_PACKET_TYPE_DIRECTED */
 	}
 
+	/* only worth it if the host takes at least two full frames */
+	if (dev->wrap && agg_frames > 1 &&
+	    agg_size >= 2 * (ETH_HLEN + net->mtu + dev->header_len))
+		return eth_xmit_agg(dev, skb, in, agg_frames, agg_size - 1);
+
 	spin_lock_irqsave(&dev->req_lock, flags);
 	/*
 	 * this freelist can be empty if an interrupt triggered disconnect()
@@ -690,6 +912,10 @@ static int eth_stop(struct net_device *net)
 	VDBG(dev, "%s\n", __func__);
 	netif_stop_queue(net);
 
+	spin_lock_irqsave(&dev->req_lock, flags);
+	tx_agg_drop(dev);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
 	DBG(dev, "stop stats: rx/tx %ld/%ld, errs %ld/%ld\n",
 		dev->net->stats.rx_packets, dev->net->stats.tx_packets,
 		dev->net->stats.rx_errors, dev->net->stats.tx_errors
@@ -1002,6 +1228,7 @@ void gether_disconnect(struct gether *link)
 	 */
 	usb_ep_disable(link->in_ep);
 	spin_lock(&dev->req_lock);
+	tx_agg_drop(dev);
 	while (!list_empty(&dev->tx_reqs)) {
 		req = container_of(dev->tx_reqs.next,
 					struct usb_request, list);
@@ -66,6 +66,13 @@ struct gether {
 	bool				is_fixed;
 	u32				fixed_out_len;
 	u32				fixed_in_len;
+	/* RNDIS multi-packet transfers: frames the function takes per
+	 * OUT transfer, frames it may send per IN transfer, and the
+	 * largest IN transfer the host accepts (0 until the host says).
+	 */
+	u32				ul_max_pkts_per_xfer;
+	u32				dl_max_pkts_per_xfer;
+	u32				dl_max_xfer_size;
 	struct sk_buff			*(*wrap)(struct gether *port,
 						struct sk_buff *skb);
 	int				(*unwrap)(struct gether *port,
@@ -32,6 +32,7 @@
 #include <linux/device.h>
 #include <linux/efi.h>
 #include <linux/fb.h>
+#include <linux/poll.h>
 
 #include <asm/fb.h>
 
@@ -1438,6 +1439,20 @@ out:
 	return res;
 }
 
+static unsigned int
+fb_poll(struct file *file, poll_table *wait)
+{
+	struct fb_info *info = file_fb_info(file);
+
+	if (!info)
+		return POLLERR;
+
+	if (info->fbops->fb_poll)
+		return info->fbops->fb_poll(info, file, wait);
+
+	return DEFAULT_POLLMASK;
+}
+
 static int 
 fb_release(struct inode *inode, struct file *file)
 __acquires(&info->lock)
@@ -1458,6 +1473,7 @@ static const struct file_operations fb_fops = {
 	.owner =	THIS_MODULE,
 	.read =		fb_read,
 	.write =	fb_write,
+	.poll =		fb_poll,
 	.unlocked_ioctl = fb_ioctl,
 #ifdef CONFIG_COMPAT
 	.compat_ioctl = fb_compat_ioctl,
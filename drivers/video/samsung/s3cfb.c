@@ -40,6 +40,9 @@
 #endif
 #include "s3cfb.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/s3cfb.h>
+
 #if defined(CONFIG_ARIES_EUR)
 #include "logo_rgb24_wvga_portrait.h"
 #elif defined(CONFIG_ARIES_NTT)
@@ -160,6 +163,124 @@ static int s3cfb_draw_logo(struct fb_info *fb)
 	return 0;
 }
 #endif
+static void s3cfb_flip_done(struct s3cfb_window *win, ktime_t timestamp)
+{
+	int i = (win->flip_head + win->flip_count) % S3CFB_FLIP_EVENTS;
+
+	trace_s3cfb_flip_done(win->id, win->flip_cur.yoffset,
+			      win->flip_cur.cookie);
+
+	/* Nobody is reading: the oldest event goes */
+	if (win->flip_count == S3CFB_FLIP_EVENTS)
+		win->flip_head = (win->flip_head + 1) % S3CFB_FLIP_EVENTS;
+	else
+		win->flip_count++;
+
+	win->flip_events[i].cookie = win->flip_cur.cookie;
+	win->flip_events[i].yoffset = win->flip_cur.yoffset;
+	win->flip_events[i].timestamp = ktime_to_ns(timestamp);
+	win->flip_latched = 0;
+}
+
+/*
+ * The address written now is taken at the start of the next frame, so
+ * a flip latched at one vsync is reported on screen at the following
+ * one, and a queued flip is latched in the same interrupt.
+ */
+static void s3cfb_flip_vsync(struct s3cfb_global *fbdev, ktime_t timestamp)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
+	struct s3cfb_window *win;
+	int i;
+
+	spin_lock(&fbdev->flip_lock);
+	for (i = 0; i < pdata->nr_wins; i++) {
+		win = fbdev->fb[i]->par;
+
+		if (win->flip_latched)
+			s3cfb_flip_done(win, timestamp);
+
+		if (win->flip_queued) {
+			fbdev->fb[i]->var.yoffset = win->flip_next.yoffset;
+			s3cfb_set_buffer_address(fbdev, i);
+
+			win->flip_cur = win->flip_next;
+			win->flip_queued = 0;
+			win->flip_latched = 1;
+		}
+	}
+	spin_unlock(&fbdev->flip_lock);
+}
+
+/* No vsync is coming: complete the flips in flight now */
+static void s3cfb_flip_flush(struct s3cfb_global *fbdev)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
+	struct s3cfb_window *win;
+	unsigned long flags;
+	ktime_t now = ktime_get();
+	int i;
+
+	spin_lock_irqsave(&fbdev->flip_lock, flags);
+	for (i = 0; i < pdata->nr_wins; i++) {
+		win = fbdev->fb[i]->par;
+
+		if (win->flip_latched)
+			s3cfb_flip_done(win, now);
+
+		if (win->flip_queued) {
+			fbdev->fb[i]->var.yoffset = win->flip_next.yoffset;
+			win->flip_cur = win->flip_next;
+			win->flip_queued = 0;
+			s3cfb_flip_done(win, now);
+		}
+	}
+	spin_unlock_irqrestore(&fbdev->flip_lock, flags);
+
+	wake_up_interruptible(&fbdev->vsync_wait);
+}
+
+/* Nothing reported on screen for this long: drop to idle_refresh */
+#define S3CFB_IDLE_DELAY	msecs_to_jiffies(500)
+
+/*
+ * The panel takes pixels at the dot clock even when nothing changed,
+ * so a static screen is refreshed at a lower clock to cut the DMA
+ * traffic. Any reported update restores the rate in the next frame.
+ */
+static void s3cfb_refresh_wake(struct s3cfb_global *fbdev)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&fbdev->refresh_lock, flags);
+	fbdev->last_update = jiffies;
+	if (fbdev->refresh_idle) {
+		s3cfb_set_clock_div(fbdev, fbdev->vclk_div);
+		fbdev->refresh_idle = 0;
+	}
+	spin_unlock_irqrestore(&fbdev->refresh_lock, flags);
+}
+
+static void s3cfb_refresh_vsync(struct s3cfb_global *fbdev)
+{
+	u32 div;
+
+	if (!fbdev->idle_refresh || fbdev->refresh_idle)
+		return;
+
+	spin_lock(&fbdev->refresh_lock);
+	if (fbdev->idle_refresh && !fbdev->refresh_idle &&
+	    time_after(jiffies, fbdev->last_update + S3CFB_IDLE_DELAY)) {
+		div = DIV_ROUND_UP(fbdev->vclk_div * fbdev->lcd->freq,
+				   fbdev->idle_refresh);
+		div = min(div, 256U);
+		if (div > fbdev->vclk_div)
+			s3cfb_set_clock_div(fbdev, div);
+		fbdev->refresh_idle = 1;
+	}
+	spin_unlock(&fbdev->refresh_lock);
+}
+
 static irqreturn_t s3cfb_irq_frame(int irq, void *data)
 {
 	struct s3cfb_global *fbdev = (struct s3cfb_global *)data;
@@ -167,6 +288,9 @@ static irqreturn_t s3cfb_irq_frame(int irq, void *data)
 	s3cfb_clear_interrupt(fbdev);
 
 	fbdev->vsync_timestamp = ktime_get();
+	trace_s3cfb_vsync(ktime_to_ns(fbdev->vsync_timestamp));
+	s3cfb_flip_vsync(fbdev, fbdev->vsync_timestamp);
+	s3cfb_refresh_vsync(fbdev);
 	wmb();
 	wake_up_interruptible(&fbdev->vsync_wait);
 
@@ -196,6 +320,7 @@ static int s3cfb_init_global(struct s3cfb_global *ctrl)
 	ctrl->rgb_mode = MODE_RGB_P;
 
 	init_waitqueue_head(&ctrl->vsync_wait);
+	spin_lock_init(&ctrl->flip_lock);
 	mutex_init(&ctrl->lock);
 
 	s3cfb_set_output(ctrl);
@@ -543,7 +668,9 @@ static int s3cfb_pan_display(struct fb_var_screeninfo *var, struct fb_info *fb)
 		"[fb%d] yoffset for pan display: %d\n",
 		win->id, var->yoffset);
 
+	trace_s3cfb_pan_display(win->id, var->yoffset, 0);
 	s3cfb_set_buffer_address(fbdev, win->id);
+	s3cfb_refresh_wake(fbdev);
 
 	return 0;
 }
@@ -626,6 +753,14 @@ static int s3cfb_release(struct fb_info *fb, int user)
 	if (!WARN_ON(!win->in_use))
 		win->in_use--;
 
+	if (!win->in_use) {
+		spin_lock_irq(&fbdev->flip_lock);
+		win->flip_queued = 0;
+		win->flip_latched = 0;
+		win->flip_count = 0;
+		spin_unlock_irq(&fbdev->flip_lock);
+	}
+
 	mutex_unlock(&fbdev->lock);
 
 	return 0;
@@ -647,13 +782,128 @@ static int s3cfb_wait_for_vsync(struct s3cfb_global *ctrl)
 
 	return ret;
 }
+
+/* Keeps the window on the panel, as S3CFB_WIN_POSITION always did */
+static void s3cfb_set_position(struct s3cfb_global *fbdev,
+			       struct fb_info *fb, int x, int y)
+{
+	struct s3cfb_window *win = fb->par;
+	struct s3cfb_lcd *lcd = fbdev->lcd;
+
+	x = max(x, 0);
+	y = max(y, 0);
+
+	if (x + fb->var.xres > lcd->width)
+		win->x = lcd->width - fb->var.xres;
+	else
+		win->x = x;
+
+	if (y + fb->var.yres > lcd->height)
+		win->y = lcd->height - fb->var.yres;
+	else
+		win->y = y;
+}
+
+static int s3cfb_check_commit(struct s3cfb_global *fbdev,
+			      struct s3cfb_commit *commit)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
+	struct s3cfb_window_state *state;
+	struct s3cfb_window *win;
+	struct fb_info *fb;
+	int i;
+
+	if (commit->mask & ~((1 << pdata->nr_wins) - 1))
+		return -EINVAL;
+
+	for (i = 0; i < pdata->nr_wins; i++) {
+		if (!(commit->mask & (1 << i)))
+			continue;
+
+		fb = fbdev->fb[i];
+		win = fb->par;
+		state = &commit->win[i];
+
+		if ((state->flags & S3CFB_WIN_STATE_ENABLE) &&
+		    state->enabled && !fb->fix.smem_start)
+			return -EINVAL;
+
+		if (state->flags & S3CFB_WIN_STATE_BUFFER) {
+			if (state->yoffset + fb->var.yres > fb->var.yres_virtual)
+				return -EINVAL;
+			/* a queued flip would undo it at the next vsync */
+			if (win->flip_queued)
+				return -EBUSY;
+		}
+
+		if ((state->flags & S3CFB_WIN_STATE_ALPHA) && i == 0)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * Called with flip_lock held, which also keeps the vsync interrupt from
+ * latching a flip in the middle. Every register write waits behind the
+ * shadow protection of its window until all of them are written.
+ */
+static void s3cfb_apply_commit(struct s3cfb_global *fbdev,
+			       struct s3cfb_commit *commit)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
+	struct s3cfb_window_state *state;
+	struct s3cfb_window *win;
+	struct fb_info *fb;
+	int i;
+
+	s3cfb_shadow_hold(fbdev, commit->mask);
+
+	for (i = 0; i < pdata->nr_wins; i++) {
+		if (!(commit->mask & (1 << i)))
+			continue;
+
+		fb = fbdev->fb[i];
+		win = fb->par;
+		state = &commit->win[i];
+
+		if (state->flags & S3CFB_WIN_STATE_POSITION) {
+			s3cfb_set_position(fbdev, fb, state->x, state->y);
+			s3cfb_set_window_position(fbdev, i);
+		}
+
+		if (state->flags & S3CFB_WIN_STATE_BUFFER) {
+			if (win->owner == DMA_MEM_OTHER)
+				fb->fix.smem_start = win->other_mem_addr;
+			fb->var.yoffset = state->yoffset;
+			s3cfb_set_buffer_address(fbdev, i);
+		}
+
+		if (state->flags & S3CFB_WIN_STATE_ALPHA) {
+			win->alpha.mode = PLANE_BLENDING;
+			win->alpha.channel = state->alpha_channel;
+			win->alpha.value = S3CFB_AVALUE(state->red,
+							state->green,
+							state->blue);
+			s3cfb_set_alpha_blending(fbdev, i);
+		}
+
+		if (state->flags & S3CFB_WIN_STATE_ENABLE) {
+			if (state->enabled)
+				s3cfb_win_map_off(fbdev, i);
+			s3cfb_set_window(fbdev, i, state->enabled);
+		}
+	}
+
+	s3cfb_shadow_release(fbdev);
+}
+
 static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 {
 	struct s3cfb_global *fbdev =
 		platform_get_drvdata(to_platform_device(fb->device));
 	struct fb_var_screeninfo *var = &fb->var;
 	struct s3cfb_window *win = fb->par;
-	struct s3cfb_lcd *lcd = fbdev->lcd;
 	struct fb_fix_screeninfo *fix = &fb->fix;
 	struct s3cfb_next_info next_fb_info;
 
@@ -663,8 +913,13 @@ static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 		struct s3cfb_user_window user_window;
 		struct s3cfb_user_plane_alpha user_alpha;
 		struct s3cfb_user_chroma user_chroma;
+		struct s3cfb_flip flip;
+		struct s3cfb_flip_event flip_event;
+		struct s3cfb_user_rect rect;
+		struct s3cfb_commit commit;
 		int vsync;
 	} p;
+	unsigned long flags;
 
 	switch (cmd) {
 	case FBIO_WAITFORVSYNC:
@@ -686,22 +941,8 @@ static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 				   sizeof(p.user_window)))
 			ret = -EFAULT;
 		else {
-			if (p.user_window.x < 0)
-				p.user_window.x = 0;
-
-			if (p.user_window.y < 0)
-				p.user_window.y = 0;
-
-			if (p.user_window.x + var->xres > lcd->width)
-				win->x = lcd->width - var->xres;
-			else
-				win->x = p.user_window.x;
-
-			if (p.user_window.y + var->yres > lcd->height)
-				win->y = lcd->height - var->yres;
-			else
-				win->y = p.user_window.y;
-
+			s3cfb_set_position(fbdev, fb, p.user_window.x,
+					   p.user_window.y);
 			s3cfb_set_window_position(fbdev, win->id);
 		}
 		break;
@@ -748,6 +989,82 @@ static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 		}
 		break;
 
+	case S3CFB_QUEUE_FLIP:
+		if (copy_from_user(&p.flip, (struct s3cfb_flip __user *)arg,
+				   sizeof(p.flip))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		if (p.flip.yoffset + var->yres > var->yres_virtual) {
+			ret = -EINVAL;
+			break;
+		}
+
+		spin_lock_irqsave(&fbdev->flip_lock, flags);
+		if (win->flip_queued) {
+			ret = -EBUSY;
+		} else {
+			win->flip_next = p.flip;
+			win->flip_queued = 1;
+			trace_s3cfb_flip_queue(win->id, p.flip.yoffset,
+					       p.flip.cookie);
+		}
+		spin_unlock_irqrestore(&fbdev->flip_lock, flags);
+
+		if (!ret)
+			s3cfb_refresh_wake(fbdev);
+		break;
+
+	case S3CFB_SET_DIRTY_RECT:
+		if (copy_from_user(&p.rect, (struct s3cfb_user_rect __user *)arg,
+				   sizeof(p.rect))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		/*
+		 * An RGB interface panel is scanned out as a whole, so the
+		 * rectangle only tells whether the screen changed at all.
+		 */
+		if (p.rect.width && p.rect.height)
+			s3cfb_refresh_wake(fbdev);
+		break;
+
+	case S3CFB_COMMIT_WINDOWS:
+		if (copy_from_user(&p.commit, (struct s3cfb_commit __user *)arg,
+				   sizeof(p.commit))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		spin_lock_irqsave(&fbdev->flip_lock, flags);
+		ret = s3cfb_check_commit(fbdev, &p.commit);
+		if (!ret)
+			s3cfb_apply_commit(fbdev, &p.commit);
+		spin_unlock_irqrestore(&fbdev->flip_lock, flags);
+
+		if (!ret)
+			s3cfb_refresh_wake(fbdev);
+		break;
+
+	case S3CFB_GET_FLIP_EVENT:
+		spin_lock_irqsave(&fbdev->flip_lock, flags);
+		if (win->flip_count) {
+			p.flip_event = win->flip_events[win->flip_head];
+			win->flip_head = (win->flip_head + 1) %
+				S3CFB_FLIP_EVENTS;
+			win->flip_count--;
+		} else {
+			ret = -EAGAIN;
+		}
+		spin_unlock_irqrestore(&fbdev->flip_lock, flags);
+
+		if (!ret && copy_to_user((void __user *)arg, &p.flip_event,
+					 sizeof(p.flip_event)))
+			ret = -EFAULT;
+		break;
+
 	case S3CFB_GET_CURR_FB_INFO:
 		next_fb_info.phy_start_addr = fix->smem_start;
 		next_fb_info.xres = var->xres;
@@ -769,6 +1086,28 @@ static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 	return ret;
 }
 
+/* POLLIN: a flip event to read, POLLOUT: room to queue a flip */
+static unsigned int s3cfb_poll(struct fb_info *fb, struct file *file,
+			       poll_table *wait)
+{
+	struct s3cfb_global *fbdev =
+		platform_get_drvdata(to_platform_device(fb->device));
+	struct s3cfb_window *win = fb->par;
+	unsigned int mask = 0;
+	unsigned long flags;
+
+	poll_wait(file, &fbdev->vsync_wait, wait);
+
+	spin_lock_irqsave(&fbdev->flip_lock, flags);
+	if (win->flip_count)
+		mask |= POLLIN | POLLRDNORM;
+	if (!win->flip_queued)
+		mask |= POLLOUT | POLLWRNORM;
+	spin_unlock_irqrestore(&fbdev->flip_lock, flags);
+
+	return mask;
+}
+
 struct fb_ops s3cfb_ops = {
 	.owner = THIS_MODULE,
 	.fb_fillrect = cfb_fillrect,
@@ -782,6 +1121,7 @@ struct fb_ops s3cfb_ops = {
 	.fb_ioctl = s3cfb_ioctl,
 	.fb_open = s3cfb_open,
 	.fb_release = s3cfb_release,
+	.fb_poll = s3cfb_poll,
 };
 
 static void s3cfb_init_fbinfo(struct s3cfb_global *ctrl, int id)
@@ -990,6 +1330,35 @@ static int s3cfb_sysfs_store_win_power(struct device *dev,
 static DEVICE_ATTR(win_power, S_IRUGO | S_IWUSR,
 		   s3cfb_sysfs_show_win_power, s3cfb_sysfs_store_win_power);
 
+static ssize_t s3cfb_sysfs_show_idle_refresh(struct device *dev,
+					     struct device_attribute *attr,
+					     char *buf)
+{
+	struct s3cfb_global *fbdev = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", fbdev->idle_refresh);
+}
+
+/* Refresh rate in Hz of a screen left unchanged, 0 to keep the LCD rate */
+static ssize_t s3cfb_sysfs_store_idle_refresh(struct device *dev,
+					      struct device_attribute *attr,
+					      const char *buf, size_t len)
+{
+	struct s3cfb_global *fbdev = dev_get_drvdata(dev);
+	unsigned long hz;
+
+	if (strict_strtoul(buf, 10, &hz) < 0 || hz > fbdev->lcd->freq)
+		return -EINVAL;
+
+	fbdev->idle_refresh = hz;
+	s3cfb_refresh_wake(fbdev);
+
+	return len;
+}
+
+static DEVICE_ATTR(idle_refresh, S_IRUGO | S_IWUSR,
+		   s3cfb_sysfs_show_idle_refresh, s3cfb_sysfs_store_idle_refresh);
+
 static int __devinit s3cfb_probe(struct platform_device *pdev)
 {
 	struct s3c_platform_fb *pdata;
@@ -1091,6 +1460,7 @@ static int __devinit s3cfb_probe(struct platform_device *pdev)
 	s3c_mdnie_setup();
 #endif
 
+	spin_lock_init(&fbdev->refresh_lock);
 	s3cfb_init_global(fbdev);
 
 	if (s3cfb_alloc_framebuffer(fbdev)) {
@@ -1152,6 +1522,10 @@ static int __devinit s3cfb_probe(struct platform_device *pdev)
 	if (ret < 0)
 		dev_err(fbdev->dev, "failed to add sysfs entries\n");
 
+	ret = device_create_file(&(pdev->dev), &dev_attr_idle_refresh);
+	if (ret < 0)
+		dev_err(fbdev->dev, "failed to add sysfs entries\n");
+
 	dev_info(fbdev->dev, "registered successfully\n");
 
 	return 0;
@@ -1208,6 +1582,7 @@ static int __devexit s3cfb_remove(struct platform_device *pdev)
 	int i;
 
 	device_remove_file(&(pdev->dev), &dev_attr_win_power);
+	device_remove_file(&(pdev->dev), &dev_attr_idle_refresh);
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	unregister_early_suspend(&fbdev->early_suspend);
@@ -1252,6 +1627,7 @@ void s3cfb_early_suspend(struct early_suspend *h)
 		container_of(h, struct s3cfb_global, early_suspend);
 
 	pr_debug("s3cfb_early_suspend is called\n");
+	s3cfb_flip_flush(fbdev);
 #ifdef CONFIG_FB_S3C_MDNIE
 	writel(0,fbdev->regs + 0x27c);
 	msleep(20);
@@ -1312,6 +1688,7 @@ void s3cfb_late_resume(struct early_suspend *h)
 #endif
 	s3cfb_init_global(fbdev);
 	s3cfb_set_clock(fbdev);
+	s3cfb_refresh_wake(fbdev);
 #ifdef CONFIG_FB_S3C_MDNIE
 	s3c_mdnie_init_global(fbdev);
 	s3c_mdnie_start(fbdev);
@@ -192,6 +192,24 @@ struct s3cfb_lcd {
  * @alpha:		alpha blending structure
  * @chroma:		chroma key structure
 */
+/*
+ * S3CFB_QUEUE_FLIP: pan to yoffset at the next vsync. Once the buffer is
+ * on screen, S3CFB_GET_FLIP_EVENT returns cookie with the time of that
+ * vsync, and the buffer shown before it is free again.
+ */
+struct s3cfb_flip {
+	unsigned int	yoffset;
+	unsigned int	cookie;
+};
+
+struct s3cfb_flip_event {
+	unsigned int	cookie;
+	unsigned int	yoffset;
+	u64		timestamp;	/* ns, ktime_get() */
+};
+
+#define S3CFB_FLIP_EVENTS	4
+
 struct s3cfb_window {
 	int			id;
 	int			enabled;
@@ -207,6 +225,15 @@ struct s3cfb_window {
 	unsigned int		pseudo_pal[16];
 	struct			s3cfb_alpha alpha;
 	struct			s3cfb_chroma chroma;
+
+	/* page flips, under s3cfb_global.flip_lock */
+	int			flip_queued;	/* flip_next waits for vsync */
+	int			flip_latched;	/* flip_cur goes on screen */
+	struct s3cfb_flip	flip_next;
+	struct s3cfb_flip	flip_cur;
+	struct s3cfb_flip_event	flip_events[S3CFB_FLIP_EVENTS];
+	int			flip_head;
+	int			flip_count;
 };
 
 /*
@@ -234,6 +261,8 @@ struct s3cfb_global {
 
 	wait_queue_head_t	vsync_wait;
 	ktime_t			vsync_timestamp;
+	spinlock_t		flip_lock;
+	u32			shadow_held;	/* windows of a commit */
 
 	/* fimd */
 	int			enabled;
@@ -243,6 +272,13 @@ struct s3cfb_global {
 	enum s3cfb_rgb_mode_t	rgb_mode;
 	struct s3cfb_lcd	*lcd;
 	u32			pixclock_hz;
+	u32			vclk_div;
+
+	/* reduced refresh while idle, under refresh_lock */
+	spinlock_t		refresh_lock;
+	unsigned int		idle_refresh;	/* Hz, 0: never */
+	int			refresh_idle;
+	unsigned long		last_update;	/* jiffies */
 
 #ifdef CONFIG_HAS_WAKELOCK
 	struct early_suspend	early_suspend;
@@ -280,6 +316,43 @@ struct s3cfb_user_chroma {
 	unsigned char	blue;
 };
 
+/*
+ * S3CFB_COMMIT_WINDOWS: update the windows in mask together. What
+ * flags asks for is changed in each of them and the hardware takes it
+ * all at the same vsync. Nothing is changed if any of it is invalid.
+ */
+#define S3CFB_MAX_WINS			5
+
+#define S3CFB_WIN_STATE_ENABLE		(1 << 0)	/* enabled */
+#define S3CFB_WIN_STATE_POSITION	(1 << 1)	/* x, y */
+#define S3CFB_WIN_STATE_BUFFER		(1 << 2)	/* yoffset */
+#define S3CFB_WIN_STATE_ALPHA		(1 << 3)	/* plane alpha */
+
+struct s3cfb_window_state {
+	unsigned int	flags;
+	int		enabled;
+	int		x;
+	int		y;
+	unsigned int	yoffset;
+	int		alpha_channel;
+	unsigned char	red;
+	unsigned char	green;
+	unsigned char	blue;
+};
+
+struct s3cfb_commit {
+	unsigned int			mask;	/* bit n: window n */
+	struct s3cfb_window_state	win[S3CFB_MAX_WINS];
+};
+
+/* Damage since the last report, zero width or height: no change */
+struct s3cfb_user_rect {
+	unsigned int	x;
+	unsigned int	y;
+	unsigned int	width;
+	unsigned int	height;
+};
+
 struct s3cfb_next_info {
 	unsigned int phy_start_addr;
 	unsigned int xres;		/* visible resolution*/
@@ -317,6 +390,10 @@ struct s3cfb_next_info {
 						enum s3cfb_mem_owner_t)
 // New IOCTL that waits for vsync and returns a timestamp
 #define S3CFB_WAIT_FOR_VSYNC  _IOR('F', 311, u64)
+#define S3CFB_QUEUE_FLIP		_IOW('F', 312, struct s3cfb_flip)
+#define S3CFB_GET_FLIP_EVENT		_IOR('F', 313, struct s3cfb_flip_event)
+#define S3CFB_SET_DIRTY_RECT		_IOW('F', 314, struct s3cfb_user_rect)
+#define S3CFB_COMMIT_WINDOWS		_IOW('F', 315, struct s3cfb_commit)
 
 /*
  * E X T E R N S
@@ -332,6 +409,7 @@ extern int s3cfb_display_on(struct s3cfb_global *ctrl);
 extern int s3cfb_display_off(struct s3cfb_global *ctrl);
 extern int s3cfb_frame_off(struct s3cfb_global *ctrl);
 extern int s3cfb_set_clock(struct s3cfb_global *ctrl);
+extern void s3cfb_set_clock_div(struct s3cfb_global *ctrl, u32 div);
 extern int s3cfb_set_polarity(struct s3cfb_global *ctrl);
 extern int s3cfb_set_timing(struct s3cfb_global *ctrl);
 extern int s3cfb_set_lcd_size(struct s3cfb_global *ctrl);
@@ -354,6 +432,8 @@ extern int s3cfb_set_window_size(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_buffer_address(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_buffer_size(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_chroma_key(struct s3cfb_global *ctrl, int id);
+extern void s3cfb_shadow_hold(struct s3cfb_global *ctrl, u32 mask);
+extern void s3cfb_shadow_release(struct s3cfb_global *ctrl);
 
 #ifdef CONFIG_HAS_WAKELOCK
 #ifdef CONFIG_HAS_EARLYSUSPEND
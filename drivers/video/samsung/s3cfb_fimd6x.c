@@ -10,11 +10,13 @@
  * published by the Free Software Foundation.
 */
 
+#include <linux/module.h>
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/fb.h>
 #include <linux/io.h>
 #include <linux/clk.h>
+#include <linux/notifier.h>
 #include <mach/map.h>
 #include <plat/clock.h>
 #include <plat/fb.h>
@@ -215,6 +217,7 @@ int s3cfb_set_clock(struct s3cfb_global *ctrl)
 
 	cfg |= S3C_VIDCON0_CLKVAL_F(div - 1);
 	writel(cfg, ctrl->regs + S3C_VIDCON0);
+	ctrl->vclk_div = div;
 
 	dev_dbg(ctrl->dev, "parent clock: %d, vclk: %d, vclk div: %d\n",
 			src_clk, vclk, div);
@@ -223,6 +226,17 @@ int s3cfb_set_clock(struct s3cfb_global *ctrl)
 	return 0;
 }
 
+/* Taken at the start of the next frame, timings are left as they are */
+void s3cfb_set_clock_div(struct s3cfb_global *ctrl, u32 div)
+{
+	u32 cfg;
+
+	cfg = readl(ctrl->regs + S3C_VIDCON0);
+	cfg &= ~S3C_VIDCON0_CLKVAL_F(-1);
+	cfg |= S3C_VIDCON0_CLKVAL_F(div - 1);
+	writel(cfg, ctrl->regs + S3C_VIDCON0);
+}
+
 int s3cfb_set_polarity(struct s3cfb_global *ctrl)
 {
 	struct s3cfb_lcd_polarity *pol;
@@ -583,13 +597,94 @@ int s3cfb_set_window_control(struct s3cfb_global *ctrl, int id)
 	return 0;
 }
 
+/*
+ * While a window is protected its shadowed registers can be written
+ * without the hardware taking any of them at a vsync. The windows of a
+ * s3cfb_shadow_hold() stay protected through the updates of single
+ * registers below, until s3cfb_shadow_release() drops them all in one
+ * write, and the next vsync takes the new state of every one of them.
+ */
+static void s3cfb_shadow_protect(struct s3cfb_global *ctrl, int id)
+{
+	u32 shw;
+
+	if (ctrl->shadow_held & (1 << id))
+		return;
+
+	shw = readl(ctrl->regs + S3C_WINSHMAP);
+	shw |= S3C_WINSHMAP_PROTECT(id);
+	writel(shw, ctrl->regs + S3C_WINSHMAP);
+}
+
+static void s3cfb_shadow_unprotect(struct s3cfb_global *ctrl, int id)
+{
+	u32 shw;
+
+	if (ctrl->shadow_held & (1 << id))
+		return;
+
+	shw = readl(ctrl->regs + S3C_WINSHMAP);
+	shw &= ~S3C_WINSHMAP_PROTECT(id);
+	writel(shw, ctrl->regs + S3C_WINSHMAP);
+}
+
+void s3cfb_shadow_hold(struct s3cfb_global *ctrl, u32 mask)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(ctrl->dev);
+	u32 shw;
+	int i;
+
+	if (pdata->hw_ver != 0x62)
+		return;
+
+	shw = readl(ctrl->regs + S3C_WINSHMAP);
+	for (i = 0; i < pdata->nr_wins; i++)
+		if (mask & (1 << i))
+			shw |= S3C_WINSHMAP_PROTECT(i);
+	writel(shw, ctrl->regs + S3C_WINSHMAP);
+
+	ctrl->shadow_held = mask;
+}
+
+void s3cfb_shadow_release(struct s3cfb_global *ctrl)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(ctrl->dev);
+	u32 shw;
+	int i;
+
+	if (pdata->hw_ver != 0x62)
+		return;
+
+	shw = readl(ctrl->regs + S3C_WINSHMAP);
+	for (i = 0; i < pdata->nr_wins; i++)
+		if (ctrl->shadow_held & (1 << i))
+			shw &= ~S3C_WINSHMAP_PROTECT(i);
+	writel(shw, ctrl->regs + S3C_WINSHMAP);
+
+	ctrl->shadow_held = 0;
+}
+
+static ATOMIC_NOTIFIER_HEAD(s3cfb_scanout_chain);
+
+int s3cfb_register_scanout_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&s3cfb_scanout_chain, nb);
+}
+EXPORT_SYMBOL(s3cfb_register_scanout_notifier);
+
+int s3cfb_unregister_scanout_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_unregister(&s3cfb_scanout_chain, nb);
+}
+EXPORT_SYMBOL(s3cfb_unregister_scanout_notifier);
+
 int s3cfb_set_buffer_address(struct s3cfb_global *ctrl, int id)
 {
+	struct s3cfb_scanout scanout;
 	struct fb_fix_screeninfo *fix = &ctrl->fb[id]->fix;
 	struct fb_var_screeninfo *var = &ctrl->fb[id]->var;
 	struct s3c_platform_fb *pdata = to_fb_plat(ctrl->dev);
 	dma_addr_t start_addr = 0, end_addr = 0;
-	u32 shw;
 
 	if (fix->smem_start) {
 		start_addr = fix->smem_start + (var->xres_virtual *
@@ -598,24 +693,22 @@ int s3cfb_set_buffer_address(struct s3cfb_global *ctrl, int id)
 		end_addr = start_addr + fix->line_length * var->yres;
 	}
 
-	if (pdata->hw_ver == 0x62) {
-		shw = readl(ctrl->regs + S3C_WINSHMAP);
-		shw |= S3C_WINSHMAP_PROTECT(id);
-		writel(shw, ctrl->regs + S3C_WINSHMAP);
-	}
+	if (pdata->hw_ver == 0x62)
+		s3cfb_shadow_protect(ctrl, id);
 
 	writel(start_addr, ctrl->regs + S3C_VIDADDR_START0(id));
 	writel(end_addr, ctrl->regs + S3C_VIDADDR_END0(id));
 
-	if (pdata->hw_ver == 0x62) {
-		shw = readl(ctrl->regs + S3C_WINSHMAP);
-		shw &= ~(S3C_WINSHMAP_PROTECT(id));
-		writel(shw, ctrl->regs + S3C_WINSHMAP);
-	}
+	if (pdata->hw_ver == 0x62)
+		s3cfb_shadow_unprotect(ctrl, id);
 
 	dev_dbg(ctrl->dev, "[fb%d] start_addr: 0x%08x, end_addr: 0x%08x\n",
 		id, start_addr, end_addr);
 
+	scanout.fb = ctrl->fb[id];
+	scanout.start = start_addr;
+	atomic_notifier_call_chain(&s3cfb_scanout_chain, id, &scanout);
+
 	return 0;
 }
 
@@ -676,11 +769,9 @@ int s3cfb_set_window_position(struct s3cfb_global *ctrl, int id)
 {
 	struct fb_var_screeninfo *var = &ctrl->fb[id]->var;
 	struct s3cfb_window *win = ctrl->fb[id]->par;
-	u32 cfg, shw;
+	u32 cfg;
 
-	shw = readl(ctrl->regs + S3C_WINSHMAP);
-	shw |= S3C_WINSHMAP_PROTECT(id);
-	writel(shw, ctrl->regs + S3C_WINSHMAP);
+	s3cfb_shadow_protect(ctrl, id);
 
 	cfg = S3C_VIDOSD_LEFT_X(win->x) | S3C_VIDOSD_TOP_Y(win->y);
 	writel(cfg, ctrl->regs + S3C_VIDOSD_A(id));
@@ -690,9 +781,7 @@ int s3cfb_set_window_position(struct s3cfb_global *ctrl, int id)
 
 	writel(cfg, ctrl->regs + S3C_VIDOSD_B(id));
 
-	shw = readl(ctrl->regs + S3C_WINSHMAP);
-	shw &= ~(S3C_WINSHMAP_PROTECT(id));
-	writel(shw, ctrl->regs + S3C_WINSHMAP);
+	s3cfb_shadow_unprotect(ctrl, id);
 
 	dev_dbg(ctrl->dev, "[fb%d] offset: (%d, %d, %d, %d)\n", id,
 		win->x, win->y, win->x + var->xres - 1, win->y + var->yres - 1);
@@ -15,6 +15,7 @@
 #include <linux/errno.h>
 #include <linux/clk.h>
 #include <linux/mutex.h>
+#include <linux/bitmap.h>
 #include <linux/poll.h>
 #include <linux/wait.h>
 #include <linux/fs.h>
@@ -50,7 +51,36 @@ static void __iomem *s3c_mdnie_base;
 #define C110_MDNIE_ADDR	0xfae00000
 
 #define s3c_mdnie_readl(addr)             __raw_readl((s3c_mdnie_base + addr))
-#define s3c_mdnie_writel(val,addr)        __raw_writel(val,(s3c_mdnie_base + addr))
+
+/*
+ * What the registers were last written with, so that a scenario switch
+ * only writes the registers its table changes. Forgotten when the block
+ * is powered down.
+ */
+#define MDNIE_REG_NUM	(S3C_MDNIE_MAP_SIZE / 4)
+
+static u16 mdnie_image[MDNIE_REG_NUM];
+static DECLARE_BITMAP(mdnie_image_valid, MDNIE_REG_NUM);
+
+static void s3c_mdnie_writel(unsigned int val, unsigned int addr)
+{
+	unsigned int reg = addr / 4;
+
+	__raw_writel(val, s3c_mdnie_base + addr);
+
+	if (reg < MDNIE_REG_NUM) {
+		mdnie_image[reg] = val;
+		__set_bit(reg, mdnie_image_valid);
+	}
+}
+
+static bool s3c_mdnie_holds(unsigned int val, unsigned int addr)
+{
+	unsigned int reg = addr / 4;
+
+	return reg < MDNIE_REG_NUM && test_bit(reg, mdnie_image_valid) &&
+		mdnie_image[reg] == val;
+}
 
 
 static char banner[] __initdata = KERN_INFO "S3C MDNIE Driver, (c) 2010 Samsung Electronics\n";
@@ -386,14 +416,24 @@ void mDNIe_Mode_Change(mDNIe_data_type *mode)
 	}
 	else
 	{
-		s3c_mdnie_mask();
-		while ( mode->addr != END_SEQ)
-		{
-			s3c_mdnie_writel(mode->data, mode->addr);
-			gprintk("[mDNIe] mDNIe_tuning_initialize: addr(0x%x), data(0x%x)  \n",mode->addr, mode->data);	
-			mode++;
+		mDNIe_data_type *m;
+
+		/* Switching back and forth mostly rewrites the same table */
+		for (m = mode; m->addr != END_SEQ; m++)
+			if (!s3c_mdnie_holds(m->data, m->addr))
+				break;
+
+		if (m->addr != END_SEQ) {
+			s3c_mdnie_mask();
+			while ( mode->addr != END_SEQ)
+			{
+				if (!s3c_mdnie_holds(mode->data, mode->addr))
+					s3c_mdnie_writel(mode->data, mode->addr);
+				gprintk("[mDNIe] mDNIe_tuning_initialize: addr(0x%x), data(0x%x)  \n",mode->addr, mode->data);	
+				mode++;
+			}
+			s3c_mdnie_unmask();
 		}
-		s3c_mdnie_unmask();
 	}
 
 	mutex_unlock(&mdnie_use);
@@ -1400,6 +1440,10 @@ int s3c_mdnie_off(void)
 	s3c_ielcd_logic_stop();
 	clk_disable(mdnie_clock);
 
+	mutex_lock(&mdnie_use);
+	bitmap_zero(mdnie_image_valid, MDNIE_REG_NUM);
+	mutex_unlock(&mdnie_use);
+
 	return 0;
 }
 
@@ -1439,6 +1439,8 @@ static int __blkdev_put(struct block_device *bdev, fmode_t mode, int for_part)
 	if (!--bdev->bd_openers) {
 		WARN_ON_ONCE(bdev->bd_holders);
 		sync_blockdev(bdev);
+		if (bdev->bd_contains == bdev)
+			blkdev_flush_deferred_discard(bdev);
 		kill_bdev(bdev);
 		/* ->release can cause the old bdi to disappear,
 		 * so must switch it out first
@@ -855,6 +855,7 @@ static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
 static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *key)
 {
 	int pwake = 0;
+	bool was_empty;
 	unsigned long flags;
 	struct epitem *epi = ep_item_from_wait(wait);
 	struct eventpoll *ep = epi->ep;
@@ -905,15 +906,30 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	}
 
 	/* If this file is already in the ready list we exit soon */
-	if (!ep_is_linked(&epi->rdllink))
-		list_add_tail(&epi->rdllink, &ep->rdllist);
+	if (ep_is_linked(&epi->rdllink))
+		goto out_unlock;
+
+	/*
+	 * Events are coalesced: if the ready list was not empty, a waiter was
+	 * woken when it stopped being, and takes this one along. Waking again
+	 * would only wake one more exclusive waiter to find nothing.
+	 */
+	was_empty = list_empty(&ep->rdllist);
+	list_add_tail(&epi->rdllink, &ep->rdllist);
+	if (!was_empty)
+		goto out_unlock;
 
 	/*
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
-	 * wait list.
+	 * wait list. A waker about to sleep, such as a socket writer, passes
+	 * the hint on so the waiter does not preempt it for every event.
 	 */
-	if (waitqueue_active(&ep->wq))
-		wake_up_locked(&ep->wq);
+	if (waitqueue_active(&ep->wq)) {
+		if (sync & WF_SYNC)
+			wake_up_locked_sync(&ep->wq);
+		else
+			wake_up_locked(&ep->wq);
+	}
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
 
@@ -1408,6 +1424,13 @@ fetch_events:
 		}
 		__remove_wait_queue(&ep->wq, &wait);
 
+		/*
+		 * ep_poll_callback() only wakes a waiter when the ready list
+		 * stops being empty: leaving events behind, hand them on.
+		 */
+		if (res && ep_events_available(ep) && waitqueue_active(&ep->wq))
+			wake_up_locked(&ep->wq);
+
 		set_current_state(TASK_RUNNING);
 	}
 check_events:
@@ -56,6 +56,7 @@
 #include <linux/oom.h>
 #include <linux/compat.h>
 #include <linux/ksm.h>
+#include <linux/launch_prefetch.h>
 
 #include <asm/uaccess.h>
 #include <asm/mmu_context.h>
@@ -1068,6 +1069,7 @@ void set_task_comm(struct task_struct *tsk, char *buf)
 	strlcpy(tsk->comm, buf, sizeof(tsk->comm));
 	task_unlock(tsk);
 	perf_event_comm(tsk);
+	launch_prefetch_start(tsk);
 }
 
 int flush_old_exec(struct linux_binprm * bprm)
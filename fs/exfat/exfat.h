@@ -487,6 +487,8 @@ extern "C" {
 		BUF_CACHE_T FAT_cache_array[FAT_CACHE_SIZE];
 		BUF_CACHE_T FAT_cache_lru_list;
 		BUF_CACHE_T FAT_cache_hash_list[FAT_CACHE_HASH_SIZE];
+		UINT32      FAT_ra_last;            // last FAT sector missed in cache
+		UINT32      FAT_ra_end;             // end of FAT sectors read ahead
 
 		/* buf cache */
 		BUF_CACHE_T buf_cache_array[BUF_CACHE_SIZE];
@@ -121,6 +121,21 @@ INT32 bdev_read(struct super_block *sb, UINT32 secno, struct buffer_head **bh, U
 	return(FFS_MEDIAERR);
 }
 
+/* Start reading sectors into the buffer cache without waiting for them */
+void bdev_readahead(struct super_block *sb, UINT32 secno, UINT32 num_secs)
+{
+	BD_INFO_T *p_bd = &(EXFAT_SB(sb)->bd_info);
+	struct blk_plug plug;
+	UINT32 i;
+
+	if (!p_bd->opened) return;
+
+	blk_start_plug(&plug);
+	for (i = 0; i < num_secs; i++)
+		__breadahead(sb->s_bdev, secno + i, p_bd->sector_size);
+	blk_finish_plug(&plug);
+}
+
 INT32 bdev_write(struct super_block *sb, UINT32 secno, struct buffer_head *bh, UINT32 num_secs, INT32 sync)
 {
 	INT32 count;
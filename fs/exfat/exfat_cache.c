@@ -65,6 +65,8 @@ static BUF_CACHE_T *buf_cache_get(struct super_block *sb, UINT32 sec);
 static void buf_cache_insert_hash(struct super_block *sb, BUF_CACHE_T *bp);
 static void buf_cache_remove_hash(BUF_CACHE_T *bp);
 
+static void FAT_readahead(struct super_block *sb, UINT32 sec);
+
 static void push_to_mru(BUF_CACHE_T *bp, BUF_CACHE_T *list);
 static void push_to_lru(BUF_CACHE_T *bp, BUF_CACHE_T *list);
 static void move_to_mru(BUF_CACHE_T *bp, BUF_CACHE_T *list);
@@ -82,6 +84,7 @@ INT32 buf_init(struct super_block *sb)
 
 	/* LRU list */
 	p_fs->FAT_cache_lru_list.next = p_fs->FAT_cache_lru_list.prev = &p_fs->FAT_cache_lru_list;
+	p_fs->FAT_ra_last = p_fs->FAT_ra_end = ~0;
 
 	for (i = 0; i < FAT_CACHE_SIZE; i++) {
 		p_fs->FAT_cache_array[i].drv = -1;
@@ -407,6 +410,8 @@ UINT8 *FAT_getblk(struct super_block *sb, UINT32 sec)
 
 	FAT_cache_insert_hash(sb, bp);
 
+	FAT_readahead(sb, sec);
+
 	if (sector_read(sb, sec, &(bp->buf_bh), 1) != FFS_SUCCESS) {
 		FAT_cache_remove_hash(bp);
 		bp->drv = -1;
@@ -421,6 +426,40 @@ UINT8 *FAT_getblk(struct super_block *sb, UINT32 sec)
 	return(bp->buf_bh->b_data);
 } /* end of FAT_getblk */
 
+/*
+ * A long chain of a fragmented file, or the FAT12/16/32 allocator, walks
+ * the FAT one sector after another, and each miss would otherwise wait
+ * for a single sector. The second miss in a row starts a readahead of the
+ * following sectors, and the next window is started once the walk gets to
+ * the end of the current one.
+ */
+static void FAT_readahead(struct super_block *sb, UINT32 sec)
+{
+	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
+	UINT32 fat_end = p_fs->FAT1_start_sector + p_fs->num_FAT_sectors;
+	UINT32 ra_end;
+
+	if ((FAT_RA_SECTORS == 0) || (sec != p_fs->FAT_ra_last + 1)) {
+		p_fs->FAT_ra_last = sec;
+		return;
+	}
+	p_fs->FAT_ra_last = sec;
+
+	/* still inside the window read ahead last time */
+	if ((sec < p_fs->FAT_ra_end) &&
+	    (sec + FAT_RA_SECTORS >= p_fs->FAT_ra_end))
+		return;
+
+	ra_end = sec + 1 + FAT_RA_SECTORS;
+	if (ra_end > fat_end)
+		ra_end = fat_end;
+	if (sec + 1 >= ra_end)
+		return;
+
+	bdev_readahead(sb, sec + 1, ra_end - sec - 1);
+	p_fs->FAT_ra_end = ra_end;
+} /* end of FAT_readahead */
+
 void FAT_modify(struct super_block *sb, UINT32 sec)
 {
 	BUF_CACHE_T *bp;
@@ -69,6 +69,10 @@ extern "C" {
 #define BUF_CACHE_SIZE          256
 #define BUF_CACHE_HASH_SIZE     64
 
+	/* FAT sectors read ahead when a chain walks the FAT */
+	/* in order (0 for no readahead)                    */
+#define FAT_RA_SECTORS          32
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
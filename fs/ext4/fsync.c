@@ -211,6 +211,15 @@ int ext4_sync_file(struct file *file, int datasync)
 		goto out;
 	}
 
+	/*
+	 * fsync_datasync makes fsync() of a regular file wait only for
+	 * what fdatasync() covers: data, size and block map. An overwrite
+	 * that only moved the timestamps then costs a cache flush instead
+	 * of a full journal commit.
+	 */
+	if (EXT4_SB(inode->i_sb)->s_fsync_datasync && S_ISREG(inode->i_mode))
+		datasync = 1;
+
 	commit_tid = datasync ? ei->i_datasync_tid : ei->i_sync_tid;
 	if (journal->j_flags & JBD2_BARRIER &&
 	    !jbd2_trans_will_send_data_barrier(journal, commit_tid))
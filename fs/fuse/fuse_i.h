@@ -23,8 +23,12 @@
 #include <linux/poll.h>
 #include <linux/workqueue.h>
 
-/** Max number of pages that can be used in a single read request */
-#define FUSE_MAX_PAGES_PER_REQ 32
+/**
+ * Max number of pages that can be used in a single request. Buffered
+ * writes are also bounded by the max_write the daemon asked for in INIT,
+ * and reads by max_read and the readahead window it accepted.
+ */
+#define FUSE_MAX_PAGES_PER_REQ 64
 
 /** Bias for fi->writectr, meaning new writepages must not be sent */
 #define FUSE_NOWRITE INT_MIN
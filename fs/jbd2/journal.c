@@ -790,6 +790,12 @@ static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 	    s->stats->run.rs_blocks / s->stats->ts_tid);
 	seq_printf(seq, "  %lu logged blocks per transaction\n",
 	    s->stats->run.rs_blocks_logged / s->stats->ts_tid);
+	seq_printf(seq, "  %lu transactions per minute\n",
+	    s->stats->ts_tid * 60 /
+	    max(1UL, (jiffies - s->journal->j_stats_start) / HZ));
+	seq_printf(seq, "%lu sync batch waits, %lu joined, wait ratio %u/%u\n",
+	    s->journal->j_batch_waits, s->journal->j_batch_joined,
+	    s->journal->j_batch_ratio, JBD2_BATCH_RATIO_ONE);
 	return 0;
 }
 
@@ -903,6 +909,8 @@ static journal_t * journal_init_common (void)
 	journal->j_commit_interval = (HZ * JBD2_DEFAULT_MAX_COMMIT_AGE);
 	journal->j_min_batch_time = 0;
 	journal->j_max_batch_time = 15000; /* 15ms */
+	journal->j_batch_ratio = JBD2_BATCH_RATIO_ONE;
+	journal->j_stats_start = jiffies;
 
 	/* The journal is marked for error until we succeed with recovery! */
 	journal->j_flags = JBD2_ABORT;
@@ -1337,10 +1337,15 @@ int jbd2_journal_stop(handle_t *handle)
 	 * to perform a synchronous write.  We do this to detect the
 	 * case where a single process is doing a stream of sync
 	 * writes.  No point in waiting for joiners in that case.
+	 *
+	 * The sleep is further scaled by how often the recent ones saw
+	 * another handle join, so that sync writers which take turns
+	 * without overlapping only pay a fraction of it.
 	 */
 	pid = current->pid;
 	if (handle->h_sync && journal->j_last_sync_writer != pid) {
 		u64 commit_time, trans_time;
+		int handles;
 
 		journal->j_last_sync_writer = pid;
 
@@ -1348,6 +1353,9 @@ int jbd2_journal_stop(handle_t *handle)
 		commit_time = journal->j_average_commit_time;
 		read_unlock(&journal->j_state_lock);
 
+		commit_time = div_u64(commit_time * journal->j_batch_ratio,
+				      JBD2_BATCH_RATIO_ONE);
+
 		trans_time = ktime_to_ns(ktime_sub(ktime_get(),
 						   transaction->t_start_time));
 
@@ -1359,8 +1367,19 @@ int jbd2_journal_stop(handle_t *handle)
 		if (trans_time < commit_time) {
 			ktime_t expires = ktime_add_ns(ktime_get(),
 						       commit_time);
+			u32 ratio = journal->j_batch_ratio * 3;
+
+			handles = atomic_read(&transaction->t_handle_count);
 			set_current_state(TASK_UNINTERRUPTIBLE);
 			schedule_hrtimeout(&expires, HRTIMER_MODE_ABS);
+
+			journal->j_batch_waits++;
+			if (atomic_read(&transaction->t_handle_count) != handles) {
+				journal->j_batch_joined++;
+				ratio += JBD2_BATCH_RATIO_ONE;
+			}
+			journal->j_batch_ratio = max_t(u32, ratio / 4,
+						       JBD2_BATCH_RATIO_MIN);
 		}
 	}
 
@@ -30,6 +30,15 @@
  */
 unsigned int pipe_max_size = 1048576;
 
+/*
+ * The size a pipe grows to by itself, doubling each time a writer fills it,
+ * unless it was sized with F_SETPIPE_SZ. Pages are only allocated for the
+ * data in the pipe, so a bigger pipe costs memory only while its reader
+ * lags, and saves a switch to the reader and back for every 64K moved.
+ * Can be set in /proc/sys/fs/pipe-auto-max-size, 0 disables it.
+ */
+unsigned int pipe_auto_max_size = 262144;
+
 /*
  * Minimum pipe size, as required by POSIX
  */
@@ -480,6 +489,20 @@ static inline int is_packetized(struct file *file)
 	return (file->f_flags & O_DIRECT) != 0;
 }
 
+static long pipe_set_size(struct pipe_inode_info *pipe, unsigned long nr_pages);
+
+/* Called with the pipe locked, when a writer found it full */
+static bool pipe_auto_grow(struct pipe_inode_info *pipe)
+{
+	unsigned long nr_pages = pipe->buffers * 2;
+
+	if (pipe->sized || !pipe->readers ||
+	    nr_pages > (pipe_auto_max_size >> PAGE_SHIFT))
+		return false;
+
+	return pipe_set_size(pipe, nr_pages) > 0;
+}
+
 static ssize_t
 pipe_write(struct kiocb *iocb, const struct iovec *_iov,
 	    unsigned long nr_segs, loff_t ppos)
@@ -626,7 +649,7 @@ redo2:
 			if (!total_len)
 				break;
 		}
-		if (bufs < pipe->buffers)
+		if (bufs < pipe->buffers || pipe_auto_grow(pipe))
 			continue;
 		if (filp->f_flags & O_NONBLOCK) {
 			if (!ret)
@@ -1267,6 +1290,8 @@ long pipe_fcntl(struct file *file, unsigned int cmd, unsigned long arg)
 			goto out;
 		}
 		ret = pipe_set_size(pipe, nr_pages);
+		if (ret > 0)
+			pipe->sized = true;
 		break;
 		}
 	case F_GETPIPE_SZ:
@@ -1067,6 +1067,8 @@ err_sighand:
 	unlock_task_sighand(task, &flags);
 err_task_lock:
 	task_unlock(task);
+	if (!err)
+		lowmem_index_update(task);
 	put_task_struct(task);
 out:
 	return err < 0 ? err : count;
@@ -1202,6 +1204,8 @@ err_sighand:
 	unlock_task_sighand(task, &flags);
 err_task_lock:
 	task_unlock(task);
+	if (!err)
+		lowmem_index_update(task);
 	put_task_struct(task);
 out:
 	return err < 0 ? err : count;
@@ -1411,6 +1415,66 @@ static const struct file_operations proc_pid_sched_operations = {
 
 #endif
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+/*
+ * Wake up to run latency histogram: the bucket bounds in usecs, then the
+ * number of wake ups that waited less than each bound. Writing clears it.
+ */
+static int sched_latency_show(struct seq_file *m, void *v)
+{
+	struct inode *inode = m->private;
+	struct task_struct *p;
+	int i;
+
+	p = get_proc_task(inode);
+	if (!p)
+		return -ESRCH;
+
+	for (i = 0; i < SCHED_LAT_BUCKETS; i++)
+		seq_printf(m, "%s%lu", i ? " " : "", 1UL << i);
+	seq_putc(m, '\n');
+	for (i = 0; i < SCHED_LAT_BUCKETS; i++)
+		seq_printf(m, "%s%u", i ? " " : "",
+			   ACCESS_ONCE(p->sched_lat_hist[i]));
+	seq_putc(m, '\n');
+
+	put_task_struct(p);
+
+	return 0;
+}
+
+static ssize_t
+sched_latency_write(struct file *file, const char __user *buf,
+		    size_t count, loff_t *offset)
+{
+	struct inode *inode = file->f_path.dentry->d_inode;
+	struct task_struct *p;
+
+	p = get_proc_task(inode);
+	if (!p)
+		return -ESRCH;
+	memset(p->sched_lat_hist, 0, sizeof(p->sched_lat_hist));
+
+	put_task_struct(p);
+
+	return count;
+}
+
+static int sched_latency_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, sched_latency_show, inode);
+}
+
+static const struct file_operations proc_pid_sched_latency_operations = {
+	.open		= sched_latency_open,
+	.read		= seq_read,
+	.write		= sched_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+#endif
+
 #ifdef CONFIG_SCHED_AUTOGROUP
 /*
  * Print out autogroup related information:
@@ -2763,6 +2827,9 @@ static const struct pid_entry tgid_base_stuff[] = {
 #ifdef CONFIG_SCHED_DEBUG
 	REG("sched",      S_IRUGO|S_IWUSR, proc_pid_sched_operations),
 #endif
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	REG("sched_latency", S_IRUGO|S_IWUSR, proc_pid_sched_latency_operations),
+#endif
 #ifdef CONFIG_SCHED_AUTOGROUP
 	REG("autogroup",  S_IRUGO|S_IWUSR, proc_pid_sched_autogroup_operations),
 #endif
@@ -2786,6 +2853,7 @@ static const struct pid_entry tgid_base_stuff[] = {
 	REG("mountstats", S_IRUSR, proc_mountstats_operations),
 #ifdef CONFIG_PROC_PAGE_MONITOR
 	REG("clear_refs", S_IWUSR, proc_clear_refs_operations),
+	REG("reclaim",    S_IWUSR, proc_reclaim_operations),
 	REG("smaps",      S_IRUGO, proc_smaps_operations),
 	REG("pagemap",    S_IRUGO, proc_pagemap_operations),
 #endif
@@ -3111,6 +3179,9 @@ static const struct pid_entry tid_base_stuff[] = {
 	INF("limits",	 S_IRUGO, proc_pid_limits),
 #ifdef CONFIG_SCHED_DEBUG
 	REG("sched",     S_IRUGO|S_IWUSR, proc_pid_sched_operations),
+#endif
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	REG("sched_latency", S_IRUGO|S_IWUSR, proc_pid_sched_latency_operations),
 #endif
 	REG("comm",      S_IRUGO|S_IWUSR, proc_pid_set_comm_operations),
 #ifdef CONFIG_HAVE_ARCH_TRACEHOOK
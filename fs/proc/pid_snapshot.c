@@ -0,0 +1,196 @@
+/*
+ * fs/proc/pid_snapshot.c
+ *
+ * /proc/pid_snapshot: a record for every process in one read.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Process trackers such as the Android ActivityManager open and parse
+ * /proc/<pid>/stat, statm and oom_adj of every process on each update,
+ * several syscalls and a seq_file formatting pass per file. Here a read
+ * at offset 0 takes a snapshot of all processes in the reader's pid
+ * namespace as fixed size binary records, so keeping the file open and
+ * calling pread() at 0 refreshes everything in one call. Reads at later
+ * offsets continue the same snapshot.
+ */
+
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/pid_namespace.h>
+#include <linux/pid_snapshot.h>
+#include <linux/proc_fs.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/times.h>
+#include <linux/vmalloc.h>
+
+/* Room for processes forked between sizing the buffer and filling it */
+#define PID_SNAPSHOT_SLACK	32
+
+struct pid_snapshot {
+	struct mutex		lock;
+	struct pid_snapshot_record *records;
+	unsigned int		size;		/* records allocated */
+	size_t			len;		/* bytes in the snapshot */
+};
+
+static char pid_snapshot_state(struct task_struct *p)
+{
+	/* as in task_state_array[] of array.c */
+	static const char letters[] = "RSDTtZXxKW";
+	unsigned int state = (p->state & TASK_REPORT) | p->exit_state;
+	int i = 0;
+
+	while (state && letters[i + 1]) {
+		i++;
+		state >>= 1;
+	}
+	return letters[i];
+}
+
+/* Called under rcu_read_lock(), the same totals as /proc/<pid>/stat */
+static void pid_snapshot_fill(struct pid_snapshot_record *r,
+			      struct task_struct *p, struct pid_namespace *ns)
+{
+	cputime_t utime = cputime_zero, stime = cputime_zero;
+	unsigned long min_flt = 0, maj_flt = 0, flags;
+	struct task_struct *t;
+	struct mm_struct *mm;
+	u64 start_time;
+
+	memset(r, 0, sizeof(*r));
+
+	if (lock_task_sighand(p, &flags)) {
+		t = p;
+		do {
+			min_flt += t->min_flt;
+			maj_flt += t->maj_flt;
+			t = next_thread(t);
+		} while (t != p);
+		min_flt += p->signal->min_flt;
+		maj_flt += p->signal->maj_flt;
+		thread_group_times(p, &utime, &stime);
+
+		r->nr_threads = get_nr_threads(p);
+		r->oom_adj = p->signal->oom_adj;
+		r->oom_score_adj = p->signal->oom_score_adj;
+		unlock_task_sighand(p, &flags);
+	}
+
+	r->utime = cputime_to_clock_t(utime);
+	r->stime = cputime_to_clock_t(stime);
+	r->min_flt = min_flt;
+	r->maj_flt = maj_flt;
+
+	start_time = (u64)p->real_start_time.tv_sec * NSEC_PER_SEC +
+		     p->real_start_time.tv_nsec;
+	r->start_time = nsec_to_clock_t(start_time);
+
+	r->pid = task_tgid_nr_ns(p, ns);
+	r->ppid = task_tgid_nr_ns(rcu_dereference(p->real_parent), ns);
+	r->uid = __task_cred(p)->uid;
+	r->state = pid_snapshot_state(p);
+	get_task_comm(r->comm, p);
+
+	task_lock(p);
+	mm = p->mm;
+	if (mm) {
+		r->rss = get_mm_rss(mm);
+		r->vsize = mm->total_vm;
+	}
+	task_unlock(p);
+}
+
+static int pid_snapshot_take(struct pid_snapshot *s)
+{
+	struct pid_namespace *ns = task_active_pid_ns(current);
+	struct pid_snapshot_record *records;
+	struct task_struct *p;
+	unsigned int size, n = 0;
+
+	size = nr_processes() + PID_SNAPSHOT_SLACK;
+	if (size > s->size) {
+		records = vmalloc(size * sizeof(*records));
+		if (!records)
+			return -ENOMEM;
+		vfree(s->records);
+		s->records = records;
+		s->size = size;
+	}
+
+	/* whatever is forked past the slack shows up in the next snapshot */
+	rcu_read_lock();
+	for_each_process(p) {
+		if (n == s->size)
+			break;
+		if (!pid_alive(p) || !task_tgid_nr_ns(p, ns))
+			continue;
+		pid_snapshot_fill(&s->records[n++], p, ns);
+	}
+	rcu_read_unlock();
+
+	s->len = n * sizeof(*s->records);
+	return 0;
+}
+
+static ssize_t pid_snapshot_read(struct file *file, char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct pid_snapshot *s = file->private_data;
+	ssize_t ret;
+
+	mutex_lock(&s->lock);
+	if (!*ppos) {
+		ret = pid_snapshot_take(s);
+		if (ret)
+			goto out;
+	}
+	ret = simple_read_from_buffer(buf, count, ppos, s->records, s->len);
+out:
+	mutex_unlock(&s->lock);
+
+	return ret;
+}
+
+static int pid_snapshot_open(struct inode *inode, struct file *file)
+{
+	struct pid_snapshot *s;
+
+	s = kzalloc(sizeof(*s), GFP_KERNEL);
+	if (!s)
+		return -ENOMEM;
+	mutex_init(&s->lock);
+	file->private_data = s;
+
+	return 0;
+}
+
+static int pid_snapshot_release(struct inode *inode, struct file *file)
+{
+	struct pid_snapshot *s = file->private_data;
+
+	vfree(s->records);
+	kfree(s);
+
+	return 0;
+}
+
+static const struct file_operations pid_snapshot_fops = {
+	.open		= pid_snapshot_open,
+	.read		= pid_snapshot_read,
+	.llseek		= default_llseek,
+	.release	= pid_snapshot_release,
+};
+
+static int __init proc_pid_snapshot_init(void)
+{
+	proc_create("pid_snapshot", 0444, NULL, &pid_snapshot_fops);
+	return 0;
+}
+module_init(proc_pid_snapshot_init);
@@ -601,6 +601,53 @@ const struct file_operations proc_clear_refs_operations = {
 	.llseek		= noop_llseek,
 };
 
+/*
+ * Writing "anon", "file" or "all" to /proc/pid/reclaim reclaims those
+ * pages that only this process maps, so a backgrounded app can be pushed
+ * out to swap while the foreground one stays resident.
+ */
+static ssize_t reclaim_write(struct file *file, const char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct task_struct *task;
+	char buffer[PROC_NUMBUF];
+	struct mm_struct *mm;
+	unsigned int type;
+	char *s;
+
+	memset(buffer, 0, sizeof(buffer));
+	if (count > sizeof(buffer) - 1)
+		count = sizeof(buffer) - 1;
+	if (copy_from_user(buffer, buf, count))
+		return -EFAULT;
+	s = strstrip(buffer);
+	if (strcmp(s, "anon") == 0)
+		type = RECLAIM_MM_ANON;
+	else if (strcmp(s, "file") == 0)
+		type = RECLAIM_MM_FILE;
+	else if (strcmp(s, "all") == 0)
+		type = RECLAIM_MM_ANON | RECLAIM_MM_FILE;
+	else
+		return -EINVAL;
+
+	task = get_proc_task(file->f_path.dentry->d_inode);
+	if (!task)
+		return -ESRCH;
+	mm = get_task_mm(task);
+	if (mm) {
+		reclaim_mm_pages(mm, type);
+		mmput(mm);
+	}
+	put_task_struct(task);
+
+	return count;
+}
+
+const struct file_operations proc_reclaim_operations = {
+	.write		= reclaim_write,
+	.llseek		= noop_llseek,
+};
+
 struct pagemapread {
 	int pos, len;
 	u64 *buffer;
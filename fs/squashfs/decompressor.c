@@ -25,6 +25,8 @@
 #include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/buffer_head.h>
+#include <linux/cpumask.h>
+#include <linux/sched.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -77,34 +79,196 @@ const struct squashfs_decompressor *squashfs_lookup_decompressor(int id)
 }
 
 
+/*
+ * The decompressors wait for the buffer heads of a block as they go, so
+ * with a single stream a reader waiting on the device holds up readers
+ * whose blocks are already in memory. Each reader takes a stream of its
+ * own from a pool instead. The pool starts with one stream and grows up
+ * to squashfs_max_decompressors() only when readers actually contend,
+ * as an xz stream preallocates a dictionary of up to the block size.
+ */
+struct squashfs_stream {
+	void			*stream;
+	struct list_head	list;
+};
+
+struct squashfs_stream_pool {
+	struct mutex		mutex;
+	struct list_head	free;
+	int			total;
+	int			max;
+	wait_queue_head_t	wait;
+	void			*comp_opts;
+	int			comp_opts_len;
+};
+
+
+int squashfs_max_decompressors(void)
+{
+	return num_online_cpus() * 2;
+}
+
+
+static struct squashfs_stream *squashfs_stream_alloc(
+	struct squashfs_sb_info *msblk, struct squashfs_stream_pool *pool)
+{
+	struct squashfs_stream *strm;
+	void *stream;
+
+	strm = kmalloc(sizeof(*strm), GFP_KERNEL);
+	if (strm == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	stream = msblk->decompressor->init(msblk, pool->comp_opts,
+		pool->comp_opts_len);
+	if (IS_ERR(stream)) {
+		kfree(strm);
+		return stream;
+	}
+
+	strm->stream = stream;
+	return strm;
+}
+
+
 void *squashfs_decompressor_init(struct super_block *sb, unsigned short flags)
 {
 	struct squashfs_sb_info *msblk = sb->s_fs_info;
-	void *strm, *buffer = NULL;
-	int length = 0;
+	struct squashfs_stream_pool *pool;
+	struct squashfs_stream *strm;
+	void *buffer = NULL;
+	int length = 0, err;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (pool == NULL)
+		return ERR_PTR(-ENOMEM);
 
 	/*
-	 * Read decompressor specific options from file system if present
+	 * Read decompressor specific options from file system if present,
+	 * and keep them for streams allocated later
 	 */
 	if (SQUASHFS_COMP_OPTS(flags)) {
 		buffer = kmalloc(PAGE_CACHE_SIZE, GFP_KERNEL);
-		if (buffer == NULL)
-			return ERR_PTR(-ENOMEM);
+		if (buffer == NULL) {
+			err = -ENOMEM;
+			goto failed;
+		}
 
 		length = squashfs_read_data(sb, &buffer,
 			sizeof(struct squashfs_super_block), 0, NULL,
 			PAGE_CACHE_SIZE, 1);
 
 		if (length < 0) {
-			strm = ERR_PTR(length);
-			goto finished;
+			err = length;
+			goto failed;
 		}
 	}
 
-	strm = msblk->decompressor->init(msblk, buffer, length);
+	mutex_init(&pool->mutex);
+	INIT_LIST_HEAD(&pool->free);
+	init_waitqueue_head(&pool->wait);
+	pool->max = squashfs_max_decompressors();
+	pool->comp_opts = buffer;
+	pool->comp_opts_len = length;
 
-finished:
+	strm = squashfs_stream_alloc(msblk, pool);
+	if (IS_ERR(strm)) {
+		err = PTR_ERR(strm);
+		goto failed;
+	}
+
+	list_add(&strm->list, &pool->free);
+	pool->total = 1;
+
+	return pool;
+
+failed:
 	kfree(buffer);
+	kfree(pool);
+	return ERR_PTR(err);
+}
 
-	return strm;
+
+void squashfs_decompressor_free(struct squashfs_sb_info *msblk, void *s)
+{
+	struct squashfs_stream_pool *pool = s;
+	struct squashfs_stream *strm, *next;
+
+	if (pool == NULL)
+		return;
+
+	list_for_each_entry_safe(strm, next, &pool->free, list) {
+		msblk->decompressor->free(strm->stream);
+		kfree(strm);
+	}
+
+	kfree(pool->comp_opts);
+	kfree(pool);
+}
+
+
+static struct squashfs_stream *squashfs_get_stream(
+	struct squashfs_sb_info *msblk, struct squashfs_stream_pool *pool)
+{
+	struct squashfs_stream *strm;
+
+	for (;;) {
+		mutex_lock(&pool->mutex);
+
+		if (!list_empty(&pool->free)) {
+			strm = list_first_entry(&pool->free,
+				struct squashfs_stream, list);
+			list_del(&strm->list);
+			mutex_unlock(&pool->mutex);
+			return strm;
+		}
+
+		if (pool->total < pool->max) {
+			pool->total++;
+			mutex_unlock(&pool->mutex);
+
+			strm = squashfs_stream_alloc(msblk, pool);
+			if (!IS_ERR(strm))
+				return strm;
+
+			/* Make do with the streams there are */
+			mutex_lock(&pool->mutex);
+			pool->total--;
+			pool->max = pool->total;
+			mutex_unlock(&pool->mutex);
+			continue;
+		}
+
+		mutex_unlock(&pool->mutex);
+
+		wait_event(pool->wait, !list_empty(&pool->free));
+	}
+}
+
+
+static void squashfs_put_stream(struct squashfs_stream_pool *pool,
+	struct squashfs_stream *strm)
+{
+	mutex_lock(&pool->mutex);
+	list_add(&strm->list, &pool->free);
+	mutex_unlock(&pool->mutex);
+
+	wake_up(&pool->wait);
+}
+
+
+int squashfs_decompress(struct squashfs_sb_info *msblk, void **buffer,
+	struct buffer_head **bh, int b, int offset, int length, int srclength,
+	int pages)
+{
+	struct squashfs_stream_pool *pool = msblk->stream;
+	struct squashfs_stream *strm = squashfs_get_stream(msblk, pool);
+	int res;
+
+	res = msblk->decompressor->decompress(msblk, strm->stream, buffer, bh,
+		b, offset, length, srclength, pages);
+
+	squashfs_put_stream(pool, strm);
+
+	return res;
 }
@@ -16,6 +16,7 @@
 #include <linux/quotaops.h>
 #include <linux/buffer_head.h>
 #include <linux/backing-dev.h>
+#include <linux/fsync_control.h>
 #include "internal.h"
 
 #define VALID_FLAGS (SYNC_FILE_RANGE_WAIT_BEFORE|SYNC_FILE_RANGE_WRITE| \
@@ -211,7 +212,10 @@ static int do_fsync(unsigned int fd, int datasync)
 
 	file = fget(fd);
 	if (file) {
-		ret = vfs_fsync(file, datasync);
+		if (fsynccontrol_skip_fsync(file))
+			ret = 0;
+		else
+			ret = vfs_fsync(file, datasync);
 		fput(file);
 	}
 	return ret;
@@ -68,6 +68,61 @@ static const unsigned char column_parity_table[] = {
 };
 
 
+/* Parity of the bits of a 32-bit word */
+static inline unsigned yaffs_parity32(u32 v)
+{
+	v ^= v >> 16;
+	v ^= v >> 8;
+	return column_parity_table[v & 0xff] & 0x01;
+}
+
+/*
+ * Parities of a 256-byte block, taken a 32-bit word (four bytes of
+ * consecutive index) at a time.
+ *
+ * The column parity table is linear: the entries of the bytes XORed
+ * together are the entry of the bytes' XOR. Bit k of the line parity is
+ * the parity of all the bytes whose index has bit k set. For bits 2..7
+ * that is the parity of the words whose index has bit k-2 set; for bits
+ * 0 and 1, of bytes 1 and 3, and 2 and 3, of the XOR of all the words.
+ */
+static void yaffs_ecc_parity_words(const u32 *data, unsigned char *col,
+				   unsigned char *line)
+{
+	u32 all = 0, w1 = 0, w2 = 0, w4 = 0, w8 = 0, w16 = 0, w32 = 0;
+	u32 w;
+	unsigned i;
+
+	for (i = 0; i < 64; i++) {
+		w = le32_to_cpu(data[i]);
+		all ^= w;
+		if (i & 0x01)
+			w1 ^= w;
+		if (i & 0x02)
+			w2 ^= w;
+		if (i & 0x04)
+			w4 ^= w;
+		if (i & 0x08)
+			w8 ^= w;
+		if (i & 0x10)
+			w16 ^= w;
+		if (i & 0x20)
+			w32 ^= w;
+	}
+
+	w = all ^ (all >> 16);
+	*col = column_parity_table[(w ^ (w >> 8)) & 0xff];
+
+	*line = yaffs_parity32(all & 0xff00ff00) |
+		yaffs_parity32(all & 0xffff0000) << 1 |
+		yaffs_parity32(w1) << 2 |
+		yaffs_parity32(w2) << 3 |
+		yaffs_parity32(w4) << 4 |
+		yaffs_parity32(w8) << 5 |
+		yaffs_parity32(w16) << 6 |
+		yaffs_parity32(w32) << 7;
+}
+
 /* Calculate the ECC for a 256-byte block of data */
 void yaffs_ecc_cacl(const unsigned char *data, unsigned char *ecc)
 {
@@ -79,13 +134,22 @@ void yaffs_ecc_cacl(const unsigned char *data, unsigned char *ecc)
 	unsigned char t;
 	unsigned char b;
 
-	for (i = 0; i < 256; i++) {
-		b = column_parity_table[*data++];
-		col_parity ^= b;
-
-		if (b & 0x01) {	/* odd number of bits in the byte */
-			line_parity ^= i;
-			line_parity_prime ^= ~i;
+	if (!((unsigned long)data & 3)) {
+		yaffs_ecc_parity_words((const u32 *)data, &col_parity,
+				       &line_parity);
+		/* ~i is i ^ 0xff: once for every byte of odd parity */
+		line_parity_prime = line_parity;
+		if (col_parity & 0x01)
+			line_parity_prime ^= 0xff;
+	} else {
+		for (i = 0; i < 256; i++) {
+			b = column_parity_table[*data++];
+			col_parity ^= b;
+
+			if (b & 0x01) {	/* odd number of bits in the byte */
+				line_parity ^= i;
+				line_parity_prime ^= ~i;
+			}
 		}
 	}
 
@@ -742,8 +742,42 @@ static void yaffs_free_tnode(struct yaffs_dev *dev, struct yaffs_tnode *tn)
 	dev->checkpoint_blocks_required = 0;	/* force recalculation */
 }
 
+static void yaffs_free_tnode_tree(struct yaffs_dev *dev,
+				  struct yaffs_tnode *tn, int level)
+{
+	int i;
+
+	if (!tn)
+		return;
+
+	if (level > 0)
+		for (i = 0; i < YAFFS_NTNODES_INTERNAL; i++)
+			yaffs_free_tnode_tree(dev, tn->internal[i], level - 1);
+
+	yaffs_free_raw_tnode(dev, tn);
+}
+
+/* Hand every object and tnode back before the allocator goes away */
 static void yaffs_deinit_tnodes_and_objs(struct yaffs_dev *dev)
 {
+	struct yaffs_obj *obj;
+	struct list_head *i;
+	struct list_head *n;
+	int b;
+
+	for (b = 0; b < YAFFS_NOBJECT_BUCKETS; b++) {
+		list_for_each_safe(i, n, &dev->obj_bucket[b].list) {
+			obj = list_entry(i, struct yaffs_obj, hash_link);
+			if (obj->variant_type == YAFFS_OBJECT_TYPE_FILE)
+				yaffs_free_tnode_tree(dev,
+					obj->variant.file_variant.top,
+					obj->variant.file_variant.top_level);
+			yaffs_free_raw_obj(dev, obj);
+		}
+		INIT_LIST_HEAD(&dev->obj_bucket[b].list);
+		dev->obj_bucket[b].count = 0;
+	}
+
 	yaffs_deinit_raw_tnodes_and_objs(dev);
 	dev->n_obj = 0;
 	dev->n_tnodes = 0;
@@ -2883,8 +2917,17 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
  * The idea is to help clear out space in a more spread-out manner.
  * Dunno if it really does anything useful.
  */
+static void yaffs_account_fg_gc(struct yaffs_dev *dev, s64 us)
+{
+	dev->fg_gcs++;
+	dev->fg_gc_us += us;
+	if (us > dev->fg_gc_max_us)
+		dev->fg_gc_max_us = us;
+}
+
 static int yaffs_check_gc(struct yaffs_dev *dev, int background)
 {
+	s64 start = 0;
 	int aggressive = 0;
 	int gc_ok = YAFFS_OK;
 	int max_tries = 0;
@@ -2958,7 +3001,11 @@ static int yaffs_check_gc(struct yaffs_dev *dev, int background)
 				"yaffs: GC n_erased_blocks %d aggressive %d",
 				dev->n_erased_blocks, aggressive);
 
+			if (!background)
+				start = Y_TIME_US();
 			gc_ok = yaffs_gc_block(dev, dev->gc_block, aggressive);
+			if (!background)
+				yaffs_account_fg_gc(dev, Y_TIME_US() - start);
 		}
 
 		if (dev->n_erased_blocks < (dev->param.n_reserved_blocks)
@@ -4916,6 +4963,9 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	dev->passive_gc_count = 0;
 	dev->oldest_dirty_gc_count = 0;
 	dev->bg_gcs = 0;
+	dev->fg_gcs = 0;
+	dev->fg_gc_us = 0;
+	dev->fg_gc_max_us = 0;
 	dev->gc_block_finder = 0;
 	dev->buffered_block = -1;
 	dev->doing_buffered_block_rewrite = 0;
@@ -724,6 +724,9 @@ struct yaffs_dev {
 	u32 oldest_dirty_gc_count;
 	u32 n_gc_blocks;
 	u32 bg_gcs;
+	u32 fg_gcs;		/* Blocks collected on the write path */
+	u64 fg_gc_us;
+	u32 fg_gc_max_us;
 	u32 n_retired_writes;
 	u32 n_retired_blocks;
 	u32 n_ecc_fixed;
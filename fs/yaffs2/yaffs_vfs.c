@@ -54,6 +54,9 @@
 #include <linux/kthread.h>
 #include <linux/delay.h>
 #include <linux/freezer.h>
+#ifdef CONFIG_HAS_EARLYSUSPEND
+#include <linux/earlysuspend.h>
+#endif
 
 #include <asm/div64.h>
 
@@ -97,6 +100,8 @@ unsigned int yaffs_wr_attempts = YAFFS_WR_ATTEMPTS;
 unsigned int yaffs_auto_checkpoint = 1;
 unsigned int yaffs_gc_control = 1;
 unsigned int yaffs_bg_enable = 1;
+/* Seconds without writes after which the background thread checkpoints */
+unsigned int yaffs_idle_checkpoint = 60;
 
 /* Module Parameters */
 module_param(yaffs_trace_mask, uint, 0644);
@@ -104,6 +109,22 @@ module_param(yaffs_wr_attempts, uint, 0644);
 module_param(yaffs_auto_checkpoint, uint, 0644);
 module_param(yaffs_gc_control, uint, 0644);
 module_param(yaffs_bg_enable, uint, 0644);
+module_param(yaffs_idle_checkpoint, uint, 0644);
+
+/*
+ * Background gc keeps collecting until this percentage of the free
+ * chunks sits in erased blocks, so that writes find an erased block
+ * and do not have to collect one first. It aims higher while the
+ * device is quiet: screen off or no writes for YAFFS_BG_QUIET_TIME.
+ */
+unsigned int yaffs_bg_gc_pct = 50;
+unsigned int yaffs_bg_gc_quiet_pct = 75;
+module_param(yaffs_bg_gc_pct, uint, 0644);
+module_param(yaffs_bg_gc_quiet_pct, uint, 0644);
+
+#define YAFFS_BG_QUIET_TIME	(2 * HZ)
+
+static int yaffs_screen_off;
 
 
 #define yaffs_inode_to_obj_lv(iptr) ((iptr)->i_private)
@@ -1598,6 +1619,9 @@ static unsigned yaffs_bg_gc_urgency(struct yaffs_dev *dev)
 	    dev->n_erased_blocks * dev->param.chunks_per_block;
 	struct yaffs_linux_context *context = yaffs_dev_to_lc(dev);
 	unsigned scattered = 0;	/* Free chunks not in an erased block */
+	unsigned pct = context->bg_quiet ? yaffs_bg_gc_quiet_pct :
+					   yaffs_bg_gc_pct;
+	unsigned target = dev->n_free_chunks / 100 * min(pct, 100u);
 
 	if (erased_chunks < dev->n_free_chunks)
 		scattered = (dev->n_free_chunks - erased_chunks);
@@ -1606,9 +1630,9 @@ static unsigned yaffs_bg_gc_urgency(struct yaffs_dev *dev)
 		return 0;
 	else if (scattered < (dev->param.chunks_per_block * 2))
 		return 0;
-	else if (erased_chunks > dev->n_free_chunks / 2)
+	else if (erased_chunks > target)
 		return 0;
-	else if (erased_chunks > dev->n_free_chunks / 4)
+	else if (erased_chunks > target / 2)
 		return 1;
 	else
 		return 2;
@@ -1654,6 +1678,10 @@ static int yaffs_do_sync_fs(struct super_block *sb, int request_checkpoint)
  * The thread should only run after the yaffs is initialised
  * The thread should be stopped before yaffs is unmounted.
  * The thread should not do any writing while the fs is in read only.
+ *
+ * Once no page has been written for yaffs_idle_checkpoint seconds the
+ * thread writes a checkpoint, so that a power cut while the device
+ * sits idle is followed by a checkpoint restore instead of a scan.
  */
 
 void yaffs_background_waker(unsigned long data)
@@ -1668,6 +1696,10 @@ static int yaffs_bg_thread_fn(void *data)
 	unsigned long now = jiffies;
 	unsigned long next_dir_update = now;
 	unsigned long next_gc = now;
+	unsigned long last_write = now;
+	u32 last_writes = dev->n_page_writes;
+	unsigned long last_user_write = now;
+	u32 user_writes = dev->n_page_writes - dev->n_gc_copies;
 	unsigned long expires;
 	unsigned int urgency;
 
@@ -1691,6 +1723,14 @@ static int yaffs_bg_thread_fn(void *data)
 
 		now = jiffies;
 
+		/* gc copies are our own writes, they do not end quiet */
+		if (dev->n_page_writes - dev->n_gc_copies != user_writes) {
+			user_writes = dev->n_page_writes - dev->n_gc_copies;
+			last_user_write = now;
+		}
+		context->bg_quiet = yaffs_screen_off ||
+		    time_after(now, last_user_write + YAFFS_BG_QUIET_TIME);
+
 		if (time_after(now, next_dir_update) && yaffs_bg_enable) {
 			yaffs_update_dirty_dirs(dev);
 			next_dir_update = now + HZ;
@@ -1714,6 +1754,20 @@ static int yaffs_bg_thread_fn(void *data)
 				next_gc = next_dir_update;
                         }
 		}
+
+		if (dev->n_page_writes != last_writes) {
+			last_writes = dev->n_page_writes;
+			last_write = now;
+		} else if (yaffs_idle_checkpoint && yaffs_bg_enable &&
+			   !dev->is_checkpointed &&
+			   time_after(now, last_write +
+				      yaffs_idle_checkpoint * HZ) &&
+			   !yaffs_bg_gc_urgency(dev)) {
+			yaffs_trace(YAFFS_TRACE_BACKGROUND | YAFFS_TRACE_CHECKPOINT,
+				"yaffs_background idle checkpoint");
+			yaffs_flush_super(context->super, 1);
+			context->super->s_dirt = 0;
+		}
 		yaffs_gross_unlock(dev);
 		expires = next_dir_update;
 		if (time_before(next_gc, expires))
@@ -2505,6 +2559,15 @@ static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 	buf += sprintf(buf, "\n");
 	buf += sprintf(buf, "n_tnodes.............. %d\n", dev->n_tnodes);
 	buf += sprintf(buf, "n_obj................. %d\n", dev->n_obj);
+	buf += sprintf(buf, "tnode_size............ %d\n", dev->tnode_size);
+	buf += sprintf(buf, "tnode_bytes........... %d\n",
+			dev->n_tnodes * dev->tnode_size);
+	buf += sprintf(buf, "obj_bytes............. %d\n",
+			dev->n_obj * (int)sizeof(struct yaffs_obj));
+	buf += sprintf(buf, "block_info_bytes...... %d\n",
+			(dev->internal_end_block - dev->internal_start_block + 1) *
+			((int)sizeof(struct yaffs_block_info) +
+			 dev->chunk_bit_stride));
 	buf += sprintf(buf, "n_free_chunks......... %d\n", dev->n_free_chunks);
 	buf += sprintf(buf, "\n");
 	buf += sprintf(buf, "n_page_writes......... %u\n", dev->n_page_writes);
@@ -2519,6 +2582,10 @@ static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 		    dev->oldest_dirty_gc_count);
 	buf += sprintf(buf, "n_gc_blocks........... %u\n", dev->n_gc_blocks);
 	buf += sprintf(buf, "bg_gcs................ %u\n", dev->bg_gcs);
+	buf += sprintf(buf, "fg_gcs................ %u\n", dev->fg_gcs);
+	buf += sprintf(buf, "fg_gc_us.............. %llu\n",
+			(unsigned long long)dev->fg_gc_us);
+	buf += sprintf(buf, "fg_gc_max_us.......... %u\n", dev->fg_gc_max_us);
 	buf +=
 	    sprintf(buf, "n_retired_writes...... %u\n", dev->n_retired_writes);
 	buf +=
@@ -2753,6 +2820,23 @@ static struct file_system_to_install fs_to_install[] = {
 	{NULL, 0}
 };
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void yaffs_early_suspend(struct early_suspend *h)
+{
+	yaffs_screen_off = 1;
+}
+
+static void yaffs_late_resume(struct early_suspend *h)
+{
+	yaffs_screen_off = 0;
+}
+
+static struct early_suspend yaffs_early_suspend_desc = {
+	.suspend = yaffs_early_suspend,
+	.resume = yaffs_late_resume,
+};
+#endif
+
 static int __init init_yaffs_fs(void)
 {
 	int error = 0;
@@ -2792,6 +2876,11 @@ static int __init init_yaffs_fs(void)
 		fsinst++;
 	}
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	if (!error)
+		register_early_suspend(&yaffs_early_suspend_desc);
+#endif
+
 	/* Any errors? uninstall  */
 	if (error) {
 		fsinst = fs_to_install;
@@ -2816,6 +2905,9 @@ static void __exit exit_yaffs_fs(void)
 	yaffs_trace(YAFFS_TRACE_ALWAYS,
 		"yaffs built " __DATE__ " " __TIME__ " removing.");
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	unregister_early_suspend(&yaffs_early_suspend_desc);
+#endif
 	remove_proc_entry("yaffs", YPROC_ROOT);
 
 	fsinst = fs_to_install;
@@ -28,6 +28,7 @@
 #include <linux/types.h>
 #include <linux/fs.h>
 #include <linux/stat.h>
+#include <linux/ktime.h>
 #include <linux/sort.h>
 #include <linux/bitops.h>
 
@@ -44,6 +45,7 @@
 
 #define Y_CURRENT_TIME CURRENT_TIME.tv_sec
 #define Y_TIME_CONVERT(x) (x).tv_sec
+#define Y_TIME_US() ktime_to_us(ktime_get())
 
 #define compile_time_assertion(assertion) \
 	({ int x = __builtin_choose_expr(assertion, 0, (void)0); (void) x; })
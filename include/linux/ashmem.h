@@ -32,6 +32,15 @@ struct ashmem_pin {
 	__u32 len;	/* length forward from offset, in bytes, page-aligned */
 };
 
+/* Pins or unpins several ranges of a region under one lock */
+struct ashmem_pin_batch {
+	__u32 cmd;	/* ASHMEM_PIN or ASHMEM_UNPIN */
+	__u32 count;	/* number of ranges, at most ASHMEM_PIN_BATCH_MAX */
+	__u64 pins;	/* user pointer to struct ashmem_pin[count] */
+};
+
+#define ASHMEM_PIN_BATCH_MAX	32
+
 #define __ASHMEMIOC		0x77
 
 #define ASHMEM_SET_NAME		_IOW(__ASHMEMIOC, 1, char[ASHMEM_NAME_LEN])
@@ -44,5 +53,6 @@ struct ashmem_pin {
 #define ASHMEM_UNPIN		_IOW(__ASHMEMIOC, 8, struct ashmem_pin)
 #define ASHMEM_GET_PIN_STATUS	_IO(__ASHMEMIOC, 9)
 #define ASHMEM_PURGE_ALL_CACHES	_IO(__ASHMEMIOC, 10)
+#define ASHMEM_PIN_BATCH	_IOW(__ASHMEMIOC, 11, struct ashmem_pin_batch)
 
 #endif	/* _LINUX_ASHMEM_H */
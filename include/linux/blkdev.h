@@ -126,6 +126,9 @@ struct request {
 #ifdef CONFIG_BLK_CGROUP
 	unsigned long long start_time_ns;
 	unsigned long long io_start_time_ns;    /* when passed to hardware */
+#endif
+#ifdef CONFIG_BLK_LATENCY_HIST
+	s64 lat_start_ns;	/* ktime when allocated, for latency_hist */
 #endif
 	/* Number of scatter-gather DMA addr+len pairs after
 	 * physical address coalescing is performed.
@@ -260,6 +263,11 @@ struct queue_limits {
 	unsigned char		discard_zeroes_data;
 };
 
+#define BLK_LAT_BUCKETS		20
+#define BLK_DISCARD_DEFER_MAX	1024
+
+struct blk_deferred_discard;
+
 struct request_queue
 {
 	/*
@@ -362,6 +370,17 @@ struct request_queue
 	int			node;
 #ifdef CONFIG_BLK_DEV_IO_TRACE
 	struct blk_trace	*blk_trace;
+#endif
+#ifdef CONFIG_BLK_DEFERRED_DISCARD
+	struct blk_deferred_discard *deferred_discard;
+	unsigned int		discard_defer_max;	/* pending ranges */
+#endif
+#ifdef CONFIG_BLK_LATENCY_HIST
+	/*
+	 * submit to completion latency in power of two usec buckets, by
+	 * [data direction][sync], protected by the queue lock
+	 */
+	unsigned int		lat_hist[2][2][BLK_LAT_BUCKETS];
 #endif
 	/*
 	 * for flush operations
@@ -924,10 +943,16 @@ static inline struct request *blk_map_queue_find_tag(struct blk_queue_tag *bqt,
 }
 
 #define BLKDEV_DISCARD_SECURE  0x01    /* secure discard */
+#define BLKDEV_DISCARD_DEFER   0x02    /* may be issued later, see blk-discard.c */
 
 extern int blkdev_issue_flush(struct block_device *, gfp_t, sector_t *);
 extern int blkdev_issue_discard(struct block_device *bdev, sector_t sector,
 		sector_t nr_sects, gfp_t gfp_mask, unsigned long flags);
+#ifdef CONFIG_BLK_DEFERRED_DISCARD
+extern void blkdev_flush_deferred_discard(struct block_device *bdev);
+#else
+static inline void blkdev_flush_deferred_discard(struct block_device *bdev) { }
+#endif
 extern int blkdev_issue_zeroout(struct block_device *bdev, sector_t sector,
 			sector_t nr_sects, gfp_t gfp_mask);
 static inline int sb_issue_discard(struct super_block *sb, sector_t block,
@@ -0,0 +1,40 @@
+/*
+ * include/linux/boot_timing.h
+ *
+ * Durations of the initcalls and async work of boot, in /proc/boot_timing.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_BOOT_TIMING_H
+#define _LINUX_BOOT_TIMING_H
+
+#include <linux/types.h>
+#include <linux/hrtimer.h>
+
+#ifdef CONFIG_BOOT_TIMING
+static inline ktime_t boot_timing_start(void)
+{
+	return ktime_get();
+}
+
+void boot_timing_record(void *fn, ktime_t start, bool async);
+void boot_timing_sync_done(ktime_t start);
+#else
+static inline ktime_t boot_timing_start(void)
+{
+	return ktime_set(0, 0);
+}
+
+static inline void boot_timing_record(void *fn, ktime_t start, bool async)
+{
+}
+
+static inline void boot_timing_sync_done(ktime_t start)
+{
+}
+#endif
+
+#endif /* _LINUX_BOOT_TIMING_H */
@@ -19,6 +19,10 @@ extern int sysctl_extfrag_threshold;
 extern int sysctl_extfrag_handler(struct ctl_table *table, int write,
 			void __user *buffer, size_t *length, loff_t *ppos);
 
+extern int sysctl_compact_proactive_order;
+extern int sysctl_compact_proactive_blocks;
+extern int sysctl_compact_proactive_interval;
+
 extern int fragmentation_index(struct zone *zone, unsigned int order);
 extern unsigned long try_to_compact_pages(struct zonelist *zonelist,
 			int order, gfp_t gfp_mask, nodemask_t *mask,
@@ -26,6 +30,7 @@ extern unsigned long try_to_compact_pages(struct zonelist *zonelist,
 extern unsigned long compaction_suitable(struct zone *zone, int order);
 extern unsigned long compact_zone_order(struct zone *zone, int order,
 					gfp_t gfp_mask, bool sync);
+extern void wakeup_kcompactd(void);
 
 /* Do not skip compaction more than 64 times */
 #define COMPACT_MAX_DEFER_SHIFT 6
@@ -75,6 +80,10 @@ static inline unsigned long compact_zone_order(struct zone *zone, int order,
 	return COMPACT_CONTINUE;
 }
 
+static inline void wakeup_kcompactd(void)
+{
+}
+
 static inline void defer_compaction(struct zone *zone)
 {
 }
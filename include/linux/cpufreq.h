@@ -192,6 +192,13 @@ extern int __cpufreq_driver_target(struct cpufreq_policy *policy,
 				   unsigned int target_freq,
 				   unsigned int relation);
 
+/*
+ * Governors deciding on a change ahead of calling the driver stamp the
+ * decision, so that cpufreq_stats can report the delay until it applies.
+ */
+extern void cpufreq_request_mark(unsigned int cpu);
+extern u64 cpufreq_request_time(unsigned int cpu);
+
 
 extern int __cpufreq_driver_getavg(struct cpufreq_policy *policy,
 				   unsigned int cpu);
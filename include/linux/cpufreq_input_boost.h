@@ -0,0 +1,46 @@
+/*
+ *  linux/include/linux/cpufreq_input_boost.h
+ *
+ *  Input boost shared by the cpufreq governors and the bus and GPU
+ *  frequency drivers.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef _LINUX_CPUFREQ_INPUT_BOOST_H
+#define _LINUX_CPUFREQ_INPUT_BOOST_H
+
+#include <linux/notifier.h>
+
+/* Notifier events, the data is unused */
+enum {
+	INPUT_BOOST_START,
+	INPUT_BOOST_END,
+};
+
+/*
+ * Subscribers are called with INPUT_BOOST_START from the input event
+ * path, in atomic context, so that a governor can raise its target right
+ * away; anything that sleeps must be deferred. INPUT_BOOST_END comes
+ * from process context once no input arrived for the boost duration.
+ * While a boost is on, the policy minimum is also raised to the boost
+ * frequency, so every governor sees it on CPUFREQ_GOV_LIMITS.
+ */
+#ifdef CONFIG_CPU_FREQ_INPUT_BOOST
+extern int input_boost_register_notifier(struct notifier_block *nb);
+extern int input_boost_unregister_notifier(struct notifier_block *nb);
+extern bool input_boost_active(void);
+#else
+static inline int input_boost_register_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+static inline int input_boost_unregister_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+static inline bool input_boost_active(void) { return false; }
+#endif
+
+#endif /* _LINUX_CPUFREQ_INPUT_BOOST_H */
@@ -0,0 +1,66 @@
+/*
+ *  linux/include/linux/cpufreq_load.h
+ *
+ *  CPU load tracking shared by the cpufreq governors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef _LINUX_CPUFREQ_LOAD_H
+#define _LINUX_CPUFREQ_LOAD_H
+
+#include <linux/list.h>
+#include <linux/types.h>
+
+/* One load sample, times in usecs */
+struct cpufreq_load_stat {
+	u64 now;
+	unsigned int delta_time;
+	unsigned int delta_idle;
+	unsigned int load;		/* busy percentage of delta_time */
+};
+
+/* Start of the current sample window, in usecs */
+struct cpufreq_load_window {
+	u64 wall;
+	u64 idle;
+};
+
+/*
+ * A governor subscribes one client per CPU. The tracker samples all the
+ * clients of a CPU from a single deferrable timer and calls update()
+ * with the load of the window that just ended, once per period_us. It is
+ * called on the tracked CPU in atomic context and must not call back
+ * into the tracker.
+ *
+ * A window that outlived its period because the CPU was idle is not
+ * reported: it restarts when the CPU leaves idle, so the next sample
+ * covers the work that was just scheduled.
+ */
+struct cpufreq_load_client {
+	void (*update)(struct cpufreq_load_client *client,
+		       const struct cpufreq_load_stat *stat);
+	unsigned int period_us;
+
+	/* private to the tracker */
+	unsigned int cpu;
+	struct cpufreq_load_window window;
+	struct list_head node;
+};
+
+extern u64 cpufreq_load_idle_time(unsigned int cpu, u64 *wall);
+extern void cpufreq_load_window_start(unsigned int cpu,
+				      struct cpufreq_load_window *window);
+extern void cpufreq_load_window_end(unsigned int cpu,
+				    struct cpufreq_load_window *window,
+				    struct cpufreq_load_stat *stat);
+
+extern int cpufreq_load_register(struct cpufreq_load_client *client,
+				 unsigned int cpu);
+extern void cpufreq_load_unregister(struct cpufreq_load_client *client);
+extern void cpufreq_load_restart(struct cpufreq_load_client *client);
+extern void cpufreq_load_set_period(struct cpufreq_load_client *client,
+				    unsigned int period_us);
+
+#endif /* _LINUX_CPUFREQ_LOAD_H */
@@ -413,6 +413,7 @@ struct vm_area_struct;
 struct fb_info;
 struct device;
 struct file;
+struct poll_table_struct;
 
 /* Definitions below are used in the parsed monitor specs */
 #define FB_DPMS_ACTIVE_OFF	1
@@ -634,6 +635,10 @@ struct fb_ops {
 	ssize_t (*fb_write)(struct fb_info *info, const char __user *buf,
 			    size_t count, loff_t *ppos);
 
+	/* For framebuffers that report events, e.g. completed page flips */
+	unsigned int (*fb_poll)(struct fb_info *info, struct file *file,
+				struct poll_table_struct *wait);
+
 	/* checks var and eventually tweaks it to something supported,
 	 * DO NOT MODIFY PAR */
 	int (*fb_check_var)(struct fb_var_screeninfo *var, struct fb_info *info);
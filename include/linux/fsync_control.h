@@ -0,0 +1,24 @@
+/* include/linux/fsync_control.h
+ *
+ * Copyright 2012  Ezekeel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_FSYNC_CONTROL_H
+#define _LINUX_FSYNC_CONTROL_H
+
+struct file;
+
+#ifdef CONFIG_FSYNC_CONTROL
+extern bool fsynccontrol_skip_fsync(struct file *file);
+#else
+static inline bool fsynccontrol_skip_fsync(struct file *file)
+{
+	return false;
+}
+#endif
+
+#endif
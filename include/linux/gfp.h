@@ -372,4 +372,11 @@ extern gfp_t gfp_allowed_mask;
 extern void pm_restrict_gfp_mask(void);
 extern void pm_restore_gfp_mask(void);
 
+#ifdef CONFIG_CMA
+/* The range must lie in a single zone, see mm/page_alloc.c */
+extern int alloc_contig_range(unsigned long start_pfn, unsigned long end_pfn);
+extern void free_contig_range(unsigned long pfn, unsigned long nr_pages);
+extern void init_cma_reserved_pageblock(struct page *page);
+#endif
+
 #endif /* __LINUX_GFP_H */
@@ -146,6 +146,8 @@ typedef void (*ctor_fn_t)(void);
 
 /* Defined in init/main.c */
 extern int do_one_initcall(initcall_t fn);
+extern int deferred_initcalls_done;
+extern void do_deferred_initcalls(void);
 extern char __initdata boot_command_line[];
 extern char *saved_command_line;
 extern unsigned int reset_devices;
@@ -209,6 +211,12 @@ extern int initcall_debug;
 #define late_initcall(fn)		__define_initcall("7",fn,7)
 #define late_initcall_sync(fn)		__define_initcall("7s",fn,7s)
 
+/*
+ * Deferred initcalls run after boot, when userspace writes to
+ * /sys/kernel/deferred_initcalls, for drivers nothing uses until then.
+ */
+#define deferred_initcall(fn)		__define_initcall("deferred",fn,deferred)
+
 #define __initcall(fn) device_initcall(fn)
 
 #define __exitcall(fn) \
@@ -288,6 +296,7 @@ void __init parse_early_options(char *cmdline);
 #define fs_initcall(fn)			module_init(fn)
 #define device_initcall(fn)		module_init(fn)
 #define late_initcall(fn)		module_init(fn)
+#define deferred_initcall(fn)		module_init(fn)
 
 #define security_initcall(fn)		module_init(fn)
 
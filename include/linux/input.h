@@ -1134,6 +1134,7 @@ struct ff_effect {
 
 #include <linux/device.h>
 #include <linux/fs.h>
+#include <linux/hrtimer.h>
 #include <linux/timer.h>
 #include <linux/mod_devicetable.h>
 
@@ -1149,6 +1150,25 @@ struct input_value {
 	__s32 value;
 };
 
+/*
+ * Latency from the device interrupt to its threaded handler, to the
+ * SYN_REPORT of the packet and from there to the evdev read(), in
+ * power of two microsecond buckets.
+ */
+enum {
+	INPUT_LATENCY_THREAD,
+	INPUT_LATENCY_SYNC,
+	INPUT_LATENCY_READ,
+	INPUT_LATENCY_STAGES
+};
+
+#define INPUT_LATENCY_BUCKETS	16
+
+struct input_latency {
+	ktime_t irq;
+	unsigned int hist[INPUT_LATENCY_STAGES][INPUT_LATENCY_BUCKETS];
+};
+
 /**
  * struct input_dev - represents an input device
  * @name: name of the device
@@ -1229,6 +1249,8 @@ struct input_value {
  * @h_list: list of input handles associated with the device. When
  *	accessing the list dev->mutex must be held
  * @node: used to place the device onto input_dev_list
+ * @latency: IRQ timestamp of the packet being built and latency
+ *	histograms, see input_latency_irq()
  */
 struct input_dev {
 	const char *name;
@@ -1300,9 +1322,41 @@ struct input_dev {
 	unsigned int num_vals;
 	unsigned int max_vals;
 	struct input_value *vals;
+
+#ifdef CONFIG_INPUT_LATENCY
+	struct input_latency latency;
+#endif
 };
 #define to_input_dev(d) container_of(d, struct input_dev, dev)
 
+#ifdef CONFIG_INPUT_LATENCY
+void input_latency_account(struct input_dev *dev, int stage, ktime_t start);
+void input_latency_read(struct input_dev *dev, const struct input_event *ev);
+
+/*
+ * Called by a driver from its hard interrupt handler. The stamp is kept
+ * until the SYN_REPORT that ends the packet the interrupt started.
+ */
+static inline void input_latency_irq(struct input_dev *dev)
+{
+	if (!dev->latency.irq.tv64)
+		dev->latency.irq = ktime_get();
+}
+
+/* Called by a driver when its threaded handler starts */
+static inline void input_latency_thread(struct input_dev *dev)
+{
+	if (dev->latency.irq.tv64)
+		input_latency_account(dev, INPUT_LATENCY_THREAD,
+				      dev->latency.irq);
+}
+#else
+static inline void input_latency_read(struct input_dev *dev,
+				      const struct input_event *ev) {}
+static inline void input_latency_irq(struct input_dev *dev) {}
+static inline void input_latency_thread(struct input_dev *dev) {}
+#endif
+
 /*
  * Verify that we are in sync with input_device_id mod_devicetable.h #defines
  */
@@ -63,7 +63,7 @@ enum {
 	SPARE_T41,
 	SPARE_T42,
 	SPARE_T43,
-	SPARE_T44,
+	GEN_MESSAGECOUNT_T44,
 	SPARE_T45,
 	SPARE_T46,
 	SPARE_T47,
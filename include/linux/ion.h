@@ -285,6 +285,24 @@ struct ion_custom_data {
 	unsigned long arg;
 };
 
+#define ION_CACHE_CLEAN		1	/* write back, before the device reads */
+#define ION_CACHE_INVALIDATE	2	/* discard, before the cpu reads */
+#define ION_CACHE_FLUSH		(ION_CACHE_CLEAN | ION_CACHE_INVALIDATE)
+
+#define ION_CACHE_MAX_HANDLES	32
+
+/**
+ * struct ion_cache_data - cache maintenance of several buffers at once
+ * @handles:	array of the handles
+ * @count:	number of handles, at most ION_CACHE_MAX_HANDLES
+ * @op:		ION_CACHE_CLEAN, ION_CACHE_INVALIDATE or ION_CACHE_FLUSH
+ */
+struct ion_cache_data {
+	struct ion_handle **handles;
+	unsigned int count;
+	unsigned int op;
+};
+
 #define ION_IOC_MAGIC		'I'
 
 /**
@@ -341,4 +359,13 @@ struct ion_custom_data {
  */
 #define ION_IOC_CUSTOM		_IOWR(ION_IOC_MAGIC, 6, struct ion_custom_data)
 
+/**
+ * DOC: ION_IOC_CACHE_OPS - cache maintenance of a set of buffers
+ *
+ * Takes an ion_cache_data struct. Buffers of heaps that are not mapped
+ * cached are skipped. Large batches are cleaned by flushing the whole
+ * cache once instead of buffer by buffer.
+ */
+#define ION_IOC_CACHE_OPS	_IOW(ION_IOC_MAGIC, 7, struct ion_cache_data)
+
 #endif /* _LINUX_ION_H */
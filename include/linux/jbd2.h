@@ -48,6 +48,9 @@
  * The default maximum commit age, in seconds.
  */
 #define JBD2_DEFAULT_MAX_COMMIT_AGE 5
+#define JBD2_BATCH_RATIO_ONE	256
+/* Keep sleeping a little, or a ratio of 0 could never see a joiner */
+#define JBD2_BATCH_RATIO_MIN	(JBD2_BATCH_RATIO_ONE / 16)
 
 #ifdef CONFIG_JBD2_DEBUG
 /*
@@ -983,6 +986,16 @@ struct journal_s
 	u32			j_min_batch_time;
 	u32			j_max_batch_time;
 
+	/*
+	 * How often a batching sleep saw another handle join, as a running
+	 * average in 1/JBD2_BATCH_RATIO_ONE units. It scales the sleep, so
+	 * writers that take turns without really overlapping stop paying
+	 * a commit time of latency on every fsync.
+	 */
+	u32			j_batch_ratio;
+	unsigned long		j_batch_waits;
+	unsigned long		j_batch_joined;
+
 	/* This function is called when a transaction is closed */
 	void			(*j_commit_callback)(journal_t *,
 						     transaction_t *);
@@ -993,6 +1006,7 @@ struct journal_s
 	spinlock_t		j_history_lock;
 	struct proc_dir_entry	*j_proc_entry;
 	struct transaction_stats_s j_stats;
+	unsigned long		j_stats_start;	/* jiffies at journal load */
 
 	/* Failed journal commit ID */
 	unsigned int		j_failed_commit;
@@ -0,0 +1,42 @@
+/*
+ * include/linux/launch_prefetch.h
+ *
+ * Replay of the file readahead seen during earlier launches of a process.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_LAUNCH_PREFETCH_H
+#define _LINUX_LAUNCH_PREFETCH_H
+
+#include <linux/types.h>
+
+struct address_space;
+struct file;
+struct task_struct;
+
+#ifdef CONFIG_LAUNCH_PREFETCH
+void launch_prefetch_start(struct task_struct *tsk);
+void launch_prefetch_replay(struct address_space *mapping, struct file *filp);
+void launch_prefetch_record(struct address_space *mapping, pgoff_t offset,
+			    unsigned long nr_pages);
+#else
+static inline void launch_prefetch_start(struct task_struct *tsk)
+{
+}
+
+static inline void launch_prefetch_replay(struct address_space *mapping,
+					  struct file *filp)
+{
+}
+
+static inline void launch_prefetch_record(struct address_space *mapping,
+					  pgoff_t offset,
+					  unsigned long nr_pages)
+{
+}
+#endif
+
+#endif /* _LINUX_LAUNCH_PREFETCH_H */
@@ -0,0 +1,25 @@
+#ifndef __LZ4_H__
+#define __LZ4_H__
+/*
+ * LZ4 Kernel Interface
+ *
+ * Decompression of the LZ4 block format, as written by the reference
+ * implementation at http://code.google.com/p/lz4/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Largest compressed size of isize bytes */
+#define lz4_compressbound(isize)	((isize) + ((isize) / 255) + 16)
+
+/*
+ * Decompresses src_len bytes of a block into at most *dest_len bytes,
+ * and sets *dest_len to the decompressed size. Returns 0, or -1 if the
+ * block is corrupt or does not fit.
+ */
+int lz4_decompress_unknownoutputsize(const unsigned char *src, size_t src_len,
+				     unsigned char *dest, size_t *dest_len);
+
+#endif
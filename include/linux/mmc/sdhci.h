@@ -137,6 +137,7 @@ struct sdhci_host {
 
 	int sg_count;		/* Mapped sg entries */
 
+	unsigned int adma_max_segs;	/* ADMA sg entries, 0 for default */
 	u8 *adma_desc;		/* ADMA descriptor table */
 	u8 *align_buffer;	/* Bounce buffer */
 
@@ -40,8 +40,20 @@
 #define MIGRATE_MOVABLE       2
 #define MIGRATE_PCPTYPES      3 /* the number of types on the pcp lists */
 #define MIGRATE_RESERVE       3
+#ifdef CONFIG_CMA
+#define MIGRATE_CMA           4 /* lent to movable allocations only */
+#define MIGRATE_ISOLATE       5 /* can't allocate from here */
+#define MIGRATE_TYPES         6
+#else
 #define MIGRATE_ISOLATE       4 /* can't allocate from here */
 #define MIGRATE_TYPES         5
+#endif
+
+#ifdef CONFIG_CMA
+#  define is_migrate_cma(migratetype) unlikely((migratetype) == MIGRATE_CMA)
+#else
+#  define is_migrate_cma(migratetype) false
+#endif
 
 #define for_each_migratetype_order(order, type) \
 	for (order = 0; order < MAX_ORDER; order++) \
@@ -117,6 +129,9 @@ enum zone_stat_item {
 	NR_ANON_TRANSPARENT_HUGEPAGES,
 #ifdef CONFIG_UKSM
 	NR_UKSM_ZERO_PAGES,
+#endif
+#ifdef CONFIG_CMA
+	NR_FREE_CMA_PAGES,	/* free pages of MIGRATE_CMA pageblocks */
 #endif
 	NR_VM_ZONE_STAT_ITEMS };
 
@@ -186,6 +201,9 @@ enum zone_watermarks {
 #define low_wmark_pages(z) (z->watermark[WMARK_LOW])
 #define high_wmark_pages(z) (z->watermark[WMARK_HIGH])
 
+/* Highest order kept on the per-cpu lists besides order-0 */
+#define PCP_HIGH_ORDERS		3
+
 struct per_cpu_pages {
 	int count;		/* number of pages in the list */
 	int high;		/* high watermark, emptying needed */
@@ -193,6 +211,10 @@ struct per_cpu_pages {
 
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[MIGRATE_PCPTYPES];
+
+	/* Freed blocks of order 1 to PCP_HIGH_ORDERS, one list per order */
+	int high_count[PCP_HIGH_ORDERS];
+	struct list_head high_lists[PCP_HIGH_ORDERS];
 };
 
 struct per_cpu_pageset {
@@ -70,6 +70,24 @@ extern unsigned long badness(struct task_struct *p, struct mem_cgroup *mem,
 
 extern struct task_struct *find_lock_task_mm(struct task_struct *p);
 
+/*
+ * Keep the lowmemorykiller oom_adj index in sync with thread groups, and
+ * feed it reclaim efficiency for its pressure events.
+ */
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER
+extern void lowmem_index_add(struct task_struct *p);
+extern void lowmem_index_del(struct task_struct *p);
+extern void lowmem_index_update(struct task_struct *p);
+extern void lowmem_vmpressure(gfp_t gfp_mask, unsigned long scanned,
+			      unsigned long reclaimed);
+#else
+static inline void lowmem_index_add(struct task_struct *p) { }
+static inline void lowmem_index_del(struct task_struct *p) { }
+static inline void lowmem_index_update(struct task_struct *p) { }
+static inline void lowmem_vmpressure(gfp_t gfp_mask, unsigned long scanned,
+				     unsigned long reclaimed) { }
+#endif
+
 /* sysctls */
 extern int sysctl_oom_dump_tasks;
 extern int sysctl_oom_kill_allocating_task;
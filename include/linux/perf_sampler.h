@@ -0,0 +1,33 @@
+/*
+ * include/linux/perf_sampler.h
+ *
+ * Records read from /dev/perf_sampler.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_PERF_SAMPLER_H
+#define _LINUX_PERF_SAMPLER_H
+
+#include <linux/types.h>
+
+/* perf_sampler_record.event */
+#define PERF_SAMPLER_CYCLES		0
+#define PERF_SAMPLER_CACHE_MISSES	1
+
+/* perf_sampler_record.flags */
+#define PERF_SAMPLER_USER		0x1	/* ip is a user address */
+
+struct perf_sampler_record {
+	__u64	time;		/* local_clock() in ns */
+	__u64	ip;
+	__u32	pid;		/* thread, 0 for the idle task */
+	__u32	tgid;
+	__u16	event;
+	__u16	flags;
+	__u32	cpu;
+};
+
+#endif /* _LINUX_PERF_SAMPLER_H */
@@ -0,0 +1,40 @@
+/*
+ * include/linux/pid_snapshot.h
+ *
+ * Records read from /proc/pid_snapshot.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_PID_SNAPSHOT_H
+#define _LINUX_PID_SNAPSHOT_H
+
+#include <linux/types.h>
+
+/*
+ * One per process, with the fields of /proc/<pid>/stat, statm and oom_adj
+ * that process trackers poll. Times are in clock ticks and sizes in
+ * pages, as there.
+ */
+struct pid_snapshot_record {
+	__u64	utime;
+	__u64	stime;
+	__u64	start_time;	/* since boot */
+	__u32	pid;
+	__u32	ppid;
+	__u32	uid;
+	__u32	nr_threads;
+	__u32	rss;
+	__u32	vsize;
+	__u32	min_flt;
+	__u32	maj_flt;
+	__s16	oom_adj;
+	__s16	oom_score_adj;
+	char	state;		/* the letter of /proc/<pid>/stat */
+	__u8	pad[3];
+	char	comm[16];
+};
+
+#endif /* _LINUX_PID_SNAPSHOT_H */
@@ -653,6 +653,9 @@ struct signal_struct {
 	int oom_score_adj;	/* OOM kill score adjustment */
 	int oom_score_adj_min;	/* OOM kill score adjustment minimum value.
 				 * Only settable by CAP_SYS_RESOURCE. */
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER
+	struct list_head lmk_node;	/* lowmemorykiller oom_adj bucket */
+#endif
 
 	struct mutex cred_guard_mutex;	/* guard against foreign influences on
 					 * credential calculations
@@ -1222,6 +1225,21 @@ enum perf_event_task_context {
 	perf_nr_task_contexts,
 };
 
+/*
+ * Wake up to run latency, bucket i counting the wake ups that waited
+ * less than 2^i usecs. The last bucket takes everything longer.
+ */
+#define SCHED_LAT_BUCKETS	16
+
+static inline int sched_lat_bucket(u64 delta_ns)
+{
+	u64 us = delta_ns >> 10;	/* close enough to usecs */
+
+	if (us >= 1UL << (SCHED_LAT_BUCKETS - 2))
+		return SCHED_LAT_BUCKETS - 1;
+	return fls_long((unsigned long)us);
+}
+
 struct task_struct {
 	volatile long state;	/* -1 unrunnable, 0 runnable, >0 stopped */
 	void *stack;
@@ -1257,6 +1275,12 @@ struct task_struct {
 	struct sched_entity se;
 	struct sched_rt_entity rt;
 #endif
+#if defined(CONFIG_SCHED_BFS) || defined(CONFIG_SCHED_LATENCY_HIST)
+	u64 wakeup_stamp; /* rq clock when woken up, 0 once it ran */
+#endif
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	unsigned int sched_lat_hist[SCHED_LAT_BUCKETS];
+#endif
 
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	/* list of struct preempt_notifier: */
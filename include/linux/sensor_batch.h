@@ -0,0 +1,58 @@
+/*
+ * include/linux/sensor_batch.h
+ *
+ * Batched delivery of polled sensor samples through an input device.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_SENSOR_BATCH_H
+#define _LINUX_SENSOR_BATCH_H
+
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/types.h>
+
+#define SENSOR_BATCH_MAX_AXES	3
+
+struct input_dev;
+
+struct sensor_batch_sample {
+	ktime_t time;
+	int val[SENSOR_BATCH_MAX_AXES];
+};
+
+/*
+ * With max_latency_ns at 0 every sample is reported as it is added,
+ * as the drivers always did. Otherwise samples wait in the ring until
+ * the oldest is max_latency_ns old or the ring is full, and are then
+ * reported back to back. Each batched sample is preceded by an
+ * EV_MSC/MSC_RAW event with its age in microseconds at delivery, so
+ * userspace can put the sample back at its real time.
+ */
+struct sensor_batch {
+	struct input_dev *input;
+	unsigned int type;
+	const unsigned int *codes;
+	unsigned int axes;
+	u64 max_latency_ns;
+
+	struct mutex lock;
+	struct sensor_batch_sample *ring;
+	unsigned int size;
+	unsigned int head;
+	unsigned int count;
+};
+
+int sensor_batch_init(struct sensor_batch *batch, struct input_dev *input,
+		      unsigned int type, const unsigned int *codes,
+		      unsigned int axes, unsigned int size);
+void sensor_batch_free(struct sensor_batch *batch);
+void sensor_batch_add(struct sensor_batch *batch, const int *val,
+		      ktime_t time);
+void sensor_batch_flush(struct sensor_batch *batch);
+void sensor_batch_set_latency(struct sensor_batch *batch, u64 ns);
+
+#endif /* _LINUX_SENSOR_BATCH_H */
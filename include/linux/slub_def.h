@@ -40,7 +40,7 @@ struct kmem_cache_cpu {
 	unsigned long tid;	/* Globally unique transaction id */
 	struct page *page;	/* The slab from which we are allocating */
 	int node;		/* The node of the page (or -1 for debug) */
-#ifdef CONFIG_SLUB_STATS
+#if defined(CONFIG_SLUB_STATS) || defined(CONFIG_SLUB_LITE_STATS)
 	unsigned stat[NR_SLUB_STAT_ITEMS];
 #endif
 };
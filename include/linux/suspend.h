@@ -297,6 +297,14 @@ static inline int unregister_pm_notifier(struct notifier_block *nb)
 static inline bool pm_wakeup_pending(void) { return false; }
 #endif /* !CONFIG_PM_SLEEP */
 
+#ifdef CONFIG_SUSPEND_TIME
+/* Account a suspend or resume callback of @name that started at @start */
+extern void suspend_time_record(const char *name, bool resume, ktime_t start);
+#else
+static inline void suspend_time_record(const char *name, bool resume,
+				       ktime_t start) {}
+#endif
+
 extern struct mutex pm_mutex;
 
 #ifndef CONFIG_HIBERNATE_CALLBACKS
@@ -194,6 +194,10 @@ struct swap_info_struct {
 	struct block_device *bdev;	/* swap device or bdev of swap file */
 	struct file *swap_file;		/* seldom referenced */
 	unsigned int old_block_size;	/* seldom referenced */
+#ifdef CONFIG_FRONTSWAP
+	unsigned long *frontswap_map;	/* frontswap in-use, one bit per page */
+	atomic_t frontswap_pages;	/* frontswap pages in-use counter */
+#endif
 };
 
 struct swap_list_t {
@@ -243,6 +247,11 @@ static inline void lru_cache_add_file(struct page *page)
 	__lru_cache_add(page, LRU_INACTIVE_FILE);
 }
 
+/* linux/mm/workingset.c */
+extern void workingset_eviction(struct address_space *mapping,
+				struct page *page);
+extern bool workingset_refault(struct address_space *mapping, pgoff_t index);
+
 /* linux/mm/vmscan.c */
 extern unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 					gfp_t gfp_mask, nodemask_t *mask);
@@ -257,6 +266,33 @@ extern unsigned long mem_cgroup_shrink_node_zone(struct mem_cgroup *mem,
 extern int __isolate_lru_page(struct page *page, isolate_mode_t mode, int file);
 extern unsigned long shrink_all_memory(unsigned long nr_pages);
 extern int vm_swappiness;
+
+/* reclaim_mm_pages() type */
+#define RECLAIM_MM_ANON		0x1
+#define RECLAIM_MM_FILE		0x2
+
+#ifdef CONFIG_MMU
+extern unsigned long reclaim_mm_pages(struct mm_struct *mm, unsigned int type);
+#else
+static inline unsigned long reclaim_mm_pages(struct mm_struct *mm,
+					     unsigned int type)
+{
+	return 0;
+}
+#endif
+
+/* Measured cost of reclaiming a page, see vm_reclaim_cost in vmscan.c */
+enum reclaim_cost_item {
+	RECLAIM_COST_SWAPIN,
+	RECLAIM_COST_SWAPOUT,
+	RECLAIM_COST_FILE,
+	RECLAIM_COST_ANON_PCT,
+	NR_RECLAIM_COST
+};
+
+extern int vm_swap_cost;
+extern unsigned long vm_reclaim_cost[NR_RECLAIM_COST];
+extern void reclaim_cost_account(enum reclaim_cost_item item, u64 start);
 extern int remove_mapping(struct address_space *mapping, struct page *page);
 extern long vm_total_pages;
 
@@ -323,11 +359,12 @@ extern long total_swap_pages;
 extern void si_swapinfo(struct sysinfo *);
 extern swp_entry_t get_swap_page(void);
 extern swp_entry_t get_swap_page_of_type(int);
-extern int valid_swaphandles(swp_entry_t, unsigned long *);
+extern int valid_swaphandles(swp_entry_t, unsigned long *, int);
 extern int add_swap_count_continuation(swp_entry_t, gfp_t);
 extern void swap_shmem_alloc(swp_entry_t);
 extern int swap_duplicate(swp_entry_t);
 extern int swapcache_prepare(swp_entry_t);
+extern int __swap_count(swp_entry_t entry);
 extern void swap_free(swp_entry_t);
 extern void swapcache_free(swp_entry_t, struct page *page);
 extern int free_swap_and_cache(swp_entry_t);
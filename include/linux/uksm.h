@@ -53,6 +53,10 @@ struct vma_slot {
 	unsigned long pages_merged; /* pages merged this round */
 	unsigned long pages_bemerged;
 
+	/* judged rounds to stay in the base rung after COW churn */
+	unsigned int cooldown;
+	unsigned int cow_strikes;
+
 	/* when it has page merged in this eval round */
 	struct list_head dedup_list;
 };
@@ -78,6 +78,8 @@ enum v4l2_photometry_mode {
 #define V4L2_CID_OVERLAY_VADDR2		(V4L2_CID_PRIVATE_BASE + 8)
 #define V4L2_CID_OVLY_MODE		(V4L2_CID_PRIVATE_BASE + 9)
 #define V4L2_CID_DST_INFO		(V4L2_CID_PRIVATE_BASE + 10)
+/* Capture frames flipped onto this fb window by the driver, -1 for none */
+#define V4L2_CID_PREVIEW_FB		(V4L2_CID_PRIVATE_BASE + 11)
 /* UMP secure id control */
 #define V4L2_CID_GET_PHY_SRC_YADDR 	(V4L2_CID_PRIVATE_BASE + 12)
 #define V4L2_CID_GET_PHY_SRC_CADDR 	(V4L2_CID_PRIVATE_BASE + 13)
@@ -88,6 +90,7 @@ enum v4l2_photometry_mode {
 #define V4L2_CID_RESERVED_MEM_BASE_ADDR	(V4L2_CID_PRIVATE_BASE + 20)
 #define V4L2_CID_FIMC_VERSION		(V4L2_CID_PRIVATE_BASE + 21)
 
+#define V4L2_CID_PREVIEW_DROPPED		(V4L2_CID_PRIVATE_BASE + 51)
 #define V4L2_CID_STREAM_PAUSE			(V4L2_CID_PRIVATE_BASE + 53)
 
 /* CID Extensions for camera sensor operations */
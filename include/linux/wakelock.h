@@ -18,6 +18,7 @@
 
 #include <linux/list.h>
 #include <linux/ktime.h>
+#include <linux/types.h>
 
 /* A wake_lock prevents the system from entering suspend or other low power
  * states when active. If the type is set to WAKE_LOCK_SUSPEND, the wake_lock
@@ -52,6 +53,26 @@ struct wake_lock {
 #endif
 };
 
+/* One lock in /proc/wakelocks_bin, followed by its name and padding */
+struct wake_lock_stat_record {
+	__u16 size;		/* of the record, name and padding included */
+	__u16 name_len;
+	__u16 type;
+	__u16 flags;
+	__u32 count;
+	__u32 expire_count;
+	__u32 wakeup_count;
+	__u32 reserved;
+	__s64 active_since;	/* ns, as the columns of /proc/wakelocks */
+	__s64 total_time;
+	__s64 sleep_time;
+	__s64 max_time;
+	__s64 last_change;
+};
+
+#define WAKE_LOCK_STAT_ACTIVE		(1U << 0)
+#define WAKE_LOCK_STAT_AUTO_EXPIRE	(1U << 1)
+
 #ifdef CONFIG_HAS_WAKELOCK
 
 void wake_lock_init(struct wake_lock *lock, int type, const char *name);
@@ -106,6 +106,22 @@ extern int vm_highmem_is_dirtyable;
 extern int block_dump;
 extern int laptop_mode;
 
+/* Writeback settings that follow the screen state */
+struct dirty_profile {
+	int background_ratio;
+	int ratio;
+	unsigned int expire_interval;		/* centiseconds */
+	unsigned int writeback_interval;	/* centiseconds */
+};
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+extern struct dirty_profile dirty_screen_off;
+
+extern int dirty_screen_off_handler(struct ctl_table *table, int write,
+		void __user *buffer, size_t *lenp,
+		loff_t *ppos);
+#endif
+
 extern unsigned long determine_dirtyable_memory(void);
 
 extern int dirty_background_ratio_handler(struct ctl_table *table, int write,
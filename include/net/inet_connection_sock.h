@@ -180,6 +180,21 @@ extern void inet_csk_reset_keepalive_timer(struct sock *sk, unsigned long timeou
 
 #ifdef INET_CSK_DEBUG
 extern const char inet_csk_timer_bug_msg[];
+
+/* Percent of their delay timers may fire late, see inet_csk_timer_slack() */
+extern int sysctl_tcp_timer_slack;
+extern int sysctl_tcp_keepalive_slack;
+
+/*
+ * Let a timer due in when jiffies fire up to pct percent late, in the
+ * tick of other timers due about then, so they share one wakeup. 0 leaves
+ * the default slack of the timer code.
+ */
+static inline void inet_csk_timer_slack(struct timer_list *timer,
+					unsigned long when, int pct)
+{
+	timer->slack = pct > 0 ? when * pct / 100 : -1;
+}
 #endif
 
 static inline void inet_csk_clear_xmit_timer(struct sock *sk, const int what)
@@ -224,10 +239,14 @@ static inline void inet_csk_reset_xmit_timer(struct sock *sk, const int what,
 	if (what == ICSK_TIME_RETRANS || what == ICSK_TIME_PROBE0) {
 		icsk->icsk_pending = what;
 		icsk->icsk_timeout = jiffies + when;
+		inet_csk_timer_slack(&icsk->icsk_retransmit_timer, when,
+				     sysctl_tcp_timer_slack);
 		sk_reset_timer(sk, &icsk->icsk_retransmit_timer, icsk->icsk_timeout);
 	} else if (what == ICSK_TIME_DACK) {
 		icsk->icsk_ack.pending |= ICSK_ACK_TIMER;
 		icsk->icsk_ack.timeout = jiffies + when;
+		inet_csk_timer_slack(&icsk->icsk_delack_timer, when,
+				     sysctl_tcp_timer_slack);
 		sk_reset_timer(sk, &icsk->icsk_delack_timer, icsk->icsk_ack.timeout);
 	}
 #ifdef INET_CSK_DEBUG
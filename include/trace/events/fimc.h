@@ -0,0 +1,54 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM fimc
+
+#if !defined(_TRACE_FIMC_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_FIMC_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(fimc_job,
+
+	TP_PROTO(int id, int idx),
+
+	TP_ARGS(id, idx),
+
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(int, idx)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->idx = idx;
+	),
+
+	TP_printk("fimc%d %d", __entry->id, __entry->idx)
+);
+
+/* idx is the output context */
+DEFINE_EVENT(fimc_job, fimc_out_start,
+
+	TP_PROTO(int id, int idx),
+
+	TP_ARGS(id, idx)
+);
+
+DEFINE_EVENT(fimc_job, fimc_out_done,
+
+	TP_PROTO(int id, int idx),
+
+	TP_ARGS(id, idx)
+);
+
+/* idx is the capture buffer written */
+DEFINE_EVENT(fimc_job, fimc_cap_done,
+
+	TP_PROTO(int id, int idx),
+
+	TP_ARGS(id, idx)
+);
+
+#endif /* if !defined(_TRACE_FIMC_H) || defined(TRACE_HEADER_MULTI_READ) */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,57 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM mfc
+
+#if !defined(_TRACE_MFC_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_MFC_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(mfc_frame_start,
+
+	TP_PROTO(int inst, int encode),
+
+	TP_ARGS(inst, encode),
+
+	TP_STRUCT__entry(
+		__field(int, inst)
+		__field(int, encode)
+	),
+
+	TP_fast_assign(
+		__entry->inst = inst;
+		__entry->encode = encode;
+	),
+
+	TP_printk("inst=%d %s", __entry->inst,
+		__entry->encode ? "encode" : "decode")
+);
+
+TRACE_EVENT(mfc_frame_done,
+
+	TP_PROTO(int inst, int encode, int intr, int err),
+
+	TP_ARGS(inst, encode, intr, err),
+
+	TP_STRUCT__entry(
+		__field(int, inst)
+		__field(int, encode)
+		__field(int, intr)
+		__field(int, err)
+	),
+
+	TP_fast_assign(
+		__entry->inst = inst;
+		__entry->encode = encode;
+		__entry->intr = intr;
+		__entry->err = err;
+	),
+
+	TP_printk("inst=%d %s intr=%d err=%d", __entry->inst,
+		__entry->encode ? "encode" : "decode",
+		__entry->intr, __entry->err)
+);
+
+#endif /* if !defined(_TRACE_MFC_H) || defined(TRACE_HEADER_MULTI_READ) */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,45 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM onedram
+
+#if !defined(_TRACE_ONEDRAM_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_ONEDRAM_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(onedram_mailbox,
+
+	TP_PROTO(u32 cmd, int sem),
+
+	TP_ARGS(cmd, sem),
+
+	TP_STRUCT__entry(
+		__field(u32, cmd)
+		__field(int, sem)
+	),
+
+	TP_fast_assign(
+		__entry->cmd = cmd;
+		__entry->sem = sem;
+	),
+
+	TP_printk("cmd=0x%08x sem=%d", __entry->cmd, __entry->sem)
+);
+
+DEFINE_EVENT(onedram_mailbox, onedram_mailbox_send,
+
+	TP_PROTO(u32 cmd, int sem),
+
+	TP_ARGS(cmd, sem)
+);
+
+DEFINE_EVENT(onedram_mailbox, onedram_mailbox_recv,
+
+	TP_PROTO(u32 cmd, int sem),
+
+	TP_ARGS(cmd, sem)
+);
+
+#endif /* if !defined(_TRACE_ONEDRAM_H) || defined(TRACE_HEADER_MULTI_READ) */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,46 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM s3c_jpeg
+
+#if !defined(_TRACE_S3C_JPEG_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_S3C_JPEG_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(s3c_jpeg_start,
+
+	TP_PROTO(int decode),
+
+	TP_ARGS(decode),
+
+	TP_STRUCT__entry(
+		__field(int, decode)
+	),
+
+	TP_fast_assign(
+		__entry->decode = decode;
+	),
+
+	TP_printk("%s", __entry->decode ? "decode" : "encode")
+);
+
+TRACE_EVENT(s3c_jpeg_done,
+
+	TP_PROTO(unsigned int status),
+
+	TP_ARGS(status),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, status)
+	),
+
+	TP_fast_assign(
+		__entry->status = status;
+	),
+
+	TP_printk("int_status=0x%02x", __entry->status)
+);
+
+#endif /* if !defined(_TRACE_S3C_JPEG_H) || defined(TRACE_HEADER_MULTI_READ) */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
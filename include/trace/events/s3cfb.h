@@ -0,0 +1,72 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM s3cfb
+
+#if !defined(_TRACE_S3CFB_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_S3CFB_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(s3cfb_vsync,
+
+	TP_PROTO(s64 timestamp),
+
+	TP_ARGS(timestamp),
+
+	TP_STRUCT__entry(
+		__field(s64, timestamp)
+	),
+
+	TP_fast_assign(
+		__entry->timestamp = timestamp;
+	),
+
+	TP_printk("timestamp=%lld", __entry->timestamp)
+);
+
+DECLARE_EVENT_CLASS(s3cfb_flip,
+
+	TP_PROTO(int win, unsigned int yoffset, unsigned int cookie),
+
+	TP_ARGS(win, yoffset, cookie),
+
+	TP_STRUCT__entry(
+		__field(int, win)
+		__field(unsigned int, yoffset)
+		__field(unsigned int, cookie)
+	),
+
+	TP_fast_assign(
+		__entry->win = win;
+		__entry->yoffset = yoffset;
+		__entry->cookie = cookie;
+	),
+
+	TP_printk("win=%d yoffset=%u cookie=%u", __entry->win,
+		__entry->yoffset, __entry->cookie)
+);
+
+DEFINE_EVENT(s3cfb_flip, s3cfb_pan_display,
+
+	TP_PROTO(int win, unsigned int yoffset, unsigned int cookie),
+
+	TP_ARGS(win, yoffset, cookie)
+);
+
+DEFINE_EVENT(s3cfb_flip, s3cfb_flip_queue,
+
+	TP_PROTO(int win, unsigned int yoffset, unsigned int cookie),
+
+	TP_ARGS(win, yoffset, cookie)
+);
+
+DEFINE_EVENT(s3cfb_flip, s3cfb_flip_done,
+
+	TP_PROTO(int win, unsigned int yoffset, unsigned int cookie),
+
+	TP_ARGS(win, yoffset, cookie)
+);
+
+#endif /* if !defined(_TRACE_S3CFB_H) || defined(TRACE_HEADER_MULTI_READ) */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,162 @@
+/*
+ * init/boot_timing.c
+ *
+ * Durations of the initcalls and async work of boot, in /proc/boot_timing.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * initcall_debug prints a line per initcall, too much to leave on and
+ * slow on a serial console. Here every initcall and every function run
+ * by async_schedule() during boot is timed, and the slowest ones are kept
+ * by name with the totals, for a board to see what holds up userspace.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/kallsyms.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/sort.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/boot_timing.h>
+
+#define BOOT_TIMING_SLOTS	32
+
+struct boot_timing_entry {
+	char		name[40];
+	u32		usecs;
+	bool		async;
+};
+
+static struct boot_timing_entry boot_timing[BOOT_TIMING_SLOTS];
+static int boot_timing_nr;
+
+static DEFINE_SPINLOCK(boot_timing_lock);
+
+static unsigned int boot_timing_calls[2];
+static u64 boot_timing_usecs[2];
+
+/* Spent waiting for async work before init, and when init was started */
+static u32 boot_timing_sync_usecs;
+static u64 boot_timing_init_usecs;
+
+/* Slot the new entry replaces, or -1 when it is faster than all kept */
+static int boot_timing_slot(u32 usecs)
+{
+	int i, slot = 0;
+
+	if (boot_timing_nr < BOOT_TIMING_SLOTS)
+		return boot_timing_nr;
+
+	for (i = 1; i < BOOT_TIMING_SLOTS; i++)
+		if (boot_timing[i].usecs < boot_timing[slot].usecs)
+			slot = i;
+
+	return usecs > boot_timing[slot].usecs ? slot : -1;
+}
+
+void boot_timing_record(void *fn, ktime_t start, bool async)
+{
+	char namebuf[KSYM_NAME_LEN];
+	unsigned long size, offset;
+	const char *name;
+	char *modname;
+	u32 usecs;
+	int slot;
+
+	if (system_state != SYSTEM_BOOTING)
+		return;
+
+	usecs = ktime_us_delta(ktime_get(), start);
+	name = kallsyms_lookup((unsigned long)fn, &size, &offset, &modname,
+			       namebuf);
+
+	spin_lock(&boot_timing_lock);
+
+	boot_timing_calls[async]++;
+	boot_timing_usecs[async] += usecs;
+
+	slot = boot_timing_slot(usecs);
+	if (slot >= 0) {
+		if (name)
+			strlcpy(boot_timing[slot].name, name,
+				sizeof(boot_timing[slot].name));
+		else
+			snprintf(boot_timing[slot].name,
+				 sizeof(boot_timing[slot].name), "%p", fn);
+		boot_timing[slot].usecs = usecs;
+		boot_timing[slot].async = async;
+		if (slot == boot_timing_nr)
+			boot_timing_nr++;
+	}
+
+	spin_unlock(&boot_timing_lock);
+}
+
+static int boot_timing_cmp(const void *a, const void *b)
+{
+	const struct boot_timing_entry *ea = a, *eb = b;
+
+	return (int)(eb->usecs > ea->usecs) - (int)(eb->usecs < ea->usecs);
+}
+
+/*
+ * Called once the async work of boot is done, just before init runs.
+ * Nothing is recorded after this, so the slowest are sorted here.
+ */
+void boot_timing_sync_done(ktime_t start)
+{
+	ktime_t now = ktime_get();
+
+	spin_lock(&boot_timing_lock);
+	boot_timing_sync_usecs = ktime_us_delta(now, start);
+	boot_timing_init_usecs = ktime_to_us(now);
+	sort(boot_timing, boot_timing_nr, sizeof(boot_timing[0]),
+	     boot_timing_cmp, NULL);
+	spin_unlock(&boot_timing_lock);
+}
+
+static int boot_timing_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	spin_lock(&boot_timing_lock);
+
+	seq_printf(m, "initcalls: %u in %llu us\n",
+		   boot_timing_calls[0], boot_timing_usecs[0]);
+	seq_printf(m, "async: %u in %llu us\n",
+		   boot_timing_calls[1], boot_timing_usecs[1]);
+	seq_printf(m, "async wait: %u us\n", boot_timing_sync_usecs);
+	seq_printf(m, "init started: %llu us\n\n", boot_timing_init_usecs);
+
+	for (i = 0; i < boot_timing_nr; i++)
+		seq_printf(m, "%10u %s %s\n", boot_timing[i].usecs,
+			   boot_timing[i].async ? "async" : "sync ",
+			   boot_timing[i].name);
+
+	spin_unlock(&boot_timing_lock);
+
+	return 0;
+}
+
+static int boot_timing_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, boot_timing_show, NULL);
+}
+
+static const struct file_operations boot_timing_fops = {
+	.open		= boot_timing_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init boot_timing_init(void)
+{
+	proc_create("boot_timing", 0444, NULL, &boot_timing_fops);
+	return 0;
+}
+fs_initcall(boot_timing_init);
@@ -69,6 +69,7 @@
 #include <linux/slab.h>
 #include <linux/perf_event.h>
 #include <linux/random.h>
+#include <linux/boot_timing.h>
 
 #include <asm/io.h>
 #include <asm/bugs.h>
@@ -664,6 +665,7 @@ static int __init_or_module do_one_initcall_debug(initcall_t fn)
 int __init_or_module do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
+	ktime_t calltime = boot_timing_start();
 	int ret;
 
 	if (initcall_debug)
@@ -671,6 +673,8 @@ int __init_or_module do_one_initcall(initcall_t fn)
 	else
 		ret = fn();
 
+	boot_timing_record(fn, calltime, false);
+
 	msgbuf[0] = 0;
 
 	if (ret && ret != -ENODEV && initcall_debug)
@@ -735,14 +739,68 @@ static void run_init_process(const char *init_filename)
 	kernel_execve(init_filename, argv_init, envp_init);
 }
 
+extern initcall_t __deferred_initcall_start[], __deferred_initcall_end[];
+
+/*
+ * Deferred initcalls are run once userspace asks for them, through
+ * /sys/kernel/deferred_initcalls, or after deferred_initcall_timeout=
+ * seconds if it never does. They are __init code like any initcall, so
+ * init memory is only freed after them.
+ */
+static unsigned int deferred_initcall_timeout = 60;
+static DEFINE_MUTEX(deferred_initcalls_lock);
+int deferred_initcalls_done;
+
+static int __init deferred_initcall_timeout_setup(char *str)
+{
+	get_option(&str, &deferred_initcall_timeout);
+	return 1;
+}
+__setup("deferred_initcall_timeout=", deferred_initcall_timeout_setup);
+
+void __ref do_deferred_initcalls(void)
+{
+	initcall_t *fn;
+
+	mutex_lock(&deferred_initcalls_lock);
+	if (!deferred_initcalls_done) {
+		for (fn = __deferred_initcall_start;
+		     fn < __deferred_initcall_end; fn++)
+			do_one_initcall(*fn);
+
+		async_synchronize_full();
+		free_initmem();
+		deferred_initcalls_done = 1;
+	}
+	mutex_unlock(&deferred_initcalls_lock);
+}
+
+static void deferred_initcalls_timeout(struct work_struct *work)
+{
+	if (!deferred_initcalls_done)
+		pr_info("deferred initcalls not requested, running them\n");
+	do_deferred_initcalls();
+}
+
+static DECLARE_DELAYED_WORK(deferred_initcalls_work,
+			    deferred_initcalls_timeout);
+
 /* This is a non __init function. Force it to be noinline otherwise gcc
  * makes it inline to init() and it becomes part of init.text section
  */
 static noinline int init_post(void)
 {
+	ktime_t synctime = boot_timing_start();
+
 	/* need to finish all async __init code before freeing the memory */
 	async_synchronize_full();
-	free_initmem();
+	boot_timing_sync_done(synctime);
+	if (__deferred_initcall_end - __deferred_initcall_start == 0) {
+		free_initmem();
+		deferred_initcalls_done = 1;
+	} else
+		schedule_delayed_work(&deferred_initcalls_work,
+				      deferred_initcall_timeout * HZ);
 	mark_rodata_ro();
 	system_state = SYSTEM_RUNNING;
 	numa_default_policy();
@@ -49,6 +49,7 @@ asynchronous and synchronous parts of the kernel.
 */
 
 #include <linux/async.h>
+#include <linux/boot_timing.h>
 #include <linux/module.h>
 #include <linux/wait.h>
 #include <linux/sched.h>
@@ -126,7 +127,7 @@ static void async_run_entry_fn(struct work_struct *work)
 	struct async_entry *entry =
 		container_of(work, struct async_entry, work);
 	unsigned long flags;
-	ktime_t calltime, delta, rettime;
+	ktime_t calltime, delta, rettime, starttime;
 
 	/* 1) move self to the running queue */
 	spin_lock_irqsave(&async_lock, flags);
@@ -139,7 +140,9 @@ static void async_run_entry_fn(struct work_struct *work)
 			entry->func, task_pid_nr(current));
 		calltime = ktime_get();
 	}
+	starttime = boot_timing_start();
 	entry->func(entry->data, entry->cookie);
+	boot_timing_record(entry->func, starttime, true);
 	if (initcall_debug && system_state == SYSTEM_BOOTING) {
 		rettime = ktime_get();
 		delta = ktime_sub(rettime, calltime);
@@ -21,6 +21,7 @@
 #include <linux/uaccess.h>
 #include <linux/freezer.h>
 #include <linux/seq_file.h>
+#include <linux/swap.h>
 
 enum freezer_state {
 	CGROUP_THAWED = 0,
@@ -32,6 +33,7 @@ struct freezer {
 	struct cgroup_subsys_state css;
 	enum freezer_state state;
 	spinlock_t lock; /* protects _writes_ to state */
+	u64 reclaimed; /* pages freed by the last write to freezer.reclaim */
 };
 
 static inline struct freezer *cgroup_freezer(
@@ -366,12 +368,111 @@ static int freezer_write(struct cgroup *cgroup,
 	return retval;
 }
 
+/*
+ * Collects a reference on each mm of the tasks of a frozen cgroup into
+ * mms, which has room for max of them. Returns how many, or -EBUSY if the
+ * cgroup is not frozen.
+ */
+static int freezer_get_mms(struct cgroup *cgroup, struct freezer *freezer,
+			   struct mm_struct **mms, int max)
+{
+	struct cgroup_iter it;
+	struct task_struct *task;
+	struct mm_struct *mm;
+	int i, n = 0;
+
+	spin_lock_irq(&freezer->lock);
+	update_if_frozen(cgroup, freezer);
+	if (freezer->state != CGROUP_FROZEN) {
+		spin_unlock_irq(&freezer->lock);
+		return -EBUSY;
+	}
+
+	cgroup_iter_start(cgroup, &it);
+	while ((task = cgroup_iter_next(cgroup, &it)) && n < max) {
+		task_lock(task);
+		mm = task->mm;
+		if (mm && !(task->flags & PF_KTHREAD)) {
+			/* threads share theirs */
+			for (i = 0; i < n && mms[i] != mm; i++)
+				;
+			if (i == n) {
+				atomic_inc(&mm->mm_users);
+				mms[n++] = mm;
+			}
+		}
+		task_unlock(task);
+	}
+	cgroup_iter_end(cgroup, &it);
+
+	spin_unlock_irq(&freezer->lock);
+	return n;
+}
+
+/*
+ * Writing "anon", "file" or "all" to freezer.reclaim of a frozen cgroup
+ * reclaims those pages of its tasks that no process outside maps, so the
+ * memory of a cached app goes to swap (zram) ahead of pressure rather
+ * than the app being killed under it. The reclaim runs without
+ * cgroup_mutex held, so it does not hold up thawing or other cgroups.
+ */
+static int freezer_reclaim_write(struct cgroup *cgroup, struct cftype *cft,
+				 const char *buffer)
+{
+	struct freezer *freezer = cgroup_freezer(cgroup);
+	struct mm_struct **mms;
+	unsigned long reclaimed = 0;
+	unsigned int type;
+	int i, n;
+
+	if (strcmp(buffer, "anon") == 0)
+		type = RECLAIM_MM_ANON;
+	else if (strcmp(buffer, "file") == 0)
+		type = RECLAIM_MM_FILE;
+	else if (strcmp(buffer, "all") == 0)
+		type = RECLAIM_MM_ANON | RECLAIM_MM_FILE;
+	else
+		return -EINVAL;
+
+	if (!cgroup_lock_live_group(cgroup))
+		return -ENODEV;
+	n = cgroup_task_count(cgroup);
+	mms = kmalloc(max(n, 1) * sizeof(*mms), GFP_KERNEL);
+	if (!mms) {
+		cgroup_unlock();
+		return -ENOMEM;
+	}
+	n = freezer_get_mms(cgroup, freezer, mms, n);
+	cgroup_unlock();
+
+	for (i = 0; i < n; i++) {
+		reclaimed += reclaim_mm_pages(mms[i], type);
+		mmput(mms[i]);
+	}
+	kfree(mms);
+
+	if (n < 0)
+		return n;
+	freezer->reclaimed = reclaimed;
+	return 0;
+}
+
+static u64 freezer_reclaim_read(struct cgroup *cgroup, struct cftype *cft)
+{
+	return cgroup_freezer(cgroup)->reclaimed;
+}
+
 static struct cftype files[] = {
 	{
 		.name = "state",
 		.read_seq_string = freezer_read,
 		.write_string = freezer_write,
 	},
+	{
+		.name = "reclaim",
+		.read_u64 = freezer_reclaim_read,
+		.write_string = freezer_reclaim_write,
+	},
 };
 
 static int freezer_populate(struct cgroup_subsys *ss, struct cgroup *cgroup)
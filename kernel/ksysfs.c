@@ -166,8 +166,24 @@ static struct bin_attribute notes_attr = {
 struct kobject *kernel_kobj;
 EXPORT_SYMBOL_GPL(kernel_kobj);
 
+/* drivers held back from boot, run by the first write */
+static ssize_t deferred_initcalls_show(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", deferred_initcalls_done);
+}
+static ssize_t deferred_initcalls_store(struct kobject *kobj,
+					struct kobj_attribute *attr,
+					const char *buf, size_t count)
+{
+	do_deferred_initcalls();
+	return count;
+}
+KERNEL_ATTR_RW(deferred_initcalls);
+
 static struct attribute * kernel_attrs[] = {
 	&fscaps_attr.attr,
+	&deferred_initcalls_attr.attr,
 #if defined(CONFIG_HOTPLUG)
 	&uevent_seqnum_attr.attr,
 	&uevent_helper_attr.attr,
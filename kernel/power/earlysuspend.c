@@ -75,6 +75,21 @@ void unregister_early_suspend(struct early_suspend *handler)
 }
 EXPORT_SYMBOL(unregister_early_suspend);
 
+static void early_suspend_call(void (*fn)(struct early_suspend *h),
+			       struct early_suspend *h, bool resume)
+{
+#ifdef CONFIG_SUSPEND_TIME
+	ktime_t start = ktime_get();
+	char name[32];
+
+	fn(h);
+	snprintf(name, sizeof(name), "%pf", fn);
+	suspend_time_record(name, resume, start);
+#else
+	fn(h);
+#endif
+}
+
 static void early_suspend(struct work_struct *work)
 {
 	struct early_suspend *pos;
@@ -105,7 +120,7 @@ static void early_suspend(struct work_struct *work)
 		if (pos->suspend != NULL) {
 			if (debug_mask & DEBUG_VERBOSE)
 				pr_info("early_suspend: calling %pf\n", pos->suspend);
-			pos->suspend(pos);
+			early_suspend_call(pos->suspend, pos, false);
 		}
 	}
 	mutex_unlock(&early_suspend_lock);
@@ -150,7 +165,7 @@ static void late_resume(struct work_struct *work)
 			if (debug_mask & DEBUG_VERBOSE)
 				pr_info("late_resume: calling %pf\n", pos->resume);
 
-			pos->resume(pos);
+			early_suspend_call(pos->resume, pos, true);
 		}
 	}
 	if (debug_mask & DEBUG_SUSPEND)
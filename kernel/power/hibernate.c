@@ -31,6 +31,7 @@
 
 static int nocompress = 0;
 static int noresume = 0;
+static int resume_wait;
 static char resume_file[256] = CONFIG_PM_STD_PARTITION;
 dev_t swsusp_resume_device;
 sector_t swsusp_resume_block;
@@ -43,6 +44,7 @@ enum {
 	HIBERNATION_TESTPROC,
 	HIBERNATION_SHUTDOWN,
 	HIBERNATION_REBOOT,
+	HIBERNATION_SNAPSHOT,
 	/* keep last */
 	__HIBERNATION_AFTER_LAST
 };
@@ -592,6 +594,26 @@ static void power_down(void)
 	while(1);
 }
 
+static void snapshot_check_sb(struct super_block *sb, void *arg)
+{
+	if (sb->s_bdev && !(sb->s_flags & MS_RDONLY)) {
+		printk(KERN_ERR "PM: %s is mounted read-write\n", sb->s_id);
+		*(bool *)arg = true;
+	}
+}
+
+/*
+ * A boot snapshot is restored on every boot, over whatever was written to
+ * disk since it was taken, so no writable filesystem may be cached in it.
+ */
+static int snapshot_check_filesystems(void)
+{
+	bool busy = false;
+
+	iterate_supers(snapshot_check_sb, &busy);
+	return busy ? -EBUSY : 0;
+}
+
 static int prepare_processes(void)
 {
 	int error = 0;
@@ -611,6 +633,12 @@ int hibernate(void)
 	int error;
 
 	mutex_lock(&pm_mutex);
+	if (hibernation_mode == HIBERNATION_SNAPSHOT) {
+		error = snapshot_check_filesystems();
+		if (error)
+			goto Unlock;
+	}
+
 	/* The snapshot device should not be opened while we're running */
 	if (!atomic_add_unless(&snapshot_device_available, -1, 0)) {
 		error = -EBUSY;
@@ -656,10 +684,13 @@ int hibernate(void)
 			flags |= SF_PLATFORM_MODE;
 		if (nocompress)
 			flags |= SF_NOCOMPRESS_MODE;
+		if (hibernation_mode == HIBERNATION_SNAPSHOT)
+			flags |= SF_SNAPSHOT_MODE;
 		pr_debug("PM: writing image.\n");
 		error = swsusp_write(flags);
 		swsusp_free();
-		if (!error)
+		/* a boot snapshot is taken on the way, the system carries on */
+		if (!error && hibernation_mode != HIBERNATION_SNAPSHOT)
 			power_down();
 		in_suspend = 0;
 		pm_restore_gfp_mask();
@@ -731,6 +762,12 @@ static int software_resume(void)
 
 	pr_debug("PM: Checking hibernation image partition %s\n", resume_file);
 
+	/* MMC cards are scanned from a workqueue, after their host probed */
+	if (resume_wait) {
+		while ((swsusp_resume_device = name_to_dev_t(resume_file)) == 0)
+			msleep(10);
+	}
+
 	/* Check if the device is there */
 	swsusp_resume_device = name_to_dev_t(resume_file);
 	if (!swsusp_resume_device) {
@@ -825,6 +862,7 @@ static const char * const hibernation_modes[] = {
 	[HIBERNATION_REBOOT]	= "reboot",
 	[HIBERNATION_TEST]	= "test",
 	[HIBERNATION_TESTPROC]	= "testproc",
+	[HIBERNATION_SNAPSHOT]	= "snapshot",
 };
 
 /*
@@ -837,13 +875,18 @@ static const char * const hibernation_modes[] = {
  *
  * The sysfs file /sys/power/disk provides an interface for selecting the
  * hibernation mode to use.  Reading from this file causes the available modes
- * to be printed.  There are 5 modes that can be supported:
+ * to be printed.  There are 6 modes that can be supported:
  *
  *	'platform'
  *	'shutdown'
  *	'reboot'
  *	'test'
  *	'testproc'
+ *	'snapshot'
+ *
+ * 'snapshot' writes a boot snapshot to the resume partition and goes on
+ * running: it is restored on every boot until it is overwritten, see
+ * Documentation/power/boot-snapshot.txt.
  *
  * If a platform hibernation driver is in use, 'platform' will be supported
  * and will be used by default.  Otherwise, 'shutdown' will be used by default.
@@ -869,6 +912,7 @@ static ssize_t disk_show(struct kobject *kobj, struct kobj_attribute *attr,
 		case HIBERNATION_REBOOT:
 		case HIBERNATION_TEST:
 		case HIBERNATION_TESTPROC:
+		case HIBERNATION_SNAPSHOT:
 			break;
 		case HIBERNATION_PLATFORM:
 			if (hibernation_ops)
@@ -911,6 +955,7 @@ static ssize_t disk_store(struct kobject *kobj, struct kobj_attribute *attr,
 		case HIBERNATION_REBOOT:
 		case HIBERNATION_TEST:
 		case HIBERNATION_TESTPROC:
+		case HIBERNATION_SNAPSHOT:
 			hibernation_mode = mode;
 			break;
 		case HIBERNATION_PLATFORM:
@@ -1067,7 +1112,14 @@ static int __init noresume_setup(char *str)
 	return 1;
 }
 
+static int __init resumewait_setup(char *str)
+{
+	resume_wait = 1;
+	return 1;
+}
+
 __setup("noresume", noresume_setup);
 __setup("resume_offset=", resume_offset_setup);
 __setup("resume=", resume_setup);
+__setup("resumewait", resumewait_setup);
 __setup("hibernate=", hibernate_setup);
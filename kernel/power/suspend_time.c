@@ -19,12 +19,79 @@
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/suspend.h>
 #include <linux/syscore_ops.h>
 #include <linux/time.h>
 
 static struct timespec suspend_time_before;
 static unsigned int time_in_suspend_bins[32];
 
+/*
+ * Suspend and resume callbacks of devices and early suspend handlers
+ * that took at least SUSPEND_TIME_MIN_NS, by name. When the table is
+ * full, a slower callback replaces the entry with the smallest maximum.
+ */
+#define SUSPEND_TIME_ENTRIES	32
+#define SUSPEND_TIME_MIN_NS	(100 * NSEC_PER_USEC)
+
+struct suspend_time_entry {
+	char name[24];
+	unsigned int count[2];		/* suspend, resume */
+	u64 last_ns[2];
+	u64 max_ns[2];
+	u64 total_ns[2];
+};
+
+static struct suspend_time_entry suspend_time_entries[SUSPEND_TIME_ENTRIES];
+static DEFINE_SPINLOCK(suspend_time_lock);
+
+static u64 suspend_time_entry_max(struct suspend_time_entry *e)
+{
+	return max(e->max_ns[0], e->max_ns[1]);
+}
+
+void suspend_time_record(const char *name, bool resume, ktime_t start)
+{
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	struct suspend_time_entry *e, *victim = NULL;
+	unsigned long flags;
+	int i;
+
+	if (ns < SUSPEND_TIME_MIN_NS)
+		return;
+
+	spin_lock_irqsave(&suspend_time_lock, flags);
+	for (i = 0; i < SUSPEND_TIME_ENTRIES; i++) {
+		e = &suspend_time_entries[i];
+		if (!e->name[0] ||
+		    !strncmp(e->name, name, sizeof(e->name) - 1)) {
+			victim = e;
+			break;
+		}
+		if (!victim ||
+		    suspend_time_entry_max(e) < suspend_time_entry_max(victim))
+			victim = e;
+	}
+
+	e = victim;
+	if (strncmp(e->name, name, sizeof(e->name) - 1)) {
+		if (e->name[0] && suspend_time_entry_max(e) >= ns)
+			goto out;
+		memset(e, 0, sizeof(*e));
+		strlcpy(e->name, name, sizeof(e->name));
+	}
+
+	e->count[resume]++;
+	e->last_ns[resume] = ns;
+	e->total_ns[resume] += ns;
+	if (ns > e->max_ns[resume])
+		e->max_ns[resume] = ns;
+out:
+	spin_unlock_irqrestore(&suspend_time_lock, flags);
+}
+
 #ifdef CONFIG_DEBUG_FS
 static int suspend_time_debug_show(struct seq_file *s, void *data)
 {
@@ -53,6 +120,58 @@ static const struct file_operations suspend_time_debug_fops = {
 	.release	= single_release,
 };
 
+static unsigned long suspend_time_us(u64 ns)
+{
+	do_div(ns, NSEC_PER_USEC);
+	return (unsigned long)ns;
+}
+
+static unsigned long suspend_time_avg_us(u64 ns, unsigned int count)
+{
+	if (!count)
+		return 0;
+	do_div(ns, count);
+	return suspend_time_us(ns);
+}
+
+static int suspend_dev_time_show(struct seq_file *s, void *data)
+{
+	struct suspend_time_entry e;
+	unsigned long flags;
+	int i, j;
+
+	seq_printf(s, "%-24s %-28s %s\n", "", "suspend (count last max avg us)",
+		   "resume (count last max avg us)");
+	for (i = 0; i < SUSPEND_TIME_ENTRIES; i++) {
+		spin_lock_irqsave(&suspend_time_lock, flags);
+		e = suspend_time_entries[i];
+		spin_unlock_irqrestore(&suspend_time_lock, flags);
+		if (!e.name[0])
+			continue;
+
+		seq_printf(s, "%-24s", e.name);
+		for (j = 0; j < 2; j++)
+			seq_printf(s, " %6u %6lu %6lu %6lu", e.count[j],
+				   suspend_time_us(e.last_ns[j]),
+				   suspend_time_us(e.max_ns[j]),
+				   suspend_time_avg_us(e.total_ns[j], e.count[j]));
+		seq_putc(s, '\n');
+	}
+	return 0;
+}
+
+static int suspend_dev_time_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, suspend_dev_time_show, NULL);
+}
+
+static const struct file_operations suspend_dev_time_fops = {
+	.open		= suspend_dev_time_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init suspend_time_debug_init(void)
 {
 	struct dentry *d;
@@ -64,6 +183,13 @@ static int __init suspend_time_debug_init(void)
 		return -ENOMEM;
 	}
 
+	d = debugfs_create_file("suspend_dev_time", 0444, NULL, NULL,
+		&suspend_dev_time_fops);
+	if (!d) {
+		pr_err("Failed to create suspend_dev_time debug file\n");
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -184,6 +184,28 @@ int swsusp_swap_in_use(void)
 static unsigned short root_swap = 0xffff;
 struct block_device *hib_resume_bdev;
 
+/*
+ * A boot snapshot goes to a partition of its own, not to swap: swapping
+ * to it after a restore would overwrite the image that the next boot
+ * restores. Its pages are used in order, from after the header.
+ */
+static bool snapshot_mode;
+static sector_t snapshot_next, snapshot_end;
+
+static sector_t alloc_image_block(void)
+{
+	if (!snapshot_mode)
+		return alloc_swapdev_block(root_swap);
+	return snapshot_next < snapshot_end ? snapshot_next++ : 0;
+}
+
+static unsigned int count_image_blocks(void)
+{
+	if (!snapshot_mode)
+		return count_swap_pages(root_swap, 1);
+	return snapshot_end - snapshot_next;
+}
+
 /*
  * Saving part
  */
@@ -193,7 +215,15 @@ static int mark_swapfiles(struct swap_map_handle *handle, unsigned int flags)
 	int error;
 
 	hib_bio_read_page(swsusp_resume_block, swsusp_header, NULL);
-	if (!memcmp("SWAP-SPACE",swsusp_header->sig, 10) ||
+	if (snapshot_mode) {
+		/* nothing to give back to the partition when the image goes */
+		memset(swsusp_header->orig_sig, 0, 10);
+		memcpy(swsusp_header->sig, HIBERNATE_SIG, 10);
+		swsusp_header->image = handle->first_sector;
+		swsusp_header->flags = flags;
+		error = hib_bio_write_page(swsusp_resume_block,
+					swsusp_header, NULL);
+	} else if (!memcmp("SWAP-SPACE",swsusp_header->sig, 10) ||
 	    !memcmp("SWAPSPACE2",swsusp_header->sig, 10)) {
 		memcpy(swsusp_header->orig_sig,swsusp_header->sig, 10);
 		memcpy(swsusp_header->sig, HIBERNATE_SIG, 10);
@@ -235,6 +265,50 @@ static int swsusp_swap_check(void)
 	return res;
 }
 
+/**
+ *	swsusp_snapshot_check - open the boot snapshot partition for writing
+ *
+ *	The header of any older snapshot is cleared first, so that a boot
+ *	does not restore it while the new one is half written.
+ */
+static int swsusp_snapshot_check(void)
+{
+	int res;
+
+	if (!swsusp_resume_device) {
+		printk(KERN_ERR "PM: No snapshot partition, set resume=\n");
+		return -ENODEV;
+	}
+	res = swap_type_of(swsusp_resume_device, swsusp_resume_block, NULL);
+	if (res >= 0) {
+		printk(KERN_ERR "PM: Snapshot partition is in use as swap\n");
+		return -EBUSY;
+	}
+
+	hib_resume_bdev = blkdev_get_by_dev(swsusp_resume_device,
+					    FMODE_WRITE, NULL);
+	if (IS_ERR(hib_resume_bdev))
+		return PTR_ERR(hib_resume_bdev);
+
+	res = set_blocksize(hib_resume_bdev, PAGE_SIZE);
+	if (res < 0)
+		goto put;
+
+	snapshot_next = swsusp_resume_block + 1;
+	snapshot_end = i_size_read(hib_resume_bdev->bd_inode) >> PAGE_SHIFT;
+
+	res = hib_bio_read_page(swsusp_resume_block, swsusp_header, NULL);
+	if (!res && !memcmp(HIBERNATE_SIG, swsusp_header->sig, 10)) {
+		memset(swsusp_header->sig, 0, 10);
+		res = hib_bio_write_page(swsusp_resume_block,
+					swsusp_header, NULL);
+	}
+put:
+	if (res)
+		blkdev_put(hib_resume_bdev, FMODE_WRITE);
+	return res;
+}
+
 /**
  *	write_page - Write one page to given swap location.
  *	@buf:		Address we're writing.
@@ -275,9 +349,9 @@ static int get_swap_writer(struct swap_map_handle *handle)
 {
 	int ret;
 
-	ret = swsusp_swap_check();
+	ret = snapshot_mode ? swsusp_snapshot_check() : swsusp_swap_check();
 	if (ret) {
-		if (ret != -ENOSPC)
+		if (ret != -ENOSPC && !snapshot_mode)
 			printk(KERN_ERR "PM: Cannot find swap device, try "
 					"swapon -a.\n");
 		return ret;
@@ -287,7 +361,7 @@ static int get_swap_writer(struct swap_map_handle *handle)
 		ret = -ENOMEM;
 		goto err_close;
 	}
-	handle->cur_swap = alloc_swapdev_block(root_swap);
+	handle->cur_swap = alloc_image_block();
 	if (!handle->cur_swap) {
 		ret = -ENOSPC;
 		goto err_rel;
@@ -310,7 +384,7 @@ static int swap_write_page(struct swap_map_handle *handle, void *buf,
 
 	if (!handle->cur)
 		return -EINVAL;
-	offset = alloc_swapdev_block(root_swap);
+	offset = alloc_image_block();
 	error = write_page(buf, offset, bio_chain);
 	if (error)
 		return error;
@@ -319,7 +393,7 @@ static int swap_write_page(struct swap_map_handle *handle, void *buf,
 		error = hib_wait_on_bio_chain(bio_chain);
 		if (error)
 			goto out;
-		offset = alloc_swapdev_block(root_swap);
+		offset = alloc_image_block();
 		if (!offset)
 			return -ENOSPC;
 		handle->cur->next_swap = offset;
@@ -435,6 +509,7 @@ static int save_image_lzo(struct swap_map_handle *handle,
 	int nr_pages;
 	int err2;
 	struct bio *bio;
+	struct blk_plug plug;
 	struct timeval start;
 	struct timeval stop;
 	size_t off, unc_len, cmp_len;
@@ -522,13 +597,17 @@ static int save_image_lzo(struct swap_map_handle *handle,
 		 * of the compressed data, so any garbage at the end will be
 		 * discarded when we read it.
 		 */
+		blk_start_plug(&plug);
 		for (off = 0; off < LZO_HEADER + cmp_len; off += PAGE_SIZE) {
 			memcpy(page, cmp + off, PAGE_SIZE);
 
 			ret = swap_write_page(handle, page, &bio);
 			if (ret)
-				goto out_finish;
+				break;
 		}
+		blk_finish_plug(&plug);
+		if (ret)
+			goto out_finish;
 	}
 
 out_finish:
@@ -559,7 +638,7 @@ out_finish:
 
 static int enough_swap(unsigned int nr_pages, unsigned int flags)
 {
-	unsigned int free_swap = count_swap_pages(root_swap, 1);
+	unsigned int free_swap = count_image_blocks();
 	unsigned int required;
 
 	pr_debug("PM: Free swap pages: %u\n", free_swap);
@@ -587,6 +666,7 @@ int swsusp_write(unsigned int flags)
 	unsigned long pages;
 	int error;
 
+	snapshot_mode = flags & SF_SNAPSHOT_MODE;
 	pages = snapshot_get_image_size();
 	error = get_swap_writer(&handle);
 	if (error) {
@@ -742,6 +822,12 @@ static int load_image(struct swap_map_handle *handle,
 	return error;
 }
 
+/*
+ * Number of pages read ahead of the decompressor. Reads go out as soon as
+ * the pages are free, so the eMMC streams while the CPU decompresses.
+ */
+#define LZO_RD_PAGES	1024
+
 /**
  * load_image_lzo - Load compressed image data and decompress them with LZO.
  * @handle: Swap map handle to use for loading data.
@@ -754,44 +840,54 @@ static int load_image_lzo(struct swap_map_handle *handle,
 {
 	unsigned int m;
 	int error = 0;
+	int err2 = 0;
+	int eof = 0;
 	struct bio *bio;
+	struct blk_plug plug;
 	struct timeval start;
 	struct timeval stop;
 	unsigned nr_pages;
-	size_t i, off, unc_len, cmp_len;
-	unsigned char *unc, *cmp, *page[LZO_CMP_PAGES];
+	unsigned ring_size, ring = 0, pg = 0, want, have = 0, asked = 0;
+	size_t i, off, unc_len, cmp_len, need;
+	unsigned char *unc, *cmp, **page;
+
+	page = kmalloc(LZO_RD_PAGES * sizeof(*page), GFP_KERNEL);
+	if (!page) {
+		printk(KERN_ERR "PM: Failed to allocate LZO pages\n");
+		return -ENOMEM;
+	}
 
-	for (i = 0; i < LZO_CMP_PAGES; i++) {
-		page[i] = (void *)__get_free_page(__GFP_WAIT | __GFP_HIGH);
+	/* one compressed chunk at the least, as many more as come easily */
+	for (i = 0; i < LZO_RD_PAGES; i++) {
+		page[i] = (void *)__get_free_page(i < LZO_CMP_PAGES ?
+				__GFP_WAIT | __GFP_HIGH :
+				__GFP_WAIT | __GFP_NOWARN | __GFP_NORETRY);
 		if (!page[i]) {
+			if (i >= LZO_CMP_PAGES)
+				break;
 			printk(KERN_ERR "PM: Failed to allocate LZO page\n");
 
 			while (i)
 				free_page((unsigned long)page[--i]);
+			kfree(page);
 
 			return -ENOMEM;
 		}
 	}
+	want = ring_size = i;
 
 	unc = vmalloc(LZO_UNC_SIZE);
 	if (!unc) {
 		printk(KERN_ERR "PM: Failed to allocate LZO uncompressed\n");
-
-		for (i = 0; i < LZO_CMP_PAGES; i++)
-			free_page((unsigned long)page[i]);
-
-		return -ENOMEM;
+		error = -ENOMEM;
+		goto out_pages;
 	}
 
 	cmp = vmalloc(LZO_CMP_SIZE);
 	if (!cmp) {
 		printk(KERN_ERR "PM: Failed to allocate LZO compressed\n");
-
-		vfree(unc);
-		for (i = 0; i < LZO_CMP_PAGES; i++)
-			free_page((unsigned long)page[i]);
-
-		return -ENOMEM;
+		error = -ENOMEM;
+		goto out_unc;
 	}
 
 	printk(KERN_INFO
@@ -809,32 +905,71 @@ static int load_image_lzo(struct swap_map_handle *handle,
 		goto out_finish;
 
 	for (;;) {
-		error = swap_read_page(handle, page[0], NULL); /* sync */
-		if (error)
-			break;
+		/* refill the ring, in one plug so the reads merge */
+		blk_start_plug(&plug);
+		for (i = 0; !eof && i < want; i++) {
+			err2 = swap_read_page(handle, page[ring], &bio);
+			if (err2) {
+				/* past the last entry of the map is the end */
+				if (handle->cur &&
+				    handle->cur->entries[handle->k])
+					break;
+				err2 = 0;
+				eof = 1;
+				break;
+			}
+			if (++ring >= ring_size)
+				ring = 0;
+		}
+		blk_finish_plug(&plug);
+		if (err2) {
+			error = err2;
+			goto out_finish;
+		}
+		asked += i;
+		want -= i;
 
-		cmp_len = *(size_t *)page[0];
+		if (!have) {
+			error = hib_wait_on_bio_chain(&bio);
+			if (error)
+				goto out_finish;
+			have += asked;
+			asked = 0;
+		}
+		if (!have) {
+			printk(KERN_ERR "PM: Image data truncated\n");
+			error = -ENODATA;
+			goto out_finish;
+		}
+
+		cmp_len = *(size_t *)page[pg];
 		if (unlikely(!cmp_len ||
 		             cmp_len > lzo1x_worst_compress(LZO_UNC_SIZE))) {
 			printk(KERN_ERR "PM: Invalid LZO compressed length\n");
 			error = -1;
-			break;
+			goto out_finish;
 		}
 
-		for (off = PAGE_SIZE, i = 1;
-		     off < LZO_HEADER + cmp_len; off += PAGE_SIZE, i++) {
-			error = swap_read_page(handle, page[i], &bio);
+		need = DIV_ROUND_UP(LZO_HEADER + cmp_len, PAGE_SIZE);
+		if (need > have) {
+			error = hib_wait_on_bio_chain(&bio);
 			if (error)
 				goto out_finish;
+			have += asked;
+			asked = 0;
 		}
-
-		error = hib_wait_on_bio_chain(&bio); /* need all data now */
-		if (error)
+		if (need > have) {
+			printk(KERN_ERR "PM: Image data truncated\n");
+			error = -ENODATA;
 			goto out_finish;
+		}
 
-		for (off = 0, i = 0;
-		     off < LZO_HEADER + cmp_len; off += PAGE_SIZE, i++) {
-			memcpy(cmp + off, page[i], PAGE_SIZE);
+		for (off = 0; off < LZO_HEADER + cmp_len; off += PAGE_SIZE) {
+			memcpy(cmp + off, page[pg], PAGE_SIZE);
+			have--;
+			want++;
+			if (++pg >= ring_size)
+				pg = 0;
 		}
 
 		unc_len = LZO_UNC_SIZE;
@@ -867,7 +1002,11 @@ static int load_image_lzo(struct swap_map_handle *handle,
 	}
 
 out_finish:
+	/* no page may be freed under a read still in flight */
+	err2 = hib_wait_on_bio_chain(&bio);
 	do_gettimeofday(&stop);
+	if (!error)
+		error = err2;
 	if (!error) {
 		printk("\b\b\b\bdone\n");
 		snapshot_write_finalize(snapshot);
@@ -878,9 +1017,12 @@ out_finish:
 	swsusp_show_speed(&start, &stop, nr_to_read, "Read");
 
 	vfree(cmp);
+out_unc:
 	vfree(unc);
-	for (i = 0; i < LZO_CMP_PAGES; i++)
+out_pages:
+	for (i = 0; i < ring_size; i++)
 		free_page((unsigned long)page[i]);
+	kfree(page);
 
 	return error;
 }
@@ -915,10 +1057,18 @@ int swsusp_read(unsigned int *flags_p)
 	}
 	swap_reader_finish(&handle);
 end:
-	if (!error)
+	if (!error) {
 		pr_debug("PM: Image successfully loaded\n");
-	else
+	} else {
 		pr_debug("PM: Error %d resuming\n", error);
+		/* not to fail the same way on every boot, e.g. after an update */
+		if (swsusp_header->flags & SF_SNAPSHOT_MODE) {
+			printk(KERN_ERR "PM: Discarding the boot snapshot\n");
+			memcpy(swsusp_header->sig, swsusp_header->orig_sig, 10);
+			hib_bio_write_page(swsusp_resume_block,
+					swsusp_header, NULL);
+		}
+	}
 	return error;
 }
 
@@ -941,6 +1091,9 @@ int swsusp_check(void)
 			goto put;
 
 		if (!memcmp(HIBERNATE_SIG, swsusp_header->sig, 10)) {
+			/* A boot snapshot stays, for the boots to come */
+			if (swsusp_header->flags & SF_SNAPSHOT_MODE)
+				goto put;
 			memcpy(swsusp_header->sig, swsusp_header->orig_sig, 10);
 			/* Reset swap signature now */
 			error = hib_bio_write_page(swsusp_resume_block,
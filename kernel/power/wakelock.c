@@ -83,7 +83,9 @@ int get_expired_time(struct wake_lock *lock, ktime_t *expire_time)
 }
 
 
-static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
+/* Called with list_lock held */
+static void get_lock_stat(struct wake_lock *lock,
+			  struct wake_lock_stat_record *rec)
 {
 	int lock_count = lock->stat.count;
 	int expire_count = lock->stat.expire_count;
@@ -111,13 +113,54 @@ static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 			max_time = add_time;
 	}
 
+	rec->name_len = strlen(lock->name);
+	rec->size = ALIGN(sizeof(*rec) + rec->name_len, 8);
+	rec->count = lock_count;
+	rec->expire_count = expire_count;
+	rec->wakeup_count = lock->stat.wakeup_count;
+	rec->type = lock->flags & WAKE_LOCK_TYPE_MASK;
+	rec->flags = 0;
+	if (lock->flags & WAKE_LOCK_ACTIVE)
+		rec->flags |= WAKE_LOCK_STAT_ACTIVE;
+	if (lock->flags & WAKE_LOCK_AUTO_EXPIRE)
+		rec->flags |= WAKE_LOCK_STAT_AUTO_EXPIRE;
+	rec->reserved = 0;
+	rec->active_since = ktime_to_ns(active_time);
+	rec->total_time = ktime_to_ns(total_time);
+	rec->sleep_time = ktime_to_ns(prevent_suspend_time);
+	rec->max_time = ktime_to_ns(max_time);
+	rec->last_change = ktime_to_ns(lock->stat.last_time);
+}
+
+static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
+{
+	struct wake_lock_stat_record rec;
+
+	get_lock_stat(lock, &rec);
 	return seq_printf(m,
 		     "\"%s\"\t%d\t%d\t%d\t%lld\t%lld\t%lld\t%lld\t%lld\n",
-		     lock->name, lock_count, expire_count,
-		     lock->stat.wakeup_count, ktime_to_ns(active_time),
-		     ktime_to_ns(total_time),
-		     ktime_to_ns(prevent_suspend_time), ktime_to_ns(max_time),
-		     ktime_to_ns(lock->stat.last_time));
+		     lock->name, rec.count, rec.expire_count,
+		     rec.wakeup_count, rec.active_since, rec.total_time,
+		     rec.sleep_time, rec.max_time, rec.last_change);
+}
+
+/*
+ * Same numbers as /proc/wakelocks, one struct wake_lock_stat_record per
+ * lock followed by its unterminated name, padded to 8 bytes.
+ */
+static int write_lock_stat(struct seq_file *m, struct wake_lock *lock)
+{
+	static const char pad[8];
+	struct wake_lock_stat_record rec;
+	int ret;
+
+	get_lock_stat(lock, &rec);
+	ret = seq_write(m, &rec, sizeof(rec));
+	if (!ret)
+		ret = seq_write(m, lock->name, rec.name_len);
+	if (!ret)
+		ret = seq_write(m, pad, rec.size - sizeof(rec) - rec.name_len);
+	return ret;
 }
 
 static int wakelock_stats_show(struct seq_file *m, void *unused)
@@ -141,6 +184,23 @@ static int wakelock_stats_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static int wakelock_stats_bin_show(struct seq_file *m, void *unused)
+{
+	unsigned long irqflags;
+	struct wake_lock *lock;
+	int type;
+
+	spin_lock_irqsave(&list_lock, irqflags);
+	list_for_each_entry(lock, &inactive_locks, link)
+		write_lock_stat(m, lock);
+	for (type = 0; type < WAKE_LOCK_TYPE_COUNT; type++) {
+		list_for_each_entry(lock, &active_wake_locks[type], link)
+			write_lock_stat(m, lock);
+	}
+	spin_unlock_irqrestore(&list_lock, irqflags);
+	return 0;
+}
+
 static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 {
 	ktime_t duration;
@@ -419,6 +479,26 @@ static void wake_lock_internal(
 	unsigned long irqflags;
 	long expire_in;
 
+	/*
+	 * Locking a lock that is already held with no timeout changes
+	 * nothing but the event count, so skip list_lock. The flags are
+	 * only checked again under it on every other path.
+	 */
+	if (!has_timeout && lock != &main_wake_lock &&
+	    (ACCESS_ONCE(lock->flags) & (WAKE_LOCK_ACTIVE |
+					 WAKE_LOCK_AUTO_EXPIRE)) ==
+	    WAKE_LOCK_ACTIVE) {
+		type = lock->flags & WAKE_LOCK_TYPE_MASK;
+#ifdef CONFIG_WAKELOCK_STAT
+		if (type != WAKE_LOCK_SUSPEND || !ACCESS_ONCE(wait_for_wakeup))
+#endif
+		{
+			if (type == WAKE_LOCK_SUSPEND)
+				current_event_num++;
+			return;
+		}
+	}
+
 	spin_lock_irqsave(&list_lock, irqflags);
 	type = lock->flags & WAKE_LOCK_TYPE_MASK;
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
@@ -503,6 +583,11 @@ void wake_unlock(struct wake_lock *lock)
 {
 	int type;
 	unsigned long irqflags;
+
+	/* Drivers unlock unconditionally: nothing to do for an idle lock */
+	if (!(ACCESS_ONCE(lock->flags) & WAKE_LOCK_ACTIVE))
+		return;
+
 	spin_lock_irqsave(&list_lock, irqflags);
 	type = lock->flags & WAKE_LOCK_TYPE_MASK;
 #ifdef CONFIG_WAKELOCK_STAT
@@ -559,6 +644,19 @@ static const struct file_operations wakelock_stats_fops = {
 	.release = single_release,
 };
 
+static int wakelock_stats_bin_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wakelock_stats_bin_show, NULL);
+}
+
+static const struct file_operations wakelock_stats_bin_fops = {
+	.owner = THIS_MODULE,
+	.open = wakelock_stats_bin_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int __init wakelocks_init(void)
 {
 	int ret;
@@ -596,6 +694,7 @@ static int __init wakelocks_init(void)
 
 #ifdef CONFIG_WAKELOCK_STAT
 	proc_create("wakelocks", S_IRUGO, NULL, &wakelock_stats_fops);
+	proc_create("wakelocks_bin", S_IRUGO, NULL, &wakelock_stats_bin_fops);
 #endif
 
 	return 0;
@@ -617,6 +716,7 @@ err_platform_device_register:
 static void  __exit wakelocks_exit(void)
 {
 #ifdef CONFIG_WAKELOCK_STAT
+	remove_proc_entry("wakelocks_bin", NULL);
 	remove_proc_entry("wakelocks", NULL);
 #endif
 	destroy_workqueue(suspend_work_queue);
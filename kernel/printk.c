@@ -41,6 +41,7 @@
 #include <linux/cpu.h>
 #include <linux/notifier.h>
 #include <linux/rculist.h>
+#include <linux/kthread.h>
 
 #include <asm/uaccess.h>
 
@@ -106,6 +107,32 @@ static int console_locked, console_suspended;
  */
 static DEFINE_SPINLOCK(logbuf_lock);
 
+/* Work for printk_tick(), which can wake tasks where printk() cannot */
+#define PRINTK_PENDING_WAKEUP	0x01	/* klogd */
+#define PRINTK_PENDING_OUTPUT	0x02	/* the async printk thread */
+
+static DEFINE_PER_CPU(int, printk_pending);
+
+#ifdef CONFIG_PRINTK_ASYNC
+/*
+ * With printk.async set, printk() only stores messages in log_buf and
+ * the printk thread writes them to the consoles, so a printk() from an
+ * interrupt handler or other hot path no longer waits for a serial port
+ * or the ram_console ECC. Messages printed in a burst faster than the
+ * consoles take them are lost to the consoles once log_buf wraps, the
+ * thread reports how many bytes were.
+ */
+static int printk_async = 1;
+module_param_named(async, printk_async, bool, S_IRUGO | S_IWUSR);
+
+static unsigned long console_dropped;	/* bytes skipped by the consoles */
+module_param_named(console_dropped, console_dropped, ulong, S_IRUGO);
+
+static struct task_struct *printk_async_task;
+static DECLARE_WAIT_QUEUE_HEAD(printk_async_wait);
+static int printk_async_kick;
+#endif
+
 #define LOG_BUF_MASK (log_buf_len-1)
 #define LOG_BUF(idx) (log_buf[(idx) & LOG_BUF_MASK])
 
@@ -729,8 +756,12 @@ static void emit_log_char(char c)
 	log_end++;
 	if (log_end - log_start > log_buf_len)
 		log_start = log_end - log_buf_len;
-	if (log_end - con_start > log_buf_len)
+	if (log_end - con_start > log_buf_len) {
 		con_start = log_end - log_buf_len;
+#ifdef CONFIG_PRINTK_ASYNC
+		console_dropped++;
+#endif
+	}
 	if (logged_chars < log_buf_len)
 		logged_chars++;
 }
@@ -867,6 +898,67 @@ static int console_trylock_for_printk(unsigned int cpu)
 	spin_unlock(&logbuf_lock);
 	return retval;
 }
+
+#ifdef CONFIG_PRINTK_ASYNC
+/*
+ * Called like console_trylock_for_printk(). Returns true, with
+ * 'logbuf_lock' released, if the printk thread is to write the new
+ * output: not before it runs and not while oopsing, when the messages
+ * have to be out before anything else happens.
+ */
+static int printk_async_defer(void)
+{
+	if (!printk_async || !printk_async_task || oops_in_progress)
+		return 0;
+
+	__this_cpu_or(printk_pending, PRINTK_PENDING_OUTPUT);
+	printk_cpu = UINT_MAX;
+	spin_unlock(&logbuf_lock);
+	return 1;
+}
+
+static int printk_async_thread(void *unused)
+{
+	unsigned long dropped, reported = 0;
+
+	for (;;) {
+		wait_event_interruptible(printk_async_wait, printk_async_kick);
+		printk_async_kick = 0;
+
+		console_lock();
+		console_unlock();
+
+		dropped = console_dropped;
+		if (dropped != reported) {
+			printk(KERN_WARNING "printk: %lu bytes dropped before "
+			       "reaching the console\n", dropped - reported);
+			reported = dropped;
+		}
+	}
+
+	return 0;
+}
+
+static int __init printk_async_init(void)
+{
+	struct task_struct *task;
+
+	task = kthread_run(printk_async_thread, NULL, "kprintkd");
+	if (IS_ERR(task)) {
+		printk(KERN_ERR "printk: unable to start kprintkd\n");
+		return PTR_ERR(task);
+	}
+	printk_async_task = task;
+	return 0;
+}
+early_initcall(printk_async_init);
+#else
+static inline int printk_async_defer(void)
+{
+	return 0;
+}
+#endif /* CONFIG_PRINTK_ASYNC */
+
 static const char recursion_bug_msg [] =
 		KERN_CRIT "BUG: recent printk recursion!\n";
 static int recursion_bug;
@@ -1020,8 +1112,10 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	 * The console_trylock_for_printk() function
 	 * will release 'logbuf_lock' regardless of whether it
 	 * actually gets the semaphore or not.
+	 *
+	 * In async mode the printk thread does all of this instead.
 	 */
-	if (console_trylock_for_printk(this_cpu))
+	if (!printk_async_defer() && console_trylock_for_printk(this_cpu))
 		console_unlock();
 
 	lockdep_on();
@@ -1268,13 +1362,20 @@ int is_console_locked(void)
 	return console_locked;
 }
 
-static DEFINE_PER_CPU(int, printk_pending);
-
 void printk_tick(void)
 {
-	if (__this_cpu_read(printk_pending)) {
+	int pending = __this_cpu_read(printk_pending);
+
+	if (pending) {
 		__this_cpu_write(printk_pending, 0);
-		wake_up_interruptible(&log_wait);
+#ifdef CONFIG_PRINTK_ASYNC
+		if (pending & PRINTK_PENDING_OUTPUT) {
+			printk_async_kick = 1;
+			wake_up(&printk_async_wait);
+		}
+#endif
+		if (pending & PRINTK_PENDING_WAKEUP)
+			wake_up_interruptible(&log_wait);
 	}
 }
 
@@ -1288,7 +1389,7 @@ int printk_needs_cpu(int cpu)
 void wake_up_klogd(void)
 {
 	if (waitqueue_active(&log_wait))
-		this_cpu_write(printk_pending, 1);
+		this_cpu_or(printk_pending, PRINTK_PENDING_WAKEUP);
 }
 
 /**
@@ -2473,10 +2473,34 @@ ttwu_stat(struct task_struct *p, int cpu, int wake_flags)
 #endif /* CONFIG_SCHEDSTATS */
 }
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+static inline void sched_lat_stamp(struct rq *rq, struct task_struct *p)
+{
+	p->wakeup_stamp = rq->clock;
+}
+
+/* The task woke up on another rq, whose clock may lag a little */
+static inline void sched_lat_account(struct rq *rq, struct task_struct *p)
+{
+	s64 delta;
+
+	if (!p->wakeup_stamp)
+		return;
+
+	delta = rq->clock - p->wakeup_stamp;
+	p->sched_lat_hist[sched_lat_bucket(max_t(s64, delta, 0))]++;
+	p->wakeup_stamp = 0;
+}
+#else
+static inline void sched_lat_stamp(struct rq *rq, struct task_struct *p) { }
+static inline void sched_lat_account(struct rq *rq, struct task_struct *p) { }
+#endif
+
 static void ttwu_activate(struct rq *rq, struct task_struct *p, int en_flags)
 {
 	activate_task(rq, p, en_flags);
 	p->on_rq = 1;
+	sched_lat_stamp(rq, p);
 
 	/* if a worker is waking up, notify workqueue */
 	if (p->flags & PF_WQ_WORKER)
@@ -2815,6 +2839,11 @@ static void __sched_fork(struct task_struct *p)
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
 #endif
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	p->wakeup_stamp = 0;
+	memset(p->sched_lat_hist, 0, sizeof(p->sched_lat_hist));
+#endif
+
 	INIT_LIST_HEAD(&p->rt.run_list);
 
 #ifdef CONFIG_PREEMPT_NOTIFIERS
@@ -2925,6 +2954,7 @@ void wake_up_new_task(struct task_struct *p)
 	rq = __task_rq_lock(p);
 	activate_task(rq, p, 0);
 	p->on_rq = 1;
+	sched_lat_stamp(rq, p);
 	trace_sched_wakeup_new(p, true);
 	check_preempt_curr(rq, p, WF_FORK);
 #ifdef CONFIG_SMP
@@ -4301,6 +4331,7 @@ need_resched:
 
 	put_prev_task(rq, prev);
 	next = pick_next_task(rq);
+	sched_lat_account(rq, next);
 	clear_tsk_need_resched(prev);
 	rq->skip_clock_update = 0;
 
@@ -4528,6 +4559,17 @@ void __wake_up_locked_key(wait_queue_head_t *q, unsigned int mode, void *key)
 }
 EXPORT_SYMBOL_GPL(__wake_up_locked_key);
 
+/*
+ * Same as __wake_up_locked_key but with the sync hint of __wake_up_sync_key,
+ * for wake up callbacks passing on the hint they were woken with.
+ */
+void __wake_up_locked_sync_key(wait_queue_head_t *q, unsigned int mode,
+			       void *key)
+{
+	__wake_up_common(q, mode, 1, WF_SYNC, key);
+}
+EXPORT_SYMBOL_GPL(__wake_up_locked_sync_key);
+
 /**
  * __wake_up_sync_key - wake up threads blocked on a waitqueue.
  * @q: the waitqueue
@@ -67,6 +67,7 @@
 #include <linux/bootmem.h>
 #include <linux/ftrace.h>
 #include <linux/slab.h>
+#include <linux/earlysuspend.h>
 
 #include <asm/tlb.h>
 #include <asm/unistd.h>
@@ -90,6 +91,7 @@
 #define iso_queue(rq)		unlikely((rq)->rq_policy == SCHED_ISO)
 #define ISO_PERIOD		((5 * HZ * grq.noc) + 1)
 #define rq_running_iso(rq)	((rq)->rq_prio == ISO_PRIO)
+#define BATCH_PERIOD		((HZ * grq.noc) + 1)
 
 /*
  * Convert user-nice values [ -20 ... 0 ... 19 ]
@@ -145,6 +147,21 @@ int rr_interval __read_mostly = 6;
  */
 int sched_iso_cpu __read_mostly = 70;
 
+/*
+ * sched_ui_profile - sysctl which halves the virtual deadline offset of
+ * SCHED_NORMAL tasks when set. Without a cpu cgroup, android moves its
+ * background threads to SCHED_BATCH, so this tilts the CPU towards the
+ * foreground app, the UI and input threads under background load.
+ */
+int sched_ui_profile __read_mostly;
+
+/*
+ * sched_batch_cpu - sysctl which determines the cpu percentage SCHED_BATCH
+ * tasks may take over a rolling second while the screen is on before they
+ * are throttled to idle priority. 100 leaves them uncapped.
+ */
+int sched_batch_cpu __read_mostly = 25;
+
 /*
  * The relative length of deadline for each priority(nice) level.
  */
@@ -183,6 +200,10 @@ struct global_rq {
 	raw_spinlock_t iso_lock;
 	int iso_ticks;
 	int iso_refractory;
+
+	/* also under iso_lock */
+	int batch_ticks;
+	bool batch_throttled;
 };
 
 #ifdef CONFIG_SMP
@@ -675,6 +696,9 @@ static void enqueue_task(struct task_struct *p)
 		if ((idleprio_task(p) && idleprio_suitable(p)) ||
 		   (iso_task(p) && isoprio_suitable()))
 			p->prio = p->normal_prio;
+		else if (batch_task(p) && grq.batch_throttled &&
+			 idleprio_suitable(p))
+			p->prio = IDLE_PRIO;
 		else
 			p->prio = NORMAL_PRIO;
 	}
@@ -978,6 +1002,7 @@ static void activate_task(struct task_struct *p, struct rq *rq)
 	p->prio = effective_prio(p);
 	if (task_contributes_to_load(p))
 		grq.nr_uninterruptible--;
+	p->wakeup_stamp = grq.niffies;
 	enqueue_task(p);
 	grq.nr_running++;
 	inc_qnr();
@@ -1569,6 +1594,10 @@ void sched_fork(struct task_struct *p)
 
 	/* Should be reset in fork.c but done here for ease of bfs patching */
 	p->sched_time = p->stime_pc = p->utime_pc = 0;
+	p->wakeup_stamp = 0;
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	memset(p->sched_lat_hist, 0, sizeof(p->sched_lat_hist));
+#endif
 
 	/*
 	 * Revert to default priority/policy on fork if requested.
@@ -2619,6 +2648,91 @@ static inline void no_iso_tick(void)
 	}
 }
 
+/*
+ * SCHED_BATCH bandwidth cap. Without a cpu cgroup android moves background
+ * threads to SCHED_BATCH, and a share of the deadline alone does not keep
+ * a sync from getting in the way of the UI. batch_ticks is accounted like
+ * iso_ticks, over a rolling second: once SCHED_BATCH tasks have used more
+ * than sched_batch_cpu percent of it, they are queued as SCHED_IDLEPRIO
+ * tasks would be, running only when nothing else wants the CPU, until the
+ * usage falls 10% below the cap. The cap is lifted while the screen is off,
+ * when background work should finish as soon as it can.
+ */
+static bool batch_screen_off;
+
+static inline bool batch_cap_on(void)
+{
+	return sched_batch_cpu < 100 && !batch_screen_off;
+}
+
+/* Puts the throttled SCHED_BATCH tasks back with the others */
+static void batch_unthrottle(void)
+{
+	struct task_struct *p, *n;
+
+	grq_lock();
+	grq.batch_throttled = false;
+	list_for_each_entry_safe(p, n, grq.queue + IDLE_PRIO, run_list) {
+		if (batch_task(p)) {
+			dequeue_task(p);
+			enqueue_task(p);
+		}
+	}
+	grq_unlock();
+}
+
+static void batch_tick(struct rq *rq)
+{
+	bool running = !rq_idle(rq) && rq->rq_policy == SCHED_BATCH &&
+		       rq->rq_prio == NORMAL_PRIO;
+
+	if (running || grq.batch_ticks) {
+		grq_iso_lock();
+		if (!running)
+			grq.batch_ticks -= grq.batch_ticks / BATCH_PERIOD + 1;
+		else if (grq.batch_ticks <= (BATCH_PERIOD * 100) - 100)
+			grq.batch_ticks += 100;
+		grq_iso_unlock();
+	}
+
+	if (likely(!grq.batch_throttled)) {
+		if (batch_cap_on() &&
+		    grq.batch_ticks > BATCH_PERIOD * sched_batch_cpu) {
+			grq.batch_throttled = true;
+			/* requeue it throttled, as ISO tasks are demoted */
+			if (running)
+				rq->rq_time_slice = 0;
+		}
+	} else if (!batch_cap_on() || grq.batch_ticks <
+		   BATCH_PERIOD * (sched_batch_cpu * 115 / 128))
+		batch_unthrottle();
+}
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void batch_early_suspend(struct early_suspend *h)
+{
+	batch_screen_off = true;
+}
+
+static void batch_late_resume(struct early_suspend *h)
+{
+	batch_screen_off = false;
+}
+
+static struct early_suspend batch_suspend = {
+	.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN,
+	.suspend = batch_early_suspend,
+	.resume = batch_late_resume,
+};
+
+static int __init batch_suspend_init(void)
+{
+	register_early_suspend(&batch_suspend);
+	return 0;
+}
+late_initcall(batch_suspend_init);
+#endif
+
 /* This manages tasks that have run out of timeslice during a scheduler_tick */
 static void task_running_tick(struct rq *rq)
 {
@@ -2689,6 +2803,7 @@ void scheduler_tick(void)
 	/* grq lock not grabbed, so only update rq clock */
 	update_rq_clock(rq);
 	update_cpu_clock(rq, rq->curr, 1);
+	batch_tick(rq);
 	if (!rq_idle(rq))
 		task_running_tick(rq);
 	else
@@ -2768,14 +2883,21 @@ static inline u64 prio_deadline_diff(int user_prio)
 	return (prio_ratios[user_prio] * rr_interval * (MS_TO_NS(1) / 128));
 }
 
+static inline u64 ui_deadline_diff(struct task_struct *p, u64 diff)
+{
+	if (sched_ui_profile && p->policy == SCHED_NORMAL)
+		return diff >> 1;
+	return diff;
+}
+
 static inline u64 task_deadline_diff(struct task_struct *p)
 {
-	return prio_deadline_diff(TASK_USER_PRIO(p));
+	return ui_deadline_diff(p, prio_deadline_diff(TASK_USER_PRIO(p)));
 }
 
-static inline u64 static_deadline_diff(int static_prio)
+static inline u64 static_deadline_diff(struct task_struct *p, int static_prio)
 {
-	return prio_deadline_diff(USER_PRIO(static_prio));
+	return ui_deadline_diff(p, prio_deadline_diff(USER_PRIO(static_prio)));
 }
 
 static inline int longest_deadline_diff(void)
@@ -2982,8 +3104,60 @@ static inline void schedule_debug(struct task_struct *prev)
  * which is only modified by the local CPU, thereby allowing the data to be
  * changed without grabbing the grq lock.
  */
+/*
+ * Wake up to run latency, in power of two usec buckets for each policy.
+ * Protected by the grq lock. Read and reset through /proc/sched_latency.
+ */
+enum {
+	WAKEUP_LAT_RT,
+	WAKEUP_LAT_ISO,
+	WAKEUP_LAT_NORMAL,
+	WAKEUP_LAT_BATCH,
+	WAKEUP_LAT_IDLEPRIO,
+	WAKEUP_LAT_POLICIES,
+};
+
+static const char *wakeup_lat_names[WAKEUP_LAT_POLICIES] = {
+	"rt", "iso", "normal", "batch", "idleprio",
+};
+
+static unsigned long wakeup_lat[WAKEUP_LAT_POLICIES][SCHED_LAT_BUCKETS];
+
+static inline int wakeup_lat_policy(struct task_struct *p)
+{
+	switch (p->policy) {
+	case SCHED_FIFO:
+	case SCHED_RR:
+		return WAKEUP_LAT_RT;
+	case SCHED_ISO:
+		return WAKEUP_LAT_ISO;
+	case SCHED_BATCH:
+		return WAKEUP_LAT_BATCH;
+	case SCHED_IDLEPRIO:
+		return WAKEUP_LAT_IDLEPRIO;
+	default:
+		return WAKEUP_LAT_NORMAL;
+	}
+}
+
+static inline void account_wakeup_lat(struct task_struct *p)
+{
+	int bucket;
+
+	if (!p->wakeup_stamp)
+		return;
+
+	bucket = sched_lat_bucket(grq.niffies - p->wakeup_stamp);
+	wakeup_lat[wakeup_lat_policy(p)][bucket]++;
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	p->sched_lat_hist[bucket]++;
+#endif
+	p->wakeup_stamp = 0;
+}
+
 static inline void set_rq_task(struct rq *rq, struct task_struct *p)
 {
+	account_wakeup_lat(p);
 	rq->rq_time_slice = p->time_slice;
 	rq->rq_deadline = p->deadline;
 	rq->rq_last_ran = p->last_ran = rq->clock;
@@ -3320,6 +3494,17 @@ void __wake_up_locked_key(wait_queue_head_t *q, unsigned int mode, void *key)
 }
 EXPORT_SYMBOL_GPL(__wake_up_locked_key);
 
+/*
+ * Same as __wake_up_locked_key but with the sync hint of __wake_up_sync_key,
+ * for wake up callbacks passing on the hint they were woken with.
+ */
+void __wake_up_locked_sync_key(wait_queue_head_t *q, unsigned int mode,
+			       void *key)
+{
+	__wake_up_common(q, mode, 1, WF_SYNC, key);
+}
+EXPORT_SYMBOL_GPL(__wake_up_locked_sync_key);
+
 /**
  * __wake_up_sync_key - wake up threads blocked on a waitqueue.
  * @q: the waitqueue
@@ -3701,7 +3886,7 @@ void rt_mutex_setprio(struct task_struct *p, int prio)
  */
 static inline void adjust_deadline(struct task_struct *p, int new_prio)
 {
-	p->deadline += static_deadline_diff(new_prio) - task_deadline_diff(p);
+	p->deadline += static_deadline_diff(p, new_prio) - task_deadline_diff(p);
 }
 
 void set_user_nice(struct task_struct *p, long nice)
@@ -6752,6 +6937,62 @@ void __init sched_init_smp(void)
 
 unsigned int sysctl_timer_migration = 1;
 
+static int sched_latency_show(struct seq_file *seq, void *v)
+{
+	unsigned long lat[SCHED_LAT_BUCKETS];
+	int i, j;
+
+	seq_printf(seq, "%-8s", "us");
+	for (j = 0; j < SCHED_LAT_BUCKETS; j++)
+		seq_printf(seq, " %8lu", 1UL << j);
+	seq_putc(seq, '\n');
+
+	for (i = 0; i < WAKEUP_LAT_POLICIES; i++) {
+		grq_lock_irq();
+		memcpy(lat, wakeup_lat[i], sizeof(lat));
+		grq_unlock_irq();
+
+		seq_printf(seq, "%-8s", wakeup_lat_names[i]);
+		for (j = 0; j < SCHED_LAT_BUCKETS; j++)
+			seq_printf(seq, " %8lu", lat[j]);
+		seq_putc(seq, '\n');
+	}
+
+	return 0;
+}
+
+static int sched_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sched_latency_show, NULL);
+}
+
+/* Any write clears the histograms */
+static ssize_t sched_latency_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	grq_lock_irq();
+	memset(wakeup_lat, 0, sizeof(wakeup_lat));
+	grq_unlock_irq();
+
+	return count;
+}
+
+static const struct file_operations proc_sched_latency_operations = {
+	.open    = sched_latency_open,
+	.read    = seq_read,
+	.write   = sched_latency_write,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+static int __init proc_sched_latency_init(void)
+{
+	proc_create("sched_latency", S_IRUGO | S_IWUSR, NULL,
+		    &proc_sched_latency_operations);
+	return 0;
+}
+module_init(proc_sched_latency_init);
+
 int in_sched_functions(unsigned long addr)
 {
 	return in_lock_functions(addr) ||
@@ -6774,6 +7015,8 @@ void __init sched_init(void)
 	grq.last_jiffy = jiffies;
 	raw_spin_lock_init(&grq.iso_lock);
 	grq.iso_ticks = grq.iso_refractory = 0;
+	grq.batch_ticks = 0;
+	grq.batch_throttled = false;
 	grq.noc = 1;
 #ifdef CONFIG_SMP
 	init_defrootdomain();
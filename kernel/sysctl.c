@@ -125,6 +125,8 @@ static int __maybe_unused one_hundred = 100;
 #ifdef CONFIG_SCHED_BFS
 extern int rr_interval;
 extern int sched_iso_cpu;
+extern int sched_ui_profile;
+extern int sched_batch_cpu;
 static int __read_mostly one_thousand = 1000;
 #endif
 #ifdef CONFIG_PRINTK
@@ -275,6 +277,7 @@ static int max_sched_tunable_scaling = SCHED_TUNABLESCALING_END-1;
 #ifdef CONFIG_COMPACTION
 static int min_extfrag_threshold;
 static int max_extfrag_threshold = 1000;
+static int max_compact_order = MAX_ORDER - 1;
 #endif
 
 static struct ctl_table kern_table[] = {
@@ -857,6 +860,24 @@ static struct ctl_table kern_table[] = {
 		.extra1		= &zero,
 		.extra2		= &one_hundred,
 	},
+	{
+		.procname	= "sched_ui_profile",
+		.data		= &sched_ui_profile,
+		.maxlen		= sizeof (int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one,
+	},
+	{
+		.procname	= "batch_cpu",
+		.data		= &sched_batch_cpu,
+		.maxlen		= sizeof (int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one_hundred,
+	},
 #endif
 #if defined(CONFIG_S390) && defined(CONFIG_SMP)
 	{
@@ -1112,6 +1133,42 @@ static struct ctl_table vm_table[] = {
 		.proc_handler	= proc_dointvec_minmax,
 		.extra1		= &zero,
 	},
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	{
+		.procname	= "dirty_background_ratio_screen_off",
+		.data		= &dirty_screen_off.background_ratio,
+		.maxlen		= sizeof(dirty_screen_off.background_ratio),
+		.mode		= 0644,
+		.proc_handler	= dirty_screen_off_handler,
+		.extra1		= &zero,
+		.extra2		= &one_hundred,
+	},
+	{
+		.procname	= "dirty_ratio_screen_off",
+		.data		= &dirty_screen_off.ratio,
+		.maxlen		= sizeof(dirty_screen_off.ratio),
+		.mode		= 0644,
+		.proc_handler	= dirty_screen_off_handler,
+		.extra1		= &zero,
+		.extra2		= &one_hundred,
+	},
+	{
+		.procname	= "dirty_expire_centisecs_screen_off",
+		.data		= &dirty_screen_off.expire_interval,
+		.maxlen		= sizeof(dirty_screen_off.expire_interval),
+		.mode		= 0644,
+		.proc_handler	= dirty_screen_off_handler,
+		.extra1		= &zero,
+	},
+	{
+		.procname	= "dirty_writeback_centisecs_screen_off",
+		.data		= &dirty_screen_off.writeback_interval,
+		.maxlen		= sizeof(dirty_screen_off.writeback_interval),
+		.mode		= 0644,
+		.proc_handler	= dirty_screen_off_handler,
+		.extra1		= &zero,
+	},
+#endif
 	{
 		.procname	= "nr_pdflush_threads",
 		.data		= &nr_pdflush_threads,
@@ -1128,6 +1185,22 @@ static struct ctl_table vm_table[] = {
 		.extra1		= &zero,
 		.extra2		= &one_hundred,
 	},
+	{
+		.procname	= "swap_cost",
+		.data		= &vm_swap_cost,
+		.maxlen		= sizeof(vm_swap_cost),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one,
+	},
+	{
+		.procname	= "reclaim_cost",
+		.data		= &vm_reclaim_cost,
+		.maxlen		= sizeof(vm_reclaim_cost),
+		.mode		= 0444,
+		.proc_handler	= proc_doulongvec_minmax,
+	},
 #ifdef CONFIG_HUGETLB_PAGE
 	{
 		.procname	= "nr_hugepages",
@@ -1206,6 +1279,31 @@ static struct ctl_table vm_table[] = {
 		.extra1		= &min_extfrag_threshold,
 		.extra2		= &max_extfrag_threshold,
 	},
+	{
+		.procname	= "compact_proactive_order",
+		.data		= &sysctl_compact_proactive_order,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &one,
+		.extra2		= &max_compact_order,
+	},
+	{
+		.procname	= "compact_proactive_blocks",
+		.data		= &sysctl_compact_proactive_blocks,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+	},
+	{
+		.procname	= "compact_proactive_interval",
+		.data		= &sysctl_compact_proactive_interval,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+	},
 
 #endif /* CONFIG_COMPACTION */
 	{
@@ -1542,6 +1640,14 @@ static struct ctl_table fs_table[] = {
 		.proc_handler	= &pipe_proc_fn,
 		.extra1		= &pipe_min_size,
 	},
+	{
+		.procname	= "pipe-auto-max-size",
+		.data		= &pipe_auto_max_size,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.extra1		= &zero,
+	},
 	{ }
 };
 
@@ -0,0 +1,171 @@
+/*
+ * LZ4 decompressor for the Linux kernel, for the pre-boot environment
+ * and initramfs.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Input is the legacy format of the lz4c tool (lz4c -l): a magic number,
+ * then chunks of a 32 bit little endian compressed size followed by one
+ * block that decompresses to at most LZ4_CHUNK_SIZE. Concatenated files
+ * repeat the magic. The kernel build appends the uncompressed size,
+ * which unlike a chunk size has nothing after it.
+ */
+
+#ifdef STATIC
+#include "lz4/lz4_decompress.c"
+#else
+#include <linux/decompress/unlz4.h>
+#endif
+
+#include <linux/types.h>
+#include <linux/lz4.h>
+#include <linux/decompress/mm.h>
+
+#include <linux/compiler.h>
+#include <asm/unaligned.h>
+
+#define LZ4_MAGIC		0x184c2102
+#define LZ4_CHUNK_SIZE		(8 << 20)
+
+/* Tops up in_buf to want bytes, returns how many it holds */
+STATIC inline int INIT unlz4_fill(int (*fill) (void *, unsigned int),
+				  u8 *in_buf, int in_len, int want)
+{
+	int n;
+
+	while (in_len < want) {
+		n = fill(in_buf + in_len, want - in_len);
+		if (n <= 0)
+			break;
+		in_len += n;
+	}
+	return in_len;
+}
+
+STATIC inline int INIT unlz4(u8 *input, int in_len,
+				int (*fill) (void *, unsigned int),
+				int (*flush) (void *, unsigned int),
+				u8 *output, int *posp,
+				void (*error) (char *x))
+{
+	const int chunk_max = lz4_compressbound(LZ4_CHUNK_SIZE);
+	u8 *in_buf, *out_buf;
+	size_t dst_len;
+	u32 chunk;
+	int want, ret = -1;
+
+	if (output) {
+		out_buf = output;
+	} else if (!flush) {
+		error("NULL output pointer and no flush function provided");
+		goto exit;
+	} else {
+		out_buf = large_malloc(LZ4_CHUNK_SIZE);
+		if (!out_buf) {
+			error("Could not allocate output buffer");
+			goto exit;
+		}
+	}
+
+	if (input && fill) {
+		error("Both input pointer and fill function provided, don't know what to do");
+		goto exit_1;
+	} else if (input) {
+		in_buf = input;
+	} else if (!fill) {
+		error("NULL input pointer and missing fill function");
+		goto exit_1;
+	} else {
+		in_buf = large_malloc(chunk_max);
+		if (!in_buf) {
+			error("Could not allocate input buffer");
+			goto exit_1;
+		}
+		in_len = 0;
+	}
+
+	if (posp)
+		*posp = 0;
+
+	if (fill)
+		in_len = unlz4_fill(fill, in_buf, 0, 4);
+	if (in_len < 4 || get_unaligned_le32(in_buf) != LZ4_MAGIC) {
+		error("invalid header");
+		goto exit_2;
+	}
+	if (posp)
+		*posp = 4;
+	if (!fill) {
+		in_buf += 4;
+		in_len -= 4;
+	}
+
+	for (;;) {
+		/* the size of the chunk, or of the whole after the last one */
+		if (fill)
+			in_len = unlz4_fill(fill, in_buf, 0, 4);
+		if (in_len < 4) {
+			error("file corrupted");
+			goto exit_2;
+		}
+		chunk = get_unaligned_le32(in_buf);
+		if (posp)
+			*posp += 4;
+		if (fill) {
+			in_len = 0;
+		} else {
+			in_buf += 4;
+			in_len -= 4;
+		}
+
+		if (chunk == LZ4_MAGIC)
+			continue;
+
+		if (fill) {
+			want = chunk < chunk_max ? chunk : chunk_max;
+			in_len = unlz4_fill(fill, in_buf, 0, want);
+		}
+		if (!in_len)
+			break;
+
+		if (chunk > chunk_max || chunk > in_len) {
+			error("file corrupted");
+			goto exit_2;
+		}
+
+		dst_len = LZ4_CHUNK_SIZE;
+		if (lz4_decompress_unknownoutputsize(in_buf, chunk,
+						     out_buf, &dst_len)) {
+			error("Compressed data violation");
+			goto exit_2;
+		}
+
+		if (flush && flush(out_buf, dst_len) != dst_len)
+			goto exit_2;
+		if (output)
+			out_buf += dst_len;
+		if (posp)
+			*posp += chunk;
+
+		if (!fill) {
+			in_buf += chunk;
+			in_len -= chunk;
+			if (!in_len)
+				break;
+		}
+	}
+
+	ret = 0;
+exit_2:
+	if (!input)
+		large_free(in_buf);
+exit_1:
+	if (!output)
+		large_free(out_buf);
+exit:
+	return ret;
+}
+
+#define decompress unlz4
@@ -0,0 +1,132 @@
+/*
+ * LZ4 Decompressor for the Linux kernel
+ *
+ * Decodes the block format of the LZ4 reference implementation by Yann
+ * Collet, http://code.google.com/p/lz4/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * A block is a run of sequences, each a token byte, literals and a
+ * match: the high nibble of the token is the literal length, the low
+ * one the match length less MINMATCH, and either is extended by the
+ * bytes following while they are 255. The match offset, 16 bits little
+ * endian, follows the literals. The last sequence has literals only.
+ *
+ * Every length and offset is checked against the buffers, so corrupt
+ * input cannot write or read outside of them. Copies go through
+ * memcpy(), which the pre-boot environments provide as well.
+ */
+
+#ifndef STATIC
+#include <linux/module.h>
+#include <linux/kernel.h>
+#endif
+
+#include <linux/types.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+
+#define MINMATCH	4
+#define ML_BITS		4
+#define ML_MASK		((1U << ML_BITS) - 1)
+#define RUN_MASK	((1U << (8 - ML_BITS)) - 1)
+
+/*
+ * Adds the extension bytes of a length to *length. Returns false if the
+ * input ends before the last of them.
+ */
+static inline bool lz4_read_length(const u8 **ipp, const u8 *iend,
+				   size_t *length)
+{
+	const u8 *ip = *ipp;
+	u8 s;
+
+	do {
+		if (ip == iend)
+			return false;
+		s = *ip++;
+		*length += s;
+	} while (s == 255);
+
+	*ipp = ip;
+	return true;
+}
+
+/*
+ * A match may overlap its own output, repeating the last offset bytes.
+ * Copying from ref what is already there doubles the non overlapping
+ * part on each pass, so short offsets take a few copies, not a byte
+ * loop.
+ */
+static inline void lz4_copy_match(u8 *op, const u8 *ref, size_t length)
+{
+	size_t n;
+
+	while (length > (size_t)(op - ref)) {
+		n = op - ref;
+		memcpy(op, ref, n);
+		op += n;
+		length -= n;
+	}
+	memcpy(op, ref, length);
+}
+
+int lz4_decompress_unknownoutputsize(const unsigned char *src, size_t src_len,
+				     unsigned char *dest, size_t *dest_len)
+{
+	const u8 *ip = src, * const iend = src + src_len;
+	u8 *op = dest, * const oend = dest + *dest_len;
+	size_t length, offset;
+	u8 token;
+
+	while (ip < iend) {
+		token = *ip++;
+
+		/* literals */
+		length = token >> ML_BITS;
+		if (length == RUN_MASK && !lz4_read_length(&ip, iend, &length))
+			goto error;
+		if (length > (size_t)(iend - ip) ||
+		    length > (size_t)(oend - op))
+			goto error;
+		memcpy(op, ip, length);
+		op += length;
+		ip += length;
+
+		/* the last sequence ends the block */
+		if (ip == iend)
+			break;
+
+		/* match */
+		if (iend - ip < 2)
+			goto error;
+		offset = get_unaligned_le16(ip);
+		ip += 2;
+		if (!offset || offset > (size_t)(op - dest))
+			goto error;
+
+		length = token & ML_MASK;
+		if (length == ML_MASK && !lz4_read_length(&ip, iend, &length))
+			goto error;
+		length += MINMATCH;
+		if (length > (size_t)(oend - op))
+			goto error;
+		lz4_copy_match(op, op - offset, length);
+		op += length;
+	}
+
+	*dest_len = op - dest;
+	return 0;
+
+error:
+	return -1;
+}
+#ifndef STATIC
+EXPORT_SYMBOL(lz4_decompress_unknownoutputsize);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Decompressor");
+#endif
@@ -17,6 +17,19 @@
 #include <asm/unaligned.h>
 #include "lzodefs.h"
 
+static inline unsigned char *lzo_copy_literals(unsigned char *op,
+		const unsigned char *ii, size_t t, int fast)
+{
+	if (fast) {
+		for (; t >= 4; t -= 4, op += 4, ii += 4)
+			lzo_store32(op, lzo_load32(ii));
+	}
+	while (t--)
+		*op++ = *ii++;
+
+	return op;
+}
+
 static noinline size_t
 _lzo1x_1_do_compress(const unsigned char *in, size_t in_len,
 		unsigned char *out, size_t *out_len, void *wrkmem)
@@ -28,6 +41,7 @@ _lzo1x_1_do_compress(const unsigned char *in, size_t in_len,
 	const unsigned char *end, *m, *m_pos;
 	size_t m_off, m_len, dindex;
 	unsigned char *op = out;
+	const int fast = lzo_fast_unaligned();
 
 	ip += 4;
 
@@ -93,9 +107,8 @@ match:
 				}
 				*op++ = tt;
 			}
-			do {
-				*op++ = *ii++;
-			} while (--t > 0);
+			op = lzo_copy_literals(op, ii, t, fast);
+			ii += t;
 		}
 
 		ip += 3;
@@ -125,6 +138,18 @@ match:
 			end = in_end;
 			m = m_pos + M2_MAX_LEN + 1;
 
+			/* a word at a time, up to the first differing byte */
+			while (fast && end - ip >= 4) {
+				u32 x = lzo_load32(m) ^ lzo_load32(ip);
+
+				if (x) {
+					m += __ffs(x) >> 3;
+					ip += __ffs(x) >> 3;
+					break;
+				}
+				m += 4;
+				ip += 4;
+			}
 			while (ip < end && *m == *ip) {
 				m++;
 				ip++;
@@ -207,9 +232,7 @@ int lzo1x_1_compress(const unsigned char *in, size_t in_len, unsigned char *out,
 
 			*op++ = tt;
 		}
-		do {
-			*op++ = *ii++;
-		} while (--t > 0);
+		op = lzo_copy_literals(op, ii, t, lzo_fast_unaligned());
 	}
 
 	*op++ = M4_MARKER | 1;
@@ -24,8 +24,14 @@
 #define HAVE_OP(x, op_end, op) ((size_t)(op_end - op) < (x))
 #define HAVE_LB(m_pos, out, op) (m_pos < out || m_pos >= op)
 
-#define COPY4(dst, src)	\
-		put_unaligned(get_unaligned((const u32 *)(src)), (u32 *)(dst))
+#define COPY4(dst, src)							\
+	do {								\
+		if (fast)						\
+			lzo_store32((dst), lzo_load32(src));		\
+		else							\
+			put_unaligned(get_unaligned((const u32 *)(src)), \
+				      (u32 *)(dst));			\
+	} while (0)
 
 int lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
 			unsigned char *out, size_t *out_len)
@@ -34,6 +40,7 @@ int lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
 	unsigned char * const op_end = out + *out_len;
 	const unsigned char *ip = in, *m_pos;
 	unsigned char *op = out;
+	const int fast = lzo_fast_unaligned();
 	size_t t;
 
 	*out_len = 0;
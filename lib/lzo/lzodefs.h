@@ -38,6 +38,39 @@
 #define D_MASK		((1u << D_BITS) - 1)
 #define D_HIGH		((D_MASK >> 1) + 1)
 
+/*
+ * ARMv7 loads and stores words at any address, but only once
+ * alignment_init() has cleared the A bit: early users such as the
+ * ram console take the byte-wise path. get_unaligned() is byte-wise on
+ * ARM, so the word accesses are spelled out.
+ */
+#if defined(CONFIG_ARM) && __LINUX_ARM_ARCH__ >= 7 && defined(__ARMEL__) && \
+	!defined(STATIC)
+#include <asm/system.h>
+
+static inline int lzo_fast_unaligned(void)
+{
+	return !(cr_alignment & CR_A);
+}
+
+static inline u32 lzo_load32(const void *p)
+{
+	u32 v;
+
+	asm("ldr	%0, %1" : "=r" (v) : "Q" (*(const u32 *)p));
+	return v;
+}
+
+static inline void lzo_store32(void *p, u32 v)
+{
+	asm("str	%1, %0" : "=Q" (*(u32 *)p) : "r" (v));
+}
+#else
+#define lzo_fast_unaligned()	0
+#define lzo_load32(p)		get_unaligned((const u32 *)(p))
+#define lzo_store32(p, v)	put_unaligned((v), (u32 *)(p))
+#endif
+
 #define DX2(p, s1, s2)	(((((size_t)((p)[2]) << (s2)) ^ (p)[1]) \
 							<< (s1)) ^ (p)[0])
 #define DX3(p, s1, s2, s3)	((DX2((p)+1, s2, s3) << (s1)) ^ (p)[0])
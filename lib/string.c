@@ -600,6 +600,12 @@ void *memcpy(void *dest, const void *src, size_t count)
 	unsigned long dstp = (unsigned long)dest; 
 	unsigned long srcp = (unsigned long)src; 
 
+#ifdef CONFIG_NEON_COPY
+	if (unlikely(memcpy_neon_threshold && count >= memcpy_neon_threshold) &&
+	    memcpy_neon(dest, src, count))
+		return dest;
+#endif
+
 	/* Copy from the beginning to the end */ 
 	mem_copy_fwd(dstp, srcp, count); 
 	return dest;
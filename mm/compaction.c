@@ -14,6 +14,8 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -38,6 +40,7 @@ struct compact_control {
 	unsigned int order;		/* order a direct compactor needs */
 	int migratetype;		/* MOVABLE, RECLAIMABLE etc */
 	struct zone *zone;
+	bool proactive;			/* kcompactd building free blocks */
 };
 
 static unsigned long release_freepages(struct list_head *freelist)
@@ -124,8 +127,8 @@ static bool suitable_migration_target(struct page *page)
 	if (PageBuddy(page) && page_order(page) >= pageblock_order)
 		return true;
 
-	/* If the block is MIGRATE_MOVABLE, allow migration */
-	if (migratetype == MIGRATE_MOVABLE)
+	/* If the block is MIGRATE_MOVABLE or MIGRATE_CMA, allow migration */
+	if (migratetype == MIGRATE_MOVABLE || is_migrate_cma(migratetype))
 		return true;
 
 	/* Otherwise skip the block */
@@ -462,6 +465,21 @@ static void update_nr_listpages(struct compact_control *cc)
 	cc->nr_freepages = nr_freepages;
 }
 
+/* Free blocks of order or larger in zone, counted in blocks of order */
+static unsigned long zone_free_blocks(struct zone *zone, unsigned int order)
+{
+	unsigned long blocks = 0;
+	unsigned int o;
+
+	for (o = order; o < MAX_ORDER; o++)
+		blocks += zone->free_area[o].nr_free << (o - order);
+
+	return blocks;
+}
+
+int sysctl_compact_proactive_order = 4;
+int sysctl_compact_proactive_blocks = 8;
+
 static int compact_finished(struct zone *zone,
 			    struct compact_control *cc)
 {
@@ -475,6 +493,12 @@ static int compact_finished(struct zone *zone,
 	if (cc->free_pfn <= cc->migrate_pfn)
 		return COMPACT_COMPLETE;
 
+	/* kcompactd: done once the zone holds its target of free blocks */
+	if (cc->proactive)
+		return zone_free_blocks(zone, cc->order) >=
+			sysctl_compact_proactive_blocks ?
+				COMPACT_PARTIAL : COMPACT_CONTINUE;
+
 	/*
 	 * order == -1 is expected when compacting via
 	 * /proc/sys/vm/compact_memory
@@ -558,6 +582,11 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 	int ret;
 
 	ret = compaction_suitable(zone, cc->order);
+
+	/* One free block is not enough when building a reserve of them */
+	if (ret == COMPACT_PARTIAL && cc->proactive)
+		ret = COMPACT_CONTINUE;
+
 	switch (ret) {
 	case COMPACT_PARTIAL:
 	case COMPACT_SKIPPED:
@@ -758,6 +787,123 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+/*
+ * Background compaction. The ion heaps and the MFC and JPEG codecs make
+ * high-order allocations when a video or the camera starts, and finding
+ * memory fragmented then means stalling in direct compaction. kcompactd
+ * keeps compact_proactive_blocks free blocks of compact_proactive_order
+ * in each zone instead, compacting asynchronously at the lowest priority
+ * so it mostly runs while the CPU is otherwise idle.
+ *
+ * It looks at the zones every compact_proactive_interval seconds and when
+ * an allocation of order > 0 enters the slow path. A zone short of blocks
+ * is only compacted if enough memory is free to make them and, when no
+ * block is left, if its fragmentation index is above extfrag_threshold:
+ * otherwise the shortage is reclaim's business, not compaction's.
+ */
+int sysctl_compact_proactive_interval = 10;
+
+static DECLARE_WAIT_QUEUE_HEAD(kcompactd_wait);
+static bool kcompactd_woken;
+
+void wakeup_kcompactd(void)
+{
+	if (kcompactd_woken || !waitqueue_active(&kcompactd_wait))
+		return;
+
+	kcompactd_woken = true;
+	count_vm_event(KCOMPACTD_WAKE);
+	wake_up_interruptible(&kcompactd_wait);
+}
+
+static bool kcompactd_zone_short(struct zone *zone, int order)
+{
+	unsigned long need = (unsigned long)sysctl_compact_proactive_blocks;
+
+	if (zone_free_blocks(zone, order) >= need)
+		return false;
+
+	if (zone_page_state(zone, NR_FREE_PAGES) <
+	    low_wmark_pages(zone) + (need << (order + 1)))
+		return false;
+
+	return compaction_suitable(zone, order) != COMPACT_SKIPPED;
+}
+
+static void kcompactd_run(void)
+{
+	int order = sysctl_compact_proactive_order;
+	struct zone *zone;
+
+	if (!sysctl_compact_proactive_blocks)
+		return;
+
+	for_each_populated_zone(zone) {
+		struct compact_control cc = {
+			.nr_freepages = 0,
+			.nr_migratepages = 0,
+			.order = order,
+			.migratetype = MIGRATE_MOVABLE,
+			.zone = zone,
+			.sync = false,
+			.proactive = true,
+		};
+		u64 start;
+
+		if (!kcompactd_zone_short(zone, order))
+			continue;
+
+		count_vm_event(KCOMPACTD_RUN);
+		start = local_clock();
+
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+		compact_zone(zone, &cc);
+
+		/* Migrated pages were freed to the PCP lists, let them merge */
+		drain_local_pages(NULL);
+
+		count_vm_events(KCOMPACTD_US,
+				div_u64(local_clock() - start, NSEC_PER_USEC));
+	}
+}
+
+static int kcompactd(void *unused)
+{
+	set_freezable();
+	set_user_nice(current, 19);
+
+	while (!kthread_should_stop()) {
+		long timeout = MAX_SCHEDULE_TIMEOUT;
+
+		if (sysctl_compact_proactive_interval)
+			timeout = sysctl_compact_proactive_interval * HZ;
+
+		wait_event_freezable_timeout(kcompactd_wait,
+				kcompactd_woken || kthread_should_stop(),
+				timeout);
+		kcompactd_woken = false;
+
+		kcompactd_run();
+	}
+
+	return 0;
+}
+
+static int __init kcompactd_init(void)
+{
+	struct task_struct *tsk;
+
+	tsk = kthread_run(kcompactd, NULL, "kcompactd0");
+	if (IS_ERR(tsk)) {
+		pr_err("Failed to start kcompactd\n");
+		return PTR_ERR(tsk);
+	}
+
+	return 0;
+}
+module_init(kcompactd_init);
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 ssize_t sysfs_compact_node(struct sys_device *dev,
 			struct sysdev_attribute *attr,
@@ -500,10 +500,12 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 
 	ret = add_to_page_cache(page, mapping, offset, gfp_mask);
 	if (ret == 0) {
-		if (page_is_file_cache(page))
-			lru_cache_add_file(page);
-		else
+		if (!page_is_file_cache(page))
 			lru_cache_add_anon(page);
+		else if (workingset_refault(mapping, offset))
+			lru_cache_add_lru(page, LRU_ACTIVE_FILE);
+		else
+			lru_cache_add_file(page);
 	}
 	return ret;
 }
@@ -1631,6 +1633,7 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	struct page *page;
 	pgoff_t size;
 	int ret = 0;
+	u64 start = 0;
 
 	size = (i_size_read(inode) + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
 	if (offset >= size)
@@ -1648,6 +1651,7 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 		do_async_mmap_readahead(vma, ra, file, page, offset);
 	} else {
 		/* No page in the page cache at all */
+		start = local_clock();
 		do_sync_mmap_readahead(vma, ra, file, offset);
 		count_vm_event(PGMAJFAULT);
 		mem_cgroup_count_vm_event(vma->vm_mm, PGMAJFAULT);
@@ -1689,6 +1693,9 @@ retry_find:
 		return VM_FAULT_SIGBUS;
 	}
 
+	if (ret & VM_FAULT_MAJOR)
+		reclaim_cost_account(RECLAIM_COST_FILE, start);
+
 	vmf->page = page;
 	return ret | VM_FAULT_LOCKED;
 
@@ -16,6 +16,10 @@
 void free_pgtables(struct mmu_gather *tlb, struct vm_area_struct *start_vma,
 		unsigned long floor, unsigned long ceiling);
 
+int do_page_cache_readahead_pages(struct address_space *mapping,
+		struct file *filp, pgoff_t offset, unsigned long nr_to_read,
+		unsigned long lookahead_size);
+
 static inline void set_page_count(struct page *page, int v)
 {
 	atomic_set(&page->_count, v);
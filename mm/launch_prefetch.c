@@ -0,0 +1,354 @@
+/*
+ * mm/launch_prefetch.c
+ *
+ * Replay of the file readahead seen during earlier launches of a process.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * A process starting up reads its APK, dex and libraries in small,
+ * scattered chunks, each one a readahead window that the task waits for
+ * before it can fault in the next. Naming a process - at exec, or when
+ * an Android app forked from zygote takes its package name - starts a
+ * launch session. For the first window_ms of it, every readahead that
+ * reads pages is recorded as an extent of its file, and at the end the
+ * extents are kept as the profile of that process name.
+ *
+ * During the next launch under the same name, the first readahead of a
+ * file in the profile submits all of its recorded extents at once, in
+ * one plug, instead of one window per fault. Files are matched by device,
+ * inode number, generation and size, so a replaced or updated file is
+ * simply read as usual. Extents replayed are carried into the new
+ * profile, since the app now hits them in the page cache without
+ * recording them again.
+ *
+ * Only files of block device backed filesystems are recorded: the
+ * profile holds no references, and the readahead is submitted by the
+ * launching task itself.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/bitmap.h>
+#include <linux/blkdev.h>
+#include <linux/jiffies.h>
+#include <linux/launch_prefetch.h>
+
+#include "internal.h"
+
+#define LP_MAX_SESSIONS		8
+#define LP_MAX_PROFILES		16
+#define LP_MAX_FILES		64
+#define LP_MAX_EXTENTS		256
+
+/* Extents submitted per replay, the rest of a file is left to readahead */
+#define LP_REPLAY_BATCH		32
+
+static bool lp_enabled = true;
+module_param_named(enabled, lp_enabled, bool, 0644);
+
+/* How long after a process is named its readahead is recorded */
+static unsigned int lp_window_ms = 3000;
+module_param_named(window_ms, lp_window_ms, uint, 0644);
+
+/* Most a profile may replay, in KB */
+static unsigned int lp_max_kb = 8192;
+module_param_named(max_kb, lp_max_kb, uint, 0644);
+
+static unsigned long lp_replayed_pages;
+module_param_named(replayed_pages, lp_replayed_pages, ulong, 0444);
+
+struct lp_file {
+	dev_t		dev;
+	unsigned long	ino;
+	u32		generation;
+	loff_t		size;
+	int		last;		/* last extent of the file */
+};
+
+struct lp_extent {
+	pgoff_t		start;
+	unsigned int	nr_pages;
+	unsigned int	file;
+};
+
+struct lp_profile {
+	char		comm[TASK_COMM_LEN];
+	unsigned long	last_used;
+	unsigned long	nr_pages;
+	int		nr_files;
+	int		nr_extents;
+	struct lp_file	files[LP_MAX_FILES];
+	struct lp_extent extents[LP_MAX_EXTENTS];
+};
+
+struct lp_session {
+	pid_t		tgid;
+	unsigned long	start;
+	struct lp_profile *record;
+	struct lp_profile *replay;
+	DECLARE_BITMAP(replayed, LP_MAX_FILES);
+};
+
+static DEFINE_SPINLOCK(lp_lock);
+static struct lp_session lp_sessions[LP_MAX_SESSIONS];
+static struct lp_profile *lp_profiles[LP_MAX_PROFILES];
+
+/* Sessions with a record, checked unlocked by the readahead hooks */
+static int lp_nr_sessions;
+
+static struct lp_profile *lp_profile_find(const char *comm)
+{
+	int i;
+
+	for (i = 0; i < LP_MAX_PROFILES; i++)
+		if (lp_profiles[i] &&
+		    !strncmp(lp_profiles[i]->comm, comm, TASK_COMM_LEN))
+			return lp_profiles[i];
+
+	return NULL;
+}
+
+/* Keep rec as the profile of its name, in place of the least recent one */
+static void lp_profile_save(struct lp_profile *rec)
+{
+	struct lp_profile *old;
+	int i, slot = 0;
+
+	for (i = 0; i < LP_MAX_PROFILES; i++) {
+		if (!lp_profiles[i] ||
+		    !strncmp(lp_profiles[i]->comm, rec->comm, TASK_COMM_LEN)) {
+			slot = i;
+			break;
+		}
+		if (time_before(lp_profiles[i]->last_used,
+				lp_profiles[slot]->last_used))
+			slot = i;
+	}
+
+	old = lp_profiles[slot];
+	rec->last_used = jiffies;
+	lp_profiles[slot] = rec;
+
+	if (!old)
+		return;
+
+	for (i = 0; i < LP_MAX_SESSIONS; i++)
+		if (lp_sessions[i].replay == old)
+			lp_sessions[i].replay = NULL;
+	kfree(old);
+}
+
+static void lp_session_end(struct lp_session *s, bool save)
+{
+	if (save && s->record->nr_extents)
+		lp_profile_save(s->record);
+	else
+		kfree(s->record);
+
+	s->record = NULL;
+	s->replay = NULL;
+	s->tgid = 0;
+	lp_nr_sessions--;
+}
+
+static struct lp_session *lp_session_find(pid_t tgid)
+{
+	unsigned long window = msecs_to_jiffies(lp_window_ms);
+	struct lp_session *found = NULL;
+	int i;
+
+	for (i = 0; i < LP_MAX_SESSIONS; i++) {
+		struct lp_session *s = &lp_sessions[i];
+
+		if (!s->record)
+			continue;
+		if (time_after(jiffies, s->start + window))
+			lp_session_end(s, true);
+		else if (s->tgid == tgid)
+			found = s;
+	}
+
+	return found;
+}
+
+static int lp_file_find(struct lp_profile *p, struct inode *inode)
+{
+	int i;
+
+	for (i = 0; i < p->nr_files; i++) {
+		struct lp_file *f = &p->files[i];
+
+		if (f->ino == inode->i_ino && f->dev == inode->i_sb->s_dev &&
+		    f->generation == inode->i_generation &&
+		    f->size == i_size_read(inode))
+			return i;
+	}
+
+	return -1;
+}
+
+static void lp_record(struct lp_profile *p, struct inode *inode,
+		      pgoff_t start, unsigned long nr_pages)
+{
+	unsigned long max_pages = lp_max_kb >> (PAGE_SHIFT - 10);
+	struct lp_extent *e;
+	struct lp_file *f;
+	pgoff_t end = start + nr_pages;
+	int i;
+
+	if (p->nr_pages + nr_pages > max_pages)
+		return;
+
+	i = lp_file_find(p, inode);
+	if (i < 0) {
+		if (p->nr_files == LP_MAX_FILES)
+			return;
+		i = p->nr_files++;
+		f = &p->files[i];
+		f->dev = inode->i_sb->s_dev;
+		f->ino = inode->i_ino;
+		f->generation = inode->i_generation;
+		f->size = i_size_read(inode);
+		f->last = -1;
+	}
+	f = &p->files[i];
+
+	/* Windows that touch the last one of the file grow it */
+	if (f->last >= 0) {
+		e = &p->extents[f->last];
+		if (start <= e->start + e->nr_pages && end >= e->start) {
+			pgoff_t e_end = max_t(pgoff_t, end,
+					      e->start + e->nr_pages);
+
+			e->start = min(start, e->start);
+			p->nr_pages += e_end - e->start - e->nr_pages;
+			e->nr_pages = e_end - e->start;
+			return;
+		}
+	}
+
+	if (p->nr_extents == LP_MAX_EXTENTS)
+		return;
+
+	f->last = p->nr_extents++;
+	e = &p->extents[f->last];
+	e->start = start;
+	e->nr_pages = nr_pages;
+	e->file = i;
+	p->nr_pages += nr_pages;
+}
+
+/* A process (not one of its threads) has been named */
+void launch_prefetch_start(struct task_struct *tsk)
+{
+	struct lp_profile *rec;
+	struct lp_session *s;
+	int i;
+
+	if (!lp_enabled || !thread_group_leader(tsk) ||
+	    (tsk->flags & PF_KTHREAD))
+		return;
+
+	rec = kzalloc(sizeof(*rec), GFP_KERNEL);
+	if (!rec)
+		return;
+	get_task_comm(rec->comm, tsk);
+
+	spin_lock(&lp_lock);
+
+	/* Renamed again: what was recorded belongs to the old name */
+	s = lp_session_find(tsk->tgid);
+	if (s)
+		lp_session_end(s, false);
+
+	for (i = 0; i < LP_MAX_SESSIONS; i++)
+		if (!lp_sessions[i].record)
+			break;
+
+	if (i == LP_MAX_SESSIONS) {
+		spin_unlock(&lp_lock);
+		kfree(rec);
+		return;
+	}
+
+	s = &lp_sessions[i];
+	s->tgid = tsk->tgid;
+	s->start = jiffies;
+	s->record = rec;
+	s->replay = lp_profile_find(rec->comm);
+	if (s->replay)
+		s->replay->last_used = jiffies;
+	bitmap_zero(s->replayed, LP_MAX_FILES);
+	lp_nr_sessions++;
+
+	spin_unlock(&lp_lock);
+}
+
+/* Called before readahead of mapping by the current task */
+void launch_prefetch_replay(struct address_space *mapping, struct file *filp)
+{
+	struct lp_extent batch[LP_REPLAY_BATCH];
+	struct inode *inode = mapping->host;
+	struct blk_plug plug;
+	struct lp_profile *p;
+	struct lp_session *s;
+	int i, f, n = 0;
+
+	if (likely(!lp_nr_sessions) || !inode->i_sb->s_bdev)
+		return;
+
+	spin_lock(&lp_lock);
+
+	s = lp_session_find(current->tgid);
+	if (!s || !s->replay)
+		goto out;
+
+	p = s->replay;
+	f = lp_file_find(p, inode);
+	if (f < 0 || test_and_set_bit(f, s->replayed))
+		goto out;
+
+	for (i = 0; i < p->nr_extents && n < LP_REPLAY_BATCH; i++) {
+		if (p->extents[i].file != f)
+			continue;
+		batch[n++] = p->extents[i];
+		lp_record(s->record, inode, p->extents[i].start,
+			  p->extents[i].nr_pages);
+	}
+out:
+	spin_unlock(&lp_lock);
+
+	if (!n)
+		return;
+
+	blk_start_plug(&plug);
+	for (i = 0; i < n; i++)
+		lp_replayed_pages += do_page_cache_readahead_pages(mapping,
+				filp, batch[i].start, batch[i].nr_pages, 0);
+	blk_finish_plug(&plug);
+}
+
+/* Called after readahead of mapping read nr_pages from offset */
+void launch_prefetch_record(struct address_space *mapping, pgoff_t offset,
+			    unsigned long nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct lp_session *s;
+
+	if (likely(!lp_nr_sessions) || !inode->i_sb->s_bdev)
+		return;
+
+	spin_lock(&lp_lock);
+	s = lp_session_find(current->tgid);
+	if (s)
+		lp_record(s->record, inode, offset, nr_pages);
+	spin_unlock(&lp_lock);
+}
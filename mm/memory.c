@@ -2979,6 +2979,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	struct mem_cgroup *ptr;
 	int exclusive = 0;
 	int ret = 0;
+	u64 start = 0;
 
 	if (!pte_unmap_same(mm, pmd, page_table, orig_pte))
 		goto out;
@@ -2999,6 +3000,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	page = lookup_swap_cache(entry);
 	if (!page) {
 		grab_swap_token(mm); /* Contend for token _before_ read-in */
+		start = local_clock();
 		page = swapin_readahead(entry,
 					GFP_HIGHUSER_MOVABLE, vma, address);
 		if (!page) {
@@ -3033,6 +3035,8 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		ret |= VM_FAULT_RETRY;
 		goto out_release;
 	}
+	if (ret & VM_FAULT_MAJOR)
+		reclaim_cost_account(RECLAIM_COST_SWAPIN, start);
 
 	/*
 	 * Make sure try_to_free_swap or reuse_swap_page or swapoff did not
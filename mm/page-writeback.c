@@ -43,7 +43,6 @@
  */
 static long ratelimit_pages = 32;
 
-bool resume = true;
 /*
  * When balance_dirty_pages decides that the caller needs to perform some
  * non-background writeback, this is how many pages it will attempt to write.
@@ -774,20 +773,79 @@ static struct notifier_block __cpuinitdata ratelimit_nb = {
 	.next		= NULL,
 };
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+/*
+ * While the screen is on, the vm.dirty_* settings hold back writeback so
+ * that it comes in fewer and bigger batches. Once it turns off, they are
+ * saved and replaced by the vm.dirty_*_screen_off ones, which flush
+ * sooner, and restored when it turns back on. A ratio is left alone while
+ * the matching *_bytes setting is in use.
+ */
+struct dirty_profile dirty_screen_off = {
+	.background_ratio	= 5,
+	.ratio			= 10,
+	.expire_interval	= 5 * 100,
+	.writeback_interval	= 5 * 100,
+};
+
+static struct dirty_profile dirty_screen_on;
+static bool dirty_screen_is_off;
+
+static void dirty_profile_save(struct dirty_profile *p)
+{
+	p->background_ratio = dirty_background_ratio;
+	p->ratio = vm_dirty_ratio;
+	p->expire_interval = dirty_expire_interval;
+	p->writeback_interval = dirty_writeback_interval;
+}
+
+static void dirty_profile_apply(const struct dirty_profile *p)
+{
+	if (!dirty_background_bytes)
+		dirty_background_ratio = p->background_ratio;
+	if (!vm_dirty_bytes && vm_dirty_ratio != p->ratio) {
+		vm_dirty_ratio = p->ratio;
+		update_completion_period();
+	}
+	dirty_expire_interval = p->expire_interval;
+	dirty_writeback_interval = p->writeback_interval;
+	bdi_arm_supers_timer();
+}
+
+/*
+ * sysctl handler for /proc/sys/vm/dirty_*_screen_off, applied right away
+ * if the screen is already off
+ */
+int dirty_screen_off_handler(struct ctl_table *table, int write,
+		void __user *buffer, size_t *lenp,
+		loff_t *ppos)
+{
+	int ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, lenp, ppos);
+	if (ret == 0 && write && dirty_screen_is_off)
+		dirty_profile_apply(&dirty_screen_off);
+	return ret;
+}
+
 static void dirty_early_suspend(struct early_suspend *handler)
 {
-	dirty_writeback_interval = 5 * 100;
+	dirty_profile_save(&dirty_screen_on);
+	dirty_screen_is_off = true;
+	dirty_profile_apply(&dirty_screen_off);
 }
 
 static void dirty_late_resume(struct early_suspend *handler)
 {
-	dirty_writeback_interval = 0;
+	dirty_screen_is_off = false;
+	dirty_profile_apply(&dirty_screen_on);
 }
 
 static struct early_suspend dirty_suspend = {
 	.suspend = dirty_early_suspend,
 	.resume = dirty_late_resume,
 };
+#endif
 
 /*
  * Called early on to tune the page writeback dirty limits.
@@ -811,7 +869,9 @@ void __init page_writeback_init(void)
 {
 	int shift;
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
 	register_early_suspend(&dirty_suspend);
+#endif
 
 	writeback_set_ratelimit();
 	register_cpu_notifier(&ratelimit_nb);
@@ -57,6 +57,8 @@
 #include <linux/ftrace_event.h>
 #include <linux/memcontrol.h>
 #include <linux/prefetch.h>
+#include <linux/migrate.h>
+#include <linux/mm_inline.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -594,6 +596,28 @@ static inline int free_pages_check(struct page *page)
 	return 0;
 }
 
+#ifdef CONFIG_CMA
+/* Free pages of MIGRATE_CMA blocks are only for movable allocations */
+static inline void __mod_zone_cma_pages(struct zone *zone, long nr_pages,
+					int migratetype)
+{
+	if (is_migrate_cma(migratetype))
+		__mod_zone_page_state(zone, NR_FREE_CMA_PAGES, nr_pages);
+}
+#else
+static inline void __mod_zone_cma_pages(struct zone *zone, long nr_pages,
+					int migratetype)
+{
+}
+#endif
+
+static inline void __mod_zone_freepage_state(struct zone *zone, long nr_pages,
+					     int migratetype)
+{
+	__mod_zone_page_state(zone, NR_FREE_PAGES, nr_pages);
+	__mod_zone_cma_pages(zone, nr_pages, migratetype);
+}
+
 /*
  * Frees a number of pages from the PCP lists
  * Assumes all pages on list are in same zone, and of same order.
@@ -639,12 +663,20 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 			batch_free = to_free;
 
 		do {
+			int mt;
+
 			page = list_entry(list->prev, struct page, lru);
 			/* must delete as __free_one_page list manipulates */
 			list_del(&page->lru);
 			/* MIGRATE_MOVABLE list may include MIGRATE_RESERVEs */
-			__free_one_page(page, zone, 0, page_private(page));
-			trace_mm_page_pcpu_drain(page, 0, page_private(page));
+			mt = page_private(page);
+			/* and CMA pages whose block was isolated since */
+			if (is_migrate_cma(mt) &&
+			    get_pageblock_migratetype(page) == MIGRATE_ISOLATE)
+				mt = MIGRATE_ISOLATE;
+			__free_one_page(page, zone, 0, mt);
+			__mod_zone_cma_pages(zone, 1, mt);
+			trace_mm_page_pcpu_drain(page, 0, mt);
 		} while (--to_free && --batch_free && !list_empty(list));
 	}
 	__mod_zone_page_state(zone, NR_FREE_PAGES, count);
@@ -659,7 +691,93 @@ static void free_one_page(struct zone *zone, struct page *page, int order,
 	zone->pages_scanned = 0;
 
 	__free_one_page(page, zone, order, migratetype);
-	__mod_zone_page_state(zone, NR_FREE_PAGES, 1 << order);
+	__mod_zone_freepage_state(zone, 1 << order, migratetype);
+	spin_unlock(&zone->lock);
+}
+
+/*
+ * Blocks of order 1 to PCP_HIGH_ORDERS - kernel stacks, skbs, driver
+ * buffers - are kept on small per-cpu lists when freed, so that the next
+ * allocation of the order does not take zone->lock. The lists are only
+ * filled by frees, never from the buddy lists, as taking blocks out ahead
+ * of need would only fragment memory further. A zone under its low
+ * watermark gets its blocks straight back, and drain_pages() empties the
+ * lists along with the order-0 ones.
+ */
+static inline int pcp_high_order_max(unsigned int order)
+{
+	return 16 >> order;
+}
+
+/* Called with interrupts disabled */
+static bool pcp_high_order_free(struct zone *zone, struct page *page,
+				unsigned int order, int migratetype)
+{
+	struct per_cpu_pages *pcp;
+
+	if (!order || order > PCP_HIGH_ORDERS ||
+	    migratetype >= MIGRATE_PCPTYPES)
+		return false;
+
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	if (!pcp->high ||
+	    pcp->high_count[order - 1] >= pcp_high_order_max(order))
+		return false;
+
+	if (!zone_watermark_ok(zone, 0, low_wmark_pages(zone), 0, 0))
+		return false;
+
+	set_page_private(page, migratetype);
+	list_add(&page->lru, &pcp->high_lists[order - 1]);
+	pcp->high_count[order - 1]++;
+
+	return true;
+}
+
+/* Called with interrupts disabled */
+static struct page *pcp_high_order_alloc(struct zone *zone,
+					 unsigned int order, int migratetype)
+{
+	struct per_cpu_pages *pcp;
+	struct page *page;
+
+	if (order > PCP_HIGH_ORDERS)
+		return NULL;
+
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	list_for_each_entry(page, &pcp->high_lists[order - 1], lru) {
+		if (page_private(page) != migratetype)
+			continue;
+
+		list_del(&page->lru);
+		pcp->high_count[order - 1]--;
+		__count_vm_event(PCPHIGHHIT);
+		return page;
+	}
+
+	__count_vm_event(PCPHIGHMISS);
+	return NULL;
+}
+
+static void pcp_high_order_drain(struct zone *zone, struct per_cpu_pages *pcp)
+{
+	unsigned int order;
+
+	spin_lock(&zone->lock);
+	for (order = 1; order <= PCP_HIGH_ORDERS; order++) {
+		struct list_head *list = &pcp->high_lists[order - 1];
+
+		while (!list_empty(list)) {
+			struct page *page = list_entry(list->next,
+						       struct page, lru);
+
+			list_del(&page->lru);
+			__free_one_page(page, zone, order, page_private(page));
+		}
+		__mod_zone_page_state(zone, NR_FREE_PAGES,
+				      pcp->high_count[order - 1] << order);
+		pcp->high_count[order - 1] = 0;
+	}
 	spin_unlock(&zone->lock);
 }
 
@@ -691,18 +809,21 @@ static bool free_pages_prepare(struct page *page, unsigned int order)
 
 static void __free_pages_ok(struct page *page, unsigned int order)
 {
+	struct zone *zone = page_zone(page);
 	unsigned long flags;
+	int migratetype;
 	int wasMlocked = __TestClearPageMlocked(page);
 
 	if (!free_pages_prepare(page, order))
 		return;
 
+	migratetype = get_pageblock_migratetype(page);
 	local_irq_save(flags);
 	if (unlikely(wasMlocked))
 		free_page_mlock(page);
 	__count_vm_events(PGFREE, 1 << order);
-	free_one_page(page_zone(page), page, order,
-					get_pageblock_migratetype(page));
+	if (!pcp_high_order_free(zone, page, order, migratetype))
+		free_one_page(zone, page, order, migratetype);
 	local_irq_restore(flags);
 }
 
@@ -842,11 +963,17 @@ struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
  * This array describes the order lists are fallen back to when
  * the free lists for the desirable migrate type are depleted
  */
-static int fallbacks[MIGRATE_TYPES][MIGRATE_TYPES-1] = {
-	[MIGRATE_UNMOVABLE]   = { MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE,   MIGRATE_RESERVE },
-	[MIGRATE_RECLAIMABLE] = { MIGRATE_UNMOVABLE,   MIGRATE_MOVABLE,   MIGRATE_RESERVE },
-	[MIGRATE_MOVABLE]     = { MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE, MIGRATE_RESERVE },
-	[MIGRATE_RESERVE]     = { MIGRATE_RESERVE,     MIGRATE_RESERVE,   MIGRATE_RESERVE }, /* Never used */
+static int fallbacks[MIGRATE_TYPES][4] = {
+	[MIGRATE_UNMOVABLE]   = { MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE,     MIGRATE_RESERVE },
+	[MIGRATE_RECLAIMABLE] = { MIGRATE_UNMOVABLE,   MIGRATE_MOVABLE,     MIGRATE_RESERVE },
+#ifdef CONFIG_CMA
+	[MIGRATE_MOVABLE]     = { MIGRATE_CMA,         MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE, MIGRATE_RESERVE },
+	[MIGRATE_CMA]         = { MIGRATE_RESERVE }, /* Never used */
+#else
+	[MIGRATE_MOVABLE]     = { MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE,   MIGRATE_RESERVE },
+#endif
+	[MIGRATE_RESERVE]     = { MIGRATE_RESERVE }, /* Never used */
+	[MIGRATE_ISOLATE]     = { MIGRATE_RESERVE }, /* Never used */
 };
 
 /*
@@ -941,12 +1068,12 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 	/* Find the largest possible block of pages in the other list */
 	for (current_order = MAX_ORDER-1; current_order >= order;
 						--current_order) {
-		for (i = 0; i < MIGRATE_TYPES - 1; i++) {
+		for (i = 0;; i++) {
 			migratetype = fallbacks[start_migratetype][i];
 
 			/* MIGRATE_RESERVE handled later if necessary */
 			if (migratetype == MIGRATE_RESERVE)
-				continue;
+				break;
 
 			area = &(zone->free_area[current_order]);
 			if (list_empty(&area->free_list[migratetype]))
@@ -960,11 +1087,13 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 			 * If breaking a large block of pages, move all free
 			 * pages to the preferred allocation list. If falling
 			 * back for a reclaimable kernel allocation, be more
-			 * aggressive about taking ownership of free pages
+			 * aggressive about taking ownership of free pages.
+			 * CMA blocks are lent, never taken over.
 			 */
-			if (unlikely(current_order >= (pageblock_order >> 1)) ||
+			if (!is_migrate_cma(migratetype) &&
+			    (unlikely(current_order >= (pageblock_order >> 1)) ||
 					start_migratetype == MIGRATE_RECLAIMABLE ||
-					page_group_by_mobility_disabled) {
+					page_group_by_mobility_disabled)) {
 				unsigned long pages;
 				pages = move_freepages_block(zone, page,
 								start_migratetype);
@@ -983,7 +1112,8 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 			rmv_page_order(page);
 
 			/* Take ownership for orders >= pageblock_order */
-			if (current_order >= pageblock_order)
+			if (current_order >= pageblock_order &&
+			    !is_migrate_cma(migratetype))
 				change_pageblock_range(page, current_order,
 							start_migratetype);
 
@@ -1008,6 +1138,21 @@ static struct page *__rmqueue(struct zone *zone, unsigned int order,
 {
 	struct page *page;
 
+#ifdef CONFIG_CMA
+	/*
+	 * Movable allocations take CMA blocks first while they hold more
+	 * than half of the free memory: kswapd does not count them, so
+	 * left to the fallback they would hardly ever be used.
+	 */
+	if (migratetype == MIGRATE_MOVABLE &&
+	    zone_page_state(zone, NR_FREE_CMA_PAGES) >
+	    zone_page_state(zone, NR_FREE_PAGES) / 2) {
+		page = __rmqueue_smallest(zone, order, MIGRATE_CMA);
+		if (page)
+			goto out;
+	}
+#endif
+
 retry_reserve:
 	page = __rmqueue_smallest(zone, order, migratetype);
 
@@ -1025,6 +1170,9 @@ retry_reserve:
 		}
 	}
 
+#ifdef CONFIG_CMA
+out:
+#endif
 	trace_mm_page_alloc_zone_locked(page, order, migratetype);
 	return page;
 }
@@ -1043,9 +1191,17 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 	spin_lock(&zone->lock);
 	for (i = 0; i < count; ++i) {
 		struct page *page = __rmqueue(zone, order, migratetype);
+		int mt = migratetype;
+
 		if (unlikely(page == NULL))
 			break;
 
+#ifdef CONFIG_CMA
+		/* Drained unused, a CMA page goes back to its own lists */
+		if (is_migrate_cma(get_pageblock_migratetype(page)))
+			mt = MIGRATE_CMA;
+#endif
+
 		/*
 		 * Split buddy pages returned by expand() are received here
 		 * in physical page order. The page is added to the callers and
@@ -1059,7 +1215,8 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 			list_add(&page->lru, list);
 		else
 			list_add_tail(&page->lru, list);
-		set_page_private(page, migratetype);
+		set_page_private(page, mt);
+		__mod_zone_cma_pages(zone, -(1 << order), mt);
 		list = &page->lru;
 	}
 	__mod_zone_page_state(zone, NR_FREE_PAGES, -(i << order));
@@ -1116,6 +1273,7 @@ static void drain_pages(unsigned int cpu)
 			free_pcppages_bulk(zone, pcp->count, pcp);
 			pcp->count = 0;
 		}
+		pcp_high_order_drain(zone, pcp);
 		local_irq_restore(flags);
 	}
 }
@@ -1267,11 +1425,13 @@ int split_free_page(struct page *page)
 	unsigned int order;
 	unsigned long watermark;
 	struct zone *zone;
+	int mt;
 
 	BUG_ON(!PageBuddy(page));
 
 	zone = page_zone(page);
 	order = page_order(page);
+	mt = get_pageblock_migratetype(page);
 
 	/* Obey watermarks as if the page was being allocated */
 	watermark = low_wmark_pages(zone) + (1 << order);
@@ -1282,13 +1442,13 @@ int split_free_page(struct page *page)
 	list_del(&page->lru);
 	zone->free_area[order].nr_free--;
 	rmv_page_order(page);
-	__mod_zone_page_state(zone, NR_FREE_PAGES, -(1UL << order));
+	__mod_zone_freepage_state(zone, -(1UL << order), mt);
 
 	/* Split into individual pages */
 	set_page_refcounted(page);
 	split_page(page, order);
 
-	if (order >= pageblock_order - 1) {
+	if (order >= pageblock_order - 1 && !is_migrate_cma(mt)) {
 		struct page *endpage = page + (1 << order) - 1;
 		for (; page < endpage; page += pageblock_nr_pages)
 			set_pageblock_migratetype(page, MIGRATE_MOVABLE);
@@ -1348,12 +1508,21 @@ again:
 			 */
 			WARN_ON_ONCE(order > 1);
 		}
-		spin_lock_irqsave(&zone->lock, flags);
-		page = __rmqueue(zone, order, migratetype);
-		spin_unlock(&zone->lock);
-		if (!page)
-			goto failed;
-		__mod_zone_page_state(zone, NR_FREE_PAGES, -(1 << order));
+		local_irq_save(flags);
+		page = pcp_high_order_alloc(zone, order, migratetype);
+		if (!page) {
+			spin_lock(&zone->lock);
+			page = __rmqueue(zone, order, migratetype);
+			spin_unlock(&zone->lock);
+			if (!page)
+				goto failed;
+			__mod_zone_page_state(zone, NR_FREE_PAGES,
+					      -(1 << order));
+#ifdef CONFIG_CMA
+			__mod_zone_cma_pages(zone, -(1 << order),
+					get_pageblock_migratetype(page));
+#endif
+		}
 	}
 
 	__count_zone_vm_events(PGALLOC, zone, 1 << order);
@@ -1382,6 +1551,7 @@ failed:
 #define ALLOC_HARDER		0x10 /* try to alloc harder */
 #define ALLOC_HIGH		0x20 /* __GFP_HIGH set */
 #define ALLOC_CPUSET		0x40 /* check for correct cpuset */
+#define ALLOC_CMA		0x80 /* may use the free pages of CMA blocks */
 
 #ifdef CONFIG_FAIL_PAGE_ALLOC
 
@@ -1495,6 +1665,11 @@ static bool __zone_watermark_ok(struct zone *z, int order, unsigned long mark,
 	if (alloc_flags & ALLOC_HARDER)
 		min -= min / 4;
 
+#ifdef CONFIG_CMA
+	if (!(alloc_flags & ALLOC_CMA))
+		free_pages -= zone_page_state(z, NR_FREE_CMA_PAGES);
+#endif
+
 	if (free_pages <= min + z->lowmem_reserve[classzone_idx])
 		return false;
 	for (o = 0; o < order; o++) {
@@ -1917,6 +2092,7 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 	unsigned long *did_some_progress)
 {
 	struct page *page;
+	u64 start;
 
 	if (!order)
 		return NULL;
@@ -1926,10 +2102,14 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 		return NULL;
 	}
 
+	start = local_clock();
 	current->flags |= PF_MEMALLOC;
 	*did_some_progress = try_to_compact_pages(zonelist, order, gfp_mask,
 						nodemask, sync_migration);
 	current->flags &= ~PF_MEMALLOC;
+	if (*did_some_progress != COMPACT_SKIPPED)
+		count_vm_events(COMPACTSTALL_US,
+				div_u64(local_clock() - start, NSEC_PER_USEC));
 	if (*did_some_progress != COMPACT_SKIPPED) {
 
 		/* Page migration frees to the PCP lists but we want merging */
@@ -2107,6 +2287,10 @@ gfp_to_alloc_flags(gfp_t gfp_mask)
 		     unlikely(test_thread_flag(TIF_MEMDIE))))
 			alloc_flags |= ALLOC_NO_WATERMARKS;
 	}
+#ifdef CONFIG_CMA
+	if (allocflags_to_migratetype(gfp_mask) == MIGRATE_MOVABLE)
+		alloc_flags |= ALLOC_CMA;
+#endif
 
 	return alloc_flags;
 }
@@ -2152,6 +2336,9 @@ restart:
 		wake_all_kswapd(order, zonelist, high_zoneidx,
 						zone_idx(preferred_zone));
 
+	if (order)
+		wakeup_kcompactd();
+
 	/*
 	 * OK, we're below the kswapd watermark and have kicked background
 	 * reclaim. Now things get more complex, so set up alloc_flags according
@@ -2319,6 +2506,7 @@ __alloc_pages_nodemask(gfp_t gfp_mask, unsigned int order,
 	struct page *page = NULL;
 	int migratetype = allocflags_to_migratetype(gfp_mask);
 	unsigned int cpuset_mems_cookie;
+	int alloc_flags = ALLOC_WMARK_LOW|ALLOC_CPUSET;
 
 	gfp_mask &= gfp_allowed_mask;
 
@@ -2347,9 +2535,14 @@ retry_cpuset:
 	if (!preferred_zone)
 		goto out;
 
+#ifdef CONFIG_CMA
+	if (migratetype == MIGRATE_MOVABLE)
+		alloc_flags |= ALLOC_CMA;
+#endif
+
 	/* First allocation attempt */
 	page = get_page_from_freelist(gfp_mask|__GFP_HARDWALL, nodemask, order,
-			zonelist, high_zoneidx, ALLOC_WMARK_LOW|ALLOC_CPUSET,
+			zonelist, high_zoneidx, alloc_flags,
 			preferred_zone, migratetype);
 	if (unlikely(!page))
 		page = __alloc_pages_slowpath(gfp_mask, order,
@@ -3649,7 +3842,7 @@ static int zone_batchsize(struct zone *zone)
 static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 {
 	struct per_cpu_pages *pcp;
-	int migratetype;
+	int migratetype, order;
 
 	memset(p, 0, sizeof(*p));
 
@@ -3659,6 +3852,8 @@ static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 	pcp->batch = max(1UL, 1 * batch);
 	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
 		INIT_LIST_HEAD(&pcp->lists[migratetype]);
+	for (order = 0; order < PCP_HIGH_ORDERS; order++)
+		INIT_LIST_HEAD(&pcp->high_lists[order]);
 }
 
 /*
@@ -3766,6 +3961,7 @@ static int __zone_pcp_update(void *data)
 
 		local_irq_save(flags);
 		free_pcppages_bulk(zone, pcp->count, pcp);
+		pcp_high_order_drain(zone, pcp);
 		setup_pageset(pset, batch);
 		local_irq_restore(flags);
 	}
@@ -5597,7 +5793,8 @@ __count_immobile_pages(struct zone *zone, struct page *page, int count)
 	if (zone_idx(zone) == ZONE_MOVABLE)
 		return true;
 
-	if (get_pageblock_migratetype(page) == MIGRATE_MOVABLE)
+	if (get_pageblock_migratetype(page) == MIGRATE_MOVABLE ||
+	    is_migrate_cma(get_pageblock_migratetype(page)))
 		return true;
 
 	pfn = page_to_pfn(page);
@@ -5697,8 +5894,12 @@ int set_migratetype_isolate(struct page *page)
 
 out:
 	if (!ret) {
+		int migratetype = get_pageblock_migratetype(page);
+		int nr_pages;
+
 		set_pageblock_migratetype(page, MIGRATE_ISOLATE);
-		move_freepages_block(zone, page, MIGRATE_ISOLATE);
+		nr_pages = move_freepages_block(zone, page, MIGRATE_ISOLATE);
+		__mod_zone_cma_pages(zone, -nr_pages, migratetype);
 	}
 
 	spin_unlock_irqrestore(&zone->lock, flags);
@@ -5707,20 +5908,189 @@ out:
 	return ret;
 }
 
-void unset_migratetype_isolate(struct page *page)
+void unset_migratetype_isolate(struct page *page, int migratetype)
 {
 	struct zone *zone;
 	unsigned long flags;
+	int nr_pages;
 	zone = page_zone(page);
 	spin_lock_irqsave(&zone->lock, flags);
 	if (get_pageblock_migratetype(page) != MIGRATE_ISOLATE)
 		goto out;
-	set_pageblock_migratetype(page, MIGRATE_MOVABLE);
-	move_freepages_block(zone, page, MIGRATE_MOVABLE);
+	set_pageblock_migratetype(page, migratetype);
+	nr_pages = move_freepages_block(zone, page, migratetype);
+	__mod_zone_cma_pages(zone, nr_pages, migratetype);
 out:
 	spin_unlock_irqrestore(&zone->lock, flags);
 }
 
+#ifdef CONFIG_CMA
+/* Attempts over a range before alloc_contig_range() gives up */
+#define CONTIG_PASSES	3
+
+static struct page *alloc_contig_target(struct page *page,
+					unsigned long private, int **resultp)
+{
+	return alloc_page(GFP_HIGHUSER_MOVABLE);
+}
+
+/*
+ * Takes up to a cluster of the LRU pages from pfn on, returning the pfn
+ * to continue from. Free pages are stepped over: the range is isolated,
+ * so nothing allocates them again.
+ */
+static unsigned long isolate_contig_lru_pages(unsigned long pfn,
+		unsigned long end_pfn, struct list_head *pages)
+{
+	int nr = 0;
+
+	for (; pfn < end_pfn && nr < SWAP_CLUSTER_MAX; pfn++) {
+		struct page *page;
+		int ret;
+
+		if (!pfn_valid_within(pfn))
+			continue;
+
+		page = pfn_to_page(pfn);
+		if (PageBuddy(page)) {
+			/* read unlocked, so only trusted when it makes sense */
+			unsigned long order = page_order(page);
+
+			if (order < MAX_ORDER)
+				pfn += (1UL << order) - 1;
+			continue;
+		}
+
+		/* the page may be on its way to being freed */
+		if (!PageLRU(page) || !get_page_unless_zero(page))
+			continue;
+		ret = isolate_lru_page(page);
+		put_page(page);
+		if (ret)
+			continue;
+
+		list_add(&page->lru, pages);
+		inc_zone_page_state(page, NR_ISOLATED_ANON +
+				    page_is_file_cache(page));
+		nr++;
+	}
+
+	return pfn;
+}
+
+static int alloc_contig_migrate_range(unsigned long start_pfn,
+				      unsigned long end_pfn)
+{
+	unsigned long pfn = start_pfn;
+	LIST_HEAD(pages);
+
+	migrate_prep();
+
+	while (pfn < end_pfn) {
+		if (fatal_signal_pending(current))
+			return -EINTR;
+
+		pfn = isolate_contig_lru_pages(pfn, end_pfn, &pages);
+		if (list_empty(&pages))
+			continue;
+
+		/* pages left over are retried by the next pass */
+		if (migrate_pages(&pages, alloc_contig_target, 0, false,
+				  MIGRATE_SYNC))
+			putback_lru_pages(&pages);
+	}
+
+	return 0;
+}
+
+/*
+ * alloc_contig_range() -- take the pages of [start_pfn, end_pfn) out of
+ * the allocator, migrating what occupies them. The range must be aligned
+ * to MAX_ORDER_NR_PAGES, lie in one zone and be made of MIGRATE_CMA
+ * pageblocks. Returns 0 with every page of the range allocated, to be
+ * given back with free_contig_range().
+ */
+int alloc_contig_range(unsigned long start_pfn, unsigned long end_pfn)
+{
+	struct zone *zone = page_zone(pfn_to_page(start_pfn));
+	unsigned long flags, pfn;
+	int pass, ret;
+
+	ret = start_isolate_page_range(start_pfn, end_pfn, MIGRATE_CMA);
+	if (ret)
+		return ret;
+
+	for (pass = 0; pass < CONTIG_PASSES; pass++) {
+		ret = alloc_contig_migrate_range(start_pfn, end_pfn);
+		if (ret)
+			goto out;
+
+		/* the old pages may still sit on the per-cpu lists */
+		lru_add_drain_all();
+		drain_all_pages();
+
+		ret = test_pages_isolated(start_pfn, end_pfn);
+		if (!ret)
+			break;
+	}
+	if (ret)
+		goto out;
+
+	spin_lock_irqsave(&zone->lock, flags);
+	for (pfn = start_pfn; pfn < end_pfn;) {
+		struct page *page = pfn_to_page(pfn);
+		unsigned int order;
+
+		if (!PageBuddy(page))
+			break;
+		order = page_order(page);
+		if (pfn + (1UL << order) > end_pfn)
+			break;
+
+		list_del(&page->lru);
+		rmv_page_order(page);
+		zone->free_area[order].nr_free--;
+		__mod_zone_page_state(zone, NR_FREE_PAGES, -(1UL << order));
+
+		set_page_refcounted(page);
+		split_page(page, order);
+		pfn += 1UL << order;
+	}
+	spin_unlock_irqrestore(&zone->lock, flags);
+
+	if (pfn < end_pfn) {
+		free_contig_range(start_pfn, pfn - start_pfn);
+		ret = -EBUSY;
+	}
+out:
+	undo_isolate_page_range(start_pfn, end_pfn, MIGRATE_CMA);
+	return ret;
+}
+
+void free_contig_range(unsigned long pfn, unsigned long nr_pages)
+{
+	for (; nr_pages--; pfn++)
+		__free_page(pfn_to_page(pfn));
+}
+
+/* Hands a pageblock kept back from bootmem to the allocator as CMA */
+void __init init_cma_reserved_pageblock(struct page *page)
+{
+	unsigned int i = pageblock_nr_pages;
+	struct page *p = page;
+
+	do {
+		__ClearPageReserved(p);
+		set_page_count(p, 0);
+	} while (++p, --i);
+
+	set_page_refcounted(page);
+	set_pageblock_migratetype(page, MIGRATE_CMA);
+	__free_pages(page, pageblock_order);
+	totalram_pages += pageblock_nr_pages;
+}
+#endif
+
 #ifdef CONFIG_MEMORY_HOTREMOVE
 /*
  * All pages in the range must be isolated before calling this.
@@ -17,6 +17,9 @@
 #include <linux/task_io_accounting_ops.h>
 #include <linux/pagevec.h>
 #include <linux/pagemap.h>
+#include <linux/launch_prefetch.h>
+
+#include "internal.h"
 
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
@@ -147,10 +150,9 @@ out:
  *
  * Returns the number of pages requested, or the maximum amount of I/O allowed.
  */
-static int
-__do_page_cache_readahead(struct address_space *mapping, struct file *filp,
-			pgoff_t offset, unsigned long nr_to_read,
-			unsigned long lookahead_size)
+int do_page_cache_readahead_pages(struct address_space *mapping,
+			struct file *filp, pgoff_t offset,
+			unsigned long nr_to_read, unsigned long lookahead_size)
 {
 	struct inode *inode = mapping->host;
 	struct page *page;
@@ -202,6 +204,23 @@ out:
 	return ret;
 }
 
+static int
+__do_page_cache_readahead(struct address_space *mapping, struct file *filp,
+			pgoff_t offset, unsigned long nr_to_read,
+			unsigned long lookahead_size)
+{
+	int ret;
+
+	launch_prefetch_replay(mapping, filp);
+
+	ret = do_page_cache_readahead_pages(mapping, filp, offset, nr_to_read,
+					    lookahead_size);
+	if (ret > 0)
+		launch_prefetch_record(mapping, offset, nr_to_read);
+
+	return ret;
+}
+
 /*
  * Chunk the readahead into 2 megabyte units, so that we don't pin too much
  * memory at once.
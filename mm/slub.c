@@ -217,10 +217,19 @@ static inline void sysfs_slab_remove(struct kmem_cache *s)
 
 #endif
 
+/* The events counted by CONFIG_SLUB_LITE_STATS */
+#define SLUB_LITE_STATS_MASK	((1 << ALLOC_FASTPATH) | (1 << ALLOC_SLOWPATH) | \
+				 (1 << FREE_FASTPATH) | (1 << FREE_SLOWPATH) | \
+				 (1 << ALLOC_FROM_PARTIAL) | (1 << ALLOC_SLAB) | \
+				 (1 << FREE_SLAB))
+
 static inline void stat(const struct kmem_cache *s, enum stat_item si)
 {
 #ifdef CONFIG_SLUB_STATS
 	__this_cpu_inc(s->cpu_slab->stat[si]);
+#elif defined(CONFIG_SLUB_LITE_STATS)
+	if ((1 << si) & SLUB_LITE_STATS_MASK)
+		__this_cpu_inc(s->cpu_slab->stat[si]);
 #endif
 }
 
@@ -4195,6 +4204,55 @@ static ssize_t objects_partial_show(struct kmem_cache *s, char *buf)
 }
 SLAB_ATTR_RO(objects_partial);
 
+/* Objects in use and free on the partial slabs of all nodes */
+static void partial_objects(struct kmem_cache *s, unsigned long *inuse,
+			    unsigned long *free)
+{
+	int node;
+
+	*inuse = 0;
+	*free = 0;
+	for_each_node_state(node, N_NORMAL_MEMORY) {
+		struct kmem_cache_node *n = get_node(s, node);
+		unsigned long flags;
+		struct page *page;
+
+		if (!n)
+			continue;
+
+		spin_lock_irqsave(&n->list_lock, flags);
+		list_for_each_entry(page, &n->partial, lru) {
+			*inuse += page->inuse;
+			*free += page->objects - page->inuse;
+		}
+		spin_unlock_irqrestore(&n->list_lock, flags);
+	}
+}
+
+/* Percentage of the objects of partial slabs that are in use */
+static ssize_t partial_utilization_show(struct kmem_cache *s, char *buf)
+{
+	unsigned long inuse, free;
+
+	partial_objects(s, &inuse, &free);
+	if (!inuse && !free)
+		return sprintf(buf, "100\n");
+
+	return sprintf(buf, "%lu\n", inuse * 100 / (inuse + free));
+}
+SLAB_ATTR_RO(partial_utilization);
+
+/* Bytes held by free objects of partial slabs */
+static ssize_t partial_waste_show(struct kmem_cache *s, char *buf)
+{
+	unsigned long inuse, free;
+
+	partial_objects(s, &inuse, &free);
+
+	return sprintf(buf, "%lu\n", free * s->size);
+}
+SLAB_ATTR_RO(partial_waste);
+
 static ssize_t reclaim_account_show(struct kmem_cache *s, char *buf)
 {
 	return sprintf(buf, "%d\n", !!(s->flags & SLAB_RECLAIM_ACCOUNT));
@@ -4432,7 +4490,7 @@ static ssize_t remote_node_defrag_ratio_store(struct kmem_cache *s,
 SLAB_ATTR(remote_node_defrag_ratio);
 #endif
 
-#ifdef CONFIG_SLUB_STATS
+#if defined(CONFIG_SLUB_STATS) || defined(CONFIG_SLUB_LITE_STATS)
 static int show_stat(struct kmem_cache *s, char *buf, enum stat_item si)
 {
 	unsigned long sum  = 0;
@@ -4489,13 +4547,16 @@ STAT_ATTR(ALLOC_FASTPATH, alloc_fastpath);
 STAT_ATTR(ALLOC_SLOWPATH, alloc_slowpath);
 STAT_ATTR(FREE_FASTPATH, free_fastpath);
 STAT_ATTR(FREE_SLOWPATH, free_slowpath);
+STAT_ATTR(ALLOC_FROM_PARTIAL, alloc_from_partial);
+STAT_ATTR(ALLOC_SLAB, alloc_slab);
+STAT_ATTR(FREE_SLAB, free_slab);
+#endif
+
+#ifdef CONFIG_SLUB_STATS
 STAT_ATTR(FREE_FROZEN, free_frozen);
 STAT_ATTR(FREE_ADD_PARTIAL, free_add_partial);
 STAT_ATTR(FREE_REMOVE_PARTIAL, free_remove_partial);
-STAT_ATTR(ALLOC_FROM_PARTIAL, alloc_from_partial);
-STAT_ATTR(ALLOC_SLAB, alloc_slab);
 STAT_ATTR(ALLOC_REFILL, alloc_refill);
-STAT_ATTR(FREE_SLAB, free_slab);
 STAT_ATTR(CPUSLAB_FLUSH, cpuslab_flush);
 STAT_ATTR(DEACTIVATE_FULL, deactivate_full);
 STAT_ATTR(DEACTIVATE_EMPTY, deactivate_empty);
@@ -4514,6 +4575,8 @@ static struct attribute *slab_attrs[] = {
 	&objects_attr.attr,
 	&objects_partial_attr.attr,
 	&partial_attr.attr,
+	&partial_utilization_attr.attr,
+	&partial_waste_attr.attr,
 	&cpu_slabs_attr.attr,
 	&ctor_attr.attr,
 	&aliases_attr.attr,
@@ -4541,18 +4604,20 @@ static struct attribute *slab_attrs[] = {
 #ifdef CONFIG_NUMA
 	&remote_node_defrag_ratio_attr.attr,
 #endif
-#ifdef CONFIG_SLUB_STATS
+#if defined(CONFIG_SLUB_STATS) || defined(CONFIG_SLUB_LITE_STATS)
 	&alloc_fastpath_attr.attr,
 	&alloc_slowpath_attr.attr,
 	&free_fastpath_attr.attr,
 	&free_slowpath_attr.attr,
+	&alloc_from_partial_attr.attr,
+	&alloc_slab_attr.attr,
+	&free_slab_attr.attr,
+#endif
+#ifdef CONFIG_SLUB_STATS
 	&free_frozen_attr.attr,
 	&free_add_partial_attr.attr,
 	&free_remove_partial_attr.attr,
-	&alloc_from_partial_attr.attr,
-	&alloc_slab_attr.attr,
 	&alloc_refill_attr.attr,
-	&free_slab_attr.attr,
 	&cpuslab_flush_attr.attr,
 	&deactivate_full_attr.attr,
 	&deactivate_empty_attr.attr,
@@ -260,14 +260,62 @@ void free_pages_and_swap_cache(struct page **pages, int nr)
  * lock getting page table operations atomic even if we drop the page
  * lock before returning.
  */
+/*
+ * Swap readahead is sized by how much of the readahead before it was used.
+ * Pages read ahead are marked PG_readahead, and a fault finding one in the
+ * swap cache counts a hit. With zram every page read ahead costs a
+ * decompression, so once readahead goes unused the window falls to the
+ * faulting page alone, and only grows back on hits or on faults at
+ * neighbouring slots.
+ */
+static atomic_t swapin_readahead_hits = ATOMIC_INIT(4);
+
+/* Order of the window to read around a fault at offset */
+static int swapin_readahead_order(unsigned long offset)
+{
+	static unsigned long prev_offset;
+	static atomic_t last_readahead_pages;
+	int max_pages = 1 << ACCESS_ONCE(page_cluster);
+	int pages, last_ra;
+
+	if (max_pages <= 1)
+		return 0;
+
+	pages = atomic_xchg(&swapin_readahead_hits, 0) + 2;
+	if (pages == 2) {
+		/* No hits to go by: read ahead only for adjacent faults */
+		if (offset != prev_offset + 1 && offset != prev_offset - 1)
+			pages = 1;
+		prev_offset = offset;
+	} else {
+		pages = roundup_pow_of_two(pages);
+	}
+
+	if (pages > max_pages)
+		pages = max_pages;
+
+	/* Don't shrink the window too fast */
+	last_ra = atomic_read(&last_readahead_pages) / 2;
+	if (pages < last_ra)
+		pages = last_ra;
+	atomic_set(&last_readahead_pages, pages);
+
+	return ilog2(pages);
+}
+
 struct page * lookup_swap_cache(swp_entry_t entry)
 {
 	struct page *page;
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		if (TestClearPageReadahead(page)) {
+			atomic_inc(&swapin_readahead_hits);
+			count_vm_event(SWAP_RA_HIT);
+		}
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
@@ -317,6 +365,13 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 		err = swapcache_prepare(entry);
 		if (err == -EEXIST) {
 			radix_tree_preload_end();
+			/*
+			 * A slot waiting in the swap slots caches has no page
+			 * coming and nothing mapping it: only readahead would
+			 * get here for it. Swapoff (no vma) drained them.
+			 */
+			if (vma && !__swap_count(entry))
+				break;
 			/*
 			 * We might race against get_swap_page() and stumble
 			 * across a SWAP_HAS_CACHE swap_map entry whose page
@@ -402,13 +457,18 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	 * more likely that neighbouring swap pages came from the same node:
 	 * so use the same "addr" to choose the same node for each swap read.
 	 */
-	nr_pages = valid_swaphandles(entry, &offset);
+	nr_pages = valid_swaphandles(entry, &offset,
+			swapin_readahead_order(swp_offset(entry)));
 	for (end_offset = offset + nr_pages; offset < end_offset; offset++) {
 		/* Ok, do the async read-ahead now */
 		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
 						gfp_mask, vma, addr);
 		if (!page)
 			break;
+		if (offset != swp_offset(entry)) {
+			SetPageReadahead(page);
+			count_vm_event(SWAP_RA);
+		}
 		page_cache_release(page);
 	}
 	lru_add_drain();	/* Push any new pages onto the LRU now */
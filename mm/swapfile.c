@@ -32,6 +32,8 @@
 #include <linux/memcontrol.h>
 #include <linux/poll.h>
 #include <linux/oom.h>
+#include <linux/frontswap.h>
+#include <linux/swapfile.h>
 
 #include <asm/pgtable.h>
 #include <asm/tlbflush.h>
@@ -43,7 +45,7 @@ static bool swap_count_continued(struct swap_info_struct *, pgoff_t,
 static void free_swap_count_continuations(struct swap_info_struct *);
 static sector_t map_swap_entry(swp_entry_t, struct block_device**);
 
-static DEFINE_SPINLOCK(swap_lock);
+DEFINE_SPINLOCK(swap_lock);
 static unsigned int nr_swapfiles;
 long nr_swap_pages;
 long total_swap_pages;
@@ -54,9 +56,9 @@ static const char Unused_file[] = "Unused swap file entry ";
 static const char Bad_offset[] = "Bad swap offset entry ";
 static const char Unused_offset[] = "Unused swap offset entry ";
 
-static struct swap_list_t swap_list = {-1, -1};
+struct swap_list_t swap_list = {-1, -1};
 
-static struct swap_info_struct *swap_info[MAX_SWAPFILES];
+struct swap_info_struct *swap_info[MAX_SWAPFILES];
 
 static DEFINE_MUTEX(swapon_mutex);
 
@@ -208,6 +210,15 @@ static unsigned long scan_swap_map(struct swap_info_struct *si,
 			si->cluster_nr = SWAPFILE_CLUSTER - 1;
 			goto checks;
 		}
+		/*
+		 * Without seeks to save or discards to issue, an empty
+		 * cluster buys nothing: take the next free slot.
+		 */
+		if ((si->flags & (SWP_SOLIDSTATE | SWP_DISCARDABLE)) ==
+		    SWP_SOLIDSTATE) {
+			si->cluster_nr = SWAPFILE_CLUSTER - 1;
+			goto checks;
+		}
 		if (si->flags & SWP_DISCARDABLE) {
 			/*
 			 * Start range check on racing allocations, in case
@@ -409,17 +420,20 @@ no_page:
 	return 0;
 }
 
-swp_entry_t get_swap_page(void)
+/* Allocate up to n slots for the swap cache into slots, returns how many */
+static int get_swap_pages(int n, swp_entry_t *slots)
 {
 	struct swap_info_struct *si;
 	pgoff_t offset;
 	int type, next;
 	int wrapped = 0;
+	int nr = 0;
 
 	spin_lock(&swap_lock);
 	if (nr_swap_pages <= 0)
 		goto noswap;
-	nr_swap_pages--;
+	n = min_t(long, n, nr_swap_pages);
+	nr_swap_pages -= n;
 
 	for (type = swap_list.next; type >= 0 && wrapped < 2; type = next) {
 		si = swap_info[type];
@@ -437,20 +451,160 @@ swp_entry_t get_swap_page(void)
 
 		swap_list.next = next;
 		/* This is called for allocating swap entry for cache */
-		offset = scan_swap_map(si, SWAP_HAS_CACHE);
-		if (offset) {
-			spin_unlock(&swap_lock);
-			return swp_entry(type, offset);
+		while (nr < n) {
+			offset = scan_swap_map(si, SWAP_HAS_CACHE);
+			if (!offset)
+				break;
+			slots[nr++] = swp_entry(type, offset);
 		}
+		if (nr == n)
+			break;
 		next = swap_list.next;
 	}
 
-	nr_swap_pages++;
+	nr_swap_pages += n - nr;
 noswap:
 	spin_unlock(&swap_lock);
-	return (swp_entry_t) {0};
+	return nr;
+}
+
+/*
+ * Swap slots are handed out from small per-cpu caches, filled
+ * SWAP_SLOTS_BATCH at a time, and slots the swap cache held the last
+ * reference to are freed in batches: with zram as the only swap device,
+ * swap_lock would otherwise be taken twice for every page swapped out.
+ *
+ * A slot in either cache is SWAP_HAS_CACHE with no page in the swap cache,
+ * as a slot is between get_swap_page() and add_to_swap_cache(). Nothing
+ * maps it, so swap readahead passes it by; swapoff stops its device from
+ * taking part and drains the caches before looking for the slots in use.
+ */
+#define SWAP_SLOTS_BATCH	64
+
+struct swap_slots_cache {
+	spinlock_t	lock;
+	int		nr;		/* slots to hand out */
+	int		nr_free;	/* slots to free */
+	swp_entry_t	slots[SWAP_SLOTS_BATCH];
+	swp_entry_t	slots_free[SWAP_SLOTS_BATCH];
+};
+
+static DEFINE_PER_CPU(struct swap_slots_cache, swap_slots);
+
+/* Serializes filling the caches with draining them for swapoff */
+static DEFINE_MUTEX(swap_slots_mutex);
+
+static unsigned char swap_entry_free(struct swap_info_struct *p,
+				     swp_entry_t entry, unsigned char usage);
+
+static void swap_slots_free(swp_entry_t *slots, int n)
+{
+	int i;
+
+	if (!n)
+		return;
+
+	spin_lock(&swap_lock);
+	for (i = 0; i < n; i++)
+		swap_entry_free(swap_info[swp_type(slots[i])], slots[i],
+				SWAP_HAS_CACHE);
+	spin_unlock(&swap_lock);
 }
 
+static void swap_slots_drain(void)
+{
+	int cpu;
+
+	mutex_lock(&swap_slots_mutex);
+	for_each_possible_cpu(cpu) {
+		struct swap_slots_cache *cache = &per_cpu(swap_slots, cpu);
+
+		spin_lock(&cache->lock);
+		swap_slots_free(cache->slots, cache->nr);
+		swap_slots_free(cache->slots_free, cache->nr_free);
+		cache->nr = 0;
+		cache->nr_free = 0;
+		spin_unlock(&cache->lock);
+	}
+	mutex_unlock(&swap_slots_mutex);
+}
+
+/* Queue entry for freeing if the swap cache holds its only reference */
+static bool swap_slots_free_cached(swp_entry_t entry, struct page *page)
+{
+	struct swap_info_struct *p = swap_info[swp_type(entry)];
+	struct swap_slots_cache *cache;
+	bool queued = false;
+
+	if (p->swap_map[swp_offset(entry)] != SWAP_HAS_CACHE)
+		return false;
+
+	cache = &get_cpu_var(swap_slots);
+	spin_lock(&cache->lock);
+	if (p->flags & SWP_WRITEOK) {
+		cache->slots_free[cache->nr_free++] = entry;
+		if (cache->nr_free == SWAP_SLOTS_BATCH) {
+			swap_slots_free(cache->slots_free, cache->nr_free);
+			cache->nr_free = 0;
+		}
+		queued = true;
+	}
+	spin_unlock(&cache->lock);
+	put_cpu_var(swap_slots);
+
+	if (queued && page)
+		mem_cgroup_uncharge_swapcache(page, entry, false);
+
+	return queued;
+}
+
+swp_entry_t get_swap_page(void)
+{
+	struct swap_slots_cache *cache;
+	swp_entry_t slots[SWAP_SLOTS_BATCH];
+	swp_entry_t entry = { 0 };
+	int n;
+
+	cache = &get_cpu_var(swap_slots);
+	spin_lock(&cache->lock);
+	if (cache->nr)
+		entry = cache->slots[--cache->nr];
+	spin_unlock(&cache->lock);
+	put_cpu_var(swap_slots);
+
+	if (entry.val)
+		return entry;
+
+	mutex_lock(&swap_slots_mutex);
+	n = get_swap_pages(SWAP_SLOTS_BATCH, slots);
+	if (n) {
+		entry = slots[--n];
+
+		cache = &get_cpu_var(swap_slots);
+		spin_lock(&cache->lock);
+		while (n && cache->nr < SWAP_SLOTS_BATCH)
+			cache->slots[cache->nr++] = slots[--n];
+		spin_unlock(&cache->lock);
+		put_cpu_var(swap_slots);
+
+		swap_slots_free(slots, n);
+	}
+	mutex_unlock(&swap_slots_mutex);
+
+	return entry;
+}
+
+static int __init swap_slots_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu(swap_slots, cpu).lock);
+
+	return 0;
+}
+core_initcall(swap_slots_init);
+
 /* The only caller of this function is now susupend routine */
 swp_entry_t get_swap_page_of_type(int type)
 {
@@ -557,6 +711,7 @@ static unsigned char swap_entry_free(struct swap_info_struct *p,
 			swap_list.next = p->type;
 		nr_swap_pages++;
 		p->inuse_pages--;
+		frontswap_flush_page(p->type, offset);
 		if ((p->flags & SWP_BLKDEV) &&
 				disk->fops->swap_slot_free_notify)
 			disk->fops->swap_slot_free_notify(p->bdev, offset);
@@ -588,6 +743,9 @@ void swapcache_free(swp_entry_t entry, struct page *page)
 	struct swap_info_struct *p;
 	unsigned char count;
 
+	if (swap_slots_free_cached(entry, page))
+		return;
+
 	p = swap_info_get(entry);
 	if (p) {
 		count = swap_entry_free(p, entry, SWAP_HAS_CACHE);
@@ -597,6 +755,14 @@ void swapcache_free(swp_entry_t entry, struct page *page)
 	}
 }
 
+/* References to entry besides the swap cache, read without swap_lock */
+int __swap_count(swp_entry_t entry)
+{
+	struct swap_info_struct *p = swap_info[swp_type(entry)];
+
+	return swap_count(p->swap_map[swp_offset(entry)]);
+}
+
 /*
  * How many references to page are currently swapped out?
  * This does not give an exact answer when swap count is continued,
@@ -1516,7 +1682,8 @@ bad_bmap:
 }
 
 static void enable_swap_info(struct swap_info_struct *p, int prio,
-				unsigned char *swap_map)
+				unsigned char *swap_map,
+				unsigned long *frontswap_map)
 {
 	int i, prev;
 
@@ -1526,6 +1693,7 @@ static void enable_swap_info(struct swap_info_struct *p, int prio,
 	else
 		p->prio = --least_priority;
 	p->swap_map = swap_map;
+	frontswap_map_set(p, frontswap_map);
 	p->flags |= SWP_WRITEOK;
 	nr_swap_pages += p->pages;
 	total_swap_pages += p->pages;
@@ -1543,12 +1711,16 @@ static void enable_swap_info(struct swap_info_struct *p, int prio,
 	else
 		swap_info[prev]->next = p->type;
 	spin_unlock(&swap_lock);
+
+	/* the backend may allocate: not under swap_lock */
+	frontswap_init(p->type);
 }
 
 SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 {
 	struct swap_info_struct *p = NULL;
 	unsigned char *swap_map;
+	unsigned long *frontswap_map;
 	struct file *swap_file, *victim;
 	struct address_space *mapping;
 	struct inode *inode;
@@ -1612,6 +1784,8 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 	p->flags &= ~SWP_WRITEOK;
 	spin_unlock(&swap_lock);
 
+	swap_slots_drain();
+
 	oom_score_adj = test_set_oom_score_adj(OOM_SCORE_ADJ_MAX);
 	err = try_to_unuse(type);
 	test_set_oom_score_adj(oom_score_adj);
@@ -1624,13 +1798,15 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 		 * sys_swapoff for this swap_info_struct at this point.
 		 */
 		/* re-insert swap space back into swap_list */
-		enable_swap_info(p, p->prio, p->swap_map);
+		enable_swap_info(p, p->prio, p->swap_map,
+				 frontswap_map_get(p));
 		goto out_dput;
 	}
 
 	destroy_swap_extents(p);
 	if (p->flags & SWP_CONTINUED)
 		free_swap_count_continuations(p);
+	frontswap_flush_area(type);
 
 	mutex_lock(&swapon_mutex);
 	spin_lock(&swap_lock);
@@ -1650,9 +1826,12 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 	swap_map = p->swap_map;
 	p->swap_map = NULL;
 	p->flags = 0;
+	frontswap_map = frontswap_map_get(p);
+	frontswap_map_set(p, NULL);
 	spin_unlock(&swap_lock);
 	mutex_unlock(&swapon_mutex);
 	vfree(swap_map);
+	vfree(frontswap_map);
 	/* Destroy swap account informatin */
 	swap_cgroup_swapoff(type);
 
@@ -2026,6 +2205,7 @@ int swapon(char *name, int swap_flags)
 	sector_t span;
 	unsigned long maxpages;
 	unsigned char *swap_map = NULL;
+	unsigned long *frontswap_map = NULL;
 	struct page *page = NULL;
 	struct inode *inode = NULL;
 
@@ -2088,6 +2268,13 @@ int swapon(char *name, int swap_flags)
 		error = -ENOMEM;
 		goto bad_swap;
 	}
+#ifdef CONFIG_FRONTSWAP
+	frontswap_map = vzalloc(BITS_TO_LONGS(maxpages) * sizeof(long));
+	if (!frontswap_map) {
+		error = -ENOMEM;
+		goto bad_swap;
+	}
+#endif
 
 	error = swap_cgroup_swapon(p->type, maxpages);
 	if (error)
@@ -2114,7 +2301,7 @@ int swapon(char *name, int swap_flags)
 	if (swap_flags & SWAP_FLAG_PREFER)
 		prio =
 		    (swap_flags & SWAP_FLAG_PRIO_MASK) >> SWAP_FLAG_PRIO_SHIFT;
-	enable_swap_info(p, prio, swap_map);
+	enable_swap_info(p, prio, swap_map, frontswap_map);
 
 	printk(KERN_INFO "Adding %uk swap on %s.  "
 	       "Priority:%d extents:%d across:%lluk %s%s\n",
@@ -2143,6 +2330,7 @@ int swapon(char *name, int swap_flags)
 	p->flags = 0;
 	spin_unlock(&swap_lock);
 	vfree(swap_map);
+	vfree(frontswap_map);
 	if (swap_file) {
 		if (inode && S_ISREG(inode->i_mode)) {
 			mutex_unlock(&inode->i_mutex);
@@ -2178,6 +2366,7 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 	sector_t span;
 	unsigned long maxpages;
 	unsigned char *swap_map = NULL;
+	unsigned long *frontswap_map = NULL;
 	struct page *page = NULL;
 	struct inode *inode = NULL;
 
@@ -2247,6 +2436,13 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 		error = -ENOMEM;
 		goto bad_swap;
 	}
+#ifdef CONFIG_FRONTSWAP
+	frontswap_map = vzalloc(BITS_TO_LONGS(maxpages) * sizeof(long));
+	if (!frontswap_map) {
+		error = -ENOMEM;
+		goto bad_swap;
+	}
+#endif
 
 	error = swap_cgroup_swapon(p->type, maxpages);
 	if (error)
@@ -2273,7 +2469,7 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 	if (swap_flags & SWAP_FLAG_PREFER)
 		prio =
 		  (swap_flags & SWAP_FLAG_PRIO_MASK) >> SWAP_FLAG_PRIO_SHIFT;
-	enable_swap_info(p, prio, swap_map);
+	enable_swap_info(p, prio, swap_map, frontswap_map);
 
 	printk(KERN_INFO "Adding %uk swap on %s.  "
 			"Priority:%d extents:%d across:%lluk %s%s\n",
@@ -2302,6 +2498,7 @@ bad_swap:
 	p->flags = 0;
 	spin_unlock(&swap_lock);
 	vfree(swap_map);
+	vfree(frontswap_map);
 	if (swap_file) {
 		if (inode && S_ISREG(inode->i_mode)) {
 			mutex_unlock(&inode->i_mutex);
@@ -2452,10 +2649,10 @@ int swapcache_prepare(swp_entry_t entry)
  * swap_lock prevents swap_map being freed. Don't grab an extra
  * reference on the swaphandle, it doesn't matter if it becomes unused.
  */
-int valid_swaphandles(swp_entry_t entry, unsigned long *offset)
+int valid_swaphandles(swp_entry_t entry, unsigned long *offset,
+		      int our_page_cluster)
 {
 	struct swap_info_struct *si;
-	int our_page_cluster = page_cluster;
 	pgoff_t target, toff;
 	pgoff_t base, end;
 	int nr_pages = 0;
@@ -69,6 +69,11 @@
 #include <linux/gcd.h>
 #include <linux/freezer.h>
 #include <linux/sradix-tree.h>
+#include <linux/cpufreq.h>
+#include <linux/power_supply.h>
+#ifdef CONFIG_HAS_EARLYSUSPEND
+#include <linux/earlysuspend.h>
+#endif
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -551,6 +556,17 @@ static unsigned long uksm_ema_page_time = UKSM_PAGE_TIME_DEFAULT;
  */
 static unsigned int uksm_thrash_threshold = 50;
 
+/*
+ * A slot whose merged pages keep getting COW-broken, a Dalvik heap for
+ * one, is held in the base rung for 2^strikes judged rounds, and may not
+ * climb the ladder meanwhile. Every round spent cooling off without
+ * churn forgets one strike.
+ */
+#define UKSM_COOLDOWN_MAX_STRIKES	6
+#define UKSM_COOLDOWN_MIN_COWS		8
+
+static unsigned long uksm_cooldowns;
+
 /* How much dedup ratio is considered to be abundant*/
 static unsigned int uksm_abundant_threshold = 10;
 
@@ -560,6 +576,28 @@ struct list_head vma_slot_dedup = LIST_HEAD_INIT(vma_slot_dedup);
 /* How many times the ksmd has slept since startup */
 static unsigned long long uksm_sleep_times;
 
+/*
+ * CPU time uksmd may spend scanning in each second, in msecs. With the
+ * screen on the budget shrinks as cpufreq raises the clock, to nothing
+ * at the top frequency, so foreground use is left alone. With the screen
+ * off it is the suspend budget, or the charging one on external power.
+ */
+static unsigned int uksm_budget_awake_ms = 10;
+static unsigned int uksm_budget_suspend_ms = 50;
+static unsigned int uksm_budget_charging_ms = 250;
+
+static bool uksm_screen_off;
+
+/* The current one second budget window */
+static unsigned long uksm_budget_start;
+static unsigned long long uksm_budget_used;
+static unsigned int uksm_budget_ns;
+
+/* Budget accounting since startup */
+static unsigned long long uksm_scan_cpu_ns;
+static unsigned long uksm_pages_merged;
+static unsigned long long uksm_budget_throttled;
+
 #define UKSM_RUN_STOP	0
 #define UKSM_RUN_MERGE	1
 static unsigned int uksm_run = 0;
@@ -2508,6 +2546,7 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 		goto node_vma_new;
 	} else {
 		uksm_pages_sharing++;
+		uksm_pages_merged++;
 	}
 
 	hlist_for_each_entry(node_vma, hlist, &stable_node->hlist, hlist) {
@@ -4045,7 +4084,7 @@ static noinline void round_update_ladder(void)
 	list_for_each_entry_safe(slot, tmp_slot, &vma_slot_dedup, dedup_list) {
 
 		/* slot may be rung_rm_slot() when mm exits */
-		if (slot->snode) {
+		if (slot->snode && !slot->cooldown) {
 			dedup = cal_dedup_ratio_old(slot);
 			if (dedup && dedup >= uksm_abundant_threshold)
 				vma_rung_up(slot);
@@ -4348,6 +4387,30 @@ static inline int rung_round_finished(struct scan_rung *rung)
 	return rung->flags & UKSM_RUNG_ROUND_FINISHED;
 }
 
+static inline int slot_churning(struct vma_slot *slot)
+{
+	if (!uksm_thrash_threshold ||
+	    slot->pages_cowed < UKSM_COOLDOWN_MIN_COWS)
+		return 0;
+
+	return slot->pages_cowed * 100 >
+		slot->pages_merged * uksm_thrash_threshold;
+}
+
+static inline void slot_update_cooldown(struct vma_slot *slot)
+{
+	if (slot_churning(slot)) {
+		if (slot->cow_strikes < UKSM_COOLDOWN_MAX_STRIKES)
+			slot->cow_strikes++;
+		slot->cooldown = 1U << slot->cow_strikes;
+		uksm_cooldowns++;
+	} else if (slot->cooldown) {
+		slot->cooldown--;
+	} else if (slot->cow_strikes) {
+		slot->cow_strikes--;
+	}
+}
+
 static inline void judge_slot(struct vma_slot *slot)
 {
 	struct scan_rung *rung = slot->rung;
@@ -4355,7 +4418,10 @@ static inline void judge_slot(struct vma_slot *slot)
 	int deleted;
 
 	dedup = cal_dedup_ratio(slot);
-	if (vma_fully_scanned(slot) && uksm_thrash_threshold)
+	slot_update_cooldown(slot);
+	if (slot->cooldown)
+		deleted = vma_rung_enter(slot, &uksm_scan_ladder[0]);
+	else if (vma_fully_scanned(slot) && uksm_thrash_threshold)
 		deleted = vma_rung_enter(slot, &uksm_scan_ladder[0]);
 	else if (dedup && dedup >= uksm_abundant_threshold)
 		deleted = vma_rung_up(slot);
@@ -4584,6 +4650,10 @@ rm_slot:
 	uksm_sleep_real = uksm_sleep_jiffies;
 	/* in case of radical cpu bursts, apply the upper bound */
 	end_time = task_sched_runtime(current);
+	if (end_time > start_time) {
+		uksm_scan_cpu_ns += end_time - start_time;
+		uksm_budget_used += end_time - start_time;
+	}
 	if (max_cpu_ratio && end_time > start_time) {
 		scan_time = end_time - start_time;
 		expected_jiffies = msecs_to_jiffies(
@@ -4605,6 +4675,77 @@ static int ksmd_should_run(void)
 	return uksm_run & UKSM_RUN_MERGE;
 }
 
+static unsigned int uksm_cpu_budget_ms(void)
+{
+	unsigned int budget = uksm_budget_awake_ms;
+#ifdef CONFIG_CPU_FREQ
+	struct cpufreq_policy *policy;
+	unsigned int cur;
+#endif
+
+	if (uksm_screen_off)
+		return power_supply_is_system_supplied() > 0 ?
+			uksm_budget_charging_ms : uksm_budget_suspend_ms;
+
+#ifdef CONFIG_CPU_FREQ
+	policy = cpufreq_cpu_get(0);
+	if (!policy)
+		return budget;
+
+	cur = clamp(policy->cur, policy->min, policy->max);
+	if (policy->max > policy->min)
+		budget = budget * (policy->max - cur) /
+			(policy->max - policy->min);
+	cpufreq_cpu_put(policy);
+#endif
+
+	return budget;
+}
+
+/* Whether the budget of the current window allows another scan */
+static bool uksm_budget_left(void)
+{
+	if (time_after_eq(jiffies, uksm_budget_start + HZ)) {
+		uksm_budget_start = jiffies;
+		uksm_budget_used = 0;
+		uksm_budget_ns = uksm_cpu_budget_ms() * NSEC_PER_MSEC;
+	}
+
+	return uksm_budget_used < uksm_budget_ns;
+}
+
+/* How long to sleep after a scan, or until the next window if over */
+static unsigned long uksm_budget_sleep(void)
+{
+	unsigned long end = uksm_budget_start + HZ;
+
+	if (uksm_budget_used < uksm_budget_ns || !time_before(jiffies, end))
+		return uksm_sleep_real;
+
+	uksm_budget_throttled++;
+	return max_t(unsigned long, uksm_sleep_real, end - jiffies);
+}
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void uksm_early_suspend(struct early_suspend *h)
+{
+	uksm_screen_off = true;
+	/* start a new window with the screen off budget */
+	uksm_budget_start = jiffies - HZ;
+}
+
+static void uksm_late_resume(struct early_suspend *h)
+{
+	uksm_screen_off = false;
+	uksm_budget_start = jiffies - HZ;
+}
+
+static struct early_suspend uksm_early_suspend_desc = {
+	.suspend = uksm_early_suspend,
+	.resume = uksm_late_resume,
+};
+#endif
+
 static int uksm_scan_thread(void *nothing)
 {
 	set_freezable();
@@ -4612,7 +4753,7 @@ static int uksm_scan_thread(void *nothing)
 
 	while (!kthread_should_stop()) {
 		mutex_lock(&uksm_thread_mutex);
-		if (ksmd_should_run()) {
+		if (ksmd_should_run() && uksm_budget_left()) {
 			uksm_do_scan();
 		}
 		mutex_unlock(&uksm_thread_mutex);
@@ -4620,7 +4761,7 @@ static int uksm_scan_thread(void *nothing)
 		try_to_freeze();
 
 		if (ksmd_should_run()) {
-			schedule_timeout_interruptible(uksm_sleep_real);
+			schedule_timeout_interruptible(uksm_budget_sleep());
 			uksm_sleep_times++;
 		} else {
 			wait_event_freezable(uksm_thread_wait,
@@ -5309,6 +5450,65 @@ static ssize_t sleep_times_show(struct kobject *kobj,
 }
 UKSM_ATTR_RO(sleep_times);
 
+static ssize_t cooldowns_show(struct kobject *kobj,
+			      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", uksm_cooldowns);
+}
+UKSM_ATTR_RO(cooldowns);
+
+#define UKSM_BUDGET_ATTR(_name)						\
+static ssize_t _name##_show(struct kobject *kobj,			\
+			    struct kobj_attribute *attr, char *buf)	\
+{									\
+	return sprintf(buf, "%u\n", uksm_##_name);			\
+}									\
+									\
+static ssize_t _name##_store(struct kobject *kobj,			\
+			     struct kobj_attribute *attr,		\
+			     const char *buf, size_t count)		\
+{									\
+	unsigned long msecs;						\
+	int err;							\
+									\
+	err = strict_strtoul(buf, 10, &msecs);				\
+	if (err || msecs > MSEC_PER_SEC)				\
+		return -EINVAL;						\
+									\
+	uksm_##_name = msecs;						\
+	uksm_budget_start = jiffies - HZ;				\
+									\
+	return count;							\
+}									\
+UKSM_ATTR(_name)
+
+UKSM_BUDGET_ATTR(budget_awake_ms);
+UKSM_BUDGET_ATTR(budget_suspend_ms);
+UKSM_BUDGET_ATTR(budget_charging_ms);
+
+static ssize_t budget_stats_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	unsigned long long cpu_us = uksm_scan_cpu_ns;
+	unsigned long long rate = 0;
+
+	do_div(cpu_us, NSEC_PER_USEC);
+	if (cpu_us) {
+		/* pages merged per CPU msec, in thousandths */
+		rate = (unsigned long long)uksm_pages_merged * 1000000;
+		do_div(rate, cpu_us);
+	}
+
+	return sprintf(buf, "budget_ms %u\nused_ms %llu\nthrottled %llu\n"
+		       "cpu_ms %llu\nmerged %lu\nmerged_per_cpu_ms %llu.%03llu\n",
+		       (unsigned int)(uksm_budget_ns / NSEC_PER_MSEC),
+		       div_u64(uksm_budget_used, NSEC_PER_MSEC),
+		       uksm_budget_throttled, div_u64(cpu_us, USEC_PER_MSEC),
+		       uksm_pages_merged, div_u64(rate, 1000),
+		       rate - div_u64(rate, 1000) * 1000);
+}
+UKSM_ATTR_RO(budget_stats);
+
 
 static struct attribute *uksm_attrs[] = {
 	&max_cpu_percentage_attr.attr,
@@ -5323,6 +5523,11 @@ static struct attribute *uksm_attrs[] = {
 	&pages_scanned_attr.attr,
 	&hash_strength_attr.attr,
 	&sleep_times_attr.attr,
+	&budget_awake_ms_attr.attr,
+	&budget_suspend_ms_attr.attr,
+	&budget_charging_ms_attr.attr,
+	&budget_stats_attr.attr,
+	&cooldowns_attr.attr,
 	&thrash_threshold_attr.attr,
 	&abundant_threshold_attr.attr,
 	&cpu_ratios_attr.attr,
@@ -5559,6 +5764,7 @@ static int __init uksm_init(void)
 
 	uksm_sleep_jiffies = msecs_to_jiffies(100);
 	uksm_sleep_saved = uksm_sleep_jiffies;
+	uksm_budget_start = jiffies - HZ;
 
 	slot_tree_init();
 	init_scan_ladder();
@@ -5595,6 +5801,10 @@ static int __init uksm_init(void)
 
 #endif /* CONFIG_SYSFS */
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	register_early_suspend(&uksm_early_suspend_desc);
+#endif
+
 #ifdef CONFIG_MEMORY_HOTREMOVE
 	/*
 	 * Choose a high priority since the callback takes uksm_thread_mutex:
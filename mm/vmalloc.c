@@ -560,6 +560,24 @@ static unsigned long lazy_max_pages(void)
 
 static atomic_t vmap_lazy_nr = ATOMIC_INIT(0);
 
+/*
+ * A purge gathers areas from all over vmalloc space, and the range between
+ * them is mostly unmapped. Flushing it a page at a time costs far more than
+ * refilling the whole TLB once it covers more pages than the TLB holds.
+ */
+#define VMAP_FLUSH_ALL_PAGES	64
+
+static void vmap_flush_tlb(unsigned long start, unsigned long end)
+{
+	if ((end - start) >> PAGE_SHIFT > VMAP_FLUSH_ALL_PAGES) {
+		count_vm_event(VMAP_TLB_FLUSH_ALL);
+		flush_tlb_all();
+	} else {
+		count_vm_event(VMAP_TLB_FLUSH_RANGE);
+		flush_tlb_kernel_range(start, end);
+	}
+}
+
 /* for per-CPU blocks */
 static void purge_fragmented_blocks_allcpus(void);
 
@@ -620,11 +638,13 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 	}
 	rcu_read_unlock();
 
-	if (nr)
+	if (nr) {
 		atomic_sub(nr, &vmap_lazy_nr);
+		count_vm_event(VMAP_PURGE);
+	}
 
 	if (nr || force_flush)
-		flush_tlb_kernel_range(*start, *end);
+		vmap_flush_tlb(*start, *end);
 
 	if (nr) {
 		spin_lock(&vmap_area_lock);
@@ -727,7 +747,7 @@ static void free_unmap_vmap_area_addr(unsigned long addr)
 #endif
 
 #define VMALLOC_PAGES		(VMALLOC_SPACE / PAGE_SIZE)
-#define VMAP_MAX_ALLOC		BITS_PER_LONG	/* 256K with 4K pages */
+#define VMAP_MAX_ALLOC		(2*BITS_PER_LONG) /* 256K with 4K pages */
 #define VMAP_BBMAP_BITS_MAX	1024	/* 4MB with 4K pages */
 #define VMAP_BBMAP_BITS_MIN	(VMAP_MAX_ALLOC*2)
 #define VMAP_MIN(x, y)		((x) < (y) ? (x) : (y)) /* can't use min() */
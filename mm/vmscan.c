@@ -108,6 +108,9 @@ struct scan_control {
 	/* Which cgroup do we reclaim from */
 	struct mem_cgroup *mem_cgroup;
 
+	/* The caller picked the pages: reclaim them even if referenced */
+	int ignore_references;
+
 	/*
 	 * Nodemask of nodes allowed by the caller. If NULL, all nodes
 	 * are scanned.
@@ -151,6 +154,45 @@ struct scan_control {
 int vm_swappiness = 90;
 long vm_total_pages;	/* The total number of pages which the VM controls */
 
+/*
+ * get_scan_count() weighs anon against file by swappiness alone, as if
+ * swap were a disk. With zram, swapping a page out and back in costs
+ * compression CPU, far less than reading a /system page back from
+ * flash. When vm_swap_cost is set, the priorities are scaled by the
+ * measured costs of getting each kind of page back.
+ *
+ * The costs are running averages in ns of a swap-in major fault, of
+ * swap_writepage(), and of a file major fault. The last element is the
+ * anon share of the latest scan balance, in percent.
+ */
+int vm_swap_cost = 1;
+unsigned long vm_reclaim_cost[NR_RECLAIM_COST];
+
+void reclaim_cost_account(enum reclaim_cost_item item, u64 start)
+{
+	u64 ns = local_clock() - start;
+	unsigned long cost = vm_reclaim_cost[item];
+
+	if (ns > ULONG_MAX / 8)
+		ns = ULONG_MAX / 8;
+	vm_reclaim_cost[item] = cost ? (cost * 7 + (unsigned long)ns) / 8 :
+		(unsigned long)ns;
+}
+
+static void swap_cost_scale(unsigned long *anon_prio, unsigned long *file_prio)
+{
+	u64 anon = vm_reclaim_cost[RECLAIM_COST_SWAPIN] +
+		   vm_reclaim_cost[RECLAIM_COST_SWAPOUT];
+	u64 file = vm_reclaim_cost[RECLAIM_COST_FILE];
+
+	/* Nothing to compare until both kinds have been faulted back */
+	if (!vm_swap_cost || !vm_reclaim_cost[RECLAIM_COST_SWAPIN] || !file)
+		return;
+
+	*anon_prio = div64_u64((u64)*anon_prio * 2 * file, anon + file);
+	*file_prio = div64_u64((u64)*file_prio * 2 * anon, anon + file);
+}
+
 static LIST_HEAD(shrinker_list);
 static DECLARE_RWSEM(shrinker_rwsem);
 
@@ -573,6 +615,8 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 
 		freepage = mapping->a_ops->freepage;
 
+		if (page_is_file_cache(page))
+			workingset_eviction(mapping, page);
 		__delete_from_page_cache(page);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
@@ -700,6 +744,9 @@ static enum page_references page_check_references(struct page *page,
 	if (sc->reclaim_mode & RECLAIM_MODE_LUMPYRECLAIM)
 		return PAGEREF_RECLAIM;
 
+	if (sc->ignore_references)
+		return PAGEREF_RECLAIM;
+
 	/*
 	 * Mlock lost the isolation race with us.  Let try_to_unmap()
 	 * move the page to the unevictable list.
@@ -1652,6 +1699,141 @@ zone_id_shrink_pagelist(struct zone *zone, struct list_head *page_list)
 EXPORT_SYMBOL(zone_id_shrink_pagelist);
 #endif /* CONFIG_ZRAM_FOR_ANDROID */
 
+#ifdef CONFIG_MMU
+struct reclaim_walk {
+	struct vm_area_struct *vma;
+	unsigned int type;
+	struct list_head pages;		/* isolated, all from zone */
+	struct zone *zone;
+	unsigned long nr_anon;
+	unsigned long nr_file;
+	unsigned long nr_reclaimed;
+};
+
+static void reclaim_walk_flush(struct reclaim_walk *rw)
+{
+	struct scan_control sc = {
+		.gfp_mask = GFP_KERNEL,
+		.may_writepage = 1,
+		.may_unmap = 1,
+		.may_swap = 1,
+		.swappiness = vm_swappiness,
+		.nr_to_reclaim = SWAP_CLUSTER_MAX,
+		.reclaim_mode = RECLAIM_MODE_SINGLE | RECLAIM_MODE_ASYNC,
+		.ignore_references = 1,
+	};
+	struct page *page;
+
+	if (list_empty(&rw->pages))
+		return;
+
+	rw->nr_reclaimed += shrink_page_list(&rw->pages, rw->zone, &sc);
+	mod_zone_page_state(rw->zone, NR_ISOLATED_ANON, -rw->nr_anon);
+	mod_zone_page_state(rw->zone, NR_ISOLATED_FILE, -rw->nr_file);
+	rw->nr_anon = rw->nr_file = 0;
+
+	while (!list_empty(&rw->pages)) {
+		page = lru_to_page(&rw->pages);
+		list_del(&page->lru);
+		putback_lru_page(page);
+	}
+}
+
+static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
+			     unsigned long end, struct mm_walk *walk)
+{
+	struct reclaim_walk *rw = walk->private;
+	struct vm_area_struct *vma = rw->vma;
+	pte_t *orig_pte, *pte, ptent;
+	struct page *page;
+	spinlock_t *ptl;
+	int file;
+
+	split_huge_page_pmd(walk->mm, pmd);
+	if (pmd_trans_unstable(pmd))
+		return 0;
+again:
+	orig_pte = pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		ptent = *pte;
+		if (!pte_present(ptent))
+			continue;
+
+		page = vm_normal_page(vma, addr, ptent);
+		/* leave what is shared with other processes */
+		if (!page || page_mapcount(page) != 1 || !PageLRU(page))
+			continue;
+		file = page_is_file_cache(page);
+		if (!(rw->type & (file ? RECLAIM_MM_FILE : RECLAIM_MM_ANON)))
+			continue;
+
+		/* shrink_page_list() takes the pages of one zone */
+		if (!list_empty(&rw->pages) && page_zone(page) != rw->zone)
+			break;
+		if (isolate_lru_page(page))
+			continue;
+		ClearPageActive(page);
+		inc_zone_page_state(page, NR_ISOLATED_ANON + file);
+		list_add(&page->lru, &rw->pages);
+		rw->zone = page_zone(page);
+		if (file)
+			rw->nr_file++;
+		else
+			rw->nr_anon++;
+
+		if (rw->nr_anon + rw->nr_file == SWAP_CLUSTER_MAX) {
+			addr += PAGE_SIZE;
+			break;
+		}
+	}
+	pte_unmap_unlock(orig_pte, ptl);
+
+	if (addr != end || rw->nr_anon + rw->nr_file == SWAP_CLUSTER_MAX)
+		reclaim_walk_flush(rw);
+	if (fatal_signal_pending(current))
+		return -EINTR;
+	cond_resched();
+	if (addr != end)
+		goto again;
+
+	return 0;
+}
+
+/*
+ * Reclaims the pages only mm maps, anon, file or both by type, however
+ * recently they were used: for processes that will not touch them for a
+ * while, such as frozen ones. Returns the number of pages freed.
+ */
+unsigned long reclaim_mm_pages(struct mm_struct *mm, unsigned int type)
+{
+	struct reclaim_walk rw = {
+		.type = type,
+	};
+	struct mm_walk walk = {
+		.pmd_entry = reclaim_pte_range,
+		.mm = mm,
+		.private = &rw,
+	};
+	struct vm_area_struct *vma;
+
+	INIT_LIST_HEAD(&rw.pages);
+
+	down_read(&mm->mmap_sem);
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		if (vma->vm_flags & (VM_LOCKED | VM_IO | VM_PFNMAP |
+				     VM_RESERVED | VM_HUGETLB))
+			continue;
+		rw.vma = vma;
+		if (walk_page_range(vma->vm_start, vma->vm_end, &walk))
+			break;
+	}
+	reclaim_walk_flush(&rw);
+	up_read(&mm->mmap_sem);
+
+	return rw.nr_reclaimed;
+}
+#endif /* CONFIG_MMU */
+
 /*
  * This moves pages from the active list to the inactive list.
  *
@@ -1974,6 +2156,7 @@ static void get_scan_count(struct zone *zone, struct scan_control *sc,
 	 */
 	anon_prio = sc->swappiness;
 	file_prio = 200 - sc->swappiness;
+	swap_cost_scale(&anon_prio, &file_prio);
 
 	/*
 	 * OK, so we have swap space and a fair amount of page cache
@@ -2012,6 +2195,8 @@ static void get_scan_count(struct zone *zone, struct scan_control *sc,
 	fraction[0] = ap;
 	fraction[1] = fp;
 	denominator = ap + fp + 1;
+	vm_reclaim_cost[RECLAIM_COST_ANON_PCT] =
+		div64_u64((u64)ap * 100, denominator);
 	if (force_scan) {
 		unsigned long scan = SWAP_CLUSTER_MAX;
 		nr_force_scan[0] = div64_u64(scan * ap, denominator);
@@ -2156,6 +2341,10 @@ restart:
 	if (inactive_anon_is_low(zone, sc))
 		shrink_active_list(SWAP_CLUSTER_MAX, zone, sc, priority, 0);
 
+	if (scanning_global_lru(sc))
+		lowmem_vmpressure(sc->gfp_mask, sc->nr_scanned - nr_scanned,
+				  nr_reclaimed);
+
 	/* reclaim/compaction might need reclaim to continue */
 	if (should_continue_reclaim(zone, nr_reclaimed,
 					sc->nr_scanned - nr_scanned, sc))
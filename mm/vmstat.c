@@ -613,6 +613,9 @@ static char * const migratetype_names[MIGRATE_TYPES] = {
 	"Reclaimable",
 	"Movable",
 	"Reserve",
+#ifdef CONFIG_CMA
+	"CMA",
+#endif
 	"Isolate",
 };
 
@@ -720,6 +723,9 @@ const char * const vmstat_text[] = {
 	"nr_anon_transparent_hugepages",
 #ifdef CONFIG_UKSM
 	"nr_uksm_zero_pages",
+#endif
+#ifdef CONFIG_CMA
+	"nr_free_cma",
 #endif
 	"nr_dirty_threshold",
 	"nr_dirty_background_threshold",
@@ -733,6 +739,8 @@ const char * const vmstat_text[] = {
 	TEXTS_FOR_ZONES("pgalloc")
 
 	"pgfree",
+	"pcp_high_order_hit",
+	"pcp_high_order_miss",
 	"pgactivate",
 	"pgdeactivate",
 
@@ -758,6 +766,18 @@ const char * const vmstat_text[] = {
 	"allocstall",
 
 	"pgrotated",
+	"workingset_refault",
+	"workingset_activate",
+	"swap_ra",
+	"swap_ra_hit",
+	"vmap_purge",
+	"vmap_tlb_flush_range",
+	"vmap_tlb_flush_all",
+#ifdef CONFIG_CPU_HAS_ASID
+	"asid_alloc",
+	"asid_rollover",
+	"asid_flush",
+#endif
 
 #ifdef CONFIG_COMPACTION
 	"compact_blocks_moved",
@@ -766,6 +786,10 @@ const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_stall_us",
+	"compact_daemon_wake",
+	"compact_daemon_run",
+	"compact_daemon_us",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
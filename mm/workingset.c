@@ -0,0 +1,113 @@
+/*
+ * mm/workingset.c - detection of file pages refaulting soon after reclaim
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * File pages start on the inactive list and have to be referenced twice
+ * there to be activated. When the inactive list is too short to hold the
+ * working set, hot pages are evicted before their second reference and
+ * come straight back from flash, with nothing telling reclaim.
+ *
+ * Every file page evicted by reclaim leaves a record of its mapping and
+ * index, with the number of evictions so far. When the page is read back
+ * in, the evictions since then are its refault distance: how much longer
+ * the inactive list would have had to be to keep it. If that is no more
+ * than the active list, which could have given up the room, the page is
+ * part of the working set and goes straight to the active list.
+ *
+ * The records are kept in a direct-mapped table rather than as shadow
+ * entries in the page cache radix tree, so every page cache lookup stays
+ * as it is. A record is overwritten by a later eviction hashing to the
+ * same slot, which only loses the information for the older page.
+ */
+
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/jhash.h>
+#include <linux/swap.h>
+#include <linux/vmalloc.h>
+#include <linux/vmstat.h>
+
+struct workingset_shadow {
+	u32	key;
+	u32	evicted;
+};
+
+static struct workingset_shadow *workingset_table;
+static unsigned int workingset_mask;
+
+/* File pages evicted by reclaim, the clock of refault distances */
+static u32 workingset_evictions;
+
+static u32 workingset_key(struct address_space *mapping, pgoff_t index)
+{
+	/* 0 marks an empty slot */
+	return jhash_2words((u32)(unsigned long)mapping, (u32)index, 0) | 1;
+}
+
+/* Called with the tree_lock of mapping held, as page leaves the cache */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct workingset_shadow *shadow;
+	u32 key;
+
+	if (!workingset_table)
+		return;
+
+	key = workingset_key(mapping, page->index);
+	shadow = &workingset_table[key & workingset_mask];
+	shadow->key = key;
+	shadow->evicted = workingset_evictions++;
+}
+
+/* Whether a page being added at index of mapping refaults the working set */
+bool workingset_refault(struct address_space *mapping, pgoff_t index)
+{
+	struct workingset_shadow *shadow;
+	u32 key, distance;
+
+	if (!workingset_table)
+		return false;
+
+	key = workingset_key(mapping, index);
+	shadow = &workingset_table[key & workingset_mask];
+	if (shadow->key != key)
+		return false;
+
+	shadow->key = 0;
+	distance = workingset_evictions - shadow->evicted;
+	count_vm_event(WORKINGSET_REFAULT);
+
+	if (distance > global_page_state(NR_ACTIVE_FILE))
+		return false;
+
+	count_vm_event(WORKINGSET_ACTIVATE);
+	return true;
+}
+
+/*
+ * One slot for every four pages of memory: refault distances beyond the
+ * size of the active list do not activate anyway.
+ */
+static int __init workingset_init(void)
+{
+	unsigned long slots = roundup_pow_of_two(max(totalram_pages / 4, 1024UL));
+	struct workingset_shadow *table;
+
+	table = vzalloc(slots * sizeof(*table));
+	if (!table) {
+		pr_warn("workingset: no memory for %lu refault records\n",
+			slots);
+		return -ENOMEM;
+	}
+	workingset_mask = slots - 1;
+	smp_wmb();
+	workingset_table = table;
+
+	return 0;
+}
+module_init(workingset_init);
@@ -31,6 +31,11 @@ int sysctl_tcp_retries1 __read_mostly = TCP_RETR1;
 int sysctl_tcp_retries2 __read_mostly = TCP_RETR2;
 int sysctl_tcp_orphan_retries __read_mostly;
 int sysctl_tcp_thin_linear_timeouts __read_mostly;
+int sysctl_tcp_timer_slack __read_mostly;
+int sysctl_tcp_keepalive_slack __read_mostly = 10;
+
+/* Tick of the last TCP timer to fire on this CPU */
+static DEFINE_PER_CPU(unsigned long, tcp_timer_last);
 
 static void tcp_write_timer(unsigned long);
 static void tcp_delack_timer(unsigned long);
@@ -43,6 +48,17 @@ void tcp_init_xmit_timers(struct sock *sk)
 }
 EXPORT_SYMBOL(tcp_init_xmit_timers);
 
+/*
+ * A timer firing in the same tick as the one before it shares its wakeup:
+ * count those, as what the slack makes timers save.
+ */
+static void tcp_timer_coalesced(struct sock *sk)
+{
+	if (__this_cpu_read(tcp_timer_last) == jiffies)
+		NET_INC_STATS_BH(sock_net(sk), LINUX_MIB_TCPTIMERCOALESCED);
+	__this_cpu_write(tcp_timer_last, jiffies);
+}
+
 static void tcp_write_err(struct sock *sk)
 {
 	sk->sk_err = sk->sk_err_soft ? : ETIMEDOUT;
@@ -214,6 +230,7 @@ static void tcp_delack_timer(unsigned long data)
 	struct tcp_sock *tp = tcp_sk(sk);
 	struct inet_connection_sock *icsk = inet_csk(sk);
 
+	tcp_timer_coalesced(sk);
 	bh_lock_sock(sk);
 	if (sock_owned_by_user(sk)) {
 		/* Try again later. */
@@ -454,6 +471,7 @@ static void tcp_write_timer(unsigned long data)
 	struct inet_connection_sock *icsk = inet_csk(sk);
 	int event;
 
+	tcp_timer_coalesced(sk);
 	bh_lock_sock(sk);
 	if (sock_owned_by_user(sk)) {
 		/* Try again later */
@@ -523,6 +541,7 @@ static void tcp_keepalive_timer (unsigned long data)
 	struct tcp_sock *tp = tcp_sk(sk);
 	u32 elapsed;
 
+	tcp_timer_coalesced(sk);
 	/* Only process if socket is not in use. */
 	bh_lock_sock(sk);
 	if (sock_owned_by_user(sk)) {
@@ -19,6 +19,8 @@
 #include <linux/module.h>
 #include <linux/netfilter/x_tables.h>
 #include <linux/netfilter/xt_qtaguid.h>
+#include <linux/percpu.h>
+#include <linux/rculist.h>
 #include <linux/skbuff.h>
 #include <linux/workqueue.h>
 #include <net/addrconf.h>
@@ -187,10 +189,12 @@ static struct proc_dir_entry *iface_stat_fmt_procfile;
  *     iface_stat_list_lock
  *
  * qtaguid_mt()
+ *   iface_stat_update_from_skb()
+ *     struct iface_stat->tag_stat_list_lock
  *   account_for_uid()
  *     if_tag_stat_update()
- *       get_sock_stat()
- *         sock_tag_list_lock
+ *       get_sock_tag()
+ *         sock_tag_list_lock, unless cached
  *       struct iface_stat->tag_stat_list_lock
  *         tag_stat_update()
  *           get_active_counter_set()
@@ -222,11 +226,26 @@ static struct proc_dir_entry *iface_stat_fmt_procfile;
  *     uid_tag_data_tree_lock
  *
  */
+/*
+ * iface_stat entries are never freed, and only added under
+ * iface_stat_list_lock, so the packet path looks them up under RCU.
+ */
 static LIST_HEAD(iface_stat_list);
 static DEFINE_SPINLOCK(iface_stat_list_lock);
 
 static struct rb_root sock_tag_tree = RB_ROOT;
 static DEFINE_SPINLOCK(sock_tag_list_lock);
+/* Bumped under sock_tag_list_lock on every change to sock_tag_tree */
+static unsigned int sock_tag_gen;
+
+/* Last socket looked up on this CPU, packets of a flow come in bursts */
+struct sock_tag_cache {
+	const struct sock *sk;
+	unsigned int gen;
+	bool tagged;
+	tag_t tag;
+};
+static DEFINE_PER_CPU(struct sock_tag_cache, sock_tag_cache);
 
 static struct rb_root tag_counter_set_tree = RB_ROOT;
 static DEFINE_SPINLOCK(tag_counter_set_list_lock);
@@ -766,7 +785,7 @@ static int get_active_counter_set(tag_t tag)
 
 /*
  * Find the entry for tracking the specified interface.
- * Caller must hold iface_stat_list_lock
+ * Caller must hold iface_stat_list_lock or rcu_read_lock()
  */
 static struct iface_stat *get_iface_entry(const char *ifname)
 {
@@ -779,7 +798,7 @@ static struct iface_stat *get_iface_entry(const char *ifname)
 	}
 
 	/* Iterate over interfaces */
-	list_for_each_entry(iface_entry, &iface_stat_list, list) {
+	list_for_each_entry_rcu(iface_entry, &iface_stat_list, list) {
 		if (!strcmp(ifname, iface_entry->ifname))
 			goto done;
 	}
@@ -866,6 +885,7 @@ static int iface_stat_fmt_proc_read(char *page, char **num_items_returned,
 				stats->tx_bytes, stats->tx_packets
 				);
 		} else {
+			spin_lock_bh(&iface_entry->tag_stat_list_lock);
 			len = snprintf(
 				outp, char_count,
 				"%s "
@@ -876,6 +896,7 @@ static int iface_stat_fmt_proc_read(char *page, char **num_items_returned,
 				iface_entry->totals_via_skb[IFS_TX].bytes,
 				iface_entry->totals_via_skb[IFS_TX].packets
 				);
+			spin_unlock_bh(&iface_entry->tag_stat_list_lock);
 		}
 		if (len >= char_count) {
 			spin_unlock_bh(&iface_stat_list_lock);
@@ -994,7 +1015,7 @@ static struct iface_stat *iface_alloc(struct net_device *net_dev)
 	isw->iface_entry = new_iface;
 	INIT_WORK(&isw->iface_work, iface_create_proc_worker);
 	schedule_work(&isw->iface_work);
-	list_add(&new_iface->list, &iface_stat_list);
+	list_add_rcu(&new_iface->list, &iface_stat_list);
 	return new_iface;
 }
 
@@ -1175,16 +1196,36 @@ static struct sock_tag *get_sock_stat_nl(const struct sock *sk)
 	return sock_tag_tree_search(&sock_tag_tree, sk);
 }
 
-static struct sock_tag *get_sock_stat(const struct sock *sk)
+/*
+ * Returns whether sk is tagged, and its tag. The entry itself may be
+ * freed by an untag as soon as sock_tag_list_lock is dropped, so only
+ * the tag is handed out.
+ */
+static bool get_sock_tag(const struct sock *sk, tag_t *tag)
 {
+	struct sock_tag_cache *cache;
 	struct sock_tag *sock_tag_entry;
-	MT_DEBUG("qtaguid: get_sock_stat(sk=%p)\n", sk);
+
+	MT_DEBUG("qtaguid: get_sock_tag(sk=%p)\n", sk);
 	if (!sk)
-		return NULL;
-	spin_lock_bh(&sock_tag_list_lock);
-	sock_tag_entry = get_sock_stat_nl(sk);
-	spin_unlock_bh(&sock_tag_list_lock);
-	return sock_tag_entry;
+		return false;
+
+	local_bh_disable();
+	cache = &__get_cpu_var(sock_tag_cache);
+	if (cache->sk != sk || cache->gen != ACCESS_ONCE(sock_tag_gen)) {
+		spin_lock(&sock_tag_list_lock);
+		sock_tag_entry = get_sock_stat_nl(sk);
+		cache->sk = sk;
+		cache->gen = sock_tag_gen;
+		cache->tagged = sock_tag_entry != NULL;
+		if (sock_tag_entry)
+			cache->tag = sock_tag_entry->tag;
+		spin_unlock(&sock_tag_list_lock);
+	}
+	*tag = cache->tag;
+	local_bh_enable();
+
+	return cache->tagged;
 }
 
 static int ipx_proto(const struct sk_buff *skb,
@@ -1325,21 +1366,22 @@ static void iface_stat_update_from_skb(const struct sk_buff *skb,
 			 par->family, proto);
 	}
 
-	spin_lock_bh(&iface_stat_list_lock);
+	rcu_read_lock();
 	entry = get_iface_entry(el_dev->name);
+	rcu_read_unlock();
 	if (entry == NULL) {
 		IF_DEBUG("qtaguid: iface_stat: %s(%s): not tracked\n",
 			 __func__, el_dev->name);
-		spin_unlock_bh(&iface_stat_list_lock);
 		return;
 	}
 
 	IF_DEBUG("qtaguid: %s(%s): entry=%p\n", __func__,
 		 el_dev->name, entry);
 
+	spin_lock_bh(&entry->tag_stat_list_lock);
 	entry->totals_via_skb[direction].bytes += bytes;
 	entry->totals_via_skb[direction].packets++;
-	spin_unlock_bh(&iface_stat_list_lock);
+	spin_unlock_bh(&entry->tag_stat_list_lock);
 }
 
 static void tag_stat_update(struct tag_stat *tag_entry,
@@ -1389,15 +1431,15 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 	tag_t tag, acct_tag;
 	tag_t uid_tag;
 	struct data_counters *uid_tag_counters;
-	struct sock_tag *sock_tag_entry;
 	struct iface_stat *iface_entry;
 	struct tag_stat *new_tag_stat = NULL;
 	MT_DEBUG("qtaguid: if_tag_stat_update(ifname=%s "
 		"uid=%u sk=%p dir=%d proto=%d bytes=%d)\n",
 		 ifname, uid, sk, direction, proto, bytes);
 
-
+	rcu_read_lock();
 	iface_entry = get_iface_entry(ifname);
+	rcu_read_unlock();
 	if (!iface_entry) {
 		pr_err("qtaguid: iface_stat: stat_update() %s not found\n",
 		       ifname);
@@ -1412,9 +1454,7 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 	 * Look for a tagged sock.
 	 * It will have an acct_uid.
 	 */
-	sock_tag_entry = get_sock_stat(sk);
-	if (sock_tag_entry) {
-		tag = sock_tag_entry->tag;
+	if (get_sock_tag(sk, &tag)) {
 		acct_tag = get_atag_from_tag(tag);
 		uid_tag = get_utag_from_tag(tag);
 	} else {
@@ -2105,6 +2145,7 @@ static int ctrl_cmd_delete(const char *input)
 				list_del(&st_entry->list);
 		}
 	}
+	sock_tag_gen++;
 	spin_unlock_bh(&sock_tag_list_lock);
 
 	sock_tag_tree_erase(&st_to_free_tree);
@@ -2377,6 +2418,7 @@ static int ctrl_cmd_tag(const char *input)
 		sock_tag_tree_insert(sock_tag_entry, &sock_tag_tree);
 		atomic64_inc(&qtu_events.sockets_tagged);
 	}
+	sock_tag_gen++;
 	spin_unlock_bh(&sock_tag_list_lock);
 	/* We keep the ref to the socket (file) until it is untagged */
 	CT_DEBUG("qtaguid: ctrl_tag(%s): done st@%p ...->f_count=%ld\n",
@@ -2441,6 +2483,7 @@ static int ctrl_cmd_untag(const char *input)
 	 * so it can do whatever it wants to it.
 	 */
 	rb_erase(&sock_tag_entry->sock_node, &sock_tag_tree);
+	sock_tag_gen++;
 
 	tag_ref_entry = lookup_tag_ref(sock_tag_entry->tag, &utd_entry);
 	BUG_ON(!tag_ref_entry);
@@ -2862,6 +2905,7 @@ static int qtudev_release(struct inode *inode, struct file *file)
 	kfree(pqd_entry);
 	file->private_data = NULL;
 
+	sock_tag_gen++;
 	spin_unlock_bh(&uid_tag_data_tree_lock);
 	spin_unlock_bh(&sock_tag_list_lock);
 
@@ -153,10 +153,47 @@ select_clock_control universal_clock_controls = wm8994_configure_clock;
 int vtcall_active;
 #endif
 
+/*
+ * Register cache. Path changes are mostly read-modify-write sequences,
+ * so serving the reads from the values last written halves their I2C
+ * traffic, and writes that would not change a register are dropped.
+ * Status, readback and trigger registers always go to the chip. The
+ * cache is dropped whenever the chip is reset or loses its supply.
+ */
+#define WM8994_CACHE_SIZE	WM8994_GPIO_1
+
+static u16 wm8994_reg_cache[WM8994_CACHE_SIZE];
+static DECLARE_BITMAP(wm8994_reg_valid, WM8994_CACHE_SIZE);
+
+static bool wm8994_volatile_register(unsigned int reg)
+{
+	switch (reg) {
+	case WM8994_SOFTWARE_RESET:
+	case WM8994_DC_SERVO_1:
+	case WM8994_DC_SERVO_2:
+	case WM8994_DC_SERVO_4:
+	case WM8994_DC_SERVO_READBACK:
+	case WM8994_WRITE_SEQUENCER_CTRL_1:
+	case WM8994_WRITE_SEQUENCER_CTRL_2:
+	case 0x100:	/* chip revision */
+		return true;
+	default:
+		break;
+	}
+
+	return reg >= WM8994_CACHE_SIZE;
+}
+
+static void wm8994_cache_invalidate(void)
+{
+	bitmap_zero(wm8994_reg_valid, WM8994_CACHE_SIZE);
+}
+
 /*
  * Implementation of I2C functions
  */
-static unsigned int wm8994_read_hw(struct snd_soc_codec *codec, u16 reg)
+static int wm8994_read_hw(struct snd_soc_codec *codec, u16 reg,
+			  unsigned int *val)
 {
 	struct i2c_msg xfer[2];
 	u16 data;
@@ -177,10 +214,12 @@ static unsigned int wm8994_read_hw(struct snd_soc_codec *codec, u16 reg)
 	ret = i2c_transfer(i2c->adapter, xfer, 2);
 	if (ret != 2) {
 		dev_err(codec->dev, "Failed to read 0x%x: %d\n", reg, ret);
-		return 0;
+		*val = 0;
+		return -EIO;
 	}
 
-	return (data >> 8) | ((data & 0xff) << 8);
+	*val = (data >> 8) | ((data & 0xff) << 8);
+	return 0;
 }
 
 int wm8994_write(struct snd_soc_codec *codec, unsigned int reg,
@@ -197,19 +236,44 @@ int wm8994_write(struct snd_soc_codec *codec, unsigned int reg,
 	data[1] = reg & 0x00ff;
 	data[2] = value >> 8;
 	data[3] = value & 0x00ff;
+
+	if (reg == WM8994_SOFTWARE_RESET)
+		wm8994_cache_invalidate();
+	else if (!wm8994_volatile_register(reg) &&
+		 test_bit(reg, wm8994_reg_valid) &&
+		 wm8994_reg_cache[reg] == value)
+		return 0;
+
 	ret = codec->hw_write(codec->control_data, data, 4);
 
-	if (ret == 4)
+	if (ret == 4) {
+		if (!wm8994_volatile_register(reg)) {
+			wm8994_reg_cache[reg] = value;
+			set_bit(reg, wm8994_reg_valid);
+		}
 		return 0;
-	else {
+	} else {
 		pr_err("i2c write problem occured\n");
+		if (!wm8994_volatile_register(reg))
+			clear_bit(reg, wm8994_reg_valid);
 		return ret;
 	}
 }
 
 unsigned int wm8994_read(struct snd_soc_codec *codec, unsigned int reg)
 {
-	return wm8994_read_hw(codec, reg);
+	unsigned int val;
+
+	if (!wm8994_volatile_register(reg) && test_bit(reg, wm8994_reg_valid))
+		return wm8994_reg_cache[reg];
+
+	if (!wm8994_read_hw(codec, reg, &val) &&
+	    !wm8994_volatile_register(reg)) {
+		wm8994_reg_cache[reg] = val;
+		set_bit(reg, wm8994_reg_valid);
+	}
+
+	return val;
 }
 
 static int wm8994_ldo_control(struct wm8994_platform_data *pdata, int en)
@@ -220,6 +284,7 @@ static int wm8994_ldo_control(struct wm8994_platform_data *pdata, int en)
 	}
 
 	gpio_set_value(pdata->ldo, en);
+	wm8994_cache_invalidate();
 
 	if (en)
 		msleep(10);
@@ -20,7 +20,8 @@ static int s3c_wrpdma_hw_params(struct snd_pcm_substream *substream,
 	struct snd_soc_platform *platform;
 
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    !s3c_dma_is_deep(substream))
 		platform = &idma_soc_platform;
 	else
 #endif
@@ -37,7 +38,8 @@ static int s3c_wrpdma_hw_free(struct snd_pcm_substream *substream)
 	struct snd_soc_platform *platform;
 
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    !s3c_dma_is_deep(substream))
 		platform = &idma_soc_platform;
 	else
 #endif
@@ -54,7 +56,8 @@ static int s3c_wrpdma_prepare(struct snd_pcm_substream *substream)
 	struct snd_soc_platform *platform;
 
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    !s3c_dma_is_deep(substream))
 		platform = &idma_soc_platform;
 	else
 #endif
@@ -71,7 +74,8 @@ static int s3c_wrpdma_trigger(struct snd_pcm_substream *substream, int cmd)
 	struct snd_soc_platform *platform;
 
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    !s3c_dma_is_deep(substream))
 		platform = &idma_soc_platform;
 	else
 #endif
@@ -88,7 +92,8 @@ static snd_pcm_uframes_t s3c_wrpdma_pointer(struct snd_pcm_substream *substream)
 	struct snd_soc_platform *platform;
 
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    !s3c_dma_is_deep(substream))
 		platform = &idma_soc_platform;
 	else
 #endif
@@ -105,7 +110,8 @@ static int s3c_wrpdma_open(struct snd_pcm_substream *substream)
 	struct snd_soc_platform *platform;
 
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    !s3c_dma_is_deep(substream))
 		platform = &idma_soc_platform;
 	else
 #endif
@@ -122,7 +128,8 @@ static int s3c_wrpdma_close(struct snd_pcm_substream *substream)
 	struct snd_soc_platform *platform;
 
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    !s3c_dma_is_deep(substream))
 		platform = &idma_soc_platform;
 	else
 #endif
@@ -140,7 +147,8 @@ static int s3c_wrpdma_ioctl(struct snd_pcm_substream *substream,
 	struct snd_soc_platform *platform;
 
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    !s3c_dma_is_deep(substream))
 		platform = &idma_soc_platform;
 	else
 #endif
@@ -158,7 +166,8 @@ static int s3c_wrpdma_mmap(struct snd_pcm_substream *substream,
 	struct snd_soc_platform *platform;
 
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    !s3c_dma_is_deep(substream))
 		platform = &idma_soc_platform;
 	else
 #endif
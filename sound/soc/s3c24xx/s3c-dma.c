@@ -20,6 +20,7 @@
 #include <linux/platform_device.h>
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
+#include <linux/earlysuspend.h>
 
 #include <sound/core.h>
 #include <sound/pcm.h>
@@ -53,6 +54,68 @@ static const struct snd_pcm_hardware s3c_dma_hardware = {
 	.fifo_size		= 32,
 };
 
+static const struct snd_pcm_hardware s3c_dma_deep_hardware = {
+	.info			= SNDRV_PCM_INFO_INTERLEAVED |
+				    SNDRV_PCM_INFO_BLOCK_TRANSFER |
+				    SNDRV_PCM_INFO_MMAP |
+				    SNDRV_PCM_INFO_MMAP_VALID |
+				    SNDRV_PCM_INFO_PAUSE |
+				    SNDRV_PCM_INFO_RESUME,
+	.formats		= SNDRV_PCM_FMTBIT_S16_LE |
+				    SNDRV_PCM_FMTBIT_U16_LE |
+				    SNDRV_PCM_FMTBIT_U8 |
+				    SNDRV_PCM_FMTBIT_S8,
+	.channels_min		= 2,
+	.channels_max		= 2,
+	.buffer_bytes_max	= S3C_DMA_DEEP_BUFFER,
+	.period_bytes_min	= 128,
+	.period_bytes_max	= S3C_DMA_DEEP_PERIOD,
+	.periods_min		= 2,
+	.periods_max		= 128,
+	.fifo_size		= 32,
+};
+
+/* Use the deep buffer for playback started with the screen off */
+static bool deep_buffer = true;
+module_param(deep_buffer, bool, 0644);
+
+static bool s3c_dma_screen_off;
+struct snd_pcm_substream *s3c_dma_deep_substream;
+EXPORT_SYMBOL_GPL(s3c_dma_deep_substream);
+
+#ifdef CONFIG_S5P_INTERNAL_DMA
+/* The playback dma_buffer is the IDMA SRAM, the deep buffer is in DRAM */
+static struct snd_dma_buffer s3c_dma_deep_buf;
+#endif
+
+void s3c_dma_deep_select(struct snd_pcm_substream *substream)
+{
+	if (substream->stream != SNDRV_PCM_STREAM_PLAYBACK)
+		return;
+
+	if (deep_buffer && s3c_dma_screen_off && !s3c_dma_deep_substream)
+		s3c_dma_deep_substream = substream;
+	else if (s3c_dma_deep_substream == substream)
+		s3c_dma_deep_substream = NULL;
+}
+EXPORT_SYMBOL_GPL(s3c_dma_deep_select);
+
+void s3c_dma_deep_release(struct snd_pcm_substream *substream)
+{
+	if (s3c_dma_deep_substream == substream)
+		s3c_dma_deep_substream = NULL;
+}
+EXPORT_SYMBOL_GPL(s3c_dma_deep_release);
+
+static struct snd_dma_buffer *s3c_dma_buffer(struct snd_pcm_substream *substream)
+{
+#ifdef CONFIG_S5P_INTERNAL_DMA
+	if (s3c_dma_is_deep(substream))
+		return &s3c_dma_deep_buf;
+#endif
+	return &substream->dma_buffer;
+}
+
 struct s3c24xx_runtime_data {
 	spinlock_t lock;
 	int state;
@@ -87,13 +150,17 @@ static void s3c_dma_enqueue(struct snd_pcm_substream *substream)
 	pr_debug("%s: loaded %d, limit %d\n",
 				__func__, prtd->dma_loaded, limit);
 
-	
-#if 0
-	ret = s3c2410_dma_enqueue_autoload (prtd->params->channel,
-		substream, pos, prtd->dma_period, limit);
-	if (ret == 0) {
-		prtd->dma_loaded += limit;
-		pos += prtd->dma_period;
+#ifdef CONFIG_S3C_PL330_DMA
+	/* the whole ring in one call, when it is made of whole periods */
+	if (!prtd->dma_loaded && s3c_dma_has_circular() &&
+	    !((prtd->dma_end - prtd->dma_start) % prtd->dma_period)) {
+		ret = s3c2410_dma_enqueue_cyclic(prtd->params->channel,
+			substream, prtd->dma_start, prtd->dma_period, limit);
+		if (ret == 0) {
+			prtd->dma_loaded = limit;
+			prtd->dma_pos = prtd->dma_start;
+			return;
+		}
 	}
 #endif
 	while (prtd->dma_loaded < limit) {
@@ -194,7 +261,7 @@ static int s3c_dma_hw_params(struct snd_pcm_substream *substream,
 	s3c2410_dma_set_buffdone_fn(prtd->params->channel,
 				    s3c24xx_audio_buffdone);
 
-	snd_pcm_set_runtime_buffer(substream, &substream->dma_buffer);
+	snd_pcm_set_runtime_buffer(substream, s3c_dma_buffer(substream));
 
 	runtime->dma_bytes = totbytes;
 
@@ -348,7 +415,10 @@ static int s3c_dma_open(struct snd_pcm_substream *substream)
 	pr_debug("Entered %s\n", __func__);
 
 	snd_pcm_hw_constraint_integer(runtime, SNDRV_PCM_HW_PARAM_PERIODS);
-	snd_soc_set_runtime_hwparams(substream, &s3c_dma_hardware);
+	if (s3c_dma_is_deep(substream))
+		snd_soc_set_runtime_hwparams(substream, &s3c_dma_deep_hardware);
+	else
+		snd_soc_set_runtime_hwparams(substream, &s3c_dma_hardware);
 
 	prtd = kzalloc(sizeof(struct s3c24xx_runtime_data), GFP_KERNEL);
 	if (prtd == NULL)
@@ -371,6 +441,7 @@ static int s3c_dma_close(struct snd_pcm_substream *substream)
 		pr_debug("s3c_dma_close called with prtd == NULL\n");
 
 	kfree(prtd);
+	s3c_dma_deep_release(substream);
 
 	return 0;
 }
@@ -400,12 +471,9 @@ static struct snd_pcm_ops s3c_dma_ops = {
 	.mmap		= s3c_dma_mmap,
 };
 
-static int s3c_preallocate_dma_buffer(struct snd_pcm *pcm, int stream)
+static int s3c_alloc_dma_buffer(struct snd_pcm *pcm,
+	struct snd_dma_buffer *buf, size_t size)
 {
-	struct snd_pcm_substream *substream = pcm->streams[stream].substream;
-	struct snd_dma_buffer *buf = &substream->dma_buffer;
-	size_t size = s3c_dma_hardware.buffer_bytes_max;
-
 	pr_debug("Entered %s\n", __func__);
 	buf->dev.type = SNDRV_DMA_TYPE_DEV;
 	buf->dev.dev = pcm->card->dev;
@@ -418,6 +486,18 @@ static int s3c_preallocate_dma_buffer(struct snd_pcm *pcm, int stream)
 	return 0;
 }
 
+static int s3c_preallocate_dma_buffer(struct snd_pcm *pcm, int stream)
+{
+	struct snd_pcm_substream *substream = pcm->streams[stream].substream;
+	size_t size = s3c_dma_hardware.buffer_bytes_max;
+
+	/* the normal playback path uses the start of the deep buffer */
+	if (stream == SNDRV_PCM_STREAM_PLAYBACK)
+		size = S3C_DMA_DEEP_BUFFER;
+
+	return s3c_alloc_dma_buffer(pcm, &substream->dma_buffer, size);
+}
+
 static void s3c_dma_free_dma_buffers(struct snd_pcm *pcm)
 {
 	struct snd_pcm_substream *substream;
@@ -443,6 +523,15 @@ static void s3c_dma_free_dma_buffers(struct snd_pcm *pcm)
 				      buf->area, buf->addr);
 		buf->area = NULL;
 	}
+
+#ifdef CONFIG_S5P_INTERNAL_DMA
+	if (s3c_dma_deep_buf.area) {
+		dma_free_writecombine(pcm->card->dev, s3c_dma_deep_buf.bytes,
+				      s3c_dma_deep_buf.area,
+				      s3c_dma_deep_buf.addr);
+		s3c_dma_deep_buf.area = NULL;
+	}
+#endif
 }
 
 static u64 s3c_dma_mask = DMA_BIT_MASK(32);
@@ -465,6 +554,12 @@ static int s3c_dma_new(struct snd_card *card,
 		if (ret)
 			goto out;
 	}
+#endif
+#ifdef CONFIG_S5P_INTERNAL_DMA
+	/* without it playback just stays on the IDMA */
+	if (dai->playback.channels_min && !s3c_dma_deep_buf.area &&
+	    s3c_alloc_dma_buffer(pcm, &s3c_dma_deep_buf, S3C_DMA_DEEP_BUFFER))
+		pr_warn("%s: no deep playback buffer\n", __func__);
 #endif
 	if (dai->capture.channels_min) {
 		ret = s3c_preallocate_dma_buffer(pcm,
@@ -484,6 +579,37 @@ struct snd_soc_platform s3c24xx_soc_platform = {
 };
 EXPORT_SYMBOL_GPL(s3c24xx_soc_platform);
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void s3c_dma_early_suspend(struct early_suspend *h)
+{
+	s3c_dma_screen_off = true;
+}
+
+static void s3c_dma_late_resume(struct early_suspend *h)
+{
+	s3c_dma_screen_off = false;
+}
+
+static struct early_suspend s3c_dma_early_suspend_desc = {
+	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB,
+	.suspend = s3c_dma_early_suspend,
+	.resume = s3c_dma_late_resume,
+};
+
+static int __init s3c_dma_init(void)
+{
+	register_early_suspend(&s3c_dma_early_suspend_desc);
+	return 0;
+}
+module_init(s3c_dma_init);
+
+static void __exit s3c_dma_exit(void)
+{
+	unregister_early_suspend(&s3c_dma_early_suspend_desc);
+}
+module_exit(s3c_dma_exit);
+#endif
+
 MODULE_AUTHOR("Ben Dooks, <ben@simtec.co.uk>");
 MODULE_DESCRIPTION("Samsung S3C Audio DMA module");
 MODULE_LICENSE("GPL");
@@ -30,4 +30,22 @@ extern struct snd_soc_platform s3c24xx_soc_platform;
 extern struct snd_soc_platform s3c24xx_pcm_soc_platform;
 extern struct snd_ac97_bus_ops s3c24xx_ac97_ops;
 
+/*
+ * Deep buffer playback: a playback stream opened with the screen off
+ * runs on the system DMA from a large DRAM buffer, in periods of up to
+ * S3C_DMA_DEEP_PERIOD, instead of the short periods of the normal path.
+ * The choice is made when the cpu dai starts up and holds until close.
+ */
+#define S3C_DMA_DEEP_BUFFER	(512 * 1024)
+#define S3C_DMA_DEEP_PERIOD	(128 * 1024)
+
+extern struct snd_pcm_substream *s3c_dma_deep_substream;
+extern void s3c_dma_deep_select(struct snd_pcm_substream *substream);
+extern void s3c_dma_deep_release(struct snd_pcm_substream *substream);
+
+static inline bool s3c_dma_is_deep(struct snd_pcm_substream *substream)
+{
+	return substream == s3c_dma_deep_substream;
+}
+
 #endif
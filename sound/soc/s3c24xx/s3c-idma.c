@@ -108,13 +108,8 @@ static struct s3c_idma_info {
 	void __iomem  *regs;
 } s3c_idma;
 
+/* The transfer count is only readable with the audio clocks running */
 static void s3c_idma_getpos(dma_addr_t *src)
-{
-	*src = LP_TXBUFF_ADDR +
-		(readl(s3c_idma.regs + S5P_IISTRNCNT) & 0xffffff) * 4;
-}
-
-void i2sdma_getpos(dma_addr_t *src)
 {
 	if (audio_clk_stat)
 		*src = LP_TXBUFF_ADDR +
@@ -123,6 +118,11 @@ void i2sdma_getpos(dma_addr_t *src)
 		*src = LP_TXBUFF_ADDR;
 }
 
+void i2sdma_getpos(dma_addr_t *src)
+{
+	s3c_idma_getpos(src);
+}
+
 static int s3c_idma_enqueue(struct snd_pcm_substream *substream)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
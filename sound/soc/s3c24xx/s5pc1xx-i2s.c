@@ -126,7 +126,8 @@ static int s5p_i2s_wr_hw_params(struct snd_pcm_substream *substream,
 		struct snd_soc_dai *dai)
 {
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    !s3c_dma_is_deep(substream))
 		s5p_i2s_hw_params(substream, params, dai);
 	else
 		s3c2412_i2s_hw_params(substream, params, dai);
@@ -139,7 +140,8 @@ static int s5p_i2s_wr_trigger(struct snd_pcm_substream *substream,
 		int cmd, struct snd_soc_dai *dai)
 {
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    !s3c_dma_is_deep(substream))
 		s5p_i2s_trigger(substream, cmd, dai);
 	else
 		s3c2412_i2s_trigger(substream, cmd, dai);
@@ -149,6 +151,37 @@ static int s5p_i2s_wr_trigger(struct snd_pcm_substream *substream,
 	return 0;
 }
 
+/*
+ * Frames the DMA has moved but the codec has not played yet, or has
+ * recorded but the DMA has not read yet. ASoC adds it to the pointer
+ * as runtime->delay, so snd_pcm_delay() and the status timestamps
+ * describe the sample at the DAC rather than at the FIFO.
+ */
+static snd_pcm_sframes_t s5p_i2s_delay(struct snd_pcm_substream *substream,
+		struct snd_soc_dai *dai)
+{
+	struct s3c_i2sv2_info *i2s = to_info(dai);
+	u32 fic, words;
+
+	if (!audio_clk_stat)
+		return 0;
+
+	if (substream->stream == SNDRV_PCM_STREAM_CAPTURE) {
+		fic = readl(i2s->regs + S3C2412_IISFIC);
+		words = S5P_IISFIC_RXCOUNT(fic);
+	} else {
+#ifdef CONFIG_S5P_INTERNAL_DMA
+		if (!s3c_dma_is_deep(substream))
+			fic = readl(i2s->regs + S5P_IISFICS);
+		else
+#endif
+			fic = readl(i2s->regs + S3C2412_IISFIC);
+		words = S5P_IISFIC_TXCOUNT(fic);
+	}
+
+	return bytes_to_frames(substream->runtime, words * 4);
+}
+
 /*
  * Set S3C2412 I2S DAI format
  */
@@ -522,8 +555,12 @@ static int s5p_i2s_wr_startup(struct snd_pcm_substream *substream,
 	else
 		rx_clk_enabled = 1;
 
+	/* deep buffer or IDMA, kept until the stream is closed */
+	s3c_dma_deep_select(substream);
+
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    !s3c_dma_is_deep(substream))
 		s5p_i2s_startup(dai);
 #endif
 
@@ -622,6 +659,7 @@ int s5p_i2sv5_register_dai(struct snd_soc_dai *dai)
 	ops->set_sysclk = s5p_i2s_set_sysclk;
 	ops->startup   = s5p_i2s_wr_startup;
 	ops->shutdown = s5p_i2s_wr_shutdown;
+	ops->delay = s5p_i2s_delay;
 	/* suspend/resume are not necessary due to Clock/Pwer gating scheme */
 	dai->suspend = s5p_i2s_suspend;
 	dai->resume = s5p_i2s_resume;
@@ -0,0 +1,877 @@
+/*
+ * mobilebench: replays the load patterns of an Android device to compare
+ * kernel builds, schedulers, I/O schedulers, zram compressors and cpufreq
+ * governors against each other.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Each test prints lines of "<test>.<metric> <value> <unit>", preceded by
+ * '#' comment lines describing the kernel and its settings, so the output
+ * of two runs can be compared with "mobilebench -c base.txt new.txt". The
+ * tests are:
+ *
+ *  ipc     synchronous request/reply round trips between two processes,
+ *          the wakeup pattern of binder transactions
+ *  fsync   bursts of SQLite style transactions in TRUNCATE journal mode:
+ *          journal write and fsync, database write and fsync, truncate
+ *  launch  the reads of an app launch, random pages of a large mapped
+ *          archive, mapped libraries and small whole files, cold (dropped
+ *          from the page cache with fadvise) and warm
+ *  mem     a ramp of anonymous memory filled with partly compressible
+ *          data, timing the faults of new pages and of pages touched
+ *          before, in a child so the low memory killer may take it
+ *  frame   60 Hz frames of fixed CPU work in bursts separated by idle,
+ *          timing wakeup and completion against the frame deadline
+ *
+ * Build for the device with "make CC=arm-linux-gnueabi-gcc" (static by
+ * default), push it to a writable directory such as /data/local/tmp and
+ * run it there, as root for the most stable numbers.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+
+#define PAGE_SZ		4096
+#define NSEC_PER_SEC	1000000000ULL
+
+static FILE *out;
+static const char *dir = "/data/local/tmp";
+static int scale = 1;
+static unsigned long mem_limit_mb;	/* 0 for half of MemTotal */
+static unsigned int frame_work_ms = 8;
+static unsigned int frame_bg_threads;
+
+/* Latency samples of one metric, in ns */
+struct lat {
+	unsigned long long *v;
+	size_t n, size;
+};
+
+static void die(const char *fmt, ...)
+{
+	va_list ap;
+	int err = errno;
+
+	va_start(ap, fmt);
+	fprintf(stderr, "mobilebench: ");
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fprintf(stderr, ": %s\n", strerror(err));
+	exit(1);
+}
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/* xorshift, so every run and every kernel sees the same sequence */
+static unsigned int rnd_state = 2463534242U;
+
+static unsigned int rnd(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state;
+}
+
+static void fill_random(void *buf, size_t len)
+{
+	unsigned int *p = buf;
+	size_t i;
+
+	for (i = 0; i < len / sizeof(*p); i++)
+		p[i] = rnd();
+}
+
+static void lat_add(struct lat *l, unsigned long long ns)
+{
+	if (l->n == l->size) {
+		l->size = l->size ? l->size * 2 : 1024;
+		l->v = realloc(l->v, l->size * sizeof(*l->v));
+		if (!l->v)
+			die("realloc");
+	}
+	l->v[l->n++] = ns;
+}
+
+static void report(const char *test, const char *metric, double value,
+		   const char *unit)
+{
+	char key[64];
+
+	snprintf(key, sizeof(key), "%s.%s", test, metric);
+	fprintf(out, "%-28s %14.3f %s\n", key, value, unit);
+}
+
+static int cmp_ull(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Reports the distribution of l in units of div ns, and frees it */
+static void lat_report(const char *test, const char *metric, struct lat *l,
+		       double div, const char *unit)
+{
+	static const int pct[] = { 50, 90, 99 };
+	unsigned long long sum = 0;
+	char name[48];
+	size_t i;
+
+	if (!l->n)
+		return;
+
+	qsort(l->v, l->n, sizeof(*l->v), cmp_ull);
+	for (i = 0; i < l->n; i++)
+		sum += l->v[i];
+
+	snprintf(name, sizeof(name), "%s.min", metric);
+	report(test, name, l->v[0] / div, unit);
+	for (i = 0; i < sizeof(pct) / sizeof(pct[0]); i++) {
+		snprintf(name, sizeof(name), "%s.p%d", metric, pct[i]);
+		report(test, name, l->v[(l->n - 1) * pct[i] / 100] / div, unit);
+	}
+	snprintf(name, sizeof(name), "%s.max", metric);
+	report(test, name, l->v[l->n - 1] / div, unit);
+	snprintf(name, sizeof(name), "%s.mean", metric);
+	report(test, name, (double)sum / l->n / div, unit);
+
+	free(l->v);
+	memset(l, 0, sizeof(*l));
+}
+
+static void xwrite(int fd, const void *buf, size_t len, off_t off)
+{
+	if (pwrite(fd, buf, len, off) != (ssize_t)len)
+		die("write");
+}
+
+static void xread(int fd, void *buf, size_t len)
+{
+	if (read(fd, buf, len) != (ssize_t)len)
+		die("read");
+}
+
+/* ipc: binder style round trips */
+
+#define IPC_MSG		128	/* a small parcel */
+
+static void bench_ipc(void)
+{
+	int req[2], rep[2], i, n = 20000 * scale;
+	char msg[IPC_MSG];
+	struct lat rtt = { 0 };
+	unsigned long long t0, start, total;
+	pid_t pid;
+
+	if (pipe(req) || pipe(rep))
+		die("pipe");
+
+	pid = fork();
+	if (pid < 0)
+		die("fork");
+	if (!pid) {
+		close(req[1]);
+		close(rep[0]);
+		while (read(req[0], msg, sizeof(msg)) == sizeof(msg))
+			if (write(rep[1], msg, sizeof(msg)) != sizeof(msg))
+				break;
+		_exit(0);
+	}
+	close(req[0]);
+	close(rep[1]);
+
+	fill_random(msg, sizeof(msg));
+	start = now_ns();
+	for (i = 0; i < n; i++) {
+		t0 = now_ns();
+		if (write(req[1], msg, sizeof(msg)) != sizeof(msg))
+			die("ipc write");
+		xread(rep[0], msg, sizeof(msg));
+		lat_add(&rtt, now_ns() - t0);
+	}
+	total = now_ns() - start;
+
+	close(req[1]);
+	close(rep[0]);
+	waitpid(pid, NULL, 0);
+
+	lat_report("ipc", "rtt", &rtt, 1e3, "us");
+	report("ipc", "throughput", n * (double)NSEC_PER_SEC / total, "ops/s");
+}
+
+/* fsync: SQLite transactions in bursts */
+
+#define FSYNC_DB_PAGES	1024
+#define FSYNC_BURST	10
+#define FSYNC_IDLE_US	100000
+
+static void bench_fsync(void)
+{
+	char db[PATH_MAX], journal[PATH_MAX], page[PAGE_SZ];
+	int dbfd, jfd, i, b, bursts = 20 * scale;
+	struct lat tx = { 0 };
+	unsigned long long t0, t, busy = 0;
+
+	snprintf(db, sizeof(db), "%s/mobilebench.db", dir);
+	snprintf(journal, sizeof(journal), "%s/mobilebench.db-journal", dir);
+
+	dbfd = open(db, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (dbfd < 0)
+		die("%s", db);
+	for (i = 0; i < FSYNC_DB_PAGES; i++) {
+		fill_random(page, sizeof(page));
+		xwrite(dbfd, page, sizeof(page), (off_t)i * PAGE_SZ);
+	}
+	fsync(dbfd);
+
+	jfd = open(journal, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (jfd < 0)
+		die("%s", journal);
+
+	for (b = 0; b < bursts; b++) {
+		for (i = 0; i < FSYNC_BURST; i++) {
+			fill_random(page, sizeof(page));
+			t0 = now_ns();
+			/* header and the two pages about to change */
+			xwrite(jfd, page, sizeof(page), 0);
+			xwrite(jfd, page, sizeof(page), PAGE_SZ);
+			xwrite(jfd, page, sizeof(page), 2 * PAGE_SZ);
+			fsync(jfd);
+			xwrite(dbfd, page, sizeof(page),
+			       (off_t)(rnd() % FSYNC_DB_PAGES) * PAGE_SZ);
+			xwrite(dbfd, page, sizeof(page),
+			       (off_t)(rnd() % FSYNC_DB_PAGES) * PAGE_SZ);
+			fsync(dbfd);
+			if (ftruncate(jfd, 0))
+				die("ftruncate");
+			fsync(jfd);
+			t = now_ns() - t0;
+			lat_add(&tx, t);
+			busy += t;
+		}
+		usleep(FSYNC_IDLE_US);
+	}
+
+	close(jfd);
+	close(dbfd);
+	unlink(journal);
+	unlink(db);
+
+	lat_report("fsync", "tx", &tx, 1e6, "ms");
+	report("fsync", "throughput",
+	       bursts * FSYNC_BURST * (double)NSEC_PER_SEC / busy, "tx/s");
+}
+
+/* launch: the reads of starting an app */
+
+#define LAUNCH_APK_MB		16
+#define LAUNCH_APK_PAGES	1024	/* touched at random */
+#define LAUNCH_LIBS		4
+#define LAUNCH_LIB_KB		1024
+#define LAUNCH_SMALL		48	/* 4 to 64 KB each */
+#define LAUNCH_FILES		(1 + LAUNCH_LIBS + LAUNCH_SMALL)
+
+static char launch_dir[PATH_MAX - 16];	/* room for the file names */
+
+static size_t launch_size(int i)
+{
+	if (!i)
+		return LAUNCH_APK_MB << 20;
+	if (i <= LAUNCH_LIBS)
+		return LAUNCH_LIB_KB << 10;
+	return PAGE_SZ << (i % 5);
+}
+
+static void launch_path(char *path, int i)
+{
+	snprintf(path, PATH_MAX, "%s/%d", launch_dir, i);
+}
+
+static void launch_setup(void)
+{
+	char path[PATH_MAX], buf[64 << 10];
+	size_t size, off;
+	int i, fd;
+
+	snprintf(launch_dir, sizeof(launch_dir), "%s/mobilebench.launch", dir);
+	if (mkdir(launch_dir, 0700) && errno != EEXIST)
+		die("%s", launch_dir);
+
+	for (i = 0; i < LAUNCH_FILES; i++) {
+		launch_path(path, i);
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		if (fd < 0)
+			die("%s", path);
+		size = launch_size(i);
+		for (off = 0; off < size; off += sizeof(buf)) {
+			fill_random(buf, sizeof(buf));
+			xwrite(fd, buf, size - off < sizeof(buf) ?
+			       size - off : sizeof(buf), off);
+		}
+		/* only clean pages can be dropped */
+		fsync(fd);
+		close(fd);
+	}
+}
+
+static void launch_cleanup(void)
+{
+	char path[PATH_MAX];
+	int i;
+
+	for (i = 0; i < LAUNCH_FILES; i++) {
+		launch_path(path, i);
+		unlink(path);
+	}
+	rmdir(launch_dir);
+}
+
+static void launch_drop(void)
+{
+	char path[PATH_MAX];
+	int i, fd;
+
+	for (i = 0; i < LAUNCH_FILES; i++) {
+		launch_path(path, i);
+		fd = open(path, O_RDONLY);
+		if (fd < 0)
+			die("%s", path);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+}
+
+static volatile unsigned long sink;
+
+/* Reads one launch worth of data, returns the bytes read */
+static size_t launch_once(struct lat *small)
+{
+	char path[PATH_MAX], buf[64 << 10];
+	unsigned long sum = 0;
+	size_t size, off, bytes = 0;
+	unsigned long long t0;
+	unsigned char *map;
+	int i, j, fd;
+
+	for (i = 0; i < LAUNCH_FILES; i++) {
+		launch_path(path, i);
+		size = launch_size(i);
+		t0 = now_ns();
+		fd = open(path, O_RDONLY);
+		if (fd < 0)
+			die("%s", path);
+
+		if (i > LAUNCH_LIBS) {
+			xread(fd, buf, size);
+			sum += buf[0];
+			bytes += size;
+			close(fd);
+			lat_add(small, now_ns() - t0);
+			continue;
+		}
+
+		map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED)
+			die("mmap %s", path);
+		if (!i) {
+			for (j = 0; j < LAUNCH_APK_PAGES; j++)
+				sum += map[(rnd() % (size / PAGE_SZ)) * PAGE_SZ];
+			bytes += LAUNCH_APK_PAGES * PAGE_SZ;
+		} else {
+			for (off = 0; off < size; off += PAGE_SZ)
+				sum += map[off];
+			bytes += size;
+		}
+		munmap(map, size);
+		close(fd);
+	}
+
+	sink = sum;
+	return bytes;
+}
+
+static void bench_launch(void)
+{
+	struct lat cold = { 0 }, warm = { 0 }, small = { 0 };
+	unsigned long long t0, t, busy = 0;
+	int i, rounds = 10 * scale;
+	size_t bytes = 0;
+
+	launch_setup();
+	for (i = 0; i < rounds; i++) {
+		launch_drop();
+		t0 = now_ns();
+		bytes += launch_once(&small);
+		t = now_ns() - t0;
+		lat_add(&cold, t);
+		busy += t;
+
+		t0 = now_ns();
+		launch_once(&small);
+		lat_add(&warm, now_ns() - t0);
+	}
+	launch_cleanup();
+
+	lat_report("launch", "cold", &cold, 1e6, "ms");
+	lat_report("launch", "warm", &warm, 1e6, "ms");
+	lat_report("launch", "file_read", &small, 1e3, "us");
+	report("launch", "cold_throughput",
+	       bytes * (double)NSEC_PER_SEC / busy / (1 << 20), "MB/s");
+}
+
+/* mem: a ramp of anonymous memory */
+
+#define MEM_STEP_MB	4
+#define MEM_STEP_PAGES	(MEM_STEP_MB << 20 >> 12)
+#define MEM_REFAULTS	64	/* earlier pages touched after each step */
+
+struct mem_result {
+	int steps;			/* completed */
+	unsigned long long *step_ns;	/* to fill each step */
+	unsigned long long *refault_ns;	/* MEM_REFAULTS per step */
+};
+
+static unsigned long mem_total_mb(void)
+{
+	unsigned long kb = 0;
+	char line[128];
+	FILE *f;
+
+	f = fopen("/proc/meminfo", "r");
+	if (!f)
+		return 0;
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, "MemTotal: %lu kB", &kb) == 1)
+			break;
+	fclose(f);
+	return kb >> 10;
+}
+
+/* About a quarter random, the rest repeats: anon pages compress ~3:1 */
+static void mem_fill_page(unsigned int *p)
+{
+	int i;
+
+	for (i = 0; i < PAGE_SZ / 4 / 4; i++)
+		p[i] = rnd();
+	for (; i < PAGE_SZ / 4; i++)
+		p[i] = i & 0xff;
+}
+
+static void mem_child(struct mem_result *res, int nsteps)
+{
+	unsigned char **chunks;
+	unsigned long long t0;
+	unsigned long sum = 0;
+	int step, i, c;
+
+	chunks = calloc(nsteps, sizeof(*chunks));
+	if (!chunks)
+		_exit(1);
+
+	for (step = 0; step < nsteps; step++) {
+		chunks[step] = mmap(NULL, MEM_STEP_MB << 20,
+				    PROT_READ | PROT_WRITE,
+				    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (chunks[step] == MAP_FAILED)
+			break;
+
+		t0 = now_ns();
+		for (i = 0; i < MEM_STEP_PAGES; i++)
+			mem_fill_page((unsigned int *)(chunks[step] +
+						       i * PAGE_SZ));
+		res->step_ns[step] = now_ns() - t0;
+
+		for (i = 0; step && i < MEM_REFAULTS; i++) {
+			c = rnd() % step;
+			t0 = now_ns();
+			sum += chunks[c][(rnd() % MEM_STEP_PAGES) * PAGE_SZ];
+			res->refault_ns[step * MEM_REFAULTS + i] =
+				now_ns() - t0;
+		}
+		res->steps = step + 1;
+	}
+
+	sink = sum;
+	_exit(0);
+}
+
+static void bench_mem(void)
+{
+	struct lat fill = { 0 }, refault = { 0 };
+	unsigned long limit = mem_limit_mb;
+	struct mem_result *res;
+	int nsteps, status, i;
+	size_t len;
+	pid_t pid;
+
+	if (!limit)
+		limit = mem_total_mb() / 2;
+	nsteps = limit / MEM_STEP_MB;
+	if (nsteps < 2)
+		nsteps = 2;
+
+	/* shared, so the results survive the child being killed */
+	len = sizeof(*res) + nsteps * (1 + MEM_REFAULTS) *
+		sizeof(unsigned long long);
+	res = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (res == MAP_FAILED)
+		die("mmap");
+	res->step_ns = (unsigned long long *)(res + 1);
+	res->refault_ns = res->step_ns + nsteps;
+
+	pid = fork();
+	if (pid < 0)
+		die("fork");
+	if (!pid)
+		mem_child(res, nsteps);
+	if (waitpid(pid, &status, 0) < 0)
+		die("waitpid");
+
+	for (i = 0; i < res->steps; i++)
+		lat_add(&fill, res->step_ns[i] / MEM_STEP_PAGES);
+	for (i = MEM_REFAULTS; i < res->steps * MEM_REFAULTS; i++)
+		lat_add(&refault, res->refault_ns[i]);
+
+	lat_report("mem", "fill_page", &fill, 1e3, "us");
+	lat_report("mem", "refault", &refault, 1e3, "us");
+	report("mem", "reached", res->steps * MEM_STEP_MB, "MB");
+	report("mem", "killed", WIFSIGNALED(status), "bool");
+
+	munmap(res, len);
+}
+
+/* frame: 60 Hz frame deadlines */
+
+#define FRAME_PERIOD_NS		16666667ULL
+#define FRAME_BURST		30
+#define FRAME_IDLE_US		500000
+
+static volatile int frame_stop;
+
+static void spin(unsigned long loops)
+{
+	unsigned long i, s = 0;
+
+	for (i = 0; i < loops; i++)
+		s += i ^ (s >> 3);
+	sink = s;
+}
+
+/* Loops per us once the governor has ramped the CPU up */
+static double spin_calibrate(void)
+{
+	unsigned long long t0, end = now_ns() + 300000000ULL;
+	double best = 0, rate;
+	int i;
+
+	while (now_ns() < end)
+		spin(10000);
+	for (i = 0; i < 3; i++) {
+		t0 = now_ns();
+		spin(1000000);
+		rate = 1e6 * 1e3 / (now_ns() - t0);
+		if (rate > best)
+			best = rate;
+	}
+	return best;
+}
+
+static void *frame_bg(void *unused)
+{
+	setpriority(PRIO_PROCESS, syscall(SYS_gettid), 10);
+	while (!frame_stop)
+		spin(100000);
+	return NULL;
+}
+
+static void bench_frame(void)
+{
+	struct lat wakeup = { 0 }, done = { 0 };
+	unsigned long long base, release, t;
+	int b, k, missed = 0, bursts = 10 * scale;
+	pthread_t *bg;
+	unsigned long loops;
+	struct timespec ts;
+	unsigned int i;
+
+	loops = spin_calibrate() * frame_work_ms * 1000;
+
+	bg = calloc(frame_bg_threads + 1, sizeof(*bg));
+	if (!bg)
+		die("calloc");
+	for (i = 0; i < frame_bg_threads; i++)
+		if (pthread_create(&bg[i], NULL, frame_bg, NULL))
+			die("pthread_create");
+
+	for (b = 0; b < bursts; b++) {
+		base = now_ns() + FRAME_PERIOD_NS;
+		for (k = 0; k < FRAME_BURST; k++) {
+			release = base + k * FRAME_PERIOD_NS;
+			ts.tv_sec = release / NSEC_PER_SEC;
+			ts.tv_nsec = release % NSEC_PER_SEC;
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+					       &ts, NULL) == EINTR)
+				;
+			lat_add(&wakeup, now_ns() - release);
+			spin(loops);
+			t = now_ns() - release;
+			lat_add(&done, t);
+			if (t > FRAME_PERIOD_NS)
+				missed++;
+		}
+		usleep(FRAME_IDLE_US);
+	}
+
+	frame_stop = 1;
+	for (i = 0; i < frame_bg_threads; i++)
+		pthread_join(bg[i], NULL);
+	free(bg);
+
+	lat_report("frame", "wakeup", &wakeup, 1e3, "us");
+	lat_report("frame", "done", &done, 1e6, "ms");
+	report("frame", "missed", 100.0 * missed / (bursts * FRAME_BURST),
+	       "%");
+}
+
+/* A/B comparison of two outputs */
+
+struct result {
+	char key[64];
+	double value;
+	char unit[16];
+};
+
+static int load_results(const char *path, struct result **res)
+{
+	char line[256];
+	int n = 0, size = 0;
+	struct result r;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f)
+		die("%s", path);
+	*res = NULL;
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#' ||
+		    sscanf(line, "%63s %lf %15s", r.key, &r.value, r.unit) != 3)
+			continue;
+		if (n == size) {
+			size = size ? size * 2 : 64;
+			*res = realloc(*res, size * sizeof(**res));
+			if (!*res)
+				die("realloc");
+		}
+		(*res)[n++] = r;
+	}
+	fclose(f);
+	return n;
+}
+
+/* Throughputs and how far the memory ramp got go up for the better */
+static int higher_is_better(const char *unit)
+{
+	return strstr(unit, "/s") || !strcmp(unit, "MB");
+}
+
+static int compare(const char *base_path, const char *new_path)
+{
+	struct result *base, *new;
+	int nbase, nnew, i, j;
+	double delta;
+	const char *verdict;
+
+	nbase = load_results(base_path, &base);
+	nnew = load_results(new_path, &new);
+
+	printf("%-28s %14s %14s %8s\n", "# metric", "base", "new", "delta");
+	for (i = 0; i < nnew; i++) {
+		for (j = 0; j < nbase; j++)
+			if (!strcmp(base[j].key, new[i].key))
+				break;
+		if (j == nbase)
+			continue;
+
+		verdict = "";
+		delta = 0;
+		if (base[j].value) {
+			delta = 100 * (new[i].value - base[j].value) /
+				base[j].value;
+			if (delta > 0.5 || delta < -0.5)
+				verdict = (delta > 0) ==
+					higher_is_better(new[i].unit) ?
+					"better" : "worse";
+		}
+		printf("%-28s %14.3f %14.3f %+7.1f%% %s %s\n", new[i].key,
+		       base[j].value, new[i].value, delta, new[i].unit,
+		       verdict);
+	}
+
+	free(base);
+	free(new);
+	return 0;
+}
+
+/* Prints the first line of a file as a comment, to tell runs apart */
+static void print_setting(const char *name, const char *path)
+{
+	char line[256];
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f)
+		return;
+	if (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\n")] = 0;
+		fprintf(out, "# %s: %s\n", name, line);
+	}
+	fclose(f);
+}
+
+static void print_header(void)
+{
+	struct utsname u;
+
+	if (!uname(&u))
+		fprintf(out, "# kernel: %s %s\n", u.release, u.version);
+	print_setting("governor",
+		      "/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor");
+	print_setting("iosched", "/sys/block/mmcblk0/queue/scheduler");
+	print_setting("zram", "/sys/block/zram0/comp_algorithm");
+	fprintf(out, "# scale: %d\n", scale);
+}
+
+static const struct {
+	const char *name;
+	void (*run)(void);
+} tests[] = {
+	{ "ipc",	bench_ipc },
+	{ "fsync",	bench_fsync },
+	{ "launch",	bench_launch },
+	{ "mem",	bench_mem },
+	{ "frame",	bench_frame },
+};
+
+#define NR_TESTS	(sizeof(tests) / sizeof(tests[0]))
+
+static int selected(const char *list, const char *test)
+{
+	char *names, *name;
+	int found = 0;
+
+	if (!list)
+		return 1;
+	names = strdup(list);
+	for (name = strtok(names, ","); name && !found;
+	     name = strtok(NULL, ","))
+		found = !strcmp(name, test);
+	free(names);
+	return found;
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: mobilebench [options]\n"
+		"       mobilebench -c base.txt new.txt\n"
+		"  -t tests   comma separated, of ipc,fsync,launch,mem,frame"
+		" (all)\n"
+		"  -d dir     directory for the test files (%s)\n"
+		"  -s scale   multiply the iterations of each test (1)\n"
+		"  -o file    write the results to file (stdout)\n"
+		"  -m MB      how far the memory ramp goes (MemTotal / 2)\n"
+		"  -w ms      CPU work of a frame at full speed (8)\n"
+		"  -b n       background threads during the frame test (0)\n"
+		"  -c         compare two outputs\n", dir);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	const char *list = NULL, *outfile = NULL;
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:d:s:o:m:w:b:ch")) != -1) {
+		switch (opt) {
+		case 't':
+			list = optarg;
+			break;
+		case 'd':
+			dir = optarg;
+			break;
+		case 's':
+			scale = atoi(optarg);
+			if (scale < 1)
+				usage();
+			break;
+		case 'o':
+			outfile = optarg;
+			break;
+		case 'm':
+			mem_limit_mb = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			frame_work_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			frame_bg_threads = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			if (argc - optind != 2)
+				usage();
+			return compare(argv[optind], argv[optind + 1]);
+		default:
+			usage();
+		}
+	}
+
+	out = stdout;
+	if (outfile) {
+		out = fopen(outfile, "w");
+		if (!out)
+			die("%s", outfile);
+	}
+	setvbuf(out, NULL, _IOLBF, 0);
+
+	print_header();
+
+	for (i = 0; i < NR_TESTS; i++) {
+		if (!selected(list, tests[i].name))
+			continue;
+		fprintf(stderr, "mobilebench: %s\n", tests[i].name);
+		tests[i].run();
+	}
+
+	if (out != stdout)
+		fclose(out);
+	return 0;
+}